@@ -0,0 +1,250 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "cbor.h"
+#include <math.h>
+#include <string.h>
+
+namespace
+{
+struct CborReader
+{
+    const uint8_t* data;
+    size_t size;
+    size_t offset;
+};
+
+bool read_bytes(CborReader& reader, size_t count, const uint8_t** out)
+{
+    if (reader.size - reader.offset < count)
+        return false;
+
+    *out = reader.data + reader.offset;
+    reader.offset += count;
+    return true;
+}
+
+bool read_uint(CborReader& reader, uint8_t info, uint64_t* out)
+{
+    if (info < 24)
+    {
+        *out = info;
+        return true;
+    }
+
+    size_t count;
+    switch (info)
+    {
+    case 24:
+        count = 1;
+        break;
+    case 25:
+        count = 2;
+        break;
+    case 26:
+        count = 4;
+        break;
+    case 27:
+        count = 8;
+        break;
+    default:
+        // Indefinite lengths are never sent by the compositor
+        return false;
+    }
+
+    const uint8_t* bytes;
+    if (!read_bytes(reader, count, &bytes))
+        return false;
+
+    *out = 0;
+    for (size_t i = 0; i < count; i++)
+        *out = (*out << 8) | bytes[i];
+    return true;
+}
+
+double half_to_double(uint16_t half)
+{
+    int exponent = (half >> 10) & 0x1F;
+    int mantissa = half & 0x3FF;
+    double value;
+    if (exponent == 0)
+        value = ldexp(mantissa, -24);
+    else if (exponent != 31)
+        value = ldexp(mantissa + 1024, exponent - 25);
+    else
+        value = mantissa == 0 ? INFINITY : NAN;
+    return (half & 0x8000) ? -value : value;
+}
+
+/// Reads the next item into [out]. json-c represents null as a NULL object,
+/// so failure is reported through the return value instead.
+bool read_item(CborReader& reader, int depth, json_object** out);
+
+bool read_array(CborReader& reader, uint64_t length, int depth, json_object** out)
+{
+    json_object* array = json_object_new_array();
+    for (uint64_t i = 0; i < length; i++)
+    {
+        json_object* item;
+        if (!read_item(reader, depth - 1, &item))
+        {
+            json_object_put(array);
+            return false;
+        }
+        json_object_array_add(array, item);
+    }
+
+    *out = array;
+    return true;
+}
+
+bool read_map(CborReader& reader, uint64_t length, int depth, json_object** out)
+{
+    json_object* object = json_object_new_object();
+    for (uint64_t i = 0; i < length; i++)
+    {
+        json_object* key;
+        if (!read_item(reader, depth - 1, &key))
+        {
+            json_object_put(object);
+            return false;
+        }
+
+        json_object* value;
+        if (!json_object_is_type(key, json_type_string) || !read_item(reader, depth - 1, &value))
+        {
+            json_object_put(key);
+            json_object_put(object);
+            return false;
+        }
+
+        json_object_object_add(object, json_object_get_string(key), value);
+        json_object_put(key);
+    }
+
+    *out = object;
+    return true;
+}
+
+bool read_simple(CborReader& reader, uint8_t info, json_object** out)
+{
+    uint64_t bits;
+    switch (info)
+    {
+    case 20:
+        *out = json_object_new_boolean(0);
+        return true;
+    case 21:
+        *out = json_object_new_boolean(1);
+        return true;
+    case 22:
+    case 23:
+        *out = NULL;
+        return true;
+    case 25:
+        if (!read_uint(reader, info, &bits))
+            return false;
+        *out = json_object_new_double(half_to_double(static_cast<uint16_t>(bits)));
+        return true;
+    case 26:
+    {
+        if (!read_uint(reader, info, &bits))
+            return false;
+        uint32_t bits32 = static_cast<uint32_t>(bits);
+        float value;
+        memcpy(&value, &bits32, sizeof(value));
+        *out = json_object_new_double(value);
+        return true;
+    }
+    case 27:
+    {
+        if (!read_uint(reader, info, &bits))
+            return false;
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        *out = json_object_new_double(value);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+bool read_item(CborReader& reader, int depth, json_object** out)
+{
+    const uint8_t* initial;
+    if (depth <= 0 || !read_bytes(reader, 1, &initial))
+        return false;
+
+    uint8_t major = *initial >> 5;
+    uint8_t info = *initial & 0x1F;
+    if (major == 7)
+        return read_simple(reader, info, out);
+
+    uint64_t argument;
+    if (!read_uint(reader, info, &argument))
+        return false;
+
+    switch (major)
+    {
+    case 0:
+        if (argument > INT64_MAX)
+            *out = json_object_new_uint64(argument);
+        else
+            *out = json_object_new_int64(static_cast<int64_t>(argument));
+        return true;
+    case 1:
+        if (argument > INT64_MAX)
+            return false;
+        *out = json_object_new_int64(-1 - static_cast<int64_t>(argument));
+        return true;
+    case 2:
+    case 3:
+    {
+        const uint8_t* bytes;
+        if (argument > INT32_MAX || !read_bytes(reader, argument, &bytes))
+            return false;
+        *out = json_object_new_string_len(reinterpret_cast<const char*>(bytes), static_cast<int>(argument));
+        return true;
+    }
+    case 4:
+        return read_array(reader, argument, depth, out);
+    case 5:
+        return read_map(reader, argument, depth, out);
+    case 6:
+        // Tags only annotate the item that follows them
+        return read_item(reader, depth - 1, out);
+    default:
+        return false;
+    }
+}
+}
+
+json_object* cbor_to_json_object(const uint8_t* data, size_t size, int max_depth)
+{
+    CborReader reader = { data, size, 0 };
+    json_object* result;
+    if (!read_item(reader, max_depth, &result))
+        return NULL;
+
+    if (reader.offset != size)
+    {
+        json_object_put(result);
+        return NULL;
+    }
+    return result;
+}
@@ -0,0 +1,32 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLEMSG_CBOR_H
+#define MIRACLEMSG_CBOR_H
+
+#include <json.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Decodes the CBOR encoded [data] into a json object, or returns NULL if it
+ * is malformed. Only the subset of CBOR that miracle-wm sends is understood:
+ * definite lengths with string keys. Tags are skipped.
+ */
+json_object* cbor_to_json_object(const uint8_t* data, size_t size, int max_depth);
+
+#endif
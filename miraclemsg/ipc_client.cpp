@@ -20,12 +20,15 @@ See the LICENSE.Sway file for details.
 
 #include "ipc_client.h"
 #include <cstdlib>
+#include <errno.h>
+#include <fcntl.h>
 #include <iostream>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 
@@ -166,28 +169,127 @@ error_1:
     return NULL;
 }
 
+bool ipc_recv_response_to_fd(int socketfd, int fd, uint32_t* type)
+{
+    char data[IPC_HEADER_SIZE];
+
+    size_t total = 0;
+    while (total < IPC_HEADER_SIZE)
+    {
+        ssize_t received = recv(socketfd, data + total, IPC_HEADER_SIZE - total, 0);
+        if (received <= 0)
+        {
+            std::cerr << "Unable to receive IPC response" << std::endl;
+            return false;
+        }
+        total += received;
+    }
+
+    uint32_t size;
+    memcpy(&size, data + sizeof(ipc_magic), sizeof(uint32_t));
+    memcpy(type, data + sizeof(ipc_magic) + sizeof(uint32_t), sizeof(uint32_t));
+
+    // splice moves the payload without copying it through userspace, but only
+    // when [fd] is a pipe. Anything else is copied through a buffer instead.
+    size_t remaining = size;
+    while (remaining > 0)
+    {
+        ssize_t moved = splice(socketfd, NULL, fd, NULL, remaining, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (moved > 0)
+        {
+            remaining -= moved;
+            continue;
+        }
+        if (moved < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (moved < 0 && errno == EINVAL)
+        {
+            break;
+        }
+
+        std::cerr << "Unable to receive IPC response" << std::endl;
+        return false;
+    }
+
+    char buffer[65536];
+    while (remaining > 0)
+    {
+        ssize_t received = recv(socketfd, buffer, remaining < sizeof(buffer) ? remaining : sizeof(buffer), 0);
+        if (received <= 0)
+        {
+            std::cerr << "Unable to receive IPC response" << std::endl;
+            return false;
+        }
+        remaining -= received;
+
+        for (ssize_t written = 0; written < received;)
+        {
+            ssize_t count = write(fd, buffer + written, received - written);
+            if (count < 0)
+            {
+                std::cerr << "Unable to write IPC response" << std::endl;
+                return false;
+            }
+            written += count;
+        }
+    }
+
+    return true;
+}
+
 void free_ipc_response(struct ipc_response* response)
 {
     free(response->payload);
     free(response);
 }
 
-char* ipc_single_command(int socketfd, uint32_t type, const char* payload, uint32_t* len)
+bool ipc_send_command(int socketfd, uint32_t type, const char* payload, uint32_t len)
 {
     char data[IPC_HEADER_SIZE];
     memcpy(data, ipc_magic, sizeof(ipc_magic));
-    memcpy(data + sizeof(ipc_magic), len, sizeof(*len));
-    memcpy(data + sizeof(ipc_magic) + sizeof(*len), &type, sizeof(type));
+    memcpy(data + sizeof(ipc_magic), &len, sizeof(len));
+    memcpy(data + sizeof(ipc_magic) + sizeof(len), &type, sizeof(type));
 
-    if (write(socketfd, data, IPC_HEADER_SIZE) == -1)
+    // Header and payload go out in a single syscall
+    struct iovec iov[2] = {
+        { .iov_base = data,                      .iov_len = IPC_HEADER_SIZE },
+        { .iov_base = const_cast<char*>(payload), .iov_len = len             }
+    };
+    size_t remaining = IPC_HEADER_SIZE + len;
+    int iovcnt = len > 0 ? 2 : 1;
+    struct iovec* next = iov;
+    while (remaining > 0)
     {
-        std::cerr << "Unable to send IPC header" << std::endl;
-        std::abort();
+        ssize_t written = writev(socketfd, next, iovcnt);
+        if (written == -1)
+        {
+            std::cerr << "Unable to send IPC message" << std::endl;
+            return false;
+        }
+
+        remaining -= written;
+        while (iovcnt > 0 && static_cast<size_t>(written) >= next->iov_len)
+        {
+            written -= next->iov_len;
+            next++;
+            iovcnt--;
+        }
+        if (iovcnt > 0)
+        {
+            next->iov_base = static_cast<char*>(next->iov_base) + written;
+            next->iov_len -= written;
+        }
     }
 
-    if (write(socketfd, payload, *len) == -1)
+    return true;
+}
+
+char* ipc_single_command(int socketfd, uint32_t type, const char* payload, uint32_t* len)
+{
+    if (!ipc_send_command(socketfd, type, payload, *len))
     {
-        std::cerr << "Unable to send IPC payload" << std::endl;
         std::abort();
     }
 
@@ -49,6 +49,11 @@ char* get_socketpath(void);
  * Opens the sway socket.
  */
 int ipc_open_socket(const char* socket_path);
+/**
+ * Sends an IPC message without waiting for its reply. Returns false if the
+ * message could not be written.
+ */
+bool ipc_send_command(int socketfd, uint32_t type, const char* payload, uint32_t len);
 /**
  * Issues a single IPC command and returns the buffer. len will be updated with
  * the length of the buffer returned from sway.
@@ -58,6 +63,11 @@ char* ipc_single_command(int socketfd, uint32_t type, const char* payload, uint3
  * Receives a single IPC response and returns an ipc_response.
  */
 struct ipc_response* ipc_recv_response(int socketfd);
+/**
+ * Receives a single IPC response and writes its payload to [fd] as it arrives,
+ * without holding on to it. [type] is set to the type of the response.
+ */
+bool ipc_recv_response_to_fd(int socketfd, int fd, uint32_t* type);
 /**
  * Free ipc_response struct
  */
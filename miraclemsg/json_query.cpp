@@ -0,0 +1,465 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "json_query.h"
+#include "ipc_client.h"
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+enum class StepKind
+{
+    member,
+    element,
+    descendant
+};
+
+struct QueryStep
+{
+    StepKind kind;
+    std::string key;
+};
+
+struct JsonScanner
+{
+    const char* p;
+    const char* end;
+};
+
+bool is_whitespace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+void skip_whitespace(JsonScanner& scanner)
+{
+    while (scanner.p < scanner.end && is_whitespace(*scanner.p))
+        scanner.p++;
+}
+
+bool at(JsonScanner& scanner, char c)
+{
+    skip_whitespace(scanner);
+    return scanner.p < scanner.end && *scanner.p == c;
+}
+
+/// Skips the string that [scanner] is at, setting [start] and [stop] to the
+/// bounds of its escaped contents.
+bool skip_string(JsonScanner& scanner, const char** start, const char** stop)
+{
+    if (!at(scanner, '"'))
+        return false;
+
+    *start = ++scanner.p;
+    while (scanner.p < scanner.end)
+    {
+        switch (*scanner.p)
+        {
+        case '"':
+            *stop = scanner.p++;
+            return true;
+        case '\\':
+            scanner.p += 2;
+            break;
+        default:
+            scanner.p++;
+            break;
+        }
+    }
+    return false;
+}
+
+/// Skips the value that [scanner] is at without looking inside of it, beyond
+/// matching up its brackets.
+bool skip_value(JsonScanner& scanner, int depth)
+{
+    skip_whitespace(scanner);
+    if (scanner.p >= scanner.end)
+        return false;
+
+    const char* start;
+    const char* stop;
+    switch (*scanner.p)
+    {
+    case '"':
+        return skip_string(scanner, &start, &stop);
+    case '{':
+    case '[':
+    {
+        int nesting = 0;
+        while (scanner.p < scanner.end)
+        {
+            switch (*scanner.p)
+            {
+            case '"':
+                if (!skip_string(scanner, &start, &stop))
+                    return false;
+                continue;
+            case '{':
+            case '[':
+                if (++nesting > depth)
+                    return false;
+                break;
+            case '}':
+            case ']':
+                if (--nesting == 0)
+                {
+                    scanner.p++;
+                    return true;
+                }
+                break;
+            }
+            scanner.p++;
+        }
+        return false;
+    }
+    default:
+        start = scanner.p;
+        while (scanner.p < scanner.end && !is_whitespace(*scanner.p)
+               && *scanner.p != ',' && *scanner.p != '}' && *scanner.p != ']')
+            scanner.p++;
+        return scanner.p != start;
+    }
+}
+
+int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+bool read_hex4(const char* p, const char* end, uint32_t* out)
+{
+    if (end - p < 4)
+        return false;
+
+    *out = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        int digit = hex_digit(p[i]);
+        if (digit < 0)
+            return false;
+        *out = (*out << 4) | digit;
+    }
+    return true;
+}
+
+void write_utf8(uint32_t code_point, FILE* out)
+{
+    if (code_point < 0x80)
+    {
+        fputc(code_point, out);
+    }
+    else if (code_point < 0x800)
+    {
+        fputc(0xC0 | (code_point >> 6), out);
+        fputc(0x80 | (code_point & 0x3F), out);
+    }
+    else if (code_point < 0x10000)
+    {
+        fputc(0xE0 | (code_point >> 12), out);
+        fputc(0x80 | ((code_point >> 6) & 0x3F), out);
+        fputc(0x80 | (code_point & 0x3F), out);
+    }
+    else
+    {
+        fputc(0xF0 | (code_point >> 18), out);
+        fputc(0x80 | ((code_point >> 12) & 0x3F), out);
+        fputc(0x80 | ((code_point >> 6) & 0x3F), out);
+        fputc(0x80 | (code_point & 0x3F), out);
+    }
+}
+
+/// Writes the escaped string contents between [p] and [end] to [out] unescaped.
+/// Runs without escapes are written in one go.
+void write_unescaped(const char* p, const char* end, FILE* out)
+{
+    while (p < end)
+    {
+        const char* escape = static_cast<const char*>(memchr(p, '\\', end - p));
+        if (!escape)
+        {
+            fwrite(p, 1, end - p, out);
+            return;
+        }
+
+        fwrite(p, 1, escape - p, out);
+        p = escape + 1;
+        if (p >= end)
+            return;
+
+        char c = *p++;
+        switch (c)
+        {
+        case 'n':
+            fputc('\n', out);
+            break;
+        case 't':
+            fputc('\t', out);
+            break;
+        case 'r':
+            fputc('\r', out);
+            break;
+        case 'b':
+            fputc('\b', out);
+            break;
+        case 'f':
+            fputc('\f', out);
+            break;
+        case 'u':
+        {
+            uint32_t code_point;
+            if (!read_hex4(p, end, &code_point))
+                break;
+            p += 4;
+
+            uint32_t low;
+            if (code_point >= 0xD800 && code_point < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u'
+                && read_hex4(p + 2, end, &low) && low >= 0xDC00 && low < 0xE000)
+            {
+                code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                p += 6;
+            }
+            write_utf8(code_point, out);
+            break;
+        }
+        default:
+            fputc(c, out);
+            break;
+        }
+    }
+}
+
+bool write_value(JsonScanner& scanner, int depth, FILE* out)
+{
+    skip_whitespace(scanner);
+    const char* start = scanner.p;
+    if (start < scanner.end && *start == '"')
+    {
+        const char* stop;
+        if (!skip_string(scanner, &start, &stop))
+            return false;
+        write_unescaped(start, stop, out);
+    }
+    else
+    {
+        if (!skip_value(scanner, depth))
+            return false;
+        fwrite(start, 1, scanner.p - start, out);
+    }
+    fputc('\n', out);
+    return true;
+}
+
+bool walk(JsonScanner& scanner, std::vector<QueryStep> const& steps, size_t index, int depth, FILE* out);
+
+/// Walks [scanner] with step [index] of a descendant match, and then again from
+/// the same place with the same step, so that matches nested within the match
+/// are found too.
+bool walk_descendant(JsonScanner& scanner, std::vector<QueryStep> const& steps, size_t index, int depth, FILE* out)
+{
+    const char* start = scanner.p;
+    if (!walk(scanner, steps, index + 1, depth, out))
+        return false;
+
+    scanner.p = start;
+    return walk(scanner, steps, index, depth, out);
+}
+
+bool walk_object(JsonScanner& scanner, std::vector<QueryStep> const& steps, size_t index, int depth, FILE* out)
+{
+    QueryStep const& step = steps[index];
+    scanner.p++;
+    if (at(scanner, '}'))
+    {
+        scanner.p++;
+        return true;
+    }
+
+    while (true)
+    {
+        const char* key;
+        const char* key_end;
+        if (!skip_string(scanner, &key, &key_end) || !at(scanner, ':'))
+            return false;
+        scanner.p++;
+
+        bool matches = step.kind != StepKind::element
+            && step.key.size() == static_cast<size_t>(key_end - key)
+            && memcmp(step.key.data(), key, step.key.size()) == 0;
+
+        bool walked;
+        if (matches && step.kind == StepKind::descendant)
+            walked = walk_descendant(scanner, steps, index, depth - 1, out);
+        else if (matches)
+            walked = walk(scanner, steps, index + 1, depth - 1, out);
+        else if (step.kind == StepKind::descendant)
+            walked = walk(scanner, steps, index, depth - 1, out);
+        else
+            walked = skip_value(scanner, depth - 1);
+
+        if (!walked)
+            return false;
+
+        if (at(scanner, ','))
+        {
+            scanner.p++;
+        }
+        else if (at(scanner, '}'))
+        {
+            scanner.p++;
+            return true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+}
+
+bool walk_array(JsonScanner& scanner, std::vector<QueryStep> const& steps, size_t index, int depth, FILE* out)
+{
+    QueryStep const& step = steps[index];
+    scanner.p++;
+    if (at(scanner, ']'))
+    {
+        scanner.p++;
+        return true;
+    }
+
+    while (true)
+    {
+        bool walked;
+        if (step.kind == StepKind::element)
+            walked = walk(scanner, steps, index + 1, depth - 1, out);
+        else if (step.kind == StepKind::descendant)
+            walked = walk(scanner, steps, index, depth - 1, out);
+        else
+            walked = skip_value(scanner, depth - 1);
+
+        if (!walked)
+            return false;
+
+        if (at(scanner, ','))
+        {
+            scanner.p++;
+        }
+        else if (at(scanner, ']'))
+        {
+            scanner.p++;
+            return true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+}
+
+/// Matches the value that [scanner] is at against the steps of the query from
+/// [index] onwards, writing it out once every step has matched.
+bool walk(JsonScanner& scanner, std::vector<QueryStep> const& steps, size_t index, int depth, FILE* out)
+{
+    if (depth <= 0)
+        return false;
+
+    if (index == steps.size())
+        return write_value(scanner, depth, out);
+
+    if (at(scanner, '{'))
+        return walk_object(scanner, steps, index, depth, out);
+    if (at(scanner, '['))
+        return walk_array(scanner, steps, index, depth, out);
+    return skip_value(scanner, depth);
+}
+}
+
+struct json_query
+{
+    std::vector<QueryStep> steps;
+};
+
+json_query* json_query_parse(const char* expression)
+{
+    if (expression[0] != '.')
+        return NULL;
+
+    auto query = new json_query;
+    const char* p = expression;
+    if (strcmp(p, ".") == 0)
+        return query;
+
+    while (*p)
+    {
+        QueryStep step;
+        if (strncmp(p, "[]", 2) == 0)
+        {
+            step.kind = StepKind::element;
+            p += 2;
+        }
+        else if (*p == '.')
+        {
+            step.kind = StepKind::member;
+            p++;
+            if (*p == '.')
+            {
+                step.kind = StepKind::descendant;
+                p++;
+            }
+
+            size_t length = strcspn(p, ".[");
+            if (length == 0)
+            {
+                delete query;
+                return NULL;
+            }
+            step.key.assign(p, length);
+            p += length;
+        }
+        else
+        {
+            delete query;
+            return NULL;
+        }
+
+        query->steps.push_back(std::move(step));
+    }
+
+    return query;
+}
+
+void json_query_free(json_query* query)
+{
+    delete query;
+}
+
+bool json_query_run(const json_query* query, const char* data, size_t size, FILE* out)
+{
+    JsonScanner scanner { data, data + size };
+    if (!walk(scanner, query->steps, 0, JSON_MAX_DEPTH, out))
+        return false;
+
+    skip_whitespace(scanner);
+    return scanner.p == scanner.end;
+}
@@ -0,0 +1,47 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLEMSG_JSON_QUERY_H
+#define MIRACLEMSG_JSON_QUERY_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * A path into a json document, like ".nodes[].name" or "..app_id".
+ *
+ * ".key" selects a member of an object, "[]" selects every element of an array
+ * and "..key" selects a member at any depth. A lone "." selects the document.
+ */
+struct json_query;
+
+/**
+ * Parses [expression] into a query, or returns NULL if it is malformed.
+ */
+json_query* json_query_parse(const char* expression);
+
+void json_query_free(json_query* query);
+
+/**
+ * Writes every value in the json text [data] that [query] selects to [out],
+ * one per line. Strings are written unquoted and unescaped; other values are
+ * written as they appear in [data]. The text is scanned in place, so no
+ * document is built. Returns false if [data] is malformed.
+ */
+bool json_query_run(const json_query* query, const char* data, size_t size, FILE* out);
+
+#endif
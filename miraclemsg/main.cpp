@@ -18,7 +18,9 @@ Portions of this code originate from swaymsg, licensed under the MIT license.
 See the LICENSE.Sway file for details.
 **/
 
+#include "cbor.h"
 #include "ipc_client.h"
+#include "json_query.h"
 #include <ctype.h>
 #include <getopt.h>
 #include <iostream>
@@ -192,6 +194,47 @@ static void pretty_print_input(json_object* i)
     printf("\n");
 }
 
+/**
+ * Parses a reply [payload] of [size] bytes, which is CBOR when [cbor] is set
+ * and JSON otherwise. Returns NULL and prints the error unless [quiet].
+ */
+static json_object* parse_payload(const char* payload, size_t size, bool cbor, bool quiet)
+{
+    if (cbor)
+    {
+        json_object* obj = cbor_to_json_object(reinterpret_cast<const uint8_t*>(payload), size, JSON_MAX_DEPTH);
+        if (obj == NULL && !quiet)
+        {
+            std::cerr << "failed to parse payload as cbor" << std::endl;
+        }
+        return obj;
+    }
+
+    json_tokener* tok = json_tokener_new_ex(JSON_MAX_DEPTH);
+    if (tok == NULL)
+    {
+        if (quiet)
+        {
+            exit(EXIT_FAILURE);
+        }
+        std::cerr << "failed allocating json_tokener" << std::endl;
+        std::abort();
+    }
+    json_object* obj = json_tokener_parse_ex(tok, payload, size);
+    enum json_tokener_error err = json_tokener_get_error(tok);
+    json_tokener_free(tok);
+    if (obj == NULL || err != json_tokener_success)
+    {
+        if (!quiet)
+        {
+            std::cerr << "failed to parse payload as json: " << json_tokener_error_desc(err) << std::endl;
+        }
+        json_object_put(obj);
+        return NULL;
+    }
+    return obj;
+}
+
 char* join_args(char** argv, int argc)
 {
     int len = 0, i;
@@ -494,32 +537,225 @@ static void pretty_print(int type, json_object* resp)
     }
 }
 
+/**
+ * Prints [obj], the reply to a message of [type], and returns the exit code for
+ * it. When [compact] is set, every reply is printed as a single line of json so
+ * that a script can read them back one line at a time.
+ */
+static int print_reply(uint32_t type, json_object* obj, bool quiet, bool raw, bool compact)
+{
+    int ret = success(obj, true) ? 0 : 2;
+    if (quiet)
+    {
+        return ret;
+    }
+
+    if (compact)
+    {
+        printf("%s\n", json_object_to_json_string_ext(obj, JSON_C_TO_STRING_PLAIN));
+    }
+    else if (type != IPC_SUBSCRIBE || ret != 0)
+    {
+        if (raw)
+        {
+            printf("%s\n", json_object_to_json_string_ext(obj, JSON_C_TO_STRING_PRETTY | JSON_C_TO_STRING_SPACED));
+        }
+        else
+        {
+            pretty_print(type, obj);
+        }
+    }
+    return ret;
+}
+
+/**
+ * Prints the event in [reply], one line per event when [raw] is set. Raw json
+ * events are written out as they were received, without being parsed. When
+ * there is a [query], only the values that it selects are printed. Returns
+ * false if the event could not be parsed.
+ */
+static bool print_event(struct ipc_response* reply, bool cbor, bool quiet, bool raw, const json_query* query)
+{
+    if (quiet)
+    {
+        return true;
+    }
+
+    if (query)
+    {
+        bool parsed = json_query_run(query, reply->payload, reply->size, stdout);
+        fflush(stdout);
+        return parsed;
+    }
+
+    if (raw && !cbor)
+    {
+        fwrite(reply->payload, 1, reply->size, stdout);
+        fputc('\n', stdout);
+        fflush(stdout);
+        return true;
+    }
+
+    json_object* obj = parse_payload(reply->payload, reply->size, cbor, quiet);
+    if (obj == NULL)
+    {
+        return false;
+    }
+
+    if (raw)
+    {
+        printf("%s\n", json_object_to_json_string_ext(obj, JSON_C_TO_STRING_PLAIN));
+    }
+    else
+    {
+        printf("%s\n", json_object_to_json_string_ext(obj, JSON_C_TO_STRING_PRETTY | JSON_C_TO_STRING_SPACED));
+    }
+    fflush(stdout);
+    json_object_put(obj);
+    return true;
+}
+
+/**
+ * Sends every line of stdin as a message of [type] over [socketfd], printing
+ * each reply as it arrives. Events that arrive in between, for lines that
+ * subscribed, are printed as they come. Returns the highest exit code of any
+ * reply.
+ */
+static int run_stdin(int socketfd, uint32_t type, bool cbor, bool quiet, bool raw)
+{
+    int ret = 0;
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t read;
+    while ((read = getline(&line, &capacity, stdin)) != -1)
+    {
+        if (read > 0 && line[read - 1] == '\n')
+        {
+            line[--read] = '\0';
+        }
+        if (read == 0)
+        {
+            continue;
+        }
+
+        if (!ipc_send_command(socketfd, type, line, read))
+        {
+            ret = 1;
+            break;
+        }
+
+        struct ipc_response* reply;
+        while ((reply = ipc_recv_response(socketfd)) != NULL && (reply->type & (1u << 31)))
+        {
+            if (!print_event(reply, cbor, quiet, raw, NULL))
+            {
+                ret = 1;
+            }
+            free_ipc_response(reply);
+        }
+        if (!reply)
+        {
+            ret = 1;
+            break;
+        }
+
+        json_object* obj = parse_payload(reply->payload, reply->size, cbor, quiet);
+        free_ipc_response(reply);
+        if (obj == NULL)
+        {
+            ret = 1;
+            continue;
+        }
+
+        int result = print_reply(type, obj, quiet, raw, raw);
+        if (result > ret)
+        {
+            ret = result;
+        }
+        fflush(stdout);
+        json_object_put(obj);
+    }
+
+    free(line);
+    return ret;
+}
+
+/**
+ * Looks up the message type called [name], case insensitively. Returns false
+ * if there is no such type.
+ */
+static bool message_type_from_name(const char* name, uint32_t* type)
+{
+    static const struct
+    {
+        const char* name;
+        uint32_t type;
+    } types[] = {
+        { "command",           IPC_COMMAND           },
+        { "get_workspaces",    IPC_GET_WORKSPACES    },
+        { "get_seats",         IPC_GET_SEATS         },
+        { "get_inputs",        IPC_GET_INPUTS        },
+        { "get_outputs",       IPC_GET_OUTPUTS       },
+        { "get_tree",          IPC_GET_TREE          },
+        { "get_marks",         IPC_GET_MARKS         },
+        { "get_bar_config",    IPC_GET_BAR_CONFIG    },
+        { "get_version",       IPC_GET_VERSION       },
+        { "get_binding_modes", IPC_GET_BINDING_MODES },
+        { "get_binding_state", IPC_GET_BINDING_STATE },
+        { "get_config",        IPC_GET_CONFIG        },
+        { "send_tick",         IPC_SEND_TICK         },
+        { "subscribe",         IPC_SUBSCRIBE         },
+    };
+
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); ++i)
+    {
+        if (strcasecmp(types[i].name, name) == 0)
+        {
+            *type = types[i].type;
+            return true;
+        }
+    }
+
+    return false;
+}
+
 int main(int argc, char** argv)
 {
     static bool quiet = false;
     static bool raw = false;
     static bool monitor = false;
+    static bool cbor = false;
+    static bool read_stdin = false;
     char* socket_path = NULL;
     char* cmdtype = NULL;
+    char* query_expression = NULL;
 
     static const struct option long_options[] = {
-        { "help",    no_argument,       NULL, 'h' },
-        { "monitor", no_argument,       NULL, 'm' },
-        { "pretty",  no_argument,       NULL, 'p' },
-        { "quiet",   no_argument,       NULL, 'q' },
-        { "raw",     no_argument,       NULL, 'r' },
-        { "socket",  required_argument, NULL, 's' },
-        { "type",    required_argument, NULL, 't' },
-        { "version", no_argument,       NULL, 'v' },
-        { 0,         0,                 0,    0   }
+        { "encoding", required_argument, NULL, 'e' },
+        { "help",     no_argument,       NULL, 'h' },
+        { "stdin",    no_argument,       NULL, 'i' },
+        { "monitor",  no_argument,       NULL, 'm' },
+        { "pretty",   no_argument,       NULL, 'p' },
+        { "query",    required_argument, NULL, 'Q' },
+        { "quiet",    no_argument,       NULL, 'q' },
+        { "raw",      no_argument,       NULL, 'r' },
+        { "socket",   required_argument, NULL, 's' },
+        { "type",     required_argument, NULL, 't' },
+        { "version",  no_argument,       NULL, 'v' },
+        { 0,          0,                 0,    0   }
     };
 
     const char* usage = "Usage: swaymsg [options] [message]\n"
                         "\n"
+                        "  -e, --encoding <name>  Receive replies as json (default) or cbor.\n"
                         "  -h, --help             Show help message and quit.\n"
-                        "  -m, --monitor          Monitor until killed (-t SUBSCRIBE only)\n"
+                        "  -i, --stdin            Send each line of stdin as a message over one\n"
+                        "                         connection, printing a reply per line.\n"
+                        "  -m, --monitor          Monitor until killed (-t SUBSCRIBE only, the default)\n"
                         "  -p, --pretty           Use pretty output even when not using a tty\n"
                         "  -q, --quiet            Be quiet.\n"
+                        "  -Q, --query <path>     Print only the values at a path, like ..name or\n"
+                        "                         .nodes[].id, without parsing the whole reply.\n"
                         "  -r, --raw              Use raw output even if using a tty\n"
                         "  -s, --socket <socket>  Use the specified socket.\n"
                         "  -t, --type <type>      Specify the message type.\n"
@@ -531,13 +767,27 @@ int main(int argc, char** argv)
     while (1)
     {
         int option_index = 0;
-        c = getopt_long(argc, argv, "hmpqrs:t:v", long_options, &option_index);
+        c = getopt_long(argc, argv, "e:himpqQ:rs:t:v", long_options, &option_index);
         if (c == -1)
         {
             break;
         }
         switch (c)
         {
+        case 'e': // Encoding
+            if (strcasecmp(optarg, "cbor") == 0)
+            {
+                cbor = true;
+            }
+            else if (strcasecmp(optarg, "json") != 0)
+            {
+                fprintf(stderr, "Unknown encoding: %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'i': // Stdin
+            read_stdin = true;
+            break;
         case 'm': // Monitor
             monitor = true;
             break;
@@ -547,6 +797,9 @@ int main(int argc, char** argv)
         case 'q': // Quiet
             quiet = true;
             break;
+        case 'Q': // Query
+            query_expression = strdup(optarg);
+            break;
         case 'r': // Raw
             raw = true;
             break;
@@ -568,7 +821,7 @@ int main(int argc, char** argv)
 
     if (!cmdtype)
     {
-        cmdtype = strdup("command");
+        cmdtype = strdup(monitor ? "subscribe" : "command");
     }
     if (!socket_path)
     {
@@ -585,64 +838,7 @@ int main(int argc, char** argv)
     }
 
     uint32_t type = IPC_COMMAND;
-
-    if (strcasecmp(cmdtype, "command") == 0)
-    {
-        type = IPC_COMMAND;
-    }
-    else if (strcasecmp(cmdtype, "get_workspaces") == 0)
-    {
-        type = IPC_GET_WORKSPACES;
-    }
-    else if (strcasecmp(cmdtype, "get_seats") == 0)
-    {
-        type = IPC_GET_SEATS;
-    }
-    else if (strcasecmp(cmdtype, "get_inputs") == 0)
-    {
-        type = IPC_GET_INPUTS;
-    }
-    else if (strcasecmp(cmdtype, "get_outputs") == 0)
-    {
-        type = IPC_GET_OUTPUTS;
-    }
-    else if (strcasecmp(cmdtype, "get_tree") == 0)
-    {
-        type = IPC_GET_TREE;
-    }
-    else if (strcasecmp(cmdtype, "get_marks") == 0)
-    {
-        type = IPC_GET_MARKS;
-    }
-    else if (strcasecmp(cmdtype, "get_bar_config") == 0)
-    {
-        type = IPC_GET_BAR_CONFIG;
-    }
-    else if (strcasecmp(cmdtype, "get_version") == 0)
-    {
-        type = IPC_GET_VERSION;
-    }
-    else if (strcasecmp(cmdtype, "get_binding_modes") == 0)
-    {
-        type = IPC_GET_BINDING_MODES;
-    }
-    else if (strcasecmp(cmdtype, "get_binding_state") == 0)
-    {
-        type = IPC_GET_BINDING_STATE;
-    }
-    else if (strcasecmp(cmdtype, "get_config") == 0)
-    {
-        type = IPC_GET_CONFIG;
-    }
-    else if (strcasecmp(cmdtype, "send_tick") == 0)
-    {
-        type = IPC_SEND_TICK;
-    }
-    else if (strcasecmp(cmdtype, "subscribe") == 0)
-    {
-        type = IPC_SUBSCRIBE;
-    }
-    else
+    if (!message_type_from_name(cmdtype, &type))
     {
         if (quiet)
         {
@@ -664,6 +860,57 @@ int main(int argc, char** argv)
         return 1;
     }
 
+    json_query* query = NULL;
+    if (query_expression)
+    {
+        query = json_query_parse(query_expression);
+        free(query_expression);
+        const char* error = NULL;
+        if (!query)
+        {
+            error = "Invalid query, expected a path like ..name or .nodes[].id";
+        }
+        else if (cbor)
+        {
+            error = "--query can only be used with the json encoding";
+        }
+        else if (read_stdin)
+        {
+            error = "--query cannot be used with --stdin";
+        }
+
+        if (error)
+        {
+            if (!quiet)
+            {
+                std::cerr << error << std::endl;
+            }
+            json_query_free(query);
+            free(socket_path);
+            return 1;
+        }
+    }
+
+    if (read_stdin && monitor)
+    {
+        if (!quiet)
+        {
+            std::cerr << "Monitor cannot be used with --stdin" << std::endl;
+        }
+        free(socket_path);
+        return 1;
+    }
+
+    if (read_stdin && optind < argc)
+    {
+        if (!quiet)
+        {
+            std::cerr << "A message cannot be given with --stdin" << std::endl;
+        }
+        free(socket_path);
+        return 1;
+    }
+
     char* command = NULL;
     if (optind < argc)
     {
@@ -678,48 +925,91 @@ int main(int argc, char** argv)
     int socketfd = ipc_open_socket(socket_path);
     struct timeval timeout = { .tv_sec = 3, .tv_usec = 0 };
     ipc_set_recv_timeout(socketfd, timeout);
-    uint32_t len = strlen(command);
-    char* resp = ipc_single_command(socketfd, type, command, &len);
 
-    // pretty print the json
-    json_tokener* tok = json_tokener_new_ex(JSON_MAX_DEPTH);
-    if (tok == NULL)
+    if (cbor)
     {
-        if (quiet)
+        // The compositor replies to this in the new encoding, so it doubles as a check
+        uint32_t encoding_len = strlen("cbor");
+        char* encoding_resp = ipc_single_command(socketfd, IPC_SET_ENCODING, "cbor", &encoding_len);
+        json_object* encoding_obj = parse_payload(encoding_resp, encoding_len, true, quiet);
+        free(encoding_resp);
+        if (encoding_obj == NULL || !success(encoding_obj, false))
         {
-            exit(EXIT_FAILURE);
+            if (!quiet)
+            {
+                std::cerr << "the compositor does not support the cbor encoding" << std::endl;
+            }
+            json_object_put(encoding_obj);
+            close(socketfd);
+            free(command);
+            free(socket_path);
+            return 1;
         }
-        std::cerr << "failed allocating json_tokener" << std::endl;
-        std::abort();
+        json_object_put(encoding_obj);
     }
-    json_object* obj = json_tokener_parse_ex(tok, resp, -1);
-    enum json_tokener_error err = json_tokener_get_error(tok);
-    json_tokener_free(tok);
-    if (obj == NULL || err != json_tokener_success)
+
+    if (read_stdin)
     {
-        if (!quiet)
-        {
-            std::cerr << "failed to parse payload as json: " << json_tokener_error_desc(err) << std::endl;
-        }
-        ret = 1;
+        ret = run_stdin(socketfd, type, cbor, quiet, raw);
+        close(socketfd);
+        free(command);
+        free(socket_path);
+        return ret;
     }
-    else
+
+    // Replies whose exit code does not depend on their contents can go
+    // straight to stdout when they are printed as they are
+    bool passthrough = raw && !cbor && !quiet && !query
+        && type != IPC_COMMAND && type != IPC_SUBSCRIBE && type != IPC_SEND_TICK;
+    if (passthrough)
     {
-        if (!success(obj, true))
+        uint32_t reply_type;
+        fflush(stdout);
+        if (ipc_send_command(socketfd, type, command, strlen(command))
+            && ipc_recv_response_to_fd(socketfd, STDOUT_FILENO, &reply_type))
         {
-            ret = 2;
+            printf("\n");
         }
-        if (!quiet && (type != IPC_SUBSCRIBE || ret != 0))
+        else
         {
-            if (raw)
-            {
-                printf("%s\n", json_object_to_json_string_ext(obj, JSON_C_TO_STRING_PRETTY | JSON_C_TO_STRING_SPACED));
-            }
-            else
+            ret = 1;
+        }
+        close(socketfd);
+        free(command);
+        free(socket_path);
+        return ret;
+    }
+
+    uint32_t len = strlen(command);
+    char* resp = ipc_single_command(socketfd, type, command, &len);
+
+    if (query && type != IPC_SUBSCRIBE)
+    {
+        if (!json_query_run(query, resp, len, stdout))
+        {
+            if (!quiet)
             {
-                pretty_print(type, obj);
+                std::cerr << "failed to parse payload as json" << std::endl;
             }
+            ret = 1;
         }
+        json_query_free(query);
+        close(socketfd);
+        free(command);
+        free(resp);
+        free(socket_path);
+        return ret;
+    }
+
+    // pretty print the json
+    json_object* obj = parse_payload(resp, len, cbor, quiet);
+    if (obj == NULL)
+    {
+        ret = 1;
+    }
+    else
+    {
+        ret = print_reply(type, obj, quiet, raw, false);
         json_object_put(obj);
     }
     free(command);
@@ -732,58 +1022,42 @@ int main(int argc, char** argv)
         timeout.tv_usec = 0;
         ipc_set_recv_timeout(socketfd, timeout);
 
+        bool passthrough_events = raw && !cbor && !quiet && !query;
+        if (passthrough_events)
+        {
+            fflush(stdout);
+        }
+
         do
         {
+            if (passthrough_events)
+            {
+                uint32_t event_type;
+                if (!ipc_recv_response_to_fd(socketfd, STDOUT_FILENO, &event_type)
+                    || write(STDOUT_FILENO, "\n", 1) != 1)
+                {
+                    break;
+                }
+                continue;
+            }
+
             struct ipc_response* reply = ipc_recv_response(socketfd);
             if (!reply)
             {
                 break;
             }
 
-            json_tokener* tok = json_tokener_new_ex(JSON_MAX_DEPTH);
-            if (tok == NULL)
-            {
-                if (quiet)
-                {
-                    exit(EXIT_FAILURE);
-                }
-                std::cerr << "failed allocating json_tokener" << std::endl;
-                std::abort();
-            }
-            json_object* obj = json_tokener_parse_ex(tok, reply->payload, -1);
-            enum json_tokener_error err = json_tokener_get_error(tok);
-            json_tokener_free(tok);
-            if (obj == NULL || err != json_tokener_success)
+            bool parsed = print_event(reply, cbor, quiet, raw, query);
+            free_ipc_response(reply);
+            if (!parsed)
             {
-                if (!quiet)
-                {
-                    std::cerr << "failed to parse payload as json: " << json_tokener_error_desc(err) << std::endl;
-                }
                 ret = 1;
                 break;
             }
-            else if (quiet)
-            {
-                json_object_put(obj);
-            }
-            else
-            {
-                if (raw)
-                {
-                    printf("%s\n", json_object_to_json_string(obj));
-                }
-                else
-                {
-                    printf("%s\n", json_object_to_json_string_ext(obj, JSON_C_TO_STRING_PRETTY | JSON_C_TO_STRING_SPACED));
-                }
-                fflush(stdout);
-                json_object_put(obj);
-            }
-
-            free_ipc_response(reply);
         } while (monitor);
     }
 
+    json_query_free(query);
     close(socketfd);
     free(socket_path);
     return ret;
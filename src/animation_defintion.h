@@ -19,11 +19,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIRACLE_WM_ANIMATION_DEFINTION_H
 
 #include "mir/geometry/point.h"
+#include <memory>
 #include <optional>
 #include <string>
 
 namespace miracle
 {
+class EaseTable;
+
 /// Defines an event that can be animated.
 enum class AnimateableEvent
 {
@@ -88,6 +91,11 @@ struct AnimationDefinition
     EaseFunction function = EaseFunction::linear;
     float duration_seconds = 1.f;
 
+    /// When true, the window is given its final geometry once, at the end of the
+    /// animation, and is otherwise animated purely by its transform. This spares
+    /// the client from resizing on every frame.
+    bool compositor_only = false;
+
     // Easing function values
     float c1 = 1.2f;
     float c2 = 1.83f;
@@ -96,6 +104,10 @@ struct AnimationDefinition
     float c5 = 1.3962634015954636f;
     float n1 = 7.5625f;
     float d1 = 2.75f;
+
+    /// The ease function sampled from the values above, built when the
+    /// configuration is loaded. See [compile_ease_table].
+    std::shared_ptr<EaseTable const> ease_table;
 };
 
 std::optional<AnimateableEvent> from_string_animateable_event(std::string const&);
@@ -0,0 +1,124 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "animation_trace.h"
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+using namespace miracle;
+
+AnimationTrace::AnimationTrace(size_t capacity) :
+    capacity { std::max<size_t>(capacity, 1) }
+{
+    buffer.reserve(this->capacity);
+}
+
+void AnimationTrace::record(std::vector<AnimationTraceRecord> const& records)
+{
+    std::lock_guard lock(mutex);
+    for (auto const& record : records)
+    {
+        if (buffer.size() < capacity)
+            buffer.push_back(record);
+        else
+            buffer[next] = record;
+        next = (next + 1) % capacity;
+    }
+}
+
+std::vector<AnimationTraceRecord> AnimationTrace::records() const
+{
+    std::lock_guard lock(mutex);
+    if (buffer.size() < capacity)
+        return buffer;
+
+    std::vector<AnimationTraceRecord> result;
+    result.reserve(buffer.size());
+    result.insert(result.end(), buffer.begin() + next, buffer.end());
+    result.insert(result.end(), buffer.begin(), buffer.begin() + next);
+    return result;
+}
+
+nlohmann::json AnimationTrace::to_chrome_trace() const
+{
+    // Timestamps and durations are in microseconds
+    auto const to_us = [](int64_t ns)
+    {
+        return static_cast<double>(ns) / 1e3;
+    };
+
+    nlohmann::json events = nlohmann::json::array();
+    for (auto const& record : records())
+    {
+        switch (record.type)
+        {
+        case AnimationTraceRecord::Type::tick:
+            events.push_back({
+                { "name", "tick" },
+                { "ph", "X" },
+                { "pid", 0 },
+                { "tid", record.thread },
+                { "ts", to_us(record.start_ns) },
+                { "dur", to_us(record.duration_ns) },
+                { "args", { { "dt_ms", record.value * 1e3 }, { "active", record.count } } }
+            });
+            events.push_back({
+                { "name", "active animations" },
+                { "ph", "C" },
+                { "pid", 0 },
+                { "ts", to_us(record.start_ns) },
+                { "args", { { "count", record.count } } }
+            });
+            break;
+        case AnimationTraceRecord::Type::step:
+            events.push_back({
+                { "name", "on_tick" },
+                { "ph", "X" },
+                { "pid", 0 },
+                { "tid", record.thread },
+                { "ts", to_us(record.start_ns) },
+                { "dur", to_us(record.duration_ns) },
+                { "args", { { "handle", record.count }, { "progress", record.value } } }
+            });
+            events.push_back({
+                { "name", "progress " + std::to_string(record.count) },
+                { "ph", "C" },
+                { "pid", 0 },
+                { "ts", to_us(record.start_ns) },
+                { "args", { { "progress", record.value } } }
+            });
+            break;
+        }
+    }
+
+    return {
+        { "traceEvents", events },
+        { "displayTimeUnit", "ms" }
+    };
+}
+
+uint32_t AnimationTrace::current_thread()
+{
+    return static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+}
+
+int64_t AnimationTrace::to_ns(clock::time_point time)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
@@ -0,0 +1,91 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_ANIMATION_TRACE_H
+#define MIRACLE_WM_ANIMATION_TRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <vector>
+
+namespace miracle
+{
+
+/// A single entry in the [AnimationTrace]. Entries are kept small so that a
+/// trace of many seconds fits in a modest buffer.
+struct AnimationTraceRecord
+{
+    enum class Type : uint8_t
+    {
+        /// A whole tick of the animator. [count] is the number of active animations
+        /// and [value] is the dt of the tick in seconds.
+        tick,
+
+        /// The step of a single animation within a tick. [count] is the handle of
+        /// the animation, [value] is its progress and [duration_ns] is the time
+        /// spent in its on_tick callback.
+        step
+    };
+
+    Type type = Type::tick;
+    uint32_t thread = 0;
+    uint32_t count = 0;
+    float value = 0;
+    int64_t start_ns = 0;
+    int64_t duration_ns = 0;
+};
+
+/// Records the timeline of the animator into a fixed-size ring buffer, so that
+/// dt spikes and dropped frames can be inspected after the fact.
+///
+/// The animator writes a tick's records at once, and the trace may be read
+/// from any thread.
+class AnimationTrace
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    /// [capacity] is the number of records that are kept before the oldest are overwritten.
+    explicit AnimationTrace(size_t capacity = 16384);
+
+    /// Appends the [records] of a single tick.
+    void record(std::vector<AnimationTraceRecord> const& records);
+
+    /// Returns the records that are held, oldest first.
+    [[nodiscard]] std::vector<AnimationTraceRecord> records() const;
+
+    /// Converts the records into the Chrome trace event format, which can be
+    /// loaded by chrome://tracing and Perfetto.
+    [[nodiscard]] nlohmann::json to_chrome_trace() const;
+
+    /// The id of the calling thread as it appears in the records.
+    static uint32_t current_thread();
+
+    static int64_t to_ns(clock::time_point time);
+
+private:
+    mutable std::mutex mutex;
+    size_t const capacity;
+    std::vector<AnimationTraceRecord> buffer;
+    size_t next = 0;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_ANIMATION_TRACE_H
@@ -19,7 +19,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define GLM_ENABLE_EXPERIMENTAL
 
 #include "animator.h"
+#include "easing.h"
+#include "metrics.h"
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <glm/gtx/transform.hpp>
 #include <mir/log.h>
 #include <mir/server_action_queue.h>
@@ -48,149 +52,42 @@ inline float get_percent_complete(float target, float real)
         return percent;
 }
 
-float ease_out_bounce(AnimationDefinition const& defintion, float x)
-{
-    if (x < 1 / defintion.d1)
-    {
-        return defintion.n1 * x * x;
-    }
-    else if (x < 2 / defintion.d1)
-    {
-        return defintion.n1 * (x -= 1.5f / defintion.d1) * x + 0.75f;
-    }
-    else if (x < 2.5 / defintion.d1)
-    {
-        return defintion.n1 * (x -= 2.25f / defintion.d1) * x + 0.9375f;
-    }
-    else
-    {
-        return defintion.n1 * (x -= 2.625f / defintion.d1) * x + 0.984375f;
-    }
-}
-
-inline float ease(AnimationDefinition const& defintion, float t)
-{
-    // https://easings.net/
-    switch (defintion.function)
-    {
-    case EaseFunction::linear:
-        return t;
-    case EaseFunction::ease_in_sine:
-        return 1 - cosf((t * M_PI) / 2.f);
-    case EaseFunction::ease_in_out_sine:
-        return -(cosf(M_PI * t) - 1) / 2;
-    case EaseFunction::ease_out_sine:
-        return sinf((t * M_PI) / 2.f);
-    case EaseFunction::ease_in_quad:
-        return t * t;
-    case EaseFunction::ease_out_quad:
-        return 1 - (1 - t) * (1 - t);
-    case EaseFunction::ease_in_out_quad:
-        return t < 0.5 ? 2 * t * t : 1 - powf(-2 * t + 2, 2) / 2;
-    case EaseFunction::ease_in_cubic:
-        return t * t * t;
-    case EaseFunction::ease_out_cubic:
-        return 1 - powf(1 - t, 3);
-    case EaseFunction::ease_in_out_cubic:
-        return t < 0.5 ? 4 * t * t * t : 1 - powf(-2 * t + 2, 3) / 2;
-    case EaseFunction::ease_in_quart:
-        return t * t * t * t;
-    case EaseFunction::ease_out_quart:
-        return 1 - powf(1 - t, 4);
-    case EaseFunction::ease_in_out_quart:
-        return t < 0.5 ? 8 * t * t * t * t : 1 - powf(-2 * t + 2, 4) / 2;
-    case EaseFunction::ease_in_quint:
-        return t * t * t * t * t;
-    case EaseFunction::ease_out_quint:
-        return 1 - powf(1 - t, 5);
-    case EaseFunction::ease_in_out_quint:
-        return t < 0.5 ? 16 * t * t * t * t * t : 1 - powf(-2 * t + 2, 5) / 2;
-    case EaseFunction::ease_in_expo:
-        return t == 0 ? 0 : powf(2, 10 * t - 10);
-    case EaseFunction::ease_out_expo:
-        return t == 1 ? 1 : 1 - powf(2, -10 * t);
-    case EaseFunction::ease_in_out_expo:
-        return t == 0
-            ? 0
-            : t == 1
-            ? 1
-            : t < 0.5 ? powf(2, 20 * t - 10) / 2
-                      : (2 - powf(2, -20 * t + 10)) / 2;
-    case EaseFunction::ease_in_circ:
-        return 1 - sqrtf(1 - powf(t, 2));
-    case EaseFunction::ease_out_circ:
-        return sqrtf(1 - powf(t - 1, 2));
-    case EaseFunction::ease_in_out_circ:
-        return t < 0.5f
-            ? (1 - sqrtf(1 - powf(2 * t, 2))) / 2
-            : (sqrtf(1 - powf(-2 * t + 2, 2)) + 1) / 2;
-    case EaseFunction::ease_in_back:
-        return defintion.c3 * t * t * t - defintion.c1 * t * t;
-    case EaseFunction::ease_out_back:
-    {
-        return 1 + defintion.c3 * powf(t - 1, 3) + defintion.c1 * powf(t - 1, 2);
-    }
-    case EaseFunction::ease_in_out_back:
-        return t < 0.5
-            ? (powf(2 * t, 2) * ((defintion.c2 + 1) * 2 * t - defintion.c2)) / 2
-            : (powf(2 * t - 2, 2) * ((defintion.c2 + 1) * (t * 2 - 2) + defintion.c2) + 2) / 2;
-    case EaseFunction::ease_in_elastic:
-        return t == 0
-            ? 0
-            : t == 1
-            ? 1
-            : -powf(2, 10 * t - 10) * sinf((t * 10 - 10.75f) * defintion.c4);
-    case EaseFunction::ease_out_elastic:
-        return t == 0
-            ? 0
-            : t == 1
-            ? 1
-            : powf(2, -10 * t) * sinf((t * 10 - 0.75f) * defintion.c4) + 1;
-    case EaseFunction::ease_in_out_elastic:
-        return t == 0
-            ? 0
-            : t == 1
-            ? 1
-            : t < 0.5
-            ? -(powf(2, 20 * t - 10) * sinf((20 * t - 11.125f) * defintion.c5)) / 2
-            : (powf(2, -20 * t + 10) * sinf((20 * t - 11.125f) * defintion.c5)) / 2 + 1;
-    case EaseFunction::ease_in_bounce:
-        return 1 - ease_out_bounce(defintion, 1 - t);
-    case EaseFunction::ease_out_bounce:
-        return ease_out_bounce(defintion, t);
-    case EaseFunction::ease_in_out_bounce:
-        return t < 0.5
-            ? (1 - ease_out_bounce(defintion, 1 - 2 * t)) / 2
-            : (1 + ease_out_bounce(defintion, 2 * t - 1)) / 2;
-    default:
-        return 1.f;
-    }
-}
-
-inline float interpolate_scale(float p, float start, float end)
+inline float interpolate_scale(float p, float start, float end, float drift)
 {
     float diff = end - start;
-    if (diff == 0)
+    if (diff == 0 && drift == 0)
         return 1.f;
 
     // We want to find the percentage that we should scale relative
     // to the [start] value. For example, if we are growing from 200
     // to 250, and p=0.5, then we should be at width 225, which would
     // be a scale up of 225 / 220;
-    float current = start + diff * p;
+    float current = start + diff * p + drift;
     return current / end;
 }
 
-inline float interpolate_scale2(float p, float start, float end, float real)
+inline float interpolate_scale2(float p, float start, float end, float real, float drift)
 {
     float diff = end - start;
-    if (diff == 0)
+    if (diff == 0 && drift == 0)
         return 1.f;
 
-    float current = start + diff * p;
+    float current = start + diff * p + drift;
     return current / real;
 }
 
+/// The cubic Hermite basis that leaves 0 with a slope of 1 and comes back to 0
+/// with a slope of 0.
+inline float hermite_tangent(float u)
+{
+    return u * (1.f - u) * (1.f - u);
+}
+
+glm::vec4 to_vec4(geom::Rectangle const& r)
+{
+    return { r.top_left.x.as_int(), r.top_left.y.as_int(), r.size.width.as_int(), r.size.height.as_int() };
+}
+
 struct SlideResult
 {
     /// The current position that the surface should be in.
@@ -206,14 +103,20 @@ struct SlideResult
     glm::mat4 transform;
 };
 
-inline SlideResult slide(float p, geom::Rectangle const& from, geom::Rectangle const& to, geom::Size const& committed_size)
+/// [drift] is added to the x, y, width and height interpolated at [p].
+inline SlideResult slide(
+    float p,
+    geom::Rectangle const& from,
+    geom::Rectangle const& to,
+    geom::Size const& committed_size,
+    glm::vec4 const& drift = glm::vec4(0.f))
 {
     auto const distance = to.top_left - from.top_left;
-    float const dx = (float)distance.dx.as_int() * p;
-    float const dy = (float)distance.dy.as_int() * p;
+    float const dx = (float)distance.dx.as_int() * p + drift.x;
+    float const dy = (float)distance.dy.as_int() * p + drift.y;
 
-    float const clip_scale_x = interpolate_scale(p, static_cast<float>(from.size.width.as_value()), static_cast<float>(to.size.width.as_value()));
-    float const clip_scale_y = interpolate_scale(p, static_cast<float>(from.size.height.as_value()), static_cast<float>(to.size.height.as_value()));
+    float const clip_scale_x = interpolate_scale(p, static_cast<float>(from.size.width.as_value()), static_cast<float>(to.size.width.as_value()), drift.z);
+    float const clip_scale_y = interpolate_scale(p, static_cast<float>(from.size.height.as_value()), static_cast<float>(to.size.height.as_value()), drift.w);
 
     // This bit will only make sense by example.
     //
@@ -228,12 +131,14 @@ inline SlideResult slide(float p, geom::Rectangle const& from, geom::Rectangle c
         p,
         static_cast<float>(from.size.width.as_value()),
         static_cast<float>(to.size.width.as_value()),
-        static_cast<float>(committed_size.width.as_value()));
+        static_cast<float>(committed_size.width.as_value()),
+        drift.z);
     float const real_scale_y = interpolate_scale2(
         p,
         static_cast<float>(from.size.height.as_value()),
         static_cast<float>(to.size.height.as_value()),
-        static_cast<float>(committed_size.height.as_value()));
+        static_cast<float>(committed_size.height.as_value()),
+        drift.w);
 
     return {
         .position = glm::vec2(from.top_left.x.as_int() + dx, from.top_left.y.as_int() + dy),
@@ -251,6 +156,27 @@ glm::vec2 to_vec2_size(geom::Rectangle const& r)
 {
     return { r.size.width.as_int(), r.size.height.as_int() };
 }
+
+/// Slides a surface that remains at [from] over to [to] by transforming it alone.
+/// The surface is scaled about its top left corner and then translated so that
+/// it covers the interpolated rectangle.
+inline SlideResult slide_compositor_only(float p, geom::Rectangle const& from, geom::Rectangle const& to)
+{
+    auto const distance = to.top_left - from.top_left;
+    glm::vec2 const offset((float)distance.dx.as_int() * p, (float)distance.dy.as_int() * p);
+
+    glm::vec2 const start_size = to_vec2_size(from);
+    glm::vec2 const size = start_size + (to_vec2_size(to) - start_size) * p;
+    glm::vec2 const scale(
+        start_size.x == 0 ? 1.f : size.x / start_size.x,
+        start_size.y == 0 ? 1.f : size.y / start_size.y);
+
+    return {
+        .position = to_vec2_point(from) + offset,
+        .clip_area_size = size,
+        .transform = glm::translate(glm::vec3(offset, 0.f)) * glm::scale(glm::vec3(scale, 1.f))
+    };
+}
 }
 
 AnimationHandle const miracle::none_animation_handle = 0;
@@ -309,6 +235,13 @@ AnimationStepResult Animation::init()
         return { handle, false, clip_area, std::nullopt, std::nullopt, glm::mat4(1.f) };
     case AnimationType::slide:
     {
+        // The window keeps its current geometry until the animation completes.
+        if (definition.compositor_only)
+        {
+            auto result = slide_compositor_only(0, from, to);
+            return { handle, false, clip_area, std::nullopt, std::nullopt, result.transform, true };
+        }
+
         // Sliding is funky. We resize immediately but remain in the same position. The transformation
         // and position are interpolated over time to give the illusion of moving and growing.
         auto result = slide(0, from, to, real_size);
@@ -321,12 +254,9 @@ AnimationStepResult Animation::init()
     }
 }
 
-AnimationStepResult Animation::step(float const dt)
+AnimationStepResult Animation::step(float const runtime, float const eased)
 {
-    runtime_seconds += dt;
-    float const t = (runtime_seconds / definition.duration_seconds);
-
-    if (runtime_seconds >= definition.duration_seconds)
+    if (runtime >= definition.duration_seconds)
     {
         return { handle, true, to, to_vec2_point(to), to_vec2_size(to), glm::mat4(1.f) };
     }
@@ -335,8 +265,9 @@ AnimationStepResult Animation::step(float const dt)
     {
     case AnimationType::slide:
     {
-        auto const p = ease(definition, t);
-        auto const result = slide(p, from, to, real_size);
+        auto const result = definition.compositor_only
+            ? slide_compositor_only(eased, from, to)
+            : slide(eased, from, to, real_size, drift(runtime));
         clip_area.top_left.x = geom::X { result.position.x };
         clip_area.top_left.y = geom::Y { result.position.y };
         clip_area.size.width = geom::Width { result.clip_area_size.x };
@@ -345,14 +276,15 @@ AnimationStepResult Animation::step(float const dt)
             handle,
             false,
             clip_area,
-            result.position,
+            definition.compositor_only ? std::nullopt : std::optional(result.position),
             std::nullopt,
-            result.transform
+            result.transform,
+            definition.compositor_only
         };
     }
     case AnimationType::grow:
     {
-        auto p = ease(definition, t);
+        auto p = eased;
         glm::vec3 translate(
             (float)to.size.width.as_value() / 2.f,
             (float)to.size.height.as_value() / 2.f,
@@ -367,7 +299,7 @@ AnimationStepResult Animation::step(float const dt)
     }
     case AnimationType::shrink:
     {
-        auto p = 1.f - ease(definition, t);
+        auto p = 1.f - eased;
         glm::vec3 translate(
             (float)to.size.width.as_value() / 2.f,
             (float)to.size.height.as_value() / 2.f,
@@ -391,6 +323,68 @@ void Animation::set_current_size(mir::geometry::Size const& size)
     real_size = size;
 }
 
+glm::vec4 Animation::drift(float runtime) const
+{
+    auto const duration = definition.duration_seconds;
+    auto const u = duration > 0 ? std::clamp(runtime / duration, 0.f, 1.f) : 1.f;
+    return velocity_offset * duration * hermite_tangent(u);
+}
+
+glm::vec4 Animation::rectangle_at(float runtime) const
+{
+    auto const duration = definition.duration_seconds;
+    auto const u = duration > 0 ? std::clamp(runtime / duration, 0.f, 1.f) : 1.f;
+    auto const start = to_vec4(from);
+    return start + (to_vec4(to) - start) * ease(definition, u) + drift(runtime);
+}
+
+std::optional<AnimationStepResult> Animation::retarget(Animation const& next, float const runtime)
+{
+    // Only non-compositor slides are retargeted. Compositor-only slides transform
+    // the surface from its committed geometry, which retargeting would invalidate.
+    auto const& next_definition = next.definition;
+    if (definition.type != AnimationType::slide
+        || next_definition.type != definition.type
+        || next_definition.function != definition.function
+        || next_definition.duration_seconds != definition.duration_seconds
+        || definition.compositor_only
+        || next_definition.compositor_only)
+        return std::nullopt;
+
+    auto const duration = definition.duration_seconds;
+    if (duration <= 0)
+        return std::nullopt;
+
+    // Where the surface is and how fast it is moving, along whatever curve it is on
+    constexpr float dt = 1.f / 1000.f;
+    auto const here = rectangle_at(runtime);
+    auto const velocity = (rectangle_at(runtime + dt) - rectangle_at(runtime - dt)) / (2.f * dt);
+
+    // The slide starts over from here, so that the surface has the whole duration
+    // to get to its new destination. The ease curve alone would start at its own
+    // velocity, so the difference is added on top of it and fades out on the way.
+    from = geom::Rectangle {
+        geom::Point { static_cast<int>(std::round(here.x)), static_cast<int>(std::round(here.y)) },
+        geom::Size { static_cast<int>(std::round(here.z)), static_cast<int>(std::round(here.w)) }
+    };
+    to = next.to;
+    low_priority = next.low_priority;
+    runtime_seconds = 0.f;
+    velocity_offset = glm::vec4(0.f);
+    auto const curve_velocity = (rectangle_at(dt) - rectangle_at(0.f)) / dt;
+    velocity_offset = velocity - curve_velocity;
+
+    // Like init(), the surface is resized to its new destination immediately
+    auto result = step(0.f, ease(definition, 0.f));
+    result.size = to_vec2_size(to);
+    return result;
+}
+
+void Animation::set_low_priority(bool value)
+{
+    low_priority = value;
+}
+
 void Animation::mark_for_great_animator_in_the_sky()
 {
     should_leave_this_animator_for_the_great_animator_in_the_sky = true;
@@ -403,63 +397,301 @@ bool Animation::is_going_to_great_animator_in_the_sky() const
 
 AnimationHandle Animator::register_animateable()
 {
-    return next_handle++;
+    std::lock_guard lock(handle_mutex);
+    if (free_handles.empty())
+        return next_handle++;
+
+    auto const handle = free_handles.back();
+    free_handles.pop_back();
+    return handle;
+}
+
+void Animator::unregister_animateable(AnimationHandle handle)
+{
+    if (handle == none_animation_handle)
+        return;
+
+    // Commands are processed in the order they were submitted, so the removal
+    // lands before anything that the next owner of the handle submits.
+    remove_by_animation_handle(handle);
+    std::lock_guard lock(handle_mutex);
+    free_handles.push_back(handle);
 }
 
 void Animator::append(std::shared_ptr<Animation> const& animation)
 {
-    std::lock_guard<std::mutex> lock(processing_lock);
-    for (auto& other : active)
+    Metrics::instance().increment(MetricCounter::animations);
+    submit({ .type = Command::Type::append, .animation = animation, .handle = animation->get_handle() });
+}
+
+void Animator::submit(Command command)
+{
+    commands.push(std::move(command));
+    stats.commands_submitted++;
+
+    // Only take the lock if the ticking thread may be asleep. The thread marks
+    // itself as waiting before it checks the queue, so at least one of us sees
+    // the other.
+    if (is_waiting)
+        notify();
+}
+
+void Animator::notify()
+{
+    auto const start = std::chrono::steady_clock::now();
     {
-        if (other->get_handle() == animation->get_handle())
-            other->mark_for_great_animator_in_the_sky();
+        std::lock_guard<std::mutex> lock(processing_lock);
+        stats.lock_wait_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start)
+                                  .count();
+        stats.wakeups++;
     }
-    active.push_back(animation);
-    animation->on_tick(animation->init());
-    cv.notify_one();
+    cv.notify_all();
+}
+
+void Animator::wait_for_animations(std::function<bool()> const& is_interrupted)
+{
+    std::unique_lock<std::mutex> lock(processing_lock);
+    is_waiting = true;
+    cv.wait(lock, [&]
+    {
+        return is_interrupted() || has_animations();
+    });
+    is_waiting = false;
+}
+
+void Animator::process_commands()
+{
+    auto const processed = commands.drain([&](Command&& command)
+    {
+        auto const it = index_by_handle.find(command.handle);
+        switch (command.type)
+        {
+        case Command::Type::append:
+        {
+            // The latest animation for a handle continues or replaces any that came before it.
+            auto const& animation = command.animation;
+            if (it != index_by_handle.end())
+            {
+                auto const i = it->second;
+                auto const& current = active[i];
+                if (!current->is_going_to_great_animator_in_the_sky())
+                {
+                    auto const result = current->retarget(*animation, runtimes[i]);
+                    if (result)
+                    {
+                        runtimes[i] = current->get_runtime_seconds();
+                        current->on_tick(result.value());
+                        break;
+                    }
+                }
+
+                active[i] = animation;
+                runtimes[i] = animation->get_runtime_seconds();
+                durations[i] = animation->get_definition().duration_seconds;
+            }
+            else
+            {
+                index_by_handle.emplace(animation->get_handle(), active.size());
+                active.push_back(animation);
+                runtimes.push_back(animation->get_runtime_seconds());
+                durations.push_back(animation->get_definition().duration_seconds);
+            }
+
+            animation->on_tick(animation->init());
+            break;
+        }
+        case Command::Type::set_size:
+            if (it != index_by_handle.end())
+                active[it->second]->set_current_size(command.size);
+            break;
+        case Command::Type::remove:
+            if (it != index_by_handle.end())
+                active[it->second]->mark_for_great_animator_in_the_sky();
+            break;
+        }
+    });
+
+    stats.commands_processed += processed;
+}
+
+nlohmann::json Animator::stats_to_json() const
+{
+    return {
+        { "active_animations", active_count.load() },
+        { "commands_submitted", stats.commands_submitted.load() },
+        { "commands_processed", stats.commands_processed.load() },
+        { "wakeups", stats.wakeups.load() },
+        { "lock_wait_ms", static_cast<double>(stats.lock_wait_ns.load()) / 1e6 }
+    };
+}
+
+void Animator::set_over_budget(bool value)
+{
+    if (over_budget == value)
+        return;
+
+    over_budget = value;
+    if (over_budget)
+        mir::log_info("Animations are over the frame budget, low priority animations will be skipped");
+    else
+        mir::log_info("Animations are back within the frame budget");
+}
+
+void Animator::set_snapping(bool value)
+{
+    snapping.store(value, std::memory_order_relaxed);
+}
+
+void Animator::set_trace(std::shared_ptr<AnimationTrace> const& next)
+{
+    trace.store(next);
 }
 
 void Animator::tick(float dt)
 {
-    std::lock_guard<std::mutex> lock(processing_lock);
+    auto const current_trace = trace.load();
+    auto const tick_start = AnimationTrace::clock::now();
+    auto const thread = current_trace ? AnimationTrace::current_thread() : 0;
+
+    process_commands();
+    auto const count = active.size();
+    bool const is_snapping = snapping.load(std::memory_order_relaxed);
+
+    // Advance every clock at once
+    progress.resize(count);
+    eased.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        runtimes[i] += dt;
+        if (is_snapping || (over_budget && active[i]->is_low_priority()))
+            runtimes[i] = durations[i];
+        progress[i] = std::min(runtimes[i] / durations[i], 1.f);
+    }
+
+    // Then ease each group of animations sharing an ease function in a single batch
+    for (auto& batch : ease_batches)
+        batch.indices.clear();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        auto const& definition = active[i]->get_definition();
+        auto batch = std::find_if(ease_batches.begin(), ease_batches.end(), [&](EaseBatch const& candidate)
+        {
+            auto const& other = candidate.definition;
+            return other.function == definition.function
+                && other.c1 == definition.c1
+                && other.c2 == definition.c2
+                && other.c3 == definition.c3
+                && other.c4 == definition.c4
+                && other.c5 == definition.c5
+                && other.n1 == definition.n1
+                && other.d1 == definition.d1;
+        });
+        if (batch == ease_batches.end())
+        {
+            ease_batches.push_back({ definition });
+            batch = ease_batches.end() - 1;
+        }
+        batch->indices.push_back(i);
+    }
+
+    for (auto& batch : ease_batches)
+    {
+        auto const batch_size = batch.indices.size();
+        batch.in.resize(batch_size);
+        batch.out.resize(batch_size);
+        for (size_t j = 0; j < batch_size; j++)
+            batch.in[j] = progress[batch.indices[j]];
+
+        ease_batch(batch.definition, batch.in.data(), batch.out.data(), batch_size);
+
+        for (size_t j = 0; j < batch_size; j++)
+            eased[batch.indices[j]] = batch.out[j];
+    }
+
+    std::erase_if(ease_batches, [](EaseBatch const& batch)
+    {
+        return batch.indices.empty();
+    });
 
-    for (auto& item : active)
+    for (size_t i = 0; i < count; i++)
     {
+        auto& item = active[i];
         if (item->is_going_to_great_animator_in_the_sky())
             continue;
 
-        auto result = item->step(dt);
-
-        item->on_tick(result);
+        auto result = item->step(runtimes[i], eased[i]);
+
+        if (current_trace)
+        {
+            auto const on_tick_start = AnimationTrace::clock::now();
+            item->on_tick(result);
+            trace_records.push_back({
+                .type = AnimationTraceRecord::Type::step,
+                .thread = thread,
+                .count = item->get_handle(),
+                .value = progress[i],
+                .start_ns = AnimationTrace::to_ns(on_tick_start),
+                .duration_ns = AnimationTrace::to_ns(AnimationTrace::clock::now()) - AnimationTrace::to_ns(on_tick_start) });
+        }
+        else
+        {
+            item->on_tick(result);
+        }
 
         if (result.is_complete)
             item->mark_for_great_animator_in_the_sky();
     }
 
-    active.erase(std::remove_if(active.begin(), active.end(), [](std::shared_ptr<Animation> const& animation)
+    // Remove finished animations by moving the last animation into their slot
+    for (size_t i = 0; i < active.size();)
     {
-        return animation->is_going_to_great_animator_in_the_sky();
-    }),
-        active.end());
-}
+        if (!active[i]->is_going_to_great_animator_in_the_sky())
+        {
+            i++;
+            continue;
+        }
+
+        index_by_handle.erase(active[i]->get_handle());
+        auto const last = active.size() - 1;
+        if (i != last)
+        {
+            active[i] = std::move(active[last]);
+            runtimes[i] = runtimes[last];
+            durations[i] = durations[last];
+            index_by_handle[active[i]->get_handle()] = i;
+        }
+
+        active.pop_back();
+        runtimes.pop_back();
+        durations.pop_back();
+    }
 
-void Animator::set_size_hack(AnimationHandle handle, mir::geometry::Size const& size)
-{
-    std::lock_guard<std::mutex> lock(processing_lock);
+    active_count = active.size();
 
-    for (auto& animation : active)
+    if (current_trace)
     {
-        if (animation->get_handle() == handle)
-            animation->set_current_size(size);
+        AnimationTraceRecord const tick_record {
+            .type = AnimationTraceRecord::Type::tick,
+            .thread = thread,
+            .count = static_cast<uint32_t>(count),
+            .value = dt,
+            .start_ns = AnimationTrace::to_ns(tick_start),
+            .duration_ns = AnimationTrace::to_ns(AnimationTrace::clock::now()) - AnimationTrace::to_ns(tick_start)
+        };
+        trace_records.insert(trace_records.begin(), tick_record);
+        current_trace->record(trace_records);
+        trace_records.clear();
     }
 }
 
+void Animator::set_size_hack(AnimationHandle handle, mir::geometry::Size const& size)
+{
+    submit({ .type = Command::Type::set_size, .handle = handle, .size = size });
+}
+
 void Animator::remove_by_animation_handle(miracle::AnimationHandle handle)
 {
-    std::lock_guard<std::mutex> lock(processing_lock);
-    for (auto& animation : active)
-    {
-        if (animation->get_handle() == handle)
-            animation->mark_for_great_animator_in_the_sky();
-    }
+    submit({ .type = Command::Type::remove, .handle = handle });
 }
@@ -19,13 +19,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIRACLEWM_ANIMATOR_H
 
 #include "animation_defintion.h"
+#include "animation_trace.h"
+#include "memory_accounting.h"
+#include "mpsc_queue.h"
+#include <atomic>
 #include <condition_variable>
 #include <functional>
 #include <glm/glm.hpp>
 #include <mir/geometry/rectangle.h>
 #include <mutex>
+#include <nlohmann/json.hpp>
 #include <optional>
-#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace mir
 {
@@ -54,6 +60,10 @@ struct AnimationStepResult
     std::optional<glm::vec2> position;
     std::optional<glm::vec2> size;
     std::optional<glm::mat4> transform;
+
+    /// Set while a compositor-only slide is running, whose clip area follows the
+    /// transform rather than the geometry.
+    bool is_compositor_only = false;
 };
 
 class Animation
@@ -69,49 +79,168 @@ public:
     Animation& operator=(Animation const& other) = default;
 
     AnimationStepResult init();
-    AnimationStepResult step(float const dt);
+
+    /// Returns the result of the animation once it has been running for [runtime]
+    /// seconds, where [eased] is the ease function applied to its progress.
+    AnimationStepResult step(float const runtime, float const eased);
     [[nodiscard]] AnimationHandle get_handle() const { return handle; }
+    [[nodiscard]] AnimationDefinition const& get_definition() const { return definition; }
+
+    /// The time at which the animation starts, which is not zero if the animation
+    /// picks up from where a previous animation left off.
     float get_runtime_seconds() const { return runtime_seconds; }
     void set_current_size(mir::geometry::Size const& size);
+
+    /// Points this animation, which has been running for [runtime] seconds, at the
+    /// destination of [next] without interrupting it. The animation starts over
+    /// from where the surface is right now, and carries on at the speed that the
+    /// surface is moving at before it eases into its new destination.
+    ///
+    /// Returns the result to apply immediately, or nothing if [next] cannot continue
+    /// this animation and must replace it.
+    std::optional<AnimationStepResult> retarget(Animation const& next, float runtime);
+    /// Low priority animations are snapped to completion when the animator is
+    /// over its frame budget. See [Animator::set_over_budget].
+    void set_low_priority(bool);
+    [[nodiscard]] bool is_low_priority() const { return low_priority; }
     void mark_for_great_animator_in_the_sky();
     bool is_going_to_great_animator_in_the_sky() const;
     virtual void on_tick(AnimationStepResult const&) = 0;
 
 private:
+    /// What a retargeted slide adds to its ease curve after [runtime] seconds.
+    [[nodiscard]] glm::vec4 drift(float runtime) const;
+    /// The x, y, width and height of the surface after [runtime] seconds.
+    [[nodiscard]] glm::vec4 rectangle_at(float runtime) const;
+
     AnimationHandle handle;
     AnimationDefinition definition;
     mir::geometry::Rectangle clip_area;
     mir::geometry::Rectangle from;
     mir::geometry::Rectangle to;
     mir::geometry::Size real_size;
+    /// How much faster a retargeted slide starts out than its ease curve, in
+    /// pixels per second of x, y, width and height. See [retarget].
+    glm::vec4 velocity_offset { 0.f };
     float runtime_seconds = 0.f;
+    bool low_priority = false;
     bool should_leave_this_animator_for_the_great_animator_in_the_sky = false;
+    MemoryCharge memory { MemorySubsystem::animations, sizeof(Animation) };
+};
+
+/// Counters describing how the animator is fed. Updated from any thread.
+struct AnimatorStats
+{
+    std::atomic<uint64_t> commands_submitted = 0;
+    std::atomic<uint64_t> commands_processed = 0;
+
+    /// The number of times that a producer had to take the lock to wake the
+    /// animator thread, and the total time spent waiting for that lock.
+    std::atomic<uint64_t> wakeups = 0;
+    std::atomic<int64_t> lock_wait_ns = 0;
 };
 
 /// Manages the animation queue. If multiple animations are queued for a window,
-/// then the latest animation may override values from previous animations.
+/// then the latest animation replaces the previous animation.
+///
+/// The active animations are owned exclusively by the thread that ticks. Other
+/// threads submit their commands through a lock-free queue, which is drained
+/// at the start of every tick, so they never wait behind a tick in progress.
+///
+/// The clocks of the active animations are stored as parallel arrays so that
+/// every tick advances and eases all animations in batches.
 class Animator
 {
 public:
     /// Animateable components must register with the Animator before being
     /// able to be animated.
+    ///
+    /// Handles given up with [unregister_animateable] are handed out again.
     AnimationHandle register_animateable();
 
+    /// Removes the animations of [handle], which must no longer be used, and
+    /// lets the next component to register take it.
+    void unregister_animateable(AnimationHandle handle);
+
     void tick(float dt);
 
     void append(std::shared_ptr<Animation> const&);
     void set_size_hack(AnimationHandle handle, mir::geometry::Size const& size);
     void remove_by_animation_handle(AnimationHandle handle);
-    bool has_animations() const { return !active.empty(); }
-    std::condition_variable& get_cv() { return cv; }
-    std::mutex& get_lock() { return processing_lock; }
+
+    /// Sheds load while the time spent ticking and rendering exceeds the frame
+    /// budget. Until it is cleared, low priority animations are snapped to
+    /// completion so that the rest can keep up. Called from the ticking thread.
+    void set_over_budget(bool);
+
+    /// While set, every animation is snapped to completion on the next tick, as
+    /// when the session is locked and nothing that is animated can be seen. May
+    /// be called from any thread.
+    void set_snapping(bool);
+
+    /// Whether there is anything left to tick. Called from the ticking thread.
+    bool has_animations() const { return !active.empty() || !commands.empty(); }
+
+    /// Blocks the ticking thread until there are animations or until
+    /// [is_interrupted] returns true. See [notify].
+    void wait_for_animations(std::function<bool()> const& is_interrupted);
+
+    /// Wakes the ticking thread if it is waiting for animations.
+    void notify();
+
+    [[nodiscard]] AnimatorStats const& get_stats() const { return stats; }
+
+    /// Starts recording every tick into [trace], or stops recording if it is null.
+    void set_trace(std::shared_ptr<AnimationTrace> const& trace);
+    [[nodiscard]] nlohmann::json stats_to_json() const;
 
 private:
+    struct Command
+    {
+        enum class Type
+        {
+            append,
+            set_size,
+            remove
+        };
+
+        Type type;
+        std::shared_ptr<Animation> animation;
+        AnimationHandle handle = none_animation_handle;
+        mir::geometry::Size size;
+    };
+
+    struct EaseBatch
+    {
+        AnimationDefinition definition;
+        std::vector<size_t> indices;
+        std::vector<float> in;
+        std::vector<float> out;
+    };
+
+    void submit(Command command);
+    void process_commands();
+
+    MpscQueue<Command> commands;
     std::vector<std::shared_ptr<Animation>> active;
-    std::thread run_thread;
+    std::vector<float> runtimes;
+    std::vector<float> durations;
+    std::vector<float> progress;
+    std::vector<float> eased;
+    std::unordered_map<AnimationHandle, size_t> index_by_handle;
+    std::vector<EaseBatch> ease_batches;
     std::condition_variable cv;
     std::mutex processing_lock;
+    std::atomic<bool> is_waiting = false;
+    std::mutex handle_mutex;
     AnimationHandle next_handle = 1;
+    std::vector<AnimationHandle> free_handles;
+    std::atomic<size_t> active_count = 0;
+    AnimatorStats stats;
+    std::atomic<std::shared_ptr<AnimationTrace>> trace;
+    std::vector<AnimationTraceRecord> trace_records;
+    bool over_budget = false;
+    std::atomic<bool> snapping = false;
 };
 
 } // miracle
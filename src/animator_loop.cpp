@@ -17,14 +17,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "animator_loop.h"
 #include "animator.h"
+#include "frame_clock.h"
 
+#include <algorithm>
 #include <mir/server_action_queue.h>
+#include <utility>
 
 using namespace miracle;
 using namespace std::chrono_literals;
 
-ThreadedAnimatorLoop::ThreadedAnimatorLoop(std::shared_ptr<Animator> const& animator) :
-    animator { animator }
+ThreadedAnimatorLoop::ThreadedAnimatorLoop(
+    std::shared_ptr<Animator> const& animator,
+    std::shared_ptr<FrameClock> const& frame_clock,
+    ThreadSchedulingConfiguration scheduling) :
+    animator { animator },
+    frame_clock { frame_clock },
+    scheduling { std::move(scheduling) }
 {
 }
 
@@ -35,6 +43,7 @@ ThreadedAnimatorLoop::~ThreadedAnimatorLoop()
 
 void ThreadedAnimatorLoop::start()
 {
+    running = true;
     run_thread = std::thread([this]()
     { run(); });
 }
@@ -45,31 +54,47 @@ void ThreadedAnimatorLoop::stop()
         return;
 
     running = false;
+    animator->notify();
     run_thread.join();
 }
 
 void ThreadedAnimatorLoop::run()
 {
-    using clock = std::chrono::high_resolution_clock;
-    constexpr std::chrono::nanoseconds timestep(16ms);
-    auto last_time = clock::now();
-    running = true;
+    apply_thread_scheduling("Animator", scheduling);
+
+    using clock = FrameClock::clock;
+    auto last_target = clock::now();
 
     while (running)
     {
+        if (!animator->has_animations())
         {
-            std::unique_lock lock(animator->get_lock());
-            if (!animator->has_animations())
+            animator->wait_for_animations([&]
             {
-                animator->get_cv().wait(lock);
-                last_time = clock::now();
-            }
+                return !running;
+            });
+            last_target = clock::now();
         }
 
-        delta_time = clock::now() - last_time;
-        last_time = clock::now();
+        if (!running)
+            break;
+
+        // Step once per displayed frame. If nothing is being drawn (e.g. the first step
+        // of an animation has yet to change the scene), fall back to the refresh interval.
+        auto const interval = frame_clock->refresh_interval();
+        frame_clock->wait_for_frame(interval + interval / 2);
+
+        // Animations are stepped to when the frame that shows this tick will be
+        // presented, rather than to now, so that what is on screen is not a frame behind.
+        auto const tick_start = clock::now();
+        auto const target = std::max(frame_clock->next_frame_time(tick_start), last_target);
+        delta_time = target - last_target;
+        last_target = target;
         animator->tick(delta_time.count());
-        std::this_thread::sleep_for(1ms);
+
+        // The tick and the render that it causes must both fit within a frame
+        auto const tick_time = clock::now() - tick_start;
+        animator->set_over_budget(tick_time + frame_clock->render_time() > interval);
     }
 }
 
@@ -18,6 +18,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef MIRACLEWM_ANIMATOR_LOOP_H
 #define MIRACLEWM_ANIMATOR_LOOP_H
 
+#include "thread_scheduling.h"
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <memory>
@@ -31,6 +33,7 @@ class ServerActionQueue;
 namespace miracle
 {
 class Animator;
+class FrameClock;
 
 class AnimatorLoop
 {
@@ -40,10 +43,16 @@ public:
     virtual void stop() = 0;
 };
 
+/// Ticks the animator on its own thread once per frame of the fastest output.
+/// The thread sleeps while there is nothing to animate, and is scheduled with
+/// [scheduling] when it starts.
 class ThreadedAnimatorLoop : public AnimatorLoop
 {
 public:
-    explicit ThreadedAnimatorLoop(std::shared_ptr<Animator> const&);
+    ThreadedAnimatorLoop(
+        std::shared_ptr<Animator> const&,
+        std::shared_ptr<FrameClock> const&,
+        ThreadSchedulingConfiguration scheduling = {});
     ~ThreadedAnimatorLoop() override;
     void start() override;
     void stop() override;
@@ -52,8 +61,10 @@ private:
     void run();
 
     std::shared_ptr<Animator> animator;
+    std::shared_ptr<FrameClock> frame_clock;
+    ThreadSchedulingConfiguration const scheduling;
     std::thread run_thread;
-    bool running = false;
+    std::atomic<bool> running = false;
     std::chrono::duration<float> delta_time;
 };
 
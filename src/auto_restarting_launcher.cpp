@@ -17,20 +17,104 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define MIR_LOG_COMPONENT "AutoRestartingLauncher"
 #include "auto_restarting_launcher.h"
+#include "spawner.h"
+#include "startup_profile.h"
+
+#include <cerrno>
+#include <cstring>
+#include <glib-2.0/glib.h>
+#include <mir/fd.h>
 #include <mir/log.h>
+#include <mir/options/option.h>
+#include <mir/server.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
 #include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
 
 using namespace miracle;
 
+namespace
+{
+int pidfd_open(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+bool supports_pidfd()
+{
+    mir::Fd const fd { pidfd_open(getpid()) };
+    return fd >= 0;
+}
+
+/// Arms [timer] to fire at [deadline], or disarms it if there is none.
+void arm_timer(int timer, std::optional<std::chrono::steady_clock::time_point> deadline)
+{
+    itimerspec spec {};
+    if (deadline)
+    {
+        auto const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline->time_since_epoch());
+        spec.it_value.tv_sec = ns.count() / 1'000'000'000;
+        spec.it_value.tv_nsec = ns.count() % 1'000'000'000;
+    }
+
+    if (timerfd_settime(timer, TFD_TIMER_ABSTIME, &spec, nullptr) < 0)
+        mir::log_error("Unable to arm a timer of the launcher: %s", strerror(errno));
+}
+}
+
 AutoRestartingLauncher::AutoRestartingLauncher(
     miral::MirRunner& runner,
     miral::ExternalClientLauncher& launcher) :
     runner { runner },
-    launcher { launcher }
+    launcher { launcher },
+    has_pidfd { supports_pidfd() },
+    restart_timer { timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC) },
+    startup_timer { timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC) }
 {
-    runner.add_start_callback([&]
-    { runner.register_signal_handler({ SIGCHLD }, [this](int)
-      { reap(); }); });
+    if (!has_pidfd)
+    {
+        mir::log_warning("pidfd_open is not supported, falling back to SIGCHLD to reap children");
+        runner.add_start_callback([&]
+        { runner.register_signal_handler({ SIGCHLD }, [this](int)
+          { reap(); }); });
+    }
+    else
+    {
+        retire_fd = mir::Fd { eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK) };
+        retire_handle = runner.register_fd_handler(retire_fd, [this](int)
+        {
+            eventfd_t value;
+            eventfd_read(retire_fd, &value);
+            std::lock_guard lock { mutex };
+            retired_child_handles.clear();
+        });
+    }
+
+    if (restart_timer < 0)
+        mir::log_error("Unable to create the restart timer, programs will be restarted immediately");
+    else
+        restart_timer_handle = runner.register_fd_handler(restart_timer, [this](int)
+        { on_restart_timer(); });
+
+    if (startup_timer < 0)
+        mir::log_error("Unable to create the startup timer, startup apps will be launched all at once");
+    else
+        startup_timer_handle = runner.register_fd_handler(startup_timer, [this](int)
+        {
+            uint64_t expirations;
+            if (read(startup_timer, &expirations, sizeof(expirations)) < 0 && errno == EAGAIN)
+                return;
+            launch_ready_startup_apps();
+        });
 }
 
 std::vector<std::string_view> split(std::string_view str, char delim)
@@ -53,7 +137,64 @@ std::vector<std::string_view> split(std::string_view str, char delim)
 void AutoRestartingLauncher::launch(miracle::StartupApp const& cmd)
 {
     std::lock_guard lock { mutex };
+    launch_locked(cmd);
+}
+
+void AutoRestartingLauncher::launch_startup_apps(std::vector<StartupApp> const& apps, StartupConfiguration const& config)
+{
+    {
+        std::lock_guard lock { mutex };
+        if (startup_timer < 0)
+        {
+            // Nothing would wake the scheduler once an app times out
+            std::vector<StartupApp> unordered = apps;
+            for (auto& app : unordered)
+                app.after_previous = false;
+            startup_scheduler.emplace(unordered, StartupConfiguration { .concurrency = 0 });
+        }
+        else
+            startup_scheduler.emplace(apps, config);
+    }
+
+    launch_ready_startup_apps();
+}
+
+void AutoRestartingLauncher::advise_window_opened(pid_t pid)
+{
+    {
+        std::lock_guard lock { mutex };
+        if (!startup_scheduler)
+            return;
+        startup_scheduler->window_opened(pid);
+    }
+
+    launch_ready_startup_apps();
+}
+
+void AutoRestartingLauncher::launch_ready_startup_apps()
+{
+    std::lock_guard lock { mutex };
+    if (!startup_scheduler)
+        return;
+
+    auto const now = StartupScheduler::clock::now();
+    while (auto const app = startup_scheduler->next(now))
+        startup_scheduler->launched(launch_locked(*app), now);
+
+    if (startup_scheduler->has_launched_all())
+    {
+        StartupProfile::instance().mark("startup applications launched");
+        startup_scheduler.reset();
+        arm_timer(startup_timer, std::nullopt);
+    }
+    else
+        arm_timer(startup_timer, startup_scheduler->next_deadline());
+}
+
+pid_t AutoRestartingLauncher::launch_locked(miracle::StartupApp const& cmd)
+{
     pid_t pid;
+    bool spawned_by_helper = false;
     if (cmd.in_systemd_scope)
     {
         std::vector<std::string> result = { "systemd-run", "--user" };
@@ -78,27 +219,54 @@ void AutoRestartingLauncher::launch(miracle::StartupApp const& cmd)
         if (start != cmd.command.size())
             result.push_back(cmd.command.substr(start));
 
-        pid = launcher.launch(result);
+        pid = spawn(result);
+        spawned_by_helper = pid > 0;
+        if (!spawned_by_helper)
+            pid = launcher.launch(result);
     }
     else
     {
-        pid = launcher.launch(cmd.command);
+        pid = -1;
+        gchar** argv = nullptr;
+        if (spawner && g_shell_parse_argv(cmd.command.c_str(), nullptr, &argv, nullptr))
+        {
+            std::vector<std::string> args;
+            for (auto arg = argv; *arg; arg++)
+                args.emplace_back(*arg);
+            g_strfreev(argv);
+            pid = spawn(args);
+        }
+
+        spawned_by_helper = pid > 0;
+        if (!spawned_by_helper)
+            pid = launcher.launch(cmd.command);
     }
 
     if (pid <= 0)
     {
         mir::log_error("Unable to start external client: %s\n", cmd.command.c_str());
-        return;
+        return pid;
     }
     mir::log_info("Started external client %s with pid=%d", cmd.command.c_str(), pid);
 
     if (cmd.restart_on_death || cmd.should_halt_compositor_on_death)
         pid_to_command_map[pid] = cmd;
+
+    if (cmd.restart_on_death)
+        backoff.started(cmd.command, RestartBackoff::clock::now());
+
+    // Programs from the spawner are not our children, and their exits are
+    // reported by the spawner instead
+    if (has_pidfd && !spawned_by_helper)
+        watch_child(pid);
+
+    return pid;
 }
 
 void AutoRestartingLauncher::kill_all()
 {
     std::lock_guard lock { mutex };
+    pending_restarts.clear();
     for (auto const& entry : pid_to_command_map)
     {
         if (entry.second.restart_on_death)
@@ -106,45 +274,219 @@ void AutoRestartingLauncher::kill_all()
     }
 }
 
+std::optional<RestartStats> AutoRestartingLauncher::restart_stats(std::string const& command) const
+{
+    std::lock_guard lock { mutex };
+    return backoff.stats(command);
+}
+
+void AutoRestartingLauncher::watch_child(pid_t pid)
+{
+    mir::Fd pidfd { pidfd_open(pid) };
+    if (pidfd < 0)
+    {
+        mir::log_error("Unable to open a pidfd for %d, it will not be reaped: %s", pid, strerror(errno));
+        return;
+    }
+
+    child_handles[pid] = runner.register_fd_handler(pidfd, [this, pid](int)
+    {
+        int status;
+        if (waitpid(pid, &status, WNOHANG) == pid)
+            on_exit(pid, status);
+    });
+}
+
+void AutoRestartingLauncher::use_spawner(std::shared_ptr<Spawner> const& spawner_, mir::Server const& server_)
+{
+    {
+        std::lock_guard lock { mutex };
+        spawner = spawner_;
+        server = &server_;
+    }
+
+    // The programs are children of the spawner, so their exits arrive from it
+    // rather than through SIGCHLD
+    runner.add_start_callback([this]
+    {
+        spawner_exits_handle = runner.register_fd_handler(mir::Fd { dup(spawner->exit_fd()) }, [this](int)
+        {
+            for (auto const& exit : spawner->read_exits())
+                on_exit(exit.pid, exit.status);
+        });
+    });
+}
+
+pid_t AutoRestartingLauncher::spawn(std::vector<std::string> const& argv)
+{
+    if (!spawner)
+        return -1;
+
+    return spawner->spawn(argv, client_environment());
+}
+
+std::vector<std::string> AutoRestartingLauncher::client_environment() const
+{
+    std::vector<std::string> result;
+    for (auto entry = environ; *entry; entry++)
+        result.emplace_back(*entry);
+
+    auto const set = [&](std::string_view name, std::optional<std::string_view> value)
+    {
+        std::erase_if(result, [&](std::string const& entry)
+        {
+            return entry.size() > name.size() && entry.starts_with(name) && entry[name.size()] == '=';
+        });
+        if (value)
+            result.push_back(std::string(name) + "=" + std::string(*value));
+    };
+
+    // These mirror the environment that miral::ExternalClientLauncher sets up
+    if (auto const wayland_display = server->wayland_display(); wayland_display.is_set())
+        set("WAYLAND_DISPLAY", wayland_display.value());
+
+    if (auto const x11_display = server->x11_display(); x11_display.is_set())
+        set("DISPLAY", x11_display.value());
+    else
+        set("DISPLAY", std::nullopt);
+
+    // Entries of --app-env are separated by ':'. "NAME=value" sets a variable,
+    // while "-NAME" removes it.
+    for (auto const* option : { "app-env", "app-env-amend" })
+    {
+        std::string app_env;
+        try
+        {
+            app_env = server->get_options()->get<std::string>(option);
+        }
+        catch (std::exception const&)
+        {
+            continue;
+        }
+
+        for (auto const& entry : split(app_env, ':'))
+        {
+            if (entry.empty())
+                continue;
+
+            if (entry.front() == '-')
+                set(entry.substr(1), std::nullopt);
+            else if (auto const equals = entry.find('='); equals != std::string_view::npos)
+                set(entry.substr(0, equals), entry.substr(equals + 1));
+            else
+                set(entry, "");
+        }
+    }
+
+    return result;
+}
+
 void AutoRestartingLauncher::reap()
 {
     int status;
     while (true)
     {
         auto const pid = waitpid(-1, &status, WNOHANG);
-        StartupApp cmd;
         if (pid > 0)
-        {
-            {
-                std::lock_guard lock { mutex };
-                if (auto it = pid_to_command_map.find(pid); it != pid_to_command_map.end())
-                {
-                    cmd = it->second;
-                    pid_to_command_map.erase(pid);
-                }
-            }
+            on_exit(pid, status);
+        else
+            break;
+    }
+}
 
-            if (cmd.should_halt_compositor_on_death)
-            {
-                runner.stop();
-                return;
-            }
+void AutoRestartingLauncher::on_exit(pid_t pid, int status)
+{
+    StartupApp cmd;
+    std::chrono::milliseconds delay { 0 };
+    {
+        std::lock_guard lock { mutex };
 
-            if (cmd.restart_on_death)
-            {
-                if (status != 127)
-                {
-                    mir::log_error(
-                        "Process exited with status 127, meaning it could not be found. %s will not be restarted",
-                        cmd.command.c_str());
-                }
-                else
-                {
-                    launch(cmd);
-                }
-            }
+        // This may run within the callback of the child's own handle, so the
+        // handle is released from the handler of [retire_fd] right after
+        if (auto it = child_handles.find(pid); it != child_handles.end())
+        {
+            retired_child_handles.push_back(std::move(it->second));
+            child_handles.erase(it);
+            eventfd_write(retire_fd, 1);
         }
-        else
-            break;
+
+        if (auto it = pid_to_command_map.find(pid); it != pid_to_command_map.end())
+        {
+            cmd = it->second;
+            pid_to_command_map.erase(pid);
+        }
+
+        if (cmd.restart_on_death)
+            delay = backoff.exited(cmd.command, status, RestartBackoff::clock::now());
+
+        if (startup_scheduler)
+            startup_scheduler->exited(pid);
+    }
+
+    launch_ready_startup_apps();
+
+    if (cmd.should_halt_compositor_on_death)
+    {
+        runner.stop();
+        return;
+    }
+
+    if (!cmd.restart_on_death)
+        return;
+
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 127)
+    {
+        mir::log_error(
+            "Process exited with status 127, meaning it could not be found. %s will not be restarted",
+            cmd.command.c_str());
+        return;
+    }
+
+    if (delay == std::chrono::milliseconds::zero() || restart_timer < 0)
+    {
+        launch(cmd);
+        return;
+    }
+
+    {
+        std::lock_guard lock { mutex };
+        auto const stats = backoff.stats(cmd.command);
+        mir::log_warning(
+            "%s died %u times in a row after %u starts, restarting it in %lldms",
+            cmd.command.c_str(),
+            stats->consecutive_failures,
+            stats->starts,
+            static_cast<long long>(delay.count()));
+        pending_restarts.emplace(RestartBackoff::clock::now() + delay, cmd);
+        arm_restart_timer();
+    }
+}
+
+void AutoRestartingLauncher::arm_restart_timer()
+{
+    if (pending_restarts.empty())
+        arm_timer(restart_timer, std::nullopt);
+    else
+        arm_timer(restart_timer, pending_restarts.begin()->first);
+}
+
+void AutoRestartingLauncher::on_restart_timer()
+{
+    uint64_t expirations;
+    if (read(restart_timer, &expirations, sizeof(expirations)) < 0 && errno == EAGAIN)
+        return;
+
+    std::vector<StartupApp> due;
+    {
+        std::lock_guard lock { mutex };
+        auto const now = RestartBackoff::clock::now();
+        auto const end = pending_restarts.upper_bound(now);
+        for (auto it = pending_restarts.begin(); it != end; ++it)
+            due.push_back(it->second);
+        pending_restarts.erase(pending_restarts.begin(), end);
+        arm_restart_timer();
     }
+
+    for (auto const& cmd : due)
+        launch(cmd);
 }
@@ -19,28 +19,86 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIRACLEWM_AUTO_RESTARTING_LAUNCHER_H
 
 #include "config.h"
+#include "restart_backoff.h"
+#include "startup_scheduler.h"
 #include <map>
+#include <mir/fd.h>
 #include <miral/external_client.h>
 #include <miral/runner.h>
 #include <string>
 
+namespace mir
+{
+class Server;
+}
+
 namespace miracle
 {
+class Spawner;
 
 class AutoRestartingLauncher
 {
 public:
     AutoRestartingLauncher(miral::MirRunner&, miral::ExternalClientLauncher&);
     void launch(miracle::StartupApp const&);
+
+    /// Launches [apps] in the order and at the pace that [StartupScheduler] decides.
+    void launch_startup_apps(std::vector<StartupApp> const& apps, StartupConfiguration const& config);
+
+    /// Lets the startup apps that wait on the app with [pid] go ahead, now that
+    /// it has opened a window.
+    void advise_window_opened(pid_t pid);
     void kill_all();
 
+    /// Launches through [spawner] from now on, giving programs the environment
+    /// that [server] gives to its clients. The [miral::ExternalClientLauncher]
+    /// remains as a fallback for when the spawner cannot be reached.
+    void use_spawner(std::shared_ptr<Spawner> const& spawner, mir::Server const& server);
+
+    /// The restart history of [command], if it has ever been started with
+    /// [StartupApp::restart_on_death].
+    [[nodiscard]] std::optional<RestartStats> restart_stats(std::string const& command) const;
+
 private:
     std::map<pid_t, miracle::StartupApp> pid_to_command_map;
     miral::MirRunner& runner;
     miral::ExternalClientLauncher& launcher;
     std::mutex mutable mutex;
+    std::shared_ptr<Spawner> spawner;
+    mir::Server const* server = nullptr;
+    std::unique_ptr<miral::FdHandle> spawner_exits_handle;
+
+    /// Direct children are reaped when their pidfd becomes readable. SIGCHLD
+    /// is only used on kernels without pidfd_open.
+    bool const has_pidfd;
+    std::map<pid_t, std::unique_ptr<miral::FdHandle>> child_handles;
+    /// A handle cannot be released from within its own callback, so the handles
+    /// of reaped children are released by the handler of [retire_fd] instead.
+    /// A reaped pidfd stays readable, so they must not outlive the next iteration
+    /// of the main loop.
+    std::vector<std::unique_ptr<miral::FdHandle>> retired_child_handles;
+    mir::Fd retire_fd;
+    std::unique_ptr<miral::FdHandle> retire_handle;
+
+    RestartBackoff backoff;
+    std::multimap<RestartBackoff::clock::time_point, miracle::StartupApp> pending_restarts;
+    mir::Fd restart_timer;
+    std::unique_ptr<miral::FdHandle> restart_timer_handle;
+
+    /// Set while some of the startup apps have yet to be launched.
+    std::optional<StartupScheduler> startup_scheduler;
+    mir::Fd startup_timer;
+    std::unique_ptr<miral::FdHandle> startup_timer_handle;
 
     void reap();
+    void watch_child(pid_t pid);
+    void on_exit(pid_t pid, int status);
+    void arm_restart_timer();
+    void on_restart_timer();
+    pid_t launch_locked(miracle::StartupApp const&);
+    void launch_ready_startup_apps();
+    pid_t spawn(std::vector<std::string> const& argv);
+    [[nodiscard]] std::vector<std::string> client_environment() const;
 };
 
 } // miracle
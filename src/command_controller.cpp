@@ -19,25 +19,65 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "command_controller.h"
 #include "config.h"
+#include "container_group_container.h"
 #include "mode_observer.h"
 #include "output_manager.h"
 #include "parent_container.h"
 #include "scratchpad.h"
+#include "tracing.h"
+#include "window_observer.h"
 #include "window_helpers.h"
 #include "workspace_manager.h"
 
 #include <mir/log.h>
 #include <miral/runner.h>
+#include <unordered_set>
 
 using namespace miracle;
 
+namespace
+{
+/// The threads that help serialize the outputs of the tree, alongside the thread
+/// that asked for it.
+constexpr size_t TREE_JSON_WORKERS = 3;
+
+LayoutCheckpoint::Node checkpoint_node(
+    Container const& container,
+    mir::geometry::Rectangle const& parent_area,
+    LayoutScheme parent_scheme,
+    WindowController& window_controller)
+{
+    LayoutCheckpoint::Node node;
+    auto const area = container.get_logical_area();
+    if (parent_scheme == LayoutScheme::horizontal && parent_area.size.width.as_int() > 0)
+        node.percent = static_cast<double>(area.size.width.as_int()) / parent_area.size.width.as_int();
+    else if (parent_scheme == LayoutScheme::vertical && parent_area.size.height.as_int() > 0)
+        node.percent = static_cast<double>(area.size.height.as_int()) / parent_area.size.height.as_int();
+
+    if (auto const window = container.window())
+    {
+        node.app_id = window_controller.info_for(window.value()).application_id();
+        return node;
+    }
+
+    if (auto const parent = dynamic_cast<ParentContainer const*>(&container))
+    {
+        node.scheme = parent->get_scheme();
+        for (auto const& child : parent->get_sub_nodes())
+            node.nodes.push_back(checkpoint_node(*child, area, node.scheme, window_controller));
+    }
+    return node;
+}
+}
+
 CommandController::CommandController(
     std::shared_ptr<Config> const& config,
-    std::recursive_mutex& mutex,
+    WindowManagerMutex& mutex,
     std::shared_ptr<CompositorState> const& state,
     std::shared_ptr<WindowController> const& window_controller,
     std::shared_ptr<WorkspaceManager> const& workspace_manager,
     std::shared_ptr<ModeObserverRegistrar> const& mode_observer_registrar,
+    std::shared_ptr<WindowObserverRegistrar> const& window_observer_registrar,
     std::unique_ptr<CommandControllerInterface> interface,
     std::shared_ptr<Scratchpad> const& scratchpad_,
     std::shared_ptr<OutputManager> const& output_manager) :
@@ -47,6 +87,7 @@ CommandController::CommandController(
     window_controller { window_controller },
     workspace_manager { workspace_manager },
     mode_observer_registrar { mode_observer_registrar },
+    window_observer_registrar { window_observer_registrar },
     interface { std::move(interface) },
     scratchpad_ { scratchpad_ },
     output_manager { output_manager }
@@ -55,6 +96,7 @@ CommandController::CommandController(
 
 void CommandController::try_toggle_resize_mode()
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_toggle_resize_mode");
     std::lock_guard lock(mutex);
     if (!state->focused_container())
     {
@@ -76,6 +118,7 @@ void CommandController::try_toggle_resize_mode()
 
 bool CommandController::try_request_vertical()
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_request_vertical");
     std::lock_guard lock(mutex);
     if (state->mode() != WindowManagerMode::normal)
         return false;
@@ -89,6 +132,7 @@ bool CommandController::try_request_vertical()
 
 bool CommandController::try_toggle_layout(bool cycle_thru_all)
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_toggle_layout");
     std::lock_guard lock(mutex);
     if (state->mode() != WindowManagerMode::normal)
         return false;
@@ -102,6 +146,7 @@ bool CommandController::try_toggle_layout(bool cycle_thru_all)
 
 bool CommandController::try_request_horizontal()
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_request_horizontal");
     std::lock_guard lock(mutex);
     if (state->mode() != WindowManagerMode::normal)
         return false;
@@ -115,6 +160,7 @@ bool CommandController::try_request_horizontal()
 
 bool CommandController::try_resize(miracle::Direction direction, int pixels)
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_resize");
     std::lock_guard lock(mutex);
     if (!state->focused_container())
         return false;
@@ -124,6 +170,7 @@ bool CommandController::try_resize(miracle::Direction direction, int pixels)
 
 bool CommandController::try_set_size(std::optional<int> const& width, std::optional<int> const& height)
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_set_size");
     std::lock_guard lock(mutex);
     if (!state->focused_container())
         return false;
@@ -133,6 +180,7 @@ bool CommandController::try_set_size(std::optional<int> const& width, std::optio
 
 bool CommandController::try_move(miracle::Direction direction)
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_move");
     std::lock_guard lock(mutex);
     if (state->mode() != WindowManagerMode::normal)
         return false;
@@ -140,11 +188,17 @@ bool CommandController::try_move(miracle::Direction direction)
     if (!state->focused_container())
         return false;
 
-    return state->focused_container()->move(direction);
+    auto container = state->focused_container();
+    if (!container->move(direction))
+        return false;
+
+    window_observer_registrar->advise_changed(WindowChange::moved, *container);
+    return true;
 }
 
 bool CommandController::try_move_by(miracle::Direction direction, int pixels)
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_move_by");
     std::lock_guard lock(mutex);
     if (state->mode() != WindowManagerMode::normal)
         return false;
@@ -157,6 +211,7 @@ bool CommandController::try_move_by(miracle::Direction direction, int pixels)
 
 bool CommandController::try_move_to(int x, int y)
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_move_to");
     std::lock_guard lock(mutex);
     if (state->mode() != WindowManagerMode::normal)
         return false;
@@ -167,6 +222,16 @@ bool CommandController::try_move_to(int x, int y)
     return state->focused_container()->move_to(x, y);
 }
 
+void CommandController::invoke_under_lock(std::function<void()> const& f)
+{
+    interface->invoke_under_lock(f);
+}
+
+std::unique_lock<WindowManagerMutex> CommandController::lock() const
+{
+    return std::unique_lock(mutex);
+}
+
 void CommandController::select_container(std::shared_ptr<Container> const& container)
 {
     std::lock_guard lock(mutex);
@@ -181,6 +246,7 @@ void CommandController::select_container(std::shared_ptr<Container> const& conta
 
 bool CommandController::try_select(miracle::Direction direction)
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_select");
     std::lock_guard lock(mutex);
     if (state->mode() != WindowManagerMode::normal)
         return false;
@@ -193,6 +259,7 @@ bool CommandController::try_select(miracle::Direction direction)
 
 bool CommandController::try_select_parent()
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_select_parent");
     std::lock_guard lock(mutex);
     if (state->mode() != WindowManagerMode::normal)
         return false;
@@ -214,6 +281,7 @@ bool CommandController::try_select_parent()
 
 bool CommandController::try_select_child()
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_select_child");
     std::lock_guard lock(mutex);
     if (state->mode() != WindowManagerMode::normal)
         return false;
@@ -254,6 +322,7 @@ bool CommandController::try_select_child()
 
 bool CommandController::try_select_floating()
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_select_floating");
     std::lock_guard lock(mutex);
     if (state->mode() != WindowManagerMode::normal)
         return false;
@@ -272,6 +341,7 @@ bool CommandController::try_select_floating()
 
 bool CommandController::try_select_tiling()
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_select_tiling");
     std::lock_guard lock(mutex);
     if (state->mode() != WindowManagerMode::normal)
         return false;
@@ -290,6 +360,7 @@ bool CommandController::try_select_tiling()
 
 bool CommandController::try_select_toggle()
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_select_toggle");
     std::lock_guard lock(mutex);
     if (state->mode() != WindowManagerMode::normal)
         return false;
@@ -307,6 +378,7 @@ bool CommandController::try_select_toggle()
 
 bool CommandController::try_close_window()
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_close_window");
     std::lock_guard lock(mutex);
     if (!state->focused_container())
         return false;
@@ -326,16 +398,53 @@ bool CommandController::quit()
     return true;
 }
 
+bool CommandController::restart()
+{
+    std::lock_guard lock(mutex);
+    write_layout_checkpoint(layout_checkpoint_path(), checkpoint_layout());
+    state->request_restart();
+    interface->quit();
+    return true;
+}
+
+LayoutCheckpoint CommandController::checkpoint_layout() const
+{
+    std::lock_guard lock(mutex);
+    LayoutCheckpoint checkpoint;
+    for (auto const* workspace : workspace_manager->workspaces())
+    {
+        auto const root = workspace->get_root();
+        auto const* output = workspace->get_output();
+        if (!output || !root || root->num_nodes() == 0)
+            continue;
+
+        auto const active = output->active();
+        checkpoint.workspaces.push_back(LayoutCheckpoint::Workspace {
+            .output = output->name(),
+            .num = workspace->num(),
+            .name = workspace->name(),
+            .is_active = active && active->id() == workspace->id(),
+            .root = checkpoint_node(*root, root->get_logical_area(), LayoutScheme::none, *window_controller) });
+    }
+    return checkpoint;
+}
+
 bool CommandController::try_toggle_fullscreen()
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_toggle_fullscreen");
     std::lock_guard lock(mutex);
     if (state->mode() != WindowManagerMode::normal)
         return false;
 
-    if (!state->focused_container())
+    auto container = state->focused_container();
+    if (!container)
         return false;
 
-    return state->focused_container()->toggle_fullscreen();
+    if (!container->toggle_fullscreen())
+        return false;
+
+    window_observer_registrar->advise_changed(WindowChange::fullscreen_mode, *container);
+    return true;
 }
 
 bool CommandController::select_workspace(int number, bool back_and_forth)
@@ -416,6 +525,14 @@ bool CommandController::move_active_to_workspace(int number, bool back_and_forth
         return false;
 
     auto container = state->focused_container();
+    if (auto const group = Container::as_group(container))
+    {
+        return move_group_to_workspace(group, [&]
+        {
+            return workspace_manager->request_workspace(output_manager->focused(), number, back_and_forth);
+        });
+    }
+
     if (container->get_workspace()->num() == number)
         return false;
 
@@ -426,6 +543,7 @@ bool CommandController::move_active_to_workspace(int number, bool back_and_forth
             output_manager->focused(), number, back_and_forth))
     {
         output_manager->focused()->graft(container);
+        window_observer_registrar->advise_changed(WindowChange::moved, *container);
         if (container->window().value())
             window_controller->select_active_window(container->window().value());
         return true;
@@ -441,6 +559,14 @@ bool CommandController::move_active_to_workspace_named(std::string const& name,
         return false;
 
     auto container = state->focused_container();
+    if (auto const group = Container::as_group(container))
+    {
+        return move_group_to_workspace(group, [&]
+        {
+            return workspace_manager->request_workspace(output_manager->focused(), name, back_and_forth);
+        });
+    }
+
     if (container->get_workspace()->name() == name)
         return false;
 
@@ -450,12 +576,40 @@ bool CommandController::move_active_to_workspace_named(std::string const& name,
     if (workspace_manager->request_workspace(output_manager->focused(), name, back_and_forth))
     {
         output_manager->focused()->graft(container);
+        window_observer_registrar->advise_changed(WindowChange::moved, *container);
         return true;
     }
 
     return false;
 }
 
+bool CommandController::move_group_to_workspace(std::shared_ptr<ContainerGroupContainer> const& group, FunctionRef<bool()> request_workspace)
+{
+    // The members leave their workspaces and join the next one in a single batch,
+    // so that each workspace is laid out once however many windows are moved
+    CommitBatch batch(*state);
+    std::vector<std::shared_ptr<Container>> moving;
+    group->for_each([&](std::shared_ptr<Container> const& container)
+    {
+        if (auto const output = container->get_output())
+        {
+            output->delete_container(container);
+            moving.push_back(container);
+        }
+    });
+    state->unfocus_container(group);
+
+    if (!request_workspace())
+        return false;
+
+    for (auto const& container : moving)
+    {
+        output_manager->focused()->graft(container);
+        window_observer_registrar->advise_changed(WindowChange::moved, *container);
+    }
+    return true;
+}
+
 bool CommandController::move_active_to_next_workspace()
 {
     std::lock_guard lock(mutex);
@@ -469,6 +623,7 @@ bool CommandController::move_active_to_next_workspace()
     if (workspace_manager->request_next(output_manager->focused()))
     {
         output_manager->focused()->graft(container);
+        window_observer_registrar->advise_changed(WindowChange::moved, *container);
         return true;
     }
 
@@ -488,6 +643,7 @@ bool CommandController::move_active_to_prev_workspace()
     if (workspace_manager->request_prev(output_manager->focused()))
     {
         output_manager->focused()->graft(container);
+        window_observer_registrar->advise_changed(WindowChange::moved, *container);
         return true;
     }
 
@@ -507,6 +663,7 @@ bool CommandController::move_active_to_back_and_forth()
     if (workspace_manager->request_back_and_forth())
     {
         output_manager->focused()->graft(container);
+        window_observer_registrar->advise_changed(WindowChange::moved, *container);
         return true;
     }
 
@@ -607,7 +764,9 @@ bool CommandController::toggle_floating()
     if (!state->focused_container())
         return false;
 
-    toggle_floating_internal(state->focused_container());
+    auto container = state->focused_container();
+    toggle_floating_internal(container);
+    window_observer_registrar->advise_changed(WindowChange::floating, *container);
     return true;
 }
 
@@ -681,6 +840,7 @@ void CommandController::move_cursor_to_output(OutputInterface const& output)
 
 bool CommandController::try_select_next_output()
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_select_next_output");
     std::lock_guard lock(mutex);
     for (size_t i = 0; i < output_manager->outputs().size(); i++)
     {
@@ -700,6 +860,7 @@ bool CommandController::try_select_next_output()
 
 bool CommandController::try_select_prev_output()
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_select_prev_output");
     std::lock_guard lock(mutex);
     for (int i = output_manager->outputs().size() - 1; i >= 0; i++)
     {
@@ -771,6 +932,7 @@ OutputInterface* CommandController::_next_output_in_direction(Direction directio
 
 bool CommandController::try_select_output(Direction direction)
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_select_output");
     std::lock_guard lock(mutex);
     auto const& next = _next_output_in_direction(direction);
     if (next != output_manager->focused())
@@ -812,6 +974,7 @@ OutputInterface* CommandController::_next_output_in_list(std::vector<std::string
 
 bool CommandController::try_select_output(std::vector<std::string> const& names)
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_select_output");
     std::lock_guard lock(mutex);
     if (!output_manager->focused())
         return false;
@@ -824,6 +987,7 @@ bool CommandController::try_select_output(std::vector<std::string> const& names)
 
 bool CommandController::try_move_active_to_output(miracle::Direction direction)
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_move_active_to_output");
     std::lock_guard lock(mutex);
     if (!output_manager->focused())
         return false;
@@ -839,6 +1003,7 @@ bool CommandController::try_move_active_to_output(miracle::Direction direction)
         state->unfocus_container(container);
 
         next->graft(container);
+        window_observer_registrar->advise_changed(WindowChange::moved, *container);
         if (container->window().value())
             window_controller->select_active_window(container->window().value());
         return true;
@@ -849,6 +1014,7 @@ bool CommandController::try_move_active_to_output(miracle::Direction direction)
 
 bool CommandController::try_move_active_to_current()
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_move_active_to_current");
     std::lock_guard lock(mutex);
     if (!output_manager->focused())
         return false;
@@ -864,6 +1030,7 @@ bool CommandController::try_move_active_to_current()
     state->unfocus_container(container);
 
     output_manager->focused()->graft(container);
+    window_observer_registrar->advise_changed(WindowChange::moved, *container);
     if (container->window().value())
         window_controller->select_active_window(container->window().value());
     return true;
@@ -871,6 +1038,7 @@ bool CommandController::try_move_active_to_current()
 
 bool CommandController::try_move_active_to_primary()
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_move_active_to_primary");
     std::lock_guard lock(mutex);
     if (output_manager->outputs().empty())
         return false;
@@ -886,6 +1054,7 @@ bool CommandController::try_move_active_to_primary()
     state->unfocus_container(container);
 
     output_manager->outputs()[0]->graft(container);
+    window_observer_registrar->advise_changed(WindowChange::moved, *container);
     if (container->window().value())
         window_controller->select_active_window(container->window().value());
     return true;
@@ -893,6 +1062,7 @@ bool CommandController::try_move_active_to_primary()
 
 bool CommandController::try_move_active_to_nonprimary()
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_move_active_to_nonprimary");
     std::lock_guard lock(mutex);
     constexpr int MIN_SIZE_TO_HAVE_NONPRIMARY_OUTPUT = 2;
     if (output_manager->outputs().size() < MIN_SIZE_TO_HAVE_NONPRIMARY_OUTPUT)
@@ -909,6 +1079,7 @@ bool CommandController::try_move_active_to_nonprimary()
     state->unfocus_container(container);
 
     output_manager->outputs()[1]->graft(container);
+    window_observer_registrar->advise_changed(WindowChange::moved, *container);
     if (container->window().value())
         window_controller->select_active_window(container->window().value());
     return true;
@@ -916,6 +1087,7 @@ bool CommandController::try_move_active_to_nonprimary()
 
 bool CommandController::try_move_active_to_next()
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_move_active_to_next");
     std::lock_guard lock(mutex);
     if (!can_move_container())
         return false;
@@ -946,6 +1118,7 @@ bool CommandController::try_move_active_to_next()
     state->unfocus_container(container);
 
     (*it)->graft(container);
+    window_observer_registrar->advise_changed(WindowChange::moved, *container);
     if (container->window().value())
         window_controller->select_active_window(container->window().value());
     return true;
@@ -953,6 +1126,7 @@ bool CommandController::try_move_active_to_next()
 
 bool CommandController::try_move_active(std::vector<std::string> const& names)
 {
+    MIRACLE_TRACE_SCOPE("CommandController::try_move_active");
     std::lock_guard lock(mutex);
     if (!can_move_container())
         return false;
@@ -965,6 +1139,7 @@ bool CommandController::try_move_active(std::vector<std::string> const& names)
         state->unfocus_container(container);
 
         output->graft(container);
+        window_observer_registrar->advise_changed(WindowChange::moved, *container);
         if (container->window().value())
             window_controller->select_active_window(container->window().value());
     }
@@ -987,6 +1162,7 @@ bool CommandController::reload_config()
 {
     std::lock_guard lock(mutex);
     config->reload();
+    config->try_process_change();
     return true;
 }
 
@@ -996,12 +1172,50 @@ void CommandController::set_mode(WindowManagerMode mode)
     mode_observer_registrar->advise_changed(state->mode());
 }
 
-nlohmann::json CommandController::to_json() const
+std::string CommandController::to_json_string() const
 {
     std::lock_guard lock(mutex);
+    auto const& outputs = output_manager->outputs();
+    auto const* focused = output_manager->focused();
+    output_json.resize(outputs.size());
+    auto const write_output = [&](size_t i)
+    {
+        output_json[i].clear();
+        if (outputs[i]->is_defunct())
+            return;
+
+        JsonWriter writer(output_json[i]);
+        outputs[i]->write_json(writer, focused == outputs[i].get());
+    };
+
+    // The outputs share no containers, so each is serialized on a thread of its own
+    if (outputs.size() > 1)
+    {
+        if (!tree_json_workers)
+            tree_json_workers = std::make_unique<WorkerPool>(TREE_JSON_WORKERS);
+        tree_json_workers->for_each(outputs.size(), write_output);
+    }
+    else if (!outputs.empty())
+        write_output(0);
+
+    std::string result;
+    JsonWriter writer(result);
+    writer.begin_object();
+    write_root_json(writer);
+    writer.key("nodes").begin_array();
+    for (auto const& json : output_json)
+    {
+        if (!json.empty())
+            writer.raw(json);
+    }
+    writer.end_array().end_object();
+    return result;
+}
+
+void CommandController::write_root_json(JsonWriter& writer) const
+{
     geom::Point top_left { INT_MAX, INT_MAX };
     geom::Point bottom_right { 0, 0 };
-    nlohmann::json outputs_json = nlohmann::json::array();
     for (auto const& output : output_manager->outputs())
     {
         if (output->is_defunct())
@@ -1021,8 +1235,6 @@ nlohmann::json CommandController::to_json() const
             bottom_right.x = geom::X { bottom_x };
         if (bottom_y > bottom_right.y.as_int())
             bottom_right.y = geom::Y { bottom_y };
-
-        outputs_json.push_back(output->to_json(output_manager->focused() == output.get()));
     }
 
     geom::Rectangle total_area {
@@ -1031,45 +1243,47 @@ nlohmann::json CommandController::to_json() const
                     geom::Width(bottom_right.x.as_int() - top_left.x.as_int()),
                     geom::Height(bottom_right.y.as_int() - top_left.y.as_int()) }
     };
-    nlohmann::json root = {
-        { "id", 0 },
-        { "name", "root" },
-        {
-         "rect",
-         { { "x", total_area.top_left.x.as_int() }, { "y", total_area.top_left.y.as_int() }, { "width", total_area.size.width.as_int() }, { "height", total_area.size.height.as_int() } },
-         },
-        { "nodes", outputs_json },
-        { "type", "root" }
-    };
-    return root;
+    writer.key("id")
+        .value(0)
+        .key("name")
+        .value("root")
+        .rect("rect", total_area)
+        .key("type")
+        .value("root");
 }
 
-nlohmann::json CommandController::outputs_json() const
+std::string CommandController::outputs_json() const
 {
     std::lock_guard lock(mutex);
-    nlohmann::json j = nlohmann::json::array();
+    std::string result;
+    JsonWriter writer(result);
+    writer.begin_array();
     for (auto const& output : output_manager->outputs())
     {
         if (output->is_defunct())
             continue;
 
-        j.push_back(output->to_json(output_manager->focused() == output.get()));
+        output->write_json(writer, output_manager->focused() == output.get());
     }
-    return j;
+    writer.end_array();
+    return result;
 }
 
-nlohmann::json CommandController::workspaces_json() const
+std::string CommandController::workspaces_json() const
 {
     std::lock_guard lock(mutex);
-    nlohmann::json j = nlohmann::json::array();
+    std::string result;
+    JsonWriter writer(result);
+    writer.begin_array();
     for (auto workspace : workspace_manager->workspaces())
     {
         if (workspace->get_output()->is_defunct())
             continue;
 
-        j.push_back(workspace->to_json(output_manager->focused() == workspace->get_output()));
+        workspace->write_json(writer, output_manager->focused() == workspace->get_output());
     }
-    return j;
+    writer.end_array();
+    return result;
 }
 
 nlohmann::json CommandController::workspace_to_json(uint32_t id) const
@@ -1110,4 +1324,145 @@ nlohmann::json CommandController::mode_to_json() const
         return {};
     }
     }
-}
\ No newline at end of file
+}
+nlohmann::json CommandController::render_stats_json() const
+{
+    // The stats are synchronised by the manager, as renderers report from their own threads.
+    return state->render_stats()->to_json();
+}
+
+nlohmann::json CommandController::window_open_stats_json() const
+{
+    // Synchronised by the stats themselves, as the renderers report the first frame of each window.
+    return state->window_open_stats()->to_json();
+}
+
+nlohmann::json CommandController::window_update_stats_json() const
+{
+    auto const& stats = state->window_update_stats();
+    return {
+        { "rectangles_suppressed", stats.rectangles_suppressed },
+        { "clips_suppressed", stats.clips_suppressed },
+        { "states_suppressed", stats.states_suppressed },
+        { "modifications_applied", stats.modifications_applied },
+        { "modifications_merged", stats.modifications_merged },
+        { "xwayland_sizes_sent", stats.xwayland_sizes_sent },
+        { "xwayland_sizes_deferred", stats.xwayland_sizes_deferred },
+        { "occlusions_changed", stats.occlusions_changed }
+    };
+}
+
+void CommandController::publish_scene(bool force)
+{
+    MIRACLE_TRACE_SCOPE("CommandController::publish_scene");
+    std::lock_guard lock(mutex);
+    auto key = current_scene_key();
+    if (!force && key == scene_key && scene_publisher.latest())
+        return;
+
+    scene_key = std::move(key);
+    scene_publisher.publish(capture_scene());
+}
+
+std::shared_ptr<SceneSnapshot const> CommandController::scene() const
+{
+    return scene_publisher.latest();
+}
+
+SceneKey CommandController::current_scene_key() const
+{
+    SceneKey key {
+        .scene_generation = state->scene_generation(),
+        .focused = state->focused_container().get(),
+        .focused_output = output_manager->focused()
+    };
+
+    // Switching workspaces moves no container, so it is caught here instead
+    for (auto const& output : output_manager->outputs())
+        key.active_workspaces.push_back(output->is_defunct() ? nullptr : output->active());
+    return key;
+}
+
+SceneSnapshot CommandController::capture_scene() const
+{
+    SceneSnapshot scene;
+    scene.mode = state->mode();
+
+    auto const focused_output = output_manager->focused();
+    for (auto const& output : output_manager->outputs())
+    {
+        if (output->is_defunct())
+            continue;
+
+        auto const active = output->active();
+        bool const is_focused = output.get() == focused_output;
+        scene.outputs.push_back({
+            .name = output->name(),
+            .area = output->get_area(),
+            .active_workspace = active ? std::optional(active->id()) : std::nullopt,
+            .is_focused = is_focused });
+
+        for (auto const& workspace : output->get_workspaces())
+        {
+            if (!workspace)
+                continue;
+
+            bool const is_visible = workspace.get() == active;
+            scene.workspaces.push_back({
+                .id = workspace->id(),
+                .num = workspace->num(),
+                .name = workspace->display_name(),
+                .output = output->name(),
+                .is_visible = is_visible,
+                .is_focused = is_visible && is_focused });
+        }
+    }
+
+    auto const focused = state->focused_container();
+    if (focused)
+        scene.focused = reinterpret_cast<uintptr_t>(focused.get());
+
+    // The roots of the workspaces are not part of the i3 tree, so they are left out
+    auto const parent_id = [](Container const& container) -> std::optional<uintptr_t>
+    {
+        auto const parent = container.get_parent().lock();
+        if (!parent || parent->get_parent().expired())
+            return std::nullopt;
+        return reinterpret_cast<uintptr_t>(parent.get());
+    };
+    auto const add = [&](Container const& container)
+    {
+        auto const workspace = container.get_workspace();
+        scene.containers.push_back({
+            .id = reinterpret_cast<uintptr_t>(&container),
+            .type = container.get_type(),
+            .parent = parent_id(container),
+            .area = container.get_logical_area(),
+            .workspace = workspace ? std::optional(workspace->id()) : std::nullopt,
+            .is_floating = !container.anchored(),
+            .is_focused = &container == focused.get() });
+    };
+
+    std::unordered_set<Container const*> seen_parents;
+    std::vector<std::shared_ptr<ParentContainer>> parents;
+    for (auto const& weak : state->containers())
+    {
+        auto const container = weak.lock();
+        if (!container)
+            continue;
+
+        add(*container);
+        for (auto parent = container->get_parent().lock(); parent && !parent->get_parent().expired();
+             parent = parent->get_parent().lock())
+        {
+            if (!seen_parents.insert(parent.get()).second)
+                break;
+            parents.push_back(parent);
+        }
+    }
+
+    for (auto const& parent : parents)
+        add(*parent);
+    return scene;
+}
+
@@ -20,7 +20,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "compositor_state.h"
 #include "direction.h"
+#include "function_ref.h"
+#include "json_writer.h"
+#include "layout_checkpoint.h"
 #include "output_interface.h"
+#include "scene_snapshot.h"
+#include "window_manager_mutex.h"
+#include "worker_pool.h"
+#include <functional>
+#include <mutex>
 #include <nlohmann/json.hpp>
 #include <optional>
 #include <string>
@@ -33,7 +41,9 @@ class MirRunner;
 namespace miracle
 {
 class Scratchpad;
+class ContainerGroupContainer;
 class ModeObserverRegistrar;
+class WindowObserverRegistrar;
 class OutputManager;
 
 class CommandControllerInterface
@@ -41,6 +51,10 @@ class CommandControllerInterface
 public:
     virtual ~CommandControllerInterface() = default;
     virtual void quit() = 0;
+
+    /// Runs [f] as a transaction of the window manager, while holding the lock
+    /// that the window manager holds for its own events.
+    virtual void invoke_under_lock(std::function<void()> const& f) { f(); }
 };
 
 /// Responsible for fielding requests from the system and forwarding
@@ -55,11 +69,12 @@ class CommandController
 public:
     CommandController(
         std::shared_ptr<Config> const& config,
-        std::recursive_mutex& mutex,
+        WindowManagerMutex& mutex,
         std::shared_ptr<CompositorState> const& state,
         std::shared_ptr<WindowController> const& window_controller,
         std::shared_ptr<WorkspaceManager> const& workspace_manager,
         std::shared_ptr<ModeObserverRegistrar> const& mode_observer_registrar,
+        std::shared_ptr<WindowObserverRegistrar> const& window_observer_registrar,
         std::unique_ptr<CommandControllerInterface> interface,
         std::shared_ptr<Scratchpad> const& scratchpad,
         std::shared_ptr<OutputManager> const& output_manager);
@@ -81,6 +96,10 @@ public:
     bool try_select_toggle();
     bool try_close_window();
     bool quit();
+
+    /// Saves the tiled layout of every workspace with [write_layout_checkpoint] and
+    /// stops the server, which then starts itself again.
+    bool restart();
     bool try_toggle_fullscreen();
     bool select_workspace(int number, bool back_and_forth = true);
     bool select_workspace(std::string const& name, bool back_and_forth);
@@ -117,31 +136,76 @@ public:
     bool reload_config();
     void set_mode(WindowManagerMode mode);
     void select_container(std::shared_ptr<Container> const&);
-    [[nodiscard]] nlohmann::json to_json() const;
-    [[nodiscard]] nlohmann::json outputs_json() const;
-    [[nodiscard]] nlohmann::json workspaces_json() const;
+
+    /// Runs [f] on the calling thread as a transaction of the window manager, in
+    /// turn with the input and window events. Work that the server thread does on
+    /// behalf of other threads goes through here, so that it is never interleaved
+    /// with an event that holds the lock of the window manager.
+    void invoke_under_lock(std::function<void()> const& f);
+
+    /// Holds off requests from other threads for as long as the returned lock
+    /// is alive. The lock is recursive, so requests made while holding it go
+    /// through without waiting.
+    [[nodiscard]] std::unique_lock<WindowManagerMutex> lock() const;
+    /// The serialized i3 tree, which reuses the JSON of containers that have
+    /// not changed since it was last requested.
+    [[nodiscard]] std::string to_json_string() const;
+    /// The serialized replies to IPC_GET_OUTPUTS and IPC_GET_WORKSPACES.
+    [[nodiscard]] std::string outputs_json() const;
+    [[nodiscard]] std::string workspaces_json() const;
     [[nodiscard]] nlohmann::json workspace_to_json(uint32_t) const;
     [[nodiscard]] nlohmann::json mode_to_json() const;
+    [[nodiscard]] nlohmann::json render_stats_json() const;
+    [[nodiscard]] nlohmann::json window_update_stats_json() const;
+    /// The percentiles of the time that new windows take to reach each [WindowOpenStage].
+    [[nodiscard]] nlohmann::json window_open_stats_json() const;
+    /// The tiled layout of every workspace that has tiled windows.
+    [[nodiscard]] LayoutCheckpoint checkpoint_layout() const;
+
+    /// Publishes a [SceneSnapshot] if the scene has changed since the last one was
+    /// published, or regardless if [force] is true. Called on the server thread at
+    /// the end of each transaction.
+    void publish_scene(bool force = false);
+
+    /// The latest [SceneSnapshot], or nullptr if none has been published yet.
+    /// May be called from any thread, as it never waits for the window manager.
+    [[nodiscard]] std::shared_ptr<SceneSnapshot const> scene() const;
 
 private:
     std::shared_ptr<Config> config;
-    std::recursive_mutex& mutex;
+    WindowManagerMutex& mutex;
     std::shared_ptr<CompositorState> state;
     std::shared_ptr<WindowController> window_controller;
     std::shared_ptr<WorkspaceManager> workspace_manager;
     std::shared_ptr<ModeObserverRegistrar> mode_observer_registrar;
+    std::shared_ptr<WindowObserverRegistrar> window_observer_registrar;
     std::unique_ptr<CommandControllerInterface> interface;
     std::shared_ptr<Scratchpad> scratchpad_;
     std::shared_ptr<OutputManager> output_manager;
+    ScenePublisher scene_publisher;
+    SceneKey scene_key;
+
+    /// Serializes the outputs of the tree in parallel. Started once a tree with
+    /// more than one output is first asked for.
+    mutable std::unique_ptr<WorkerPool> tree_json_workers;
+    /// The JSON of each output in the last tree, kept to reuse its memory.
+    mutable std::vector<std::string> output_json;
 
     bool can_move_container() const;
     bool can_set_layout() const;
 
+    /// Moves every member of [group] to the workspace that [request_workspace] focuses.
+    bool move_group_to_workspace(std::shared_ptr<ContainerGroupContainer> const& group, FunctionRef<bool()> request_workspace);
+
     /// Floats the container and returns the new [ParentContainer] of that container.
     std::shared_ptr<ParentContainer> toggle_floating_internal(std::shared_ptr<Container> const& container);
 
     OutputInterface* _next_output_in_list(std::vector<std::string> const& names);
     OutputInterface* _next_output_in_direction(Direction direction);
+    /// Writes the fields of the root of the tree, less its nodes.
+    void write_root_json(JsonWriter& writer) const;
+    [[nodiscard]] SceneKey current_scene_key() const;
+    [[nodiscard]] SceneSnapshot capture_scene() const;
 };
 }
 
@@ -18,12 +18,21 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIR_LOG_COMPONENT "compositor_state"
 
 #include "compositor_state.h"
+#include "debug_log.h"
+#include "parent_container.h"
+#include <limits>
 #include <mir/log.h>
 
 using namespace miracle;
 
 CompositorState::CompositorState() :
-    render_data_manager_(std::make_unique<RenderDataManager>())
+    render_data_manager_(std::make_unique<RenderDataManager>()),
+    render_stats_(std::make_unique<RenderStatsManager>()),
+    window_open_stats_(std::make_unique<WindowOpenStats>()),
+    // Unbounded until the renderers apply the configured budget
+    gpu_memory_budget_(std::make_unique<GpuMemoryBudget>(std::numeric_limits<size_t>::max())),
+    mirror_groups_(std::make_unique<MirrorGroups>()),
+    frame_clock_(std::make_shared<FrameClock>())
 {
 }
 
@@ -37,20 +46,17 @@ std::shared_ptr<Container> CompositorState::focused_container() const
 
 void CompositorState::focus_container(std::shared_ptr<Container> const& container, bool is_anonymous)
 {
+    scene_generation_++;
     if (is_anonymous)
     {
         focused = container;
         return;
     }
 
-    auto it = std::find_if(focus_order.begin(), focus_order.end(), [&](auto const& element)
+    auto it = focus_order_index.find(container.get());
+    if (it != focus_order_index.end())
     {
-        return !element.expired() && element.lock() == container;
-    });
-
-    if (it != focus_order.end())
-    {
-        std::rotate(focus_order.begin(), it, it + 1);
+        focus_order.splice(focus_order.begin(), focus_order, it->second);
         focused = container;
     }
 }
@@ -60,23 +66,31 @@ void CompositorState::unfocus_container(std::shared_ptr<Container> const& contai
     if (!focused.expired())
     {
         if (focused.lock() == container)
+        {
             focused.reset();
+            scene_generation_++;
+        }
     }
 }
 
 void CompositorState::add(std::shared_ptr<Container> const& container)
 {
+    // A container that was never removed may have left its address behind
+    remove(container);
     focus_order.push_back(container);
-    mir::log_debug("add: there are now %zu surfaces in the focus order", focus_order.size());
+    focus_order_index[container.get()] = std::prev(focus_order.end());
+    MIRACLE_LOG_DEBUG(LogCategory::state, "add: there are now %zu surfaces in the focus order", focus_order.size());
 }
 
 void CompositorState::remove(std::shared_ptr<Container> const& container)
 {
-    focus_order.erase(std::remove_if(focus_order.begin(), focus_order.end(), [&](auto const& element)
-    {
-        return !element.expired() && element.lock() == container;
-    }));
-    mir::log_debug("remove: there are now %zu surfaces in the focus order", focus_order.size());
+    auto it = focus_order_index.find(container.get());
+    if (it == focus_order_index.end())
+        return;
+
+    focus_order.erase(it->second);
+    focus_order_index.erase(it);
+    MIRACLE_LOG_DEBUG(LogCategory::state, "remove: there are now %zu surfaces in the focus order", focus_order.size());
 }
 
 std::shared_ptr<Container> CompositorState::first_floating() const
@@ -109,9 +123,121 @@ WindowManagerMode CompositorState::mode() const
 void CompositorState::mode(WindowManagerMode next)
 {
     mode_ = next;
+    scene_generation_++;
+    render_data_manager_->mode_change(next);
+}
+
+std::optional<mir::geometry::Rectangle> const& CompositorState::drag_preview() const
+{
+    return drag_preview_;
+}
+
+void CompositorState::drag_preview(std::optional<mir::geometry::Rectangle> const& next)
+{
+    drag_preview_ = next;
+    render_data_manager_->drag_preview_change(next);
 }
 
 RenderDataManager* CompositorState::render_data_manager() const
 {
     return render_data_manager_.get();
-}
\ No newline at end of file
+}
+RenderStatsManager* CompositorState::render_stats() const
+{
+    return render_stats_.get();
+}
+
+WindowOpenStats* CompositorState::window_open_stats() const
+{
+    return window_open_stats_.get();
+}
+
+GpuMemoryBudget* CompositorState::gpu_memory_budget() const
+{
+    return gpu_memory_budget_.get();
+}
+
+MirrorGroups* CompositorState::mirror_groups() const
+{
+    return mirror_groups_.get();
+}
+
+std::shared_ptr<FrameClock> const& CompositorState::frame_clock() const
+{
+    return frame_clock_;
+}
+
+void CompositorState::begin_batch()
+{
+    batch_depth++;
+}
+
+void CompositorState::end_batch()
+{
+    if (batch_depth == 0)
+    {
+        mir::log_error("end_batch: no batch is open");
+        return;
+    }
+
+    if (--batch_depth > 0)
+        return;
+
+    // Parents are laid out before their children, as laying out a parent resizes its children
+    std::vector<std::pair<size_t, std::shared_ptr<ParentContainer>>> relayouts;
+    for (auto const& parent : deferred_relayouts)
+    {
+        if (auto const locked = parent.lock())
+        {
+            size_t depth = 0;
+            for (auto ancestor = locked->get_parent().lock(); ancestor; ancestor = ancestor->get_parent().lock())
+                depth++;
+            relayouts.emplace_back(depth, locked);
+        }
+    }
+    deferred_relayouts.clear();
+    std::stable_sort(relayouts.begin(), relayouts.end(), [](auto const& a, auto const& b)
+    {
+        return a.first < b.first;
+    });
+    for (auto const& [depth, parent] : relayouts)
+        parent->relayout();
+
+    auto pending = std::move(deferred_commits);
+    deferred_commits.clear();
+    for (auto const& container : pending)
+    {
+        if (auto const locked = container.lock())
+            locked->commit_changes();
+    }
+}
+
+bool CompositorState::defer_relayout(std::shared_ptr<ParentContainer> const& parent)
+{
+    if (batch_depth == 0)
+        return false;
+
+    auto it = std::find_if(deferred_relayouts.begin(), deferred_relayouts.end(), [&](auto const& element)
+    {
+        return !element.owner_before(parent) && !parent.owner_before(element);
+    });
+
+    if (it == deferred_relayouts.end())
+        deferred_relayouts.push_back(parent);
+    return true;
+}
+
+bool CompositorState::defer_commit(std::shared_ptr<Container> const& container)
+{
+    if (batch_depth == 0)
+        return false;
+
+    auto it = std::find_if(deferred_commits.begin(), deferred_commits.end(), [&](auto const& element)
+    {
+        return !element.owner_before(container) && !container.owner_before(element);
+    });
+
+    if (it == deferred_commits.end())
+        deferred_commits.push_back(container);
+    return true;
+}
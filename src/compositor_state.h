@@ -19,31 +19,47 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIRACLE_WM_COMPOSITOR_STATE_H
 
 #include "container.h"
+#include "frame_clock.h"
+#include "gpu_memory_budget.h"
+#include "mirror_groups.h"
+#include "quality_tier.h"
 #include "render_data_manager.h"
+#include "render_stats.h"
+#include "window_open_stats.h"
+#include "window_manager_mode.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <mir/geometry/point.h>
+#include <mir/geometry/rectangle.h>
+#include <list>
+#include <optional>
+#include <unordered_map>
 #include <vector>
 
 namespace miracle
 {
-enum class WindowManagerMode
-{
-    normal = 0,
-
-    /// While [resizing], only the window that was selected during
-    /// resize can be selected. If that window closes, resize
-    /// is completed.
-    resizing,
-
-    /// While [selecting], only [Container]s selected with the multi-select
-    /// keybind/mousebind can be selected or deselected.
-    selecting,
+class ParentContainer;
 
-    dragging,
-
-    moving
+/// Counts the window updates that were dropped by the [WindowController]
+/// because they matched what the window already had.
+struct WindowUpdateStats
+{
+    uint64_t rectangles_suppressed = 0;
+    uint64_t clips_suppressed = 0;
+    uint64_t states_suppressed = 0;
+    /// The modifications that were sent to windows, and those that were folded
+    /// into another modification of the same window instead of being sent.
+    uint64_t modifications_applied = 0;
+    uint64_t modifications_merged = 0;
+    /// The sizes that were sent to Xwayland windows, and those that were held
+    /// back until the window had answered the size before them.
+    uint64_t xwayland_sizes_sent = 0;
+    uint64_t xwayland_sizes_deferred = 0;
+    /// The times that a window was occluded or shown again. See [WindowController::set_occluded].
+    uint64_t occlusions_changed = 0;
 };
 
 class CompositorState
@@ -64,16 +80,151 @@ public:
     void remove(std::shared_ptr<Container> const& container);
     [[nodiscard]] std::shared_ptr<Container> first_floating() const;
     [[nodiscard]] std::shared_ptr<Container> first_tiling() const;
-    [[nodiscard]] std::vector<std::weak_ptr<Container>> const& containers() const { return focus_order; }
+
+    /// The containers from the most to the least recently focused.
+    [[nodiscard]] std::list<std::weak_ptr<Container>> const& containers() const { return focus_order; }
     WindowManagerMode mode() const;
     void mode(WindowManagerMode);
+
+    /// While dragging, the area that the dragged container will be moved to
+    /// once it is dropped.
+    [[nodiscard]] std::optional<mir::geometry::Rectangle> const& drag_preview() const;
+    void drag_preview(std::optional<mir::geometry::Rectangle> const&);
     RenderDataManager* render_data_manager() const;
+    RenderStatsManager* render_stats() const;
+    WindowOpenStats* window_open_stats() const;
+    GpuMemoryBudget* gpu_memory_budget() const;
+    MirrorGroups* mirror_groups() const;
+    std::shared_ptr<FrameClock> const& frame_clock() const;
+
+    /// While a batch is open, [LeafContainer]s hold on to their pending logical area
+    /// instead of applying it, so that each window is placed once per batch.
+    void begin_batch();
+
+    /// Closes the batch. Once the outermost batch is closed, every deferred
+    /// parent is laid out, and then every deferred container is committed.
+    void end_batch();
+
+    /// Returns true if a batch is open, in which case [container] will be
+    /// committed once the batch is closed.
+    bool defer_commit(std::shared_ptr<Container> const& container);
+
+    /// Returns true if a batch is open, in which case [parent] will be laid out
+    /// once the batch is closed, however many times it was changed in the batch.
+    bool defer_relayout(std::shared_ptr<ParentContainer> const& parent);
+
+    /// Records that the area or the arrangement of a window has changed, so that
+    /// anything derived from the layout knows to compute it again.
+    void layout_changed()
+    {
+        layout_generation_++;
+        scene_generation_++;
+    }
+
+    /// Increases with every call to [layout_changed].
+    [[nodiscard]] uint64_t layout_generation() const { return layout_generation_; }
+
+    /// Records that something which is part of the [SceneSnapshot] has changed, so
+    /// that a new one is published at the end of the transaction. Changes to the
+    /// layout, the focus and the mode are recorded without this.
+    void scene_changed() { scene_generation_++; }
+    [[nodiscard]] uint64_t scene_generation() const { return scene_generation_; }
+
+    /// While animations are suppressed, windows and workspaces are moved straight
+    /// to where they are going. Suppression nests, like batches. Animations are
+    /// always suppressed in the [QualityTier::reduced] tier.
+    void begin_suppressing_animations() { animation_suppression_depth++; }
+    void end_suppressing_animations() { animation_suppression_depth--; }
+    [[nodiscard]] bool animations_suppressed() const
+    {
+        return animation_suppression_depth > 0 || quality_tier() == QualityTier::reduced || is_session_locked();
+    }
+
+    /// Set while the session is locked, from the thread that locks it. Only the
+    /// lock screen is drawn in the meantime and nothing is animated.
+    void set_session_locked(bool locked) { is_session_locked_.store(locked, std::memory_order_relaxed); }
+    [[nodiscard]] bool is_session_locked() const { return is_session_locked_.load(std::memory_order_relaxed); }
+
+    /// The [QualityTier] that the renderers settled on. Set from the render threads.
+    void set_quality_tier(QualityTier tier) { quality_tier_.store(tier, std::memory_order_relaxed); }
+    [[nodiscard]] QualityTier quality_tier() const { return quality_tier_.load(std::memory_order_relaxed); }
+
+    /// Set before the server is stopped to have the compositor start itself again
+    /// once it has shut down.
+    void request_restart() { is_restart_requested_ = true; }
+    [[nodiscard]] bool is_restart_requested() const { return is_restart_requested_; }
+
+    WindowUpdateStats& window_update_stats() { return window_update_stats_; }
+    [[nodiscard]] WindowUpdateStats const& window_update_stats() const { return window_update_stats_; }
 
 private:
     std::weak_ptr<Container> focused;
-    std::vector<std::weak_ptr<Container>> focus_order;
+    std::list<std::weak_ptr<Container>> focus_order;
+
+    /// Finds the entry of each container in [focus_order] without a scan.
+    std::unordered_map<Container const*, std::list<std::weak_ptr<Container>>::iterator> focus_order_index;
     WindowManagerMode mode_ = WindowManagerMode::normal;
+    std::optional<mir::geometry::Rectangle> drag_preview_;
     std::unique_ptr<RenderDataManager> render_data_manager_;
+    std::unique_ptr<RenderStatsManager> render_stats_;
+    std::unique_ptr<WindowOpenStats> window_open_stats_;
+    std::unique_ptr<GpuMemoryBudget> gpu_memory_budget_;
+    std::unique_ptr<MirrorGroups> mirror_groups_;
+    std::shared_ptr<FrameClock> frame_clock_;
+    int batch_depth = 0;
+    std::vector<std::weak_ptr<Container>> deferred_commits;
+    std::vector<std::weak_ptr<ParentContainer>> deferred_relayouts;
+    uint64_t layout_generation_ = 0;
+    uint64_t scene_generation_ = 0;
+    int animation_suppression_depth = 0;
+    std::atomic<QualityTier> quality_tier_ = QualityTier::full;
+    std::atomic<bool> is_session_locked_ = false;
+    WindowUpdateStats window_update_stats_;
+    std::atomic<bool> is_restart_requested_ = false;
+};
+
+/// Opens a batch on [CompositorState] for as long as it is in scope.
+class CommitBatch
+{
+public:
+    explicit CommitBatch(CompositorState& state) :
+        state { state }
+    {
+        state.begin_batch();
+    }
+
+    CommitBatch(CommitBatch const&) = delete;
+    CommitBatch& operator=(CommitBatch const&) = delete;
+
+    ~CommitBatch()
+    {
+        state.end_batch();
+    }
+
+private:
+    CompositorState& state;
+};
+
+/// Suppresses animations on [CompositorState] for as long as it is in scope.
+class AnimationSuppression
+{
+public:
+    explicit AnimationSuppression(CompositorState& state) :
+        state { state }
+    {
+        state.begin_suppressing_animations();
+    }
+
+    AnimationSuppression(AnimationSuppression const&) = delete;
+    AnimationSuppression& operator=(AnimationSuppression const&) = delete;
+
+    ~AnimationSuppression()
+    {
+        state.end_suppressing_animations();
+    }
+
+private:
+    CompositorState& state;
 };
 }
 
@@ -18,19 +18,28 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIR_LOG_COMPONENT "config"
 
 #include "config.h"
+#include "easing.h"
+#include "metrics.h"
+#include "startup_profile.h"
 #include "yaml-cpp/node/node.h"
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <glib-2.0/glib.h>
 #include <glm/fwd.hpp>
+#include <iterator>
 #include <libevdev-1.0/libevdev/libevdev.h>
 #include <mir/log.h>
 #include <mir/options/option.h>
 #include <mir/server.h>
 #include <miral/runner.h>
 #include <sstream>
+#include <sys/eventfd.h>
 #include <sys/inotify.h>
+#include <tuple>
+#include <utility>
 
 using namespace miracle;
 
@@ -53,6 +62,29 @@ std::string create_default_configuration_path()
     return config_path_stream.str();
 }
 
+void create_config_file_if_missing(std::string const& config_path)
+{
+    if (!std::filesystem::exists(config_path))
+    {
+        if (!std::filesystem::exists(std::filesystem::path(config_path).parent_path()))
+        {
+            mir::log_info("Configuration directory path missing, creating it now");
+            std::filesystem::create_directories(std::filesystem::path(config_path).parent_path());
+        }
+        if (std::filesystem::exists(MIRACLE_DEFAULT_CONFIG_DIR))
+        {
+            mir::log_info("Configuration hierarchy being copied from %s", MIRACLE_DEFAULT_CONFIG_DIR);
+            const auto fs_copyopts = std::filesystem::copy_options::recursive;
+            std::filesystem::copy(MIRACLE_DEFAULT_CONFIG_DIR, std::filesystem::path(config_path).parent_path(), fs_copyopts);
+        }
+        else
+        {
+            mir::log_info("Configuration being written blank");
+            std::fstream file(config_path, std::ios::out | std::ios::in | std::ios::app);
+        }
+    }
+}
+
 std::optional<MirKeyboardAction> from_string_keyboard_action(std::string const& action)
 {
     if (action == "up")
@@ -69,6 +101,18 @@ std::optional<MirKeyboardAction> from_string_keyboard_action(std::string const&
 
 }
 
+std::optional<IpcOverflowPolicy> miracle::from_string_ipc_overflow_policy(std::string const& policy)
+{
+    if (policy == "disconnect")
+        return IpcOverflowPolicy::disconnect;
+    else if (policy == "drop_oldest")
+        return IpcOverflowPolicy::drop_oldest;
+    else if (policy == "coalesce")
+        return IpcOverflowPolicy::coalesce;
+    else
+        return std::nullopt;
+}
+
 uint Config::process_modifier(uint modifier) const
 {
     if (modifier & miracle_input_event_modifier_default)
@@ -82,10 +126,16 @@ FilesystemConfiguration::FilesystemConfiguration(miral::MirRunner& runner) :
 }
 
 FilesystemConfiguration::FilesystemConfiguration(
-    miral::MirRunner& runner, std::string const& path, bool load_immediately) :
+    miral::MirRunner& runner,
+    std::string const& path,
+    bool load_immediately,
+    std::optional<std::filesystem::path> const& cache_directory) :
     runner { runner },
-    default_config_path { path }
+    default_config_path { path },
+    cache { cache_directory ? std::make_unique<ConfigCache>(*cache_directory) : nullptr }
 {
+    compile_key_bindings(options);
+    publish_snapshot();
     if (load_immediately)
     {
         mir::log_info("FilesystemConfiguration: File is being loaded immediately on construction. "
@@ -97,6 +147,9 @@ FilesystemConfiguration::FilesystemConfiguration(
 
 void FilesystemConfiguration::load(mir::Server& server)
 {
+    if (!cache)
+        cache = std::make_unique<ConfigCache>(std::filesystem::path(g_get_user_cache_dir()) / "miracle-wm" / "config");
+
     const char* config_file_name_option = "config";
     server.add_configuration_option(
         config_file_name_option,
@@ -122,6 +175,15 @@ void FilesystemConfiguration::load(mir::Server& server)
         "If specified, this script will setup the systemd session before any apps are run",
         "");
 
+    // Reading and parsing the file does not need the server, so it is done while
+    // the platform is being brought up
+    server.add_pre_init_callback([this, config_file_name_option, no_config_option, &server]
+    {
+        auto const server_opts = server.get_options();
+        if (!server_opts->get<bool>(no_config_option))
+            prefetch(server_opts->get<std::string>(config_file_name_option));
+    });
+
     server.add_init_callback([this, config_file_name_option, no_config_option, exec_option, systemd_session_configure_option, &server]
     {
         auto const server_opts = server.get_options();
@@ -159,30 +221,15 @@ void FilesystemConfiguration::_init(std::optional<StartupApp> const& systemd_app
     else
     {
         mir::log_info("Configuration file path is: %s", config_path.c_str());
-        if (!std::filesystem::exists(config_path))
-        {
-
-            if (!std::filesystem::exists(std::filesystem::path(config_path).parent_path()))
-            {
-                mir::log_info("Configuration directory path missing, creating it now");
-                std::filesystem::create_directories(std::filesystem::path(config_path).parent_path());
-            }
-            if (std::filesystem::exists(MIRACLE_DEFAULT_CONFIG_DIR))
-            {
-                mir::log_info("Configuration hierarchy being copied from %s", MIRACLE_DEFAULT_CONFIG_DIR);
-                const auto fs_copyopts = std::filesystem::copy_options::recursive;
-                std::filesystem::copy(MIRACLE_DEFAULT_CONFIG_DIR, std::filesystem::path(config_path).parent_path(), fs_copyopts);
-            }
-            else
-            {
-                mir::log_info("Configuration being written blank");
-                std::fstream file(config_path, std::ios::out | std::ios::in | std::ios::app);
-            }
-        }
+        if (!prefetched.valid())
+            create_config_file_if_missing(config_path);
     }
 
     reload();
 
+    // Nobody is listening for the first load
+    pending_changes = ConfigSection::none;
+
     // If the user specified an --systemd-session-configure <APP_NAME>, let's add that to the list
     if (systemd_app)
     {
@@ -198,24 +245,171 @@ void FilesystemConfiguration::_init(std::optional<StartupApp> const& systemd_app
 
     is_loaded_ = true;
     _watch(runner);
+    StartupProfile::instance().mark("configuration loaded");
+}
+
+void FilesystemConfiguration::prefetch(std::string const& path)
+{
+    prefetched = std::async(std::launch::async, [path, cache = cache.get()]
+    {
+        PrefetchedFile result { .path = path };
+        create_config_file_if_missing(path);
+        if (cache)
+        {
+            std::ifstream file(path, std::ios::binary);
+            if (file)
+            {
+                result.contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+                result.cache_key = ConfigCache::key(path, result.contents);
+                if (cache->load(*result.cache_key))
+                    return result;
+            }
+        }
+
+        // A file that fails to parse is parsed again by [reload], which reports the error
+        try
+        {
+            result.yaml = result.cache_key ? YAML::Load(result.contents) : YAML::LoadFile(path);
+        }
+        catch (YAML::Exception const&)
+        {
+        }
+        return result;
+    });
 }
 
 void FilesystemConfiguration::reload()
 {
-    std::lock_guard<std::mutex> lock(mutex);
+    std::lock_guard<std::mutex> lock(reload_mutex);
+
+    // A reload that is in flight on another thread is overtaken by this one,
+    // which also reads any change that arrived while it was in flight
+    if (pending_parse.valid())
+    {
+        apply(pending_parse.get());
+        reload_again = false;
+    }
+    apply(parse());
+}
+
+void FilesystemConfiguration::reload_in_background()
+{
+    std::lock_guard<std::mutex> lock(reload_mutex);
+    if (pending_parse.valid())
+    {
+        // The file changed again while it was being read, so it is read once more
+        // after the current read has been applied
+        reload_again = true;
+        return;
+    }
+
+    pending_parse = std::async(std::launch::async, [this]
+    {
+        auto result = parse();
+        eventfd_write(parse_done_fd, 1);
+        return result;
+    });
+}
+
+void FilesystemConfiguration::on_parse_done()
+{
+    // The read is waited for if it has not finished yet, so this may also be
+    // called before the main loop is told that it is done
+    eventfd_t value;
+    eventfd_read(parse_done_fd, &value);
+
+    bool again;
+    {
+        std::lock_guard<std::mutex> lock(reload_mutex);
+
+        // A synchronous [reload] may have applied it already
+        if (!pending_parse.valid())
+            return;
 
-    // Reset all
-    options = ConfigDetails();
+        apply(pending_parse.get());
+        again = std::exchange(reload_again, false);
+    }
+
+    try_process_change();
+    if (again)
+        reload_in_background();
+}
+
+FilesystemConfiguration::ParsedConfig FilesystemConfiguration::parse()
+{
+    parsing = ConfigDetails();
+    ParsedConfig result;
 
     if (no_config)
     {
         mir::log_info("No configuration was specified, so the config will not load.");
-        return;
+        compile_key_bindings(parsing);
+        result.options = std::move(parsing);
+        return result;
     }
 
     // Load the new configuration
     mir::log_info("Configuration is loading...");
-    YAML::Node config = YAML::LoadFile(config_path);
+    Metrics::instance().increment(MetricCounter::config_reloads);
+    std::optional<ConfigCacheKey> cache_key;
+    std::string contents;
+    std::optional<YAML::Node> parsed;
+    if (prefetched.valid())
+    {
+        auto prefetch = prefetched.get();
+        if (prefetch.path == config_path)
+        {
+            contents = std::move(prefetch.contents);
+            cache_key = std::move(prefetch.cache_key);
+            parsed = std::move(prefetch.yaml);
+        }
+    }
+
+    if (cache && !cache_key)
+    {
+        std::ifstream file(config_path, std::ios::binary);
+        if (file)
+        {
+            contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            cache_key = ConfigCache::key(config_path, contents);
+        }
+    }
+
+    if (cache_key)
+    {
+        if (auto const entry = cache->load(*cache_key))
+        {
+            ConfigCacheReader reader(entry->data());
+            if (read_cache(reader))
+            {
+                mir::log_info("Configuration was unchanged, so it was loaded from the cache");
+                compile_key_bindings(parsing);
+                result.options = std::move(parsing);
+                return result;
+            }
+
+            mir::log_warning("The configuration cache could not be read, parsing the file instead");
+            parsing = ConfigDetails();
+        }
+    }
+
+    YAML::Node config;
+    try
+    {
+        config = parsed ? *parsed : cache_key ? YAML::Load(contents) : YAML::LoadFile(config_path);
+    }
+    catch (YAML::Exception const& e)
+    {
+        error_handler.add_error({ e.mark.line,
+            e.mark.column,
+            ConfigurationInfo::Level::error,
+            config_path,
+            e.msg });
+        compile_key_bindings(parsing);
+        result.options = std::move(parsing);
+        return result;
+    }
+
     if (config["action_key"])
         read_action_key(config["action_key"]);
     if (config["default_action_overrides"])
@@ -228,6 +422,8 @@ void FilesystemConfiguration::reload()
         read_outer_gaps(config["outer_gaps"]);
     if (config["startup_apps"])
         read_startup_apps(config["startup_apps"]);
+    if (config["startup"])
+        read_startup(config["startup"]);
     if (config["terminal"])
         read_terminal(config["terminal"]);
     if (config["resize_jump"])
@@ -246,10 +442,412 @@ void FilesystemConfiguration::reload()
         read_move_modifier(config["move_modifier"]);
     if (config["drag_and_drop"])
         read_drag_and_drop(config["drag_and_drop"]);
+    if (config["ipc"])
+        read_ipc(config["ipc"]);
+    if (config["scheduling"])
+        read_scheduling(config["scheduling"]);
+    if (config["color_filter"])
+        read_color_filter(config["color_filter"]);
+    if (config["quality_tier"])
+        read_quality_tier(config["quality_tier"]);
+    if (config["blur"])
+        read_blur(config["blur"]);
+    if (config["gpu_memory_budget_mb"])
+        read_gpu_memory_budget(config["gpu_memory_budget_mb"]);
+    if (config["frame_rate_caps"])
+        read_frame_rate_caps(config["frame_rate_caps"]);
+
+    compile_key_bindings(parsing);
+    result.options = std::move(parsing);
+    result.cache_key = std::move(cache_key);
+    return result;
+}
+
+void FilesystemConfiguration::apply(ParsedConfig parsed)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // A file with errors is only loaded when there is no working configuration
+    // to keep instead
+    if (is_loaded_ && error_handler.has_errors())
+    {
+        mir::log_warning("The configuration has errors, so the previous configuration is kept");
+        error_handler.on_complete();
+        return;
+    }
+
+    auto const previous = std::exchange(options, std::move(parsed.options));
+    publish_snapshot();
+    pending_changes |= diff(previous, options);
+
+    // Only a configuration without any errors is cached, so that the errors
+    // are reported again on the next start
+    if (parsed.cache_key && !error_handler.has_errors())
+    {
+        ConfigCacheWriter writer;
+        write_cache(writer);
+        cache->store(*parsed.cache_key, writer.data());
+    }
 
     error_handler.on_complete();
 }
 
+void FilesystemConfiguration::write_cache(ConfigCacheWriter& writer) const
+{
+    // [read_cache] must read these back in exactly the same order
+    writer.write(options.primary_modifier);
+    writer.write(static_cast<uint32_t>(options.custom_key_commands.size()));
+    for (auto const& command : options.custom_key_commands)
+    {
+        writer.write(command.action);
+        writer.write(command.modifiers);
+        writer.write(command.key);
+        writer.write(command.command);
+    }
+
+    for (auto const& list : options.key_commands)
+    {
+        writer.write(static_cast<uint32_t>(list.size()));
+        for (auto const& command : list)
+        {
+            writer.write(command.action);
+            writer.write(command.modifiers);
+            writer.write(command.key);
+        }
+    }
+
+    writer.write(options.inner_gaps_x);
+    writer.write(options.inner_gaps_y);
+    writer.write(options.outer_gaps_x);
+    writer.write(options.outer_gaps_y);
+
+    writer.write(static_cast<uint32_t>(options.startup_apps.size()));
+    for (auto const& app : options.startup_apps)
+    {
+        writer.write(app.command);
+        writer.write(app.restart_on_death);
+        writer.write(app.no_startup_id);
+        writer.write(app.should_halt_compositor_on_death);
+        writer.write(app.in_systemd_scope);
+        writer.write(app.priority);
+        writer.write(app.after_previous);
+    }
+    writer.write(options.startup.concurrency);
+    writer.write(static_cast<int64_t>(options.startup.app_timeout.count()));
+
+    writer.write(options.terminal.has_value());
+    writer.write(options.terminal.value_or(""));
+    writer.write(options.resize_jump);
+
+    writer.write(static_cast<uint32_t>(options.environment_variables.size()));
+    for (auto const& variable : options.environment_variables)
+    {
+        writer.write(variable.key);
+        writer.write(variable.value);
+    }
+
+    writer.write(options.border_config.size);
+    writer.write(options.border_config.focus_color);
+    writer.write(options.border_config.color);
+
+    writer.write(options.animations_enabled);
+    for (auto const& definition : options.animation_definitions)
+    {
+        writer.write(definition.type);
+        writer.write(definition.function);
+        writer.write(definition.duration_seconds);
+        writer.write(definition.compositor_only);
+        writer.write(definition.c1);
+        writer.write(definition.c2);
+        writer.write(definition.c3);
+        writer.write(definition.c4);
+        writer.write(definition.c5);
+        writer.write(definition.n1);
+        writer.write(definition.d1);
+    }
+
+    writer.write(static_cast<uint32_t>(options.workspace_configs.size()));
+    for (auto const& workspace : options.workspace_configs)
+    {
+        writer.write(workspace.num);
+        writer.write(workspace.layout);
+        writer.write(workspace.name.has_value());
+        writer.write(workspace.name.value_or(""));
+    }
+
+    writer.write(options.move_modifier);
+    writer.write(options.drag_and_drop.enabled);
+    writer.write(options.drag_and_drop.modifiers);
+
+    writer.write(options.ipc.max_client_queue_bytes);
+    writer.write(static_cast<uint32_t>(options.ipc.overflow_policies.size()));
+    for (auto const& [name, policy] : options.ipc.overflow_policies)
+    {
+        writer.write(name);
+        writer.write(policy);
+    }
+    writer.write(options.ipc.metrics_socket);
+    writer.write(options.ipc.listen_backlog);
+
+    for (auto const* thread : { &options.scheduling.animator, &options.scheduling.render })
+    {
+        writer.write(thread->realtime);
+        writer.write(thread->realtime_priority);
+        writer.write(thread->nice);
+        writer.write(static_cast<uint32_t>(thread->cpus.size()));
+        for (auto const cpu : thread->cpus)
+            writer.write(cpu);
+    }
+    writer.write(options.color_filter);
+    writer.write(options.quality_tier);
+    writer.write(options.blur.enabled);
+    writer.write(options.blur.passes);
+    writer.write(options.blur.offset);
+    writer.write(options.gpu_memory_budget_mb);
+    writer.write(options.frame_rate_caps.unfocused);
+    writer.write(options.frame_rate_caps.static_content);
+}
+
+bool FilesystemConfiguration::read_cache(ConfigCacheReader& reader)
+{
+    parsing.primary_modifier = reader.read<uint>();
+    auto const custom_key_command_count = reader.read<uint32_t>();
+    for (uint32_t i = 0; i < custom_key_command_count && reader.ok(); i++)
+    {
+        CustomKeyCommand command;
+        command.action = reader.read<MirKeyboardAction>();
+        command.modifiers = reader.read<uint>();
+        command.key = reader.read<int>();
+        command.command = reader.read_string();
+        parsing.custom_key_commands.push_back(std::move(command));
+    }
+
+    // Unlike the file, the cache holds the defaults too, so they are replaced
+    for (auto& list : parsing.key_commands)
+    {
+        list.clear();
+        auto const count = reader.read<uint32_t>();
+        for (uint32_t i = 0; i < count && reader.ok(); i++)
+        {
+            KeyCommand command;
+            command.action = reader.read<MirKeyboardAction>();
+            command.modifiers = reader.read<uint>();
+            command.key = reader.read<int>();
+            list.push_back(command);
+        }
+    }
+
+    parsing.inner_gaps_x = reader.read<int>();
+    parsing.inner_gaps_y = reader.read<int>();
+    parsing.outer_gaps_x = reader.read<int>();
+    parsing.outer_gaps_y = reader.read<int>();
+
+    auto const startup_app_count = reader.read<uint32_t>();
+    for (uint32_t i = 0; i < startup_app_count && reader.ok(); i++)
+    {
+        StartupApp app;
+        app.command = reader.read_string();
+        app.restart_on_death = reader.read<bool>();
+        app.no_startup_id = reader.read<bool>();
+        app.should_halt_compositor_on_death = reader.read<bool>();
+        app.in_systemd_scope = reader.read<bool>();
+        app.priority = reader.read<int>();
+        app.after_previous = reader.read<bool>();
+        parsing.startup_apps.push_back(std::move(app));
+    }
+    parsing.startup.concurrency = reader.read<int>();
+    parsing.startup.app_timeout = std::chrono::milliseconds(reader.read<int64_t>());
+
+    auto const has_terminal = reader.read<bool>();
+    auto terminal = reader.read_string();
+    parsing.terminal = has_terminal ? std::optional(std::move(terminal)) : std::nullopt;
+    parsing.resize_jump = reader.read<int>();
+
+    auto const environment_variable_count = reader.read<uint32_t>();
+    for (uint32_t i = 0; i < environment_variable_count && reader.ok(); i++)
+    {
+        EnvironmentVariable variable;
+        variable.key = reader.read_string();
+        variable.value = reader.read_string();
+        parsing.environment_variables.push_back(std::move(variable));
+    }
+
+    parsing.border_config.size = reader.read<int>();
+    parsing.border_config.focus_color = reader.read<glm::vec4>();
+    parsing.border_config.color = reader.read<glm::vec4>();
+
+    parsing.animations_enabled = reader.read<bool>();
+    for (auto& definition : parsing.animation_definitions)
+    {
+        definition.type = reader.read<AnimationType>();
+        definition.function = reader.read<EaseFunction>();
+        definition.duration_seconds = reader.read<float>();
+        definition.compositor_only = reader.read<bool>();
+        definition.c1 = reader.read<float>();
+        definition.c2 = reader.read<float>();
+        definition.c3 = reader.read<float>();
+        definition.c4 = reader.read<float>();
+        definition.c5 = reader.read<float>();
+        definition.n1 = reader.read<float>();
+        definition.d1 = reader.read<float>();
+        compile_ease_table(definition);
+    }
+
+    auto const workspace_count = reader.read<uint32_t>();
+    for (uint32_t i = 0; i < workspace_count && reader.ok(); i++)
+    {
+        WorkspaceConfig workspace;
+        workspace.num = reader.read<std::optional<int>>();
+        workspace.layout = reader.read<std::optional<ContainerType>>();
+        auto const has_name = reader.read<bool>();
+        auto name = reader.read_string();
+        if (has_name)
+            workspace.name = std::move(name);
+        parsing.workspace_configs.push_back(std::move(workspace));
+    }
+
+    parsing.move_modifier = reader.read<uint>();
+    parsing.drag_and_drop.enabled = reader.read<bool>();
+    parsing.drag_and_drop.modifiers = reader.read<uint>();
+
+    parsing.ipc.max_client_queue_bytes = reader.read<size_t>();
+    auto const overflow_policy_count = reader.read<uint32_t>();
+    for (uint32_t i = 0; i < overflow_policy_count && reader.ok(); i++)
+    {
+        auto name = reader.read_string();
+        parsing.ipc.overflow_policies[std::move(name)] = reader.read<IpcOverflowPolicy>();
+    }
+    parsing.ipc.metrics_socket = reader.read_string();
+    parsing.ipc.listen_backlog = reader.read<int>();
+
+    for (auto* thread : { &parsing.scheduling.animator, &parsing.scheduling.render })
+    {
+        thread->realtime = reader.read<bool>();
+        thread->realtime_priority = reader.read<int>();
+        thread->nice = reader.read<std::optional<int>>();
+        auto const cpu_count = reader.read<uint32_t>();
+        for (uint32_t i = 0; i < cpu_count && reader.ok(); i++)
+            thread->cpus.push_back(reader.read<int>());
+    }
+    parsing.color_filter = reader.read<RenderFilter>();
+    parsing.quality_tier = reader.read<std::optional<QualityTier>>();
+    parsing.blur.enabled = reader.read<bool>();
+    parsing.blur.passes = reader.read<int>();
+    parsing.blur.offset = reader.read<float>();
+    parsing.gpu_memory_budget_mb = reader.read<int>();
+    parsing.frame_rate_caps.unfocused = reader.read<int>();
+    parsing.frame_rate_caps.static_content = reader.read<int>();
+
+    return reader.ok() && reader.at_end();
+}
+
+void FilesystemConfiguration::publish_snapshot()
+{
+    published_snapshot.store(std::make_shared<ConfigSnapshot const>(ConfigSnapshot {
+        .inner_gaps_x = options.inner_gaps_x,
+        .inner_gaps_y = options.inner_gaps_y,
+        .outer_gaps_x = options.outer_gaps_x,
+        .outer_gaps_y = options.outer_gaps_y,
+        .half_inner_gaps_x = static_cast<int>(std::ceil(options.inner_gaps_x / 2.0)),
+        .half_inner_gaps_y = static_cast<int>(std::ceil(options.inner_gaps_y / 2.0)),
+        .border_config = options.border_config,
+        .animations_enabled = options.animations_enabled,
+        .animation_definitions = options.animation_definitions,
+        .color_filter = options.color_filter,
+        .quality_tier = options.quality_tier,
+        .blur = options.blur,
+        .gpu_memory_budget_bytes = static_cast<size_t>(options.gpu_memory_budget_mb) * 1024 * 1024,
+        .frame_rate_caps = options.frame_rate_caps }));
+}
+
+std::shared_ptr<ConfigSnapshot const> FilesystemConfiguration::snapshot() const
+{
+    return published_snapshot.load();
+}
+
+ConfigSection FilesystemConfiguration::diff(ConfigDetails const& before, ConfigDetails const& after)
+{
+    // The ease tables are rebuilt on every load, so only the parameters that
+    // they are built from are compared
+    auto const same_animation = [](AnimationDefinition const& left, AnimationDefinition const& right)
+    {
+        auto const fields = [](AnimationDefinition const& definition)
+        {
+            return std::tie(
+                definition.type, definition.function, definition.duration_seconds, definition.compositor_only,
+                definition.c1, definition.c2, definition.c3, definition.c4, definition.c5, definition.n1, definition.d1);
+        };
+        return fields(left) == fields(right);
+    };
+
+    ConfigSection result = ConfigSection::none;
+    if (before.primary_modifier != after.primary_modifier
+        || before.custom_key_commands != after.custom_key_commands
+        || !std::equal(std::begin(before.key_commands), std::end(before.key_commands), std::begin(after.key_commands)))
+        result |= ConfigSection::key_bindings;
+    if (before.inner_gaps_x != after.inner_gaps_x
+        || before.inner_gaps_y != after.inner_gaps_y
+        || before.outer_gaps_x != after.outer_gaps_x
+        || before.outer_gaps_y != after.outer_gaps_y)
+        result |= ConfigSection::gaps;
+    if (before.startup_apps != after.startup_apps || before.startup != after.startup)
+        result |= ConfigSection::startup_apps;
+    if (before.terminal != after.terminal)
+        result |= ConfigSection::terminal;
+    if (before.resize_jump != after.resize_jump)
+        result |= ConfigSection::resize_jump;
+    if (before.environment_variables != after.environment_variables)
+        result |= ConfigSection::environment_variables;
+    if (before.border_config != after.border_config)
+        result |= ConfigSection::border;
+    if (before.animations_enabled != after.animations_enabled
+        || !std::equal(
+            before.animation_definitions.begin(), before.animation_definitions.end(),
+            after.animation_definitions.begin(), same_animation))
+        result |= ConfigSection::animations;
+    if (before.workspace_configs != after.workspace_configs)
+        result |= ConfigSection::workspaces;
+    if (before.move_modifier != after.move_modifier)
+        result |= ConfigSection::move_modifier;
+    if (before.drag_and_drop != after.drag_and_drop)
+        result |= ConfigSection::drag_and_drop;
+    if (before.ipc != after.ipc)
+        result |= ConfigSection::ipc;
+    return result;
+}
+
+void FilesystemConfiguration::compile_key_bindings(ConfigDetails& details)
+{
+    // The modifiers of a binding depend on the action key, so this must run
+    // after the whole file has been read. [process_modifier] is not used, as it
+    // reads the live action key rather than that of [details].
+    auto const process = [&](uint modifier)
+    {
+        if (modifier & miracle_input_event_modifier_default)
+            modifier = modifier & ~miracle_input_event_modifier_default | details.primary_modifier;
+        return modifier;
+    };
+
+    details.key_bindings.clear();
+    for (size_t i = 0; i < details.custom_key_commands.size(); i++)
+    {
+        auto const& command = details.custom_key_commands[i];
+        auto& bound = details.key_bindings[{ command.action, command.key, process(command.modifiers) }];
+        if (!bound.custom_key_command)
+            bound.custom_key_command = i;
+    }
+
+    for (int i = 0; i < static_cast<int>(DefaultKeyCommand::MAX); i++)
+    {
+        for (auto const& command : details.key_commands[i])
+        {
+            auto& bound = details.key_bindings[{ command.action, command.key, process(command.modifiers) }];
+            if (bound.default_key_commands.empty() || bound.default_key_commands.back() != static_cast<DefaultKeyCommand>(i))
+                bound.default_key_commands.push_back(static_cast<DefaultKeyCommand>(i));
+        }
+    }
+}
+
 /// Helper method for quickly creating and reporting an error
 void FilesystemConfiguration::add_error(YAML::Node const& node)
 {
@@ -264,7 +862,7 @@ void FilesystemConfiguration::add_error(YAML::Node const& node)
 void FilesystemConfiguration::read_action_key(YAML::Node const& node)
 {
     if (auto modifier = try_parse_string_to_optional_value<std::optional<uint>>(node, try_parse_modifier))
-        options.primary_modifier = modifier.value();
+        parsing.primary_modifier = modifier.value();
 }
 
 void FilesystemConfiguration::read_custom_actions(YAML::Node const& custom_actions)
@@ -309,7 +907,7 @@ void FilesystemConfiguration::read_custom_actions(YAML::Node const& custom_actio
         if (!try_parse_modifiers(modifiers_node, modifiers))
             continue;
 
-        options.custom_key_commands.push_back({ keyboard_action.value(),
+        parsing.custom_key_commands.push_back({ keyboard_action.value(),
             modifiers,
             code,
             command });
@@ -318,17 +916,17 @@ void FilesystemConfiguration::read_custom_actions(YAML::Node const& custom_actio
 
 void FilesystemConfiguration::read_inner_gaps(YAML::Node const& node)
 {
-    if (!try_parse_value(node, "x", options.inner_gaps_x))
+    if (!try_parse_value(node, "x", parsing.inner_gaps_x))
         return;
-    if (!try_parse_value(node, "y", options.inner_gaps_y))
+    if (!try_parse_value(node, "y", parsing.inner_gaps_y))
         return;
 }
 
 void FilesystemConfiguration::read_outer_gaps(YAML::Node const& node)
 {
-    if (!try_parse_value(node, "x", options.outer_gaps_x))
+    if (!try_parse_value(node, "x", parsing.outer_gaps_x))
         return;
-    if (!try_parse_value(node, "y", options.outer_gaps_y))
+    if (!try_parse_value(node, "y", parsing.outer_gaps_y))
         return;
 }
 
@@ -361,9 +959,52 @@ void FilesystemConfiguration::read_startup_apps(YAML::Node const& startup_apps)
                 continue;
         }
 
-        options.startup_apps.push_back({ .command = std::move(command),
+        int priority = 0;
+        if (node["priority"])
+        {
+            if (!try_parse_value(node, "priority", priority))
+                continue;
+        }
+
+        bool after_previous = false;
+        if (node["after_previous"])
+        {
+            if (!try_parse_value(node, "after_previous", after_previous))
+                continue;
+        }
+
+        parsing.startup_apps.push_back({ .command = std::move(command),
             .restart_on_death = restart_on_death,
-            .in_systemd_scope = in_systemd_scope });
+            .in_systemd_scope = in_systemd_scope,
+            .priority = priority,
+            .after_previous = after_previous });
+    }
+}
+
+void FilesystemConfiguration::read_startup(YAML::Node const& node)
+{
+    int concurrency;
+    if (try_parse_value(node, "concurrency", concurrency, true))
+    {
+        if (concurrency < 0)
+        {
+            builder << "startup.concurrency must not be negative";
+            add_error(node["concurrency"]);
+        }
+        else
+            parsing.startup.concurrency = concurrency;
+    }
+
+    int app_timeout_ms;
+    if (try_parse_value(node, "app_timeout_ms", app_timeout_ms, true))
+    {
+        if (app_timeout_ms < 1)
+        {
+            builder << "startup.app_timeout_ms must be at least 1";
+            add_error(node["app_timeout_ms"]);
+        }
+        else
+            parsing.startup.app_timeout = std::chrono::milliseconds(app_timeout_ms);
     }
 }
 
@@ -380,12 +1021,12 @@ void FilesystemConfiguration::read_terminal(YAML::Node const& node)
         return;
     }
 
-    options.terminal = desired_terminal;
+    parsing.terminal = desired_terminal;
 }
 
 void FilesystemConfiguration::read_resize_jump(YAML::Node const& node)
 {
-    try_parse_value(node, options.resize_jump);
+    try_parse_value(node, parsing.resize_jump);
 }
 
 void FilesystemConfiguration::read_environment_variables(YAML::Node const& env)
@@ -404,7 +1045,7 @@ void FilesystemConfiguration::read_environment_variables(YAML::Node const& env)
             continue;
         if (!try_parse_value(node, "value", value))
             continue;
-        options.environment_variables.push_back({ key, value });
+        parsing.environment_variables.push_back({ key, value });
     }
 }
 
@@ -529,7 +1170,7 @@ void FilesystemConfiguration::read_border(YAML::Node const& border)
     if (!try_parse_color(border, "focus_color", focus_color))
         return;
 
-    options.border_config = { size, focus_color, color };
+    parsing.border_config = { size, focus_color, color };
 }
 
 void FilesystemConfiguration::read_workspaces(YAML::Node const& workspaces)
@@ -559,7 +1200,7 @@ void FilesystemConfiguration::read_workspaces(YAML::Node const& workspaces)
         if (!try_parse_value(workspace, "name", name, true))
             continue;
 
-        options.workspace_configs.push_back({ num,
+        parsing.workspace_configs.push_back({ num,
             type,
             name.empty() ? std::optional<std::string>(std::nullopt) : name });
     }
@@ -700,7 +1341,7 @@ void FilesystemConfiguration::read_default_action_overrides(YAML::Node const& de
         if (!try_parse_modifiers(modifiers_node, modifiers))
             continue;
 
-        options.key_commands[static_cast<int>(key_command)].push_back({ keyboard_action.value(),
+        parsing.key_commands[static_cast<int>(key_command)].push_back({ keyboard_action.value(),
             modifiers,
             code });
     }
@@ -739,38 +1380,201 @@ void FilesystemConfiguration::read_animation_definitions(YAML::Node const& anima
             continue;
 
         int const event_as_int = static_cast<int>(event.value());
-        options.animation_definitions[event_as_int].type = type.value();
-        options.animation_definitions[event_as_int].function = function.value();
-        try_parse_value(node, "duration", options.animation_definitions[event_as_int].duration_seconds, true);
-        try_parse_value(node, "c1", options.animation_definitions[event_as_int].c1, true);
-        try_parse_value(node, "c2", options.animation_definitions[event_as_int].c2, true);
-        try_parse_value(node, "c3", options.animation_definitions[event_as_int].c3, true);
-        try_parse_value(node, "c4", options.animation_definitions[event_as_int].c4, true);
-        try_parse_value(node, "n1", options.animation_definitions[event_as_int].n1, true);
-        try_parse_value(node, "d1", options.animation_definitions[event_as_int].d1, true);
+        parsing.animation_definitions[event_as_int].type = type.value();
+        parsing.animation_definitions[event_as_int].function = function.value();
+        try_parse_value(node, "duration", parsing.animation_definitions[event_as_int].duration_seconds, true);
+        try_parse_value(node, "compositor_only", parsing.animation_definitions[event_as_int].compositor_only, true);
+        try_parse_value(node, "c1", parsing.animation_definitions[event_as_int].c1, true);
+        try_parse_value(node, "c2", parsing.animation_definitions[event_as_int].c2, true);
+        try_parse_value(node, "c3", parsing.animation_definitions[event_as_int].c3, true);
+        try_parse_value(node, "c4", parsing.animation_definitions[event_as_int].c4, true);
+        try_parse_value(node, "n1", parsing.animation_definitions[event_as_int].n1, true);
+        try_parse_value(node, "d1", parsing.animation_definitions[event_as_int].d1, true);
     }
+
+    for (auto& definition : parsing.animation_definitions)
+        compile_ease_table(definition);
 }
 
 void FilesystemConfiguration::read_enable_animations(YAML::Node const& node)
 {
-    try_parse_value(node, options.animations_enabled);
+    try_parse_value(node, parsing.animations_enabled);
 }
 
 void FilesystemConfiguration::read_move_modifier(YAML::Node const& node)
 {
-    try_parse_modifiers(node, options.move_modifier);
+    try_parse_modifiers(node, parsing.move_modifier);
 }
 
 void FilesystemConfiguration::read_drag_and_drop(YAML::Node const& node)
 {
-    try_parse_value(node, "enabled", options.drag_and_drop.enabled, true);
+    try_parse_value(node, "enabled", parsing.drag_and_drop.enabled, true);
     uint modifiers = 0;
     if (node["modifiers"])
     {
         if (!try_parse_modifiers(node["modifiers"], modifiers))
             return;
 
-        options.drag_and_drop.modifiers = modifiers;
+        parsing.drag_and_drop.modifiers = modifiers;
+    }
+}
+
+void FilesystemConfiguration::read_ipc(YAML::Node const& node)
+{
+    try_parse_value(node, "max_client_queue_bytes", parsing.ipc.max_client_queue_bytes, true);
+    try_parse_value(node, "metrics_socket", parsing.ipc.metrics_socket, true);
+
+    int listen_backlog;
+    if (try_parse_value(node, "listen_backlog", listen_backlog, true))
+    {
+        if (listen_backlog < 1)
+        {
+            builder << "ipc.listen_backlog must be at least 1";
+            add_error(node["listen_backlog"]);
+        }
+        else
+            parsing.ipc.listen_backlog = listen_backlog;
+    }
+
+    auto const& overflow = node["overflow"];
+    if (!overflow)
+        return;
+
+    if (!overflow.IsMap())
+    {
+        builder << "ipc.overflow must be a map of event types to policies";
+        add_error(overflow);
+        return;
+    }
+
+    for (auto const& entry : overflow)
+    {
+        std::string event_type;
+        if (!try_parse_value(entry.first, event_type))
+            continue;
+
+        if (auto const policy = try_parse_string_to_optional_value<std::optional<IpcOverflowPolicy>>(
+                entry.second, from_string_ipc_overflow_policy))
+            parsing.ipc.overflow_policies[event_type] = policy.value();
+    }
+}
+
+void FilesystemConfiguration::read_scheduling(YAML::Node const& node)
+{
+    if (node["animator"])
+        read_thread_scheduling(node["animator"], parsing.scheduling.animator);
+    if (node["render"])
+        read_thread_scheduling(node["render"], parsing.scheduling.render);
+}
+
+void FilesystemConfiguration::read_color_filter(YAML::Node const& node)
+{
+    if (auto const filter = try_parse_string_to_optional_value<std::optional<RenderFilter>>(
+            node, from_string_render_filter))
+        parsing.color_filter = filter.value();
+}
+
+void FilesystemConfiguration::read_quality_tier(YAML::Node const& node)
+{
+    // "auto" leaves the tier to be detected from the GPU
+    if (node.IsScalar() && node.as<std::string>() == "auto")
+        return;
+
+    if (auto const tier = try_parse_string_to_optional_value<std::optional<QualityTier>>(
+            node, from_string_quality_tier))
+        parsing.quality_tier = tier.value();
+}
+
+void FilesystemConfiguration::read_blur(YAML::Node const& node)
+{
+    try_parse_value(node, "enabled", parsing.blur.enabled, true);
+
+    int passes;
+    if (try_parse_value(node, "passes", passes, true))
+    {
+        if (passes < 1 || passes > max_blur_passes)
+        {
+            builder << "blur.passes must be between 1 and " << max_blur_passes;
+            add_error(node["passes"]);
+        }
+        else
+            parsing.blur.passes = passes;
+    }
+
+    float offset;
+    if (try_parse_value(node, "offset", offset, true))
+    {
+        if (offset <= 0)
+        {
+            builder << "blur.offset must be greater than 0";
+            add_error(node["offset"]);
+        }
+        else
+            parsing.blur.offset = offset;
+    }
+}
+
+void FilesystemConfiguration::read_gpu_memory_budget(YAML::Node const& node)
+{
+    int budget;
+    if (!try_parse_value(node, budget))
+        return;
+
+    if (budget < 1)
+    {
+        builder << "gpu_memory_budget_mb must be at least 1";
+        add_error(node);
+        return;
+    }
+
+    parsing.gpu_memory_budget_mb = budget;
+}
+
+void FilesystemConfiguration::read_frame_rate_caps(YAML::Node const& node)
+{
+    for (auto const& [key, cap] : {
+             std::pair { "unfocused", &parsing.frame_rate_caps.unfocused },
+             std::pair { "static", &parsing.frame_rate_caps.static_content } })
+    {
+        int fps;
+        if (!try_parse_value(node, key, fps, true))
+            continue;
+
+        if (fps < 0)
+        {
+            builder << "frame_rate_caps." << key << " must be at least 0";
+            add_error(node[key]);
+        }
+        else
+            *cap = fps;
+    }
+}
+
+void FilesystemConfiguration::read_thread_scheduling(YAML::Node const& node, ThreadSchedulingConfiguration& thread)
+{
+    try_parse_value(node, "realtime", thread.realtime, true);
+    try_parse_value(node, "priority", thread.realtime_priority, true);
+
+    int nice;
+    if (node["nice"] && try_parse_value(node, "nice", nice))
+        thread.nice = nice;
+
+    auto const& cpus = node["cpus"];
+    if (!cpus)
+        return;
+
+    if (!cpus.IsSequence())
+    {
+        builder << "Expected cpus to be an array of CPU numbers";
+        add_error(cpus);
+        return;
+    }
+
+    for (auto const& cpu_node : cpus)
+    {
+        int cpu;
+        if (try_parse_value(cpu_node, cpu))
+            thread.cpus.push_back(cpu);
     }
 }
 
@@ -798,24 +1602,30 @@ void FilesystemConfiguration::_watch(miral::MirRunner& runner)
         if (read(inotify_fd, &inotify_buffer, sizeof(inotify_buffer)) < static_cast<ssize_t>(sizeof(inotify_event)))
             return;
 
+        // The file is read and checked on another thread. Once that is done, the
+        // listeners are notified right here on the main loop, rather than waiting
+        // for the next input event to pick the change up.
         if (inotify_buffer.event.mask & (IN_MODIFY))
-        {
-            reload();
-            has_changes = true;
-        }
+            reload_in_background();
     });
+
+    parse_done_fd = mir::Fd { eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK) };
+    parse_done_handle = runner.register_fd_handler(parse_done_fd, [this](int)
+    { on_parse_done(); });
 }
 
 void FilesystemConfiguration::try_process_change()
 {
     std::lock_guard<std::mutex> lock(mutex);
-    if (!has_changes)
+    if (pending_changes == ConfigSection::none)
         return;
 
-    has_changes = false;
+    auto const changes = pending_changes;
+    pending_changes = ConfigSection::none;
     for (auto const& on_change : on_change_listeners)
     {
-        on_change.listener(*this);
+        if ((on_change.sections & changes) != ConfigSection::none)
+            on_change.listener(*this);
     }
 }
 
@@ -876,45 +1686,31 @@ MirInputEventModifier FilesystemConfiguration::get_input_event_modifier() const
     return static_cast<MirInputEventModifier>(options.primary_modifier);
 }
 
+KeyMatch FilesystemConfiguration::match_key(MirKeyboardAction action, int scan_code, unsigned int modifiers) const
+{
+    auto const it = options.key_bindings.find({ action, scan_code, modifiers });
+    if (it == options.key_bindings.end())
+        return {};
+
+    auto const& bound = it->second;
+    return {
+        bound.custom_key_command ? &options.custom_key_commands[*bound.custom_key_command] : nullptr,
+        bound.default_key_commands
+    };
+}
+
 CustomKeyCommand const*
 FilesystemConfiguration::matches_custom_key_command(MirKeyboardAction action, int scan_code, unsigned int modifiers) const
 {
-    // TODO: Copy & paste
-    for (auto const& command : options.custom_key_commands)
-    {
-        if (action != command.action)
-            continue;
-
-        auto command_modifiers = process_modifier(command.modifiers);
-        if (command_modifiers != modifiers)
-            continue;
-
-        if (scan_code == command.key)
-            return &command;
-    }
-
-    return nullptr;
+    return match_key(action, scan_code, modifiers).custom_key_command;
 }
 
 bool FilesystemConfiguration::matches_key_command(MirKeyboardAction action, int scan_code, unsigned int modifiers, std::function<bool(DefaultKeyCommand)> const& f) const
 {
-    for (int i = 0; i < static_cast<int>(DefaultKeyCommand::MAX); i++)
+    for (auto const command : match_key(action, scan_code, modifiers).default_key_commands)
     {
-        for (auto command : options.key_commands[i])
-        {
-            if (action != command.action)
-                continue;
-
-            auto command_modifiers = process_modifier(command.modifiers);
-            if (command_modifiers != modifiers)
-                continue;
-
-            if (scan_code == command.key)
-            {
-                if (f(static_cast<DefaultKeyCommand>(i)))
-                    return true;
-            }
-        }
+        if (f(command))
+            return true;
     }
 
     return false;
@@ -945,12 +1741,23 @@ const std::vector<StartupApp>& FilesystemConfiguration::get_startup_apps() const
     return options.startup_apps;
 }
 
+StartupConfiguration FilesystemConfiguration::startup() const
+{
+    return options.startup;
+}
+
 int FilesystemConfiguration::register_listener(std::function<void(miracle::Config&)> const& func)
 {
     return register_listener(func, 5);
 }
 
 int FilesystemConfiguration::register_listener(std::function<void(miracle::Config&)> const& func, int priority)
+{
+    return register_listener(func, ConfigSection::all, priority);
+}
+
+int FilesystemConfiguration::register_listener(
+    std::function<void(miracle::Config&)> const& func, ConfigSection sections, int priority)
 {
     int handle = next_listener_handle++;
 
@@ -958,12 +1765,12 @@ int FilesystemConfiguration::register_listener(std::function<void(miracle::Confi
     {
         if (it->priority >= priority)
         {
-            on_change_listeners.insert(it, { func, priority, handle });
+            on_change_listeners.insert(it, { func, priority, handle, sections });
             return handle;
         }
     }
 
-    on_change_listeners.push_back({ func, priority, handle });
+    on_change_listeners.push_back({ func, priority, handle, sections });
     return handle;
 }
 
@@ -1032,6 +1839,16 @@ DragAndDropConfiguration FilesystemConfiguration::drag_and_drop() const
     return options.drag_and_drop;
 }
 
+IpcConfiguration FilesystemConfiguration::ipc() const
+{
+    return options.ipc;
+}
+
+SchedulingConfiguration FilesystemConfiguration::scheduling() const
+{
+    return options.scheduling;
+}
+
 uint FilesystemConfiguration::move_modifier() const
 {
     return options.move_modifier;
@@ -1197,4 +2014,6 @@ FilesystemConfiguration::ConfigDetails::ConfigDetails()
          0.25f }
     });
     animation_definitions = parsed;
+    for (auto& definition : animation_definitions)
+        compile_ease_table(definition);
 }
@@ -19,19 +19,30 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIRACLEWM_CONFIG_H
 
 #include "animation_defintion.h"
+#include "config_cache.h"
 #include "config_error_handler.h"
 #include "container.h"
+#include "quality_tier.h"
+#include "render_filter.h"
+#include "thread_scheduling.h"
 
+#include <algorithm>
+#include <chrono>
 #include <atomic>
+#include <filesystem>
 #include <functional>
+#include <future>
 #include <glm/glm.hpp>
 #include <linux/input.h>
+#include <map>
 #include <memory>
 #include <mir/fd.h>
 #include <miral/toolkit_event.h>
 #include <mutex>
 #include <optional>
+#include <span>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <yaml-cpp/yaml.h>
 
@@ -107,15 +118,29 @@ struct KeyCommand
     MirKeyboardAction action;
     uint modifiers;
     int key;
+
+    bool operator==(KeyCommand const&) const = default;
 };
 
 struct CustomKeyCommand : KeyCommand
 {
     std::string command;
+
+    bool operator==(CustomKeyCommand const&) const = default;
 };
 
 typedef std::vector<KeyCommand> KeyCommandList;
 
+/// The commands bound to a key event. The custom command takes precedence, and
+/// the default commands are tried in order. Valid until the configuration changes.
+struct KeyMatch
+{
+    CustomKeyCommand const* custom_key_command = nullptr;
+    std::span<DefaultKeyCommand const> default_key_commands;
+
+    [[nodiscard]] bool empty() const { return !custom_key_command && default_key_commands.empty(); }
+};
+
 struct StartupApp
 {
     std::string command;
@@ -123,12 +148,37 @@ struct StartupApp
     bool no_startup_id = false;
     bool should_halt_compositor_on_death = false;
     bool in_systemd_scope = false;
+
+    /// Apps with a higher priority are launched first at startup, such as a bar
+    /// or a wallpaper ahead of a chat client.
+    int priority = 0;
+
+    /// Holds the app back at startup until the app launched before it has
+    /// opened its first window. See [StartupScheduler].
+    bool after_previous = false;
+
+    bool operator==(StartupApp const&) const = default;
+};
+
+/// How the startup apps are launched. See [StartupScheduler].
+struct StartupConfiguration
+{
+    /// The most startup apps that may be starting at once, or 0 for no limit.
+    int concurrency = 0;
+
+    /// How long an app counts as starting if it neither opens a window nor exits,
+    /// as many apps never open one.
+    std::chrono::milliseconds app_timeout { 5000 };
+
+    bool operator==(StartupConfiguration const&) const = default;
 };
 
 struct EnvironmentVariable
 {
     std::string key;
     std::string value;
+
+    bool operator==(EnvironmentVariable const&) const = default;
 };
 
 struct BorderConfig
@@ -136,6 +186,8 @@ struct BorderConfig
     int size = 0;
     glm::vec4 focus_color = glm::vec4(0);
     glm::vec4 color = glm::vec4(0);
+
+    bool operator==(BorderConfig const&) const = default;
 };
 
 struct WorkspaceConfig
@@ -143,21 +195,169 @@ struct WorkspaceConfig
     std::optional<int> num;
     std::optional<ContainerType> layout;
     std::optional<std::string> name;
-};
 
-enum class RenderFilter : int
-{
-    none,
-    grayscale,
-    protanopia,
-    deuteranopia,
-    tritanopia
+    bool operator==(WorkspaceConfig const&) const = default;
 };
 
 struct DragAndDropConfiguration
 {
     bool enabled = true;
     uint modifiers = miracle_input_event_modifier_default | mir_input_event_modifier_shift;
+
+    bool operator==(DragAndDropConfiguration const&) const = default;
+};
+
+/// What to do with an IPC event that does not fit in the write queue of a client.
+enum class IpcOverflowPolicy
+{
+    /// Disconnect the client, as it is not keeping up.
+    disconnect,
+    /// Drop the oldest queued events of the same type until the new one fits.
+    drop_oldest,
+    /// Replace the queued events of the same type with the new one.
+    coalesce
+};
+
+std::optional<IpcOverflowPolicy> from_string_ipc_overflow_policy(std::string const&);
+
+struct IpcConfiguration
+{
+    /// The most bytes that may wait to be written to a single client.
+    size_t max_client_queue_bytes = 4'000'000;
+
+    /// The overflow policy of each event type, by its subscription name
+    /// (e.g. "workspace"). Event types that are missing use disconnect.
+    std::map<std::string, IpcOverflowPolicy> overflow_policies;
+
+    /// The path of a socket that answers every connection with the metrics in
+    /// the Prometheus text format. Empty when there is no such socket.
+    std::string metrics_socket;
+
+    /// The most connections that may wait to be accepted on the IPC socket.
+    /// Bars and other clients tend to connect all at once when a session starts.
+    int listen_backlog = 128;
+
+    bool operator==(IpcConfiguration const&) const = default;
+};
+
+/// The scheduling of the threads that frames depend upon. It is applied as each
+/// thread starts, so changes take effect on the next start.
+struct SchedulingConfiguration
+{
+    ThreadSchedulingConfiguration animator;
+    ThreadSchedulingConfiguration render;
+
+    bool operator==(SchedulingConfiguration const&) const = default;
+};
+
+constexpr int max_blur_passes = 6;
+constexpr int default_gpu_memory_budget_mb = 256;
+
+/// Blurs what is behind translucent windows. The blur is only recomputed when
+/// the background of the output changes.
+struct BlurConfiguration
+{
+    bool enabled = false;
+    /// The number of times that the background is halved in size and then
+    /// doubled again. Each pass roughly doubles the radius of the blur.
+    int passes = 2;
+    /// The distance between the samples of each pass, in pixels of that pass.
+    float offset = 2.f;
+
+    bool operator==(BlurConfiguration const&) const = default;
+};
+
+/// Caps how often an output that the user is not looking at is drawn, to save
+/// power. A cap is given in frames per second, and a cap of 0 leaves the output
+/// to be drawn at its refresh rate.
+///
+/// Outputs are only capped in [WindowManagerMode::normal] while the window
+/// manager is not moving anything on them, so that animations stay smooth.
+struct FrameRateCapConfiguration
+{
+    /// The cap of an output that shows neither the focused window nor the cursor.
+    int unfocused = 0;
+    /// The cap of any output whose windows are only redrawing themselves.
+    int static_content = 0;
+
+    /// The cap that applies to an output, depending on whether the user is
+    /// looking at it. The lower cap wins when both apply.
+    [[nodiscard]] int cap(bool has_focus) const
+    {
+        if (has_focus || unfocused <= 0)
+            return static_content;
+        if (static_content <= 0)
+            return unfocused;
+        return std::min(unfocused, static_content);
+    }
+
+    bool operator==(FrameRateCapConfiguration const&) const = default;
+};
+
+/// The sections of the configuration that a listener may subscribe to. These
+/// are combined as flags.
+enum class ConfigSection : uint32_t
+{
+    none = 0,
+    key_bindings = 1 << 0,
+    gaps = 1 << 1,
+    startup_apps = 1 << 2,
+    terminal = 1 << 3,
+    resize_jump = 1 << 4,
+    environment_variables = 1 << 5,
+    border = 1 << 6,
+    animations = 1 << 7,
+    workspaces = 1 << 8,
+    move_modifier = 1 << 9,
+    drag_and_drop = 1 << 10,
+    ipc = 1 << 11,
+    all = ~0u
+};
+
+constexpr ConfigSection operator|(ConfigSection left, ConfigSection right)
+{
+    return static_cast<ConfigSection>(static_cast<uint32_t>(left) | static_cast<uint32_t>(right));
+}
+
+constexpr ConfigSection operator&(ConfigSection left, ConfigSection right)
+{
+    return static_cast<ConfigSection>(static_cast<uint32_t>(left) & static_cast<uint32_t>(right));
+}
+
+constexpr ConfigSection& operator|=(ConfigSection& left, ConfigSection right)
+{
+    return left = left | right;
+}
+
+/// The values that are read on every frame or layout pass.
+///
+/// A snapshot is never modified once it is published, so it may be read from
+/// any thread without locking. Readers hold on to one for the duration of a
+/// frame or a layout pass.
+struct ConfigSnapshot
+{
+    int inner_gaps_x = 0;
+    int inner_gaps_y = 0;
+    int outer_gaps_x = 0;
+    int outer_gaps_y = 0;
+
+    /// Half of each inner gap, rounded up, which is what a container leaves on
+    /// each side that has a neighbor.
+    int half_inner_gaps_x = 0;
+    int half_inner_gaps_y = 0;
+
+    BorderConfig border_config;
+    bool animations_enabled = false;
+    std::array<AnimationDefinition, static_cast<int>(AnimateableEvent::max)> animation_definitions;
+    /// Applied to each output as a whole once its frame has been drawn.
+    RenderFilter color_filter = RenderFilter::none;
+    /// The [QualityTier] chosen in the configuration, or nullopt to have each
+    /// renderer detect it from the GPU.
+    std::optional<QualityTier> quality_tier;
+    BlurConfiguration blur;
+    /// The video memory that the offscreen targets of all outputs may hold together.
+    size_t gpu_memory_budget_bytes = static_cast<size_t>(default_gpu_memory_budget_mb) * 1024 * 1024;
+    FrameRateCapConfiguration frame_rate_caps;
 };
 
 class Config
@@ -168,6 +368,9 @@ public:
     virtual void reload() = 0;
     [[nodiscard]] virtual std::string const& get_filename() const = 0;
     [[nodiscard]] virtual MirInputEventModifier get_input_event_modifier() const = 0;
+    /// Everything that is bound to a key event, found with a single lookup and
+    /// without allocating. Empty if nothing is bound to it.
+    [[nodiscard]] virtual KeyMatch match_key(MirKeyboardAction action, int scan_code, unsigned int modifiers) const = 0;
     [[nodiscard]] virtual CustomKeyCommand const* matches_custom_key_command(MirKeyboardAction action, int scan_code, unsigned int modifiers) const = 0;
     virtual bool matches_key_command(MirKeyboardAction action, int scan_code, unsigned int modifiers, std::function<bool(DefaultKeyCommand)> const& f) const = 0;
     [[nodiscard]] virtual int get_inner_gaps_x() const = 0;
@@ -175,6 +378,7 @@ public:
     [[nodiscard]] virtual int get_outer_gaps_x() const = 0;
     [[nodiscard]] virtual int get_outer_gaps_y() const = 0;
     [[nodiscard]] virtual std::vector<StartupApp> const& get_startup_apps() const = 0;
+    [[nodiscard]] virtual StartupConfiguration startup() const = 0;
     [[nodiscard]] virtual std::optional<std::string> const& get_terminal_command() const = 0;
     [[nodiscard]] virtual int get_resize_jump() const = 0;
     [[nodiscard]] virtual std::vector<EnvironmentVariable> const& get_env_variables() const = 0;
@@ -184,15 +388,23 @@ public:
     [[nodiscard]] virtual WorkspaceConfig get_workspace_config(std::optional<int> const& num, std::optional<std::string> const& name) const = 0;
     [[nodiscard]] virtual LayoutScheme get_default_layout_scheme() const = 0;
     [[nodiscard]] virtual DragAndDropConfiguration drag_and_drop() const = 0;
+    [[nodiscard]] virtual IpcConfiguration ipc() const = 0;
+    [[nodiscard]] virtual SchedulingConfiguration scheduling() const = 0;
     [[nodiscard]] virtual uint move_modifier() const = 0;
 
     virtual int register_listener(std::function<void(miracle::Config&)> const&) = 0;
     /// Register a listener on configuration change. A lower "priority" number signifies that the
     /// listener should be triggered earlier. A higher priority means later
     virtual int register_listener(std::function<void(miracle::Config&)> const&, int priority) = 0;
+    /// Register a listener that is only triggered when one of [sections] changes.
+    virtual int register_listener(std::function<void(miracle::Config&)> const&, ConfigSection sections, int priority) = 0;
     virtual void unregister_listener(int handle) = 0;
+    /// Notifies the listeners if the configuration has been reloaded since they
+    /// were last notified.
     virtual void try_process_change() = 0;
     [[nodiscard]] virtual uint get_primary_modifier() const = 0;
+    /// The latest [ConfigSnapshot], which is replaced rather than modified on reload.
+    [[nodiscard]] virtual std::shared_ptr<ConfigSnapshot const> snapshot() const = 0;
     uint process_modifier(uint modifier) const;
 };
 
@@ -200,15 +412,27 @@ class FilesystemConfiguration : public Config
 {
 public:
     explicit FilesystemConfiguration(miral::MirRunner&);
-    FilesystemConfiguration(miral::MirRunner&, std::string const&, bool load_immediately = false);
+    /// When [cache_directory] is set, the parsed configuration is cached there. See [ConfigCache].
+    FilesystemConfiguration(
+        miral::MirRunner&,
+        std::string const&,
+        bool load_immediately = false,
+        std::optional<std::filesystem::path> const& cache_directory = std::nullopt);
     ~FilesystemConfiguration() override = default;
     FilesystemConfiguration(FilesystemConfiguration const&) = delete;
     auto operator=(FilesystemConfiguration const&) -> FilesystemConfiguration& = delete;
 
     void load(mir::Server& server) override;
     void reload() override;
+    /// Reads the file on another thread, leaving the live configuration as it is
+    /// until [on_parse_done] applies the result. Used when the file changes.
+    void reload_in_background();
+    /// Applies the result of [reload_in_background] and notifies the listeners,
+    /// waiting for the read if it has not finished yet. Called on the main loop.
+    void on_parse_done();
     [[nodiscard]] std::string const& get_filename() const override;
     [[nodiscard]] MirInputEventModifier get_input_event_modifier() const override;
+    [[nodiscard]] KeyMatch match_key(MirKeyboardAction action, int scan_code, unsigned int modifiers) const override;
     [[nodiscard]] CustomKeyCommand const* matches_custom_key_command(MirKeyboardAction action, int scan_code, unsigned int modifiers) const override;
     bool matches_key_command(MirKeyboardAction action, int scan_code, unsigned int modifiers, std::function<bool(DefaultKeyCommand)> const& f) const override;
     [[nodiscard]] int get_inner_gaps_x() const override;
@@ -216,6 +440,7 @@ public:
     [[nodiscard]] int get_outer_gaps_x() const override;
     [[nodiscard]] int get_outer_gaps_y() const override;
     [[nodiscard]] std::vector<StartupApp> const& get_startup_apps() const override;
+    [[nodiscard]] StartupConfiguration startup() const override;
     [[nodiscard]] std::optional<std::string> const& get_terminal_command() const override;
     [[nodiscard]] int get_resize_jump() const override;
     [[nodiscard]] std::vector<EnvironmentVariable> const& get_env_variables() const override;
@@ -225,25 +450,63 @@ public:
     [[nodiscard]] WorkspaceConfig get_workspace_config(std::optional<int> const& num, std::optional<std::string> const& name) const override;
     [[nodiscard]] LayoutScheme get_default_layout_scheme() const override;
     [[nodiscard]] DragAndDropConfiguration drag_and_drop() const override;
+    [[nodiscard]] IpcConfiguration ipc() const override;
+    [[nodiscard]] SchedulingConfiguration scheduling() const override;
     [[nodiscard]] uint move_modifier() const override;
     int register_listener(std::function<void(miracle::Config&)> const&) override;
     int register_listener(std::function<void(miracle::Config&)> const&, int priority) override;
+    int register_listener(std::function<void(miracle::Config&)> const&, ConfigSection sections, int priority) override;
     void unregister_listener(int handle) override;
     void try_process_change() override;
     [[nodiscard]] uint get_primary_modifier() const override;
+    [[nodiscard]] std::shared_ptr<ConfigSnapshot const> snapshot() const override;
 
 private:
+    /// A key event, with the modifiers of the binding already processed.
+    struct KeyBinding
+    {
+        MirKeyboardAction action;
+        int scan_code;
+        uint modifiers;
+
+        bool operator==(KeyBinding const&) const = default;
+    };
+
+    struct KeyBindingHash
+    {
+        size_t operator()(KeyBinding const& binding) const noexcept
+        {
+            return std::hash<uint64_t>()(
+                (static_cast<uint64_t>(binding.modifiers) << 32)
+                ^ (static_cast<uint64_t>(static_cast<uint32_t>(binding.scan_code)) << 8)
+                ^ static_cast<uint64_t>(binding.action));
+        }
+    };
+
+    /// The commands that are bound to a [KeyBinding]. The custom command takes
+    /// precedence, and the default commands are tried in order.
+    struct BoundKeyCommands
+    {
+        std::optional<size_t> custom_key_command;
+        std::vector<DefaultKeyCommand> default_key_commands;
+    };
+
     struct ConfigDetails
     {
         ConfigDetails();
         uint primary_modifier = mir_input_event_modifier_meta;
         std::vector<CustomKeyCommand> custom_key_commands;
         KeyCommandList key_commands[static_cast<int>(DefaultKeyCommand::MAX)];
+
+        /// Built from [custom_key_commands] and [key_commands] once the
+        /// configuration is read, so that a key event is matched with a single lookup.
+        std::unordered_map<KeyBinding, BoundKeyCommands, KeyBindingHash> key_bindings;
         int inner_gaps_x = 10;
         int inner_gaps_y = 10;
         int outer_gaps_x = 10;
         int outer_gaps_y = 10;
         std::vector<StartupApp> startup_apps;
+        StartupConfiguration startup;
         std::optional<std::string> terminal = "miracle-wm-sensible-terminal";
         int resize_jump = 50;
         std::vector<EnvironmentVariable> environment_variables;
@@ -253,6 +516,13 @@ private:
         std::vector<WorkspaceConfig> workspace_configs;
         uint move_modifier = miracle_input_event_modifier_default;
         DragAndDropConfiguration drag_and_drop;
+        IpcConfiguration ipc;
+        SchedulingConfiguration scheduling;
+        RenderFilter color_filter = RenderFilter::none;
+        std::optional<QualityTier> quality_tier;
+        BlurConfiguration blur;
+        int gpu_memory_budget_mb = default_gpu_memory_budget_mb;
+        FrameRateCapConfiguration frame_rate_caps;
     };
 
     struct ChangeListener
@@ -260,17 +530,54 @@ private:
         std::function<void(miracle::Config&)> listener;
         int priority;
         int handle;
+        ConfigSection sections = ConfigSection::all;
+    };
+
+    /// The sections that differ between [before] and [after].
+    static ConfigSection diff(ConfigDetails const& before, ConfigDetails const& after);
+
+    /// The configuration file as it was read ahead of its first load.
+    struct PrefetchedFile
+    {
+        std::string path;
+        std::string contents;
+        std::optional<ConfigCacheKey> cache_key;
+        /// The parsed file, unless it is going to be loaded from the cache.
+        std::optional<YAML::Node> yaml;
+    };
+
+    /// The configuration as it was read by [parse]. Its errors are held by the
+    /// [ConfigErrorHandler] until it is applied.
+    struct ParsedConfig
+    {
+        ConfigDetails options;
+        /// Set when [options] were parsed from the file rather than loaded from the cache.
+        std::optional<ConfigCacheKey> cache_key;
     };
 
     void _init(std::optional<StartupApp> const& systemd_app, std::optional<StartupApp> const& exec_app);
+    /// Starts reading and parsing the file at [path] on another thread, to be
+    /// picked up by the next [reload] of that path.
+    void prefetch(std::string const& path);
     void _watch(miral::MirRunner& runner);
     void add_error(YAML::Node const&);
+    /// Reads the file into [parsing] and returns the result, without touching the
+    /// live configuration. Only one parse may run at a time.
+    ParsedConfig parse();
+    /// Makes [parsed] the live configuration, unless it has errors and a
+    /// configuration has already been loaded.
+    void apply(ParsedConfig parsed);
+    void compile_key_bindings(ConfigDetails& details);
+    void publish_snapshot();
+    void write_cache(ConfigCacheWriter& writer) const;
+    bool read_cache(ConfigCacheReader& reader);
     void read_action_key(YAML::Node const&);
     void read_default_action_overrides(YAML::Node const&);
     void read_custom_actions(YAML::Node const&);
     void read_inner_gaps(YAML::Node const&);
     void read_outer_gaps(YAML::Node const&);
     void read_startup_apps(YAML::Node const&);
+    void read_startup(YAML::Node const&);
     void read_terminal(YAML::Node const&);
     void read_resize_jump(YAML::Node const&);
     void read_environment_variables(YAML::Node const&);
@@ -280,6 +587,14 @@ private:
     void read_enable_animations(YAML::Node const&);
     void read_move_modifier(YAML::Node const&);
     void read_drag_and_drop(YAML::Node const&);
+    void read_ipc(YAML::Node const&);
+    void read_scheduling(YAML::Node const&);
+    void read_color_filter(YAML::Node const&);
+    void read_quality_tier(YAML::Node const&);
+    void read_blur(YAML::Node const&);
+    void read_gpu_memory_budget(YAML::Node const&);
+    void read_frame_rate_caps(YAML::Node const&);
+    void read_thread_scheduling(YAML::Node const&, ThreadSchedulingConfiguration&);
 
     static std::optional<uint> try_parse_modifier(std::string const& stringified_action_key);
 
@@ -365,11 +680,26 @@ private:
     std::unique_ptr<miral::FdHandle> watch_handle;
     int file_watch = 0;
     std::mutex mutex;
-    std::atomic<bool> has_changes = false;
+    /// The sections that changed in reloads that the listeners have not yet been told about.
+    ConfigSection pending_changes = ConfigSection::none;
+    std::atomic<std::shared_ptr<ConfigSnapshot const>> published_snapshot;
+    std::unique_ptr<ConfigCache> cache;
+    std::future<PrefetchedFile> prefetched;
     bool is_loaded_ = false;
     std::stringstream builder;
     ConfigDetails options;
+    /// The options that the read_* methods fill in, owned by whichever thread is parsing.
+    ConfigDetails parsing;
     ConfigErrorHandler error_handler;
+
+    /// Guards [pending_parse] and [reload_again].
+    std::mutex reload_mutex;
+    bool reload_again = false;
+    mir::Fd parse_done_fd;
+    std::unique_ptr<miral::FdHandle> parse_done_handle;
+    /// Declared last, so that a parse in flight is waited for before the state
+    /// that it reads is destroyed.
+    std::future<ParsedConfig> pending_parse;
 };
 }
 
@@ -0,0 +1,180 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#define MIR_LOG_COMPONENT "config_cache"
+
+#include "config_cache.h"
+#include "version.h"
+
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <mir/fd.h>
+#include <mir/log.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace miracle;
+
+namespace
+{
+constexpr std::uint32_t magic = 0x43434d57; // "MWCC"
+
+/// Bump this whenever the layout of a cache entry changes.
+constexpr std::uint32_t version = 10;
+
+struct Header
+{
+    std::uint32_t magic = 0;
+    std::uint32_t version = 0;
+    std::int64_t mtime_ns = 0;
+    std::uint64_t size = 0;
+    std::uint64_t hash = 0;
+    std::uint64_t data_size = 0;
+};
+
+/// FNV-1a, like the program binary cache.
+void hash_into(std::uint64_t& hash, std::string_view data)
+{
+    for (unsigned char c : data)
+    {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+
+    hash ^= 0xff;
+    hash *= 0x100000001b3ull;
+}
+}
+
+ConfigCacheEntry::ConfigCacheEntry(void* address, size_t length, std::span<char const> data) :
+    address { address },
+    length { length },
+    data_ { data }
+{
+}
+
+ConfigCacheEntry::~ConfigCacheEntry()
+{
+    munmap(address, length);
+}
+
+ConfigCache::ConfigCache(std::filesystem::path directory) :
+    directory { std::move(directory) }
+{
+}
+
+ConfigCacheKey ConfigCache::key(std::filesystem::path const& path, std::string_view contents)
+{
+    ConfigCacheKey result { .path = path.string(), .size = contents.size() };
+
+    struct stat info;
+    if (stat(path.c_str(), &info) == 0)
+        result.mtime_ns = static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1'000'000'000 + info.st_mtim.tv_nsec;
+
+    // A different build may parse the same file differently
+    result.hash = 0xcbf29ce484222325ull;
+    hash_into(result.hash, MIRACLE_VERSION_STRING);
+    hash_into(result.hash, contents);
+    return result;
+}
+
+std::filesystem::path ConfigCache::path_for(ConfigCacheKey const& key) const
+{
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    hash_into(hash, key.path);
+
+    char name[21];
+    snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(hash));
+    return directory / name;
+}
+
+std::unique_ptr<ConfigCacheEntry> ConfigCache::load(ConfigCacheKey const& key) const
+{
+    mir::Fd const fd { open(path_for(key).c_str(), O_RDONLY | O_CLOEXEC) };
+    if (fd < 0)
+        return nullptr;
+
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size < static_cast<off_t>(sizeof(Header)))
+        return nullptr;
+
+    auto const length = static_cast<size_t>(info.st_size);
+    auto const address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED)
+        return nullptr;
+
+    // The entry owns the mapping from here on, so that every early return unmaps it
+    auto const bytes = static_cast<char const*>(address);
+    Header header;
+    std::memcpy(&header, bytes, sizeof(header));
+    auto entry = std::make_unique<ConfigCacheEntry>(
+        address, length, std::span<char const>(bytes + sizeof(Header), length - sizeof(Header)));
+
+    if (header.magic != magic
+        || header.version != version
+        || header.mtime_ns != key.mtime_ns
+        || header.size != key.size
+        || header.hash != key.hash
+        || header.data_size != length - sizeof(Header))
+        return nullptr;
+
+    return entry;
+}
+
+void ConfigCache::store(ConfigCacheKey const& key, std::span<char const> data) const
+{
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec)
+    {
+        mir::log_warning("Unable to create the config cache directory %s: %s", directory.c_str(), ec.message().c_str());
+        return;
+    }
+
+    // Write to a temporary file first so that a crash never leaves a truncated entry behind.
+    auto const path = path_for(key);
+    auto temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        Header const header {
+            .magic = magic,
+            .version = version,
+            .mtime_ns = key.mtime_ns,
+            .size = key.size,
+            .hash = key.hash,
+            .data_size = data.size()
+        };
+        file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!file)
+        {
+            mir::log_warning("Unable to write the config cache entry %s", temporary.c_str());
+            std::filesystem::remove(temporary, ec);
+            return;
+        }
+    }
+
+    std::filesystem::rename(temporary, path, ec);
+    if (ec)
+    {
+        mir::log_warning("Unable to write the config cache entry %s: %s", path.c_str(), ec.message().c_str());
+        std::filesystem::remove(temporary, ec);
+    }
+}
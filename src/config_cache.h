@@ -0,0 +1,175 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_CONFIG_CACHE_H
+#define MIRACLE_WM_CONFIG_CACHE_H
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace miracle
+{
+
+/// Identifies one version of a configuration file.
+struct ConfigCacheKey
+{
+    std::string path;
+    std::int64_t mtime_ns = 0;
+    std::uint64_t size = 0;
+
+    /// A hash of the contents of the file and of the build that parsed it.
+    std::uint64_t hash = 0;
+
+    bool operator==(ConfigCacheKey const&) const = default;
+};
+
+/// Appends values to a buffer that is stored in the [ConfigCache].
+class ConfigCacheWriter
+{
+public:
+    template <typename T>
+    void write(T const& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        auto const bytes = reinterpret_cast<char const*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    void write(std::string_view value)
+    {
+        write(static_cast<std::uint32_t>(value.size()));
+        buffer.insert(buffer.end(), value.begin(), value.end());
+    }
+
+    void write(std::string const& value)
+    {
+        write(std::string_view(value));
+    }
+
+    [[nodiscard]] std::span<char const> data() const { return buffer; }
+
+private:
+    std::vector<char> buffer;
+};
+
+/// Reads back the values written by a [ConfigCacheWriter].
+///
+/// Reading past the end yields default values and marks the reader as failed,
+/// so that a truncated entry is rejected rather than half applied.
+class ConfigCacheReader
+{
+public:
+    explicit ConfigCacheReader(std::span<char const> data) :
+        data { data }
+    {
+    }
+
+    template <typename T>
+    T read()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value {};
+        if (!take(sizeof(T)))
+            return value;
+
+        std::memcpy(&value, data.data() + offset - sizeof(T), sizeof(T));
+        return value;
+    }
+
+    std::string read_string()
+    {
+        auto const size = read<std::uint32_t>();
+        if (!take(size))
+            return {};
+
+        return std::string(data.data() + offset - size, size);
+    }
+
+    /// Whether everything read so far was present.
+    [[nodiscard]] bool ok() const { return !failed; }
+
+    /// Whether every byte has been read.
+    [[nodiscard]] bool at_end() const { return offset == data.size(); }
+
+private:
+    bool take(size_t size)
+    {
+        if (failed || data.size() - offset < size)
+        {
+            failed = true;
+            return false;
+        }
+
+        offset += size;
+        return true;
+    }
+
+    std::span<char const> data;
+    size_t offset = 0;
+    bool failed = false;
+};
+
+/// An entry of the [ConfigCache] that is mapped into memory.
+class ConfigCacheEntry
+{
+public:
+    ConfigCacheEntry(void* address, size_t length, std::span<char const> data);
+    ~ConfigCacheEntry();
+    ConfigCacheEntry(ConfigCacheEntry const&) = delete;
+    ConfigCacheEntry& operator=(ConfigCacheEntry const&) = delete;
+
+    [[nodiscard]] std::span<char const> data() const { return data_; }
+
+private:
+    void* address;
+    size_t length;
+    std::span<char const> data_;
+};
+
+/// Stores the parsed configuration on disk, so that the YAML does not need to
+/// be parsed again when the configuration file has not changed since the last
+/// start.
+///
+/// There is one entry per configuration path. An entry is only used when the
+/// modification time, the size and the hash of the contents all match.
+class ConfigCache
+{
+public:
+    explicit ConfigCache(std::filesystem::path directory);
+
+    /// Returns the key of [contents], which were read from [path].
+    [[nodiscard]] static ConfigCacheKey key(std::filesystem::path const& path, std::string_view contents);
+
+    [[nodiscard]] std::unique_ptr<ConfigCacheEntry> load(ConfigCacheKey const& key) const;
+    void store(ConfigCacheKey const& key, std::span<char const> data) const;
+
+private:
+    [[nodiscard]] std::filesystem::path path_for(ConfigCacheKey const& key) const;
+
+    std::filesystem::path directory;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_CONFIG_CACHE_H
@@ -61,3 +61,8 @@ void ConfigErrorHandler::on_complete()
 
     info.clear();
 }
+
+bool ConfigErrorHandler::has_errors() const
+{
+    return !info.empty();
+}
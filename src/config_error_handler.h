@@ -53,6 +53,9 @@ public:
     void add_error(ConfigurationInfo const&& info);
     void on_complete();
 
+    /// Whether anything was reported since the last [on_complete].
+    [[nodiscard]] bool has_errors() const;
+
 private:
     std::vector<ConfigurationInfo> info;
 };
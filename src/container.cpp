@@ -94,6 +94,19 @@ bool Container::is_lane()
     return get_type() == ContainerType::parent;
 }
 
+bool Container::is_hidden_tab() const
+{
+    Container const* node = this;
+    for (auto parent = get_parent().lock(); parent; parent = parent->get_parent().lock())
+    {
+        if (auto const active = parent->active_tab(); active && active.get() != node)
+            return true;
+        node = parent.get();
+    }
+
+    return false;
+}
+
 float Container::get_percent_of_parent() const
 {
     float percent = 1.f;
@@ -122,6 +135,14 @@ float Container::get_percent_of_parent() const
     return percent;
 }
 
+nlohmann::json Container::to_json(bool is_workspace_visible) const
+{
+    std::string serialized;
+    JsonWriter writer(serialized);
+    write_json(writer, is_workspace_visible);
+    return nlohmann::json::parse(serialized);
+}
+
 namespace
 {
 bool has_neighbor(Container const* container, LayoutScheme direction, size_t cannot_be_index)
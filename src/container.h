@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIRACLE_CONTAINER_H
 
 #include "direction.h"
+#include "json_writer.h"
 #include "scratchpad_state.h"
 
 #include "layout_scheme.h"
@@ -130,10 +131,21 @@ public:
     virtual void scratchpad_state(ScratchpadState) = 0;
     virtual ScratchpadState scratchpad_state() const = 0;
     virtual LayoutScheme get_layout() const = 0;
-    virtual nlohmann::json to_json(bool is_workspace_visible) const = 0;
+
+    /// Writes this container as a node of the i3 tree. Containers may reuse the
+    /// JSON of whatever has not changed since the last time.
+    virtual void write_json(JsonWriter& writer, bool is_workspace_visible) const = 0;
+
+    /// Returns the result of [write_json] as a document, for the events that
+    /// compare a container with how it was before.
+    [[nodiscard]] nlohmann::json to_json(bool is_workspace_visible) const;
 
     bool is_leaf();
     bool is_lane();
+
+    /// Whether this container is in a tab of a tabbing or stacking container,
+    /// at any depth, that is not the selected tab.
+    [[nodiscard]] bool is_hidden_tab() const;
     [[nodiscard]] float get_percent_of_parent() const;
 
     static std::shared_ptr<LeafContainer> as_leaf(std::shared_ptr<Container> const&);
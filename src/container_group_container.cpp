@@ -29,30 +29,54 @@ ContainerGroupContainer::ContainerGroupContainer(std::shared_ptr<CompositorState
 
 void ContainerGroupContainer::add(std::shared_ptr<Container> const& container)
 {
-    containers.push_back(container);
+    auto const [it, inserted] = index_of.try_emplace(container.get(), containers.size());
+    if (inserted)
+        containers.push_back(container);
+    else
+        containers[it->second] = container;
 }
 
 void ContainerGroupContainer::remove(std::shared_ptr<Container> const& container)
 {
-    containers.erase(std::remove_if(
-                         containers.begin(),
-                         containers.end(),
-                         [&](std::weak_ptr<Container> const& weak_container)
+    auto const it = index_of.find(container.get());
+    if (it == index_of.end())
+        return;
+
+    // Members keep the order in which they were selected
+    auto const index = it->second;
+    index_of.erase(it);
+    containers.erase(containers.begin() + static_cast<std::ptrdiff_t>(index));
+    for (auto& [_, position] : index_of)
     {
-        return weak_container.expired() || weak_container.lock() == container;
-    }),
-        containers.end());
+        if (position > index)
+            position--;
+    }
 }
 
 bool ContainerGroupContainer::contains(std::shared_ptr<Container const> const& container) const
 {
-    for (auto const& other : containers)
+    auto const it = index_of.find(container.get());
+    return it != index_of.end() && containers[it->second].lock() == container;
+}
+
+void ContainerGroupContainer::for_each(FunctionRef<void(std::shared_ptr<Container> const&)> f) const
+{
+    CommitBatch batch(*state);
+    for (auto const& container : containers)
     {
-        if (!other.expired() && other.lock() == container)
-            return true;
+        if (auto c = container.lock())
+            f(c);
     }
+}
 
-    return false;
+bool ContainerGroupContainer::all_of(FunctionRef<bool(Container&)> f) const
+{
+    bool result = true;
+    for_each([&](std::shared_ptr<Container> const& c)
+    {
+        result &= f(*c);
+    });
+    return result;
 }
 
 ContainerType ContainerGroupContainer::get_type() const
@@ -62,29 +86,26 @@ ContainerType ContainerGroupContainer::get_type() const
 
 void ContainerGroupContainer::show()
 {
-    for (auto const& container : containers)
+    for_each([&](std::shared_ptr<Container> const& c)
     {
-        if (auto c = container.lock())
-            c->show();
-    }
+        c->show();
+    });
 }
 
 void ContainerGroupContainer::hide()
 {
-    for (auto const& container : containers)
+    for_each([&](std::shared_ptr<Container> const& c)
     {
-        if (auto c = container.lock())
-            c->hide();
-    }
+        c->hide();
+    });
 }
 
 void ContainerGroupContainer::commit_changes()
 {
-    for (auto const& container : containers)
+    for_each([&](std::shared_ptr<Container> const& c)
     {
-        if (auto c = container.lock())
-            c->commit_changes();
-    }
+        c->commit_changes();
+    });
 }
 
 mir::geometry::Rectangle ContainerGroupContainer::get_logical_area() const
@@ -103,11 +124,10 @@ mir::geometry::Rectangle ContainerGroupContainer::get_visible_area() const
 
 void ContainerGroupContainer::constrain()
 {
-    for (auto const& container : containers)
+    for_each([&](std::shared_ptr<Container> const& c)
     {
-        if (auto c = container.lock())
-            c->constrain();
-    }
+        c->constrain();
+    });
 }
 
 std::weak_ptr<ParentContainer> ContainerGroupContainer::get_parent() const
@@ -137,98 +157,82 @@ void ContainerGroupContainer::handle_ready()
 
 void ContainerGroupContainer::handle_modify(miral::WindowSpecification const& specification)
 {
-    for (auto const& container : containers)
+    for_each([&](std::shared_ptr<Container> const& c)
     {
-        if (auto c = container.lock())
-            c->handle_modify(specification);
-    }
+        c->handle_modify(specification);
+    });
 }
 
 void ContainerGroupContainer::handle_request_move(MirInputEvent const* input_event)
 {
-    for (auto const& container : containers)
+    for_each([&](std::shared_ptr<Container> const& c)
     {
-        if (auto c = container.lock())
-            c->handle_request_move(input_event);
-    }
+        c->handle_request_move(input_event);
+    });
 }
 
 void ContainerGroupContainer::handle_request_resize(MirInputEvent const* input_event, MirResizeEdge edge)
 {
-    for (auto const& container : containers)
+    for_each([&](std::shared_ptr<Container> const& c)
     {
-        if (auto c = container.lock())
-            c->handle_request_resize(input_event, edge);
-    }
+        c->handle_request_resize(input_event, edge);
+    });
 }
 
 void ContainerGroupContainer::handle_raise()
 {
-    for (auto const& container : containers)
+    for_each([&](std::shared_ptr<Container> const& c)
     {
-        if (auto c = container.lock())
-            c->handle_raise();
-    }
+        c->handle_raise();
+    });
 }
 
 bool ContainerGroupContainer::resize(Direction direction, int pixels)
 {
-    bool result = true;
-    for (auto const& container : containers)
+    return all_of([&](Container& c)
     {
-        if (auto c = container.lock())
-            result &= c->resize(direction, pixels);
-    }
-    return result;
+        return c.resize(direction, pixels);
+    });
 }
 
 bool ContainerGroupContainer::set_size(std::optional<int> const& width, std::optional<int> const& height)
 {
-    bool result = true;
-    for (auto const& container : containers)
+    return all_of([&](Container& c)
     {
-        if (auto c = container.lock())
-            result &= c->set_size(width, height);
-    }
-    return result;
+        return c.set_size(width, height);
+    });
 }
 
 bool ContainerGroupContainer::toggle_fullscreen()
 {
-    bool result = true;
-    for (auto const& container : containers)
+    return all_of([&](Container& c)
     {
-        if (auto c = container.lock())
-            result &= c->toggle_fullscreen();
-    }
-    return result;
+        return c.toggle_fullscreen();
+    });
 }
 
 void ContainerGroupContainer::request_horizontal_layout()
 {
-    for (auto const& container : containers)
+    for_each([&](std::shared_ptr<Container> const& c)
     {
-        if (auto c = container.lock())
-            c->request_horizontal_layout();
-    }
+        c->request_horizontal_layout();
+    });
 }
 
 void ContainerGroupContainer::request_vertical_layout()
 {
-    for (auto const& container : containers)
+    for_each([&](std::shared_ptr<Container> const& c)
     {
-        if (auto c = container.lock())
-            c->request_vertical_layout();
-    }
+        c->request_vertical_layout();
+    });
 }
 
 void ContainerGroupContainer::toggle_layout(bool cycle_thru_all)
 {
-    for (auto const& container : containers)
+    for_each([&](std::shared_ptr<Container> const& c)
     {
-        if (auto c = container.lock())
-            c->toggle_layout(cycle_thru_all);
-    }
+        c->toggle_layout(cycle_thru_all);
+    });
 }
 
 void ContainerGroupContainer::on_open()
@@ -323,45 +327,33 @@ bool ContainerGroupContainer::pinned(bool b)
 
 bool ContainerGroupContainer::move(Direction direction)
 {
-    bool result = true;
-    for (auto const& container : containers)
+    return all_of([&](Container& c)
     {
-        if (auto c = container.lock())
-            result &= c->move(direction);
-    }
-    return result;
+        return c.move(direction);
+    });
 }
 
 bool ContainerGroupContainer::move_by(Direction direction, int pixels)
 {
-    bool result = true;
-    for (auto const& container : containers)
+    return all_of([&](Container& c)
     {
-        if (auto c = container.lock())
-            result &= c->move_by(direction, pixels);
-    }
-    return result;
+        return c.move_by(direction, pixels);
+    });
 }
 
 bool ContainerGroupContainer::move_by(float x, float y)
 {
-    bool result = true;
-    for (auto const& container : containers)
+    return all_of([&](Container& c)
     {
-        if (auto c = container.lock())
-            result &= c->move_by(x, y);
-    }
-    return result;
+        return c.move_by(x, y);
+    });
 }
 
 bool ContainerGroupContainer::move_to(int x, int y)
 {
-    bool result = true;
-    for (auto const& container : containers)
+    return all_of([&](Container& c)
     {
-        if (auto c = container.lock())
-            result &= c->move_to(x, y);
-    }
-    return result;
+        return c.move_to(x, y);
+    });
 }
 } // miracle
@@ -19,7 +19,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIRACLE_WM_CONTAINER_GROUP_CONTAINER_H
 
 #include "container.h"
+#include "function_ref.h"
+#include "memory_accounting.h"
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace miracle
@@ -31,6 +34,10 @@ class CompositorState;
 /// at once. The [ContainerGroupContainer] is incapable of performing
 /// some actions by design. It weakly owns its members, meaning that
 /// [Container]s may be removed from underneath it.
+///
+/// An operation on the group is applied to every member within a single
+/// [CommitBatch], so that the whole group costs one layout pass and each
+/// window is animated once.
 class ContainerGroupContainer : public Container
 {
 public:
@@ -40,6 +47,9 @@ public:
     bool contains(std::shared_ptr<Container const> const&) const;
     [[nodiscard]] std::vector<std::weak_ptr<Container>> const& get_containers() const { return containers; }
 
+    /// Calls [f] on every member that still exists within a single [CommitBatch].
+    void for_each(FunctionRef<void(std::shared_ptr<Container> const&)> f) const;
+
     ContainerType get_type() const override;
     void show() override;
     void hide() override;
@@ -99,11 +109,19 @@ public:
     void scratchpad_state(ScratchpadState) override { }
     ScratchpadState scratchpad_state() const override { return ScratchpadState::none; }
     LayoutScheme get_layout() const override { return LayoutScheme::none; }
-    nlohmann::json to_json(bool is_workspace_active) const override { return {}; }
+    void write_json(JsonWriter& writer, bool is_workspace_active) const override { writer.null(); }
 
 private:
+    /// Applies [f] to every member and returns true if it succeeded for all of them.
+    bool all_of(FunctionRef<bool(Container&)> f) const;
+
     std::vector<std::weak_ptr<Container>> containers;
+
+    /// The position of each member in [containers], so that membership is a lookup.
+    /// A member that has been destroyed keeps its entry until its address is reused.
+    std::unordered_map<Container const*, size_t> index_of;
     std::shared_ptr<CompositorState> state;
+    MemoryCharge memory { MemorySubsystem::containers, sizeof(ContainerGroupContainer) };
 };
 
 } // miracle
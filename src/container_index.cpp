@@ -0,0 +1,254 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#define MIR_LOG_COMPONENT "container_index"
+
+#include "container_index.h"
+#include "container.h"
+#include "jpcre2.h"
+#include "window_controller.h"
+#include "workspace_interface.h"
+
+#include <charconv>
+#include <mir/log.h>
+#include <optional>
+
+using namespace miracle;
+
+namespace
+{
+typedef jpcre2::select<char> jp;
+}
+
+struct RegexCache::Compiled
+{
+    explicit Compiled(std::string const& pattern) :
+        regex(pattern, 0, jpcre2::JIT_COMPILE)
+    {
+    }
+
+    jp::Regex regex;
+};
+
+RegexCache::RegexCache() = default;
+RegexCache::~RegexCache() = default;
+
+bool RegexCache::matches(std::string_view pattern, std::string const& subject)
+{
+    auto it = patterns.find(pattern);
+    if (it == patterns.end())
+    {
+        // Criteria strings are few, so the cache is simply started over once it fills up.
+        if (patterns.size() >= capacity)
+            patterns.clear();
+
+        std::string key(pattern);
+        auto compiled = std::make_unique<Compiled>(key);
+        if (!compiled->regex)
+            mir::log_warning("Unable to compile criteria pattern: %s", key.c_str());
+        it = patterns.emplace(std::move(key), std::move(compiled)).first;
+    }
+
+    auto& regex = it->second->regex;
+    return regex && regex.match(subject) > 0;
+}
+
+ContainerIndex::ContainerIndex(std::shared_ptr<WindowController> const& window_controller) :
+    window_controller { window_controller }
+{
+}
+
+void ContainerIndex::on_window_changed(WindowChange change, Container const& container)
+{
+    switch (change)
+    {
+    case WindowChange::closed:
+        remove(&container);
+        return;
+    case WindowChange::focused:
+        // Focus does not change any of the attributes that are indexed.
+        return;
+    default:
+        refresh(container);
+        return;
+    }
+}
+
+void ContainerIndex::refresh(Container const& container)
+{
+    auto const window = container.window();
+    if (!window || !window.value())
+        return;
+
+    auto const& info = window_controller->info_for(window.value());
+    auto const* workspace = container.get_workspace();
+    update(
+        std::const_pointer_cast<Container>(container.shared_from_this()),
+        {
+            .app_id = info.application_id(),
+            .title = info.name(),
+            .workspace = workspace ? workspace->display_name() : "",
+            .floating = !container.anchored(),
+        });
+}
+
+void ContainerIndex::update(std::shared_ptr<Container> const& container, Attributes attributes)
+{
+    auto const key = container.get();
+    auto it = entries.find(key);
+    if (it != entries.end())
+    {
+        unlink(key, it->second.attributes);
+        it->second = { container, std::move(attributes) };
+    }
+    else
+    {
+        it = entries.emplace(key, Entry { container, std::move(attributes) }).first;
+    }
+
+    link(key, it->second.attributes);
+}
+
+void ContainerIndex::remove(Container const* container)
+{
+    auto it = entries.find(container);
+    if (it == entries.end())
+        return;
+
+    unlink(container, it->second.attributes);
+    entries.erase(it);
+}
+
+void ContainerIndex::link(Key key, Attributes const& attributes)
+{
+    by_app_id[attributes.app_id].insert(key);
+    by_title[attributes.title].insert(key);
+    by_workspace[attributes.workspace].insert(key);
+    (attributes.floating ? floating : tiling).insert(key);
+}
+
+void ContainerIndex::unlink(Key key, Attributes const& attributes)
+{
+    auto const erase = [key](ValueIndex& index, std::string const& value)
+    {
+        auto it = index.find(value);
+        if (it == index.end())
+            return;
+
+        it->second.erase(key);
+        if (it->second.empty())
+            index.erase(it);
+    };
+
+    erase(by_app_id, attributes.app_id);
+    erase(by_title, attributes.title);
+    erase(by_workspace, attributes.workspace);
+    (attributes.floating ? floating : tiling).erase(key);
+}
+
+ContainerIndex::KeySet ContainerIndex::match(ValueIndex const& index, std::string_view pattern)
+{
+    KeySet result;
+    for (auto const& [value, keys] : index)
+    {
+        if (regexes.matches(pattern, value))
+            result.insert(keys.begin(), keys.end());
+    }
+
+    return result;
+}
+
+std::vector<std::shared_ptr<Container>> ContainerIndex::find(decltype(IpcParseResult::scope) const& scope)
+{
+    std::optional<KeySet> candidates;
+    auto const narrow = [&](KeySet const& keys)
+    {
+        if (!candidates)
+            candidates = keys;
+        else
+            std::erase_if(*candidates, [&](Key key)
+            { return !keys.contains(key); });
+    };
+
+    for (auto const& criterion : scope)
+    {
+        switch (criterion.type)
+        {
+        case IpcScopeType::all:
+            break;
+        case IpcScopeType::floating:
+            narrow(floating);
+            break;
+        case IpcScopeType::tiling:
+            narrow(tiling);
+            break;
+        case IpcScopeType::app_id:
+        // Wayland windows have no class or instance, so these match the app_id like they do in sway.
+        case IpcScopeType::class_:
+        case IpcScopeType::instance:
+            narrow(match(by_app_id, criterion.value));
+            break;
+        case IpcScopeType::title:
+            narrow(match(by_title, criterion.value));
+            break;
+        case IpcScopeType::workspace:
+            narrow(match(by_workspace, criterion.value));
+            break;
+        case IpcScopeType::con_id:
+        {
+            KeySet keys;
+            std::uintptr_t id = 0;
+            auto const& value = criterion.value;
+            if (std::from_chars(value.data(), value.data() + value.size(), id).ec == std::errc())
+            {
+                if (auto it = entries.find(reinterpret_cast<Key>(id)); it != entries.end())
+                    keys.insert(it->first);
+            }
+            narrow(keys);
+            break;
+        }
+        default:
+            // Marks, urgency and the remaining X11 criteria are never met.
+            return {};
+        }
+
+        if (candidates && candidates->empty())
+            return {};
+    }
+
+    std::vector<std::shared_ptr<Container>> result;
+    auto const collect = [&](Key key)
+    {
+        if (auto container = entries.at(key).container.lock())
+            result.push_back(std::move(container));
+    };
+
+    if (candidates)
+    {
+        result.reserve(candidates->size());
+        for (auto const key : *candidates)
+            collect(key);
+    }
+    else
+    {
+        result.reserve(entries.size());
+        for (auto const& [key, entry] : entries)
+            collect(key);
+    }
+
+    return result;
+}
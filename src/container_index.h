@@ -0,0 +1,125 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_CONTAINER_INDEX_H
+#define MIRACLE_WM_CONTAINER_INDEX_H
+
+#include "ipc_command.h"
+#include "window_observer.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace miracle
+{
+class WindowController;
+
+/// Compiles each distinct criteria pattern once, with JIT, and keeps it for the
+/// commands that use it again.
+class RegexCache
+{
+public:
+    static constexpr size_t capacity = 128;
+
+    RegexCache();
+    ~RegexCache();
+
+    /// Returns true if [pattern] is found in [subject]. A pattern that does not
+    /// compile matches nothing.
+    bool matches(std::string_view pattern, std::string const& subject);
+
+private:
+    struct Compiled;
+
+    /// Lets patterns be looked up by string_view without building a string.
+    struct PatternHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view pattern) const { return std::hash<std::string_view> {}(pattern); }
+    };
+
+    std::unordered_map<std::string, std::unique_ptr<Compiled>, PatternHash, std::equal_to<>> patterns;
+};
+
+/// Keeps the attributes that command criteria select windows by, so that a scoped
+/// command only has to look at the windows that can match it.
+///
+/// Containers are identified by their address, which is also the "id" of a leaf
+/// container in the tree.
+class ContainerIndex : public WindowObserver
+{
+public:
+    struct Attributes
+    {
+        std::string app_id;
+        std::string title;
+        std::string workspace;
+        bool floating = false;
+    };
+
+    explicit ContainerIndex(std::shared_ptr<WindowController> const& window_controller);
+
+    void on_window_changed(WindowChange change, Container const& container) override;
+
+    /// Reads the attributes of [container] again. Used for changes that no
+    /// [WindowChange] is advised for, such as a new app_id.
+    void refresh(Container const& container);
+
+    void update(std::shared_ptr<Container> const& container, Attributes attributes);
+    void remove(Container const* container);
+
+    /// Returns the containers that meet every criterion in [scope].
+    std::vector<std::shared_ptr<Container>> find(decltype(IpcParseResult::scope) const& scope);
+
+    [[nodiscard]] size_t size() const { return entries.size(); }
+
+private:
+    using Key = Container const*;
+    using KeySet = std::unordered_set<Key>;
+    using ValueIndex = std::unordered_map<std::string, KeySet>;
+
+    struct Entry
+    {
+        std::weak_ptr<Container> container;
+        Attributes attributes;
+    };
+
+    void link(Key key, Attributes const& attributes);
+    void unlink(Key key, Attributes const& attributes);
+
+    /// The containers whose value in [index] matches [pattern]. Each distinct value
+    /// is tested once, however many containers share it.
+    KeySet match(ValueIndex const& index, std::string_view pattern);
+
+    std::shared_ptr<WindowController> window_controller;
+    std::unordered_map<Key, Entry> entries;
+    ValueIndex by_app_id;
+    ValueIndex by_title;
+    ValueIndex by_workspace;
+    KeySet floating;
+    KeySet tiling;
+    RegexCache regexes;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_CONTAINER_INDEX_H
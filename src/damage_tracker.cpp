@@ -0,0 +1,154 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "damage_tracker.h"
+
+#include <algorithm>
+
+using namespace miracle;
+namespace geom = mir::geometry;
+
+namespace
+{
+bool is_empty(geom::Rectangle const& r)
+{
+    return r.size.width.as_int() <= 0 || r.size.height.as_int() <= 0;
+}
+
+/// Grows [into] so that it also covers [r].
+void add_damage(geom::Rectangle& into, geom::Rectangle const& r)
+{
+    if (is_empty(r))
+        return;
+
+    if (is_empty(into))
+    {
+        into = r;
+        return;
+    }
+
+    int const x1 = std::min(into.top_left.x.as_int(), r.top_left.x.as_int());
+    int const y1 = std::min(into.top_left.y.as_int(), r.top_left.y.as_int());
+    int const x2 = std::max(
+        into.top_left.x.as_int() + into.size.width.as_int(),
+        r.top_left.x.as_int() + r.size.width.as_int());
+    int const y2 = std::max(
+        into.top_left.y.as_int() + into.size.height.as_int(),
+        r.top_left.y.as_int() + r.size.height.as_int());
+    into = geom::Rectangle {
+        geom::Point { x1, y1 },
+        geom::Size { x2 - x1, y2 - y1 }
+    };
+}
+}
+
+DamageTracker::DamageTracker(size_t max_buffer_age) :
+    max_buffer_age { std::max<size_t>(max_buffer_age, 1) }
+{
+    history.reserve(this->max_buffer_age + 1);
+}
+
+std::optional<geom::Rectangle> DamageTracker::next_frame(
+    std::vector<DamageTrackerEntry> const& entries, int buffer_age)
+{
+    std::optional<geom::Rectangle> frame_damage;
+    if (!is_invalidated)
+    {
+        geom::Rectangle damage;
+        seen.assign(previous.size(), false);
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            auto const& entry = entries[i];
+            auto it = std::ranges::lower_bound(previous_index, entry.id, {}, &std::pair<void const*, size_t>::first);
+            if (it == previous_index.end() || it->first != entry.id)
+            {
+                add_damage(damage, entry.area);
+                continue;
+            }
+
+            seen[it->second] = true;
+            auto const& old_entry = previous[it->second];
+
+            // A change in the stacking order is as good as a change in contents.
+            if (it->second != i || old_entry != entry)
+            {
+                add_damage(damage, old_entry.area);
+                add_damage(damage, entry.area);
+            }
+        }
+
+        for (size_t i = 0; i < previous.size(); i++)
+        {
+            if (!seen[i])
+                add_damage(damage, previous[i].area);
+        }
+
+        frame_damage = damage;
+    }
+
+    is_invalidated = false;
+    history.insert(history.begin(), frame_damage);
+    if (history.size() > max_buffer_age)
+        history.pop_back();
+
+    previous = entries;
+    previous_index.clear();
+    for (size_t i = 0; i < previous.size(); i++)
+        previous_index.emplace_back(previous[i].id, i);
+    std::ranges::sort(previous_index);
+
+    if (buffer_age <= 0 || static_cast<size_t>(buffer_age) > history.size())
+        return std::nullopt;
+
+    geom::Rectangle result;
+    for (size_t i = 0; i < static_cast<size_t>(buffer_age); i++)
+    {
+        if (!history[i])
+            return std::nullopt;
+
+        add_damage(result, history[i].value());
+    }
+
+    return result;
+}
+
+bool DamageTracker::is_up_to_date(int buffer_age) const
+{
+    if (is_invalidated || buffer_age <= 0 || static_cast<size_t>(buffer_age) > history.size())
+        return false;
+
+    // The buffer shows the frame [buffer_age] frames ago, so every frame since then must be unchanged
+    for (size_t i = 0; i + 1 < static_cast<size_t>(buffer_age); i++)
+    {
+        if (!history[i] || !is_empty(history[i].value()))
+            return false;
+    }
+
+    return true;
+}
+
+void DamageTracker::repeat_frame()
+{
+    history.insert(history.begin(), geom::Rectangle {});
+    if (history.size() > max_buffer_age)
+        history.pop_back();
+}
+
+void DamageTracker::invalidate()
+{
+    is_invalidated = true;
+}
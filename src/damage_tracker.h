@@ -0,0 +1,91 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_DAMAGE_TRACKER_H
+#define MIRACLE_WM_DAMAGE_TRACKER_H
+
+#include <glm/glm.hpp>
+#include <mir/geometry/rectangle.h>
+#include <mir/graphics/buffer_id.h>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace miracle
+{
+
+/// Everything about a single renderable that affects the pixels that it produces.
+struct DamageTrackerEntry
+{
+    void const* id = nullptr;
+    mir::graphics::BufferID buffer_id;
+    /// The area covered by the renderable, including its outline.
+    mir::geometry::Rectangle area;
+    std::optional<mir::geometry::Rectangle> clip_area;
+    float alpha = 1.f;
+    bool is_focused = false;
+    bool needs_outline = false;
+    glm::vec4 outline_color = glm::vec4(0);
+
+    bool operator==(DamageTrackerEntry const&) const = default;
+};
+
+/// Compares the renderables of consecutive frames in order to determine the
+/// smallest area of the output that must be redrawn.
+///
+/// The tracker remembers the damage of the last few frames so that the result
+/// can be applied to a back buffer of any age up to [max_buffer_age].
+class DamageTracker
+{
+public:
+    explicit DamageTracker(size_t max_buffer_age = 4);
+
+    /// Records [entries] as the contents of the next frame and returns the area
+    /// that must be redrawn in a back buffer of [buffer_age]. A buffer age of 0
+    /// means that the contents of the buffer are unknown.
+    ///
+    /// std::nullopt is returned if the entire output must be redrawn. An empty
+    /// rectangle is returned if nothing has changed.
+    std::optional<mir::geometry::Rectangle> next_frame(
+        std::vector<DamageTrackerEntry> const& entries, int buffer_age);
+
+    /// Returns true if a back buffer of [buffer_age] already shows the last frame,
+    /// so that a frame with the same entries would not need anything redrawn.
+    [[nodiscard]] bool is_up_to_date(int buffer_age) const;
+
+    /// Records a frame with the same entries as the last one without comparing them.
+    void repeat_frame();
+
+    /// Forces the next frame to be redrawn in its entirety.
+    void invalidate();
+
+private:
+    size_t max_buffer_age;
+    bool is_invalidated = true;
+    std::vector<DamageTrackerEntry> previous;
+    /// The index of each entry of [previous] by id, sorted by id. A sorted vector
+    /// rather than a map, so that building it each frame does not allocate.
+    std::vector<std::pair<void const*, size_t>> previous_index;
+    /// Which entries of [previous] are still present, kept to reuse its storage.
+    std::vector<bool> seen;
+    /// The damage of the most recent frames, newest first.
+    std::vector<std::optional<mir::geometry::Rectangle>> history;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_DAMAGE_TRACKER_H
@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIRACLE_WM_DEBUG_HELPER_H
 
 #define MIR_LOG_COMPONENT "debug_helper"
+#include "debug_log.h"
 #include "mir/log.h"
 #include <miral/window_specification.h>
 #include <sstream>
@@ -26,7 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 namespace miracle
 {
-std::string point_to_string(mir::optional_value<mir::geometry::Point> const& point)
+inline std::string point_to_string(mir::optional_value<mir::geometry::Point> const& point)
 {
     if (!point)
         return "(unset)";
@@ -40,7 +41,7 @@ std::string point_to_string(mir::optional_value<mir::geometry::Point> const& poi
     return ss.str();
 }
 
-std::string size_to_string(mir::optional_value<mir::geometry::Size> const& size)
+inline std::string size_to_string(mir::optional_value<mir::geometry::Size> const& size)
 {
     if (!size)
         return "(unset)";
@@ -54,13 +55,18 @@ std::string size_to_string(mir::optional_value<mir::geometry::Size> const& size)
     return ss.str();
 }
 
-void print_specification(std::string const& label, mir::geometry::Rectangle const& spec)
+/// Logs [spec] under [LogCategory::layout]. Nothing is formatted unless the
+/// category is enabled.
+inline void print_specification(std::string const& label, mir::geometry::Rectangle const& spec)
 {
+    if (!is_log_category_compiled(LogCategory::layout) || !DebugLog::is_enabled(LogCategory::layout))
+        return;
+
     std::stringstream ss;
     ss << label << ": \n";
     ss << "  top_left(): " << point_to_string(spec.top_left) << "\n";
     ss << "  size(): " << size_to_string(spec.size) << "\n";
-    mir::log_info(ss.str());
+    mir::log_debug("%s", ss.str().c_str());
 }
 }
 
@@ -0,0 +1,78 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "debug_log.h"
+
+using namespace miracle;
+
+std::atomic<uint32_t> DebugLog::mask = 0;
+
+char const* miracle::log_category_name(LogCategory category)
+{
+    switch (category)
+    {
+    case LogCategory::ipc:
+        return "ipc";
+    case LogCategory::state:
+        return "state";
+    case LogCategory::render:
+        return "render";
+    case LogCategory::input:
+        return "input";
+    case LogCategory::layout:
+        return "layout";
+    case LogCategory::config:
+        return "config";
+    }
+
+    return "unknown";
+}
+
+std::optional<uint32_t> DebugLog::parse(std::string_view categories)
+{
+    uint32_t result = 0;
+    while (!categories.empty())
+    {
+        auto const comma = categories.find(',');
+        auto const name = categories.substr(0, comma);
+        categories = comma == std::string_view::npos ? std::string_view {} : categories.substr(comma + 1);
+        if (name.empty())
+            continue;
+
+        if (name == "all")
+        {
+            result = all_log_categories;
+            continue;
+        }
+
+        bool found = false;
+        for (uint32_t bit = 1; bit <= all_log_categories; bit <<= 1)
+        {
+            if (name == log_category_name(static_cast<LogCategory>(bit)))
+            {
+                result |= bit;
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+            return std::nullopt;
+    }
+
+    return result;
+}
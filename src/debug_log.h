@@ -0,0 +1,95 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_DEBUG_LOG_H
+#define MIRACLE_WM_DEBUG_LOG_H
+
+#include "feature_flags.h"
+#include <atomic>
+#include <cstdint>
+#include <mir/log.h>
+#include <optional>
+#include <string_view>
+
+/// The categories of [MIRACLE_LOG_DEBUG] that are compiled in, as a mask of
+/// [miracle::LogCategory]. Defining this as 0 removes every debug log from the
+/// build.
+#ifndef MIRACLE_DEBUG_LOG_CATEGORIES
+#define MIRACLE_DEBUG_LOG_CATEGORIES 0xffffffffu
+#endif
+
+namespace miracle
+{
+
+enum class LogCategory : uint32_t
+{
+    ipc = 1 << 0,
+    state = 1 << 1,
+    render = 1 << 2,
+    input = 1 << 3,
+    layout = 1 << 4,
+    config = 1 << 5
+};
+
+constexpr uint32_t all_log_categories = (1 << 6) - 1;
+
+/// Whether the debug logs of [category] are compiled in.
+constexpr bool is_log_category_compiled(LogCategory category)
+{
+    return MIRACLE_FEATURE_FLAG_DEBUG_LOG
+        && (static_cast<uint32_t>(MIRACLE_DEBUG_LOG_CATEGORIES) & static_cast<uint32_t>(category)) != 0;
+}
+
+/// The categories of debug log that are printed while the compositor runs.
+/// None are printed until they are enabled with --debug-log.
+class DebugLog
+{
+public:
+    [[nodiscard]] static bool is_enabled(LogCategory category)
+    {
+        return (mask.load(std::memory_order_relaxed) & static_cast<uint32_t>(category)) != 0;
+    }
+
+    static void enable(uint32_t categories) { mask.store(categories, std::memory_order_relaxed); }
+    [[nodiscard]] static uint32_t enabled() { return mask.load(std::memory_order_relaxed); }
+
+    /// Parses a comma separated list of category names, or "all". Returns
+    /// nothing if a name is not a category.
+    static std::optional<uint32_t> parse(std::string_view categories);
+
+private:
+    static std::atomic<uint32_t> mask;
+};
+
+char const* log_category_name(LogCategory category);
+
+} // miracle
+
+/// Logs at debug level if [category] is compiled in and enabled. The arguments
+/// are only evaluated when the message is printed, and when the category is
+/// compiled out the whole statement is discarded.
+#define MIRACLE_LOG_DEBUG(category, ...)                                     \
+    do                                                                       \
+    {                                                                        \
+        if constexpr (::miracle::is_log_category_compiled(category))         \
+        {                                                                    \
+            if (::miracle::DebugLog::is_enabled(category))                   \
+                ::mir::log_debug(__VA_ARGS__);                               \
+        }                                                                    \
+    } while (0)
+
+#endif // MIRACLE_WM_DEBUG_LOG_H
@@ -23,8 +23,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "config.h"
 #include "constants.h"
 #include "feature_flags.h"
+#include "frame_clock.h"
 #include "output_manager.h"
 
+#include <algorithm>
 #include <mir/log.h>
 #include <miral/toolkit_event.h>
 
@@ -49,6 +51,7 @@ bool DragAndDropService::handle_pointer_event(CompositorState& state, float x, f
     {
         if (action == mir_pointer_action_button_up)
         {
+            commit_target(state);
             command_controller->set_mode(WindowManagerMode::normal);
             if (state.focused_container())
                 state.focused_container()->drag_stop();
@@ -59,6 +62,7 @@ bool DragAndDropService::handle_pointer_event(CompositorState& state, float x, f
         if (!state.focused_container())
         {
             mir::log_warning("handle_drag_and_drop_pointer_event: focused container no longer exists while dragging");
+            clear_target(state);
             return false;
         }
 
@@ -78,24 +82,12 @@ bool DragAndDropService::handle_pointer_event(CompositorState& state, float x, f
 
         if (output_manager->focused()->active()->is_empty())
         {
+            clear_target(state);
             drag_to(state.focused_container(), output_manager->focused()->active());
             return true;
         }
 
-        // Get the intersection and try to move ourselves there. We only care if we're intersecting
-        // a leaf container, as those would be the only one in the grid.
-        std::shared_ptr<Container> intersected = output_manager->focused()->intersect_leaf(x, y, true);
-        if (!intersected)
-        {
-            last_intersected.reset();
-            return true;
-        }
-
-        if (last_intersected.lock() == intersected)
-            return true;
-
-        last_intersected = intersected;
-        drag_to(state.focused_container(), intersected);
+        update_target(state, x, y, action != mir_pointer_action_motion);
         return true;
     }
     else if (action == mir_pointer_action_button_down)
@@ -137,6 +129,67 @@ bool DragAndDropService::handle_pointer_event(CompositorState& state, float x, f
     return false;
 }
 
+void DragAndDropService::update_target(CompositorState& state, float x, float y, bool immediate)
+{
+    auto const now = std::chrono::steady_clock::now();
+    if (!immediate && now - last_evaluation < state.frame_clock()->refresh_interval())
+        return;
+    last_evaluation = now;
+
+    // Get the intersection and try to move ourselves there. We only care if we're intersecting
+    // a leaf container, as those would be the only one in the grid.
+    std::shared_ptr<Container> intersected = output_manager->focused()->intersect_leaf(x, y, true);
+    if (!intersected)
+    {
+        last_intersected.reset();
+        clear_target(state);
+        return;
+    }
+
+    if (last_intersected.lock() == intersected)
+    {
+        clear_target(state);
+        return;
+    }
+
+    if (pending_target.lock() != intersected)
+    {
+        auto const area = intersected->get_visible_area();
+        int const margin_x = std::min(hysteresis, area.size.width.as_int() / 4);
+        int const margin_y = std::min(hysteresis, area.size.height.as_int() / 4);
+        geom::Rectangle const inner {
+            geom::Point { area.top_left.x.as_int() + margin_x, area.top_left.y.as_int() + margin_y },
+            geom::Size { area.size.width.as_int() - 2 * margin_x, area.size.height.as_int() - 2 * margin_y }
+        };
+        if (!immediate && !inner.contains(geom::Point(static_cast<int>(x), static_cast<int>(y))))
+            return;
+
+        pending_target = intersected;
+        pending_since = now;
+        state.drag_preview(area);
+    }
+
+    if (immediate || now - pending_since >= settle_delay)
+        commit_target(state);
+}
+
+void DragAndDropService::commit_target(CompositorState& state)
+{
+    auto const target = pending_target.lock();
+    clear_target(state);
+    if (!target || !state.focused_container() || last_intersected.lock() == target)
+        return;
+
+    last_intersected = target;
+    drag_to(state.focused_container(), target);
+}
+
+void DragAndDropService::clear_target(CompositorState& state)
+{
+    pending_target.reset();
+    state.drag_preview(std::nullopt);
+}
+
 void DragAndDropService::drag_to(
     std::shared_ptr<Container> const& dragging,
     std::shared_ptr<Container> const& to)
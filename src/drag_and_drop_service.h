@@ -18,6 +18,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef MIRACLE_WM_DRAG_AND_DROP_SERVICE_H
 #define MIRACLE_WM_DRAG_AND_DROP_SERVICE_H
 
+#include <chrono>
 #include <memory>
 #include <mir_toolkit/event.h>
 
@@ -40,6 +41,15 @@ public:
         std::shared_ptr<OutputManager> const& output_manager);
     bool handle_pointer_event(CompositorState& state, float x, float y, MirPointerAction action, uint modifiers);
 
+    /// How far the pointer must travel into a container before it becomes the
+    /// drop target, so that a pointer resting on an edge does not flip between
+    /// the containers on either side.
+    static constexpr int hysteresis = 16;
+
+    /// How long the drop target must stay the same before the dragged container
+    /// is moved to it without waiting for the drop.
+    static constexpr std::chrono::milliseconds settle_delay { 300 };
+
 private:
     std::shared_ptr<CommandController> command_controller;
     std::shared_ptr<Config> config;
@@ -53,6 +63,19 @@ private:
     float current_y = 0;
     std::weak_ptr<Container> last_intersected;
 
+    /// The container that is previewed as the drop target.
+    std::weak_ptr<Container> pending_target;
+    std::chrono::steady_clock::time_point pending_since;
+    std::chrono::steady_clock::time_point last_evaluation;
+
+    /// Finds the drop target under [x], [y]. Unless [immediate] is true, this happens
+    /// at most once per frame, and only previews the target until it settles.
+    void update_target(CompositorState& state, float x, float y, bool immediate);
+
+    /// Moves the dragged container to the previewed drop target, if there is one.
+    void commit_target(CompositorState& state);
+    void clear_target(CompositorState& state);
+
     void drag_to(
         std::shared_ptr<Container> const& dragging,
         std::shared_ptr<Container> const& to);
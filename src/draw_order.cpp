@@ -0,0 +1,98 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "draw_order.h"
+
+#include <algorithm>
+#include <memory>
+
+using namespace miracle;
+
+namespace
+{
+/// Sorts [items] with scratch space from [allocator], which is also used for the result.
+template <typename Allocator>
+std::vector<size_t, Allocator> sort(std::vector<DrawOrderItem> const& items, Allocator const& allocator)
+{
+    using Indices = std::vector<size_t, Allocator>;
+    using IndicesAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Indices>;
+    auto const count = items.size();
+
+    // [blockers] is the number of items below each item that it overlaps and
+    // that have yet to be drawn.
+    Indices blockers(count, 0, allocator);
+    std::vector<Indices, IndicesAllocator> blocked_by(count, Indices(allocator), IndicesAllocator(allocator));
+    for (size_t i = 0; i < count; i++)
+    {
+        for (size_t j = 0; j < i; j++)
+        {
+            if (items[i].is_barrier || items[j].is_barrier || items[i].area.overlaps(items[j].area))
+            {
+                blockers[i]++;
+                blocked_by[j].push_back(i);
+            }
+        }
+    }
+
+    Indices ready(allocator);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (blockers[i] == 0)
+            ready.push_back(i);
+    }
+
+    Indices order(allocator);
+    order.reserve(count);
+    while (!ready.empty())
+    {
+        // Continue the current batch if we can, otherwise fall back to the lowest item.
+        auto next = ready.begin();
+        if (!order.empty())
+        {
+            auto const key = items[order.back()].batch_key;
+            auto same = std::find_if(ready.begin(), ready.end(), [&](size_t i)
+            {
+                return items[i].batch_key == key;
+            });
+            if (same != ready.end())
+                next = same;
+        }
+
+        auto const index = *next;
+        ready.erase(next);
+        order.push_back(index);
+
+        for (auto above : blocked_by[index])
+        {
+            if (--blockers[above] == 0)
+                ready.insert(std::lower_bound(ready.begin(), ready.end(), above), above);
+        }
+    }
+
+    return order;
+}
+}
+
+std::vector<size_t> miracle::sort_draw_order(std::vector<DrawOrderItem> const& items)
+{
+    return sort(items, std::allocator<size_t>());
+}
+
+FrameVector<size_t> miracle::sort_draw_order(std::vector<DrawOrderItem> const& items, FrameArena& arena)
+{
+    return sort(items, FrameArenaAllocator<size_t>(arena));
+}
@@ -0,0 +1,52 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_DRAW_ORDER_H
+#define MIRACLE_WM_DRAW_ORDER_H
+
+#include "frame_arena.h"
+#include <cstdint>
+#include <mir/geometry/rectangle.h>
+#include <vector>
+
+namespace miracle
+{
+
+struct DrawOrderItem
+{
+    /// Everything that this item may touch when drawn.
+    mir::geometry::Rectangle area;
+    /// Items with the same key share the same GL state (e.g. program and blend mode).
+    std::uint64_t batch_key = 0;
+    /// Set when [area] cannot be trusted, such as for a transformed item. The item
+    /// is treated as overlapping every other item, so it keeps its stacking position.
+    bool is_barrier = false;
+};
+
+/// Returns the order in which [items] (given bottom to top) should be drawn so
+/// that items sharing a batch key are drawn one after the other.
+///
+/// The visible result is unchanged: an item is never drawn before an item
+/// below it that it overlaps.
+std::vector<size_t> sort_draw_order(std::vector<DrawOrderItem> const& items);
+
+/// Like [sort_draw_order], but allocates from [arena] instead of the heap.
+FrameVector<size_t> sort_draw_order(std::vector<DrawOrderItem> const& items, FrameArena& arena);
+
+} // miracle
+
+#endif // MIRACLE_WM_DRAW_ORDER_H
@@ -0,0 +1,271 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "easing.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace miracle;
+
+namespace
+{
+float ease_out_bounce(AnimationDefinition const& defintion, float x)
+{
+    if (x < 1 / defintion.d1)
+    {
+        return defintion.n1 * x * x;
+    }
+    else if (x < 2 / defintion.d1)
+    {
+        return defintion.n1 * (x -= 1.5f / defintion.d1) * x + 0.75f;
+    }
+    else if (x < 2.5 / defintion.d1)
+    {
+        return defintion.n1 * (x -= 2.25f / defintion.d1) * x + 0.9375f;
+    }
+    else
+    {
+        return defintion.n1 * (x -= 2.625f / defintion.d1) * x + 0.984375f;
+    }
+}
+
+template <typename F>
+inline void apply(float const* __restrict t, float* __restrict out, size_t count, F const& f)
+{
+    for (size_t i = 0; i < count; i++)
+        out[i] = f(t[i]);
+}
+}
+
+float miracle::ease(AnimationDefinition const& definition, float t)
+{
+    float result;
+    ease_batch(definition, &t, &result, 1);
+    return result;
+}
+
+void miracle::ease_batch(AnimationDefinition const& definition, float const* in, float* out, size_t count)
+{
+    if (definition.ease_table)
+        definition.ease_table->evaluate(in, out, count);
+    else
+        ease_batch_exact(definition, in, out, count);
+}
+
+void miracle::ease_batch_exact(AnimationDefinition const& defintion, float const* in, float* out, size_t count)
+{
+    // https://easings.net/
+    switch (defintion.function)
+    {
+    case EaseFunction::linear:
+        return apply(in, out, count, [](float t)
+        { return t; });
+    case EaseFunction::ease_in_sine:
+        return apply(in, out, count, [](float t)
+        { return 1 - cosf((t * M_PI) / 2.f); });
+    case EaseFunction::ease_in_out_sine:
+        return apply(in, out, count, [](float t)
+        { return -(cosf(M_PI * t) - 1) / 2; });
+    case EaseFunction::ease_out_sine:
+        return apply(in, out, count, [](float t)
+        { return sinf((t * M_PI) / 2.f); });
+    case EaseFunction::ease_in_quad:
+        return apply(in, out, count, [](float t)
+        { return t * t; });
+    case EaseFunction::ease_out_quad:
+        return apply(in, out, count, [](float t)
+        { return 1 - (1 - t) * (1 - t); });
+    case EaseFunction::ease_in_out_quad:
+        return apply(in, out, count, [](float t)
+        { return t < 0.5 ? 2 * t * t : 1 - powf(-2 * t + 2, 2) / 2; });
+    case EaseFunction::ease_in_cubic:
+        return apply(in, out, count, [](float t)
+        { return t * t * t; });
+    case EaseFunction::ease_out_cubic:
+        return apply(in, out, count, [](float t)
+        { return 1 - powf(1 - t, 3); });
+    case EaseFunction::ease_in_out_cubic:
+        return apply(in, out, count, [](float t)
+        { return t < 0.5 ? 4 * t * t * t : 1 - powf(-2 * t + 2, 3) / 2; });
+    case EaseFunction::ease_in_quart:
+        return apply(in, out, count, [](float t)
+        { return t * t * t * t; });
+    case EaseFunction::ease_out_quart:
+        return apply(in, out, count, [](float t)
+        { return 1 - powf(1 - t, 4); });
+    case EaseFunction::ease_in_out_quart:
+        return apply(in, out, count, [](float t)
+        { return t < 0.5 ? 8 * t * t * t * t : 1 - powf(-2 * t + 2, 4) / 2; });
+    case EaseFunction::ease_in_quint:
+        return apply(in, out, count, [](float t)
+        { return t * t * t * t * t; });
+    case EaseFunction::ease_out_quint:
+        return apply(in, out, count, [](float t)
+        { return 1 - powf(1 - t, 5); });
+    case EaseFunction::ease_in_out_quint:
+        return apply(in, out, count, [](float t)
+        { return t < 0.5 ? 16 * t * t * t * t * t : 1 - powf(-2 * t + 2, 5) / 2; });
+    case EaseFunction::ease_in_expo:
+        return apply(in, out, count, [](float t)
+        { return t == 0 ? 0 : powf(2, 10 * t - 10); });
+    case EaseFunction::ease_out_expo:
+        return apply(in, out, count, [](float t)
+        { return t == 1 ? 1 : 1 - powf(2, -10 * t); });
+    case EaseFunction::ease_in_out_expo:
+        return apply(in, out, count, [](float t)
+        {
+            return t == 0
+                ? 0
+                : t == 1
+                ? 1
+                : t < 0.5 ? powf(2, 20 * t - 10) / 2
+                          : (2 - powf(2, -20 * t + 10)) / 2;
+        });
+    case EaseFunction::ease_in_circ:
+        return apply(in, out, count, [](float t)
+        { return 1 - sqrtf(1 - powf(t, 2)); });
+    case EaseFunction::ease_out_circ:
+        return apply(in, out, count, [](float t)
+        { return sqrtf(1 - powf(t - 1, 2)); });
+    case EaseFunction::ease_in_out_circ:
+        return apply(in, out, count, [](float t)
+        {
+            return t < 0.5f
+                ? (1 - sqrtf(1 - powf(2 * t, 2))) / 2
+                : (sqrtf(1 - powf(-2 * t + 2, 2)) + 1) / 2;
+        });
+    case EaseFunction::ease_in_back:
+        return apply(in, out, count, [c1 = defintion.c1, c3 = defintion.c3](float t)
+        { return c3 * t * t * t - c1 * t * t; });
+    case EaseFunction::ease_out_back:
+        return apply(in, out, count, [c1 = defintion.c1, c3 = defintion.c3](float t)
+        { return 1 + c3 * powf(t - 1, 3) + c1 * powf(t - 1, 2); });
+    case EaseFunction::ease_in_out_back:
+        return apply(in, out, count, [c2 = defintion.c2](float t)
+        {
+            return t < 0.5
+                ? (powf(2 * t, 2) * ((c2 + 1) * 2 * t - c2)) / 2
+                : (powf(2 * t - 2, 2) * ((c2 + 1) * (t * 2 - 2) + c2) + 2) / 2;
+        });
+    case EaseFunction::ease_in_elastic:
+        return apply(in, out, count, [c4 = defintion.c4](float t)
+        {
+            return t == 0
+                ? 0
+                : t == 1
+                ? 1
+                : -powf(2, 10 * t - 10) * sinf((t * 10 - 10.75f) * c4);
+        });
+    case EaseFunction::ease_out_elastic:
+        return apply(in, out, count, [c4 = defintion.c4](float t)
+        {
+            return t == 0
+                ? 0
+                : t == 1
+                ? 1
+                : powf(2, -10 * t) * sinf((t * 10 - 0.75f) * c4) + 1;
+        });
+    case EaseFunction::ease_in_out_elastic:
+        return apply(in, out, count, [c5 = defintion.c5](float t)
+        {
+            return t == 0
+                ? 0
+                : t == 1
+                ? 1
+                : t < 0.5
+                ? -(powf(2, 20 * t - 10) * sinf((20 * t - 11.125f) * c5)) / 2
+                : (powf(2, -20 * t + 10) * sinf((20 * t - 11.125f) * c5)) / 2 + 1;
+        });
+    case EaseFunction::ease_in_bounce:
+        return apply(in, out, count, [&](float t)
+        { return 1 - ease_out_bounce(defintion, 1 - t); });
+    case EaseFunction::ease_out_bounce:
+        return apply(in, out, count, [&](float t)
+        { return ease_out_bounce(defintion, t); });
+    case EaseFunction::ease_in_out_bounce:
+        return apply(in, out, count, [&](float t)
+        {
+            return t < 0.5
+                ? (1 - ease_out_bounce(defintion, 1 - 2 * t)) / 2
+                : (1 + ease_out_bounce(defintion, 2 * t - 1)) / 2;
+        });
+    default:
+        return apply(in, out, count, [](float)
+        { return 1.f; });
+    }
+}
+
+EaseTable::EaseTable(AnimationDefinition const& definition)
+{
+    std::array<float, resolution + 1> t;
+    for (size_t i = 0; i <= resolution; i++)
+        t[i] = static_cast<float>(i) / static_cast<float>(resolution);
+
+    ease_batch_exact(definition, t.data(), samples.data(), samples.size());
+}
+
+float EaseTable::operator()(float t) const
+{
+    float const x = std::clamp(t, 0.f, 1.f) * static_cast<float>(resolution);
+    auto const i = std::min(static_cast<size_t>(x), resolution - 1);
+    float const fraction = x - static_cast<float>(i);
+    return samples[i] + (samples[i + 1] - samples[i]) * fraction;
+}
+
+void EaseTable::evaluate(float const* t, float* out, size_t count) const
+{
+    for (size_t i = 0; i < count; i++)
+        out[i] = (*this)(t[i]);
+}
+
+bool miracle::has_ease_table(EaseFunction function)
+{
+    // Only the functions that call into libm are worth sampling. The circular
+    // functions are left out, as their slopes are too steep to interpolate, and
+    // bounce is no slower to evaluate than the table.
+    switch (function)
+    {
+    case EaseFunction::ease_in_sine:
+    case EaseFunction::ease_out_sine:
+    case EaseFunction::ease_in_out_sine:
+    case EaseFunction::ease_out_cubic:
+    case EaseFunction::ease_in_out_cubic:
+    case EaseFunction::ease_out_quart:
+    case EaseFunction::ease_in_out_quart:
+    case EaseFunction::ease_out_quint:
+    case EaseFunction::ease_in_out_quint:
+    case EaseFunction::ease_in_expo:
+    case EaseFunction::ease_out_expo:
+    case EaseFunction::ease_in_out_expo:
+    case EaseFunction::ease_out_back:
+    case EaseFunction::ease_in_elastic:
+    case EaseFunction::ease_out_elastic:
+    case EaseFunction::ease_in_out_elastic:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void miracle::compile_ease_table(AnimationDefinition& definition)
+{
+    if (has_ease_table(definition.function))
+        definition.ease_table = std::make_shared<EaseTable const>(definition);
+    else
+        definition.ease_table = nullptr;
+}
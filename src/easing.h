@@ -0,0 +1,72 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_EASING_H
+#define MIRACLE_WM_EASING_H
+
+#include "animation_defintion.h"
+#include <array>
+#include <cstddef>
+
+namespace miracle
+{
+
+/// Evaluates the ease function of [definition] at [t], where t is in [0, 1].
+///
+/// The definition's ease table is used when it has one.
+float ease(AnimationDefinition const& definition, float t);
+
+/// Evaluates the ease function of [definition] for each of the [count] values
+/// in [t], writing the results to [out].
+///
+/// The definition's ease table is used when it has one. Otherwise, the function
+/// is selected once for the whole batch, leaving a tight loop per function that
+/// the compiler is free to vectorize.
+void ease_batch(AnimationDefinition const& definition, float const* t, float* out, size_t count);
+
+/// Like [ease_batch], but always evaluates the ease function analytically.
+void ease_batch_exact(AnimationDefinition const& definition, float const* t, float* out, size_t count);
+
+/// A sampling of an ease function at evenly spaced points in [0, 1].
+///
+/// Evaluating the table is a lookup and a lerp, which spares the animator the
+/// powf, sinf and cosf of the more elaborate functions on every step.
+class EaseTable
+{
+public:
+    static constexpr size_t resolution = 1024;
+
+    explicit EaseTable(AnimationDefinition const& definition);
+
+    [[nodiscard]] float operator()(float t) const;
+    void evaluate(float const* t, float* out, size_t count) const;
+
+private:
+    std::array<float, resolution + 1> samples;
+};
+
+/// Whether or not sampling [function] into an EaseTable is faster than evaluating
+/// it while staying accurate.
+bool has_ease_table(EaseFunction function);
+
+/// Builds the ease table of [definition] from its current parameters, or clears
+/// it if the function of [definition] is better evaluated analytically.
+void compile_ease_table(AnimationDefinition& definition);
+
+} // miracle
+
+#endif // MIRACLE_WM_EASING_H
@@ -0,0 +1,382 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#define MIR_LOG_COMPONENT "event_recording"
+
+#include "event_recording.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <istream>
+#include <mir/log.h>
+#include <ostream>
+
+using namespace miracle;
+
+namespace
+{
+void write_varint(std::ostream& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.put(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.put(static_cast<char>(value));
+}
+
+void write_signed(std::ostream& out, int64_t value)
+{
+    write_varint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void write_float(std::ostream& out, float value)
+{
+    auto const bits = std::bit_cast<uint32_t>(value);
+    for (int i = 0; i < 4; i++)
+        out.put(static_cast<char>((bits >> (i * 8)) & 0xff));
+}
+
+void write_string(std::ostream& out, std::string const& value)
+{
+    write_varint(out, value.size());
+    out.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+void write_rectangle(std::ostream& out, mir::geometry::Rectangle const& area)
+{
+    write_signed(out, area.top_left.x.as_int());
+    write_signed(out, area.top_left.y.as_int());
+    write_signed(out, area.size.width.as_int());
+    write_signed(out, area.size.height.as_int());
+}
+
+/// Reads the fields of an event, remembering whether any of them ran past the
+/// end of the stream.
+class FieldReader
+{
+public:
+    explicit FieldReader(std::istream& in) :
+        in { in }
+    {
+    }
+
+    uint64_t varint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            auto const c = in.get();
+            if (c == std::char_traits<char>::eof())
+                break;
+
+            value |= static_cast<uint64_t>(c & 0x7f) << shift;
+            if ((c & 0x80) == 0)
+                return value;
+        }
+
+        failed = true;
+        return 0;
+    }
+
+    uint32_t u32() { return static_cast<uint32_t>(varint()); }
+
+    int32_t i32()
+    {
+        auto const value = varint();
+        return static_cast<int32_t>(static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1));
+    }
+
+    float f32()
+    {
+        uint32_t bits = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            auto const c = in.get();
+            if (c == std::char_traits<char>::eof())
+            {
+                failed = true;
+                return 0;
+            }
+            bits |= static_cast<uint32_t>(c & 0xff) << (i * 8);
+        }
+        return std::bit_cast<float>(bits);
+    }
+
+    std::string string()
+    {
+        auto const size = varint();
+        std::string value;
+        if (failed || size > max_string_size)
+        {
+            failed = true;
+            return value;
+        }
+
+        value.resize(size);
+        in.read(value.data(), static_cast<std::streamsize>(size));
+        if (in.gcount() != static_cast<std::streamsize>(size))
+            failed = true;
+        return value;
+    }
+
+    mir::geometry::Rectangle rectangle()
+    {
+        auto const x = i32();
+        auto const y = i32();
+        auto const width = i32();
+        auto const height = i32();
+        return { mir::geometry::Point(x, y), mir::geometry::Size(width, height) };
+    }
+
+    bool failed = false;
+
+private:
+    /// Guards against corrupt lengths. No command comes close to this.
+    static constexpr uint64_t max_string_size = 1 << 20;
+
+    std::istream& in;
+};
+
+struct PayloadWriter
+{
+    std::ostream& out;
+
+    void operator()(RecordedWindowOpened const& e) const
+    {
+        write_varint(out, e.id);
+        write_rectangle(out, e.area);
+        write_varint(out, e.type);
+        write_varint(out, e.state);
+    }
+
+    void operator()(RecordedWindowClosed const& e) const
+    {
+        write_varint(out, e.id);
+    }
+
+    void operator()(RecordedKeyboardEvent const& e) const
+    {
+        write_varint(out, e.action);
+        write_varint(out, e.keysym);
+        write_signed(out, e.scan_code);
+        write_varint(out, e.modifiers);
+    }
+
+    void operator()(RecordedPointerEvent const& e) const
+    {
+        write_varint(out, e.action);
+        write_float(out, e.x);
+        write_float(out, e.y);
+        write_varint(out, e.buttons);
+        write_varint(out, e.modifiers);
+    }
+
+    void operator()(RecordedIpcCommand const& e) const
+    {
+        write_string(out, e.command);
+    }
+
+    void operator()(RecordedOutputEvent const& e) const
+    {
+        out.put(static_cast<char>(e.change));
+        write_signed(out, e.id);
+        write_string(out, e.name);
+        write_rectangle(out, e.area);
+    }
+};
+
+std::optional<RecordedPayload> read_payload(FieldReader& r, size_t index)
+{
+    switch (index)
+    {
+    case 0:
+    {
+        RecordedWindowOpened e;
+        e.id = r.u32();
+        e.area = r.rectangle();
+        e.type = r.u32();
+        e.state = r.u32();
+        return e;
+    }
+    case 1:
+        return RecordedWindowClosed { r.u32() };
+    case 2:
+    {
+        RecordedKeyboardEvent e;
+        e.action = r.u32();
+        e.keysym = r.u32();
+        e.scan_code = r.i32();
+        e.modifiers = r.u32();
+        return e;
+    }
+    case 3:
+    {
+        RecordedPointerEvent e;
+        e.action = r.u32();
+        e.x = r.f32();
+        e.y = r.f32();
+        e.buttons = r.u32();
+        e.modifiers = r.u32();
+        return e;
+    }
+    case 4:
+        return RecordedIpcCommand { r.string() };
+    case 5:
+    {
+        RecordedOutputEvent e;
+        auto const change = r.u32();
+        if (change > static_cast<uint32_t>(RecordedOutputChange::deleted))
+            return std::nullopt;
+        e.change = static_cast<RecordedOutputChange>(change);
+        e.id = r.i32();
+        e.name = r.string();
+        e.area = r.rectangle();
+        return e;
+    }
+    default:
+        return std::nullopt;
+    }
+}
+}
+
+EventWriter::EventWriter(std::ostream& out) :
+    out { out }
+{
+    out.write(magic.data(), static_cast<std::streamsize>(magic.size()));
+    out.put(static_cast<char>(version));
+}
+
+void EventWriter::write(RecordedEvent const& event)
+{
+    auto const delta = std::max(event.time - last_time, std::chrono::microseconds(0));
+    last_time = std::max(event.time, last_time);
+    out.put(static_cast<char>(event.payload.index()));
+    write_varint(out, static_cast<uint64_t>(delta.count()));
+    std::visit(PayloadWriter { out }, event.payload);
+}
+
+EventReader::EventReader(std::istream& in) :
+    in { in }
+{
+    std::string header(EventWriter::magic.size(), '\0');
+    in.read(header.data(), static_cast<std::streamsize>(header.size()));
+    valid_ = in.gcount() == static_cast<std::streamsize>(header.size())
+        && header == EventWriter::magic
+        && in.get() == EventWriter::version;
+}
+
+std::optional<RecordedEvent> EventReader::next()
+{
+    if (!valid_)
+        return std::nullopt;
+
+    auto const index = in.get();
+    if (index == std::char_traits<char>::eof())
+        return std::nullopt;
+
+    FieldReader reader(in);
+    auto const delta = std::chrono::microseconds(reader.varint());
+    auto payload = read_payload(reader, static_cast<size_t>(index));
+    if (!payload || reader.failed)
+    {
+        valid_ = false;
+        return std::nullopt;
+    }
+
+    last_time += delta;
+    return RecordedEvent { last_time, std::move(payload.value()) };
+}
+
+EventRecorder& EventRecorder::instance()
+{
+    static EventRecorder recorder;
+    return recorder;
+}
+
+EventRecorder::~EventRecorder()
+{
+    stop();
+}
+
+bool EventRecorder::start(std::string const& path)
+{
+    std::lock_guard lock(mutex);
+    writer.reset();
+    file = std::ofstream(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        mir::log_error("Unable to record events to %s: %s", path.c_str(), strerror(errno));
+        recording = false;
+        return false;
+    }
+
+    writer.emplace(file);
+    start_time = clock::now();
+    unflushed = 0;
+    next_window_id = 1;
+    window_ids.clear();
+    recording = true;
+    mir::log_info("Recording events to %s", path.c_str());
+    return true;
+}
+
+void EventRecorder::stop()
+{
+    std::lock_guard lock(mutex);
+    recording = false;
+    writer.reset();
+    if (file.is_open())
+        file.close();
+}
+
+void EventRecorder::record(RecordedPayload payload)
+{
+    std::lock_guard lock(mutex);
+    if (!writer)
+        return;
+
+    auto const time = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start_time);
+    writer->write({ time, std::move(payload) });
+    if (++unflushed >= flush_interval)
+    {
+        file.flush();
+        unflushed = 0;
+    }
+}
+
+uint32_t EventRecorder::window_id(void const* window)
+{
+    std::lock_guard lock(mutex);
+    auto [it, inserted] = window_ids.try_emplace(window, next_window_id);
+    if (inserted)
+        next_window_id++;
+    return it->second;
+}
+
+uint32_t EventRecorder::forget_window(void const* window)
+{
+    std::lock_guard lock(mutex);
+    auto const it = window_ids.find(window);
+    if (it == window_ids.end())
+        return 0;
+
+    auto const id = it->second;
+    window_ids.erase(it);
+    return id;
+}
@@ -0,0 +1,189 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_EVENT_RECORDING_H
+#define MIRACLE_WM_EVENT_RECORDING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mir/geometry/rectangle.h>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+
+namespace miracle
+{
+
+/// A window that was opened. The enums of Mir are stored as integers so that
+/// recordings can be read without the server.
+struct RecordedWindowOpened
+{
+    uint32_t id = 0;
+    mir::geometry::Rectangle area;
+    uint32_t type = 0;
+    uint32_t state = 0;
+};
+
+struct RecordedWindowClosed
+{
+    uint32_t id = 0;
+};
+
+struct RecordedKeyboardEvent
+{
+    uint32_t action = 0;
+    uint32_t keysym = 0;
+    int32_t scan_code = 0;
+    uint32_t modifiers = 0;
+};
+
+struct RecordedPointerEvent
+{
+    uint32_t action = 0;
+    float x = 0;
+    float y = 0;
+    uint32_t buttons = 0;
+    uint32_t modifiers = 0;
+};
+
+struct RecordedIpcCommand
+{
+    std::string command;
+};
+
+enum class RecordedOutputChange : uint8_t
+{
+    created,
+    updated,
+    deleted
+};
+
+struct RecordedOutputEvent
+{
+    RecordedOutputChange change = RecordedOutputChange::created;
+    int32_t id = 0;
+    std::string name;
+    mir::geometry::Rectangle area;
+};
+
+using RecordedPayload = std::variant<
+    RecordedWindowOpened,
+    RecordedWindowClosed,
+    RecordedKeyboardEvent,
+    RecordedPointerEvent,
+    RecordedIpcCommand,
+    RecordedOutputEvent>;
+
+/// An event that the policy handled, at [time] after the recording started.
+struct RecordedEvent
+{
+    std::chrono::microseconds time { 0 };
+    RecordedPayload payload;
+};
+
+/// Writes events to a recording.
+///
+/// The recording starts with a magic string and a version. Each event is its
+/// type in one byte, followed by the time since the previous event and its
+/// fields, with integers as LEB128 varints.
+class EventWriter
+{
+public:
+    static constexpr std::string_view magic = "MIRACLE-EVENTS";
+    static constexpr uint8_t version = 1;
+
+    explicit EventWriter(std::ostream& out);
+    void write(RecordedEvent const& event);
+
+private:
+    std::ostream& out;
+    std::chrono::microseconds last_time { 0 };
+};
+
+/// Reads back the events of [EventWriter].
+class EventReader
+{
+public:
+    explicit EventReader(std::istream& in);
+
+    /// Whether the stream starts with a recording header of a known version.
+    [[nodiscard]] bool valid() const { return valid_; }
+
+    /// Returns the next event, or nothing at the end of the recording. A
+    /// recording that was cut short, as when the compositor crashed, ends at
+    /// its last complete event.
+    std::optional<RecordedEvent> next();
+
+private:
+    std::istream& in;
+    bool valid_ = false;
+    std::chrono::microseconds last_time { 0 };
+};
+
+/// Records the events that the policy handles to a file, so that a session can
+/// be replayed with miracle-wm-replay. Recording is opt-in with --record-events.
+class EventRecorder
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    /// The recorder of this process.
+    static EventRecorder& instance();
+
+    /// Starts recording to [path], returning false if it cannot be opened.
+    bool start(std::string const& path);
+    void stop();
+
+    /// Checked before building an event, so that the policy pays nothing when
+    /// it is not being recorded.
+    [[nodiscard]] bool is_recording() const { return recording.load(std::memory_order_relaxed); }
+
+    void record(RecordedPayload payload);
+
+    /// Returns the id under which [window] is recorded. Windows are numbered in
+    /// the order that they are opened.
+    uint32_t window_id(void const* window);
+
+    /// Like [window_id], but the id is not handed out again for [window].
+    uint32_t forget_window(void const* window);
+
+private:
+    EventRecorder() = default;
+    ~EventRecorder();
+
+    /// The file is flushed after this many events, so that little of a
+    /// session is lost if the compositor crashes.
+    static constexpr size_t flush_interval = 256;
+
+    std::atomic<bool> recording = false;
+    std::mutex mutex;
+    std::ofstream file;
+    std::optional<EventWriter> writer;
+    clock::time_point start_time;
+    size_t unflushed = 0;
+    uint32_t next_window_id = 1;
+    std::unordered_map<void const*, uint32_t> window_ids;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_EVENT_RECORDING_H
@@ -20,5 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define MIRACLE_FEATURE_FLAG_MULTI_SELECT false
 #define MIRACLE_FEATURE_FLAG_DRAG_AND_DROP true
+#define MIRACLE_FEATURE_FLAG_TRACING true
+#define MIRACLE_FEATURE_FLAG_DEBUG_LOG true
 
 #endif // MIRACLE_WM_FEATURE_FLAGS_H
@@ -0,0 +1,85 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace miracle;
+
+FrameArena::FrameArena(size_t capacity) :
+    block { std::make_unique_for_overwrite<std::byte[]>(capacity) },
+    block_size { capacity },
+    heap_allocations_ { 1 }
+{
+}
+
+void* FrameArena::bump(std::byte* data, size_t size, size_t& offset, size_t bytes, size_t alignment)
+{
+    auto const base = reinterpret_cast<std::uintptr_t>(data);
+    auto const start = (base + offset + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1);
+    auto const end = start - base + bytes;
+    if (end > size)
+        return nullptr;
+
+    offset = end;
+    return reinterpret_cast<void*>(start);
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment)
+{
+    size = std::max<size_t>(size, 1);
+    std::byte* const data = overflow.empty() ? block.get() : overflow.back().data.get();
+    size_t const available = overflow.empty() ? block_size : overflow.back().size;
+    size_t& cursor = overflow.empty() ? offset : overflow_offset;
+    size_t const before = cursor;
+    if (auto result = bump(data, available, cursor, size, alignment))
+    {
+        used_ += cursor - before;
+        return result;
+    }
+
+    // The frame has outgrown the arena until the next reset
+    auto const overflow_size = std::max(block_size, size + alignment);
+    overflow.push_back({ std::make_unique_for_overwrite<std::byte[]>(overflow_size), overflow_size });
+    heap_allocations_++;
+    overflow_offset = 0;
+    auto result = bump(overflow.back().data.get(), overflow_size, overflow_offset, size, alignment);
+    used_ += overflow_offset;
+    return result;
+}
+
+void FrameArena::reset()
+{
+    if (!overflow.empty())
+    {
+        // Make room for everything that this frame needed, with some to spare
+        size_t needed = block_size;
+        for (auto const& extra : overflow)
+            needed += extra.size;
+
+        block_size = needed + needed / 2;
+        block = std::make_unique_for_overwrite<std::byte[]>(block_size);
+        heap_allocations_++;
+        overflow.clear();
+    }
+
+    offset = 0;
+    overflow_offset = 0;
+    used_ = 0;
+}
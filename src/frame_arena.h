@@ -0,0 +1,118 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_FRAME_ARENA_H
+#define MIRACLE_WM_FRAME_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace miracle
+{
+
+/// A bump allocator for scratch data that only lives for a single frame.
+///
+/// Allocations are carved out of one block that is kept from frame to frame,
+/// and freeing them is a matter of resetting the arena. When a frame outgrows
+/// the block, the excess goes to overflow blocks, and the next reset replaces
+/// all of them with a single block that fits them. A renderer that draws a
+/// similar scene every frame thus stops touching the heap after a few frames.
+class FrameArena
+{
+public:
+    explicit FrameArena(size_t capacity = 64 * 1024);
+
+    FrameArena(FrameArena const&) = delete;
+    FrameArena& operator=(FrameArena const&) = delete;
+
+    /// Returns [size] bytes aligned to [alignment], which must be a power of two.
+    void* allocate(size_t size, size_t alignment);
+
+    /// Frees everything that was allocated since the last reset.
+    void reset();
+
+    /// The bytes allocated since the last reset, including alignment padding.
+    [[nodiscard]] size_t used() const { return used_; }
+    [[nodiscard]] size_t capacity() const { return block_size; }
+
+    /// The number of blocks that the arena has taken from the heap.
+    [[nodiscard]] size_t heap_allocations() const { return heap_allocations_; }
+
+private:
+    struct Block
+    {
+        std::unique_ptr<std::byte[]> data;
+        size_t size = 0;
+    };
+
+    /// Bumps [offset] within [data] of [size], or returns nullptr if it does not fit.
+    static void* bump(std::byte* data, size_t size, size_t& offset, size_t bytes, size_t alignment);
+
+    std::unique_ptr<std::byte[]> block;
+    size_t block_size;
+    size_t offset = 0;
+    std::vector<Block> overflow;
+    size_t overflow_offset = 0;
+    size_t used_ = 0;
+    size_t heap_allocations_ = 0;
+};
+
+/// Allocates from a [FrameArena], so that standard containers may hold per-frame
+/// data. Deallocation does nothing: the memory is reclaimed when the arena is reset.
+template <typename T>
+class FrameArenaAllocator
+{
+public:
+    using value_type = T;
+
+    explicit FrameArenaAllocator(FrameArena& arena) noexcept :
+        arena { &arena }
+    {
+    }
+
+    template <typename U>
+    FrameArenaAllocator(FrameArenaAllocator<U> const& other) noexcept :
+        arena { other.arena }
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) noexcept
+    {
+    }
+
+    template <typename U>
+    bool operator==(FrameArenaAllocator<U> const& other) const noexcept { return arena == other.arena; }
+
+private:
+    template <typename U>
+    friend class FrameArenaAllocator;
+
+    FrameArena* arena;
+};
+
+template <typename T>
+using FrameVector = std::vector<T, FrameArenaAllocator<T>>;
+
+} // miracle
+
+#endif // MIRACLE_WM_FRAME_ARENA_H
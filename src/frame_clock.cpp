@@ -0,0 +1,149 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "frame_clock.h"
+
+#include <algorithm>
+
+using namespace miracle;
+using namespace std::chrono_literals;
+
+namespace
+{
+/// Outputs only render when something changes, so frames that are further apart
+/// than this are a gap in rendering rather than a measure of the refresh rate.
+constexpr std::chrono::nanoseconds idle_threshold = 100ms;
+constexpr std::chrono::nanoseconds min_interval = 1ms;
+constexpr std::chrono::nanoseconds default_interval = 16'666'667ns;
+}
+
+void FrameClock::on_frame(void const* output, clock::time_point time)
+{
+    std::lock_guard lock(mutex);
+    auto& timing = outputs[output];
+    if (timing.last_frame != clock::time_point {})
+    {
+        auto const delta = time - timing.last_frame;
+        if (delta >= min_interval && delta < idle_threshold)
+        {
+            // A moving average smooths out the jitter of individual frames
+            timing.interval = timing.interval
+                ? (timing.interval.value() * 7 + delta) / 8
+                : std::chrono::nanoseconds(delta);
+        }
+    }
+    timing.last_frame = time;
+
+    if (fastest_output(time) == output)
+    {
+        sequence++;
+        cv.notify_all();
+    }
+}
+
+void FrameClock::remove(void const* output)
+{
+    std::lock_guard lock(mutex);
+    outputs.erase(output);
+}
+
+void FrameClock::on_render_time(void const* output, std::chrono::nanoseconds duration)
+{
+    std::lock_guard lock(mutex);
+    auto& timing = outputs[output];
+    timing.render_time = timing.render_time
+        ? (timing.render_time.value() * 7 + duration) / 8
+        : duration;
+}
+
+bool FrameClock::wait_for_frame(std::chrono::nanoseconds timeout)
+{
+    std::unique_lock lock(mutex);
+    auto const current = sequence;
+    return cv.wait_for(lock, timeout, [&]
+    {
+        return sequence != current;
+    });
+}
+
+std::chrono::nanoseconds FrameClock::refresh_interval() const
+{
+    std::lock_guard lock(mutex);
+    auto const fastest = fastest_output(clock::now());
+    if (!fastest)
+        return default_interval;
+
+    return outputs.at(fastest).interval.value_or(default_interval);
+}
+
+FrameClock::clock::time_point FrameClock::next_frame_time(clock::time_point now) const
+{
+    std::lock_guard lock(mutex);
+    auto const fastest = fastest_output(now);
+    if (!fastest)
+        return now;
+
+    auto const& timing = outputs.at(fastest);
+    auto const interval = timing.interval.value_or(default_interval);
+    auto next = timing.last_frame + interval;
+
+    // A frame that was due but has not been presented is skipped rather than waited for.
+    if (next < now)
+        next += interval * ((now - next) / interval + 1);
+    return next;
+}
+
+std::chrono::nanoseconds FrameClock::render_time() const
+{
+    std::lock_guard lock(mutex);
+    auto const now = clock::now();
+    std::chrono::nanoseconds slowest { 0 };
+    for (auto const& [output, timing] : outputs)
+    {
+        if (now - timing.last_frame > idle_threshold || !timing.render_time)
+            continue;
+
+        slowest = std::max(slowest, timing.render_time.value());
+    }
+
+    return slowest;
+}
+
+void const* FrameClock::fastest_output(clock::time_point now) const
+{
+    void const* fastest = nullptr;
+    std::optional<std::chrono::nanoseconds> fastest_interval;
+    for (auto const& [output, timing] : outputs)
+    {
+        if (now - timing.last_frame > idle_threshold)
+            continue;
+
+        // Outputs that have yet to be measured are only used if nothing else is known.
+        if (!fastest)
+        {
+            fastest = output;
+            fastest_interval = timing.interval;
+        }
+        else if (timing.interval && (!fastest_interval || timing.interval.value() < fastest_interval.value()))
+        {
+            fastest = output;
+            fastest_interval = timing.interval;
+        }
+    }
+
+    return fastest;
+}
@@ -0,0 +1,84 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_FRAME_CLOCK_H
+#define MIRACLE_WM_FRAME_CLOCK_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace miracle
+{
+
+/// Follows the frames presented by each output so that work can be paced to
+/// the display rather than to a timer.
+///
+/// Only the frames of the fastest output that is actively rendering are
+/// counted, so that a mixed 60Hz and 144Hz setup ticks at 144Hz rather than
+/// at the sum of the two.
+class FrameClock
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    /// Called by a renderer each time that it presents a frame on [output].
+    void on_frame(void const* output, clock::time_point time = clock::now());
+    void remove(void const* output);
+
+    /// Called by a renderer with the time that it spent rendering its latest frame.
+    void on_render_time(void const* output, std::chrono::nanoseconds duration);
+
+    /// Blocks until the next counted frame is presented or until [timeout] elapses.
+    /// Returns true if a frame was presented.
+    bool wait_for_frame(std::chrono::nanoseconds timeout);
+
+    /// The estimated refresh interval of the fastest active output. Defaults to
+    /// 60Hz until an output has presented a few frames.
+    [[nodiscard]] std::chrono::nanoseconds refresh_interval() const;
+
+    /// The time at which the fastest active output is expected to present its next
+    /// frame, estimated from its last frame and its refresh interval. Returns [now]
+    /// if no output is active.
+    [[nodiscard]] clock::time_point next_frame_time(clock::time_point now = clock::now()) const;
+
+    /// The estimated render time of the slowest active output, or zero if no
+    /// output has rendered recently.
+    [[nodiscard]] std::chrono::nanoseconds render_time() const;
+
+private:
+    struct OutputTiming
+    {
+        clock::time_point last_frame;
+        std::optional<std::chrono::nanoseconds> interval;
+        std::optional<std::chrono::nanoseconds> render_time;
+    };
+
+    [[nodiscard]] void const* fastest_output(clock::time_point now) const;
+
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    std::unordered_map<void const*, OutputTiming> outputs;
+    std::uint64_t sequence = 0;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_FRAME_CLOCK_H
@@ -0,0 +1,62 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_FUNCTION_REF_H
+#define MIRACLE_WM_FUNCTION_REF_H
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace miracle
+{
+
+template <typename Signature>
+class FunctionRef;
+
+/// A non-owning reference to a callable, for visitors that are passed through
+/// virtual functions. Unlike std::function, it neither allocates nor copies the
+/// callable, so the callable must outlive the reference. In practice, it is
+/// given a lambda as an argument and only used for the duration of the call.
+template <typename R, typename... Args>
+class FunctionRef<R(Args...)>
+{
+public:
+    template <typename F>
+    requires(!std::is_same_v<std::remove_cvref_t<F>, FunctionRef> && std::is_invocable_r_v<R, F&, Args...>)
+    FunctionRef(F&& f) noexcept :
+        object { const_cast<void*>(static_cast<void const*>(std::addressof(f))) },
+        callback { [](void* object, Args... args) -> R
+        {
+            return (*static_cast<std::remove_reference_t<F>*>(object))(std::forward<Args>(args)...);
+        } }
+    {
+    }
+
+    R operator()(Args... args) const
+    {
+        return callback(object, std::forward<Args>(args)...);
+    }
+
+private:
+    void* object;
+    R (*callback)(void*, Args...);
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_FUNCTION_REF_H
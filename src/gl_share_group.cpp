@@ -0,0 +1,123 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "gl_share_group.h"
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <vector>
+
+using namespace miracle;
+
+namespace
+{
+/// Marks the probes apart from whatever else a texture of the same name might hold.
+constexpr GLubyte probe_marker = 0x5a;
+
+struct Probe
+{
+    EGLDisplay display;
+    GLuint texture;
+    uint32_t id;
+    int members;
+};
+
+std::mutex probes_mutex;
+std::vector<Probe> probes;
+uint32_t next_id = 1;
+
+std::array<GLubyte, 4> pixel_of(uint32_t id)
+{
+    return {
+        static_cast<GLubyte>(id & 0xff),
+        static_cast<GLubyte>((id >> 8) & 0xff),
+        static_cast<GLubyte>((id >> 16) & 0xff),
+        probe_marker
+    };
+}
+
+/// Whether the current context sees [probe] as the probe texture that it is.
+bool can_read(Probe const& probe)
+{
+    if (probe.display != eglGetCurrentDisplay() || !glIsTexture(probe.texture))
+        return false;
+
+    GLint previous_framebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+
+    GLuint framebuffer = 0;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, probe.texture, 0);
+
+    std::array<GLubyte, 4> pixel {};
+    auto const is_complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (is_complete)
+        glReadPixels(0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel.data());
+
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previous_framebuffer));
+    glDeleteFramebuffers(1, &framebuffer);
+    return is_complete && pixel == pixel_of(probe.id);
+}
+}
+
+GlShareGroup::GlShareGroup()
+{
+    std::lock_guard lock(probes_mutex);
+    for (auto& probe : probes)
+    {
+        if (can_read(probe))
+        {
+            probe.members++;
+            id_ = probe.id;
+            return;
+        }
+    }
+
+    id_ = next_id++;
+    auto const pixel = pixel_of(id_);
+
+    GLint previous_texture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous_texture);
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel.data());
+    glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(previous_texture));
+
+    // The contexts that probe it next may be on other threads
+    glFinish();
+    probes.push_back({ eglGetCurrentDisplay(), texture, id_, 1 });
+}
+
+GlShareGroup::~GlShareGroup()
+{
+    std::lock_guard lock(probes_mutex);
+    auto const it = std::ranges::find(probes, id_, &Probe::id);
+    if (it == probes.end() || --it->members > 0)
+        return;
+
+    // Any context of the group may delete the probe, as they all share it
+    glDeleteTextures(1, &it->texture);
+    probes.erase(it);
+}
@@ -0,0 +1,53 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_GL_SHARE_GROUP_H
+#define MIRACLE_WM_GL_SHARE_GROUP_H
+
+#include <cstdint>
+
+namespace miracle
+{
+
+/// The set of GL contexts that the current context shares its textures with.
+///
+/// Texture names are per context, so a name that is valid in one context says
+/// nothing about whether another context sees the same texture. Instead, the
+/// first context of each group creates a small probe texture that holds the id of
+/// the group. A context joins a group when it can read that id back out of the
+/// probe of the group, and starts a new group of its own otherwise.
+///
+/// Must be constructed and destroyed with the same GL context current.
+class GlShareGroup
+{
+public:
+    GlShareGroup();
+    ~GlShareGroup();
+
+    GlShareGroup(GlShareGroup const&) = delete;
+    GlShareGroup& operator=(GlShareGroup const&) = delete;
+
+    /// The same for every context that shares textures with this one. Never 0.
+    [[nodiscard]] uint32_t id() const { return id_; }
+
+private:
+    uint32_t id_;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_GL_SHARE_GROUP_H
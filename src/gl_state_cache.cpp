@@ -0,0 +1,178 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "gl_state_cache.h"
+
+#include <cstring>
+#include <glm/gtc/type_ptr.hpp>
+
+using namespace miracle;
+
+void GLStateCache::begin_frame()
+{
+    stats_ = {};
+    program.reset();
+    texture_unit.reset();
+    blend_enabled.reset();
+    stencil_enabled.reset();
+    scissor_enabled.reset();
+    blend_func.reset();
+    blend_color_.reset();
+    stencil_func_.reset();
+    stencil_op_.reset();
+    stencil_mask_.reset();
+    scissor_.reset();
+}
+
+void GLStateCache::invalidate_active_texture()
+{
+    texture_unit.reset();
+}
+
+bool GLStateCache::update(bool changed)
+{
+    if (changed)
+        stats_.issued++;
+    else
+        stats_.skipped++;
+    return changed;
+}
+
+void GLStateCache::use_program(GLuint next)
+{
+    if (update(program, next))
+        glUseProgram(next);
+}
+
+void GLStateCache::active_texture(GLenum unit)
+{
+    if (update(texture_unit, unit))
+        glActiveTexture(unit);
+}
+
+void GLStateCache::set_enabled(GLenum capability, bool enabled)
+{
+    std::optional<bool>* current = nullptr;
+    switch (capability)
+    {
+    case GL_BLEND:
+        current = &blend_enabled;
+        break;
+    case GL_STENCIL_TEST:
+        current = &stencil_enabled;
+        break;
+    case GL_SCISSOR_TEST:
+        current = &scissor_enabled;
+        break;
+    default:
+        break;
+    }
+
+    if (current && !update(*current, enabled))
+        return;
+
+    if (enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+void GLStateCache::blend_func_separate(GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha)
+{
+    if (update(blend_func, { src_rgb, dst_rgb, src_alpha, dst_alpha }))
+        glBlendFuncSeparate(src_rgb, dst_rgb, src_alpha, dst_alpha);
+}
+
+void GLStateCache::blend_color(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+{
+    if (update(blend_color_, { r, g, b, a }))
+        glBlendColor(r, g, b, a);
+}
+
+void GLStateCache::stencil_func(GLenum func, GLint ref, GLuint mask)
+{
+    if (update(stencil_func_, { func, static_cast<GLuint>(ref), mask }))
+        glStencilFunc(func, ref, mask);
+}
+
+void GLStateCache::stencil_op(GLenum fail, GLenum zfail, GLenum zpass)
+{
+    if (update(stencil_op_, { fail, zfail, zpass }))
+        glStencilOp(fail, zfail, zpass);
+}
+
+void GLStateCache::stencil_mask(GLuint mask)
+{
+    if (update(stencil_mask_, mask))
+        glStencilMask(mask);
+}
+
+void GLStateCache::scissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    if (update(scissor_, { x, y, width, height }))
+        glScissor(x, y, width, height);
+}
+
+bool GLStateCache::update_uniform(GLint location, void const* data, size_t size)
+{
+    if (location < 0 || !program)
+        return false;
+
+    auto const key = (static_cast<std::uint64_t>(program.value()) << 32) | static_cast<std::uint32_t>(location);
+    auto& value = uniforms[key];
+    if (value.size == size && memcmp(value.data.data(), data, size) == 0)
+        return update(false);
+
+    value.size = size;
+    memcpy(value.data.data(), data, size);
+    return update(true);
+}
+
+void GLStateCache::uniform(GLint location, GLint value)
+{
+    if (update_uniform(location, &value, sizeof(value)))
+        glUniform1i(location, value);
+}
+
+void GLStateCache::uniform(GLint location, GLfloat value)
+{
+    if (update_uniform(location, &value, sizeof(value)))
+        glUniform1f(location, value);
+}
+
+void GLStateCache::uniform(GLint location, glm::vec2 const& value)
+{
+    if (update_uniform(location, glm::value_ptr(value), sizeof(value)))
+        glUniform2f(location, value.x, value.y);
+}
+
+void GLStateCache::uniform(GLint location, glm::vec4 const& value)
+{
+    if (update_uniform(location, glm::value_ptr(value), sizeof(value)))
+        glUniform4f(location, value.x, value.y, value.z, value.w);
+}
+
+void GLStateCache::uniform(GLint location, glm::mat4 const& value)
+{
+    if (update_uniform(location, glm::value_ptr(value), sizeof(value)))
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+GLStateCacheStats const& GLStateCache::stats() const
+{
+    return stats_;
+}
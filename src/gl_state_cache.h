@@ -0,0 +1,109 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_GL_STATE_CACHE_H
+#define MIRACLE_WM_GL_STATE_CACHE_H
+
+#include <GLES2/gl2.h>
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <optional>
+#include <unordered_map>
+
+namespace miracle
+{
+
+struct GLStateCacheStats
+{
+    size_t issued = 0;
+    size_t skipped = 0;
+};
+
+/// Tracks the GL state that the renderer sets so that redundant calls can be
+/// skipped. Fixed-function state is forgotten at the start of every frame, as
+/// Mir may change it between frames. Uniform values live on the program
+/// objects, which only the renderer touches, so they are remembered for as
+/// long as the cache exists.
+class GLStateCache
+{
+public:
+    /// Forgets all fixed-function state and resets the per-frame statistics.
+    void begin_frame();
+
+    /// Forgets the active texture unit. Must be called after anything outside of
+    /// the cache (e.g. Texture::bind) may have changed it.
+    void invalidate_active_texture();
+
+    void use_program(GLuint program);
+    void active_texture(GLenum unit);
+    void set_enabled(GLenum capability, bool enabled);
+    void blend_func_separate(GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha);
+    void blend_color(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+    void stencil_func(GLenum func, GLint ref, GLuint mask);
+    void stencil_op(GLenum fail, GLenum zfail, GLenum zpass);
+    void stencil_mask(GLuint mask);
+    void scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+
+    /// Uniforms are set on the currently used program.
+    void uniform(GLint location, GLint value);
+    void uniform(GLint location, GLfloat value);
+    void uniform(GLint location, glm::vec2 const& value);
+    void uniform(GLint location, glm::vec4 const& value);
+    void uniform(GLint location, glm::mat4 const& value);
+
+    [[nodiscard]] GLStateCacheStats const& stats() const;
+
+private:
+    struct UniformValue
+    {
+        size_t size = 0;
+        std::array<std::uint32_t, 16> data {};
+    };
+
+    /// Returns true if the value of the uniform at [location] on the current program changed.
+    bool update_uniform(GLint location, void const* data, size_t size);
+    bool update(bool changed);
+
+    template <typename T>
+    bool update(std::optional<T>& current, T const& next)
+    {
+        if (current && *current == next)
+            return update(false);
+
+        current = next;
+        return update(true);
+    }
+
+    GLStateCacheStats stats_;
+    std::optional<GLuint> program;
+    std::optional<GLenum> texture_unit;
+    std::optional<bool> blend_enabled;
+    std::optional<bool> stencil_enabled;
+    std::optional<bool> scissor_enabled;
+    std::optional<std::array<GLenum, 4>> blend_func;
+    std::optional<std::array<GLfloat, 4>> blend_color_;
+    std::optional<std::array<GLuint, 3>> stencil_func_;
+    std::optional<std::array<GLenum, 3>> stencil_op_;
+    std::optional<GLuint> stencil_mask_;
+    std::optional<std::array<GLint, 4>> scissor_;
+    std::unordered_map<std::uint64_t, UniformValue> uniforms;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_GL_STATE_CACHE_H
@@ -0,0 +1,101 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "gpu_fence.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+#include <cstring>
+
+using namespace miracle;
+
+namespace
+{
+struct FenceFunctions
+{
+    PFNEGLCREATESYNCKHRPROC create_sync = nullptr;
+    PFNEGLDESTROYSYNCKHRPROC destroy_sync = nullptr;
+    PFNEGLCLIENTWAITSYNCKHRPROC client_wait_sync = nullptr;
+    /// Null without EGL_KHR_wait_sync, in which case the CPU waits instead.
+    PFNEGLWAITSYNCKHRPROC wait_sync = nullptr;
+};
+
+/// Every output is on the same EGL display, so the functions are only looked up once.
+FenceFunctions const& functions(EGLDisplay display)
+{
+    static FenceFunctions const result = [display]
+    {
+        FenceFunctions functions;
+        auto const* extensions = eglQueryString(display, EGL_EXTENSIONS);
+        if (!extensions || !strstr(extensions, "EGL_KHR_fence_sync"))
+            return functions;
+
+        functions.create_sync = reinterpret_cast<PFNEGLCREATESYNCKHRPROC>(eglGetProcAddress("eglCreateSyncKHR"));
+        functions.destroy_sync = reinterpret_cast<PFNEGLDESTROYSYNCKHRPROC>(eglGetProcAddress("eglDestroySyncKHR"));
+        functions.client_wait_sync = reinterpret_cast<PFNEGLCLIENTWAITSYNCKHRPROC>(eglGetProcAddress("eglClientWaitSyncKHR"));
+        if (!functions.create_sync || !functions.destroy_sync || !functions.client_wait_sync)
+            return FenceFunctions {};
+
+        if (strstr(extensions, "EGL_KHR_wait_sync"))
+            functions.wait_sync = reinterpret_cast<PFNEGLWAITSYNCKHRPROC>(eglGetProcAddress("eglWaitSyncKHR"));
+        return functions;
+    }();
+    return result;
+}
+}
+
+bool GpuFence::is_supported()
+{
+    auto const display = eglGetCurrentDisplay();
+    return display != EGL_NO_DISPLAY && functions(display).create_sync;
+}
+
+std::shared_ptr<GpuFence const> GpuFence::create()
+{
+    auto const display = eglGetCurrentDisplay();
+    if (display == EGL_NO_DISPLAY || !functions(display).create_sync)
+        return nullptr;
+
+    auto const sync = functions(display).create_sync(display, EGL_SYNC_FENCE_KHR, nullptr);
+    if (sync == EGL_NO_SYNC_KHR)
+        return nullptr;
+
+    // A fence that was never flushed would never be reached by another context
+    glFlush();
+    return std::shared_ptr<GpuFence const>(new GpuFence(display, sync));
+}
+
+GpuFence::GpuFence(void* display, void* sync) :
+    display { display },
+    sync { sync }
+{
+}
+
+GpuFence::~GpuFence()
+{
+    functions(display).destroy_sync(display, sync);
+}
+
+void GpuFence::wait() const
+{
+    auto const& f = functions(display);
+    if (f.wait_sync)
+        f.wait_sync(display, sync, 0);
+    else
+        f.client_wait_sync(display, sync, EGL_SYNC_FLUSH_COMMANDS_BIT_KHR, EGL_FOREVER_KHR);
+}
@@ -0,0 +1,61 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_GPU_FENCE_H
+#define MIRACLE_WM_GPU_FENCE_H
+
+#include <memory>
+
+namespace miracle
+{
+
+/// Marks a point in the commands of the current GL context, so that another
+/// context can wait for the GPU to get past it. Uses EGL_KHR_fence_sync, and
+/// EGL_KHR_wait_sync where it is available so that the waiting context stalls
+/// on the GPU rather than on the CPU.
+///
+/// A fence may be waited for and destroyed from any thread.
+class GpuFence
+{
+public:
+    /// Whether fences can be created on the display of the current context.
+    static bool is_supported();
+
+    /// Inserts a fence after the commands issued so far in the current context and
+    /// flushes them, so that other contexts can wait for them. Returns nullptr if
+    /// fences are not supported.
+    static std::shared_ptr<GpuFence const> create();
+
+    ~GpuFence();
+
+    GpuFence(GpuFence const&) = delete;
+    GpuFence& operator=(GpuFence const&) = delete;
+
+    /// Holds back the commands that the current context issues from now on until
+    /// the GPU has got past the fence.
+    void wait() const;
+
+private:
+    GpuFence(void* display, void* sync);
+
+    void* const display;
+    void* const sync;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_GPU_FENCE_H
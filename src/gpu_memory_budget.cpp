@@ -0,0 +1,154 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "gpu_memory_budget.h"
+
+#include <algorithm>
+
+using namespace miracle;
+
+GpuMemoryBudget::GpuMemoryBudget(size_t budget_bytes) :
+    budget { budget_bytes }
+{
+}
+
+void GpuMemoryBudget::set_budget(size_t budget_bytes)
+{
+    std::lock_guard lock(mutex);
+    if (budget == budget_bytes)
+        return;
+
+    budget = budget_bytes;
+    evict(nullptr);
+}
+
+void GpuMemoryBudget::use(void const* owner, int slot, size_t bytes, bool evictable)
+{
+    std::lock_guard lock(mutex);
+    auto entry = find(owner, slot);
+    if (!entry)
+        entry = &entries.emplace_back(Entry { .owner = owner, .slot = slot, .bytes = 0, .evictable = evictable, .last_used = 0 });
+    else if (entry->evicted)
+        entry->evicted = false;
+    else
+        used -= entry->bytes;
+
+    used += bytes;
+    entry->bytes = bytes;
+    entry->evictable = evictable;
+    entry->last_used = ++clock;
+    evict(entry);
+}
+
+void GpuMemoryBudget::release(void const* owner, int slot)
+{
+    std::lock_guard lock(mutex);
+    std::erase_if(entries, [&](Entry const& entry)
+    {
+        if (entry.owner != owner || entry.slot != slot)
+            return false;
+
+        if (!entry.evicted)
+            used -= entry.bytes;
+        return true;
+    });
+}
+
+void GpuMemoryBudget::remove(void const* owner)
+{
+    std::lock_guard lock(mutex);
+    std::erase_if(entries, [&](Entry const& entry)
+    {
+        if (entry.owner != owner)
+            return false;
+
+        if (!entry.evicted)
+            used -= entry.bytes;
+        return true;
+    });
+}
+
+bool GpuMemoryBudget::take_eviction(void const* owner, int slot)
+{
+    std::lock_guard lock(mutex);
+    auto const it = std::ranges::find_if(entries, [&](Entry const& entry)
+    {
+        return entry.owner == owner && entry.slot == slot && entry.evicted;
+    });
+    if (it == entries.end())
+        return false;
+
+    entries.erase(it);
+    return true;
+}
+
+size_t GpuMemoryBudget::used_bytes() const
+{
+    std::lock_guard lock(mutex);
+    return used;
+}
+
+size_t GpuMemoryBudget::used_bytes(void const* owner) const
+{
+    std::lock_guard lock(mutex);
+    size_t result = 0;
+    for (auto const& entry : entries)
+    {
+        if (entry.owner == owner && !entry.evicted)
+            result += entry.bytes;
+    }
+    return result;
+}
+
+size_t GpuMemoryBudget::budget_bytes() const
+{
+    std::lock_guard lock(mutex);
+    return budget;
+}
+
+GpuMemoryBudget::Entry* GpuMemoryBudget::find(void const* owner, int slot)
+{
+    auto const it = std::ranges::find_if(entries, [&](Entry const& entry)
+    {
+        return entry.owner == owner && entry.slot == slot;
+    });
+    return it == entries.end() ? nullptr : &*it;
+}
+
+void GpuMemoryBudget::evict(Entry const* keep)
+{
+    // There are only ever a few targets per output, so a scan is cheaper than
+    // keeping them in order of use.
+    while (used > budget)
+    {
+        Entry* oldest = nullptr;
+        for (auto& entry : entries)
+        {
+            if (&entry == keep || !entry.evictable || entry.evicted)
+                continue;
+
+            if (!oldest || entry.last_used < oldest->last_used)
+                oldest = &entry;
+        }
+
+        if (!oldest)
+            return;
+
+        oldest->evicted = true;
+        used -= oldest->bytes;
+    }
+}
@@ -0,0 +1,82 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_GPU_MEMORY_BUDGET_H
+#define MIRACLE_WM_GPU_MEMORY_BUDGET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace miracle
+{
+
+/// Keeps the offscreen targets of every output within a budget of video memory.
+///
+/// Renderers record each target that they hold with [use] on every frame that uses
+/// it. Once the total exceeds the budget, the least recently used targets that can
+/// be rebuilt are evicted. Targets belong to the GL context of their renderer, so
+/// the budget only marks them: the owner learns of it through [take_eviction] and
+/// frees the target itself. Any thread may call into the budget.
+class GpuMemoryBudget
+{
+public:
+    explicit GpuMemoryBudget(size_t budget_bytes);
+
+    void set_budget(size_t budget_bytes);
+
+    /// Records that [slot] of [owner] holds [bytes] and was used just now. Targets
+    /// that are not [evictable] are counted toward the budget, but never evicted.
+    void use(void const* owner, int slot, size_t bytes, bool evictable);
+    void release(void const* owner, int slot);
+
+    /// Forgets every target of [owner], including those waiting to be evicted.
+    void remove(void const* owner);
+
+    /// Returns true if [slot] of [owner] was evicted and must now be freed.
+    bool take_eviction(void const* owner, int slot);
+
+    [[nodiscard]] size_t used_bytes() const;
+    [[nodiscard]] size_t used_bytes(void const* owner) const;
+    [[nodiscard]] size_t budget_bytes() const;
+
+private:
+    struct Entry
+    {
+        void const* owner;
+        int slot;
+        size_t bytes;
+        bool evictable;
+        uint64_t last_used;
+        bool evicted = false;
+    };
+
+    Entry* find(void const* owner, int slot);
+    /// Must be called with [mutex] held.
+    void evict(Entry const* keep);
+
+    mutable std::mutex mutex;
+    size_t budget;
+    size_t used = 0;
+    uint64_t clock = 0;
+    std::vector<Entry> entries;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_GPU_MEMORY_BUDGET_H
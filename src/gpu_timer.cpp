@@ -0,0 +1,113 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "gpu_timer.h"
+
+#include <EGL/egl.h>
+#include <cstring>
+
+using namespace miracle;
+
+namespace
+{
+template <typename T>
+T load(char const* name)
+{
+    return reinterpret_cast<T>(eglGetProcAddress(name));
+}
+}
+
+GpuTimer::GpuTimer()
+{
+    auto const* extensions = reinterpret_cast<char const*>(glGetString(GL_EXTENSIONS));
+    if (!extensions || !strstr(extensions, "GL_EXT_disjoint_timer_query"))
+        return;
+
+    gen_queries = load<PFNGLGENQUERIESEXTPROC>("glGenQueriesEXT");
+    delete_queries = load<PFNGLDELETEQUERIESEXTPROC>("glDeleteQueriesEXT");
+    begin_query = load<PFNGLBEGINQUERYEXTPROC>("glBeginQueryEXT");
+    end_query = load<PFNGLENDQUERYEXTPROC>("glEndQueryEXT");
+    get_query_uiv = load<PFNGLGETQUERYOBJECTUIVEXTPROC>("glGetQueryObjectuivEXT");
+    get_query_ui64v = load<PFNGLGETQUERYOBJECTUI64VEXTPROC>("glGetQueryObjectui64vEXT");
+    if (!gen_queries || !delete_queries || !begin_query || !end_query || !get_query_uiv || !get_query_ui64v)
+    {
+        gen_queries = nullptr;
+        return;
+    }
+
+    for (auto& query : queries)
+        gen_queries(1, &query.id);
+}
+
+GpuTimer::~GpuTimer()
+{
+    if (!is_supported())
+        return;
+
+    for (auto& query : queries)
+        delete_queries(1, &query.id);
+}
+
+void GpuTimer::begin_frame()
+{
+    // When every query is still waiting on the GPU we simply skip timing this frame.
+    if (!is_supported() || queries[next].in_flight)
+        return;
+
+    begin_query(GL_TIME_ELAPSED_EXT, queries[next].id);
+    is_timing = true;
+}
+
+void GpuTimer::end_frame()
+{
+    if (!is_timing)
+        return;
+
+    end_query(GL_TIME_ELAPSED_EXT);
+    queries[next].in_flight = true;
+    next = (next + 1) % queries.size();
+    is_timing = false;
+}
+
+std::optional<std::chrono::nanoseconds> GpuTimer::poll()
+{
+    if (!is_supported())
+        return std::nullopt;
+
+    std::optional<std::chrono::nanoseconds> result;
+    while (queries[oldest].in_flight)
+    {
+        GLuint available = GL_FALSE;
+        get_query_uiv(queries[oldest].id, GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+        if (!available)
+            break;
+
+        GLuint64 elapsed = 0;
+        get_query_ui64v(queries[oldest].id, GL_QUERY_RESULT_EXT, &elapsed);
+        queries[oldest].in_flight = false;
+        oldest = (oldest + 1) % queries.size();
+        result = std::chrono::nanoseconds(elapsed);
+    }
+
+    // A disjoint operation (e.g. a change in GPU frequency) makes the results meaningless.
+    GLint disjoint = 0;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    if (disjoint)
+        return std::nullopt;
+
+    return result;
+}
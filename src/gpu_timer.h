@@ -0,0 +1,75 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_GPU_TIMER_H
+#define MIRACLE_WM_GPU_TIMER_H
+
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <array>
+#include <chrono>
+#include <optional>
+
+namespace miracle
+{
+
+/// Measures the GPU time of each frame with GL_EXT_disjoint_timer_query.
+///
+/// Results are read back without stalling the pipeline, so they become
+/// available a few frames after the frame that they measure. Must be
+/// constructed, used and destroyed with the same GL context current.
+class GpuTimer
+{
+public:
+    GpuTimer();
+    ~GpuTimer();
+
+    GpuTimer(GpuTimer const&) = delete;
+    GpuTimer& operator=(GpuTimer const&) = delete;
+
+    [[nodiscard]] bool is_supported() const { return gen_queries != nullptr; }
+
+    void begin_frame();
+    void end_frame();
+
+    /// Returns the GPU time of the most recently completed frame, if any
+    /// completed since the last call.
+    std::optional<std::chrono::nanoseconds> poll();
+
+private:
+    struct Query
+    {
+        GLuint id = 0;
+        bool in_flight = false;
+    };
+
+    PFNGLGENQUERIESEXTPROC gen_queries = nullptr;
+    PFNGLDELETEQUERIESEXTPROC delete_queries = nullptr;
+    PFNGLBEGINQUERYEXTPROC begin_query = nullptr;
+    PFNGLENDQUERYEXTPROC end_query = nullptr;
+    PFNGLGETQUERYOBJECTUIVEXTPROC get_query_uiv = nullptr;
+    PFNGLGETQUERYOBJECTUI64VEXTPROC get_query_ui64v = nullptr;
+
+    std::array<Query, 4> queries;
+    size_t next = 0;
+    size_t oldest = 0;
+    bool is_timing = false;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_GPU_TIMER_H
@@ -18,16 +18,31 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIR_LOG_COMPONENT "miracle_ipc"
 
 #include "ipc.h"
+#include "animator.h"
 #include "command_controller.h"
 #include "config.h"
+#include "container.h"
+#include "debug_log.h"
+#include "event_recording.h"
 #include "ipc_command_executor.h"
+#include "json_fragment.h"
+#include "metrics.h"
+#include "placement_batch.h"
+#include "tracing.h"
 #include "version.h"
 #include "workspace_interface.h"
 
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
 #include <fcntl.h>
 #include <mir/log.h>
+#include <mir/server_action_queue.h>
 #include <nlohmann/json.hpp>
-#include <sys/ioctl.h>
+#include <optional>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <unistd.h>
@@ -38,7 +53,18 @@ using namespace miracle;
 static const char ipc_magic[] = { 'i', '3', '-', 'i', 'p', 'c' };
 
 #define IPC_HEADER_SIZE (sizeof(ipc_magic) + 8)
-#define event_mask(ev) (1 << (ev & 0x7F))
+
+/// The most that is read from a client in a single wakeup, so that one busy
+/// client cannot starve the others.
+static const size_t max_read_per_wakeup = 256 * 1024;
+
+/// How long a client must go without sending or receiving anything before the
+/// read buffer that it grew is released.
+static constexpr std::chrono::seconds idle_trim_delay { 10 };
+
+/// The largest request that a client may send.
+static const size_t max_request_size = 4'000'000;
+#define event_index(ev) (ev & 0x7F)
 
 namespace
 {
@@ -111,15 +137,104 @@ json mode_event_to_json(WindowManagerMode mode)
     }
     }
 }
+
+char const* window_change_to_string(WindowChange change)
+{
+    switch (change)
+    {
+    case WindowChange::created:
+        return "new";
+    case WindowChange::closed:
+        return "close";
+    case WindowChange::focused:
+        return "focus";
+    case WindowChange::title:
+        return "title";
+    case WindowChange::moved:
+        return "move";
+    case WindowChange::floating:
+        return "floating";
+    case WindowChange::fullscreen_mode:
+        return "fullscreen_mode";
+    default:
+        return "unknown";
+    }
 }
 
-Ipc::Ipc(miral::MirRunner& runner,
+std::optional<IpcEncoding> encoding_from_string(std::string const& name)
+{
+    if (name == "json")
+        return IpcEncoding::json;
+    else if (name == "cbor")
+        return IpcEncoding::cbor;
+    else if (name == "msgpack")
+        return IpcEncoding::msgpack;
+    return std::nullopt;
+}
+
+char const* encoding_to_string(IpcEncoding encoding)
+{
+    switch (encoding)
+    {
+    case IpcEncoding::cbor:
+        return "cbor";
+    case IpcEncoding::msgpack:
+        return "msgpack";
+    default:
+        return "json";
+    }
+}
+
+/// Maps the name that clients subscribe with to its event type.
+std::optional<IpcType> event_type_from_string(std::string const& name)
+{
+    if (name == "workspace")
+        return IPC_EVENT_WORKSPACE;
+    else if (name == "window")
+        return IPC_EVENT_WINDOW;
+    else if (name == "input")
+        return IPC_EVENT_INPUT;
+    else if (name == "mode")
+        return IPC_EVENT_MODE;
+    else if (name == "tick")
+        return IPC_EVENT_TICK;
+    else if (name == "shutdown")
+        return IPC_EVENT_SHUTDOWN;
+    return std::nullopt;
+}
+
+std::string encode(json const& payload, IpcEncoding encoding)
+{
+    std::string result;
+    switch (encoding)
+    {
+    case IpcEncoding::cbor:
+        json::to_cbor(payload, result);
+        break;
+    case IpcEncoding::msgpack:
+        json::to_msgpack(payload, result);
+        break;
+    default:
+        result = to_string(payload);
+        break;
+    }
+
+    return result;
+}
+}
+
+Ipc::Ipc(std::shared_ptr<mir::ServerActionQueue> const& server_action_queue,
     std::shared_ptr<CommandController> const& policy,
     std::unique_ptr<IpcCommandExecutor> executor,
-    std::shared_ptr<Config> const& config) :
+    std::shared_ptr<Config> const& config,
+    std::shared_ptr<Animator> const& animator,
+    std::shared_ptr<PlacementBatch> const& placement_batch) :
+    server_action_queue { server_action_queue },
     policy { policy },
     executor { std::move(executor) },
-    config { config }
+    config { config },
+    animator { animator },
+    placement_batch { placement_batch }
 {
     auto ipc_socket_raw = socket(AF_UNIX, SOCK_STREAM, 0);
     if (ipc_socket_raw == -1)
@@ -153,7 +268,8 @@ Ipc::Ipc(miral::MirRunner& runner,
         exit(1);
     }
 
-    if (listen(ipc_socket_raw, 3) == -1)
+    listen_backlog = config->ipc().listen_backlog;
+    if (listen(ipc_socket_raw, listen_backlog) == -1)
     {
         mir::log_error("Unable to listen on IPC socket");
         exit(1);
@@ -166,94 +282,234 @@ Ipc::Ipc(miral::MirRunner& runner,
     mir::log_info("Listening to IPC socket on path: %s", ipc_sockaddr->sun_path);
 
     ipc_socket = mir::Fd { ipc_socket_raw };
-    socket_handle = runner.register_fd_handler(ipc_socket, [&](int fd)
+
+    epoll_fd = mir::Fd { epoll_create1(EPOLL_CLOEXEC) };
+    wake_fd = mir::Fd { eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK) };
+    if (epoll_fd == mir::Fd::invalid || wake_fd == mir::Fd::invalid)
     {
-        int client_fd = accept(ipc_socket, NULL, NULL);
-        if (client_fd == -1)
-        {
-            mir::log_error("Unable to accept IPC client connection");
-            return;
-        }
+        mir::log_error("Unable to create IPC epoll fd");
+        exit(1);
+    }
 
-        int flags;
-        if ((flags = fcntl(client_fd, F_GETFD)) == -1
-            || fcntl(client_fd, F_SETFD, flags | FD_CLOEXEC) == -1)
+    for (int fd : { ipc_socket.operator int(), wake_fd.operator int() })
+    {
+        epoll_event event { .events = EPOLLIN, .data = { .fd = fd } };
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1)
         {
-            mir::log_error("Unable to set CLOEXEC on IPC client socket");
-            close(client_fd);
-            return;
+            mir::log_error("Unable to watch IPC fd: %d", fd);
+            exit(1);
         }
-        if ((flags = fcntl(client_fd, F_GETFL)) == -1
-            || fcntl(client_fd, F_SETFL, flags | O_NONBLOCK) == -1)
+    }
+
+    apply_config(config->ipc());
+    auto const on_change = [this](Config& updated)
+    {
+        post([this, ipc_config = updated.ipc()]()
+        { apply_config(ipc_config); });
+    };
+    config_handle = config->register_listener(on_change, ConfigSection::ipc, 5);
+
+    ipc_thread = std::thread([this]()
+    { run(); });
+}
+
+Ipc::~Ipc()
+{
+    config->unregister_listener(config_handle);
+    post([this]()
+    { running = false; });
+    ipc_thread.join();
+
+    // Anything that the IPC thread left for the server thread refers to us
+    server_action_queue->pause_processing_for(this);
+    unlink(ipc_sockaddr->sun_path);
+    free(ipc_sockaddr);
+    if (!metrics_socket_path.empty())
+        unlink(metrics_socket_path.c_str());
+}
+
+void Ipc::run()
+{
+    epoll_event events[32];
+    while (running)
+    {
+        auto const trim_in = trim_idle_clients();
+        int const count = epoll_wait(epoll_fd, events, std::size(events), trim_in ? static_cast<int>(trim_in->count()) : -1);
+        if (count == -1)
         {
-            mir::log_error("Unable to set NONBLOCK on IPC client socket");
-            close(client_fd);
-            return;
+            if (errno == EINTR)
+                continue;
+
+            mir::log_error("Unable to wait on IPC fds, IPC is stopping");
+            break;
         }
 
-        auto mir_fd = mir::Fd { client_fd };
-        clients.push_back({ mir_fd,
-            runner.register_fd_handler(mir_fd, [this](int fd)
+        for (int i = 0; i < count; i++)
         {
-            auto& client = get_client(fd);
-
-            int read_available;
-            if (ioctl(client.client_fd, FIONREAD, &read_available) == -1)
+            int const fd = events[i].data.fd;
+            if (fd == ipc_socket)
             {
-                mir::log_error("Unable to read IPC socket buffer size");
-                disconnect(client);
-                return;
+                accept_clients();
             }
-
-            if (client.pending_read_length > 0)
+            else if (fd == metrics_socket)
             {
-                if ((uint32_t)read_available >= client.pending_read_length)
-                {
-                    // Reset pending values.
-                    uint32_t pending_length = client.pending_read_length;
-                    IpcType pending_type = client.pending_type;
-                    client.pending_read_length = 0;
-                    handle_command(client, pending_length, pending_type);
-                }
-                return;
+                serve_metrics();
             }
-
-            if (read_available < (int)IPC_HEADER_SIZE)
+            else if (fd == wake_fd)
             {
-                return;
+                uint64_t value;
+                if (read(wake_fd, &value, sizeof(value)) == -1 && errno != EAGAIN)
+                    mir::log_error("Unable to read IPC wake fd");
+                tasks.drain([](std::function<void()>&& task)
+                { task(); });
             }
-
-            uint8_t buf[IPC_HEADER_SIZE];
-            // Should be fully available, because read_available >= IPC_HEADER_SIZE
-            ssize_t received = recv(client.client_fd, buf, IPC_HEADER_SIZE, 0);
-            if (received == -1)
+            else if (events[i].events & (EPOLLHUP | EPOLLERR))
             {
-                mir::log_error("Unable to receive header from IPC client");
-                disconnect(client);
-                return;
+                // Nothing can be sent to a client that has hung up
+                if (auto it = clients.find(fd); it != clients.end())
+                    disconnect(it->second);
             }
-
-            if (memcmp(buf, ipc_magic, sizeof(ipc_magic)) != 0)
+            else
             {
-                mir::log_error("IPC header check failed");
-                disconnect(client);
-                return;
+                // Either handler may disconnect the client, so look it up each time
+                if (events[i].events & EPOLLOUT)
+                {
+                    if (auto it = clients.find(fd); it != clients.end())
+                        handle_writeable(it->second);
+                }
+
+                if (events[i].events & EPOLLIN)
+                {
+                    if (auto it = clients.find(fd); it != clients.end())
+                        handle_readable(it->second);
+                }
             }
+        }
+    }
+}
 
-            memcpy(&client.pending_read_length, buf + sizeof(ipc_magic), sizeof(uint32_t));
-            memcpy(&client.pending_type, buf + sizeof(ipc_magic) + sizeof(uint32_t), sizeof(uint32_t));
-            mir::log_debug("Received request from IPC client: %d", (int)client.pending_type);
+void Ipc::post(std::function<void()> task)
+{
+    tasks.push(std::move(task));
 
-            if (read_available - received >= (long)client.pending_read_length)
-            {
-                // Reset pending values.
-                uint32_t pending_length = client.pending_read_length;
-                IpcType pending_type = client.pending_type;
-                client.pending_read_length = 0;
-                handle_command(client, pending_length, pending_type);
-            }
-        }) });
-    });
+    uint64_t const value = 1;
+    if (write(wake_fd, &value, sizeof(value)) == -1)
+        mir::log_error("Unable to wake the IPC thread");
+}
+
+void Ipc::accept_clients()
+{
+    // Clients tend to connect in bursts, so take every connection that is
+    // waiting rather than one per wakeup.
+    while (true)
+    {
+        int client_fd = accept4(ipc_socket, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+        if (client_fd == -1)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                mir::log_error("Unable to accept IPC client connection: %s", strerror(errno));
+            return;
+        }
+
+        auto [it, _] = clients.emplace(client_fd, IpcClient { .client_fd = mir::Fd { client_fd }, .id = next_client_id++ });
+        update_epoll(it->second);
+    }
+}
+
+void Ipc::handle_readable(IpcClient& client)
+{
+    int const fd = client.client_fd;
+    uint64_t const id = client.id;
+    auto& buffer = client.read_buffer;
+    if (client.read_offset > 0)
+    {
+        buffer.erase(buffer.begin(), buffer.begin() + client.read_offset);
+        client.read_offset = 0;
+    }
+
+    // Read everything that is available, so that back-to-back requests are
+    // handled in a single wakeup. The buffer keeps its capacity between reads.
+    size_t total = 0;
+    while (total < max_read_per_wakeup)
+    {
+        size_t const chunk = 16 * 1024;
+        size_t const size = buffer.size();
+        buffer.resize(size + chunk);
+        ssize_t const received = recv(client.client_fd, buffer.data() + size, chunk, 0);
+        buffer.resize(size + std::max<ssize_t>(received, 0));
+
+        if (received == 0)
+        {
+            disconnect(client);
+            return;
+        }
+
+        if (received == -1)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            if (errno == EINTR)
+                continue;
+
+            mir::log_error("Unable to receive from IPC client");
+            disconnect(client);
+            return;
+        }
+
+        total += received;
+        if ((size_t)received < chunk)
+            break;
+    }
+
+    client.last_active = std::chrono::steady_clock::now();
+    handle_buffered(client);
+    if (auto it = clients.find(fd); it != clients.end() && it->second.id == id)
+        account(it->second);
+}
+
+void Ipc::handle_buffered(IpcClient& client)
+{
+    int const fd = client.client_fd;
+    uint64_t const id = client.id;
+    while (!client.is_awaiting_reply)
+    {
+        size_t const available = client.read_buffer.size() - client.read_offset;
+        if (available < IPC_HEADER_SIZE)
+            return;
+
+        char const* header = client.read_buffer.data() + client.read_offset;
+        if (memcmp(header, ipc_magic, sizeof(ipc_magic)) != 0)
+        {
+            mir::log_error("IPC header check failed");
+            disconnect(client);
+            return;
+        }
+
+        uint32_t payload_length;
+        IpcType payload_type;
+        memcpy(&payload_length, header + sizeof(ipc_magic), sizeof(uint32_t));
+        memcpy(&payload_type, header + sizeof(ipc_magic) + sizeof(uint32_t), sizeof(uint32_t));
+        if (payload_length > max_request_size)
+        {
+            mir::log_error("IPC request too big (%u), disconnecting client", payload_length);
+            disconnect(client);
+            return;
+        }
+
+        if (available - IPC_HEADER_SIZE < payload_length)
+            return;
+
+        MIRACLE_LOG_DEBUG(LogCategory::ipc, "Received request from IPC client: %d", (int)payload_type);
+        client.read_offset += IPC_HEADER_SIZE + payload_length;
+        handle_command(client, payload_type, std::string_view(header + IPC_HEADER_SIZE, payload_length));
+
+        // Handling the request may have disconnected the client
+        auto it = clients.find(fd);
+        if (it == clients.end() || it->second.id != id)
+            return;
+    }
 }
 
 void Ipc::on_created(uint32_t id)
@@ -264,16 +520,8 @@ void Ipc::on_created(uint32_t id)
         { "current", policy->workspace_to_json(id) }
     };
 
-    auto serialized_value = to_string(j);
-    for (auto& client : clients)
-    {
-        if ((client.subscribed_events & event_mask(IPC_EVENT_WORKSPACE)) == 0)
-        {
-            continue;
-        }
-
-        send_reply(client, IPC_EVENT_WORKSPACE, serialized_value);
-    }
+    post([this, j = std::move(j)]()
+    { broadcast(IPC_EVENT_WORKSPACE, j); });
 }
 
 void Ipc::on_removed(uint32_t id)
@@ -283,16 +531,8 @@ void Ipc::on_removed(uint32_t id)
         { "current", policy->workspace_to_json(id) }
     };
 
-    auto serialized_value = to_string(j);
-    for (auto& client : clients)
-    {
-        if ((client.subscribed_events & event_mask(IPC_EVENT_WORKSPACE)) == 0)
-        {
-            continue;
-        }
-
-        send_reply(client, IPC_EVENT_WORKSPACE, serialized_value);
-    }
+    post([this, j = std::move(j)]()
+    { broadcast(IPC_EVENT_WORKSPACE, j); });
 }
 
 void Ipc::on_focused(
@@ -309,67 +549,74 @@ void Ipc::on_focused(
     else
         j["old"] = nullptr;
 
-    auto serialized_value = to_string(j);
-    for (auto& client : clients)
-    {
-        if ((client.subscribed_events & event_mask(IPC_EVENT_WORKSPACE)) == 0)
-        {
-            continue;
-        }
-
-        send_reply(client, IPC_EVENT_WORKSPACE, serialized_value);
-    }
+    post([this, j = std::move(j)]()
+    { broadcast(IPC_EVENT_WORKSPACE, j); });
 }
 
 void Ipc::on_changed(WindowManagerMode mode)
 {
-    auto response = to_string(mode_event_to_json(mode));
-    for (auto& client : clients)
-    {
-        if ((client.subscribed_events & event_mask(IPC_EVENT_MODE)) == 0)
-        {
-            continue;
-        }
-
-        send_reply(client, IPC_EVENT_MODE, response);
-    }
+    post([this, j = mode_event_to_json(mode)]()
+    { broadcast(IPC_EVENT_MODE, j); });
 }
 
-void Ipc::on_shutdown()
+void Ipc::on_window_changed(WindowChange change, Container const& container)
 {
-    auto response = to_string(json({
-        { "change", "exit" }
-    }));
-    for (auto& client : clients)
-    {
-        if ((client.subscribed_events & event_mask(IPC_EVENT_SHUTDOWN)) == 0)
-        {
-            continue;
-        }
+    if (!has_window_subscribers)
+        return;
 
-        send_reply(client, IPC_EVENT_SHUTDOWN, response);
-    }
+    auto const* workspace = container.get_workspace();
+    bool const is_workspace_visible = workspace && workspace->get_output()
+        && workspace->get_output()->active() == workspace;
+    auto container_json = container.to_json(is_workspace_visible);
+    if (!container_json.contains("id"))
+        return;
+
+    // The deltas are computed on the IPC thread, where the subscribers are known
+    post([this, change, container_json = std::move(container_json)]()
+    { broadcast_window_change(change, container_json); });
 }
 
-Ipc::IpcClient& Ipc::get_client(int fd)
+void Ipc::broadcast_window_change(WindowChange change, json const& container_json)
 {
-    for (auto& client : clients)
+    broadcast(IPC_EVENT_WINDOW, json({
+        { "change",    window_change_to_string(change) },
+        { "container", container_json                  }
+    }));
+
+    if (window_delta_subscribers.empty())
     {
-        if (client.client_fd == fd)
-            return client;
+        window_deltas.reset();
+        return;
     }
 
-    throw std::runtime_error("Could not find IPC client");
+    broadcast(window_delta_subscribers, IPC_EVENT_WINDOW, json({
+        { "change",    window_change_to_string(change)                                     },
+        { "container", window_deltas.next(container_json, change == WindowChange::closed) }
+    }));
 }
 
-void Ipc::disconnect(Ipc::IpcClient& client)
+void Ipc::on_shutdown()
 {
-    auto it = std::find_if(clients.begin(), clients.end(), [&](IpcClient const& other)
+    post([this]()
     {
-        return other.client_fd.operator int() == client.client_fd.operator int();
+        broadcast(IPC_EVENT_SHUTDOWN, json({
+            { "change", "exit" }
+        }));
     });
+}
+
+void Ipc::disconnect(Ipc::IpcClient& client)
+{
+    auto it = clients.find(client.client_fd);
     if (it != clients.end())
     {
+        for (auto& fds : subscribers)
+            std::erase(fds, it->first);
+        std::erase(window_delta_subscribers, it->first);
+        update_window_subscribers();
+
+        if (client.epoll_events != 0)
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client.client_fd, nullptr);
         if (fd_is_valid(client.client_fd))
             shutdown(client.client_fd, SHUT_RDWR);
         mir::log_info("Disconnected client: %d", (int)client.client_fd);
@@ -381,90 +628,119 @@ void Ipc::disconnect(Ipc::IpcClient& client)
     }
 }
 
-void Ipc::handle_command(miracle::Ipc::IpcClient& client, uint32_t payload_length, miracle::IpcType payload_type)
+void Ipc::subscribe(Ipc::IpcClient& client, IpcType event_type)
 {
-    char* buf = (char*)malloc(payload_length + 1);
-    if (!buf)
-    {
-        mir::log_error("Unable to allocate IPC payload");
-        disconnect(client);
-        return;
-    }
+    subscribe(client, subscribers[event_index(event_type)]);
+}
 
-    if (payload_length > 0)
+void Ipc::subscribe(Ipc::IpcClient& client, std::vector<int>& fds)
+{
+    if (std::find(fds.begin(), fds.end(), client.client_fd.operator int()) == fds.end())
     {
-        // Payload should be fully available
-        ssize_t received = recv(client.client_fd, buf, payload_length, 0);
-        if (received == -1)
+        fds.push_back(client.client_fd);
+
+        // The new subscriber has no baseline to apply deltas to, so every
+        // subscriber is sent whole containers again
+        if (&fds == &window_delta_subscribers)
         {
-            mir::log_error("Unable to receive payload from IPC client");
-            disconnect(client);
-            free(buf);
-            return;
+            client.receives_window_deltas = true;
+            window_deltas.reset();
         }
     }
-    buf[payload_length] = '\0';
+    update_window_subscribers();
+}
+
+void Ipc::update_window_subscribers()
+{
+    bool const has_subscribers = !subscribers[event_index(IPC_EVENT_WINDOW)].empty() || !window_delta_subscribers.empty();
+    if (window_delta_subscribers.empty())
+        window_deltas.reset();
+    has_window_subscribers = has_subscribers;
+}
+
+void Ipc::broadcast(IpcType event_type, json const& payload)
+{
+    broadcast(subscribers[event_index(event_type)], event_type, payload);
+}
+
+void Ipc::broadcast(std::vector<int> const& fds, IpcType event_type, json const& payload)
+{
+    if (fds.empty())
+        return;
+
+    std::array<IpcWriteQueue::Frame, static_cast<size_t>(IpcEncoding::max)> frames;
+
+    // Sending may disconnect a client, which removes it from the subscribers.
+    for (auto const fd : std::vector<int>(fds))
+    {
+        auto it = clients.find(fd);
+        if (it == clients.end())
+            continue;
+
+        auto& frame = frames[static_cast<size_t>(it->second.encoding)];
+        if (!frame)
+            frame = IpcWriteQueue::frame(static_cast<uint32_t>(event_type), serialize(payload, it->second.encoding));
+        send_event(it->second, event_type, frame);
+    }
+}
 
+void Ipc::handle_command(miracle::Ipc::IpcClient& client, miracle::IpcType payload_type, std::string_view payload)
+{
+    Metrics::instance().increment(MetricCounter::ipc_messages);
+    MetricTimer timer(MetricHistogram::ipc_request_time);
     switch (payload_type)
     {
     case IPC_COMMAND:
     {
-        mir::log_debug("Processing i3_command: %s", buf);
-        auto result = parse_i3_command(buf);
-        if (result.success)
-        {
-            const std::string msg = "[{\"success\": true}]";
-            send_reply(client, payload_type, msg);
-        }
-        else
+        std::string command(payload);
+        MIRACLE_LOG_DEBUG(LogCategory::ipc, "Processing i3_command: %s", command.c_str());
+        reply_from_server(client, payload_type, [this, command = std::move(command)]() -> json
         {
+            auto result = parse_i3_command(command);
+            if (result.success)
+                return json::array({ { { "success", true } } });
+
             json j = json::array();
             j.push_back({
                 { "success",     false              },
                 { "parse_error", result.parse_error },
                 { "error",       result.error       },
             });
-            const std::string msg = to_string(j);
-            send_reply(client, payload_type, msg);
-        }
+            return j;
+        });
         break;
     }
     case IPC_GET_WORKSPACES:
-    {
-        auto json_string = to_string(policy->workspaces_json());
-        send_reply(client, payload_type, json_string);
-        break;
-    }
     case IPC_GET_OUTPUTS:
+    case IPC_GET_TREE:
+    case IPC_GET_BINDING_STATE:
     {
-        auto json_string = to_string(policy->outputs_json());
-        send_reply(client, payload_type, json_string);
+        reply_from_snapshot(client, payload_type);
         break;
     }
     case IPC_SUBSCRIBE:
     {
-        json j = json::parse(buf);
+        json j = json::parse(payload, nullptr, false);
+        if (!j.is_array())
+        {
+            mir::log_error("Cannot parse IPC subscription request: %.*s", (int)payload.size(), payload.data());
+            disconnect(client);
+            break;
+        }
+
         bool success = true;
         bool send_event_tick = false;
         for (auto const& i : j)
         {
-            std::string event_type = i.template get<std::string>();
-            mir::log_debug("Received subscription request from IPC client for event: %s", event_type.c_str());
-            if (event_type == "workspace")
-                client.subscribed_events |= event_mask(IPC_EVENT_WORKSPACE);
-            else if (event_type == "window")
-                client.subscribed_events |= event_mask(IPC_EVENT_WINDOW);
-            else if (event_type == "input")
-                client.subscribed_events |= event_mask(IPC_EVENT_INPUT);
-            else if (event_type == "mode")
-                client.subscribed_events |= event_mask(IPC_EVENT_MODE);
-            else if (event_type == "tick")
+            std::string event_type = i.is_string() ? i.template get<std::string>() : "";
+            MIRACLE_LOG_DEBUG(LogCategory::ipc, "Received subscription request from IPC client for event: %s", event_type.c_str());
+            if (event_type == "window_delta")
+                subscribe(client, window_delta_subscribers);
+            else if (auto const type = event_type_from_string(event_type))
             {
-                client.subscribed_events |= event_mask(IPC_EVENT_TICK);
-                send_event_tick = true;
+                subscribe(client, type.value());
+                send_event_tick = send_event_tick || type == IPC_EVENT_TICK;
             }
-            else if (event_type == "shutdown")
-                client.subscribed_events |= event_mask(IPC_EVENT_SHUTDOWN);
             else
             {
                 mir::log_error("Cannot process IPC subscription event for event_type: %s", event_type.c_str());
@@ -475,38 +751,45 @@ void Ipc::handle_command(miracle::Ipc::IpcClient& client, uint32_t payload_lengt
         }
 
         if (success)
-        {
-            const std::string msg = "{\"success\": true}";
-            send_reply(client, payload_type, msg);
-        }
+            send_reply(client, payload_type, json({ { "success", true } }));
 
-        if (send_event_tick)
+        if (success && send_event_tick)
         {
             json response = {
                 { "first",   true },
                 { "payload", ""   }
             };
-            send_reply(client, IPC_EVENT_TICK, to_string(response));
+            send_reply(client, IPC_EVENT_TICK, response);
         }
 
         break;
     }
-    case IPC_GET_TREE:
+    case IPC_SYNC:
     {
-        auto json_string = to_string(policy->to_json());
-        send_reply(client, payload_type, json_string);
+        // There is no X server to synchronize with. Instead, the reply is sent once
+        // the server thread has applied every command that came before it.
+        reply_from_server(client, payload_type, []()
+        { return json({ { "success", true } }); });
+        break;
+    }
+    case IPC_GET_MARKS:
+    {
+        // Marks are not supported yet, so there are never any to report.
+        send_reply(client, payload_type, json::array());
         break;
     }
     case IPC_GET_VERSION:
     {
-        json response = {
-            { "major",                   MIRACLE_WM_MAJOR       },
-            { "minor",                   MIRACLE_WM_MINOR       },
-            { "patch",                   MIRACLE_WM_PATCH       },
-            { "human_readable",          MIRACLE_VERSION_STRING },
-            { "loaded_config_file_name", config->get_filename() }
-        };
-        send_reply(client, payload_type, to_string(response));
+        reply_from_server(client, payload_type, [this]()
+        {
+            return json {
+                { "major",                   MIRACLE_WM_MAJOR       },
+                { "minor",                   MIRACLE_WM_MINOR       },
+                { "patch",                   MIRACLE_WM_PATCH       },
+                { "human_readable",          MIRACLE_VERSION_STRING },
+                { "loaded_config_file_name", config->get_filename() }
+            };
+        });
         break;
     }
     case IPC_GET_BINDING_MODES:
@@ -515,32 +798,146 @@ void Ipc::handle_command(miracle::Ipc::IpcClient& client, uint32_t payload_lengt
         response.push_back("default");
         response.push_back("resize");
         response.push_back("selecting");
-        send_reply(client, payload_type, to_string(response));
+        send_reply(client, payload_type, response);
         break;
     }
-    case IPC_GET_BINDING_STATE:
+    case IPC_GET_RENDER_STATS:
     {
-        send_reply(client, payload_type, to_string(policy->mode_to_json()));
+        reply_from_server(client, payload_type, [this]()
+        { return policy->render_stats_json(); });
         break;
     }
-    case IPC_SEND_TICK:
+    case IPC_GET_ANIMATOR_STATS:
     {
-        const std::string msg = "{\"success\": true}";
-        send_reply(client, payload_type, msg);
-
-        for (auto& other_client : clients)
+        reply_from_server(client, payload_type, [this]()
+        { return animator->stats_to_json(); });
+        break;
+    }
+    case IPC_ANIMATION_TRACE:
+    {
+        // "start" and "stop" toggle the recording, and anything else dumps the
+        // latest recording as Chrome trace events.
+        reply_from_server(client, payload_type, [this, action = std::string(payload)]() -> json
         {
-            if ((other_client.subscribed_events & event_mask(IPC_EVENT_TICK)) == 0)
+            if (action == "start")
             {
-                continue;
+                animation_trace = std::make_shared<AnimationTrace>();
+                animator->set_trace(animation_trace);
+                return json({ { "success", true } });
+            }
+            else if (action == "stop")
+            {
+                animator->set_trace(nullptr);
+                return json({ { "success", true } });
             }
+            else if (animation_trace)
+                return animation_trace->to_chrome_trace();
+            else
+                return json({ { "traceEvents", json::array() } });
+        });
+        break;
+    }
+    case IPC_COMMAND_TRACE:
+    {
+        // Like IPC_ANIMATION_TRACE, but for the spans from input and commands
+        // through to the containers being committed.
+        reply_from_server(client, payload_type, [action = std::string(payload)]() -> json
+        {
+            auto& tracer = Tracer::instance();
+            if (action == "start")
+            {
+                if (!MIRACLE_FEATURE_FLAG_TRACING)
+                    return json({ { "success", false }, { "error", "tracing is not built in" } });
 
-            json response = {
-                { "first",   false            },
-                { "payload", std::string(buf) }
-            };
-            send_reply(other_client, IPC_EVENT_TICK, to_string(response));
+                tracer.start();
+                return json({ { "success", true } });
+            }
+            else if (action == "stop")
+            {
+                tracer.stop();
+                return json({ { "success", true } });
+            }
+            else
+                return tracer.to_chrome_trace();
+        });
+        break;
+    }
+    case IPC_GET_WINDOW_UPDATE_STATS:
+    {
+        reply_from_server(client, payload_type, [this]()
+        { return policy->window_update_stats_json(); });
+        break;
+    }
+    case IPC_GET_WINDOW_OPEN_STATS:
+    {
+        reply_from_server(client, payload_type, [this]()
+        { return policy->window_open_stats_json(); });
+        break;
+    }
+    case IPC_PLACEMENT_BATCH:
+    {
+        // "start" holds the layout of new windows until "stop", or until the
+        // batch closes itself after a quiet period.
+        reply_from_server(client, payload_type, [this, action = std::string(payload)]() -> json
+        {
+            if (!placement_batch)
+                return json({ { "success", false }, { "error", "placement batches are not available" } });
+
+            if (action == "start")
+                placement_batch->open();
+            else if (action == "stop")
+                placement_batch->close();
+            else
+                return json({ { "success", false }, { "error", "expected start or stop" } });
+
+            return json({ { "success", true } });
+        });
+        break;
+    }
+    case IPC_GET_IPC_STATS:
+    {
+        send_reply(client, payload_type, stats_to_json());
+        break;
+    }
+    case IPC_GET_METRICS:
+    {
+        // The registry may be read from any thread
+        send_reply(client, payload_type, Metrics::instance().to_json());
+        break;
+    }
+    case IPC_GET_MEMORY:
+    {
+        // The memory accounting may also be read from any thread
+        send_reply(client, payload_type, MemoryAccounting::instance().to_json());
+        break;
+    }
+    case IPC_SET_ENCODING:
+    {
+        std::string const name(payload);
+        auto const encoding = encoding_from_string(name);
+        if (!encoding)
+        {
+            send_reply(client, payload_type, json({
+                { "success", false                      },
+                { "error",   "Unknown encoding: " + name }
+            }));
+            break;
         }
+
+        // The reply is the first message that is sent in the new encoding.
+        client.encoding = encoding.value();
+        send_reply(client, payload_type, json({ { "success", true } }));
+        break;
+    }
+    case IPC_SEND_TICK:
+    {
+        send_reply(client, payload_type, json({ { "success", true } }));
+
+        json response = {
+            { "first",   false            },
+            { "payload", std::string(payload) }
+        };
+        broadcast(IPC_EVENT_TICK, response);
         break;
     }
     default:
@@ -550,7 +947,152 @@ void Ipc::handle_command(miracle::Ipc::IpcClient& client, uint32_t payload_lengt
     }
 }
 
+void Ipc::reply_from_server(IpcClient& client, IpcType type, std::function<json()> build)
+{
+    client.is_awaiting_reply = true;
+    update_epoll(client);
+
+    server_action_queue->enqueue(this, [this, fd = client.client_fd.operator int(), id = client.id, type, build = std::move(build)]()
+    {
+        // The request is applied in turn with the input and window events, rather
+        // than racing them for the lock
+        json reply;
+        policy->invoke_under_lock([&]()
+        { reply = build(); });
+
+        // Whatever the request changed is published before it is answered, so
+        // that the next query of the client sees it
+        policy->publish_scene();
+        post([this, fd, id, type, reply = std::move(reply)]()
+        {
+            auto it = clients.find(fd);
+            if (it == clients.end() || it->second.id != id)
+                return;
+
+            send_reply(it->second, type, reply);
+            finish_reply(fd, id);
+        });
+    });
+}
+
+void Ipc::reply_from_snapshot(IpcClient& client, IpcType type)
+{
+    client.is_awaiting_reply = true;
+    update_epoll(client);
+
+    snapshot_queries.push_back({ client.client_fd, client.id, type });
+    if (snapshot_queries.size() > 1)
+        return;
+
+    // The scene is published at the end of every transaction, so an unchanged
+    // version means that the last snapshot still holds
+    if (auto const scene = policy->scene(); last_snapshot && scene && scene->version == last_snapshot->scene_version)
+    {
+        post([this, snapshot = last_snapshot]()
+        {
+            answer_snapshot_queries(*snapshot);
+        });
+        return;
+    }
+
+    // The snapshot is taken after the queries arrive, so that they see the effects
+    // of any command that came before them.
+    server_action_queue->enqueue(this, [this]()
+    {
+        // Taken under a single lock, so that the replies agree with one another
+        auto const lock = policy->lock();
+        policy->publish_scene();
+        auto const scene = policy->scene();
+        auto snapshot = std::make_shared<IpcSnapshot const>(IpcSnapshot {
+            .scene_version = scene ? scene->version : 0,
+            .tree = policy->to_json_string(),
+            .workspaces = policy->workspaces_json(),
+            .outputs = policy->outputs_json(),
+            .binding_state = policy->mode_to_json() });
+
+        post([this, snapshot = std::move(snapshot)]()
+        {
+            last_snapshot = snapshot;
+            answer_snapshot_queries(*snapshot);
+        });
+    });
+}
+
+void Ipc::answer_snapshot_queries(IpcSnapshot const& snapshot)
+{
+    ParsedSnapshot parsed;
+    auto queries = std::move(snapshot_queries);
+    snapshot_queries.clear();
+    for (auto const& query : queries)
+        answer_snapshot_query(query, snapshot, parsed);
+}
+
+void Ipc::answer_snapshot_query(SnapshotQuery const& query, IpcSnapshot const& snapshot, ParsedSnapshot& parsed)
+{
+    auto it = clients.find(query.client_fd);
+    if (it == clients.end() || it->second.id != query.client_id)
+        return;
+
+    auto& client = it->second;
+    switch (query.type)
+    {
+    case IPC_GET_WORKSPACES:
+        send_serialized_reply(client, query.type, snapshot.workspaces, parsed.workspaces);
+        break;
+    case IPC_GET_OUTPUTS:
+        send_serialized_reply(client, query.type, snapshot.outputs, parsed.outputs);
+        break;
+    case IPC_GET_BINDING_STATE:
+        send_reply(client, query.type, snapshot.binding_state);
+        break;
+    case IPC_GET_TREE:
+        send_serialized_reply(client, query.type, snapshot.tree, parsed.tree);
+        break;
+    default:
+        mir::log_error("answer_snapshot_query: not a snapshot query: %d", query.type);
+        break;
+    }
+
+    finish_reply(query.client_fd, query.client_id);
+}
+
+void Ipc::finish_reply(int fd, uint64_t id)
+{
+    // Sending the reply may have disconnected the client
+    auto it = clients.find(fd);
+    if (it == clients.end() || it->second.id != id)
+        return;
+
+    it->second.is_awaiting_reply = false;
+    update_epoll(it->second);
+    handle_buffered(it->second);
+}
+
 void Ipc::send_reply(miracle::Ipc::IpcClient& client, miracle::IpcType command_type, const std::string& payload)
+{
+    send_frame(client, IpcWriteQueue::frame(static_cast<uint32_t>(command_type), payload));
+}
+
+void Ipc::send_reply(miracle::Ipc::IpcClient& client, miracle::IpcType command_type, json const& payload)
+{
+    send_frame(client, IpcWriteQueue::frame(static_cast<uint32_t>(command_type), serialize(payload, client.encoding)));
+}
+
+void Ipc::send_serialized_reply(
+    IpcClient& client, IpcType command_type, std::string const& serialized, json& parsed)
+{
+    if (client.encoding == IpcEncoding::json)
+    {
+        send_reply(client, command_type, serialized);
+        return;
+    }
+
+    if (parsed.is_null())
+        parsed = json::parse(serialized);
+    send_reply(client, command_type, parsed);
+}
+
+void Ipc::send_frame(miracle::Ipc::IpcClient& client, IpcWriteQueue::Frame const& frame)
 {
     if (!fd_is_valid(client.client_fd.operator int()))
     {
@@ -559,88 +1101,282 @@ void Ipc::send_reply(miracle::Ipc::IpcClient& client, miracle::IpcType command_t
         return;
     }
 
-    const uint32_t payload_length = payload.size();
-    char data[IPC_HEADER_SIZE];
+    if (client.write_queue.size() + frame->size() > max_client_queue_bytes)
+    {
+        mir::log_error("Client write queue too big (%zu), disconnecting client", client.write_queue.size());
+        disconnect(client);
+        return;
+    }
 
-    const auto casted_command = static_cast<uint32_t>(command_type);
-    memcpy(data, ipc_magic, sizeof(ipc_magic));
-    memcpy(data + sizeof(ipc_magic), &payload_length, sizeof(payload_length));
-    memcpy(data + sizeof(ipc_magic) + sizeof(payload_length), &casted_command, sizeof(casted_command));
+    client.write_queue.push(frame);
+    client.messages_sent++;
+    handle_writeable(client);
+}
 
-    auto new_buffer_size = client.buffer.size();
-    while (client.write_buffer_len + IPC_HEADER_SIZE + payload_length >= new_buffer_size)
+void Ipc::send_event(miracle::Ipc::IpcClient& client, miracle::IpcType event_type, IpcWriteQueue::Frame const& frame)
+{
+    auto const fits = [&]
+    { return client.write_queue.size() + frame->size() <= max_client_queue_bytes; };
+
+    // A client that lost a delta would diverge from the real state without
+    // knowing, so it is disconnected instead
+    auto const policy = event_type == IPC_EVENT_WINDOW && client.receives_window_deltas
+        ? IpcOverflowPolicy::disconnect
+        : overflow_policies[event_index(event_type)];
+    if (fits() || policy == IpcOverflowPolicy::disconnect)
     {
-        if (new_buffer_size == 0)
-            new_buffer_size = 1;
-        new_buffer_size *= 2;
+        send_frame(client, frame);
+        return;
     }
 
-    if (new_buffer_size > 4e6)
-    { // 4 MB
-        mir::log_error("Client write buffer too big (%zu), disconnecting client", client.buffer.size());
-        disconnect(client);
+    auto const type = static_cast<uint32_t>(event_type);
+    if (policy == IpcOverflowPolicy::drop_oldest)
+        client.events_dropped += client.write_queue.drop_oldest(type, frame->size(), max_client_queue_bytes);
+    else
+        client.events_coalesced += client.write_queue.remove(type);
+
+    // The client is still connected, so just miss out on this event if there is
+    // no room for it.
+    if (!fits())
+    {
+        client.events_dropped++;
         return;
     }
 
-    client.buffer.resize(new_buffer_size);
+    send_frame(client, frame);
+}
 
-    memcpy(client.buffer.data() + client.write_buffer_len, data, IPC_HEADER_SIZE);
-    client.write_buffer_len += IPC_HEADER_SIZE;
-    memcpy(client.buffer.data() + client.write_buffer_len, payload.c_str(), payload_length);
-    client.write_buffer_len += payload_length;
-    handle_writeable(client);
+std::string Ipc::serialize(json const& payload, IpcEncoding encoding)
+{
+    auto const start = std::chrono::steady_clock::now();
+    auto result = encode(payload, encoding);
+    serialization_time += std::chrono::steady_clock::now() - start;
+    serialization_count++;
+    return result;
 }
 
-namespace
+void Ipc::apply_config(IpcConfiguration const& ipc_config)
 {
-// https://stackoverflow.com/questions/24920748/how-to-handle-a-sigpipe-error-inside-the-object-that-generated-it
-ssize_t write_nosigpipe(int fd, void* buf, size_t len)
+    max_client_queue_bytes = ipc_config.max_client_queue_bytes;
+    if (ipc_config.listen_backlog != listen_backlog)
+    {
+        // Listening again on a socket that is already listening changes its backlog
+        listen_backlog = ipc_config.listen_backlog;
+        if (listen(ipc_socket, listen_backlog) == -1)
+            mir::log_error("Unable to change the backlog of the IPC socket");
+    }
+    overflow_policies.fill(IpcOverflowPolicy::disconnect);
+    for (auto const& [name, policy] : ipc_config.overflow_policies)
+    {
+        if (auto const event_type = event_type_from_string(name))
+            overflow_policies[event_index(event_type.value())] = policy;
+        else
+            mir::log_warning("Ignoring the IPC overflow policy of unknown event type: %s", name.c_str());
+    }
+
+    open_metrics_socket(ipc_config.metrics_socket);
+}
+
+void Ipc::open_metrics_socket(std::string const& path)
 {
-    sigset_t oldset, newset;
-    ssize_t result;
-    siginfo_t si;
-    struct timespec ts = { 0 };
+    if (path == metrics_socket_path)
+        return;
 
-    sigemptyset(&newset);
-    sigaddset(&newset, SIGPIPE);
-    pthread_sigmask(SIG_BLOCK, &newset, &oldset);
+    close_metrics_socket();
+    if (path.empty())
+        return;
 
-    result = write(fd, buf, len);
+    sockaddr_un address { .sun_family = AF_UNIX };
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        mir::log_error("The metrics socket path is too long: %s", path.c_str());
+        return;
+    }
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
 
-    while (sigtimedwait(&newset, &si, &ts) >= 0 || errno != EAGAIN)
-        ;
-    pthread_sigmask(SIG_SETMASK, &oldset, 0);
+    mir::Fd fd { socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0) };
+    if (fd == mir::Fd::invalid)
+    {
+        mir::log_error("Unable to create the metrics socket");
+        return;
+    }
 
-    return result;
+    unlink(address.sun_path);
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) == -1 || listen(fd, 8) == -1)
+    {
+        mir::log_error("Unable to listen on the metrics socket: %s", path.c_str());
+        return;
+    }
+
+    epoll_event event { .events = EPOLLIN, .data = { .fd = fd } };
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1)
+    {
+        mir::log_error("Unable to watch the metrics socket");
+        unlink(address.sun_path);
+        return;
+    }
+
+    mir::log_info("Serving metrics on path: %s", path.c_str());
+    metrics_socket = std::move(fd);
+    metrics_socket_path = path;
+}
+
+void Ipc::close_metrics_socket()
+{
+    if (metrics_socket_path.empty())
+        return;
+
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, metrics_socket, nullptr);
+    metrics_socket = mir::Fd {};
+    unlink(metrics_socket_path.c_str());
+    metrics_socket_path.clear();
+}
+
+void Ipc::serve_metrics()
+{
+    mir::Fd client_fd { accept4(metrics_socket, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK) };
+    if (client_fd == mir::Fd::invalid)
+        return;
+
+    // The reply is framed as HTTP, so that it can be scraped through a proxy that
+    // forwards to the socket, while a plain read of the socket still works.
+    auto const body = Metrics::instance().to_prometheus();
+    auto const reply = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+        + std::to_string(body.size()) + "\r\n\r\n" + body;
+
+    // The reply fits in the socket's buffer, so it is written in one go rather
+    // than being queued like the replies to IPC clients.
+    if (send(client_fd, reply.data(), reply.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(reply.size()))
+        mir::log_warning("Unable to write the metrics in full");
+
+    // Drain whatever request was sent, so that closing does not reset the connection
+    shutdown(client_fd, SHUT_WR);
+    char discard[512];
+    while (recv(client_fd, discard, sizeof(discard), MSG_DONTWAIT) > 0)
+        ;
 }
+
+json Ipc::stats_to_json() const
+{
+    auto const now = std::chrono::steady_clock::now();
+    json clients_json = json::array();
+    for (auto const& [fd, client] : clients)
+    {
+        auto const seconds = std::chrono::duration<double>(now - client.connected_at).count();
+        clients_json.push_back({
+            { "fd",                  fd                                                     },
+            { "encoding",            encoding_to_string(client.encoding)                    },
+            { "queue_bytes",         client.write_queue.size()                              },
+            { "queue_messages",      client.write_queue.count()                             },
+            { "messages_sent",       client.messages_sent                                   },
+            { "messages_per_second", seconds > 0 ? client.messages_sent / seconds : 0.0     },
+            { "events_dropped",      client.events_dropped                                  },
+            { "events_coalesced",    client.events_coalesced                                }
+        });
+    }
+
+    auto const serialization_ms = std::chrono::duration<double, std::milli>(serialization_time).count();
+    return {
+        { "max_client_queue_bytes", max_client_queue_bytes },
+        { "serialization",
+         { { "count", serialization_count },
+            { "total_ms", serialization_ms },
+            { "average_ms", serialization_count > 0 ? serialization_ms / serialization_count : 0.0 } } },
+        { "clients",                clients_json           }
+    };
 }
 
 void Ipc::handle_writeable(miracle::Ipc::IpcClient& client)
 {
-    while (client.write_buffer_len > 0)
+    client.last_active = std::chrono::steady_clock::now();
+    switch (client.write_queue.write_to(client.client_fd))
     {
-        ssize_t written = write_nosigpipe(client.client_fd, client.buffer.data(), client.write_buffer_len);
-        if (written == -1 && errno == EAGAIN)
-        {
-            return;
-        }
-        else if (written == -1)
+    case IpcWriteQueue::WriteResult::done:
+        watch_writable(client, false);
+        account(client);
+        break;
+    case IpcWriteQueue::WriteResult::pending:
+        watch_writable(client, true);
+        account(client);
+        break;
+    case IpcWriteQueue::WriteResult::error:
+        mir::log_error("Unable to send data from queue to IPC client");
+        disconnect(client);
+        break;
+    }
+}
+
+void Ipc::account(miracle::Ipc::IpcClient& client)
+{
+    client.memory.resize(sizeof(IpcClient) + client.read_buffer.capacity() + client.write_queue.size());
+}
+
+std::optional<std::chrono::milliseconds> Ipc::trim_idle_clients()
+{
+    auto const now = std::chrono::steady_clock::now();
+    std::optional<std::chrono::steady_clock::duration> next;
+    for (auto& [_, client] : clients)
+    {
+        if (client.read_buffer.capacity() == 0 || client.is_awaiting_reply)
+            continue;
+
+        auto const idle = now - client.last_active;
+        if (idle < idle_trim_delay)
         {
-            mir::log_error("Unable to send data from queue to IPC client");
-            disconnect(client);
-            return;
+            auto const remaining = idle_trim_delay - idle;
+            if (!next || remaining < *next)
+                next = remaining;
+            continue;
         }
 
-        memmove(client.buffer.data(), client.buffer.data() + written, client.write_buffer_len - written);
-        client.write_buffer_len -= written;
+        client.read_buffer.erase(client.read_buffer.begin(), client.read_buffer.begin() + client.read_offset);
+        client.read_offset = 0;
+        client.read_buffer.shrink_to_fit();
+        account(client);
+    }
+
+    if (!next)
+        return std::nullopt;
+
+    // Round up, so that the client is idle for long enough once we wake
+    return std::chrono::ceil<std::chrono::milliseconds>(*next);
+}
+
+void Ipc::watch_writable(miracle::Ipc::IpcClient& client, bool watch)
+{
+    if (client.is_watching_writable == watch)
+        return;
+
+    client.is_watching_writable = watch;
+    update_epoll(client);
+}
+
+void Ipc::update_epoll(miracle::Ipc::IpcClient& client)
+{
+    // epoll always reports hang ups, so a client that is awaiting a reply and has
+    // nothing to write is left out altogether.
+    uint32_t const events = (client.is_awaiting_reply ? 0 : EPOLLIN)
+        | (client.is_watching_writable ? EPOLLOUT : 0);
+    if (events == client.epoll_events)
+        return;
+
+    epoll_event event { .events = events, .data = { .fd = client.client_fd } };
+    int const op = client.epoll_events == 0 ? EPOLL_CTL_ADD
+        : events == 0                       ? EPOLL_CTL_DEL
+                                            : EPOLL_CTL_MOD;
+    if (epoll_ctl(epoll_fd, op, client.client_fd, &event) == -1)
+    {
+        mir::log_error("Unable to update the events of IPC client: %d", (int)client.client_fd);
+        return;
     }
 
-    client.write_buffer_len = 0;
+    client.epoll_events = events;
 }
 
-IpcValidationResult Ipc::parse_i3_command(const char* command)
+IpcValidationResult Ipc::parse_i3_command(std::string_view command)
 {
-    IpcCommandParser parser(command);
-    auto const pending_commands = parser.parse();
-    return executor->process(pending_commands);
+    MIRACLE_TRACE_SCOPE("Ipc::parse_i3_command");
+    if (auto& recorder = EventRecorder::instance(); recorder.is_recording())
+        recorder.record(RecordedIpcCommand { std::string(command) });
+    return executor->process(command_cache.parse(command));
 }
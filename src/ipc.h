@@ -18,22 +18,44 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef MIRACLEWM_IPC_H
 #define MIRACLEWM_IPC_H
 
+#include "config.h"
 #include "ipc_command.h"
 #include "ipc_command_executor.h"
+#include "ipc_write_queue.h"
+#include "json_fragment.h"
+#include "memory_accounting.h"
 #include "mode_observer.h"
+#include "mpsc_queue.h"
+#include "window_observer.h"
 #include "workspace_manager.h"
 #include "workspace_observer.h"
 #include <mir/fd.h>
-#include <miral/runner.h>
+#include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <optional>
 #include <shared_mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 struct sockaddr_un;
 
+namespace mir
+{
+class ServerActionQueue;
+}
+
 namespace miracle
 {
 
+class AnimationTrace;
+class Animator;
 class CommandController;
+class PlacementBatch;
 
 /// This it taken directly from SWAY
 enum IpcType
@@ -57,6 +79,19 @@ enum IpcType
     IPC_GET_INPUTS = 100,
     IPC_GET_SEATS = 101,
 
+    // miracle-specific command types
+    IPC_GET_RENDER_STATS = 200,
+    IPC_GET_ANIMATOR_STATS = 201,
+    IPC_ANIMATION_TRACE = 202,
+    IPC_SET_ENCODING = 203,
+    IPC_GET_IPC_STATS = 204,
+    IPC_COMMAND_TRACE = 205,
+    IPC_GET_WINDOW_UPDATE_STATS = 206,
+    IPC_PLACEMENT_BATCH = 207,
+    IPC_GET_METRICS = 208,
+    IPC_GET_MEMORY = 209,
+    IPC_GET_WINDOW_OPEN_STATS = 210,
+
     // Events sent from sway to clients. Events have the highest bits set.
     IPC_EVENT_WORKSPACE = ((1 << 31) | 0),
     IPC_EVENT_OUTPUT = ((1 << 31) | 1),
@@ -72,50 +107,215 @@ enum IpcType
     IPC_EVENT_INPUT = ((1 << 31) | 21),
 };
 
+/// How the replies and events that are sent to a client are encoded. Clients
+/// select one with IPC_SET_ENCODING, while their requests are always text.
+enum class IpcEncoding
+{
+    json,
+    cbor,
+    msgpack,
+    max
+};
+
 /// Inter process communication for compositor clients (e.g. waybar).
 /// This class will implement I3's interface: https://i3wm.org/docs/ipc.html
 /// plus some of the sway-specific items.
 /// It may be extended in the future.
-class Ipc : public virtual WorkspaceObserver, public virtual ModeObserver
+///
+/// Socket I/O, request parsing and reply encoding happen on a thread of its own,
+/// so that a busy client does not hold up input on the server thread. Requests
+/// that touch the compositor's state are handed to the server thread, and the
+/// read-only queries are answered from an immutable snapshot of that state.
+class Ipc : public virtual WorkspaceObserver, public virtual ModeObserver, public virtual WindowObserver
 {
 public:
-    Ipc(miral::MirRunner& runner,
+    Ipc(std::shared_ptr<mir::ServerActionQueue> const&,
         std::shared_ptr<CommandController> const&,
         std::unique_ptr<IpcCommandExecutor>,
-        std::shared_ptr<Config> const&);
+        std::shared_ptr<Config> const&,
+        std::shared_ptr<Animator> const&,
+        std::shared_ptr<PlacementBatch> const& = nullptr);
+    ~Ipc() override;
 
     void on_created(uint32_t id) override;
     void on_removed(uint32_t id) override;
     void on_focused(std::optional<uint32_t>, uint32_t) override;
     void on_changed(WindowManagerMode mode) override;
+    void on_window_changed(WindowChange change, Container const& container) override;
     void on_shutdown();
 
 private:
     struct IpcClient
     {
         mir::Fd client_fd;
-        std::unique_ptr<miral::FdHandle> handle;
-        uint32_t pending_read_length = 0;
-        IpcType pending_type;
-        std::vector<char> buffer;
-        int write_buffer_len = 0;
-        int subscribed_events = 0;
+        /// Distinguishes this client from a later one that is given the same fd.
+        uint64_t id;
+        /// The bytes received from the client, of which those before [read_offset]
+        /// have been handled.
+        std::vector<char> read_buffer;
+        size_t read_offset = 0;
+        IpcWriteQueue write_queue;
+        bool is_watching_writable = false;
+        /// Set while a request is being answered elsewhere. No more requests
+        /// are read from the client until then, so replies stay in order.
+        bool is_awaiting_reply = false;
+        /// The events that the client is registered for in the epoll fd, if any.
+        uint32_t epoll_events = 0;
+        IpcEncoding encoding = IpcEncoding::json;
+
+        std::chrono::steady_clock::time_point connected_at = std::chrono::steady_clock::now();
+        uint64_t messages_sent = 0;
+        uint64_t events_dropped = 0;
+        uint64_t events_coalesced = 0;
+        /// Set once the client subscribes to "window_delta". Each delta builds on
+        /// the events before it, so none of its window events may be dropped.
+        bool receives_window_deltas = false;
+
+        /// The last time that the client sent or was sent anything.
+        std::chrono::steady_clock::time_point last_active = std::chrono::steady_clock::now();
+        MemoryCharge memory { MemorySubsystem::ipc_clients, sizeof(IpcClient) };
+    };
+
+    /// The state that the read-only queries are answered from.
+    struct IpcSnapshot
+    {
+        /// The version of the [SceneSnapshot] that this was taken alongside.
+        uint64_t scene_version = 0;
+        std::string tree;
+        std::string workspaces;
+        std::string outputs;
+        nlohmann::json binding_state;
+    };
+
+    /// The parts of a snapshot that have been parsed for the clients that chose
+    /// an encoding other than JSON. Each is parsed at most once.
+    struct ParsedSnapshot
+    {
+        nlohmann::json tree;
+        nlohmann::json workspaces;
+        nlohmann::json outputs;
     };
 
+    /// A read-only query that is waiting on the next snapshot.
+    struct SnapshotQuery
+    {
+        int client_fd;
+        uint64_t client_id;
+        IpcType type;
+    };
+
+    std::shared_ptr<mir::ServerActionQueue> server_action_queue;
     std::shared_ptr<CommandController> policy;
     mir::Fd ipc_socket;
-    std::unique_ptr<miral::FdHandle> socket_handle;
     sockaddr_un* ipc_sockaddr = nullptr;
-    std::vector<IpcClient> clients;
+
+    /// Everything below is owned by the IPC thread, unless stated otherwise.
+    std::thread ipc_thread;
+    bool running = true;
+    mir::Fd epoll_fd;
+
+    /// Wakes the IPC thread when [tasks] has been pushed to.
+    mir::Fd wake_fd;
+    MpscQueue<std::function<void()>> tasks;
+    std::unordered_map<int, IpcClient> clients;
+    uint64_t next_client_id = 0;
+
+    /// The queries that will be answered by the snapshot that has been requested
+    /// from the server thread. Queries that arrive in the meantime share it.
+    std::vector<SnapshotQuery> snapshot_queries;
+
+    /// The last snapshot that was taken. Queries are answered from it without
+    /// waking the server thread for as long as the scene has not changed.
+    std::shared_ptr<IpcSnapshot const> last_snapshot;
+
+    /// Applied from the configuration, which is read on the server thread.
+    size_t max_client_queue_bytes = IpcConfiguration {}.max_client_queue_bytes;
+    int listen_backlog = IpcConfiguration {}.listen_backlog;
+    std::array<IpcOverflowPolicy, 32> overflow_policies {};
+
+    /// Answers every connection with the metrics in the Prometheus text format,
+    /// while [metrics_socket_path] is configured.
+    mir::Fd metrics_socket;
+    std::string metrics_socket_path;
+
+    /// The time spent encoding replies and events on the IPC thread.
+    std::chrono::nanoseconds serialization_time { 0 };
+    uint64_t serialization_count = 0;
+
+    /// The fds of the clients that are subscribed to each event type.
+    std::array<std::vector<int>, 32> subscribers;
+
+    /// The fds of the clients that subscribed to "window_delta". They receive
+    /// window events whose container holds only the fields that changed since
+    /// the last event about that container.
+    std::vector<int> window_delta_subscribers;
+
+    /// The container JSON that was last sent to the window_delta subscribers.
+    WindowDeltas window_deltas;
+
+    /// Read by the server thread to skip building window events that nobody wants.
+    std::atomic<bool> has_window_subscribers = false;
+
+    /// Owned by the server thread.
+    int config_handle = -1;
     std::unique_ptr<IpcCommandExecutor> executor;
+    IpcCommandCache command_cache;
     std::shared_ptr<Config> config;
+    std::shared_ptr<Animator> animator;
+    std::shared_ptr<PlacementBatch> placement_batch;
+    std::shared_ptr<AnimationTrace> animation_trace;
 
+    void run();
+    /// Runs [task] on the IPC thread. May be called from any thread.
+    void post(std::function<void()> task);
+    /// Accepts every connection that is waiting on the IPC socket.
+    void accept_clients();
     void disconnect(IpcClient& client);
-    IpcClient& get_client(int fd);
-    void handle_command(IpcClient& client, uint32_t payload_length, IpcType payload_type);
+    void handle_readable(IpcClient& client);
+    /// Handles the requests in the read buffer of [client], up until one must be
+    /// answered elsewhere.
+    void handle_buffered(IpcClient& client);
+    void handle_command(IpcClient& client, IpcType payload_type, std::string_view payload);
+    /// Builds the reply to a request of [client] on the server thread.
+    void reply_from_server(IpcClient& client, IpcType type, std::function<nlohmann::json()> build);
+    /// Answers a read-only query of [client] from the next snapshot.
+    void reply_from_snapshot(IpcClient& client, IpcType type);
+    void answer_snapshot_queries(IpcSnapshot const& snapshot);
+    void answer_snapshot_query(SnapshotQuery const& query, IpcSnapshot const& snapshot, ParsedSnapshot& parsed);
+    /// Sends [serialized] as it is to a client that chose JSON, and otherwise
+    /// re-encodes it from [parsed], parsing it first if that has not happened yet.
+    void send_serialized_reply(IpcClient& client, IpcType command_type, std::string const& serialized, nlohmann::json& parsed);
+    /// Resumes handling the requests of a client once its reply has been sent.
+    void finish_reply(int client_fd, uint64_t client_id);
     void send_reply(IpcClient& client, IpcType command_type, std::string const& payload);
+    void send_reply(IpcClient& client, IpcType command_type, nlohmann::json const& payload);
+    void send_frame(IpcClient& client, IpcWriteQueue::Frame const& frame);
+    /// Like [send_frame], but applies the overflow policy of [event_type] when
+    /// the queue of [client] is full.
+    void send_event(IpcClient& client, IpcType event_type, IpcWriteQueue::Frame const& frame);
+    std::string serialize(nlohmann::json const& payload, IpcEncoding encoding);
+    void apply_config(IpcConfiguration const& ipc_config);
+    void open_metrics_socket(std::string const& path);
+    void close_metrics_socket();
+    void serve_metrics();
+    nlohmann::json stats_to_json() const;
+    void subscribe(IpcClient& client, IpcType event_type);
+    void subscribe(IpcClient& client, std::vector<int>& fds);
+    /// Frames [payload] once and queues it for every client subscribed to [event_type].
+    /// The payload is encoded once for each encoding that the subscribers use.
+    void broadcast(IpcType event_type, nlohmann::json const& payload);
+    void broadcast(std::vector<int> const& fds, IpcType event_type, nlohmann::json const& payload);
+    void broadcast_window_change(WindowChange change, nlohmann::json const& container_json);
     void handle_writeable(IpcClient& client);
-    IpcValidationResult parse_i3_command(const char* command);
+    /// Updates the memory that is accounted to [client].
+    void account(IpcClient& client);
+    /// Releases the read buffers of the clients that have been idle for a while.
+    /// Returns how long until the next client could be trimmed, if any can be.
+    std::optional<std::chrono::milliseconds> trim_idle_clients();
+    void watch_writable(IpcClient& client, bool watch);
+    void update_epoll(IpcClient& client);
+    void update_window_subscribers();
+    IpcValidationResult parse_i3_command(std::string_view command);
 };
 }
 
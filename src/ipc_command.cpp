@@ -16,13 +16,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 **/
 
 #include <cctype>
-#include <sstream>
 #define MIR_LOG_COMPONENT "miracle::i3_command"
 
 #include "ipc_command.h"
 
 #include "ipc.h"
 #include "jpcre2.h"
+#include "perfect_hash.h"
 #include "string_extensions.h"
 #include "window_controller.h"
 #include "window_helpers.h"
@@ -37,17 +37,50 @@ using namespace miracle;
 
 namespace
 {
-const char* CLASS_STRING = "class";
-const char* INSTANCE_STRING = "instance";
-const char* WINDOW_ROLE_STRING = "window_role";
-const char* MACHINE_STRING = "machine";
-const char* ID_STRING = "id";
-const char* TITLE_STRING = "title";
-const char* URGENT_STRING = "urgent";
-const char* WORKSPACE_STRING = "workspace";
-const char* ALL_STRING = "all";
-const char* FLOATING_STRING = "floating";
-const char* TILING_STRING = "tiling";
+constexpr PerfectHashMap<IpcScopeType, 14> scope_types({
+    { "class",       IpcScopeType::class_      },
+    { "instance",    IpcScopeType::instance    },
+    { "window_role", IpcScopeType::window_role },
+    { "machine",     IpcScopeType::machine     },
+    { "id",          IpcScopeType::id          },
+    { "title",       IpcScopeType::title       },
+    { "urgent",      IpcScopeType::urgent      },
+    { "workspace",   IpcScopeType::workspace   },
+    { "all",         IpcScopeType::all         },
+    { "floating",    IpcScopeType::floating    },
+    { "tiling",      IpcScopeType::tiling      },
+    { "app_id",      IpcScopeType::app_id      },
+    { "con_id",      IpcScopeType::con_id      },
+    { "con_mark",    IpcScopeType::con_mark    },
+});
+
+constexpr PerfectHashMap<IpcCommandType, 25> command_types({
+    { "exec",              IpcCommandType::exec              },
+    { "split",             IpcCommandType::split             },
+    { "layout",            IpcCommandType::layout            },
+    { "focus",             IpcCommandType::focus             },
+    { "move",              IpcCommandType::move              },
+    { "swap",              IpcCommandType::swap              },
+    { "sticky",            IpcCommandType::sticky            },
+    { "workspace",         IpcCommandType::workspace         },
+    { "mark",              IpcCommandType::mark              },
+    { "title_format",      IpcCommandType::title_format      },
+    { "title_window_icon", IpcCommandType::title_window_icon },
+    { "border",            IpcCommandType::border            },
+    { "shm_log",           IpcCommandType::shm_log           },
+    { "debug_log",         IpcCommandType::debug_log         },
+    { "restart",           IpcCommandType::restart           },
+    { "reload",            IpcCommandType::reload            },
+    { "exit",              IpcCommandType::exit              },
+    { "scratchpad",        IpcCommandType::scratchpad        },
+    { "nop",               IpcCommandType::nop               },
+    { "i3_bar",            IpcCommandType::i3_bar            },
+    { "gaps",              IpcCommandType::gaps              },
+    { "input",             IpcCommandType::input             },
+    { "resize",            IpcCommandType::resize            },
+    { "append_layout",     IpcCommandType::append_layout     },
+    { "overview",          IpcCommandType::overview          },
+});
 
 constexpr char COMMAND_DELIM = ' ';
 constexpr char INTER_COMMAND_DELIM = ';';
@@ -58,119 +91,75 @@ constexpr char SCOPE_DELIM = ' ';
 constexpr char LITERAL_OPEN = '"';
 constexpr char LITERAL_CLOSE = '"';
 
-IpcScopeType scope_from_string(const std::string& s)
+IpcScopeType scope_from_string(std::string_view s)
 {
-    if (s == CLASS_STRING)
-        return IpcScopeType::class_;
-    else if (s == INSTANCE_STRING)
-        return IpcScopeType::instance;
-    else if (s == WINDOW_ROLE_STRING)
-        return IpcScopeType::window_role;
-    else if (s == MACHINE_STRING)
-        return IpcScopeType::machine;
-    else if (s == ID_STRING)
-        return IpcScopeType::id;
-    else if (s == TITLE_STRING)
-        return IpcScopeType::title;
-    else if (s == URGENT_STRING)
-        return IpcScopeType::urgent;
-    else if (s == WORKSPACE_STRING)
-        return IpcScopeType::workspace;
-    else if (s == ALL_STRING)
-        return IpcScopeType::all;
-    else if (s == FLOATING_STRING)
-        return IpcScopeType::floating;
-    else if (s == TILING_STRING)
-        return IpcScopeType::tiling;
-    else
-        return IpcScopeType::all;
+    return scope_types.find(s).value_or(IpcScopeType::all);
 }
 
-IpcCommandType command_from_string(const std::string& str)
+IpcCommandType command_from_string(std::string_view str)
 {
-    if (str == "exec")
-        return IpcCommandType::exec;
-    else if (str == "split")
-        return IpcCommandType::split;
-    else if (str == "layout")
-        return IpcCommandType::layout;
-    else if (str == "focus")
-        return IpcCommandType::focus;
-    else if (str == "move")
-        return IpcCommandType::move;
-    else if (str == "swap")
-        return IpcCommandType::swap;
-    else if (str == "sticky")
-        return IpcCommandType::sticky;
-    else if (str == "workspace")
-        return IpcCommandType::workspace;
-    else if (str == "mark")
-        return IpcCommandType::mark;
-    else if (str == "title_format")
-        return IpcCommandType::title_format;
-    else if (str == "title_window_icon")
-        return IpcCommandType::title_window_icon;
-    else if (str == "border")
-        return IpcCommandType::border;
-    else if (str == "shm_log")
-        return IpcCommandType::shm_log;
-    else if (str == "debug_log")
-        return IpcCommandType::debug_log;
-    else if (str == "restart")
-        return IpcCommandType::restart;
-    else if (str == "reload")
-        return IpcCommandType::reload;
-    else if (str == "exit")
-        return IpcCommandType::exit;
-    else if (str == "scratchpad")
-        return IpcCommandType::scratchpad;
-    else if (str == "nop")
-        return IpcCommandType::nop;
-    else if (str == "i3_bar")
-        return IpcCommandType::i3_bar;
-    else if (str == "gaps")
-        return IpcCommandType::gaps;
-    else if (str == "input")
-        return IpcCommandType::input;
-    else if (str == "resize")
-        return IpcCommandType::resize;
-    else
-    {
-        mir::log_error("Invalid i3 command type: %s", str.c_str());
-        return IpcCommandType::none;
-    }
+    if (auto const type = command_types.find(str))
+        return type.value();
+
+    mir::log_error("Invalid i3 command type: %.*s", (int)str.size(), str.data());
+    return IpcCommandType::none;
 }
 }
 
-IpcCommandParser::IpcCommandParser(const char* data) :
+IpcCommandParser::IpcCommandParser(std::string_view data) :
     data { data }
 {
 }
 
+void IpcCommandParser::push(ParseState state)
+{
+    assert(depth < max_depth);
+    stack[depth++] = state;
+}
+
+void IpcCommandParser::pop()
+{
+    assert(depth > 1);
+    depth--;
+}
+
+void IpcCommandParser::append(size_t i)
+{
+    if (!has_token())
+        token_start = i;
+    token_end = i + 1;
+}
+
+std::string_view IpcCommandParser::take_token()
+{
+    auto const token = data.substr(token_start, token_end - token_start);
+    token_start = token_end = 0;
+    return token;
+}
+
 IpcParseResult IpcCommandParser::parse()
 {
     IpcParseResult retval;
-    std::stringstream ss;
     for (; index < data.size(); index++)
     {
         char c = data[index];
-        switch (stack.back())
+        switch (top())
         {
         case ParseState::root:
         {
             if (c == SCOPE_OPEN)
             {
-                stack.push_back(ParseState::scope_key);
+                push(ParseState::scope_key);
             }
             else
             {
-                assert(ss.str().empty());
+                assert(!has_token());
                 if (c == SCOPE_DELIM)
                     break;
 
                 if (!has_parsed_command)
                 {
-                    stack.push_back(ParseState::command);
+                    push(ParseState::command);
                 }
                 else
                 {
@@ -180,19 +169,19 @@ IpcParseResult IpcCommandParser::parse()
                         && data[index] == '-'
                         && data[index + 1] == '-')
                     {
-                        stack.push_back(ParseState::option);
+                        push(ParseState::option);
                     }
                     else
                     {
                         can_parse_options = false;
-                        stack.push_back(ParseState::argument);
+                        push(ParseState::argument);
                     }
                 }
 
                 if (c == LITERAL_OPEN)
-                    stack.push_back(ParseState::literal);
+                    push(ParseState::literal);
                 else
-                    ss << c;
+                    append(index);
             }
             break;
         }
@@ -200,33 +189,31 @@ IpcParseResult IpcCommandParser::parse()
         {
             if (c == SCOPE_CLOSE)
             {
-                if (ss.str().empty())
+                if (!has_token())
                 {
-                    stack.pop_back();
+                    pop();
                     break;
                 }
 
-                retval.scope.push_back({ scope_from_string(ss.str()) });
-                ss = std::stringstream();
-                stack.pop_back();
+                retval.scope.push_back({ scope_from_string(take_token()) });
+                pop();
             }
             else if (c == LITERAL_OPEN)
             {
-                assert(ss.str().empty());
-                stack.push_back(ParseState::literal);
+                assert(!has_token());
+                push(ParseState::literal);
             }
             else if (c == SCOPE_EQUALS)
             {
-                if (ss.str().empty())
+                if (!has_token())
                 {
-                    stack.pop_back();
+                    pop();
                     break;
                 }
 
-                retval.scope.push_back({ scope_from_string(ss.str()) });
-                ss = std::stringstream();
-                stack.pop_back();
-                stack.push_back(ParseState::scope_value);
+                retval.scope.push_back({ scope_from_string(take_token()) });
+                pop();
+                push(ParseState::scope_value);
             }
             else if (c == SCOPE_DELIM)
             {
@@ -234,7 +221,7 @@ IpcParseResult IpcCommandParser::parse()
             }
             else
             {
-                ss << c;
+                append(index);
             }
             break;
         }
@@ -243,30 +230,29 @@ IpcParseResult IpcCommandParser::parse()
             if (c == SCOPE_CLOSE || c == SCOPE_DELIM)
             {
                 assert(!retval.scope.empty());
-                retval.scope.back().value = ss.str();
-                ss = std::stringstream();
-                stack.pop_back();
+                retval.scope.back().value = take_token();
+                pop();
 
                 if (c == SCOPE_DELIM)
-                    stack.push_back(ParseState::scope_key);
+                    push(ParseState::scope_key);
             }
             else if (c == LITERAL_OPEN)
             {
-                assert(ss.str().empty());
-                stack.push_back(ParseState::literal);
+                assert(!has_token());
+                push(ParseState::literal);
             }
             else
             {
-                ss << c;
+                append(index);
             }
             break;
         }
         case ParseState::literal:
         {
             if (c == LITERAL_CLOSE)
-                stack.pop_back();
+                pop();
             else
-                ss << c;
+                append(index);
             break;
         }
         case ParseState::command:
@@ -275,18 +261,17 @@ IpcParseResult IpcCommandParser::parse()
             {
                 // In case we are encountering random whitespace before
                 // we've parsed anything, then we ignore the delim.
-                if (ss.str().empty())
+                if (!has_token())
                     break;
 
-                retval.commands.push_back({ command_from_string(ss.str()) });
-                ss = std::stringstream();
-                stack.pop_back();
+                retval.commands.push_back({ command_from_string(take_token()) });
+                pop();
                 can_parse_options = true;
                 has_parsed_command = c != INTER_COMMAND_DELIM;
                 break;
             }
 
-            ss << c;
+            append(index);
             break;
         }
         case ParseState::option:
@@ -295,17 +280,16 @@ IpcParseResult IpcCommandParser::parse()
             {
                 // In case we are encountering random whitespace before
                 // we've parsed anything, then we ignore the delim.
-                if (c == COMMAND_DELIM && ss.str().empty())
+                if (c == COMMAND_DELIM && !has_token())
                     break;
 
-                retval.commands.back().options.push_back(ss.str());
-                ss = std::stringstream();
-                stack.pop_back();
+                retval.commands.back().options.push_back(take_token());
+                pop();
                 has_parsed_command = c != INTER_COMMAND_DELIM;
                 break;
             }
 
-            ss << c;
+            append(index);
             break;
         }
         case ParseState::argument:
@@ -314,40 +298,39 @@ IpcParseResult IpcCommandParser::parse()
             {
                 // In case we are encountering random whitespace before
                 // we've parsed anything, then we ignore the delim.
-                if (ss.str().empty())
+                if (!has_token())
                     break;
 
-                retval.commands.back().arguments.push_back(ss.str());
-                ss = std::stringstream();
-                stack.pop_back();
+                retval.commands.back().arguments.push_back(take_token());
+                pop();
                 has_parsed_command = c != INTER_COMMAND_DELIM;
                 break;
             }
 
-            ss << c;
+            append(index);
             break;
         }
         }
     }
 
-    if (!ss.str().empty())
+    if (has_token())
     {
-        switch (stack.back())
+        switch (top())
         {
         case ParseState::option:
-            retval.commands.back().options.push_back(ss.str());
+            retval.commands.back().options.push_back(take_token());
             break;
         case ParseState::argument:
-            retval.commands.back().arguments.push_back(ss.str());
+            retval.commands.back().arguments.push_back(take_token());
             break;
         case ParseState::command:
-            retval.commands.push_back({ command_from_string(ss.str()) });
+            retval.commands.push_back({ command_from_string(take_token()) });
             break;
         case ParseState::scope_key:
-            retval.scope.push_back({ scope_from_string(ss.str()) });
+            retval.scope.push_back({ scope_from_string(take_token()) });
             break;
         case ParseState::scope_value:
-            retval.scope.back().value = ss.str();
+            retval.scope.back().value = take_token();
             break;
         default:
             break;
@@ -356,3 +339,37 @@ IpcParseResult IpcCommandParser::parse()
 
     return retval;
 }
+
+IpcCommandCache::IpcCommandCache(size_t capacity) :
+    capacity { capacity }
+{
+}
+
+IpcParseResult const& IpcCommandCache::parse(std::string_view command)
+{
+    if (auto it = index.find(command); it != index.end())
+    {
+        hit_count++;
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->result;
+    }
+
+    miss_count++;
+    if (command.size() > max_command_length || capacity == 0)
+    {
+        uncached.command = command;
+        uncached.result = IpcCommandParser(uncached.command).parse();
+        return uncached.result;
+    }
+
+    if (entries.size() >= capacity)
+    {
+        index.erase(entries.back().command);
+        entries.pop_back();
+    }
+
+    auto& entry = entries.emplace_front(Entry { std::string(command), {} });
+    entry.result = IpcCommandParser(entry.command).parse();
+    index.emplace(entry.command, entries.begin());
+    return entry.result;
+}
@@ -18,11 +18,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef MIRACLEWM_I3_COMMAND_H
 #define MIRACLEWM_I3_COMMAND_H
 
+#include "small_vector.h"
+
+#include <array>
+#include <list>
 #include <miral/window.h>
 #include <miral/window_manager_tools.h>
 #include <optional>
 #include <string>
-#include <vector>
+#include <string_view>
+#include <unordered_map>
 
 namespace miracle
 {
@@ -53,7 +58,9 @@ enum class IpcCommandType
     i3_bar,
     gaps,
     input,
-    resize
+    resize,
+    append_layout,
+    overview
 };
 
 // https://i3wm.org/docs/userguide.html#command_criteria
@@ -71,6 +78,7 @@ enum class IpcScopeType
     floating_from,
     tiling,
     tiling_from,
+    app_id,
 
     /// TODO: X11-only
     class_,
@@ -86,27 +94,34 @@ enum class IpcScopeType
 
 struct IpcScope
 {
-    IpcScopeType type;
-    std::string value;
+    IpcScopeType type = IpcScopeType::none;
+    std::string_view value;
 };
 
+/// The options and arguments of a command are views into the string that was
+/// parsed, so they are only valid for as long as that string is.
 struct IpcCommand
 {
-    IpcCommandType type;
-    std::vector<std::string> options;
-    std::vector<std::string> arguments;
+    IpcCommandType type = IpcCommandType::none;
+    SmallVector<std::string_view, 2> options;
+    SmallVector<std::string_view, 4> arguments;
 };
 
 struct IpcParseResult
 {
-    std::vector<IpcScope> scope;
-    std::vector<IpcCommand> commands;
+    SmallVector<IpcScope, 2> scope;
+    SmallVector<IpcCommand, 2> commands;
 };
 
+/// Tokenizes an i3 command without allocating, unless the command has more
+/// items than fit inline in [IpcParseResult].
+///
+/// Quotes are only recognized around a whole token.
 class IpcCommandParser
 {
 public:
-    explicit IpcCommandParser(const char*);
+    /// [data] must outlive the result of [parse].
+    explicit IpcCommandParser(std::string_view data);
     IpcParseResult parse();
 
 private:
@@ -121,12 +136,60 @@ private:
         argument
     };
 
-    std::string data;
-    std::vector<ParseState> stack = { ParseState::root };
+    static constexpr size_t max_depth = 4;
+
+    void push(ParseState state);
+    void pop();
+    [[nodiscard]] ParseState top() const { return stack[depth - 1]; }
+
+    void append(size_t i);
+    [[nodiscard]] bool has_token() const { return token_end > token_start; }
+    [[nodiscard]] std::string_view take_token();
+
+    std::string_view data;
+    std::array<ParseState, max_depth> stack = { ParseState::root };
+    size_t depth = 1;
     size_t index = 0;
+    size_t token_start = 0;
+    size_t token_end = 0;
     bool has_parsed_command = false;
     bool can_parse_options = true;
 };
+
+/// Remembers the parse results of the most recently used commands, as bars and
+/// keybindings send the same few commands over and over.
+class IpcCommandCache
+{
+public:
+    /// Commands that are longer than this are parsed every time.
+    static constexpr size_t max_command_length = 256;
+
+    explicit IpcCommandCache(size_t capacity = 64);
+
+    /// Returns the parse result of [command]. The result is valid until the
+    /// next call to [parse].
+    IpcParseResult const& parse(std::string_view command);
+
+    [[nodiscard]] size_t size() const { return entries.size(); }
+    [[nodiscard]] size_t hits() const { return hit_count; }
+    [[nodiscard]] size_t misses() const { return miss_count; }
+
+private:
+    /// The result holds views into [command], which never moves once the entry
+    /// is in the list.
+    struct Entry
+    {
+        std::string command;
+        IpcParseResult result;
+    };
+
+    size_t const capacity;
+    std::list<Entry> entries;
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+    Entry uncached;
+    size_t hit_count = 0;
+    size_t miss_count = 0;
+};
 }
 
 #endif // MIRACLEWM_I3_COMMAND_H
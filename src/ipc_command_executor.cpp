@@ -18,11 +18,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "ipc_command_executor.h"
 #include "auto_restarting_launcher.h"
 #include "command_controller.h"
+#include "container_index.h"
 #include "direction.h"
 #include "ipc_command.h"
+#include "layout_template.h"
 #include "leaf_container.h"
 #include "output_manager.h"
 #include "parent_container.h"
+#include "tracing.h"
 #include "utility_general.h"
 #include "window_controller.h"
 #include "window_helpers.h"
@@ -30,6 +33,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define MIR_LOG_COMPONENT "miracle"
 #include <format>
+#include <fstream>
 #include <mir/log.h>
 #include <miral/application_info.h>
 
@@ -57,7 +61,7 @@ public:
         return index < command.arguments.size();
     }
 
-    [[nodiscard]] std::string const& current() const
+    [[nodiscard]] std::string_view current() const
     {
         return command.arguments[index];
     }
@@ -67,33 +71,30 @@ public:
         if (!next())
             return false;
 
-        try
+        if (!try_get_number(current(), out))
         {
-            out = std::stoi(current());
-            if (next())
-            {
-                // We default to assuming the value is in pixels
-                if (current() == "ppt")
-                {
-                    float ppt = static_cast<float>(out) / 100.f;
-                    out = static_cast<float>(available_area) * ppt;
-                    return true;
-                }
-                else if (current() == "px")
-                {
-                    return true;
-                }
-            }
-
-            // The 'next' item wasn't ppt or px, so let's pop out of it.
-            prev();
-            return true;
+            mir::log_error("Invalid argument: %.*s", (int)current().size(), current().data());
+            return false;
         }
-        catch (std::invalid_argument const& e)
+
+        if (next())
         {
-            mir::log_error("Invalid argument: %s", command.arguments[index].c_str());
-            return false;
+            // We default to assuming the value is in pixels
+            if (current() == "ppt")
+            {
+                float ppt = static_cast<float>(out) / 100.f;
+                out = static_cast<float>(available_area) * ppt;
+                return true;
+            }
+            else if (current() == "px")
+            {
+                return true;
+            }
         }
+
+        // The 'next' item wasn't ppt or px, so let's pop out of it.
+        prev();
+        return true;
     }
 
 protected:
@@ -108,21 +109,33 @@ IpcCommandExecutor::IpcCommandExecutor(
     std::shared_ptr<WorkspaceManager> const& workspace_manager,
     std::shared_ptr<CompositorState> const& state,
     AutoRestartingLauncher& launcher,
-    std::shared_ptr<WindowController> const& window_controller) :
+    std::shared_ptr<WindowController> const& window_controller,
+    std::shared_ptr<ContainerIndex> const& container_index) :
     policy { policy },
     output_manager { output_manager },
     workspace_manager { workspace_manager },
     state { state },
     launcher { launcher },
-    window_controller { window_controller }
+    window_controller { window_controller },
+    container_index { container_index }
 {
 }
 
 IpcValidationResult IpcCommandExecutor::process(miracle::IpcParseResult const& command_list)
 {
+    MIRACLE_TRACE_SCOPE("IpcCommandExecutor::process");
+    // The list is applied as a whole: the lock is taken once rather than by each
+    // command, and nothing from another thread can land in between commands.
+    // The containers are placed once all of the commands have been applied, so
+    // that a long list of commands costs a single relayout.
+    auto const lock = policy->lock();
+    CommitBatch batch(*state);
     IpcValidationResult result;
     for (auto const& command : command_list.commands)
     {
+        if (command.type != IpcCommandType::resize)
+            flush_pending_resize();
+
         switch (command.type)
         {
         case IpcCommandType::exec:
@@ -162,34 +175,56 @@ IpcValidationResult IpcCommandExecutor::process(miracle::IpcParseResult const& c
         case IpcCommandType::reload:
             result = process_reload(command, command_list);
             break;
+        case IpcCommandType::restart:
+            result = process_restart(command, command_list);
+            break;
+        case IpcCommandType::append_layout:
+            result = process_append_layout(command, command_list);
+            break;
+        case IpcCommandType::overview:
+            result = process_overview(command, command_list);
+            break;
+        case IpcCommandType::nop:
+            result = {};
+            break;
         default:
             result = parse_error(std::format("Unsupported command type: {}", (int)command.type));
             break;
         }
 
         if (!result.success)
+        {
+            flush_pending_resize();
             return result;
+        }
     }
 
+    flush_pending_resize();
     return {};
 }
 
 miral::Window IpcCommandExecutor::get_window_meeting_criteria(IpcParseResult const& command_list)
 {
-    for (auto const& container : state->containers())
-    {
-        if (container.expired())
-            continue;
+    auto const matches = container_index->find(command_list.scope);
+    if (matches.empty())
+        return miral::Window {};
 
-        auto window = container.lock()->window();
-        if (auto const& w = window.value())
+    // When several windows match, the most recently focused one is chosen.
+    auto chosen = matches.front();
+    if (matches.size() > 1)
+    {
+        for (auto const& container : state->containers())
         {
-            // if (command_list.meets_criteria(w, window_controller))
-            return window.value();
+            auto const locked = container.lock();
+            if (locked && std::find(matches.begin(), matches.end(), locked) != matches.end())
+            {
+                chosen = locked;
+                break;
+            }
         }
     }
 
-    return miral::Window {};
+    return chosen->window().value_or(miral::Window {});
 }
 
 IpcValidationResult IpcCommandExecutor::parse_error(std::string error)
@@ -204,6 +239,7 @@ IpcValidationResult IpcCommandExecutor::parse_error(std::string error)
 
 IpcValidationResult IpcCommandExecutor::process_exec(miracle::IpcCommand const& command, miracle::IpcParseResult const& command_list)
 {
+    MIRACLE_TRACE_SCOPE("IpcCommandExecutor::process_exec");
     if (command.arguments.empty())
         return parse_error("process_exec: no arguments were supplied");
 
@@ -217,7 +253,8 @@ IpcValidationResult IpcCommandExecutor::process_exec(miracle::IpcCommand const&
     std::string exec_cmd;
     for (auto const& arg : command.arguments)
     {
-        exec_cmd += arg + " ";
+        exec_cmd += arg;
+        exec_cmd += ' ';
     }
 
     StartupApp app { exec_cmd, false, no_startup_id };
@@ -227,6 +264,7 @@ IpcValidationResult IpcCommandExecutor::process_exec(miracle::IpcCommand const&
 
 IpcValidationResult IpcCommandExecutor::process_split(miracle::IpcCommand const& command, miracle::IpcParseResult const& command_list)
 {
+    MIRACLE_TRACE_SCOPE("IpcCommandExecutor::process_split");
     if (command.arguments.empty())
         return parse_error("process_split: no arguments were supplied");
 
@@ -244,7 +282,7 @@ IpcValidationResult IpcCommandExecutor::process_split(miracle::IpcCommand const&
     }
     else
     {
-        return parse_error(std::format("process_split: unknown argument {}", command.arguments.front().c_str()));
+        return parse_error(std::format("process_split: unknown argument {}", command.arguments.front()));
     }
 
     return {};
@@ -252,6 +290,7 @@ IpcValidationResult IpcCommandExecutor::process_split(miracle::IpcCommand const&
 
 IpcValidationResult IpcCommandExecutor::process_focus(IpcCommand const& command, IpcParseResult const& command_list)
 {
+    MIRACLE_TRACE_SCOPE("IpcCommandExecutor::process_focus");
     // https://i3wm.org/docs/userguide.html#_focusing_moving_containers
     if (command.arguments.empty())
     {
@@ -366,37 +405,35 @@ IpcValidationResult IpcCommandExecutor::process_focus(IpcCommand const& command,
 
 namespace
 {
-bool parse_move_distance(std::vector<std::string> const& arguments, int& index, int total_size, int& out)
+bool parse_move_distance(decltype(IpcCommand::arguments) const& arguments, int& index, int total_size, int& out)
 {
     auto size = arguments.size() - index;
     if (size <= 1)
         return false;
 
-    try
+    if (!try_get_number(arguments[index], out))
     {
-        out = std::stoi(arguments[index]);
-        if (size == 2)
-        {
-            // We default to assuming the value is in pixels
-            if (arguments[index + 1] == "ppt")
-            {
-                float ppt = static_cast<float>(out) / 100.f;
-                out = (float)total_size * ppt;
-            }
-        }
-
-        return true;
+        mir::log_error("Invalid argument: %.*s", (int)arguments[index].size(), arguments[index].data());
+        return false;
     }
-    catch (std::invalid_argument const& e)
+
+    if (size == 2)
     {
-        mir::log_error("Invalid argument: %s", arguments[index].c_str());
-        return false;
+        // We default to assuming the value is in pixels
+        if (arguments[index + 1] == "ppt")
+        {
+            float ppt = static_cast<float>(out) / 100.f;
+            out = (float)total_size * ppt;
+        }
     }
+
+    return true;
 }
 }
 
 IpcValidationResult IpcCommandExecutor::process_move(IpcCommand const& command, IpcParseResult const& command_list)
 {
+    MIRACLE_TRACE_SCOPE("IpcCommandExecutor::process_move");
     auto const& active_output = output_manager->focused();
     if (!active_output)
         return parse_error("process_move: output is not set");
@@ -534,7 +571,7 @@ IpcValidationResult IpcCommandExecutor::process_move(IpcCommand const& command,
             }
             else
             {
-                policy->move_active_to_workspace_named(arg3, back_and_forth);
+                policy->move_active_to_workspace_named(std::string(arg3), back_and_forth);
                 return {};
             }
         }
@@ -590,6 +627,7 @@ IpcValidationResult IpcCommandExecutor::process_move(IpcCommand const& command,
 
 IpcValidationResult IpcCommandExecutor::process_sticky(IpcCommand const& command, IpcParseResult const& command_list)
 {
+    MIRACLE_TRACE_SCOPE("IpcCommandExecutor::process_sticky");
     if (command.arguments.empty())
         return parse_error("process_sticky: expects arguments");
 
@@ -601,13 +639,14 @@ IpcValidationResult IpcCommandExecutor::process_sticky(IpcCommand const& command
     else if (arg0 == "toggle")
         policy->toggle_pinned_to_workspace();
     else
-        mir::log_warning("process_sticky: unknown arguments: %s", arg0.c_str());
+        mir::log_warning("process_sticky: unknown arguments: %.*s", (int)arg0.size(), arg0.data());
 
     return {};
 }
 
 IpcValidationResult IpcCommandExecutor::process_input(IpcCommand const& command, IpcParseResult const& command_list)
 {
+    MIRACLE_TRACE_SCOPE("IpcCommandExecutor::process_input");
     // Payloads appear in the following format:
     //    [type:X, xkb_Y, Z]
     // where X is something like "keyboard", Y is the variable that we want to change
@@ -620,7 +659,7 @@ IpcValidationResult IpcCommandExecutor::process_input(IpcCommand const& command,
     const size_t TYPE_PREFIX_LEN = strlen(TYPE_PREFIX);
     std::string_view type_str = command.arguments[0];
     if (!type_str.starts_with("type:"))
-        return parse_error(std::format("process_input: 'type' string is misformatted: {}", command.arguments[0].c_str()));
+        return parse_error(std::format("process_input: 'type' string is misformatted: {}", command.arguments[0]));
 
     std::string_view type = type_str.substr(TYPE_PREFIX_LEN);
     assert(type == "keyboard");
@@ -629,7 +668,7 @@ IpcValidationResult IpcCommandExecutor::process_input(IpcCommand const& command,
     const char* const XKB_PREFIX = "xkb_";
     const size_t XKB_PREFIX_LEN = strlen(XKB_PREFIX);
     if (!xkb_str.starts_with(XKB_PREFIX))
-        return parse_error(std::format("process_input: 'xkb' string is misformatted: {}", command.arguments[1].c_str()));
+        return parse_error(std::format("process_input: 'xkb' string is misformatted: {}", command.arguments[1]));
 
     std::string_view xkb_variable_name = xkb_str.substr(XKB_PREFIX_LEN);
     assert(xkb_variable_name == "model"
@@ -657,10 +696,11 @@ IpcValidationResult IpcCommandExecutor::process_input(IpcCommand const& command,
 
 IpcValidationResult IpcCommandExecutor::process_workspace(IpcCommand const& command, IpcParseResult const& command_list)
 {
+    MIRACLE_TRACE_SCOPE("IpcCommandExecutor::process_workspace");
     if (command.arguments.empty())
         return parse_error("process_workspace: no arguments provided");
 
-    std::string const& arg0 = command.arguments[0];
+    std::string_view arg0 = command.arguments[0];
     if (arg0 == "next")
         policy->next_workspace();
     else if (arg0 == "prev")
@@ -685,11 +725,10 @@ IpcValidationResult IpcCommandExecutor::process_workspace(IpcCommand const& comm
     }
     else
     {
-        std::string const* arg1 = &arg0;
         auto const back_and_forth = std::find(command.options.begin(), command.options.end(), "--no-auto-back-and-forth") == command.options.end();
 
         int number = -1;
-        if (try_get_number(*arg1, number))
+        if (try_get_number(arg0, number))
         {
             // Check if we just have "workspace number"
             if (command.arguments.size() < 3)
@@ -699,13 +738,12 @@ IpcValidationResult IpcCommandExecutor::process_workspace(IpcCommand const& comm
             }
 
             // We have "workspace number <name>"
-            arg1 = &command.arguments[2];
-            policy->select_workspace(*arg1, back_and_forth);
+            policy->select_workspace(std::string(command.arguments[2]), back_and_forth);
         }
         else
         {
             // We have "workspace <name>"
-            policy->select_workspace(*arg1, back_and_forth);
+            policy->select_workspace(std::string(arg0), back_and_forth);
         }
     }
 
@@ -714,8 +752,9 @@ IpcValidationResult IpcCommandExecutor::process_workspace(IpcCommand const& comm
 
 IpcValidationResult IpcCommandExecutor::process_layout(IpcCommand const& command, IpcParseResult const& command_list)
 {
+    MIRACLE_TRACE_SCOPE("IpcCommandExecutor::process_layout");
     // https://i3wm.org/docs/userguide.html#manipulating_layout
-    std::string const& arg0 = command.arguments[0];
+    std::string_view arg0 = command.arguments[0];
     if (arg0 == "default")
         policy->set_layout_default();
     else if (arg0 == "tabbed")
@@ -819,10 +858,11 @@ IpcValidationResult IpcCommandExecutor::process_layout(IpcCommand const& command
 
 IpcValidationResult IpcCommandExecutor::process_scratchpad(IpcCommand const& command, IpcParseResult const& command_list)
 {
+    MIRACLE_TRACE_SCOPE("IpcCommandExecutor::process_scratchpad");
     if (command.arguments.empty())
         return parse_error("process_scratchpad: no arguments provided");
 
-    std::string const& arg0 = command.arguments[0];
+    std::string_view arg0 = command.arguments[0];
     if (arg0 != "show")
         return parse_error("process_scratchpad: all scratchpad commands must be 'scratchpad show'");
 
@@ -832,6 +872,24 @@ IpcValidationResult IpcCommandExecutor::process_scratchpad(IpcCommand const& com
 
 namespace
 {
+/// The size of the output that a resize happens on, which 'ppt' distances are
+/// resolved against. It is looked up once per command rather than per argument.
+struct OutputMetrics
+{
+    int width = 0;
+    int height = 0;
+};
+
+std::optional<OutputMetrics> metrics_for_focused(CompositorState const& state)
+{
+    auto const& container = state.focused_container();
+    if (!container || !container->get_output())
+        return std::nullopt;
+
+    auto const size = container->get_output()->get_area().size;
+    return OutputMetrics { size.width.as_value(), size.height.as_value() };
+}
+
 struct ResizeAdjust
 {
     bool success = true;
@@ -841,15 +899,11 @@ struct ResizeAdjust
     int second = 0;
 };
 
-ResizeAdjust parse_resize(std::shared_ptr<CompositorState> const& state, ArgumentsIndexer& indexer, int multiplier)
+ResizeAdjust parse_resize(OutputMetrics const& metrics, ArgumentsIndexer& indexer, int multiplier)
 {
     if (!indexer.next())
         return { .success = false, .error = "process_resize: expected argument after 'resize grow'" };
 
-    auto const& container = state->focused_container();
-    if (!container)
-        return { .success = false, .error = "No container is selcted" };
-
     ResizeAdjust result;
     if (indexer.current() == "width" || indexer.current() == "horizontal")
     {
@@ -877,7 +931,7 @@ ResizeAdjust parse_resize(std::shared_ptr<CompositorState> const& state, Argumen
     }
     else
     {
-        return { .success = false, .error = std::format("Unknown direction value: {}", indexer.current().c_str()) };
+        return { .success = false, .error = std::format("Unknown direction value: {}", indexer.current()) };
     }
 
     int available_space = 0;
@@ -885,10 +939,10 @@ ResizeAdjust parse_resize(std::shared_ptr<CompositorState> const& state, Argumen
     {
     case Direction::up:
     case Direction::down:
-        available_space = container->get_output()->get_area().size.height.as_value();
+        available_space = metrics.height;
         break;
     default:
-        available_space = container->get_output()->get_area().size.width.as_value();
+        available_space = metrics.width;
         break;
     }
 
@@ -917,18 +971,14 @@ struct SetResizeResult
     std::optional<int> height;
 };
 
-SetResizeResult parse_set_resize(std::shared_ptr<CompositorState> const& state, ArgumentsIndexer& indexer)
+SetResizeResult parse_set_resize(OutputMetrics const& metrics, ArgumentsIndexer& indexer)
 {
-    auto const& container = state->focused_container();
-    if (!container)
-        return { .success = false, .error = "Container is not selected" };
-
     SetResizeResult result;
     int width = 0, height = 0;
-    if (!indexer.parse_move_distance(container->get_output()->get_area().size.width.as_value(), width))
+    if (!indexer.parse_move_distance(metrics.width, width))
         return { .success = false, .error = "invalid width" };
 
-    if (!indexer.parse_move_distance(container->get_output()->get_area().size.height.as_value(), height))
+    if (!indexer.parse_move_distance(metrics.height, height))
         return { .success = false, .error = "invalid height" };
 
     if (width != 0)
@@ -942,46 +992,139 @@ SetResizeResult parse_set_resize(std::shared_ptr<CompositorState> const& state,
 
 IpcValidationResult IpcCommandExecutor::process_resize(IpcCommand const& command, IpcParseResult const& command_list)
 {
+    MIRACLE_TRACE_SCOPE("IpcCommandExecutor::process_resize");
     if (command.arguments.empty())
         return parse_error("process_resize: no arguments provided");
 
     ArgumentsIndexer indexer(command);
     auto const& arg0 = indexer.current();
-    if (arg0 == "grow")
-    {
-        auto adjust = parse_resize(state, indexer, 1);
-        if (!adjust.success)
-            return parse_error(adjust.error);
+    if (arg0 != "grow" && arg0 != "shrink" && arg0 != "set")
+        return parse_error(std::format("process_resize: unexpected argument: {}", arg0));
 
-        policy->try_resize(adjust.direction, adjust.first);
-    }
-    else if (arg0 == "shrink")
+    auto const metrics = metrics_for_focused(*state);
+    if (!metrics)
+        return parse_error("process_resize: no container is selected");
+
+    if (arg0 == "grow" || arg0 == "shrink")
     {
-        auto adjust = parse_resize(state, indexer, -1);
+        auto adjust = parse_resize(*metrics, indexer, arg0 == "grow" ? 1 : -1);
         if (!adjust.success)
             return parse_error(adjust.error);
 
-        policy->try_resize(adjust.direction, adjust.first);
+        // Resizes in the same direction are summed until a different command
+        // comes along, so that a run of them costs a single resize.
+        if (pending_resize && pending_resize->direction != adjust.direction)
+            flush_pending_resize();
+        if (pending_resize)
+            pending_resize->pixels += adjust.first;
+        else
+            pending_resize = PendingResize { adjust.direction, adjust.first };
     }
-    else if (arg0 == "set")
+    else
     {
-        auto result = parse_set_resize(state, indexer);
+        auto result = parse_set_resize(*metrics, indexer);
         if (!result.success)
             return parse_error(result.error);
 
+        flush_pending_resize();
         policy->try_set_size(result.width, result.height);
     }
-    else
-        return parse_error(std::format("process_resize: unexpected argument: {}", arg0.c_str()));
 
     return {};
 }
 
+void IpcCommandExecutor::flush_pending_resize()
+{
+    if (!pending_resize)
+        return;
+
+    auto const resize = *pending_resize;
+    pending_resize.reset();
+    policy->try_resize(resize.direction, resize.pixels);
+}
+
 IpcValidationResult IpcCommandExecutor::process_reload(IpcCommand const& command, IpcParseResult const&)
 {
+    MIRACLE_TRACE_SCOPE("IpcCommandExecutor::process_reload");
     if (!command.arguments.empty())
         return parse_error("'reload' command expects no arguments");
 
     policy->reload_config();
     return {};
 }
+
+IpcValidationResult IpcCommandExecutor::process_restart(IpcCommand const& command, IpcParseResult const&)
+{
+    MIRACLE_TRACE_SCOPE("IpcCommandExecutor::process_restart");
+    if (!command.arguments.empty())
+        return parse_error("'restart' command expects no arguments");
+
+    policy->restart();
+    return {};
+}
+
+IpcValidationResult IpcCommandExecutor::process_append_layout(IpcCommand const& command, IpcParseResult const&)
+{
+    MIRACLE_TRACE_SCOPE("IpcCommandExecutor::process_append_layout");
+    if (command.arguments.empty())
+        return parse_error("'append_layout' command expects a path");
+
+    std::string path;
+    for (auto const& argument : command.arguments)
+    {
+        if (!path.empty())
+            path += ' ';
+        path += argument;
+    }
+
+    std::ifstream file(path);
+    if (!file)
+        return parse_error("append_layout: unable to open " + path);
+
+    nlohmann::json json;
+    try
+    {
+        // The layouts that i3-save-tree writes are commented
+        json = nlohmann::json::parse(file, nullptr, true, true);
+    }
+    catch (nlohmann::json::parse_error const& e)
+    {
+        return parse_error(std::string("append_layout: ") + e.what());
+    }
+
+    auto layout = parse_layout_template(json);
+    if (auto const* error = std::get_if<std::string>(&layout))
+        return parse_error("append_layout: " + *error);
+
+    auto const output = output_manager->focused();
+    if (!output || !output->active())
+        return parse_error("append_layout: there is no active workspace");
+
+    if (!output->active()->append_layout(std::get<LayoutTemplateNode>(layout)))
+        return parse_error("append_layout: the workspace must not have any tiled windows");
+
+    return {};
+}
+
+IpcValidationResult IpcCommandExecutor::process_overview(IpcCommand const& command, IpcParseResult const&)
+{
+    MIRACLE_TRACE_SCOPE("IpcCommandExecutor::process_overview");
+    if (command.arguments.size() != 1)
+        return parse_error("'overview' command expects one of 'enable', 'disable' or 'toggle'");
+
+    auto const output = output_manager->focused();
+    if (!output)
+        return parse_error("overview: there is no focused output");
+
+    auto const& arg0 = command.arguments.front();
+    if (arg0 == "enable")
+        output->set_overview(true);
+    else if (arg0 == "disable")
+        output->set_overview(false);
+    else if (arg0 == "toggle")
+        output->set_overview(!output->is_showing_overview());
+    else
+        return parse_error(std::format("overview: unexpected argument: {}", arg0));
+
+    return {};
+}
@@ -19,13 +19,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIRACLEWM_I_3_COMMAND_EXECUTOR_H
 
 #include "compositor_state.h"
+#include "direction.h"
 #include "ipc_command.h"
 #include <mir/glib_main_loop.h>
+#include <optional>
 
 namespace miracle
 {
 
 class CommandController;
+class ContainerIndex;
 class WorkspaceManager;
 class AutoRestartingLauncher;
 class WindowController;
@@ -49,7 +52,8 @@ public:
         std::shared_ptr<WorkspaceManager> const&,
         std::shared_ptr<CompositorState> const&,
         AutoRestartingLauncher&,
-        std::shared_ptr<WindowController> const&);
+        std::shared_ptr<WindowController> const&,
+        std::shared_ptr<ContainerIndex> const&);
     IpcValidationResult process(IpcParseResult const&);
 
 private:
@@ -59,7 +63,18 @@ private:
     std::shared_ptr<CompositorState> state;
     AutoRestartingLauncher& launcher;
     std::shared_ptr<WindowController> window_controller;
+    std::shared_ptr<ContainerIndex> container_index;
 
+    /// A 'resize grow' or 'resize shrink' that has yet to be applied.
+    struct PendingResize
+    {
+        Direction direction;
+        int pixels;
+    };
+    std::optional<PendingResize> pending_resize;
+
+    /// Applies the [pending_resize], if there is one.
+    void flush_pending_resize();
     miral::Window get_window_meeting_criteria(IpcParseResult const&);
     IpcValidationResult process_exec(IpcCommand const&, IpcParseResult const&);
     IpcValidationResult process_split(IpcCommand const&, IpcParseResult const&);
@@ -72,6 +87,9 @@ private:
     IpcValidationResult process_scratchpad(IpcCommand const&, IpcParseResult const&);
     IpcValidationResult process_resize(IpcCommand const&, IpcParseResult const&);
     IpcValidationResult process_reload(IpcCommand const&, IpcParseResult const&);
+    IpcValidationResult process_restart(IpcCommand const&, IpcParseResult const&);
+    IpcValidationResult process_append_layout(IpcCommand const&, IpcParseResult const&);
+    IpcValidationResult process_overview(IpcCommand const&, IpcParseResult const&);
 
     IpcValidationResult parse_error(std::string error);
 };
@@ -0,0 +1,145 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "ipc_write_queue.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+using namespace miracle;
+
+namespace
+{
+const char ipc_magic[] = { 'i', '3', '-', 'i', 'p', 'c' };
+static_assert(sizeof(ipc_magic) + 2 * sizeof(uint32_t) == IpcWriteQueue::header_size);
+
+/// The most messages that are gathered into one writev.
+constexpr size_t max_messages_per_write = 64;
+}
+
+IpcWriteQueue::Frame IpcWriteQueue::frame(uint32_t type, std::string_view payload)
+{
+    uint32_t const payload_length = payload.size();
+    std::string result;
+    result.reserve(header_size + payload_length);
+    result.append(ipc_magic, sizeof(ipc_magic));
+    result.append(reinterpret_cast<char const*>(&payload_length), sizeof(payload_length));
+    result.append(reinterpret_cast<char const*>(&type), sizeof(type));
+    result.append(payload);
+    return std::make_shared<std::string const>(std::move(result));
+}
+
+uint32_t IpcWriteQueue::type_of(Frame const& frame)
+{
+    uint32_t type;
+    memcpy(&type, frame->data() + sizeof(ipc_magic) + sizeof(uint32_t), sizeof(type));
+    return type;
+}
+
+void IpcWriteQueue::push(Frame frame)
+{
+    pending_bytes += frame->size();
+    messages.push_back({ std::move(frame) });
+}
+
+size_t IpcWriteQueue::drop_oldest(uint32_t type, size_t incoming, size_t limit)
+{
+    size_t dropped = 0;
+    for (auto it = messages.begin(); it != messages.end() && pending_bytes + incoming > limit;)
+    {
+        if (it->offset == 0 && type_of(it->frame) == type)
+        {
+            pending_bytes -= it->frame->size();
+            it = messages.erase(it);
+            dropped++;
+        }
+        else
+            ++it;
+    }
+
+    return dropped;
+}
+
+size_t IpcWriteQueue::remove(uint32_t type)
+{
+    return std::erase_if(messages, [&](Message const& message)
+    {
+        if (message.offset != 0 || type_of(message.frame) != type)
+            return false;
+
+        pending_bytes -= message.frame->size();
+        return true;
+    });
+}
+
+IpcWriteQueue::WriteResult IpcWriteQueue::write_to(int fd)
+{
+    while (!messages.empty())
+    {
+        std::array<iovec, max_messages_per_write> iov;
+        auto const count = std::min(messages.size(), max_messages_per_write);
+        for (size_t i = 0; i < count; i++)
+        {
+            auto const& message = messages[i];
+            iov[i] = {
+                .iov_base = const_cast<char*>(message.frame->data()) + message.offset,
+                .iov_len = message.frame->size() - message.offset
+            };
+        }
+
+        msghdr msg {};
+        msg.msg_iov = iov.data();
+        msg.msg_iovlen = count;
+
+        // Sending with MSG_NOSIGNAL turns a client that has gone away into EPIPE rather than SIGPIPE.
+        ssize_t const written = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (written == -1)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return WriteResult::pending;
+            if (errno == EINTR)
+                continue;
+            return WriteResult::error;
+        }
+
+        consume(written);
+    }
+
+    return WriteResult::done;
+}
+
+void IpcWriteQueue::consume(size_t count)
+{
+    pending_bytes -= count;
+    while (count > 0)
+    {
+        auto& message = messages.front();
+        auto const remaining = message.frame->size() - message.offset;
+        if (count < remaining)
+        {
+            message.offset += count;
+            return;
+        }
+
+        count -= remaining;
+        messages.pop_front();
+    }
+}
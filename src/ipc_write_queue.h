@@ -0,0 +1,93 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_IPC_WRITE_QUEUE_H
+#define MIRACLE_WM_IPC_WRITE_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace miracle
+{
+
+/// The messages that are waiting to be written to a single IPC client.
+///
+/// Messages are framed once into an immutable buffer that is shared rather than
+/// copied, so an event that is broadcast to every subscriber is only serialized
+/// once. Partially written messages are tracked by an offset, and everything
+/// that is pending is handed to the kernel in a single writev.
+class IpcWriteQueue
+{
+public:
+    using Frame = std::shared_ptr<std::string const>;
+
+    static constexpr size_t header_size = 14;
+
+    enum class WriteResult
+    {
+        done,
+        pending,
+        error
+    };
+
+    /// Creates the header and payload of a message of [type] in one buffer.
+    static Frame frame(uint32_t type, std::string_view payload);
+
+    /// The message type that is written in the header of [frame].
+    static uint32_t type_of(Frame const& frame);
+
+    /// Queues [frame] to be written after everything that is already pending.
+    void push(Frame frame);
+
+    /// Removes the oldest messages of [type] until [incoming] more bytes fit
+    /// within [limit]. Returns the number of messages that were removed.
+    ///
+    /// A message that has been partially written is never removed.
+    size_t drop_oldest(uint32_t type, size_t incoming, size_t limit);
+
+    /// Removes every message of [type] that has yet to be written. Returns the
+    /// number of messages that were removed.
+    size_t remove(uint32_t type);
+
+    /// Writes as much of the queue to [fd] as it will accept without blocking.
+    WriteResult write_to(int fd);
+
+    /// The number of bytes that have yet to be written.
+    [[nodiscard]] size_t size() const { return pending_bytes; }
+    [[nodiscard]] bool empty() const { return messages.empty(); }
+    [[nodiscard]] size_t count() const { return messages.size(); }
+
+private:
+    struct Message
+    {
+        Frame frame;
+        size_t offset = 0;
+    };
+
+    void consume(size_t count);
+
+    std::deque<Message> messages;
+    size_t pending_bytes = 0;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_IPC_WRITE_QUEUE_H
@@ -0,0 +1,113 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_JSON_FRAGMENT_H
+#define MIRACLE_WM_JSON_FRAGMENT_H
+
+#include "memory_accounting.h"
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace miracle
+{
+
+/// Holds the serialized JSON of an object along with the [Key] that it was
+/// built from. The JSON is only rebuilt once the key changes, so an unchanged
+/// object costs a comparison rather than a serialization.
+///
+/// The key must hold every input of the JSON.
+template <typename Key>
+class JsonFragmentCache
+{
+public:
+    /// Returns the JSON for [key], calling [build] with [key] if it differs
+    /// from the key of the cached JSON.
+    template <typename F>
+    std::string const& get(Key key, F const& build)
+    {
+        if (!cached_key || !(*cached_key == key))
+        {
+            serialized = build(key);
+            cached_key = std::move(key);
+            memory.resize(serialized.capacity());
+        }
+
+        return serialized;
+    }
+
+private:
+    std::optional<Key> cached_key;
+    std::string serialized;
+    MemoryCharge memory { MemorySubsystem::json_caches };
+};
+
+/// Returns the fields of [current] that are missing from or differ in [previous].
+inline nlohmann::json json_delta(nlohmann::json const& previous, nlohmann::json const& current)
+{
+    nlohmann::json delta = nlohmann::json::object();
+    for (auto const& [key, value] : current.items())
+    {
+        auto const it = previous.find(key);
+        if (it == previous.end() || *it != value)
+            delta[key] = value;
+    }
+
+    return delta;
+}
+
+/// Turns the containers of window events into deltas against the last event
+/// about the same container, which is the baseline of every subscriber.
+class WindowDeltas
+{
+public:
+    /// The container to send for an event about [container]: all of it if there
+    /// is no baseline for it yet, and otherwise the fields that changed, plus the id.
+    nlohmann::json next(nlohmann::json const& container, bool closed)
+    {
+        auto const id = container["id"].get<std::uintptr_t>();
+        if (closed)
+        {
+            snapshots.erase(id);
+            return { { "id", id } };
+        }
+
+        if (auto it = snapshots.find(id); it != snapshots.end())
+        {
+            auto delta = json_delta(it->second, container);
+            delta["id"] = id;
+            it->second = container;
+            return delta;
+        }
+
+        snapshots.emplace(id, container);
+        return container;
+    }
+
+    /// Drops every baseline, so that the next event about each container carries
+    /// all of its fields. Called when a subscriber joins that has seen none of them.
+    void reset() { snapshots.clear(); }
+
+private:
+    std::unordered_map<std::uintptr_t, nlohmann::json> snapshots;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_JSON_FRAGMENT_H
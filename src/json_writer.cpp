@@ -0,0 +1,251 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "json_writer.h"
+
+#include <cmath>
+
+using namespace miracle;
+
+namespace
+{
+/// Returns the length of the valid UTF-8 sequence at the start of [s], or 0
+/// if it does not start with one.
+size_t utf8_sequence_length(std::string_view s)
+{
+    auto const byte = [&](size_t i)
+    { return static_cast<unsigned char>(s[i]); };
+    auto const is_continuation = [&](size_t i)
+    { return i < s.size() && (byte(i) & 0xc0) == 0x80; };
+
+    auto const lead = byte(0);
+    if (lead < 0x80)
+        return 1;
+    if (lead >= 0xc2 && lead <= 0xdf)
+        return is_continuation(1) ? 2 : 0;
+    if (lead >= 0xe0 && lead <= 0xef)
+    {
+        if (!is_continuation(1) || !is_continuation(2))
+            return 0;
+        // Overlong encodings and surrogates
+        if ((lead == 0xe0 && byte(1) < 0xa0) || (lead == 0xed && byte(1) > 0x9f))
+            return 0;
+        return 3;
+    }
+    if (lead >= 0xf0 && lead <= 0xf4)
+    {
+        if (!is_continuation(1) || !is_continuation(2) || !is_continuation(3))
+            return 0;
+        // Overlong encodings and code points above U+10FFFF
+        if ((lead == 0xf0 && byte(1) < 0x90) || (lead == 0xf4 && byte(1) > 0x8f))
+            return 0;
+        return 4;
+    }
+
+    return 0;
+}
+}
+
+JsonWriter& JsonWriter::begin_object()
+{
+    separate();
+    out += '{';
+    needs_separator = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::end_object()
+{
+    out += '}';
+    needs_separator = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::begin_array()
+{
+    separate();
+    out += '[';
+    needs_separator = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::end_array()
+{
+    out += ']';
+    needs_separator = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(std::string_view key)
+{
+    separate();
+    write_string(key);
+    out += ':';
+    needs_separator = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view value)
+{
+    separate();
+    write_string(value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool value)
+{
+    separate();
+    out += value ? "true" : "false";
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double value)
+{
+    // Like nlohmann::json, which has no representation for them either
+    if (!std::isfinite(value))
+        return null();
+
+    separate();
+    char buffer[32];
+    auto const result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    std::string_view const written(buffer, result.ptr);
+    out += written;
+
+    // Keep the value a float for parsers that tell the two apart
+    if (written.find_first_of(".e") == std::string_view::npos)
+        out += ".0";
+    return *this;
+}
+
+JsonWriter& JsonWriter::null()
+{
+    separate();
+    out += "null";
+    return *this;
+}
+
+JsonWriter& JsonWriter::raw(std::string_view serialized)
+{
+    separate();
+    out += serialized;
+    return *this;
+}
+
+JsonWriter& JsonWriter::fields(std::string_view serialized)
+{
+    if (serialized.empty())
+        return *this;
+
+    separate();
+    out += serialized;
+    return *this;
+}
+
+JsonWriter& JsonWriter::rect(std::string_view key, mir::geometry::Rectangle const& rectangle)
+{
+    this->key(key)
+        .begin_object()
+        .key("x")
+        .value(rectangle.top_left.x.as_int())
+        .key("y")
+        .value(rectangle.top_left.y.as_int())
+        .key("width")
+        .value(rectangle.size.width.as_int())
+        .key("height")
+        .value(rectangle.size.height.as_int())
+        .end_object();
+    return *this;
+}
+
+void JsonWriter::separate()
+{
+    if (needs_separator)
+        out += ',';
+    needs_separator = true;
+}
+
+void JsonWriter::write_string(std::string_view value)
+{
+    static char const hex[] = "0123456789abcdef";
+
+    out += '"';
+    size_t clean_start = 0;
+    size_t i = 0;
+    auto const flush = [&]
+    {
+        out.append(value.data() + clean_start, i - clean_start);
+    };
+
+    while (i < value.size())
+    {
+        auto const c = static_cast<unsigned char>(value[i]);
+        if (c >= 0x20 && c != '"' && c != '\\' && c < 0x80)
+        {
+            i++;
+            continue;
+        }
+
+        if (c >= 0x80)
+        {
+            if (auto const length = utf8_sequence_length(value.substr(i)))
+            {
+                i += length;
+                continue;
+            }
+
+            flush();
+            out += "\xef\xbf\xbd";
+            clean_start = ++i;
+            continue;
+        }
+
+        flush();
+        switch (c)
+        {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\b':
+            out += "\\b";
+            break;
+        case '\f':
+            out += "\\f";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            out += "\\u00";
+            out += hex[c >> 4];
+            out += hex[c & 0xf];
+            break;
+        }
+        clean_start = ++i;
+    }
+
+    flush();
+    out += '"';
+}
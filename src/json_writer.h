@@ -0,0 +1,88 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_JSON_WRITER_H
+#define MIRACLE_WM_JSON_WRITER_H
+
+#include <charconv>
+#include <concepts>
+#include <mir/geometry/rectangle.h>
+#include <string>
+#include <string_view>
+
+namespace miracle
+{
+
+/// Writes JSON straight into a string as it is described, without building a
+/// document first. The writer only places the separators, so it is up to the
+/// caller to open and close objects and arrays in a valid order and to give
+/// every value within an object a [key].
+///
+/// Strings are written as UTF-8, with invalid sequences replaced by U+FFFD.
+class JsonWriter
+{
+public:
+    explicit JsonWriter(std::string& out) :
+        out { out }
+    {
+    }
+
+    JsonWriter& begin_object();
+    JsonWriter& end_object();
+    JsonWriter& begin_array();
+    JsonWriter& end_array();
+    JsonWriter& key(std::string_view key);
+
+    JsonWriter& value(std::string_view value);
+    JsonWriter& value(char const* value) { return this->value(std::string_view(value)); }
+    JsonWriter& value(bool value);
+    JsonWriter& value(double value);
+    JsonWriter& null();
+
+    template <std::integral T>
+    JsonWriter& value(T value)
+    {
+        separate();
+        char buffer[24];
+        auto const result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+        return *this;
+    }
+
+    /// Writes a value that has already been serialized, e.g. by another writer.
+    JsonWriter& raw(std::string_view serialized);
+
+    /// Writes the fields of an object that have already been serialized, without
+    /// their braces. The object must be open.
+    JsonWriter& fields(std::string_view serialized);
+
+    /// Writes [rectangle] under [key] as an i3 rect.
+    JsonWriter& rect(std::string_view key, mir::geometry::Rectangle const& rectangle);
+
+    [[nodiscard]] std::string& buffer() const { return out; }
+
+private:
+    void separate();
+    void write_string(std::string_view value);
+
+    std::string& out;
+    bool needs_separator = false;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_JSON_WRITER_H
@@ -0,0 +1,202 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#define MIR_LOG_COMPONENT "layout_checkpoint"
+
+#include "layout_checkpoint.h"
+#include "config_cache.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <mir/log.h>
+#include <string_view>
+#include <unistd.h>
+
+using namespace miracle;
+
+namespace
+{
+constexpr std::uint32_t magic = 0x434c574d; // "MWLC"
+
+/// Bump this whenever the layout of a checkpoint changes.
+constexpr std::uint32_t version = 1;
+
+/// Deeper trees than this are taken to be corrupt rather than recursed into.
+constexpr int max_depth = 64;
+
+void write_node(ConfigCacheWriter& writer, LayoutCheckpoint::Node const& node)
+{
+    writer.write(node.scheme);
+    writer.write(node.percent);
+    writer.write(node.app_id);
+    writer.write(static_cast<std::uint32_t>(node.nodes.size()));
+    for (auto const& child : node.nodes)
+        write_node(writer, child);
+}
+
+bool read_node(ConfigCacheReader& reader, LayoutCheckpoint::Node& node, int depth)
+{
+    if (depth > max_depth)
+        return false;
+
+    node.scheme = reader.read<LayoutScheme>();
+    node.percent = reader.read<double>();
+    node.app_id = reader.read_string();
+    auto const count = reader.read<std::uint32_t>();
+    for (std::uint32_t i = 0; i < count && reader.ok(); i++)
+    {
+        if (!read_node(reader, node.nodes.emplace_back(), depth + 1))
+            return false;
+    }
+
+    return reader.ok();
+}
+
+std::string escape_regex(std::string const& text)
+{
+    std::string result;
+    for (auto const c : text)
+    {
+        if (std::string_view("\\^$.|?*+()[]{}").find(c) != std::string_view::npos)
+            result += '\\';
+        result += c;
+    }
+    return result;
+}
+}
+
+std::vector<char> miracle::serialize_layout_checkpoint(LayoutCheckpoint const& checkpoint)
+{
+    ConfigCacheWriter writer;
+    writer.write(magic);
+    writer.write(version);
+    writer.write(static_cast<std::uint32_t>(checkpoint.workspaces.size()));
+    for (auto const& workspace : checkpoint.workspaces)
+    {
+        writer.write(workspace.output);
+        writer.write(workspace.num);
+        writer.write(workspace.name.has_value());
+        writer.write(workspace.name.value_or(""));
+        writer.write(workspace.is_active);
+        write_node(writer, workspace.root);
+    }
+
+    auto const data = writer.data();
+    return { data.begin(), data.end() };
+}
+
+std::optional<LayoutCheckpoint> miracle::parse_layout_checkpoint(std::span<char const> data)
+{
+    ConfigCacheReader reader(data);
+    if (reader.read<std::uint32_t>() != magic || reader.read<std::uint32_t>() != version)
+        return std::nullopt;
+
+    LayoutCheckpoint checkpoint;
+    auto const count = reader.read<std::uint32_t>();
+    for (std::uint32_t i = 0; i < count && reader.ok(); i++)
+    {
+        auto& workspace = checkpoint.workspaces.emplace_back();
+        workspace.output = reader.read_string();
+        workspace.num = reader.read<std::optional<int>>();
+        auto const has_name = reader.read<bool>();
+        auto name = reader.read_string();
+        if (has_name)
+            workspace.name = std::move(name);
+        workspace.is_active = reader.read<bool>();
+        if (!read_node(reader, workspace.root, 0))
+            return std::nullopt;
+    }
+
+    if (!reader.ok() || !reader.at_end())
+        return std::nullopt;
+
+    return checkpoint;
+}
+
+LayoutTemplateNode miracle::to_layout_template(LayoutCheckpoint::Node const& node)
+{
+    LayoutTemplateNode result;
+    result.scheme = node.scheme;
+    if (node.percent > 0)
+        result.percent = node.percent;
+
+    if (node.nodes.empty())
+        result.swallows.push_back({ .app_id = std::regex("^" + escape_regex(node.app_id) + "$") });
+
+    for (auto const& child : node.nodes)
+        result.nodes.push_back(to_layout_template(child));
+    return result;
+}
+
+std::filesystem::path miracle::layout_checkpoint_path()
+{
+    // Env var typically set by logind, e.g. "/run/user/<user-id>"
+    char const* dir = getenv("XDG_RUNTIME_DIR");
+    if (!dir)
+        dir = "/tmp";
+
+    return std::filesystem::path(dir) / ("miracle-wm-layout." + std::to_string(getuid()) + ".checkpoint");
+}
+
+bool miracle::write_layout_checkpoint(std::filesystem::path const& path, LayoutCheckpoint const& checkpoint)
+{
+    // Write to a temporary file first so that a crash never leaves a truncated checkpoint behind.
+    auto const data = serialize_layout_checkpoint(checkpoint);
+    auto temporary = path;
+    temporary += ".tmp";
+    std::error_code ec;
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!file)
+        {
+            mir::log_warning("Unable to write the layout checkpoint %s", temporary.c_str());
+            std::filesystem::remove(temporary, ec);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporary, path, ec);
+    if (ec)
+    {
+        mir::log_warning("Unable to write the layout checkpoint %s: %s", path.c_str(), ec.message().c_str());
+        std::filesystem::remove(temporary, ec);
+        return false;
+    }
+
+    return true;
+}
+
+std::optional<LayoutCheckpoint> miracle::take_layout_checkpoint(std::filesystem::path const& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return std::nullopt;
+
+    std::vector<char> const data { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+    file.close();
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+
+    auto checkpoint = parse_layout_checkpoint(data);
+    if (!checkpoint)
+        mir::log_warning("Ignoring the layout checkpoint %s, which is not from this version", path.c_str());
+    return checkpoint;
+}
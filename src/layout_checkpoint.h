@@ -0,0 +1,87 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_LAYOUT_CHECKPOINT_H
+#define MIRACLE_WM_LAYOUT_CHECKPOINT_H
+
+#include "layout_scheme.h"
+#include "layout_template.h"
+
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace miracle
+{
+
+/// The tiled windows of every workspace, saved when the compositor restarts so
+/// that each window is put back in its place once its client returns.
+struct LayoutCheckpoint
+{
+    struct Node
+    {
+        LayoutScheme scheme = LayoutScheme::horizontal;
+
+        /// The fraction of the parent that this node takes up, or 0 if it
+        /// shares the parent evenly with its siblings.
+        double percent = 0;
+
+        /// The app_id of the window of a node without [nodes].
+        std::string app_id;
+        std::vector<Node> nodes;
+
+        bool operator==(Node const&) const = default;
+    };
+
+    struct Workspace
+    {
+        std::string output;
+        std::optional<int> num;
+        std::optional<std::string> name;
+        bool is_active = false;
+        Node root;
+
+        bool operator==(Workspace const&) const = default;
+    };
+
+    std::vector<Workspace> workspaces;
+
+    bool operator==(LayoutCheckpoint const&) const = default;
+};
+
+std::vector<char> serialize_layout_checkpoint(LayoutCheckpoint const& checkpoint);
+
+/// Returns std::nullopt if [data] was not written by this version of
+/// [serialize_layout_checkpoint].
+std::optional<LayoutCheckpoint> parse_layout_checkpoint(std::span<char const> data);
+
+/// A template whose slots each swallow exactly the app_id of the window that was in them.
+LayoutTemplateNode to_layout_template(LayoutCheckpoint::Node const& node);
+
+/// The file in $XDG_RUNTIME_DIR that the checkpoint is kept in across a restart.
+std::filesystem::path layout_checkpoint_path();
+
+bool write_layout_checkpoint(std::filesystem::path const& path, LayoutCheckpoint const& checkpoint);
+
+/// Reads the checkpoint at [path] and removes it, so that it is only ever restored once.
+std::optional<LayoutCheckpoint> take_layout_checkpoint(std::filesystem::path const& path);
+
+} // miracle
+
+#endif // MIRACLE_WM_LAYOUT_CHECKPOINT_H
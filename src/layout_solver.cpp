@@ -0,0 +1,110 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "layout_solver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+using namespace miracle;
+
+std::vector<int> miracle::distribute_space(int total, std::vector<double> const& weights, std::vector<int> const& minimums)
+{
+    auto const count = weights.size();
+    std::vector<int> sizes(count, 0);
+    if (count == 0)
+        return sizes;
+
+    // Items without a usable weight share the space equally
+    std::vector<double> shares(weights);
+    if (std::none_of(shares.begin(), shares.end(), [](double weight) { return weight > 0; }))
+        std::fill(shares.begin(), shares.end(), 1.0);
+    for (auto& share : shares)
+        share = std::max(share, 0.0);
+
+    auto const minimum = [&](size_t i)
+    {
+        return i < minimums.size() ? std::max(minimums[i], 0) : 0;
+    };
+
+    long long minimum_total = 0;
+    for (size_t i = 0; i < count; i++)
+        minimum_total += minimum(i);
+    bool const use_minimums = minimum_total <= total;
+
+    // Pin every item whose share would fall below its minimum to that minimum, then
+    // share what is left between the rest. Pinning an item can only shrink the shares
+    // of the others, so this settles after at most [count] rounds.
+    std::vector<bool> pinned(count, false);
+    std::vector<double> ideal(count, 0);
+    while (true)
+    {
+        double remaining = total;
+        double weight_total = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (pinned[i])
+                remaining -= minimum(i);
+            else
+                weight_total += shares[i];
+        }
+
+        bool changed = false;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (pinned[i])
+            {
+                ideal[i] = minimum(i);
+                continue;
+            }
+
+            ideal[i] = weight_total > 0 ? remaining * shares[i] / weight_total : 0;
+            if (use_minimums && ideal[i] < minimum(i))
+            {
+                pinned[i] = true;
+                changed = true;
+            }
+        }
+
+        if (!changed)
+            break;
+    }
+
+    int assigned = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        sizes[i] = static_cast<int>(std::floor(ideal[i]));
+        assigned += sizes[i];
+    }
+
+    std::vector<size_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+    {
+        return ideal[a] - std::floor(ideal[a]) > ideal[b] - std::floor(ideal[b]);
+    });
+
+    // Whatever is left after flooring is less than one pixel per item
+    for (size_t i = 0; assigned < total; i = (i + 1) % count)
+    {
+        sizes[order[i]]++;
+        assigned++;
+    }
+
+    return sizes;
+}
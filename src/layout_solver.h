@@ -0,0 +1,36 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_LAYOUT_SOLVER_H
+#define MIRACLE_WM_LAYOUT_SOLVER_H
+
+#include <vector>
+
+namespace miracle
+{
+
+/// Splits [total] pixels between items in proportion to their [weights], such
+/// that the sizes add up to exactly [total].
+///
+/// Each item is given at least its entry in [minimums], taking the space from
+/// the others. If the minimums cannot all be met, they are ignored. The pixels
+/// that rounding leaves over go to the items that lost the most to rounding.
+std::vector<int> distribute_space(int total, std::vector<double> const& weights, std::vector<int> const& minimums);
+
+} // miracle
+
+#endif // MIRACLE_WM_LAYOUT_SOLVER_H
@@ -0,0 +1,233 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "layout_template.h"
+#include "layout_solver.h"
+
+#include <algorithm>
+
+using namespace miracle;
+
+namespace geom = mir::geometry;
+
+namespace
+{
+std::optional<LayoutScheme> scheme_from_string(std::string const& layout)
+{
+    if (layout == "splith" || layout == "horizontal")
+        return LayoutScheme::horizontal;
+    if (layout == "splitv" || layout == "vertical")
+        return LayoutScheme::vertical;
+    if (layout == "tabbed")
+        return LayoutScheme::tabbing;
+    if (layout == "stacked")
+        return LayoutScheme::stacking;
+    return std::nullopt;
+}
+
+std::optional<std::string> parse_node(nlohmann::json const& json, LayoutTemplateNode& node)
+{
+    if (!json.is_object())
+        return "every node must be an object";
+
+    if (json.contains("layout"))
+    {
+        if (!json["layout"].is_string())
+            return "'layout' must be a string";
+
+        auto const scheme = scheme_from_string(json["layout"].get<std::string>());
+        if (!scheme)
+            return "unknown layout: " + json["layout"].get<std::string>();
+        node.scheme = scheme.value();
+    }
+
+    if (json.contains("percent") && !json["percent"].is_null())
+    {
+        if (!json["percent"].is_number())
+            return "'percent' must be a number";
+        node.percent = std::clamp(json["percent"].get<double>(), 0.0, 1.0);
+    }
+
+    if (json.contains("nodes"))
+    {
+        if (!json["nodes"].is_array())
+            return "'nodes' must be an array";
+
+        for (auto const& child_json : json["nodes"])
+        {
+            LayoutTemplateNode child;
+            if (auto const error = parse_node(child_json, child))
+                return error;
+            node.nodes.push_back(std::move(child));
+        }
+    }
+
+    if (json.contains("swallows"))
+    {
+        if (!json["swallows"].is_array())
+            return "'swallows' must be an array";
+
+        for (auto const& swallow_json : json["swallows"])
+        {
+            if (!swallow_json.is_object())
+                return "every swallow must be an object";
+
+            // Wayland clients have an app_id where X11 clients have a class
+            LayoutTemplateNode::Swallow swallow;
+            try
+            {
+                for (auto const* key : { "app_id", "class" })
+                {
+                    if (swallow_json.contains(key) && swallow_json[key].is_string())
+                        swallow.app_id = std::regex(swallow_json[key].get<std::string>());
+                }
+                if (swallow_json.contains("title") && swallow_json["title"].is_string())
+                    swallow.title = std::regex(swallow_json["title"].get<std::string>());
+            }
+            catch (std::regex_error const& e)
+            {
+                return std::string("invalid swallow pattern: ") + e.what();
+            }
+
+            node.swallows.push_back(std::move(swallow));
+        }
+    }
+
+    return std::nullopt;
+}
+
+void solve_node(
+    LayoutTemplateNode const& node,
+    std::vector<size_t>& path,
+    geom::Rectangle const& area,
+    geom::Rectangle const& root_area,
+    int half_gap_x,
+    int half_gap_y,
+    LayoutTemplateSolution& solution)
+{
+    if (node.is_slot())
+    {
+        // Sides that touch the edge of the root have no neighbor to share a gap with
+        int left = area.top_left.x.as_int();
+        int top = area.top_left.y.as_int();
+        int right = left + area.size.width.as_int();
+        int bottom = top + area.size.height.as_int();
+        if (left > root_area.top_left.x.as_int())
+            left += half_gap_x;
+        if (top > root_area.top_left.y.as_int())
+            top += half_gap_y;
+        if (right < root_area.top_left.x.as_int() + root_area.size.width.as_int())
+            right -= half_gap_x;
+        if (bottom < root_area.top_left.y.as_int() + root_area.size.height.as_int())
+            bottom -= half_gap_y;
+
+        solution.slots.push_back({
+            &node,
+            path,
+            area,
+            geom::Rectangle { geom::Point { left, top }, geom::Size { right - left, bottom - top } }
+        });
+        return;
+    }
+
+    solution.containers.push_back({ path, area });
+
+    std::vector<geom::Rectangle> areas;
+    if (node.scheme == LayoutScheme::horizontal || node.scheme == LayoutScheme::vertical)
+    {
+        double given = 0;
+        size_t missing = 0;
+        for (auto const& child : node.nodes)
+        {
+            if (child.percent)
+                given += child.percent.value();
+            else
+                missing++;
+        }
+
+        double const share = missing > 0 ? std::max(0.0, 1.0 - given) / static_cast<double>(missing) : 0.0;
+        std::vector<double> weights;
+        for (auto const& child : node.nodes)
+            weights.push_back(child.percent.value_or(share));
+
+        bool const is_horizontal = node.scheme == LayoutScheme::horizontal;
+        auto const sizes = distribute_space(
+            is_horizontal ? area.size.width.as_int() : area.size.height.as_int(), weights, {});
+
+        int position = is_horizontal ? area.top_left.x.as_int() : area.top_left.y.as_int();
+        for (auto const size : sizes)
+        {
+            areas.push_back(is_horizontal
+                    ? geom::Rectangle { geom::Point { position, area.top_left.y.as_int() }, geom::Size { size, area.size.height.as_int() } }
+                    : geom::Rectangle { geom::Point { area.top_left.x.as_int(), position }, geom::Size { area.size.width.as_int(), size } });
+            position += size;
+        }
+    }
+    else
+    {
+        areas.assign(node.nodes.size(), area);
+    }
+
+    for (size_t i = 0; i < node.nodes.size(); i++)
+    {
+        path.push_back(i);
+        solve_node(node.nodes[i], path, areas[i], root_area, half_gap_x, half_gap_y, solution);
+        path.pop_back();
+    }
+}
+}
+
+bool LayoutTemplateNode::matches(std::string const& app_id, std::string const& title) const
+{
+    if (swallows.empty())
+        return true;
+
+    return std::any_of(swallows.begin(), swallows.end(), [&](Swallow const& swallow)
+    {
+        return (!swallow.app_id || std::regex_search(app_id, swallow.app_id.value()))
+            && (!swallow.title || std::regex_search(title, swallow.title.value()));
+    });
+}
+
+std::variant<LayoutTemplateNode, std::string> miracle::parse_layout_template(nlohmann::json const& json)
+{
+    LayoutTemplateNode root;
+    if (json.is_array())
+    {
+        if (auto const error = parse_node(nlohmann::json { { "nodes", json } }, root))
+            return error.value();
+    }
+    else if (auto const error = parse_node(json, root))
+        return error.value();
+
+    if (root.is_slot())
+        return std::string("the template has no nodes");
+
+    return root;
+}
+
+LayoutTemplateSolution miracle::solve_layout_template(
+    LayoutTemplateNode const& root,
+    geom::Rectangle const& area,
+    int half_gap_x,
+    int half_gap_y)
+{
+    LayoutTemplateSolution solution;
+    std::vector<size_t> path;
+    solve_node(root, path, area, area, half_gap_x, half_gap_y, solution);
+    return solution;
+}
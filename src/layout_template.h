@@ -0,0 +1,104 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_LAYOUT_TEMPLATE_H
+#define MIRACLE_WM_LAYOUT_TEMPLATE_H
+
+#include "layout_scheme.h"
+
+#include <cstddef>
+#include <mir/geometry/rectangle.h>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <regex>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace miracle
+{
+
+/// A node of a layout template, read from the JSON of i3's `append_layout`.
+///
+/// A node with [nodes] is a container, and a node without them is a slot that
+/// a window will be placed into once a window that it [swallows] is opened.
+struct LayoutTemplateNode
+{
+    struct Swallow
+    {
+        std::optional<std::regex> app_id;
+        std::optional<std::regex> title;
+    };
+
+    LayoutScheme scheme = LayoutScheme::horizontal;
+
+    /// The fraction of the parent that this node takes up, if it has one. The
+    /// nodes without one share what is left evenly.
+    std::optional<double> percent;
+    std::vector<LayoutTemplateNode> nodes;
+
+    /// A slot matches a window if any of these do. A slot without any matches
+    /// every window.
+    std::vector<Swallow> swallows;
+
+    [[nodiscard]] bool is_slot() const { return nodes.empty(); }
+    [[nodiscard]] bool matches(std::string const& app_id, std::string const& title) const;
+};
+
+/// Reads a template from [json]. An array of nodes is read as the nodes of a
+/// horizontal container. Returns an error message if the template is invalid.
+std::variant<LayoutTemplateNode, std::string> parse_layout_template(nlohmann::json const& json);
+
+/// The exact area of a slot in a template that has been solved for an area.
+struct LayoutTemplateSlot
+{
+    LayoutTemplateNode const* node;
+
+    /// The indices of the nodes from the root of the template to the slot.
+    std::vector<size_t> path;
+    mir::geometry::Rectangle logical_area;
+
+    /// The area of the window, which is inset by half of the gaps on the
+    /// sides that it shares with another window.
+    mir::geometry::Rectangle visible_area;
+};
+
+/// The exact area of every node of a template, containers included, from the
+/// root down, so that containers come before their nodes.
+struct LayoutTemplateSolution
+{
+    struct Area
+    {
+        std::vector<size_t> path;
+        mir::geometry::Rectangle logical_area;
+    };
+
+    std::vector<Area> containers;
+    std::vector<LayoutTemplateSlot> slots;
+};
+
+/// Divides [area] between the nodes of [root] in the same way that the tree
+/// would once every slot is filled.
+LayoutTemplateSolution solve_layout_template(
+    LayoutTemplateNode const& root,
+    mir::geometry::Rectangle const& area,
+    int half_gap_x,
+    int half_gap_y);
+
+} // miracle
+
+#endif // MIRACLE_WM_LAYOUT_TEMPLATE_H
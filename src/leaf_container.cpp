@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "output_interface.h"
 #include "output_manager.h"
 #include "parent_container.h"
+#include "tracing.h"
 #include "window_helpers.h"
 #include "workspace_interface.h"
 
@@ -175,6 +176,7 @@ void LeafContainer::set_parent(std::shared_ptr<ParentContainer> const& in_parent
     miral::WindowSpecification spec;
     spec.depth_layer() = !in_parent->anchored() ? mir_depth_layer_above : mir_depth_layer_application;
     window_controller->modify(window_, spec);
+    window_controller->set_occluded(window_, is_hidden_tab());
 }
 
 void LeafContainer::set_state(MirWindowState state)
@@ -184,9 +186,9 @@ void LeafContainer::set_state(MirWindowState state)
 
 geom::Rectangle LeafContainer::get_visible_area() const
 {
-    // TODO: Could cache these half values in the config
-    int const half_gap_x = (int)(ceil((double)config->get_inner_gaps_x() / 2.0));
-    int const half_gap_y = (int)(ceil((double)config->get_inner_gaps_y() / 2.0));
+    auto const snapshot = config->snapshot();
+    int const half_gap_x = snapshot->half_inner_gaps_x;
+    int const half_gap_y = snapshot->half_inner_gaps_y;
     auto neighbors = get_neighbors();
     int x = logical_area.top_left.x.as_int();
     int y = logical_area.top_left.y.as_int();
@@ -211,7 +213,7 @@ geom::Rectangle LeafContainer::get_visible_area() const
         height -= half_gap_y;
     }
 
-    int const border_size = config->get_border_config().size;
+    int const border_size = snapshot->border_config.size;
     x += border_size;
     width -= 2 * border_size;
     y += border_size;
@@ -502,11 +504,16 @@ bool LeafContainer::is_fullscreen() const
 
 void LeafContainer::commit_changes()
 {
+    MIRACLE_TRACE_SCOPE("LeafContainer::commit_changes");
+
+    // The state, depth layer and geometry reach the client as one modification
+    WindowChangeBatch changes(*window_controller, window_);
     if (next_state)
     {
         window_controller->change_state(window_, next_state.value());
         constrain();
         next_state.reset();
+        state->render_data_manager()->fullscreen_change(*this);
     }
 
     if (next_depth_layer)
@@ -519,9 +526,14 @@ void LeafContainer::commit_changes()
 
     if (next_logical_area)
     {
+        // Within a batch, only the last area that the container is given is applied.
+        if (state->defer_commit(shared_from_this()))
+            return;
+
         auto previous = get_visible_area();
         logical_area = next_logical_area.value();
         next_logical_area.reset();
+        state->layout_changed();
         if (!window_controller->is_fullscreen(window_))
         {
             auto next_visible_area = get_visible_area();
@@ -582,6 +594,7 @@ WorkspaceInterface* LeafContainer::get_workspace() const
 void LeafContainer::set_workspace(miracle::WorkspaceInterface* in)
 {
     workspace = in;
+    state->render_data_manager()->workspace_change(*this);
 }
 
 OutputInterface* LeafContainer::get_output() const
@@ -636,7 +649,7 @@ ContainerType LeafContainer::get_type() const
 
 bool LeafContainer::select_next(miracle::Direction direction)
 {
-    auto next = handle_select(*this, direction);
+    auto next = workspace->neighbour(*this, direction);
     if (!next)
     {
         mir::log_warning("Unable to select the next window: handle_select failed");
@@ -873,11 +886,10 @@ LayoutScheme LeafContainer::get_layout() const
     return LayoutScheme::none;
 }
 
-nlohmann::json LeafContainer::to_json(bool is_workspace_visible) const
+LeafContainer::JsonKey LeafContainer::json_key(bool is_workspace_visible) const
 {
     auto const app = window_.application();
     auto const& win_info = window_controller->info_for(window_);
-    auto visible_area = get_visible_area();
     auto locked_parent = parent.lock();
     bool visible = true;
 
@@ -886,63 +898,101 @@ nlohmann::json LeafContainer::to_json(bool is_workspace_visible) const
 
     if (locked_parent == nullptr)
         visible = false;
-
-    if (locked_parent->get_scheme() == LayoutScheme::stacking || locked_parent->get_scheme() == LayoutScheme::tabbing)
+    else if (locked_parent->get_scheme() == LayoutScheme::stacking || locked_parent->get_scheme() == LayoutScheme::tabbing)
         if (!is_focused())
             visible = false;
 
-    nlohmann::json properties = nlohmann::json::object();
     return {
-        { "id",                   reinterpret_cast<std::uintptr_t>(this)                                                                                                                                                                                                                                   },
-        { "name",                 app->name()                                                                                                                                                                                                                                                              },
-        { "rect",                 {
-                      { "x", logical_area.top_left.x.as_int() },
-                      { "y", logical_area.top_left.y.as_int() },
-                      { "width", logical_area.size.width.as_int() },
-                      { "height", logical_area.size.height.as_int() },
-                  }                                                                                                                                                                                                                                                                       },
-        { "focused",              visible && is_focused()                                                                                                                                                                                                                                                  },
-        { "focus",                std::vector<int>()                                                                                                                                                                                                                                                       },
-        { "border",               "normal"                                                                                                                                                                                                                                                                 },
-        { "current_border_width", config->get_border_config().size                                                                                                                                                                                                                                         },
-        { "layout",               "none"                                                                                                                                                                                                                                                                   },
-        { "orientation",          "none"                                                                                                                                                                                                                                                                   },
-        { "percent",              get_percent_of_parent()                                                                                                                                                                                                                                                  },
-        { "window_rect",          {
-                                                                                                                                                                                                                                                                                     { "x", visible_area.top_left.x.as_int() },
-                                                                                                                                                                                                                                                                                     { "y", visible_area.top_left.y.as_int() },
-                                                                                                                                                                                                                                                                                     { "width", visible_area.size.width.as_int() },
-                                                                                                                                                                                                                                                                                     { "height", visible_area.size.height.as_int() },
-                                                                                                                                                                                                                                                                                 } },
-        { "deco_rect",            {
-                           { "x", 0 },
-                           { "y", 0 },
-                           { "width", logical_area.size.width.as_int() },
-                           { "height", logical_area.size.height.as_int() },
-                       }                                                                                                                                                                                                                                                             },
-        { "geometry",             {
-                          { "x", 0 },
-                          { "y", 0 },
-                          { "width", logical_area.size.width.as_int() },
-                          { "height", logical_area.size.height.as_int() },
-                      }                                                                                                                                                                                                                                                               },
-        { "window",               0                                                                                                                                                                                                                                                                        }, // TODO
-        { "urgent",               false                                                                                                                                                                                                                                                                    },
-        { "floating_nodes",       std::vector<int>()                                                                                                                                                                                                                                                       },
-        { "sticky",               false                                                                                                                                                                                                                                                                    },
-        { "type",                 "con"                                                                                                                                                                                                                                                                    },
-        { "fullscreen_mode",      is_fullscreen() ? 1 : 0                                                                                                                                                                                                                                                  }, // TODO: Support value 2
-        { "pid",                  app->process_id()                                                                                                                                                                                                                                                        },
-        { "app_id",               win_info.application_id()                                                                                                                                                                                                                                                },
-        { "visible",              visible                                                                                                                                                                                                                                                                  },
-        { "shell",                "miracle-wm"                                                                                                                                                                                                                                                             }, // TODO
-        { "inhibit_idle",         false                                                                                                                                                                                                                                                                    },
-        { "idle_inhibitors",      {
-                                                            { "application", "none" },
-                                                            { "user", "visible" },
-                                                        }                                                                                                                                                                                                                      },
-        { "window_properties",    properties                                                                                                                                                                                                                                                               }, // TODO
-        { "nodes",                std::vector<int>()                                                                                                                                                                                                                                                       },
-        { "scratchpad_state",     scratchpad_state_to_string(scratchpad_state())                                                                                                                                                                                                                           }
+        .name = app->name(),
+        .app_id = win_info.application_id(),
+        .pid = app->process_id(),
+        .logical_area = logical_area,
+        .visible_area = get_visible_area(),
+        .visible = visible,
+        .focused = visible && is_focused(),
+        .fullscreen = is_fullscreen(),
+        .percent = get_percent_of_parent(),
+        .border_width = config->snapshot()->border_config.size,
+        .scratchpad_state = scratchpad_state()
     };
 }
+
+void LeafContainer::write_json(JsonWriter& writer, bool is_workspace_visible) const
+{
+    writer.raw(json_cache.get(json_key(is_workspace_visible), [this](JsonKey const& key)
+    {
+        std::string serialized;
+        JsonWriter key_writer(serialized);
+        write_key(key_writer, key);
+        return serialized;
+    }));
+}
+
+void LeafContainer::write_key(JsonWriter& writer, JsonKey const& key) const
+{
+    auto const& logical_area = key.logical_area;
+    geom::Rectangle const local_area { geom::Point { 0, 0 }, logical_area.size };
+    writer.begin_object()
+        .key("id")
+        .value(reinterpret_cast<std::uintptr_t>(this))
+        .key("name")
+        .value(key.name)
+        .rect("rect", logical_area)
+        .key("focused")
+        .value(key.focused)
+        .key("focus")
+        .begin_array()
+        .end_array()
+        .key("border")
+        .value("normal")
+        .key("current_border_width")
+        .value(key.border_width)
+        .key("layout")
+        .value("none")
+        .key("orientation")
+        .value("none")
+        .key("percent")
+        .value(key.percent)
+        .rect("window_rect", key.visible_area)
+        .rect("deco_rect", local_area)
+        .rect("geometry", local_area)
+        .key("window")
+        .value(0) // TODO
+        .key("urgent")
+        .value(false)
+        .key("floating_nodes")
+        .begin_array()
+        .end_array()
+        .key("sticky")
+        .value(false)
+        .key("type")
+        .value("con")
+        .key("fullscreen_mode")
+        .value(key.fullscreen ? 1 : 0) // TODO: Support value 2
+        .key("pid")
+        .value(key.pid)
+        .key("app_id")
+        .value(key.app_id)
+        .key("visible")
+        .value(key.visible)
+        .key("shell")
+        .value("miracle-wm") // TODO
+        .key("inhibit_idle")
+        .value(false)
+        .key("idle_inhibitors")
+        .begin_object()
+        .key("application")
+        .value("none")
+        .key("user")
+        .value("visible")
+        .end_object()
+        .key("window_properties")
+        .begin_object()
+        .end_object() // TODO
+        .key("nodes")
+        .begin_array()
+        .end_array()
+        .key("scratchpad_state")
+        .value(scratchpad_state_to_string(key.scratchpad_state))
+        .end_object();
+}
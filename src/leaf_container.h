@@ -19,7 +19,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIRACLEWM_LEAF_NODE_H
 
 #include "container.h"
+#include "json_fragment.h"
 #include "layout_scheme.h"
+#include "memory_accounting.h"
 #include "scratchpad_state.h"
 #include "window_controller.h"
 
@@ -109,13 +111,31 @@ public:
     ScratchpadState scratchpad_state() const override;
     void scratchpad_state(ScratchpadState) override;
     LayoutScheme get_layout() const override;
-    nlohmann::json to_json(bool is_workspace_visible) const override;
+    void write_json(JsonWriter& writer, bool is_workspace_visible) const override;
 
     static std::shared_ptr<LeafContainer> handle_select(
         Container& from,
         Direction direction);
 
 private:
+    /// Everything that the JSON of the container is built from.
+    struct JsonKey
+    {
+        std::string name;
+        std::string app_id;
+        pid_t pid;
+        geom::Rectangle logical_area;
+        geom::Rectangle visible_area;
+        bool visible;
+        bool focused;
+        bool fullscreen;
+        float percent;
+        int border_width;
+        ScratchpadState scratchpad_state;
+
+        bool operator==(JsonKey const&) const = default;
+    };
+
     WorkspaceInterface* workspace;
     std::shared_ptr<WindowController> window_controller;
     geom::Rectangle logical_area;
@@ -134,6 +154,11 @@ private:
     bool is_dragging_ = false;
     geom::Point dragged_position;
 
+    mutable JsonFragmentCache<JsonKey> json_cache;
+    MemoryCharge memory { MemorySubsystem::containers, sizeof(LeafContainer) };
+
+    [[nodiscard]] JsonKey json_key(bool is_workspace_visible) const;
+    void write_key(JsonWriter& writer, JsonKey const& key) const;
     static void handle_resize(Container* container, Direction direction, int amount);
     static void handle_layout_scheme(Container* container, LayoutScheme scheme);
 };
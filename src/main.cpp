@@ -19,16 +19,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "compositor_state.h"
 #include "config.h"
+#include "debug_log.h"
+#include "event_recording.h"
 #include "miracle_gl_config.h"
 #include "policy.h"
 #include "render_data_manager.h"
 #include "renderer.h"
+#include "spawner.h"
+#include "startup_profile.h"
 #include "version.h"
 
+#include <cerrno>
+#include <cstring>
 #include <mir/log.h>
+#include <mir/options/option.h>
 #include <mir/renderer/gl/gl_surface.h>
 #include <mir/server.h>
-#include <miral/append_event_filter.h>
 #include <miral/custom_renderer.h>
 #include <miral/display_configuration_option.h>
 #include <miral/external_client.h>
@@ -38,6 +44,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <miral/window_management_options.h>
 #include <miral/x11_support.h>
 #include <miroil/open_gl_context.h>
+#include <unistd.h>
 
 #define PRINT_OPENING_MESSAGE(x) mir::log_info("Welcome to miracle-wm v%s", x);
 
@@ -62,12 +69,21 @@ private:
 
 int main(int argc, char const* argv[])
 {
+    // Startup is timed from here
+    auto& startup_profile = miracle::StartupProfile::instance();
+
+    // The spawner is forked before anything else, while the process is small
+    // and has a single thread
+    std::shared_ptr<miracle::Spawner> spawner = miracle::Spawner::start();
+    startup_profile.mark("spawner started");
+
     PRINT_OPENING_MESSAGE(MIRACLE_VERSION_STRING);
     MirRunner runner { argc, argv };
     auto compositor_state = std::make_shared<miracle::CompositorState>();
 
     ExternalClientLauncher external_client_launcher;
     auto config = std::make_shared<miracle::FilesystemConfiguration>(runner);
+    runner.add_start_callback([&startup_profile] { startup_profile.mark("server started"); });
     for (auto const& env : config->get_env_variables())
     {
         setenv(env.key.c_str(), env.value.c_str(), 1);
@@ -78,15 +94,46 @@ int main(int argc, char const* argv[])
         [&](mir::Server& server)
     {
         config->load(server);
+
+        char const* record_events_option = "record-events";
+        server.add_configuration_option(
+            record_events_option,
+            "If specified, the window management events of the session are recorded to this "
+            "file so that they can be replayed with miracle-wm-replay",
+            "");
+        char const* debug_log_option = "debug-log";
+        server.add_configuration_option(
+            debug_log_option,
+            "A comma separated list of the categories of debug log to print: ipc, state, "
+            "render, input, layout, config or all",
+            "");
+        server.add_init_callback([record_events_option, debug_log_option, &server]
+        {
+            auto const server_opts = server.get_options();
+            auto const path = server_opts->get<std::string>(record_events_option);
+            if (!path.empty())
+                miracle::EventRecorder::instance().start(path);
+
+            auto const categories = server_opts->get<std::string>(debug_log_option);
+            if (auto const mask = miracle::DebugLog::parse(categories))
+                miracle::DebugLog::enable(mask.value());
+            else
+                mir::log_warning("Ignoring unknown debug log categories: %s", categories.c_str());
+        });
+
         options = new WindowManagerOptions {
             add_window_manager_policy<miracle::Policy>(
-                "tiling", server, runner, external_client_launcher, config, compositor_state)
+                "tiling", server, runner, external_client_launcher, config, compositor_state, spawner)
         };
         (*options)(server);
     });
 
     Keymap config_keymap;
 
+    // Screencopy is served by Mir, which renders each captured frame on its own and
+    // copies it into the buffer that the client provides. The frames do not come
+    // from the renderers of the outputs, so they cannot be handed out as dmabufs or
+    // limited to the damage of the output from here.
     WaylandExtensions wayland_extensions = WaylandExtensions {}
                                                .enable(miral::WaylandExtensions::zwlr_layer_shell_v1)
                                                .enable(miral::WaylandExtensions::zwlr_foreign_toplevel_manager_v1)
@@ -97,24 +144,39 @@ int main(int argc, char const* argv[])
                                                .enable(miral::WaylandExtensions::zwlr_screencopy_manager_v1)
                                                .enable(miral::WaylandExtensions::ext_session_lock_manager_v1);
 
-    for (auto const& extension : { "zwp_pointer_constraints_v1", "zwp_relative_pointer_manager_v1" })
-        wayland_extensions.enable(extension);
+    // Fractional scaling lets clients draw at the exact resolution of the output,
+    // rather than at the next integer scale to be scaled down by the renderer. It is
+    // only offered by newer versions of Mir.
+    auto const supported_extensions = WaylandExtensions::supported();
+    for (auto const& extension : {
+             "zwp_pointer_constraints_v1",
+             "zwp_relative_pointer_manager_v1",
+             "wp_fractional_scale_manager_v1",
+             "wp_viewporter" })
+    {
+        if (supported_extensions.contains(extension))
+            wayland_extensions.enable(extension);
+    }
 
-    return runner.run_with(
+    auto const result = runner.run_with(
         { window_managers,
             wayland_extensions,
             X11Support {}.default_to_enabled(),
             config_keymap,
             external_client_launcher,
             display_configuration_options,
-            AppendEventFilter([&config](MirEvent const*)
-    {
-        config->try_process_change();
-        return false;
-    }),
             CustomRenderer([&](std::unique_ptr<mir::graphics::gl::OutputSurface> surface, std::shared_ptr<mir::graphics::GLRenderingProvider> rendering_provider)
     {
         return std::make_unique<miracle::Renderer>(std::move(rendering_provider), std::move(surface), config, compositor_state);
     }),
             miroil::OpenGLContext(new miracle::GLConfig()) });
+
+    // The layout was saved before the server stopped, and is restored by the new process
+    if (compositor_state->is_restart_requested())
+    {
+        execv("/proc/self/exe", const_cast<char* const*>(argv));
+        mir::log_error("Unable to restart: %s", strerror(errno));
+    }
+
+    return result;
 }
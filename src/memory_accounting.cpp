@@ -0,0 +1,150 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "memory_accounting.h"
+
+using namespace miracle;
+
+char const* miracle::memory_subsystem_name(MemorySubsystem subsystem)
+{
+    switch (subsystem)
+    {
+    case MemorySubsystem::ipc_clients:
+        return "ipc_clients";
+    case MemorySubsystem::render_data:
+        return "render_data";
+    case MemorySubsystem::animations:
+        return "animations";
+    case MemorySubsystem::containers:
+        return "containers";
+    case MemorySubsystem::json_caches:
+        return "json_caches";
+    default:
+        return "unknown";
+    }
+}
+
+MemoryAccounting& MemoryAccounting::instance()
+{
+    static MemoryAccounting accounting;
+    return accounting;
+}
+
+void MemoryAccounting::add(MemorySubsystem subsystem, int64_t bytes, int64_t objects)
+{
+    auto& entry = counts[static_cast<size_t>(subsystem)];
+    entry.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    entry.objects.fetch_add(objects, std::memory_order_relaxed);
+}
+
+MemoryUsage MemoryAccounting::usage(MemorySubsystem subsystem) const
+{
+    auto const& entry = counts[static_cast<size_t>(subsystem)];
+    return {
+        .bytes = entry.bytes.load(std::memory_order_relaxed),
+        .objects = entry.objects.load(std::memory_order_relaxed)
+    };
+}
+
+nlohmann::json MemoryAccounting::to_json() const
+{
+    nlohmann::json j = nlohmann::json::object();
+    int64_t total = 0;
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        auto const subsystem = static_cast<MemorySubsystem>(i);
+        auto const current = usage(subsystem);
+        total += current.bytes;
+        j[memory_subsystem_name(subsystem)] = {
+            { "bytes", current.bytes },
+            { "objects", current.objects }
+        };
+    }
+
+    j["total_bytes"] = total;
+    return j;
+}
+
+MemoryCharge::MemoryCharge(MemorySubsystem subsystem, size_t bytes) :
+    subsystem { subsystem },
+    bytes_ { bytes }
+{
+    MemoryAccounting::instance().add(subsystem, static_cast<int64_t>(bytes), 1);
+}
+
+MemoryCharge::MemoryCharge(MemoryCharge const& other) :
+    MemoryCharge(other.subsystem, other.bytes_)
+{
+}
+
+MemoryCharge::MemoryCharge(MemoryCharge&& other) noexcept :
+    subsystem { other.subsystem },
+    bytes_ { other.bytes_ },
+    charged { other.charged }
+{
+    other.charged = false;
+    other.bytes_ = 0;
+}
+
+MemoryCharge& MemoryCharge::operator=(MemoryCharge const& other)
+{
+    if (this != &other)
+    {
+        release();
+        subsystem = other.subsystem;
+        bytes_ = other.bytes_;
+        charged = true;
+        MemoryAccounting::instance().add(subsystem, static_cast<int64_t>(bytes_), 1);
+    }
+
+    return *this;
+}
+
+MemoryCharge& MemoryCharge::operator=(MemoryCharge&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        subsystem = other.subsystem;
+        bytes_ = other.bytes_;
+        charged = other.charged;
+        other.charged = false;
+        other.bytes_ = 0;
+    }
+
+    return *this;
+}
+
+MemoryCharge::~MemoryCharge()
+{
+    release();
+}
+
+void MemoryCharge::resize(size_t bytes)
+{
+    if (charged)
+        MemoryAccounting::instance().add(
+            subsystem, static_cast<int64_t>(bytes) - static_cast<int64_t>(bytes_), 0);
+    bytes_ = bytes;
+}
+
+void MemoryCharge::release()
+{
+    if (charged)
+        MemoryAccounting::instance().add(subsystem, -static_cast<int64_t>(bytes_), -1);
+    charged = false;
+}
@@ -0,0 +1,104 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_MEMORY_ACCOUNTING_H
+#define MIRACLE_WM_MEMORY_ACCOUNTING_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+
+namespace miracle
+{
+
+/// The parts of the compositor whose memory is accounted for.
+enum class MemorySubsystem
+{
+    /// The read buffers and write queues of IPC clients.
+    ipc_clients,
+    /// The render data of the window manager and the snapshots held by renderers.
+    render_data,
+    animations,
+    containers,
+    /// The serialized JSON that is kept for containers that have not changed.
+    json_caches,
+    max
+};
+
+char const* memory_subsystem_name(MemorySubsystem subsystem);
+
+struct MemoryUsage
+{
+    int64_t bytes = 0;
+    int64_t objects = 0;
+};
+
+/// Counts the bytes and objects that each [MemorySubsystem] holds. The counts
+/// are approximate: they cover the objects and the buffers that they own, not
+/// the overhead of the heap.
+///
+/// Any thread may record and read the counts.
+class MemoryAccounting
+{
+public:
+    static MemoryAccounting& instance();
+
+    void add(MemorySubsystem subsystem, int64_t bytes, int64_t objects);
+    [[nodiscard]] MemoryUsage usage(MemorySubsystem subsystem) const;
+    [[nodiscard]] nlohmann::json to_json() const;
+
+private:
+    struct Counts
+    {
+        std::atomic<int64_t> bytes = 0;
+        std::atomic<int64_t> objects = 0;
+    };
+
+    std::array<Counts, static_cast<size_t>(MemorySubsystem::max)> counts;
+};
+
+/// Counts an object and the [bytes] that it holds toward a subsystem for as long
+/// as the charge is alive. Make it a member of the object that is accounted for.
+///
+/// Copying the charge counts the copy, as copying the object copies its memory.
+class MemoryCharge
+{
+public:
+    explicit MemoryCharge(MemorySubsystem subsystem, size_t bytes = 0);
+    MemoryCharge(MemoryCharge const& other);
+    MemoryCharge(MemoryCharge&& other) noexcept;
+    MemoryCharge& operator=(MemoryCharge const& other);
+    MemoryCharge& operator=(MemoryCharge&& other) noexcept;
+    ~MemoryCharge();
+
+    /// Changes the number of bytes that the object holds to [bytes].
+    void resize(size_t bytes);
+    [[nodiscard]] size_t bytes() const { return bytes_; }
+
+private:
+    void release();
+
+    MemorySubsystem subsystem;
+    size_t bytes_;
+    bool charged = true;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_MEMORY_ACCOUNTING_H
@@ -0,0 +1,279 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "metrics.h"
+
+#include <format>
+
+using namespace miracle;
+
+namespace
+{
+std::atomic<uint64_t> next_metrics_id = 1;
+
+/// The shard of the calling thread, for the registry with the id [metrics].
+struct ThreadShard
+{
+    uint64_t metrics = 0;
+    MetricsShard* shard = nullptr;
+};
+
+thread_local ThreadShard thread_shard;
+
+/// Only the owning thread writes, so the increment needs no read-modify-write.
+template <typename T>
+inline void add(std::atomic<T>& value, T by)
+{
+    value.store(value.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+}
+
+char const* metric_help(MetricCounter counter)
+{
+    switch (counter)
+    {
+    case MetricCounter::frames:
+        return "Frames rendered across all outputs";
+    case MetricCounter::renderables_drawn:
+        return "Renderables drawn across all frames";
+    case MetricCounter::relayouts:
+        return "Containers laid out again";
+    case MetricCounter::ipc_messages:
+        return "IPC requests received";
+    case MetricCounter::animations:
+        return "Animations started";
+    case MetricCounter::config_reloads:
+        return "Times the configuration was loaded";
+    case MetricCounter::input_events:
+        return "Keyboard and pointer events handled";
+    case MetricCounter::texture_upload_bytes:
+        return "Bytes of shm buffers uploaded to textures";
+    case MetricCounter::lock_contentions:
+        return "Times the window manager lock was held by another thread when it was taken";
+    default:
+        return "";
+    }
+}
+
+char const* metric_help(MetricHistogram histogram)
+{
+    switch (histogram)
+    {
+    case MetricHistogram::frame_time:
+        return "CPU time spent rendering a frame";
+    case MetricHistogram::relayout_time:
+        return "Time spent laying out a container";
+    case MetricHistogram::ipc_request_time:
+        return "Time spent handling an IPC request on the IPC thread";
+    case MetricHistogram::input_time:
+        return "Time spent handling an input event";
+    case MetricHistogram::input_latency:
+        return "Time from the arrival of an input event to the commit of the first frame that shows it";
+    case MetricHistogram::lock_wait:
+        return "Time spent waiting for the window manager lock while another thread held it";
+    default:
+        return "";
+    }
+}
+
+double to_seconds(std::chrono::nanoseconds duration)
+{
+    return std::chrono::duration<double>(duration).count();
+}
+}
+
+char const* miracle::metric_name(MetricCounter counter)
+{
+    switch (counter)
+    {
+    case MetricCounter::frames:
+        return "miracle_frames_total";
+    case MetricCounter::renderables_drawn:
+        return "miracle_renderables_drawn_total";
+    case MetricCounter::relayouts:
+        return "miracle_relayouts_total";
+    case MetricCounter::ipc_messages:
+        return "miracle_ipc_messages_total";
+    case MetricCounter::animations:
+        return "miracle_animations_total";
+    case MetricCounter::config_reloads:
+        return "miracle_config_reloads_total";
+    case MetricCounter::input_events:
+        return "miracle_input_events_total";
+    case MetricCounter::texture_upload_bytes:
+        return "miracle_texture_upload_bytes_total";
+    case MetricCounter::lock_contentions:
+        return "miracle_lock_contentions_total";
+    default:
+        return "miracle_unknown_total";
+    }
+}
+
+char const* miracle::metric_name(MetricHistogram histogram)
+{
+    switch (histogram)
+    {
+    case MetricHistogram::frame_time:
+        return "miracle_frame_seconds";
+    case MetricHistogram::relayout_time:
+        return "miracle_relayout_seconds";
+    case MetricHistogram::ipc_request_time:
+        return "miracle_ipc_request_seconds";
+    case MetricHistogram::input_time:
+        return "miracle_input_seconds";
+    case MetricHistogram::input_latency:
+        return "miracle_input_latency_seconds";
+    case MetricHistogram::lock_wait:
+        return "miracle_lock_wait_seconds";
+    default:
+        return "miracle_unknown_seconds";
+    }
+}
+
+void MetricsShard::increment(MetricCounter counter, uint64_t by)
+{
+    add(counters[static_cast<size_t>(counter)], by);
+}
+
+void MetricsShard::observe(MetricHistogram histogram, std::chrono::nanoseconds duration)
+{
+    auto& h = histograms[static_cast<size_t>(histogram)];
+    auto const bucket = std::ranges::lower_bound(metric_histogram_bounds, duration);
+    if (bucket != metric_histogram_bounds.end())
+        add(h.buckets[static_cast<size_t>(bucket - metric_histogram_bounds.begin())], uint64_t { 1 });
+    add(h.count, uint64_t { 1 });
+    add(h.sum_ns, static_cast<int64_t>(duration.count()));
+}
+
+void MetricsShard::add_to(MetricsSnapshot& snapshot) const
+{
+    for (size_t i = 0; i < counters.size(); i++)
+        snapshot.counters[i] += counters[i].load(std::memory_order_relaxed);
+
+    for (size_t i = 0; i < histograms.size(); i++)
+    {
+        auto& out = snapshot.histograms[i];
+        auto const& h = histograms[i];
+        for (size_t j = 0; j < h.buckets.size(); j++)
+            out.buckets[j] += h.buckets[j].load(std::memory_order_relaxed);
+        out.count += h.count.load(std::memory_order_relaxed);
+        out.sum += std::chrono::nanoseconds(h.sum_ns.load(std::memory_order_relaxed));
+    }
+}
+
+Metrics::Metrics() :
+    id { next_metrics_id++ }
+{
+}
+
+Metrics& Metrics::instance()
+{
+    static Metrics metrics;
+    return metrics;
+}
+
+void Metrics::increment(MetricCounter counter, uint64_t by)
+{
+    shard_for_current_thread().increment(counter, by);
+}
+
+void Metrics::observe(MetricHistogram histogram, std::chrono::nanoseconds duration)
+{
+    shard_for_current_thread().observe(histogram, duration);
+}
+
+MetricsShard& Metrics::shard_for_current_thread()
+{
+    if (thread_shard.metrics == id)
+        return *thread_shard.shard;
+
+    // Shards outlive their threads, so that nothing that was counted is lost
+    std::lock_guard lock(shards_mutex);
+    shards.push_back(std::make_unique<MetricsShard>());
+    thread_shard = { id, shards.back().get() };
+    return *thread_shard.shard;
+}
+
+MetricsSnapshot Metrics::snapshot() const
+{
+    MetricsSnapshot result;
+    std::lock_guard lock(shards_mutex);
+    for (auto const& shard : shards)
+        shard->add_to(result);
+    return result;
+}
+
+nlohmann::json Metrics::to_json() const
+{
+    auto const values = snapshot();
+    nlohmann::json counters = nlohmann::json::object();
+    for (size_t i = 0; i < values.counters.size(); i++)
+        counters[metric_name(static_cast<MetricCounter>(i))] = values.counters[i];
+
+    nlohmann::json bounds = nlohmann::json::array();
+    for (auto const bound : metric_histogram_bounds)
+        bounds.push_back(bound.count());
+
+    nlohmann::json histograms = nlohmann::json::object();
+    for (size_t i = 0; i < values.histograms.size(); i++)
+    {
+        auto const& h = values.histograms[i];
+        histograms[metric_name(static_cast<MetricHistogram>(i))] = {
+            { "count",   h.count                                              },
+            { "sum_us",  std::chrono::duration<double, std::micro>(h.sum).count() },
+            { "buckets", h.buckets                                            }
+        };
+    }
+
+    return {
+        { "counters",        counters   },
+        { "histograms",      histograms },
+        { "bucket_bounds_us", bounds    }
+    };
+}
+
+std::string Metrics::to_prometheus() const
+{
+    auto const values = snapshot();
+    std::string out;
+    for (size_t i = 0; i < values.counters.size(); i++)
+    {
+        auto const counter = static_cast<MetricCounter>(i);
+        auto const name = metric_name(counter);
+        out += std::format("# HELP {} {}\n# TYPE {} counter\n{} {}\n",
+            name, metric_help(counter), name, name, values.counters[i]);
+    }
+
+    for (size_t i = 0; i < values.histograms.size(); i++)
+    {
+        auto const histogram = static_cast<MetricHistogram>(i);
+        auto const name = metric_name(histogram);
+        auto const& h = values.histograms[i];
+        out += std::format("# HELP {} {}\n# TYPE {} histogram\n", name, metric_help(histogram), name);
+
+        // Prometheus buckets are cumulative
+        uint64_t cumulative = 0;
+        for (size_t j = 0; j < h.buckets.size(); j++)
+        {
+            cumulative += h.buckets[j];
+            out += std::format("{}_bucket{{le=\"{}\"}} {}\n", name, to_seconds(metric_histogram_bounds[j]), cumulative);
+        }
+        out += std::format("{}_bucket{{le=\"+Inf\"}} {}\n", name, h.count);
+        out += std::format("{}_sum {}\n{}_count {}\n", name, to_seconds(h.sum), name, h.count);
+    }
+
+    return out;
+}
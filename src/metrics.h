@@ -0,0 +1,179 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_METRICS_H
+#define MIRACLE_WM_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+namespace miracle
+{
+
+enum class MetricCounter
+{
+    frames,
+    renderables_drawn,
+    relayouts,
+    ipc_messages,
+    animations,
+    config_reloads,
+    input_events,
+    texture_upload_bytes,
+    lock_contentions,
+    max
+};
+
+enum class MetricHistogram
+{
+    frame_time,
+    relayout_time,
+    ipc_request_time,
+    input_time,
+    input_latency,
+    lock_wait,
+    max
+};
+
+/// The upper bounds of the buckets of every histogram. Observations above the
+/// last bound only count toward the total.
+constexpr std::array<std::chrono::microseconds, 12> metric_histogram_bounds {
+    std::chrono::microseconds(10),
+    std::chrono::microseconds(50),
+    std::chrono::microseconds(100),
+    std::chrono::microseconds(250),
+    std::chrono::microseconds(500),
+    std::chrono::microseconds(1'000),
+    std::chrono::microseconds(2'500),
+    std::chrono::microseconds(5'000),
+    std::chrono::microseconds(10'000),
+    std::chrono::microseconds(25'000),
+    std::chrono::microseconds(50'000),
+    std::chrono::microseconds(100'000),
+};
+
+/// The name that [counter] is exposed under, such as "miracle_frames_total".
+char const* metric_name(MetricCounter counter);
+char const* metric_name(MetricHistogram histogram);
+
+struct HistogramSnapshot
+{
+    /// The number of observations that fell into each bucket, not cumulative.
+    std::array<uint64_t, metric_histogram_bounds.size()> buckets {};
+    uint64_t count = 0;
+    std::chrono::nanoseconds sum { 0 };
+};
+
+/// The values of every metric, summed over all of the threads that recorded them.
+struct MetricsSnapshot
+{
+    std::array<uint64_t, static_cast<size_t>(MetricCounter::max)> counters {};
+    std::array<HistogramSnapshot, static_cast<size_t>(MetricHistogram::max)> histograms {};
+
+    [[nodiscard]] uint64_t counter(MetricCounter c) const { return counters[static_cast<size_t>(c)]; }
+    [[nodiscard]] HistogramSnapshot const& histogram(MetricHistogram h) const { return histograms[static_cast<size_t>(h)]; }
+};
+
+/// The metrics recorded by a single thread.
+///
+/// Only the owning thread writes to the shard, so recording is a relaxed load
+/// and store with no read-modify-write. Any thread may read it.
+class MetricsShard
+{
+public:
+    /// Must only be called by the owning thread.
+    void increment(MetricCounter counter, uint64_t by);
+    void observe(MetricHistogram histogram, std::chrono::nanoseconds duration);
+
+    /// Adds the values of this shard to [snapshot].
+    void add_to(MetricsSnapshot& snapshot) const;
+
+private:
+    struct Histogram
+    {
+        std::array<std::atomic<uint64_t>, metric_histogram_bounds.size()> buckets {};
+        std::atomic<uint64_t> count = 0;
+        std::atomic<int64_t> sum_ns = 0;
+    };
+
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(MetricCounter::max)> counters {};
+    std::array<Histogram, static_cast<size_t>(MetricHistogram::max)> histograms {};
+};
+
+/// The counters and latency histograms of every subsystem, so that changes in
+/// behavior between versions can be spotted by monitoring tools.
+///
+/// Each thread records to a shard of its own and the shards are only summed when
+/// the metrics are read, so recording never takes a lock.
+class Metrics
+{
+public:
+    Metrics();
+
+    /// The registry that the compositor records to.
+    static Metrics& instance();
+
+    void increment(MetricCounter counter, uint64_t by = 1);
+    void observe(MetricHistogram histogram, std::chrono::nanoseconds duration);
+
+    [[nodiscard]] MetricsSnapshot snapshot() const;
+    [[nodiscard]] nlohmann::json to_json() const;
+
+    /// Writes the metrics in the Prometheus text exposition format.
+    [[nodiscard]] std::string to_prometheus() const;
+
+private:
+    MetricsShard& shard_for_current_thread();
+
+    uint64_t const id;
+    mutable std::mutex shards_mutex;
+    std::vector<std::unique_ptr<MetricsShard>> shards;
+};
+
+/// Observes the lifetime of the scope that it is declared in into [histogram].
+class MetricTimer
+{
+public:
+    explicit MetricTimer(MetricHistogram histogram) :
+        histogram { histogram },
+        start { std::chrono::steady_clock::now() }
+    {
+    }
+
+    ~MetricTimer()
+    {
+        Metrics::instance().observe(histogram, std::chrono::steady_clock::now() - start);
+    }
+
+    MetricTimer(MetricTimer const&) = delete;
+    MetricTimer& operator=(MetricTimer const&) = delete;
+
+private:
+    MetricHistogram const histogram;
+    std::chrono::steady_clock::time_point const start;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_METRICS_H
@@ -0,0 +1,239 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "mirror_groups.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace miracle;
+
+namespace
+{
+int64_t pixel_count(mir::geometry::Size const& size)
+{
+    return static_cast<int64_t>(size.width.as_int()) * size.height.as_int();
+}
+
+/// Whether [a] and [b] have the same aspect ratio, give or take the rounding of
+/// the letterboxing of either.
+bool is_same_aspect(mir::geometry::Size const& a, mir::geometry::Size const& b)
+{
+    auto const cross = static_cast<int64_t>(a.width.as_int()) * b.height.as_int()
+        - static_cast<int64_t>(a.height.as_int()) * b.width.as_int();
+    return std::abs(cross) <= std::max({ a.width.as_int(), a.height.as_int(), b.width.as_int(), b.height.as_int() });
+}
+}
+
+void MirrorGroups::set_output(
+    void const* output,
+    mir::geometry::Rectangle const& viewport,
+    mir::geometry::Size const& size,
+    bool top_row_first,
+    uint32_t share_group,
+    bool shareable)
+{
+    std::lock_guard lock(mutex);
+    if (auto* existing = find(output))
+    {
+        if (existing->viewport == viewport
+            && existing->size == size
+            && existing->top_row_first == top_row_first
+            && existing->share_group == share_group
+            && existing->shareable == shareable)
+            return;
+
+        existing->viewport = viewport;
+        existing->size = size;
+        existing->top_row_first = top_row_first;
+        existing->share_group = share_group;
+        existing->shareable = shareable;
+    }
+    else
+    {
+        outputs.push_back({ output, viewport, size, top_row_first, share_group, shareable });
+    }
+
+    assign_roles();
+    cv.notify_all();
+}
+
+void MirrorGroups::remove(void const* output)
+{
+    std::lock_guard lock(mutex);
+    std::erase_if(outputs, [&](Output const& o)
+    {
+        return o.output == output;
+    });
+    assign_roles();
+    cv.notify_all();
+}
+
+MirrorGroups::Role MirrorGroups::role(void const* output) const
+{
+    std::lock_guard lock(mutex);
+    auto const* o = find(output);
+    return o ? o->role : Role::alone;
+}
+
+void MirrorGroups::publish(void const* source, std::shared_ptr<MirrorFrame const> const& frame)
+{
+    std::lock_guard lock(mutex);
+    auto* o = find(source);
+    if (!o || o->role != Role::source)
+        return;
+
+    o->frame = frame;
+    o->thread = std::this_thread::get_id();
+    cv.notify_all();
+}
+
+void MirrorGroups::begin_drawing(void const* source, std::vector<std::shared_ptr<GpuFence const>>& reads)
+{
+    reads.clear();
+    std::unique_lock lock(mutex);
+    auto* o = find(source);
+    if (!o)
+        return;
+
+    o->frame.reset();
+
+    // Mirrors issue the commands that read a frame as soon as they are given it,
+    // without waiting on anything else, so this wait is brief
+    cv.wait(lock, [&]
+    {
+        o = find(source);
+        return !o || o->pending_reads == 0;
+    });
+
+    if (o)
+        std::swap(o->reads, reads);
+}
+
+std::shared_ptr<MirrorFrame const> MirrorGroups::frame_for(
+    void const* mirror, uint64_t scene, std::chrono::nanoseconds timeout)
+{
+    auto const deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock lock(mutex);
+    while (true)
+    {
+        auto* self = find(mirror);
+        if (!self || self->role != Role::mirror)
+            return nullptr;
+
+        auto* source = find(self->source);
+        if (source->frame && source->frame->scene == scene)
+        {
+            self->reading_from = source->output;
+            source->pending_reads++;
+            return source->frame;
+        }
+
+        // A source that is composited on this thread is drawn either before or after
+        // this output, but never while it waits. One that has not published a frame
+        // yet may never do so.
+        if (source->thread == std::thread::id() || source->thread == std::this_thread::get_id())
+            return nullptr;
+
+        if (std::chrono::steady_clock::now() >= deadline)
+            return nullptr;
+
+        cv.wait_until(lock, deadline);
+    }
+}
+
+void MirrorGroups::finish_reading(void const* mirror, std::shared_ptr<GpuFence const> const& read)
+{
+    std::lock_guard lock(mutex);
+    auto* self = find(mirror);
+    if (!self || !self->reading_from)
+        return;
+
+    if (auto* source = find(self->reading_from))
+    {
+        source->pending_reads--;
+        if (read)
+            source->reads.push_back(read);
+    }
+
+    self->reading_from = nullptr;
+    cv.notify_all();
+}
+
+MirrorGroups::Output* MirrorGroups::find(void const* output)
+{
+    auto const it = std::ranges::find(outputs, output, &Output::output);
+    return it == outputs.end() ? nullptr : &*it;
+}
+
+MirrorGroups::Output const* MirrorGroups::find(void const* output) const
+{
+    auto const it = std::ranges::find(outputs, output, &Output::output);
+    return it == outputs.end() ? nullptr : &*it;
+}
+
+void MirrorGroups::assign_roles()
+{
+    for (auto& o : outputs)
+    {
+        o.role = Role::alone;
+        o.source = nullptr;
+    }
+
+    for (auto& candidate : outputs)
+    {
+        if (!candidate.shareable || candidate.source || candidate.role == Role::source)
+            continue;
+
+        // The output of the group with the most pixels draws for the others, so that
+        // none of them is shown at less than its own resolution
+        auto const same_group = [&](Output const& o)
+        {
+            return o.shareable
+                && o.viewport == candidate.viewport
+                && o.top_row_first == candidate.top_row_first
+                && o.share_group == candidate.share_group;
+        };
+
+        Output* source = &candidate;
+        for (auto& o : outputs)
+        {
+            if (same_group(o) && pixel_count(o.size) > pixel_count(source->size))
+                source = &o;
+        }
+
+        for (auto& o : outputs)
+        {
+            if (&o == source || !same_group(o) || !is_same_aspect(o.size, source->size))
+                continue;
+
+            o.role = Role::mirror;
+            o.source = source->output;
+            source->role = Role::source;
+        }
+    }
+
+    // Frames and reads only mean anything to the source that they were drawn for
+    for (auto& o : outputs)
+    {
+        if (o.role != Role::source)
+        {
+            o.frame.reset();
+            o.reads.clear();
+        }
+    }
+}
@@ -0,0 +1,145 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_MIRROR_GROUPS_H
+#define MIRACLE_WM_MIRROR_GROUPS_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mir/geometry/rectangle.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace miracle
+{
+class GpuFence;
+
+/// A frame that the source of a mirror group drew into its offscreen target.
+struct MirrorFrame
+{
+    /// The GL texture that holds the frame. Textures are shared between the
+    /// contexts of a share group, while framebuffers are not.
+    uint32_t texture = 0;
+    /// Identifies the scene that the frame shows, so that a mirror only ever shows
+    /// a frame of the scene that it was itself asked to draw.
+    uint64_t scene = 0;
+    /// Reached once the frame has been drawn.
+    std::shared_ptr<GpuFence const> drawn;
+};
+
+/// Lets outputs that mirror one another share a single render of the scene.
+///
+/// Outputs that show the same area of the scene, the same way up, form a group.
+/// The output with the most pixels is the source of the group: it draws the scene
+/// into an offscreen target and publishes each frame with [publish]. The other
+/// outputs, the mirrors, scale the texture of that target onto themselves instead
+/// of drawing the scene again. Mirrors whose aspect ratio differs from that of the
+/// source would be stretched, so they draw the scene themselves.
+///
+/// Each output may be composited on a thread and a GL context of its own. Any
+/// thread may call into the groups.
+class MirrorGroups
+{
+public:
+    enum class Role
+    {
+        /// The output draws the scene by itself.
+        alone,
+        /// The output draws the scene for itself and for its mirrors.
+        source,
+        /// The output shows the frames of its source.
+        mirror
+    };
+
+    /// Records that [output] shows [viewport] on [size] pixels, with its rows in
+    /// the order given by [top_row_first]. Only outputs whose GL contexts are in
+    /// the same [share_group] can read the textures of one another. Outputs that
+    /// cannot share frames, such as rotated ones, are not [shareable] and always
+    /// draw by themselves.
+    void set_output(
+        void const* output,
+        mir::geometry::Rectangle const& viewport,
+        mir::geometry::Size const& size,
+        bool top_row_first,
+        uint32_t share_group,
+        bool shareable);
+    void remove(void const* output);
+
+    [[nodiscard]] Role role(void const* output) const;
+
+    /// Publishes the latest frame of [source] to its mirrors.
+    void publish(void const* source, std::shared_ptr<MirrorFrame const> const& frame);
+
+    /// Withdraws the frame of [source] before it draws over its texture. Waits for
+    /// the mirrors that are issuing reads of the texture to finish doing so, then
+    /// moves those reads into [reads]. The source must wait for each of them on
+    /// the GPU before it draws.
+    void begin_drawing(void const* source, std::vector<std::shared_ptr<GpuFence const>>& reads);
+
+    /// Returns the frame of the source of [mirror] that shows [scene]. If the source
+    /// has not drawn that scene yet and is composited on another thread, waits up
+    /// to [timeout] for it. Returns nullptr if there is no such frame.
+    ///
+    /// A mirror that is given a frame must call [finish_reading] once it has issued
+    /// the commands that read it, even if it did not read it after all.
+    std::shared_ptr<MirrorFrame const> frame_for(
+        void const* mirror, uint64_t scene, std::chrono::nanoseconds timeout);
+
+    /// Records that [mirror] has issued the commands that read the frame that it was
+    /// last given, which are done once [read] is reached. [read] may be null if
+    /// nothing was read.
+    void finish_reading(void const* mirror, std::shared_ptr<GpuFence const> const& read);
+
+private:
+    struct Output
+    {
+        void const* output;
+        mir::geometry::Rectangle viewport;
+        mir::geometry::Size size;
+        bool top_row_first;
+        uint32_t share_group;
+        bool shareable;
+        Role role = Role::alone;
+        /// The source of the group, if this is a mirror.
+        void const* source = nullptr;
+        /// The source whose frame this output is reading, if any.
+        void const* reading_from = nullptr;
+
+        /// Set on sources only.
+        std::shared_ptr<MirrorFrame const> frame;
+        std::thread::id thread;
+        /// The mirrors that were given the frame and are yet to finish reading it.
+        int pending_reads = 0;
+        std::vector<std::shared_ptr<GpuFence const>> reads;
+    };
+
+    Output* find(void const* output);
+    Output const* find(void const* output) const;
+    /// Must be called with [mutex] held.
+    void assign_roles();
+
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<Output> outputs;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_MIRROR_GROUPS_H
@@ -21,6 +21,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "compositor_state.h"
 #include "config.h"
 #include "output_manager.h"
+#include "parent_container.h"
+#include <glm/gtx/transform.hpp>
 #include <mir/log.h>
 
 using namespace miracle;
@@ -42,10 +44,15 @@ bool MoveService::handle_pointer_event(
     MirPointerAction action,
     uint modifiers)
 {
+    // The move may have been ended by something other than the pointer
+    if (state.mode() != WindowManagerMode::moving && !moving_root.expired())
+        finish_move();
+
     if (state.mode() == WindowManagerMode::moving)
     {
         if (action == mir_pointer_action_button_up)
         {
+            finish_move();
             command_controller->set_mode(WindowManagerMode::normal);
             return true;
         }
@@ -60,11 +67,17 @@ bool MoveService::handle_pointer_event(
         if (cursor_x == x && cursor_y == y)
             return false;
 
-        auto dx = x - cursor_x;
-        auto dy = y - cursor_y;
-        state.focused_container()->move_by(dx, dy);
         cursor_x = x;
         cursor_y = y;
+
+        // Only the transform changes here, so the compositor coalesces every move
+        // within a frame and the client is not reconfigured until the drop.
+        auto const offset = glm::translate(glm::vec3(x - start_x, y - start_y, 0.f));
+        for (auto const& leaf : moving_leaves)
+        {
+            if (auto container = leaf.container.lock())
+                container->set_transform(offset * leaf.base_transform);
+        }
         return true;
     }
     else if (action == mir_pointer_action_button_down)
@@ -90,8 +103,55 @@ bool MoveService::handle_pointer_event(
         command_controller->select_container(intersected);
         cursor_x = x;
         cursor_y = y;
+        start_x = x;
+        start_y = y;
+        begin_move(intersected);
         return true;
     }
 
     return false;
+}
+
+void MoveService::begin_move(std::shared_ptr<Container> const& container)
+{
+    moving_leaves.clear();
+
+    auto root = container;
+    while (auto parent = root->get_parent().lock())
+        root = parent;
+
+    // Anchored trees are tiled, and cannot be moved by the pointer
+    if (root->is_leaf() || root->anchored())
+    {
+        moving_root.reset();
+        return;
+    }
+
+    moving_root = root;
+    auto const collect = [&](auto const& self, std::shared_ptr<Container> const& node) -> void
+    {
+        if (node->is_leaf())
+        {
+            moving_leaves.push_back({ node, node->get_transform() });
+            return;
+        }
+
+        for (auto const& child : Container::as_parent(node)->get_sub_nodes())
+            self(self, child);
+    };
+    collect(collect, root);
+}
+
+void MoveService::finish_move()
+{
+    for (auto const& leaf : moving_leaves)
+    {
+        if (auto container = leaf.container.lock())
+            container->set_transform(leaf.base_transform);
+    }
+    moving_leaves.clear();
+
+    if (auto root = moving_root.lock())
+        root->move_by(cursor_x - start_x, cursor_y - start_y);
+    moving_root.reset();
 }
\ No newline at end of file
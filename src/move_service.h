@@ -18,13 +18,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef MIRACLE_WM_MOVE_SERVICE_H
 #define MIRACLE_WM_MOVE_SERVICE_H
 
+#include <glm/glm.hpp>
 #include <memory>
 #include <mir_toolkit/event.h>
+#include <vector>
 
 namespace miracle
 {
 class CommandController;
 class Config;
+class Container;
 class CompositorState;
 class OutputManager;
 
@@ -41,6 +44,22 @@ private:
 
     float cursor_x = 0;
     float cursor_y = 0;
+
+    /// While moving, the window only follows the cursor through the transforms of
+    /// its leaves. The floating tree is moved for real once the move is finished.
+    struct MovingLeaf
+    {
+        std::weak_ptr<Container> container;
+        glm::mat4 base_transform;
+    };
+
+    std::weak_ptr<Container> moving_root;
+    std::vector<MovingLeaf> moving_leaves;
+    float start_x = 0;
+    float start_y = 0;
+
+    void begin_move(std::shared_ptr<Container> const& container);
+    void finish_move();
 };
 
 } // miracle
@@ -0,0 +1,97 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_MPSC_QUEUE_H
+#define MIRACLE_WM_MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace miracle
+{
+
+/// A lock-free queue that any number of threads may push to, but that only a
+/// single thread may drain.
+///
+/// Producers push onto an atomic stack. The consumer takes the whole stack at
+/// once and reverses it, so items are handed out in the order they were pushed.
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue() = default;
+    MpscQueue(MpscQueue const&) = delete;
+    MpscQueue& operator=(MpscQueue const&) = delete;
+
+    ~MpscQueue()
+    {
+        drain([](T&&) { });
+    }
+
+    void push(T value)
+    {
+        auto node = new Node { std::move(value), head.load() };
+        while (!head.compare_exchange_weak(node->next, node))
+            ;
+    }
+
+    /// Calls [f] with every item pushed since the last drain, oldest first.
+    /// Returns the number of items drained.
+    template <typename F>
+    size_t drain(F const& f)
+    {
+        Node* reversed = nullptr;
+        for (Node* node = head.exchange(nullptr); node;)
+        {
+            auto next = node->next;
+            node->next = reversed;
+            reversed = node;
+            node = next;
+        }
+
+        size_t count = 0;
+        while (reversed)
+        {
+            auto next = reversed->next;
+            f(std::move(reversed->value));
+            delete reversed;
+            reversed = next;
+            count++;
+        }
+
+        return count;
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return head.load() == nullptr;
+    }
+
+private:
+    struct Node
+    {
+        T value;
+        Node* next;
+    };
+
+    std::atomic<Node*> head = nullptr;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_MPSC_QUEUE_H
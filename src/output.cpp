@@ -22,17 +22,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "compositor_state.h"
 #include "config.h"
 #include "leaf_container.h"
+#include "parent_container.h"
+#include "pool_allocator.h"
 #include "vector_helpers.h"
 #include "window_helpers.h"
 
 #include "workspace.h"
 #include "workspace_manager.h"
+#include "workspace_swipe.h"
+#include <algorithm>
 #include <glm/gtx/transform.hpp>
 #include <memory>
 #include <mir/log.h>
 #include <miral/toolkit_event.h>
 #include <miral/window_info.h>
 #include <miral/zone.h>
+#include <utility>
 
 using namespace miracle;
 
@@ -53,11 +58,20 @@ Output::Output(
     animator { animator },
     handle { animator->register_animateable() }
 {
+    // The default workspaces are built up front so that switching to them never has to allocate
+    spare_workspaces.reserve(WorkspaceManager::NUM_DEFAULT_WORKSPACES);
+    for (int i = 0; i < WorkspaceManager::NUM_DEFAULT_WORKSPACES; i++)
+    {
+        auto const spare = std::make_shared<Workspace>(
+            this, 0, std::nullopt, std::nullopt, this->config, this->window_controller, this->state);
+        spare->hide();
+        spare_workspaces.push_back(spare);
+    }
 }
 
 Output::~Output()
 {
-    animator->remove_by_animation_handle(handle);
+    animator->unregister_animateable(handle);
 }
 
 WorkspaceInterface* Output::active() const
@@ -84,26 +98,34 @@ std::shared_ptr<Container> Output::intersect_leaf(float x, float y, bool ignore_
         return nullptr;
     }
 
-    auto workspace = active_workspace.lock().get();
-    std::shared_ptr<Container> result = nullptr;
-    workspace->for_each_window([&](std::shared_ptr<Container> const& container)
+    auto const workspace = active_workspace.lock();
+    update_leaf_index(*workspace);
+
+    auto const focused = ignore_selected ? state->focused_container() : nullptr;
+    auto const found = leaf_index.find(geom::Point(x, y), [&](std::weak_ptr<Container> const& container)
     {
-        if (ignore_selected && container == state->focused_container())
-            return false;
+        return !focused || container.lock() != focused;
+    });
 
-        if (container->get_type() != ContainerType::leaf)
-            return false;
+    return found ? found->lock() : nullptr;
+}
 
-        if (container->get_visible_area().contains(geom::Point(x, y)))
-        {
-            result = container;
-            return true;
-        }
+void Output::update_leaf_index(WorkspaceInterface const& workspace)
+{
+    if (leaf_index_generation == state->layout_generation() && leaf_index_workspace == &workspace)
+        return;
 
+    std::vector<RectangleIndex<std::weak_ptr<Container>>::Entry> entries;
+    workspace.for_each_window([&](std::shared_ptr<Container> const& container)
+    {
+        if (container->get_type() == ContainerType::leaf)
+            entries.push_back({ container->get_visible_area(), container });
         return false;
     });
 
-    return result;
+    leaf_index.build(std::move(entries));
+    leaf_index_generation = state->layout_generation();
+    leaf_index_workspace = &workspace;
 }
 
 AllocationHint Output::allocate_position(
@@ -129,15 +151,46 @@ AllocationHint Output::allocate_position(
     if (hint.container_type == ContainerType::shell)
         return hint;
 
-    return active()->allocate_position(app_info, requested_specification, hint);
+    // A layout that is waiting for this window takes it, even onto a hidden
+    // workspace, unless the active workspace is waiting for it too
+    auto const app_id = requested_specification.application_id().is_set()
+        ? requested_specification.application_id().value()
+        : app_info.name();
+    auto const title = requested_specification.name().is_set() ? requested_specification.name().value() : "";
+    auto const current = active();
+    if (!current->has_layout_slot_for(app_id, title))
+    {
+        for (auto const& workspace : workspaces)
+        {
+            if (workspace.get() != current && workspace->has_layout_slot_for(app_id, title))
+                return workspace->allocate_position(app_info, requested_specification, hint);
+        }
+    }
+
+    return current->allocate_position(app_info, requested_specification, hint);
 }
 
 std::shared_ptr<Container> Output::create_container(
     miral::WindowInfo const& window_info, AllocationHint const& hint) const
 {
+    // The window goes wherever it was allocated, which may not be the active workspace
+    if (hint.container_type == ContainerType::leaf && hint.parent)
+    {
+        if (auto const workspace = hint.parent.value()->get_workspace())
+            return workspace->create_container(window_info, hint);
+    }
+
     return active()->create_container(window_info, hint);
 }
 
+bool Output::has_layout_slot_for(std::string const& app_id, std::string const& title) const
+{
+    return std::ranges::any_of(workspaces, [&](std::shared_ptr<WorkspaceInterface> const& workspace)
+    {
+        return workspace->has_layout_slot_for(app_id, title);
+    });
+}
+
 void Output::delete_container(std::shared_ptr<miracle::Container> const& container)
 {
     auto workspace = container->get_workspace();
@@ -160,13 +213,28 @@ void Output::insert_workspace_sorted(std::shared_ptr<WorkspaceInterface> const&
         else
             return false;
     });
+
+    if (is_showing_overview())
+        show_overview();
 }
 
 void Output::advise_new_workspace(WorkspaceCreationData const&& data)
 {
+    std::shared_ptr<WorkspaceInterface> new_workspace;
+    if (!spare_workspaces.empty())
+    {
+        auto const spare = spare_workspaces.back();
+        spare_workspaces.pop_back();
+        spare->recycle(data.id, data.num, data.name);
+        new_workspace = spare;
+    }
+    else
+    {
+        new_workspace = std::make_shared<Workspace>(
+            this, data.id, data.num, data.name, config, window_controller, state);
+    }
+
     // Workspaces are always kept in sorted order with numbered workspaces in front followed by all other workspaces
-    std::shared_ptr<WorkspaceInterface> new_workspace = std::make_shared<Workspace>(
-        this, data.id, data.num, data.name, config, window_controller, state);
     insert_workspace_sorted(new_workspace);
 }
 
@@ -176,7 +244,22 @@ void Output::advise_workspace_deleted(WorkspaceManager& workspace_manager, uint3
     {
         if (it->get()->id() == id)
         {
+            // A workspace that is moving to another output has already been handed
+            // over to it, and so is not ours to recycle.
+            auto const workspace = std::dynamic_pointer_cast<Workspace>(*it);
             workspaces.erase(it);
+            state->render_data_manager()->clear_workspace_transform(id);
+            if (is_showing_overview())
+                show_overview();
+
+            if (workspace
+                && workspace->get_output() == this
+                && workspace->is_empty()
+                && spare_workspaces.size() < WorkspaceManager::NUM_DEFAULT_WORKSPACES)
+            {
+                workspace->hide();
+                spare_workspaces.push_back(workspace);
+            }
             return;
         }
     }
@@ -188,14 +271,14 @@ void Output::move_workspace_to(WorkspaceManager& workspace_manager, WorkspaceInt
         return;
 
     std::shared_ptr<WorkspaceInterface> to_add = nullptr;
-    if (auto old = workspace->get_output())
+    auto const old = workspace->get_output();
+    if (old)
     {
         for (auto const& w : old->get_workspaces())
         {
             if (w->id() == workspace->id())
             {
                 to_add = w;
-                old->advise_workspace_deleted(workspace_manager, workspace->id());
                 break;
             }
         }
@@ -208,8 +291,9 @@ void Output::move_workspace_to(WorkspaceManager& workspace_manager, WorkspaceInt
     }
 
     mir::log_info("Moving workspace %d to output %d", workspace->id(), id_);
-    insert_workspace_sorted(to_add);
     to_add->set_output(this);
+    old->advise_workspace_deleted(workspace_manager, to_add->id());
+    insert_workspace_sorted(to_add);
     to_add->hide();
 
     if (to_add->is_empty())
@@ -247,6 +331,15 @@ bool Output::advise_workspace_active(WorkspaceManager& workspace_manager, uint32
         return false;
     }
 
+    // Picking a workspace always leaves the overview. The overview already shows
+    // the workspace, so there is nothing to animate.
+    if (is_showing_overview())
+    {
+        AnimationSuppression suppression(*state);
+        set_overview(false);
+        return advise_workspace_active(workspace_manager, id);
+    }
+
     if (!from)
     {
         to->show();
@@ -256,7 +349,7 @@ bool Output::advise_workspace_active(WorkspaceManager& workspace_manager, uint32
         set_position(glm::vec2(
             -to_rectangle.top_left.x.as_int(),
             -to_rectangle.top_left.y.as_int()));
-        to->workspace_transform_change_hack();
+        reset_workspace_transforms(to);
         return true;
     }
 
@@ -285,7 +378,8 @@ bool Output::advise_workspace_active(WorkspaceManager& workspace_manager, uint32
     if (from->is_empty())
         workspace_manager.delete_workspace(from->id());
 
-    if (!config->are_animations_enabled())
+    auto const snapshot = config->snapshot();
+    if (!snapshot->animations_enabled || state->animations_suppressed())
     {
         on_workspace_animation(
             AnimationStepResult { handle,
@@ -299,9 +393,23 @@ bool Output::advise_workspace_active(WorkspaceManager& workspace_manager, uint32
         return true;
     }
 
-    auto animation = std::make_shared<WorkspaceAnimation>(
+    auto definition = snapshot->animation_definitions[(int)AnimateableEvent::workspace_switch];
+    if (auto const velocity = std::exchange(release_velocity, std::nullopt))
+    {
+        // A swipe let go of the workspaces on their way here. Carry on from where
+        // they are, at the speed at which they were let go.
+        src = real;
+        definition.function = EaseFunction::ease_out_cubic;
+        definition.duration_seconds = WorkspaceSwipe::release_duration(
+            static_cast<float>((dest.top_left.x - real.top_left.x).as_int()),
+            velocity.value(),
+            definition.duration_seconds);
+    }
+
+    auto animation = std::allocate_shared<WorkspaceAnimation>(
+        PoolAllocator<WorkspaceAnimation>(),
         handle,
-        config->get_animation_definitions()[(int)AnimateableEvent::workspace_switch],
+        definition,
         src,
         dest,
         real,
@@ -363,7 +471,7 @@ void Output::on_workspace_animation(
                 workspace->hide();
         }
 
-        to->workspace_transform_change_hack();
+        reset_workspace_transforms(to);
         return;
     }
 
@@ -372,8 +480,32 @@ void Output::on_workspace_animation(
     if (asr.transform)
         set_transform(asr.transform.value());
 
+    apply_workspace_transforms();
+}
+
+void Output::apply_workspace_transforms()
+{
+    {
+        RenderDataManager::Batch batch(*state->render_data_manager());
+        for (size_t i = 0; i < workspaces.size(); i++)
+            state->render_data_manager()->workspace_transform_change(workspaces[i]->id(), get_workspace_transform(i));
+    }
+
     for (auto const& workspace : workspaces)
-        workspace->workspace_transform_change_hack();
+        workspace->surface_transform_change_hack();
+}
+
+void Output::reset_workspace_transforms(std::shared_ptr<WorkspaceInterface> const& active)
+{
+    RenderDataManager::Batch batch(*state->render_data_manager());
+    for (auto const& workspace : workspaces)
+    {
+        if (workspace != active)
+            state->render_data_manager()->clear_workspace_transform(workspace->id());
+    }
+
+    if (active)
+        active->workspace_transform_change_hack();
 }
 
 void Output::advise_application_zone_create(miral::Zone const& application_zone)
@@ -381,8 +513,7 @@ void Output::advise_application_zone_create(miral::Zone const& application_zone)
     if (application_zone.extents().contains(area))
     {
         application_zone_list.push_back(application_zone);
-        for (auto& workspace : workspaces)
-            workspace->recalculate_area();
+        are_application_zones_dirty = true;
     }
 }
 
@@ -392,8 +523,7 @@ void Output::advise_application_zone_update(miral::Zone const& updated, miral::Z
         if (zone == original)
         {
             zone = updated;
-            for (auto& workspace : workspaces)
-                workspace->recalculate_area();
+            are_application_zones_dirty = true;
             break;
         }
 }
@@ -406,10 +536,18 @@ void Output::advise_application_zone_delete(miral::Zone const& application_zone)
         application_zone_list.end());
 
     if (application_zone_list.size() != original_size)
-    {
-        for (auto& workspace : workspaces)
-            workspace->recalculate_area();
-    }
+        are_application_zones_dirty = true;
+}
+
+void Output::apply_application_zones()
+{
+    if (!are_application_zones_dirty)
+        return;
+
+    // Hidden workspaces only hold on to their new area until they are shown
+    are_application_zones_dirty = false;
+    for (auto& workspace : workspaces)
+        workspace->recalculate_area();
 }
 
 bool Output::point_is_in_output(int x, int y)
@@ -424,20 +562,15 @@ void Output::update_area(geom::Rectangle const& new_area)
         workspace->set_area(area);
 }
 
-std::vector<miral::Window> Output::collect_all_windows() const
+bool Output::for_each_window(FunctionRef<bool(std::shared_ptr<Container> const&)> f) const
 {
-    std::vector<miral::Window> windows;
-    for (auto& workspace : get_workspaces())
+    for (auto const& workspace : workspaces)
     {
-        workspace->for_each_window([&](std::shared_ptr<Container> const& container)
-        {
-            if (auto window = container->window())
-                windows.push_back(*window);
-            return false;
-        });
+        if (workspace->for_each_window(f))
+            return true;
     }
 
-    return windows;
+    return false;
 }
 
 void Output::graft(std::shared_ptr<Container> const& container)
@@ -471,6 +604,13 @@ geom::Rectangle Output::get_workspace_rectangle(size_t i) const
     };
 }
 
+glm::mat4 Output::get_workspace_transform(size_t i) const
+{
+    auto const workspace_rect = get_workspace_rectangle(i);
+    return get_transform()
+        * glm::translate(glm::vec3(workspace_rect.top_left.x.as_int(), workspace_rect.top_left.y.as_int(), 0));
+}
+
 [[nodiscard]] WorkspaceInterface const* Output::workspace(uint32_t id) const
 {
     for (auto const& workspace : workspaces)
@@ -515,50 +655,201 @@ void Output::unset_defunct()
     is_defunct_ = false;
 }
 
+void Output::set_overview(bool enabled)
+{
+    if (enabled == is_showing_overview())
+        return;
+
+    if (enabled)
+    {
+        show_overview();
+        return;
+    }
+
+    overview_cells.clear();
+    auto const active_ = active_workspace.lock();
+    for (auto const& workspace : workspaces)
+    {
+        if (workspace != active_)
+            workspace->hide();
+    }
+
+    reset_workspace_transforms(active_);
+}
+
+void Output::begin_swipe()
+{
+    release_velocity.reset();
+
+    // The swipe takes over from a switch that is still on its way.
+    animator->remove_by_animation_handle(handle);
+
+    auto const active_ = active_workspace.lock();
+    auto const it = std::ranges::find(workspaces, active_);
+    if (it == workspaces.end())
+        return;
+
+    // The neighbours start drawing now, rather than when they come into view.
+    if (it != workspaces.begin())
+        (*std::prev(it))->show();
+    if (std::next(it) != workspaces.end())
+        (*std::next(it))->show();
+}
+
+void Output::swipe(float offset)
+{
+    auto const it = std::ranges::find(workspaces, active_workspace.lock());
+    if (it == workspaces.end())
+        return;
+
+    // Workspaces are as far apart as their numbers, so the swipe is stretched to
+    // bring the neighbour fully into view as it reaches the edge of the output.
+    size_t const index = std::distance(workspaces.begin(), it);
+    auto const rectangle = get_workspace_rectangle(index);
+    auto const width = area.size.width.as_int();
+    swipe_scale = 1.f;
+    if (width > 0 && offset > 0 && index + 1 < workspaces.size())
+        swipe_scale = static_cast<float>((get_workspace_rectangle(index + 1).top_left.x - rectangle.top_left.x).as_int()) / width;
+    else if (width > 0 && offset < 0 && index > 0)
+        swipe_scale = static_cast<float>((rectangle.top_left.x - get_workspace_rectangle(index - 1).top_left.x).as_int()) / width;
+
+    set_position(glm::vec2(
+        -rectangle.top_left.x.as_int() - offset * swipe_scale,
+        -rectangle.top_left.y.as_int()));
+    apply_workspace_transforms();
+}
+
+void Output::end_swipe(float velocity, bool switches)
+{
+    velocity *= swipe_scale;
+    swipe_scale = 1.f;
+    if (switches)
+    {
+        release_velocity = velocity;
+        return;
+    }
+
+    auto const active_ = active_workspace.lock();
+    auto const it = std::ranges::find(workspaces, active_);
+    if (it == workspaces.end())
+        return;
+
+    auto const active_rectangle = get_workspace_rectangle(std::distance(workspaces.begin(), it));
+    geom::Rectangle real {
+        { geom::X { position_offset.x }, geom::Y { position_offset.y } },
+        area.size
+    };
+    geom::Rectangle dest {
+        { geom::X { -active_rectangle.top_left.x.as_int() }, geom::Y { active_rectangle.top_left.y.as_int() } },
+        area.size
+    };
+
+    auto const snapshot = config->snapshot();
+    if (!snapshot->animations_enabled || state->animations_suppressed())
+    {
+        on_workspace_animation(
+            AnimationStepResult { handle,
+                true,
+                dest,
+                glm::vec2(dest.top_left.x.as_int(), dest.top_left.y.as_int()),
+                glm::vec2(dest.size.width.as_int(), dest.size.height.as_int()),
+                glm::mat4(1.f) },
+            active_,
+            nullptr);
+        return;
+    }
+
+    auto definition = snapshot->animation_definitions[(int)AnimateableEvent::workspace_switch];
+    definition.function = EaseFunction::ease_out_cubic;
+    definition.duration_seconds = WorkspaceSwipe::release_duration(
+        static_cast<float>((dest.top_left.x - real.top_left.x).as_int()),
+        velocity,
+        definition.duration_seconds);
+
+    animator->append(std::allocate_shared<WorkspaceAnimation>(
+        PoolAllocator<WorkspaceAnimation>(),
+        handle,
+        definition,
+        real,
+        dest,
+        real,
+        active_,
+        nullptr,
+        this));
+}
+
+void Output::show_overview()
+{
+    overview_cells = layout_overview(area, workspaces.size());
+
+    // The clients keep their size. Each workspace is only drawn with a transform
+    // that scales it down into its cell.
+    {
+        RenderDataManager::Batch batch(*state->render_data_manager());
+        for (size_t i = 0; i < workspaces.size(); i++)
+            state->render_data_manager()->workspace_transform_change(workspaces[i]->id(), overview_cells[i].transform);
+    }
+
+    for (auto const& workspace : workspaces)
+    {
+        workspace->show();
+        workspace->surface_transform_change_hack();
+    }
+}
+
+std::optional<uint32_t> Output::overview_workspace_at(geom::Point const& point) const
+{
+    for (size_t i = 0; i < overview_cells.size() && i < workspaces.size(); i++)
+    {
+        if (overview_cells[i].area.contains(point))
+            return workspaces[i]->id();
+    }
+
+    return std::nullopt;
+}
+
 nlohmann::json Output::to_json(bool is_focused) const
 {
-    nlohmann::json nodes = nlohmann::json::array();
+    std::string serialized;
+    JsonWriter writer(serialized);
+    write_json(writer, is_focused);
+    return nlohmann::json::parse(serialized);
+}
+
+void Output::write_json(JsonWriter& writer, bool is_focused) const
+{
+    geom::Rectangle const empty_area;
+    writer.begin_object()
+        .key("id")
+        .value(reinterpret_cast<std::uintptr_t>(this))
+        .key("name")
+        .value(name_)
+        .key("type")
+        .value("output")
+        .key("layout")
+        .value("output")
+        .key("orientation")
+        .value("none")
+        .key("visible")
+        .value(true)
+        .key("focused")
+        .value(is_focused)
+        .key("urgent")
+        .value(false)
+        .key("border")
+        .value("none")
+        .key("current_border_width")
+        .value(0)
+        .rect("window_rect", empty_area)
+        .rect("deco_rect", empty_area)
+        .rect("geometry", empty_area)
+        .rect("rect", area);
+
+    writer.key("nodes").begin_array();
     for (auto const& workspace : workspaces)
     {
         if (workspace)
-            nodes.push_back(workspace->to_json(is_focused));
-    }
-
-    return {
-        { "id",                   reinterpret_cast<std::uintptr_t>(this) },
-        { "name",                 name_                                  },
-        { "type",                 "output"                               },
-        { "layout",               "output"                               },
-        { "orientation",          "none"                                 },
-        { "visible",              true                                   },
-        { "focused",              is_focused                             },
-        { "urgent",               false                                  },
-        { "border",               "none"                                 },
-        { "current_border_width", 0                                      },
-        { "window_rect",          {
-                             { "x", 0 },
-                             { "y", 0 },
-                             { "width", 0 },
-                             { "height", 0 },
-                         }                       },
-        { "deco_rect",            {
-                           { "x", 0 },
-                           { "y", 0 },
-                           { "width", 0 },
-                           { "height", 0 },
-                       }                           },
-        { "geometry",             {
-                          { "x", 0 },
-                          { "y", 0 },
-                          { "width", 0 },
-                          { "height", 0 },
-                      }                             },
-        { "rect",                 {
-                      { "x", area.top_left.x.as_int() },
-                      { "y", area.top_left.y.as_int() },
-                      { "width", area.size.width.as_int() },
-                      { "height", area.size.height.as_int() },
-                  }                                     },
-        { "nodes",                nodes                                  }
-    };
+            workspace->write_json(writer, is_focused);
+    }
+    writer.end_array().end_object();
 }
@@ -19,9 +19,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIRACLE_WM_OUTPUT_H
 
 #include "output_interface.h"
+#include "overview_layout.h"
+#include "rectangle_index.h"
+
+#include <optional>
 
 namespace miracle
 {
+class Workspace;
+
 class Output : public OutputInterface
 {
 public:
@@ -44,12 +50,14 @@ public:
     [[nodiscard]] std::shared_ptr<Container> create_container(
         miral::WindowInfo const& window_info, AllocationHint const& hint) const override;
     void delete_container(std::shared_ptr<Container> const& container) override;
+    [[nodiscard]] bool has_layout_slot_for(std::string const& app_id, std::string const& title) const override;
     void advise_new_workspace(WorkspaceCreationData const&&) override;
     void advise_workspace_deleted(WorkspaceManager& workspace_manager, uint32_t id) override;
     bool advise_workspace_active(WorkspaceManager& workspace_manager, uint32_t id) override;
     void advise_application_zone_create(miral::Zone const& application_zone) override;
     void advise_application_zone_update(miral::Zone const& updated, miral::Zone const& original) override;
     void advise_application_zone_delete(miral::Zone const& application_zone) override;
+    void apply_application_zones() override;
     void move_workspace_to(WorkspaceManager& workspace_manager, WorkspaceInterface* workspace) override;
     bool point_is_in_output(int x, int y) override;
     void update_area(geom::Rectangle const& area) override;
@@ -59,19 +67,27 @@ public:
     void set_info(int id, std::string name) override;
     void set_defunct() override;
     void unset_defunct() override;
+    void set_overview(bool enabled) override;
+    void begin_swipe() override;
+    void swipe(float offset) override;
+    void end_swipe(float velocity, bool switches) override;
 
-    [[nodiscard]] std::vector<miral::Window> collect_all_windows() const override;
+    bool for_each_window(FunctionRef<bool(std::shared_ptr<Container> const&)> f) const override;
     [[nodiscard]] WorkspaceInterface* active() const override;
     [[nodiscard]] std::vector<std::shared_ptr<WorkspaceInterface>> const& get_workspaces() const override { return workspaces; }
     [[nodiscard]] geom::Rectangle const& get_area() const override { return area; }
     [[nodiscard]] std::vector<miral::Zone> const& get_app_zones() const override { return application_zone_list; }
     [[nodiscard]] std::string const& name() const override { return name_; }
     [[nodiscard]] bool is_defunct() const override { return is_defunct_; }
+    [[nodiscard]] bool is_showing_overview() const override { return !overview_cells.empty(); }
+    [[nodiscard]] std::optional<uint32_t> overview_workspace_at(geom::Point const& point) const override;
     [[nodiscard]] int id() const override { return id_; }
     [[nodiscard]] glm::mat4 get_transform() const override;
     [[nodiscard]] geom::Rectangle get_workspace_rectangle(size_t i) const override;
+    [[nodiscard]] glm::mat4 get_workspace_transform(size_t i) const override;
     [[nodiscard]] WorkspaceInterface const* workspace(uint32_t id) const override;
     [[nodiscard]] nlohmann::json to_json(bool is_focused) const override;
+    void write_json(JsonWriter& writer, bool is_focused) const override;
 
 private:
     class WorkspaceAnimation : public Animation
@@ -95,10 +111,15 @@ private:
         Output* output;
     };
 
+    /// Drops the transforms of the hidden workspaces and publishes that of [active].
+    void reset_workspace_transforms(std::shared_ptr<WorkspaceInterface> const& active);
+    void show_overview();
     void on_workspace_animation(
         AnimationStepResult const& result,
         std::shared_ptr<WorkspaceInterface> const& to,
         std::shared_ptr<WorkspaceInterface> const& from);
+    /// Publishes the transform of every workspace for the current position.
+    void apply_workspace_transforms();
     void insert_workspace_sorted(std::shared_ptr<WorkspaceInterface> const& new_workspace);
 
     std::string name_;
@@ -110,7 +131,11 @@ private:
     std::shared_ptr<Animator> animator;
     std::weak_ptr<WorkspaceInterface> active_workspace;
     std::vector<std::shared_ptr<WorkspaceInterface>> workspaces;
+
+    /// Empty workspaces that are waiting to be used again by [advise_new_workspace].
+    std::vector<std::shared_ptr<Workspace>> spare_workspaces;
     std::vector<miral::Zone> application_zone_list;
+    bool are_application_zones_dirty = false;
     AnimationHandle handle;
 
     /// The position of the output for scrolling across workspaces
@@ -123,6 +148,25 @@ private:
     glm::mat4 final_transform = glm::mat4(1.f);
 
     bool is_defunct_ = false;
+
+    /// The speed at which a swipe that lands on another workspace was let go. The
+    /// switch that follows picks up at this speed.
+    std::optional<float> release_velocity;
+
+    /// How many pixels the workspaces move for each pixel of the swipe.
+    float swipe_scale = 1.f;
+
+    /// Where each of [workspaces] is drawn while the overview is shown. Empty
+    /// when the overview is hidden.
+    std::vector<OverviewCell> overview_cells;
+
+    /// The visible areas of the leaves on the active workspace, built from the layout
+    /// of [leaf_index_generation].
+    RectangleIndex<std::weak_ptr<Container>> leaf_index;
+    std::optional<uint64_t> leaf_index_generation;
+    WorkspaceInterface const* leaf_index_workspace = nullptr;
+
+    void update_leaf_index(WorkspaceInterface const& workspace);
 };
 }
 
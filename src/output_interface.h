@@ -60,12 +60,20 @@ public:
         miral::WindowInfo const& window_info, AllocationHint const& hint) const
         = 0;
     virtual void delete_container(std::shared_ptr<Container> const& container) = 0;
+
+    /// Whether a workspace of this output is waiting on a layout with a free slot
+    /// for a window with [app_id] and [title].
+    [[nodiscard]] virtual bool has_layout_slot_for(std::string const& app_id, std::string const& title) const = 0;
     virtual void advise_new_workspace(WorkspaceCreationData const&&) = 0;
     virtual void advise_workspace_deleted(WorkspaceManager& workspace_manager, uint32_t id) = 0;
     virtual bool advise_workspace_active(WorkspaceManager& workspace_manager, uint32_t id) = 0;
     virtual void advise_application_zone_create(miral::Zone const& application_zone) = 0;
     virtual void advise_application_zone_update(miral::Zone const& updated, miral::Zone const& original) = 0;
     virtual void advise_application_zone_delete(miral::Zone const& application_zone) = 0;
+
+    /// Lays out the workspaces again if the application zones have changed since
+    /// the last call, however many times they changed in between.
+    virtual void apply_application_zones() = 0;
     virtual void move_workspace_to(WorkspaceManager& workspace_manager, WorkspaceInterface* workspace) = 0;
     virtual bool point_is_in_output(int x, int y) = 0;
     virtual void update_area(geom::Rectangle const& area) = 0;
@@ -84,8 +92,27 @@ public:
     virtual void set_defunct() = 0;
     virtual void unset_defunct() = 0;
 
+    /// Shows every workspace of the output at once, scaled down into a grid,
+    /// or returns to the active workspace.
+    virtual void set_overview(bool enabled) = 0;
+
+    /// Starts dragging the workspaces sideways. The workspaces beside the active one
+    /// are shown right away, so that they have drawn by the time they come into view.
+    virtual void begin_swipe() = 0;
+
+    /// Draws the workspaces [offset] pixels away from the active one, toward the
+    /// next workspace when positive.
+    virtual void swipe(float offset) = 0;
+
+    /// Stops dragging the workspaces. If [switches] is false, they return to the
+    /// active workspace. Otherwise, the next workspace switch starts out from where
+    /// the swipe left off at [velocity] pixels per second.
+    virtual void end_swipe(float velocity, bool switches) = 0;
+
     // Getters
-    [[nodiscard]] virtual std::vector<miral::Window> collect_all_windows() const = 0;
+    /// Calls [f] with each window on each workspace of the output until it returns
+    /// true. Returns whether [f] returned true.
+    virtual bool for_each_window(FunctionRef<bool(std::shared_ptr<Container> const&)> f) const = 0;
     [[nodiscard]] virtual WorkspaceInterface* active() const = 0;
     [[nodiscard]] virtual std::vector<std::shared_ptr<WorkspaceInterface>> const& get_workspaces() const = 0;
     [[nodiscard]] virtual geom::Rectangle const& get_area() const = 0;
@@ -93,10 +120,21 @@ public:
     [[nodiscard]] virtual int id() const = 0;
     [[nodiscard]] virtual std::string const& name() const = 0;
     [[nodiscard]] virtual bool is_defunct() const = 0;
+    [[nodiscard]] virtual bool is_showing_overview() const = 0;
+
+    /// The workspace drawn beneath [point] while the overview is shown.
+    [[nodiscard]] virtual std::optional<uint32_t> overview_workspace_at(geom::Point const& point) const = 0;
     [[nodiscard]] virtual glm::mat4 get_transform() const = 0;
     [[nodiscard]] virtual geom::Rectangle get_workspace_rectangle(size_t i) const = 0;
+
+    /// The transform shared by every window on the [i]th workspace, which combines
+    /// the transform of the output with the position of the workspace.
+    [[nodiscard]] virtual glm::mat4 get_workspace_transform(size_t i) const = 0;
     [[nodiscard]] virtual WorkspaceInterface const* workspace(uint32_t id) const = 0;
+    /// Returns the result of [write_json] as a document.
     [[nodiscard]] virtual nlohmann::json to_json(bool is_focused) const = 0;
+    /// Writes this output as a node of the i3 tree.
+    virtual void write_json(JsonWriter& writer, bool is_focused) const = 0;
 };
 
 }
@@ -46,6 +46,8 @@ OutputInterface* OutputManager::create(
     if (focused_ == nullptr)
         focus(outputs_.back()->id());
 
+    areas[outputs_.back().get()] = area;
+    update_output_index();
     return outputs_.back().get();
 }
 
@@ -56,6 +58,8 @@ void OutputManager::update(int id, mir::geometry::Rectangle area)
         if (output->id() == id)
         {
             output->update_area(area);
+            areas[output.get()] = area;
+            update_output_index();
             return;
         }
     }
@@ -79,7 +83,8 @@ bool OutputManager::remove(int id, WorkspaceManager& workspace_manager)
         else
         {
             // Find the workspace ids
-            std::vector<size_t> workspaces(output->get_workspaces().size());
+            std::vector<uint32_t> workspaces;
+            workspaces.reserve(output->get_workspaces().size());
             for (auto const& workspace : output->get_workspaces())
                 workspaces.push_back(workspace->id());
 
@@ -93,7 +98,9 @@ bool OutputManager::remove(int id, WorkspaceManager& workspace_manager)
                 workspace_manager.move_workspace_to_output(workspace_id, next_it->get());
 
             focus(next_it->get()->id());
+            areas.erase(it->get());
             outputs_.erase(it);
+            update_output_index();
         }
         return true;
     }
@@ -135,4 +142,22 @@ bool OutputManager::unfocus(int id)
 OutputInterface* OutputManager::focused()
 {
     return focused_;
-}
\ No newline at end of file
+}
+
+OutputInterface* OutputManager::output_at(mir::geometry::Point const& point) const
+{
+    auto const found = output_index.find(point);
+    return found ? *found : nullptr;
+}
+
+void OutputManager::update_output_index()
+{
+    std::vector<RectangleIndex<OutputInterface*>::Entry> entries;
+    for (auto const& output : outputs_)
+    {
+        if (auto const it = areas.find(output.get()); it != areas.end())
+            entries.push_back({ it->second, output.get() });
+    }
+
+    output_index.build(std::move(entries));
+}
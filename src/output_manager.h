@@ -19,9 +19,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIRACLE_WM_OUTPUT_MANAGER_H
 
 #include "output_factory_interface.h"
+#include "rectangle_index.h"
 
 #include <memory>
 #include <mir/geometry/rectangle.h>
+#include <unordered_map>
 #include <vector>
 
 namespace miracle
@@ -47,10 +49,17 @@ public:
     bool unfocus(int id);
     OutputInterface* focused();
 
+    /// Returns the output that contains [point], or nullptr if no output does.
+    [[nodiscard]] OutputInterface* output_at(mir::geometry::Point const& point) const;
+
 private:
     std::unique_ptr<OutputFactoryInterface> output_factory;
     std::vector<std::unique_ptr<OutputInterface>> outputs_;
     OutputInterface* focused_ = nullptr;
+    std::unordered_map<OutputInterface const*, mir::geometry::Rectangle> areas;
+    RectangleIndex<OutputInterface*> output_index;
+
+    void update_output_index();
 };
 
 }
@@ -0,0 +1,64 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "overview_layout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace miracle;
+namespace geom = mir::geometry;
+
+std::vector<OverviewCell> miracle::layout_overview(geom::Rectangle const& output_area, size_t count, int gap)
+{
+    std::vector<OverviewCell> cells;
+    if (count == 0)
+        return cells;
+
+    auto const columns = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+    auto const rows = (count + columns - 1) / columns;
+
+    auto const width = static_cast<float>(output_area.size.width.as_int());
+    auto const height = static_cast<float>(output_area.size.height.as_int());
+    auto const cell_width = width / static_cast<float>(columns);
+    auto const cell_height = height / static_cast<float>(rows);
+    auto const scale = std::max(0.f,
+        std::min((cell_width - 2.f * static_cast<float>(gap)) / width, (cell_height - 2.f * static_cast<float>(gap)) / height));
+
+    auto const origin = glm::vec3(output_area.top_left.x.as_int(), output_area.top_left.y.as_int(), 0);
+    cells.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        // Each workspace is centred in its cell
+        auto const column = static_cast<float>(i % columns);
+        auto const row = static_cast<float>(i / columns);
+        auto const x = origin.x + column * cell_width + (cell_width - width * scale) / 2.f;
+        auto const y = origin.y + row * cell_height + (cell_height - height * scale) / 2.f;
+
+        auto transform = glm::translate(glm::mat4(1.f), glm::vec3(x, y, 0));
+        transform = glm::scale(transform, glm::vec3(scale, scale, 1));
+        transform = glm::translate(transform, -origin);
+        cells.push_back({
+            geom::Rectangle {
+                geom::Point { static_cast<int>(std::round(x)), static_cast<int>(std::round(y)) },
+                geom::Size { static_cast<int>(std::round(width * scale)), static_cast<int>(std::round(height * scale)) } },
+            transform });
+    }
+
+    return cells;
+}
@@ -0,0 +1,45 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_OVERVIEW_LAYOUT_H
+#define MIRACLE_WM_OVERVIEW_LAYOUT_H
+
+#include <glm/glm.hpp>
+#include <mir/geometry/rectangle.h>
+#include <vector>
+
+namespace miracle
+{
+
+/// Where a workspace is drawn while the overview is shown.
+struct OverviewCell
+{
+    /// The area of the output that the scaled down workspace covers.
+    mir::geometry::Rectangle area;
+
+    /// Takes the windows of the workspace from where they are laid out on the
+    /// output to [area]. It is used as the transform of the whole workspace.
+    glm::mat4 transform;
+};
+
+/// Arranges [count] workspaces of [output_area] in a grid that fills the output,
+/// keeping the aspect ratio of the output and leaving [gap] pixels around each.
+std::vector<OverviewCell> layout_overview(mir::geometry::Rectangle const& output_area, size_t count, int gap = 24);
+
+} // miracle
+
+#endif // MIRACLE_WM_OVERVIEW_LAYOUT_H
@@ -20,10 +20,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "compositor_state.h"
 #include "config.h"
 #include "container.h"
+#include "layout_solver.h"
 #include "leaf_container.h"
+#include "metrics.h"
 #include "output_interface.h"
 #include "output_manager.h"
+#include "pool_allocator.h"
+#include "tracing.h"
 #include "workspace_interface.h"
+#include <algorithm>
 #include <cmath>
 #include <mir/log.h>
 
@@ -43,45 +48,39 @@ InsertNodeInternalResult insert_node_internal(
     int index,
     size_t node_count,
     std::function<int(int)> const& get_node_size,
+    std::function<int(int)> const& get_node_min_size,
     std::function<void(int, int, int)> const& set_node_size_position)
 {
-    int new_item_size = floor((double)lane_size / (double)(node_count + 1));
-    int new_item_position = lane_pos + index * new_item_size;
+    // The new node takes its even share of the lane, and the other nodes give it
+    // up in proportion to their size.
+    index = std::clamp(index, 0, (int)node_count);
+    int total_size = 0;
+    for (int i = 0; i < node_count; i++)
+        total_size += get_node_size(i);
 
-    int size_lost = 0;
-    int prev_pos = lane_pos;
-    int prev_size = 0;
+    std::vector<double> weights;
+    std::vector<int> minimums;
     for (int i = 0; i < node_count; i++)
     {
-        int node_size = get_node_size(i);
-
-        // Each node will lose a percentage of its width that corresponds to what it can give
-        // (meaning that larger nodes give more width, and lesser nodes give less width)
-        double percent_size_lost = ((double)node_size / (double)lane_size);
-        int width_to_lose = (int)floor(percent_size_lost * new_item_size);
-        size_lost += width_to_lose;
-
-        if (i == index)
-        {
-            prev_size = new_item_size;
-            prev_pos = new_item_position;
-        }
-
-        int changed_node_size = node_size - width_to_lose;
-        int changed_node_pos = prev_pos + prev_size;
-        set_node_size_position(i, changed_node_size, changed_node_pos);
-
-        prev_pos = changed_node_pos;
-        prev_size = changed_node_size;
+        weights.push_back(total_size > 0 ? (double)get_node_size(i) * (double)node_count / (double)total_size : 1);
+        minimums.push_back(get_node_min_size(i));
     }
+    weights.insert(weights.begin() + index, 1);
+    minimums.insert(minimums.begin() + index, 0);
 
-    if (node_count)
+    auto const sizes = distribute_space(lane_size, weights, minimums);
+    InsertNodeInternalResult result { 0, lane_pos };
+    int position = lane_pos;
+    for (int i = 0; i < (int)sizes.size(); i++)
     {
-        new_item_size += size_lost - new_item_size;
-        new_item_position -= size_lost - new_item_size;
+        if (i == index)
+            result = { sizes[i], position };
+        else
+            set_node_size_position(i < index ? i : i - 1, sizes[i], position);
+        position += sizes[i];
     }
 
-    return { new_item_size, new_item_position };
+    return result;
 }
 }
 
@@ -113,8 +112,9 @@ geom::Rectangle ParentContainer::get_logical_area() const
 {
     if (parent.lock() == nullptr)
     {
-        auto x = config->get_outer_gaps_x();
-        auto y = config->get_outer_gaps_y();
+        auto const snapshot = config->snapshot();
+        auto x = snapshot->outer_gaps_x;
+        auto y = snapshot->outer_gaps_y;
 
         auto modified_logical_area = geom::Rectangle(
             geom::Point(logical_area.top_left.x.as_int() + x, logical_area.top_left.y.as_int() + y),
@@ -153,6 +153,8 @@ geom::Rectangle ParentContainer::create_space(int pending_index)
             sub_nodes.size(),
             [&](int index)
         { return sub_nodes[index]->get_logical_area().size.width.as_int(); },
+            [&](int index)
+        { return (int)sub_nodes[index]->get_min_width(); },
             [&](int index, int size, int pos)
         {
             sub_nodes[index]->set_logical_area({
@@ -183,6 +185,8 @@ geom::Rectangle ParentContainer::create_space(int pending_index)
             sub_nodes.size(),
             [&](int index)
         { return sub_nodes[index]->get_logical_area().size.height.as_int(); },
+            [&](int index)
+        { return (int)sub_nodes[index]->get_min_height(); },
             [&](int index, int size, int pos)
         {
             sub_nodes[index]->set_logical_area({
@@ -217,9 +221,9 @@ geom::Rectangle ParentContainer::create_space(int pending_index)
 }
 
 miral::WindowSpecification ParentContainer::place_new_window(
-    miral::WindowSpecification const& requested_specification)
+    miral::WindowSpecification const& requested_specification, int index)
 {
-    auto container = create_space_for_window();
+    auto container = create_space_for_window(index);
     auto rect = container->get_visible_area();
 
     miral::WindowSpecification new_spec = requested_specification;
@@ -239,7 +243,8 @@ std::shared_ptr<LeafContainer> ParentContainer::create_space_for_window(int pend
 {
     if (pending_index < 0)
         pending_index = num_nodes();
-    pending_node = std::make_shared<LeafContainer>(
+    pending_node = std::allocate_shared<LeafContainer>(
+        PoolAllocator<LeafContainer>(),
         workspace,
         window_controller,
         create_space(pending_index),
@@ -285,7 +290,8 @@ std::shared_ptr<ParentContainer> ParentContainer::convert_to_parent(std::shared_
         return nullptr;
     }
 
-    auto new_parent_node = std::make_shared<ParentContainer>(
+    auto new_parent_node = std::allocate_shared<ParentContainer>(
+        PoolAllocator<ParentContainer>(),
         state,
         window_controller,
         config,
@@ -306,108 +312,54 @@ void ParentContainer::set_logical_area(const geom::Rectangle& target_rect, bool
     // neighbor takes up the remaining 600px, horizontally).
     // We need to look at the target dimension and scale everyone relative to that.
     // However, the "non-main-axis" dimension will be consistent across each node.
-    auto current_logical_area = get_logical_area();
     logical_area = target_rect;
     auto target_placement_area = get_logical_area();
-    std::vector<geom::Rectangle> pending_size_updates;
-    pending_size_updates.reserve(sub_nodes.size());
-    if (scheme == LayoutScheme::horizontal)
+    if (scheme == LayoutScheme::horizontal || scheme == LayoutScheme::vertical)
     {
-        int total_width = 0;
-        for (size_t idx = 0; idx < sub_nodes.size(); idx++)
+        std::vector<double> weights;
+        weights.reserve(sub_nodes.size());
+        for (auto const& node : sub_nodes)
         {
-            auto item = sub_nodes[idx];
-            auto item_rect = item->get_logical_area();
-            double percent_width_taken = (double)item_rect.size.width.as_int() / (double)current_logical_area.size.width.as_int();
-            int new_width = (int)ceil((double)target_placement_area.size.width.as_int() * percent_width_taken);
-
-            geom::Rectangle new_item_rect;
-            new_item_rect.size = geom::Size {
-                geom::Width { new_width },
-                target_placement_area.size.height
-            };
-            if (idx == 0)
-            {
-                new_item_rect.top_left = geom::Point {
-                    target_placement_area.top_left.x,
-                    target_placement_area.top_left.y
-                };
-            }
-            else
-            {
-                auto const& prev_rect = pending_size_updates[idx - 1];
-                new_item_rect.top_left = geom::Point {
-                    geom::X { prev_rect.top_left.x.as_int() + prev_rect.size.width.as_int() },
-                    target_placement_area.top_left.y
-                };
-            }
-
-            pending_size_updates.push_back(new_item_rect);
-            total_width += new_width;
+            auto const size = node->get_logical_area().size;
+            weights.push_back(scheme == LayoutScheme::horizontal ? size.width.as_int() : size.height.as_int());
         }
 
-        if (!pending_size_updates.empty())
-        {
-            int leftover_width = target_placement_area.size.width.as_int() - total_width;
-            pending_size_updates.back().size.width = geom::Width { pending_size_updates.back().size.width.as_int() + leftover_width };
-        }
-    }
-    else if (scheme == LayoutScheme::vertical)
-    {
-        int total_height = 0;
-        for (size_t idx = 0; idx < sub_nodes.size(); idx++)
-        {
-            auto item = sub_nodes[idx];
-            auto item_rect = item->get_logical_area();
-            double percent_height_taken = static_cast<double>(item_rect.size.height.as_int()) / current_logical_area.size.height.as_int();
-            int new_height = (int)floor((double)target_placement_area.size.height.as_int() * percent_height_taken);
-
-            geom::Rectangle new_item_rect;
-            new_item_rect.size = geom::Size {
-                target_placement_area.size.width,
-                geom::Height { new_height },
-            };
-            if (idx == 0)
-            {
-                new_item_rect.top_left = geom::Point {
-                    target_placement_area.top_left.x,
-                    target_placement_area.top_left.y
-                };
-            }
-            else
-            {
-                auto const& prev_rect = pending_size_updates[idx - 1];
-                new_item_rect.top_left = geom::Point {
-                    target_placement_area.top_left.x,
-                    geom::Y { prev_rect.top_left.y.as_int() + prev_rect.size.height.as_int() },
-                };
-            }
-
-            pending_size_updates.push_back(new_item_rect);
-            total_height += new_height;
-        }
-
-        if (!pending_size_updates.empty())
-        {
-            int leftover_height = target_placement_area.size.height.as_int() - total_height;
-            pending_size_updates.back().size.height = geom::Height { pending_size_updates.back().size.height.as_int() + leftover_height };
-        }
+        place_nodes(target_placement_area, weights, with_animations);
     }
     else if (scheme == LayoutScheme::tabbing || scheme == LayoutScheme::stacking)
     {
-        for (size_t idx = 0; idx < sub_nodes.size(); idx++)
+        auto const active = active_tab();
+        for (auto const& node : sub_nodes)
         {
-            pending_size_updates.push_back(target_placement_area);
+            if (active == nullptr || node == active)
+                node->set_logical_area(target_placement_area, with_animations);
         }
     }
     else
     {
         mir::log_error("Cannot set_logical_area with invalid scheme");
     }
+}
+
+void ParentContainer::place_nodes(geom::Rectangle const& area, std::vector<double> const& weights, bool with_animations)
+{
+    bool const is_horizontal = scheme == LayoutScheme::horizontal;
+    std::vector<int> minimums;
+    minimums.reserve(sub_nodes.size());
+    for (auto const& node : sub_nodes)
+        minimums.push_back((int)(is_horizontal ? node->get_min_width() : node->get_min_height()));
 
+    auto const sizes = distribute_space(
+        is_horizontal ? area.size.width.as_int() : area.size.height.as_int(), weights, minimums);
+
+    int position = is_horizontal ? area.top_left.x.as_int() : area.top_left.y.as_int();
     for (size_t i = 0; i < sub_nodes.size(); i++)
     {
-        sub_nodes[i]->set_logical_area(pending_size_updates[i], with_animations);
+        geom::Rectangle const rectangle = is_horizontal
+            ? geom::Rectangle { geom::Point { position, area.top_left.y.as_int() }, geom::Size { sizes[i], area.size.height.as_int() } }
+            : geom::Rectangle { geom::Point { area.top_left.x.as_int(), position }, geom::Size { area.size.width.as_int(), sizes[i] } };
+        sub_nodes[i]->set_logical_area(rectangle, with_animations);
+        position += sizes[i];
     }
 }
 
@@ -437,9 +389,9 @@ std::shared_ptr<LeafContainer> ParentContainer::get_nth_window(size_t i) const
     return as_parent(sub_nodes[i])->get_nth_window(0);
 }
 
-std::shared_ptr<Container> ParentContainer::find_where(std::function<bool(std::shared_ptr<Container> const&)> func) const
+std::shared_ptr<Container> ParentContainer::find_where(std::function<bool(std::shared_ptr<Container> const&)> const& func) const
 {
-    for (auto node : sub_nodes)
+    for (auto const& node : sub_nodes)
         if (func(node))
             return node;
 
@@ -466,7 +418,18 @@ void ParentContainer::swap_nodes(std::shared_ptr<Container> const& first, std::s
     auto second_index = get_index_of_node(second);
     sub_nodes[second_index] = first;
     sub_nodes[first_index] = second;
-    relayout();
+
+    // The two nodes trade their areas, so that the nodes between them stay where
+    // they are and are neither laid out nor animated again
+    if (scheme == LayoutScheme::horizontal || scheme == LayoutScheme::vertical)
+    {
+        auto const first_area = first->get_logical_area();
+        first->set_logical_area(second->get_logical_area());
+        second->set_logical_area(first_area);
+        state->layout_changed();
+    }
+    else
+        relayout();
     constrain();
 }
 
@@ -511,7 +474,7 @@ int ParentContainer::get_index_of_node(std::shared_ptr<Container> const& node) c
 
 int ParentContainer::get_index_of_node(Container const& node) const
 {
-    return get_index_of_node(node.shared_from_this().get());
+    return get_index_of_node(&node);
 }
 
 void ParentContainer::constrain()
@@ -548,47 +511,48 @@ void ParentContainer::set_parent(std::shared_ptr<ParentContainer> const& in_pare
 
 void ParentContainer::relayout()
 {
+    if (state->defer_relayout(as_parent(shared_from_this())))
+        return;
+
+    MIRACLE_TRACE_SCOPE("ParentContainer::relayout");
+    Metrics::instance().increment(MetricCounter::relayouts);
+    MetricTimer timer(MetricHistogram::relayout_time);
+
+    // The arrangement of the nodes may change without any of their areas doing
+    // so, as when switching between tabbing and stacking.
+    state->layout_changed();
     auto placement_area = get_logical_area();
-    if (scheme == LayoutScheme::horizontal)
+    if (scheme == LayoutScheme::horizontal || scheme == LayoutScheme::vertical)
     {
-        int total_width = 0;
+        // Whatever space the nodes are missing, or have too much of, is shared evenly
+        bool const is_horizontal = scheme == LayoutScheme::horizontal;
+        int total_size = 0;
         for (auto const& node : sub_nodes)
         {
-            total_width += node->get_logical_area().size.width.as_int();
+            auto const size = node->get_logical_area().size;
+            total_size += is_horizontal ? size.width.as_int() : size.height.as_int();
         }
 
-        int diff_width = placement_area.size.width.as_value() - total_width;
-        int diff_per_node = floor((double)diff_width / (double)sub_nodes.size());
-        for (auto const& node : sub_nodes)
-        {
-            auto rectangle = node->get_logical_area();
-            rectangle.size.width = geom::Width { rectangle.size.width.as_int() + diff_per_node };
-            rectangle.size.height = geom::Height { placement_area.size.height };
-            node->set_logical_area(rectangle);
-        }
-    }
-    else if (scheme == LayoutScheme::vertical)
-    {
-        int total_height = 0;
+        int const lane_size = is_horizontal ? placement_area.size.width.as_int() : placement_area.size.height.as_int();
+        double const diff_per_node = (double)(lane_size - total_size) / (double)sub_nodes.size();
+        std::vector<double> weights;
+        weights.reserve(sub_nodes.size());
         for (auto const& node : sub_nodes)
         {
-            total_height += node->get_logical_area().size.height.as_int();
+            auto const size = node->get_logical_area().size;
+            weights.push_back(std::max(0.0, (is_horizontal ? size.width.as_int() : size.height.as_int()) + diff_per_node));
         }
 
-        int diff_width = placement_area.size.height.as_value() - total_height;
-        int diff_per_node = floor((double)diff_width / (double)sub_nodes.size());
-        for (auto const& node : sub_nodes)
-        {
-            auto rectangle = node->get_logical_area();
-            rectangle.size.width = geom::Width { placement_area.size.width };
-            rectangle.size.height = geom::Height { rectangle.size.height.as_int() + diff_per_node };
-            node->set_logical_area(rectangle);
-        }
+        place_nodes(placement_area, weights, true);
     }
     else if (scheme == LayoutScheme::tabbing || scheme == LayoutScheme::stacking)
     {
+        auto const active = active_tab();
         for (auto const& node : sub_nodes)
-            node->set_logical_area(placement_area);
+        {
+            if (active == nullptr || node == active)
+                node->set_logical_area(placement_area);
+        }
     }
     else
     {
@@ -648,12 +612,14 @@ void ParentContainer::request_horizontal_layout()
 {
     scheme = LayoutScheme::horizontal;
     relayout();
+    refresh_tab_visibility();
 }
 
 void ParentContainer::request_vertical_layout()
 {
     scheme = LayoutScheme::vertical;
     relayout();
+    refresh_tab_visibility();
 }
 
 void ParentContainer::toggle_layout(bool cycle_thru_all)
@@ -669,17 +635,72 @@ void ParentContainer::toggle_layout(bool cycle_thru_all)
     }
 
     relayout();
+    refresh_tab_visibility();
 }
 
 void ParentContainer::on_focus_gained()
 {
     if (scheme == LayoutScheme::tabbing || scheme == LayoutScheme::stacking)
     {
+        auto const focused = node_containing(state->focused_container());
         for (auto const& container : sub_nodes)
         {
-            if (container != state->focused_container() && container->window())
+            if (container != focused && container->window())
                 window_controller->send_to_back(container->window().value());
         }
+
+        // The newly selected tab may have missed resizes while it was hidden.
+        auto const previous = selected_tab.lock();
+        selected_tab = focused;
+        if (focused && focused != previous)
+        {
+            focused->set_logical_area(get_logical_area());
+            focused->commit_changes();
+            refresh_tab_visibility();
+        }
+    }
+
+    // Tabs that are further up the tree may hold the focused container too.
+    if (auto const sh_parent = parent.lock())
+        sh_parent->on_focus_gained();
+}
+
+std::shared_ptr<Container> ParentContainer::active_tab() const
+{
+    if (scheme != LayoutScheme::tabbing && scheme != LayoutScheme::stacking)
+        return nullptr;
+
+    if (auto const tab = selected_tab.lock(); tab && std::ranges::find(sub_nodes, tab) != sub_nodes.end())
+        return tab;
+
+    return node_containing(state->focused_container());
+}
+
+std::shared_ptr<Container> ParentContainer::node_containing(std::shared_ptr<Container> container) const
+{
+    while (container)
+    {
+        auto container_parent = container->get_parent().lock();
+        if (container_parent.get() == this)
+            return container;
+        container = std::move(container_parent);
+    }
+
+    return nullptr;
+}
+
+void ParentContainer::refresh_tab_visibility()
+{
+    for (auto const& node : sub_nodes)
+    {
+        if (auto const parent_node = Container::as_parent(node))
+            parent_node->refresh_tab_visibility();
+        else
+        {
+            state->render_data_manager()->tab_change(*node);
+            if (auto const window = node->window())
+                window_controller->set_occluded(window.value(), node->is_hidden_tab());
+        }
     }
 }
 
@@ -855,6 +876,7 @@ bool ParentContainer::toggle_tabbing()
         scheme = LayoutScheme::tabbing;
 
     relayout();
+    refresh_tab_visibility();
     return true;
 }
 
@@ -866,6 +888,7 @@ bool ParentContainer::toggle_stacking()
         scheme = LayoutScheme::stacking;
 
     relayout();
+    refresh_tab_visibility();
     return true;
 }
 
@@ -875,6 +898,7 @@ bool ParentContainer::set_layout(LayoutScheme new_scheme)
     relayout();
     constrain();
     commit_changes();
+    refresh_tab_visibility();
     return true;
 }
 
@@ -913,71 +937,86 @@ void ParentContainer::scratchpad_state(ScratchpadState next_scratchpad_state)
     scratchpad_state_ = next_scratchpad_state;
 }
 
-nlohmann::json ParentContainer::to_json(bool is_workspace_visible) const
+ParentContainer::JsonKey ParentContainer::json_key(bool is_workspace_visible) const
 {
-    auto const visible_area = get_visible_area();
-    auto const logical_area = get_logical_area();
-    nlohmann::json containers_json;
-    for (auto const& container : sub_nodes)
-
-        containers_json.push_back(container->to_json(is_workspace_visible));
-    auto workspace = get_workspace();
-    auto output = get_output();
-    auto locked_parent = parent.lock();
-    bool visible = true;
+    bool const visible = is_workspace_visible && parent.lock() != nullptr;
+    return {
+        .logical_area = get_logical_area(),
+        .visible_area = get_visible_area(),
+        .visible = visible,
+        .focused = visible && is_focused(),
+        .fullscreen = is_fullscreen(),
+        .percent = get_percent_of_parent(),
+        .scheme = scheme
+    };
+}
 
-    if (!is_workspace_visible)
-        visible = false;
+void ParentContainer::write_json(JsonWriter& writer, bool is_workspace_visible) const
+{
+    writer.begin_object();
+    writer.fields(json_cache.get(json_key(is_workspace_visible), [this](JsonKey const& key)
+    {
+        std::string serialized;
+        JsonWriter key_writer(serialized);
+        write_key(key_writer, key);
+        return serialized;
+    }));
 
-    if (locked_parent == nullptr)
-        visible = false;
+    writer.key("nodes").begin_array();
+    for (auto const& container : sub_nodes)
+        container->write_json(writer, is_workspace_visible);
+    writer.end_array().end_object();
+}
 
+void ParentContainer::write_key(JsonWriter& writer, JsonKey const& key) const
+{
+    auto const& logical_area = key.logical_area;
+    geom::Rectangle const local_area { geom::Point { 0, 0 }, logical_area.size };
     auto const id = reinterpret_cast<std::uintptr_t>(this);
-    return {
-        { "id",                   id                                                                                                                                                                                                                                                 },
-        { "name",                 "Parent #" + std::to_string(id)                                                                                                                                                                                                                    },
-        { "rect",                 {
-                      { "x", logical_area.top_left.x.as_int() },
-                      { "y", logical_area.top_left.y.as_int() },
-                      { "width", logical_area.size.width.as_int() },
-                      { "height", logical_area.size.height.as_int() },
-                  }                                                                                                                                                                                                                                                 },
-        { "focused",              visible && is_focused()                                                                                                                                                                                                                            },
-        { "focus",                std::vector<int>()                                                                                                                                                                                                                                 },
-        { "border",               "none"                                                                                                                                                                                                                                             },
-        { "current_border_width", 0                                                                                                                                                                                                                                                  },
-        { "layout",               to_string(scheme)                                                                                                                                                                                                                                  },
-        { "orientation",          "none"                                                                                                                                                                                                                                             },
-        { "percent",              get_percent_of_parent()                                                                                                                                                                                                                            },
-        { "window_rect",          {
-                                                                                                                                                                                                                                                               { "x", visible_area.top_left.x.as_int() },
-                                                                                                                                                                                                                                                               { "y", visible_area.top_left.y.as_int() },
-                                                                                                                                                                                                                                                               { "width", visible_area.size.width.as_int() },
-                                                                                                                                                                                                                                                               { "height", visible_area.size.height.as_int() },
-                                                                                                                                                                                                                                                           } },
-        { "deco_rect",            {
-                           { "x", 0 },
-                           { "y", 0 },
-                           { "width", logical_area.size.width.as_int() },
-                           { "height", logical_area.size.height.as_int() },
-                       }                                                                                                                                                                                                                                       },
-        { "geometry",             {
-                          { "x", 0 },
-                          { "y", 0 },
-                          { "width", logical_area.size.width.as_int() },
-                          { "height", logical_area.size.height.as_int() },
-                      }                                                                                                                                                                                                                                         },
-        { "window",               0                                                                                                                                                                                                                                                  }, // TODO
-        { "urgent",               false                                                                                                                                                                                                                                              },
-        { "floating_nodes",       std::vector<int>()                                                                                                                                                                                                                                 },
-        { "sticky",               false                                                                                                                                                                                                                                              },
-        { "type",                 "con"                                                                                                                                                                                                                                              },
-        { "fullscreen_mode",      is_fullscreen() ? 1 : 0                                                                                                                                                                                                                            }, // TODO: Support value 2
-        { "visible",              visible                                                                                                                                                                                                                                            },
-        { "shell",                "miracle-wm"                                                                                                                                                                                                                                       }, // TODO
-        { "inhibit_idle",         false                                                                                                                                                                                                                                              },
-        { "idle_inhibitors",      {}                                                                                                                                                                                                                                                 },
-        { "window_properties",    {}                                                                                                                                                                                                                                                 }, // TODO
-        { "nodes",                containers_json                                                                                                                                                                                                                                    }
-    };
+    writer.key("id")
+        .value(id)
+        .key("name")
+        .value("Parent #" + std::to_string(id))
+        .rect("rect", logical_area)
+        .key("focused")
+        .value(key.focused)
+        .key("focus")
+        .begin_array()
+        .end_array()
+        .key("border")
+        .value("none")
+        .key("current_border_width")
+        .value(0)
+        .key("layout")
+        .value(to_string(key.scheme))
+        .key("orientation")
+        .value("none")
+        .key("percent")
+        .value(key.percent)
+        .rect("window_rect", key.visible_area)
+        .rect("deco_rect", local_area)
+        .rect("geometry", local_area)
+        .key("window")
+        .value(0) // TODO
+        .key("urgent")
+        .value(false)
+        .key("floating_nodes")
+        .begin_array()
+        .end_array()
+        .key("sticky")
+        .value(false)
+        .key("type")
+        .value("con")
+        .key("fullscreen_mode")
+        .value(key.fullscreen ? 1 : 0) // TODO: Support value 2
+        .key("visible")
+        .value(key.visible)
+        .key("shell")
+        .value("miracle-wm") // TODO
+        .key("inhibit_idle")
+        .value(false)
+        .key("idle_inhibitors")
+        .null()
+        .key("window_properties")
+        .null(); // TODO
 }
@@ -19,7 +19,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIRACLEWM_PARENT_NODE_H
 
 #include "container.h"
+#include "json_fragment.h"
 #include "layout_scheme.h"
+#include "memory_accounting.h"
 #include "miral/window_specification.h"
 #include "window_controller.h"
 #include <mir/geometry/rectangle.h>
@@ -51,7 +53,7 @@ public:
     geom::Rectangle get_visible_area() const override;
     virtual size_t num_nodes() const;
     miral::WindowSpecification place_new_window(
-        miral::WindowSpecification const& requested_specification);
+        miral::WindowSpecification const& requested_specification, int index = -1);
     std::shared_ptr<LeafContainer> create_space_for_window(int index = -1);
     std::shared_ptr<LeafContainer> confirm_window(miral::Window const&);
     void graft_existing(std::shared_ptr<Container> const& node, int index);
@@ -62,7 +64,7 @@ public:
     void commit_changes() override;
     std::shared_ptr<Container> at(size_t i) const;
     std::shared_ptr<LeafContainer> get_nth_window(size_t i) const;
-    std::shared_ptr<Container> find_where(std::function<bool(std::shared_ptr<Container> const&)> func) const;
+    std::shared_ptr<Container> find_where(std::function<bool(std::shared_ptr<Container> const&)> const& func) const;
     LayoutScheme get_direction() { return scheme; }
     std::vector<std::shared_ptr<Container>> const& get_sub_nodes() const;
     [[nodiscard]] int get_index_of_node(Container const* node) const;
@@ -124,10 +126,33 @@ public:
     ScratchpadState scratchpad_state() const override;
     void scratchpad_state(ScratchpadState) override;
     LayoutScheme get_layout() const override;
-    nlohmann::json to_json(bool is_workspace_visible) const override;
+    void write_json(JsonWriter& writer, bool is_workspace_visible) const override;
     [[nodiscard]] LayoutScheme get_scheme() const { return scheme; }
 
+    /// Fits the nodes of this container to its logical area. While a batch is open
+    /// on [CompositorState], this happens once, when the batch is closed.
+    void relayout();
+
+    /// In a tabbing or stacking layout, the node that is shown. Only this node is
+    /// kept at the size of the container; the others are resized once they are
+    /// selected. Returns nullptr for any other layout, or if no node is selected.
+    [[nodiscard]] std::shared_ptr<Container> active_tab() const;
+
 private:
+    /// Everything that the JSON of the container, less its nodes, is built from.
+    struct JsonKey
+    {
+        geom::Rectangle logical_area;
+        geom::Rectangle visible_area;
+        bool visible;
+        bool focused;
+        bool fullscreen;
+        float percent;
+        LayoutScheme scheme;
+
+        bool operator==(JsonKey const&) const = default;
+    };
+
     std::shared_ptr<CompositorState> state;
     std::shared_ptr<WindowController> window_controller;
     std::shared_ptr<Config> config;
@@ -141,9 +166,25 @@ private:
     LayoutScheme scheme = LayoutScheme::horizontal;
     std::vector<std::shared_ptr<Container>> sub_nodes;
     std::shared_ptr<LeafContainer> pending_node;
+    std::weak_ptr<Container> selected_tab;
+
+    /// The fields of the JSON of the container, less its nodes.
+    mutable JsonFragmentCache<JsonKey> json_cache;
+    MemoryCharge memory { MemorySubsystem::containers, sizeof(ParentContainer) };
 
     geom::Rectangle create_space(int pending_index);
-    void relayout();
+
+    /// Returns the node of this container that holds [container], if any.
+    [[nodiscard]] std::shared_ptr<Container> node_containing(std::shared_ptr<Container> container) const;
+    /// Informs the renderer of which windows in this container are hidden tabs.
+    void refresh_tab_visibility();
+
+    /// Lays the nodes out one after another along the axis of the scheme, sharing
+    /// [area] between them by [weights].
+    void place_nodes(geom::Rectangle const& area, std::vector<double> const& weights, bool with_animations);
+    [[nodiscard]] JsonKey json_key(bool is_workspace_visible) const;
+    /// Writes the fields of the JSON of the container, less its nodes.
+    void write_key(JsonWriter& writer, JsonKey const& key) const;
 };
 
 } // miracle
@@ -0,0 +1,114 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_PERFECT_HASH_H
+#define MIRACLE_WM_PERFECT_HASH_H
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace miracle
+{
+
+/// A map from a fixed set of strings to values that is built at compile time.
+///
+/// A seed is searched for that hashes every key into a slot of its own, so that
+/// a lookup is one hash and one string comparison.
+template <typename T, size_t N>
+class PerfectHashMap
+{
+public:
+    struct Entry
+    {
+        std::string_view key;
+        T value;
+    };
+
+    consteval explicit PerfectHashMap(Entry const (&in_entries)[N])
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            if (in_entries[i].key.empty())
+                throw "PerfectHashMap: keys may not be empty";
+            entries[i] = in_entries[i];
+        }
+
+        for (seed = 0;; seed++)
+        {
+            if (try_seed())
+                return;
+        }
+    }
+
+    [[nodiscard]] constexpr std::optional<T> find(std::string_view key) const
+    {
+        auto const slot = slots[hash(key, seed) & (table_size - 1)];
+        if (slot == 0 || entries[slot - 1].key != key)
+            return std::nullopt;
+
+        return entries[slot - 1].value;
+    }
+
+private:
+    static constexpr size_t table_size = std::bit_ceil(N * 4);
+
+    /// FNV-1a, starting from [seed].
+    static constexpr uint32_t hash(std::string_view key, uint32_t seed)
+    {
+        uint32_t h = 2166136261u ^ (seed * 16777619u);
+        for (char c : key)
+        {
+            h ^= static_cast<uint8_t>(c);
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    constexpr bool try_seed()
+    {
+        slots = {};
+        for (size_t i = 0; i < N; i++)
+        {
+            auto& slot = slots[hash(entries[i].key, seed) & (table_size - 1)];
+            if (slot != 0)
+            {
+                // Two identical keys can never be separated.
+                if (entries[slot - 1].key == entries[i].key)
+                    throw "PerfectHashMap: keys must be unique";
+                return false;
+            }
+
+            slot = static_cast<uint8_t>(i + 1);
+        }
+
+        return true;
+    }
+
+    static_assert(N < 255, "PerfectHashMap holds at most 254 entries");
+
+    std::array<Entry, N> entries {};
+    std::array<uint8_t, table_size> slots {};
+    uint32_t seed = 0;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_PERFECT_HASH_H
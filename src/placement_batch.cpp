@@ -0,0 +1,83 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#define MIR_LOG_COMPONENT "placement_batch"
+
+#include "placement_batch.h"
+#include "compositor_state.h"
+
+#include <algorithm>
+#include <mir/log.h>
+#include <mir/time/alarm.h>
+#include <mir/time/alarm_factory.h>
+
+using namespace miracle;
+
+PlacementBatch::PlacementBatch(
+    std::shared_ptr<CompositorState> const& state,
+    WindowManagerMutex& mutex,
+    std::shared_ptr<mir::time::AlarmFactory> const& alarms) :
+    state { state },
+    mutex { mutex },
+    alarm { alarms->create_alarm([this]()
+    { close(); }) }
+{
+}
+
+PlacementBatch::~PlacementBatch()
+{
+    alarm->cancel();
+}
+
+void PlacementBatch::open()
+{
+    std::lock_guard lock(mutex);
+    if (!opened_at)
+    {
+        mir::log_info("Opening a placement batch");
+        opened_at = std::chrono::steady_clock::now();
+        state->begin_batch();
+    }
+
+    schedule();
+}
+
+void PlacementBatch::close()
+{
+    std::lock_guard lock(mutex);
+    if (!opened_at)
+        return;
+
+    alarm->cancel();
+    opened_at.reset();
+    state->end_batch();
+    mir::log_info("Closed the placement batch");
+}
+
+void PlacementBatch::advise_window_placed()
+{
+    std::lock_guard lock(mutex);
+    if (opened_at)
+        schedule();
+}
+
+void PlacementBatch::schedule()
+{
+    auto const elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - opened_at.value());
+    alarm->reschedule_in(std::clamp(longest - elapsed, std::chrono::milliseconds::zero(), quiet_period));
+}
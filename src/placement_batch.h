@@ -0,0 +1,77 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_PLACEMENT_BATCH_H
+#define MIRACLE_WM_PLACEMENT_BATCH_H
+
+#include "window_manager_mutex.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+namespace mir::time
+{
+class Alarm;
+class AlarmFactory;
+}
+
+namespace miracle
+{
+class CompositorState;
+
+/// Holds a batch open on [CompositorState] while many windows are placed at
+/// once, such as when a session is restored. The siblings of each new window
+/// are resized once when the batch is closed instead of once per window.
+///
+/// The batch closes itself once no window has been placed for [quiet_period],
+/// or once it has been open for [longest], so that a client that never closes
+/// it cannot freeze the layout.
+class PlacementBatch
+{
+public:
+    static constexpr std::chrono::milliseconds quiet_period { 500 };
+    static constexpr std::chrono::milliseconds longest { 5000 };
+
+    PlacementBatch(
+        std::shared_ptr<CompositorState> const& state,
+        WindowManagerMutex& mutex,
+        std::shared_ptr<mir::time::AlarmFactory> const& alarms);
+    ~PlacementBatch();
+
+    /// Opens the batch, or restarts the quiet period if it is already open.
+    /// These take [mutex], which is held by the window manager.
+    void open();
+    void close();
+
+    /// Restarts the quiet period of an open batch.
+    void advise_window_placed();
+
+
+private:
+    void schedule();
+
+    std::shared_ptr<CompositorState> state;
+    WindowManagerMutex& mutex;
+    std::unique_ptr<mir::time::Alarm> alarm;
+    std::optional<std::chrono::steady_clock::time_point> opened_at;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_PLACEMENT_BATCH_H
@@ -22,34 +22,55 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "config.h"
 #include "constants.h"
 #include "container_group_container.h"
+#include "event_recording.h"
 #include "feature_flags.h"
+#include "metrics.h"
 #include "output_factory.h"
 #include "output_manager.h"
 #include "parent_container.h"
+#include "render_data_manager.h"
 #include "shell_component_container.h"
+#include "startup_profile.h"
+#include "tracing.h"
 #include "workspace_manager.h"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <mir/geometry/rectangle.h>
 #include <mir/log.h>
+#include <mir/scene/session_lock.h>
 #include <mir/server.h>
+#include <mir/server_action_queue.h>
+#include <mir/time/alarm.h>
+#include <mir/time/alarm_factory.h>
 #include <mir_toolkit/events/enums.h>
+#include <miral/application.h>
 #include <miral/application_info.h>
 #include <miral/runner.h>
 #include <miral/toolkit_event.h>
 #include <miral/window_specification.h>
 #include <miral/zone.h>
 #include <mutex>
+#include <utility>
 
 using namespace miracle;
 
 namespace
 {
+/// The pixels that the workspaces move for each unit of sideways scrolling.
+constexpr float WORKSPACE_SWIPE_PIXELS_PER_SCROLL = 10.f;
+
+/// A swipe ends once no scrolling has come in for this long, which is when the
+/// fingers have been lifted without the touchpad saying so.
+constexpr auto WORKSPACE_SWIPE_IDLE_TIME = std::chrono::milliseconds(150);
+
 class MirRunnerCommandControllerInterface : public CommandControllerInterface
 {
 public:
-    explicit MirRunnerCommandControllerInterface(miral::MirRunner& runner) :
-        runner { runner }
+    MirRunnerCommandControllerInterface(miral::MirRunner& runner, miral::WindowManagerTools const& tools) :
+        runner { runner },
+        tools { tools }
     {
     }
 
@@ -58,9 +79,31 @@ public:
         runner.stop();
     }
 
+    void invoke_under_lock(std::function<void()> const& f) override
+    {
+        tools.invoke_under_lock(f);
+    }
+
 private:
     miral::MirRunner& runner;
+    miral::WindowManagerTools tools;
 };
+
+void record_output_event(RecordedOutputChange change, miral::Output const& output)
+{
+    if (auto& recorder = EventRecorder::instance(); recorder.is_recording())
+        recorder.record(RecordedOutputEvent { change, output.id(), output.name(), output.extents() });
+}
+
+/// Returns the time at which [event] arrived. Mir stamps input events with the
+/// monotonic clock, which is the clock of [std::chrono::steady_clock].
+std::chrono::steady_clock::time_point arrival_time(MirInputEvent const* event)
+{
+    auto const now = std::chrono::steady_clock::now();
+    auto const time = std::chrono::steady_clock::time_point(
+        std::chrono::nanoseconds(miral::toolkit::mir_input_event_get_event_time(event)));
+    return time > now || time.time_since_epoch().count() == 0 ? now : time;
+}
 }
 
 class Policy::Self : public WorkspaceObserver
@@ -97,7 +140,39 @@ public:
     }
 
     Policy& policy;
-    std::recursive_mutex mutex;
+    WindowManagerMutex mutex;
+};
+
+class Policy::SessionLockObserver : public mir::scene::SessionLockObserver
+{
+public:
+    explicit SessionLockObserver(Policy& policy) :
+        policy { policy }
+    {
+    }
+
+    void on_lock() override { set_locked(true); }
+    void on_unlock() override { set_locked(false); }
+
+private:
+    Policy& policy;
+
+    /// Called on the thread that locked the session. The renderers and the animator
+    /// stop showing the windows from their next frame, without waiting for the
+    /// window manager, so that the lock screen is all that is drawn from then on.
+    void set_locked(bool locked)
+    {
+        policy.state->set_session_locked(locked);
+        policy.animator->set_snapping(locked);
+        policy.server_action_queue->enqueue(&policy, [this]()
+        {
+            policy.tools.invoke_under_lock([this]()
+            {
+                std::lock_guard lock(policy.self->mutex);
+                policy.apply_session_lock();
+            });
+        });
+    }
 };
 
 Policy::Policy(
@@ -106,14 +181,15 @@ Policy::Policy(
     miral::MirRunner& runner,
     miral::ExternalClientLauncher& external_client_launcher,
     std::shared_ptr<Config> const& config,
-    std::shared_ptr<CompositorState> const& state) :
+    std::shared_ptr<CompositorState> const& state,
+    std::shared_ptr<Spawner> const& spawner) :
     config { config },
     state { state },
     launcher { std::make_unique<AutoRestartingLauncher>(runner, external_client_launcher) },
     animator(std::make_shared<Animator>()),
     window_controller(std::make_shared<WindowManagerToolsWindowController>(
         tools, animator, state, config, server.the_main_loop(), this)),
-    animator_loop(std::make_unique<ThreadedAnimatorLoop>(animator)),
+    animator_loop(std::make_unique<ThreadedAnimatorLoop>(animator, state->frame_clock(), config->scheduling().animator)),
     output_manager(std::make_shared<OutputManager>(
         std::make_unique<MiralOutputFactory>(
             state,
@@ -125,180 +201,409 @@ Policy::Policy(
     scratchpad_(std::make_shared<Scratchpad>(window_controller, output_manager)),
     self(std::make_shared<Self>(*this)),
     mode_observer_registrar(std::make_shared<ModeObserverRegistrar>()),
+    window_observer_registrar(std::make_shared<WindowObserverRegistrar>()),
     command_controller(std::make_shared<CommandController>(
         config, self->mutex, state, window_controller,
-        workspace_manager, mode_observer_registrar,
-        std::make_unique<MirRunnerCommandControllerInterface>(runner), scratchpad_, output_manager)),
+        workspace_manager, mode_observer_registrar, window_observer_registrar,
+        std::make_unique<MirRunnerCommandControllerInterface>(runner, tools), scratchpad_, output_manager)),
     drag_and_drop_service(std::make_unique<DragAndDropService>(command_controller, config, output_manager)),
     move_service(std::make_unique<MoveService>(command_controller, config, output_manager)),
+    container_index(std::make_shared<ContainerIndex>(window_controller)),
+    placement_batch(std::make_shared<PlacementBatch>(state, self->mutex, server.the_main_loop())),
     ipc(std::make_shared<Ipc>(
-        runner,
+        server.the_main_loop(),
         command_controller,
-        std::make_unique<IpcCommandExecutor>(command_controller, output_manager, workspace_manager, state, *launcher, window_controller),
-        config))
+        std::make_unique<IpcCommandExecutor>(
+            command_controller, output_manager, workspace_manager, state, *launcher, window_controller, container_index),
+        config,
+        animator,
+        placement_batch)),
+    tools { tools },
+    server_action_queue { server.the_main_loop() },
+    session_lock { server.the_session_lock() },
+    session_lock_observer { std::make_shared<SessionLockObserver>(*this) }
 {
+    if (spawner)
+        launcher->use_spawner(spawner, server);
+
     workspace_observer_registrar->register_interest(ipc);
     workspace_observer_registrar->register_interest(self);
     mode_observer_registrar->register_interest(ipc);
+    window_observer_registrar->register_interest(ipc);
+    window_observer_registrar->register_interest(container_index);
+    session_lock->register_interest(session_lock_observer);
     animator_loop->start();
+    restored_layout = take_layout_checkpoint(layout_checkpoint_path());
+    workspace_swipe_alarm = server.the_main_loop()->create_alarm([this]()
+    {
+        this->tools.invoke_under_lock([this]()
+        {
+            std::lock_guard lock(self->mutex);
+            end_workspace_swipe();
+        });
+    });
+    StartupProfile::instance().mark("window manager constructed");
 }
 
 Policy::~Policy()
 {
+    session_lock->unregister_interest(*session_lock_observer);
+    workspace_swipe_alarm->cancel();
+    server_action_queue->pause_processing_for(this);
     ipc->on_shutdown();
     animator_loop->stop();
     workspace_observer_registrar->unregister_interest(ipc.get());
     workspace_observer_registrar->unregister_interest(self.get());
     mode_observer_registrar->unregister_interest(ipc.get());
+    window_observer_registrar->unregister_interest(ipc.get());
+    window_observer_registrar->unregister_interest(container_index.get());
 }
 
 bool Policy::handle_keyboard_event(MirKeyboardEvent const* event)
 {
+    MIRACLE_TRACE_SCOPE("Policy::handle_keyboard_event");
+    is_scene_untouched = true;
+    Metrics::instance().increment(MetricCounter::input_events);
+    MetricTimer timer(MetricHistogram::input_time);
+    RenderDataManager::InputTag input_tag(
+        *state->render_data_manager(), arrival_time(miral::toolkit::mir_keyboard_event_input_event(event)));
     auto const action = miral::toolkit::mir_keyboard_event_action(event);
     auto const scan_code = miral::toolkit::mir_keyboard_event_scan_code(event);
     auto const modifiers = miral::toolkit::mir_keyboard_event_modifiers(event) & MODIFIER_MASK;
     state->modifiers = modifiers;
 
-    auto custom_key_command = config->matches_custom_key_command(action, scan_code, modifiers);
-    if (custom_key_command != nullptr)
+    if (auto& recorder = EventRecorder::instance(); recorder.is_recording())
     {
-        launcher->launch({ custom_key_command->command });
-        return true;
+        recorder.record(RecordedKeyboardEvent {
+            .action = static_cast<uint32_t>(action),
+            .keysym = static_cast<uint32_t>(miral::toolkit::mir_keyboard_event_keysym(event)),
+            .scan_code = scan_code,
+            .modifiers = modifiers });
     }
 
-    return config->matches_key_command(action, scan_code, modifiers, [&](DefaultKeyCommand key_command)
+    // Whatever this event does must happen after the repeats that came before it
+    if (action != mir_keyboard_action_repeat)
+        flush_pending_repeat();
+
+    // Most keys are typed rather than bound, so they are let through after a single
+    // lookup that allocates nothing.
+    auto const match = config->match_key(action, scan_code, modifiers);
+    if (match.empty())
+        return false;
+
+    if (match.custom_key_command)
     {
-        if (key_command == DefaultKeyCommand::MAX)
-            return false;
+        launcher->launch({ match.custom_key_command->command });
+        return true;
+    }
 
-        switch (key_command)
-        {
-        case DefaultKeyCommand::Terminal:
-        {
-            auto terminal_command = config->get_terminal_command();
-            if (terminal_command)
-                launcher->launch({ terminal_command.value() });
-            return true;
-        }
-        case DefaultKeyCommand::RequestVertical:
-            return command_controller->try_request_vertical();
-        case DefaultKeyCommand::RequestHorizontal:
-            return command_controller->try_request_horizontal();
-        case DefaultKeyCommand::ToggleResize:
-            command_controller->try_toggle_resize_mode();
+    for (auto const key_command : match.default_key_commands)
+    {
+        if (run_key_command(key_command, action))
             return true;
-        case DefaultKeyCommand::ResizeUp:
-            return state->mode() != WindowManagerMode::normal && command_controller->try_resize(Direction::up, config->get_resize_jump());
-        case DefaultKeyCommand::ResizeDown:
-            return state->mode() != WindowManagerMode::normal && command_controller->try_resize(Direction::down, config->get_resize_jump());
-        case DefaultKeyCommand::ResizeLeft:
-            return state->mode() != WindowManagerMode::normal && command_controller->try_resize(Direction::left, config->get_resize_jump());
-        case DefaultKeyCommand::ResizeRight:
-            return state->mode() != WindowManagerMode::normal && command_controller->try_resize(Direction::right, config->get_resize_jump());
-        case DefaultKeyCommand::MoveUp:
-            return command_controller->try_move(Direction::up);
-        case DefaultKeyCommand::MoveDown:
-            return command_controller->try_move(Direction::down);
-        case DefaultKeyCommand::MoveLeft:
-            return command_controller->try_move(Direction::left);
-        case DefaultKeyCommand::MoveRight:
-            return command_controller->try_move(Direction::right);
-        case DefaultKeyCommand::SelectUp:
-            return command_controller->try_select(Direction::up);
-        case DefaultKeyCommand::SelectDown:
-            return command_controller->try_select(Direction::down);
-        case DefaultKeyCommand::SelectLeft:
-            return command_controller->try_select(Direction::left);
-        case DefaultKeyCommand::SelectRight:
-            return command_controller->try_select(Direction::right);
-        case DefaultKeyCommand::QuitActiveWindow:
-            return command_controller->try_close_window();
-        case DefaultKeyCommand::QuitCompositor:
-            return command_controller->quit();
-        case DefaultKeyCommand::Fullscreen:
-            return command_controller->try_toggle_fullscreen();
-        case DefaultKeyCommand::SelectWorkspace1:
-            return command_controller->select_workspace(1);
-        case DefaultKeyCommand::SelectWorkspace2:
-            return command_controller->select_workspace(2);
-        case DefaultKeyCommand::SelectWorkspace3:
-            return command_controller->select_workspace(3);
-        case DefaultKeyCommand::SelectWorkspace4:
-            return command_controller->select_workspace(4);
-        case DefaultKeyCommand::SelectWorkspace5:
-            return command_controller->select_workspace(5);
-        case DefaultKeyCommand::SelectWorkspace6:
-            return command_controller->select_workspace(6);
-        case DefaultKeyCommand::SelectWorkspace7:
-            return command_controller->select_workspace(7);
-        case DefaultKeyCommand::SelectWorkspace8:
-            return command_controller->select_workspace(8);
-        case DefaultKeyCommand::SelectWorkspace9:
-            return command_controller->select_workspace(9);
-        case DefaultKeyCommand::SelectWorkspace0:
-            return command_controller->select_workspace(0);
-        case DefaultKeyCommand::MoveToWorkspace1:
-            return command_controller->move_active_to_workspace(1);
-        case DefaultKeyCommand::MoveToWorkspace2:
-            return command_controller->move_active_to_workspace(2);
-        case DefaultKeyCommand::MoveToWorkspace3:
-            return command_controller->move_active_to_workspace(3);
-        case DefaultKeyCommand::MoveToWorkspace4:
-            return command_controller->move_active_to_workspace(4);
-        case DefaultKeyCommand::MoveToWorkspace5:
-            return command_controller->move_active_to_workspace(5);
-        case DefaultKeyCommand::MoveToWorkspace6:
-            return command_controller->move_active_to_workspace(6);
-        case DefaultKeyCommand::MoveToWorkspace7:
-            return command_controller->move_active_to_workspace(7);
-        case DefaultKeyCommand::MoveToWorkspace8:
-            return command_controller->move_active_to_workspace(8);
-        case DefaultKeyCommand::MoveToWorkspace9:
-            return command_controller->move_active_to_workspace(9);
-        case DefaultKeyCommand::MoveToWorkspace0:
-            return command_controller->move_active_to_workspace(0);
-        case DefaultKeyCommand::ToggleFloating:
-            return command_controller->toggle_floating();
-        case DefaultKeyCommand::TogglePinnedToWorkspace:
-            return command_controller->toggle_pinned_to_workspace();
-        case DefaultKeyCommand::ToggleTabbing:
-            return command_controller->toggle_tabbing();
-        case DefaultKeyCommand::ToggleStacking:
-            return command_controller->toggle_stacking();
-        default:
-            std::cerr << "Unknown key_command: " << static_cast<int>(key_command) << std::endl;
-            break;
-        }
+    }
+
+    return false;
+}
+
+bool Policy::run_key_command(DefaultKeyCommand key_command, MirKeyboardAction action)
+{
+    if (key_command == DefaultKeyCommand::MAX)
+        return false;
+
+    is_scene_untouched = false;
+    if (action == mir_keyboard_action_repeat)
+    {
+        if (auto const consumed = queue_repeat(key_command))
+            return consumed.value();
+    }
+
+    // A command may change the tree several times, but it is laid out once
+    CommitBatch batch(*state);
+    switch (key_command)
+    {
+    case DefaultKeyCommand::Terminal:
+    {
+        auto terminal_command = config->get_terminal_command();
+        if (terminal_command)
+            launcher->launch({ terminal_command.value() });
+        return true;
+    }
+    case DefaultKeyCommand::RequestVertical:
+        return command_controller->try_request_vertical();
+    case DefaultKeyCommand::RequestHorizontal:
+        return command_controller->try_request_horizontal();
+    case DefaultKeyCommand::ToggleResize:
+        command_controller->try_toggle_resize_mode();
+        return true;
+    case DefaultKeyCommand::ResizeUp:
+        return state->mode() != WindowManagerMode::normal && command_controller->try_resize(Direction::up, config->get_resize_jump());
+    case DefaultKeyCommand::ResizeDown:
+        return state->mode() != WindowManagerMode::normal && command_controller->try_resize(Direction::down, config->get_resize_jump());
+    case DefaultKeyCommand::ResizeLeft:
+        return state->mode() != WindowManagerMode::normal && command_controller->try_resize(Direction::left, config->get_resize_jump());
+    case DefaultKeyCommand::ResizeRight:
+        return state->mode() != WindowManagerMode::normal && command_controller->try_resize(Direction::right, config->get_resize_jump());
+    case DefaultKeyCommand::MoveUp:
+        return command_controller->try_move(Direction::up);
+    case DefaultKeyCommand::MoveDown:
+        return command_controller->try_move(Direction::down);
+    case DefaultKeyCommand::MoveLeft:
+        return command_controller->try_move(Direction::left);
+    case DefaultKeyCommand::MoveRight:
+        return command_controller->try_move(Direction::right);
+    case DefaultKeyCommand::SelectUp:
+        return command_controller->try_select(Direction::up);
+    case DefaultKeyCommand::SelectDown:
+        return command_controller->try_select(Direction::down);
+    case DefaultKeyCommand::SelectLeft:
+        return command_controller->try_select(Direction::left);
+    case DefaultKeyCommand::SelectRight:
+        return command_controller->try_select(Direction::right);
+    case DefaultKeyCommand::QuitActiveWindow:
+        return command_controller->try_close_window();
+    case DefaultKeyCommand::QuitCompositor:
+        return command_controller->quit();
+    case DefaultKeyCommand::Fullscreen:
+        return command_controller->try_toggle_fullscreen();
+    case DefaultKeyCommand::SelectWorkspace1:
+        return command_controller->select_workspace(1);
+    case DefaultKeyCommand::SelectWorkspace2:
+        return command_controller->select_workspace(2);
+    case DefaultKeyCommand::SelectWorkspace3:
+        return command_controller->select_workspace(3);
+    case DefaultKeyCommand::SelectWorkspace4:
+        return command_controller->select_workspace(4);
+    case DefaultKeyCommand::SelectWorkspace5:
+        return command_controller->select_workspace(5);
+    case DefaultKeyCommand::SelectWorkspace6:
+        return command_controller->select_workspace(6);
+    case DefaultKeyCommand::SelectWorkspace7:
+        return command_controller->select_workspace(7);
+    case DefaultKeyCommand::SelectWorkspace8:
+        return command_controller->select_workspace(8);
+    case DefaultKeyCommand::SelectWorkspace9:
+        return command_controller->select_workspace(9);
+    case DefaultKeyCommand::SelectWorkspace0:
+        return command_controller->select_workspace(0);
+    case DefaultKeyCommand::MoveToWorkspace1:
+        return command_controller->move_active_to_workspace(1);
+    case DefaultKeyCommand::MoveToWorkspace2:
+        return command_controller->move_active_to_workspace(2);
+    case DefaultKeyCommand::MoveToWorkspace3:
+        return command_controller->move_active_to_workspace(3);
+    case DefaultKeyCommand::MoveToWorkspace4:
+        return command_controller->move_active_to_workspace(4);
+    case DefaultKeyCommand::MoveToWorkspace5:
+        return command_controller->move_active_to_workspace(5);
+    case DefaultKeyCommand::MoveToWorkspace6:
+        return command_controller->move_active_to_workspace(6);
+    case DefaultKeyCommand::MoveToWorkspace7:
+        return command_controller->move_active_to_workspace(7);
+    case DefaultKeyCommand::MoveToWorkspace8:
+        return command_controller->move_active_to_workspace(8);
+    case DefaultKeyCommand::MoveToWorkspace9:
+        return command_controller->move_active_to_workspace(9);
+    case DefaultKeyCommand::MoveToWorkspace0:
+        return command_controller->move_active_to_workspace(0);
+    case DefaultKeyCommand::ToggleFloating:
+        return command_controller->toggle_floating();
+    case DefaultKeyCommand::TogglePinnedToWorkspace:
+        return command_controller->toggle_pinned_to_workspace();
+    case DefaultKeyCommand::ToggleTabbing:
+        return command_controller->toggle_tabbing();
+    case DefaultKeyCommand::ToggleStacking:
+        return command_controller->toggle_stacking();
+    default:
+        std::cerr << "Unknown key_command: " << static_cast<int>(key_command) << std::endl;
+        break;
+    }
+    return false;
+}
+
+namespace
+{
+std::optional<Direction> resize_direction(DefaultKeyCommand command)
+{
+    switch (command)
+    {
+    case DefaultKeyCommand::ResizeUp:
+        return Direction::up;
+    case DefaultKeyCommand::ResizeDown:
+        return Direction::down;
+    case DefaultKeyCommand::ResizeLeft:
+        return Direction::left;
+    case DefaultKeyCommand::ResizeRight:
+        return Direction::right;
+    default:
+        return std::nullopt;
+    }
+}
+
+std::optional<Direction> move_direction(DefaultKeyCommand command)
+{
+    switch (command)
+    {
+    case DefaultKeyCommand::MoveUp:
+        return Direction::up;
+    case DefaultKeyCommand::MoveDown:
+        return Direction::down;
+    case DefaultKeyCommand::MoveLeft:
+        return Direction::left;
+    case DefaultKeyCommand::MoveRight:
+        return Direction::right;
+    default:
+        return std::nullopt;
+    }
+}
+}
+
+std::optional<bool> Policy::queue_repeat(DefaultKeyCommand command)
+{
+    if (resize_direction(command))
+    {
+        if (state->mode() == WindowManagerMode::normal)
+            return std::nullopt;
+    }
+    else if (move_direction(command))
+    {
+        if (state->mode() != WindowManagerMode::normal)
+            return std::nullopt;
+    }
+    else
+        return std::nullopt;
+
+    if (!state->focused_container())
+        return false;
+
+    if (pending_repeat && pending_repeat->command == command)
+    {
+        pending_repeat->count++;
+        return true;
+    }
+
+    // The first repeat of a run is applied at once, so that the key is only
+    // consumed if the command does something. The rest follow it.
+    flush_pending_repeat();
+    bool applied = false;
+    {
+        CommitBatch batch(*state);
+        applied = apply_repeat(command, 1);
+    }
+    if (!applied)
         return false;
+
+    pending_repeat = PendingRepeat { command, 0 };
+
+    // Input is handled under the window manager lock, so the flush takes it too
+    server_action_queue->enqueue(this, [this]()
+    {
+        tools.invoke_under_lock([this]()
+        {
+            flush_pending_repeat();
+        });
     });
+    return true;
+}
+
+void Policy::flush_pending_repeat()
+{
+    if (!pending_repeat)
+        return;
+
+    MIRACLE_TRACE_SCOPE("Policy::flush_pending_repeat");
+    auto const [command, count] = *pending_repeat;
+    pending_repeat.reset();
+    if (count == 0)
+        return;
+
+    CommitBatch batch(*state);
+    apply_repeat(command, count);
+}
+
+bool Policy::apply_repeat(DefaultKeyCommand command, int count)
+{
+    if (auto const direction = resize_direction(command))
+    {
+        return state->mode() != WindowManagerMode::normal
+            && command_controller->try_resize(*direction, count * config->get_resize_jump());
+    }
+
+    auto const direction = move_direction(command);
+    if (!direction)
+        return false;
+
+    // Tiled moves are swaps, which cannot be summed, but their relayouts can
+    bool moved = false;
+    for (int i = 0; i < count; i++)
+    {
+        if (!command_controller->try_move(*direction))
+            break;
+        moved = true;
+    }
+    return moved;
 }
 
 bool Policy::handle_pointer_event(MirPointerEvent const* event)
 {
+    is_scene_untouched = true;
+    Metrics::instance().increment(MetricCounter::input_events);
+    MetricTimer timer(MetricHistogram::input_time);
+    RenderDataManager::InputTag input_tag(
+        *state->render_data_manager(), arrival_time(miral::toolkit::mir_pointer_event_input_event(event)));
     std::lock_guard lock(self->mutex);
     auto x = miral::toolkit::mir_pointer_event_axis_value(event, MirPointerAxis::mir_pointer_axis_x);
     auto y = miral::toolkit::mir_pointer_event_axis_value(event, MirPointerAxis::mir_pointer_axis_y);
     auto action = miral::toolkit::mir_pointer_event_action(event);
     auto const modifiers = miral::toolkit::mir_pointer_event_modifiers(event) & MODIFIER_MASK;
+    auto const buttons = miral::toolkit::mir_pointer_event_buttons(event);
     state->cursor_position = { x, y };
 
+    if (auto& recorder = EventRecorder::instance(); recorder.is_recording())
+    {
+        recorder.record(RecordedPointerEvent {
+            .action = static_cast<uint32_t>(action),
+            .x = x,
+            .y = y,
+            .buttons = static_cast<uint32_t>(buttons),
+            .modifiers = modifiers });
+    }
+
+    auto const hscroll = miral::toolkit::mir_pointer_event_axis_value(event, MirPointerAxis::mir_pointer_axis_hscroll);
+    if (handle_workspace_swipe(action, hscroll, modifiers))
+        return true;
+
+    // Moving within the container that we last hit changes neither the output nor the focus
+    if (action == mir_pointer_action_motion && is_pointer_hit(x, y, buttons, modifiers))
+        return false;
+    pointer_hit.reset();
+
     // Select the output first
-    for (auto const& output : output_manager->outputs())
+    if (auto const output = output_manager->output_at(geom::Point(static_cast<int>(x), static_cast<int>(y))))
     {
-        if (output->point_is_in_output(static_cast<int>(x), static_cast<int>(y)))
+        if (output_manager->focused() != output)
         {
-            if (output_manager->focused() != output.get())
-            {
-                if (output_manager->focused())
-                    output_manager->unfocus(output_manager->focused()->id());
-                output_manager->focus(output->id());
-                if (auto active = output->active())
-                    workspace_manager->request_focus(active->id());
-            }
-            break;
+            if (output_manager->focused())
+                output_manager->unfocus(output_manager->focused()->id());
+            output_manager->focus(output->id());
+            if (auto active = output->active())
+                workspace_manager->request_focus(active->id());
         }
     }
 
+    // The clients are not where they are drawn while the overview is shown, so the
+    // pointer is only used to pick a workspace.
+    if (auto const output = output_manager->focused(); output && output->is_showing_overview())
+    {
+        if (action == mir_pointer_action_button_down)
+        {
+            if (auto const id = output->overview_workspace_at(geom::Point(static_cast<int>(x), static_cast<int>(y))))
+                workspace_manager->request_focus(id.value());
+        }
+
+        return true;
+    }
+
     if (move_service->handle_pointer_event(*state, x, y, action, modifiers))
         return true;
 
@@ -340,6 +645,7 @@ bool Policy::handle_pointer_event(MirPointerEvent const* event)
                 {
                     if (state->focused_container() != intersected)
                         window_controller->select_active_window(window);
+                    remember_pointer_hit(intersected, buttons, modifiers);
                 }
             }
 
@@ -359,10 +665,70 @@ bool Policy::handle_pointer_event(MirPointerEvent const* event)
     return false;
 }
 
+void Policy::apply_session_lock()
+{
+    for (auto const& weak : state->containers())
+    {
+        if (auto const container = weak.lock(); container && container->window())
+            window_controller->apply_session_lock(container->window().value());
+    }
+}
+
+bool Policy::is_pointer_hit(float x, float y, MirPointerButtons buttons, uint modifiers) const
+{
+    if (!pointer_hit || state->mode() != WindowManagerMode::normal)
+        return false;
+
+    if (pointer_hit->buttons != buttons || pointer_hit->modifiers != modifiers)
+        return false;
+
+    if (output_manager->focused() != pointer_hit->output)
+        return false;
+
+    auto const container = pointer_hit->container.lock();
+    if (!container || container != state->focused_container())
+        return false;
+
+    geom::Point const point(x, y);
+    return pointer_hit->area.contains(point) && pointer_hit->output_area.contains(point);
+}
+
+void Policy::remember_pointer_hit(std::shared_ptr<Container> const& container, MirPointerButtons buttons, uint modifiers)
+{
+    // The selection of a window may have been refused, in which case the next motion must try again
+    if (state->focused_container() != container)
+        return;
+
+    auto const output = output_manager->focused();
+    auto const workspace = output->active();
+    if (!workspace)
+        return;
+
+    // Hit testing picks the topmost window, so an area that another window
+    // overlaps could belong to either of them.
+    auto const area = container->get_visible_area();
+    bool const overlapped = workspace->for_each_window([&](std::shared_ptr<Container> const& other)
+    {
+        return other != container && area.overlaps(other->get_logical_area());
+    });
+    if (overlapped)
+        return;
+
+    pointer_hit = PointerHit {
+        .container = container,
+        .area = area,
+        .output = output,
+        .output_area = output->get_area(),
+        .buttons = buttons,
+        .modifiers = modifiers
+    };
+}
+
 auto Policy::place_new_window(
     const miral::ApplicationInfo& app_info,
     const miral::WindowSpecification& requested_specification) -> miral::WindowSpecification
 {
+    auto const requested = std::chrono::steady_clock::now();
     std::lock_guard lock(self->mutex);
     if (!output_manager->focused())
     {
@@ -370,22 +736,66 @@ auto Policy::place_new_window(
         return requested_specification;
     }
 
+    // A window that a restored layout is waiting for goes to the output of that layout
+    auto output = output_manager->focused();
+    auto const app_id = requested_specification.application_id().is_set()
+        ? requested_specification.application_id().value()
+        : app_info.name();
+    auto const title = requested_specification.name().is_set() ? requested_specification.name().value() : "";
+    if (!output->has_layout_slot_for(app_id, title))
+    {
+        for (auto const& candidate : output_manager->outputs())
+        {
+            if (candidate->has_layout_slot_for(app_id, title))
+            {
+                output = candidate.get();
+                break;
+            }
+        }
+    }
+
     auto new_spec = requested_specification;
-    pending_allocation = output_manager->focused()->allocate_position(app_info, new_spec, {});
+    pending_allocation = output->allocate_position(app_info, new_spec, {});
+    pending_open_requested = requested;
+    pending_open_placed = std::chrono::steady_clock::now();
     return new_spec;
 }
 
 void Policy::advise_new_window(miral::WindowInfo const& window_info)
 {
     std::lock_guard lock(self->mutex);
+    pointer_hit.reset();
     if (!output_manager->focused())
         mir::fatal_error("create_container: an output should always be available");
 
     auto container = output_manager->focused()->create_container(window_info, pending_allocation);
+    auto const surface = std::shared_ptr<mir::scene::Surface>(window_info.window()).get();
+    auto* open_stats = state->window_open_stats();
+    open_stats->begin(surface, pending_open_requested);
+    open_stats->mark(surface, WindowOpenStage::placed, pending_open_placed);
+    open_stats->mark(surface, WindowOpenStage::created);
+
+    if (auto& recorder = EventRecorder::instance(); recorder.is_recording())
+    {
+        auto const& window = window_info.window();
+        recorder.record(RecordedWindowOpened {
+            .id = recorder.window_id(container.get()),
+            .area = { window.top_left(), window.size() },
+            .type = static_cast<uint32_t>(window_info.type()),
+            .state = static_cast<uint32_t>(window_info.state()) });
+    }
+
     container->animation_handle(animator->register_animateable());
     container->on_open();
     state->add(container);
 
+    // Windows that open while the session is locked stay hidden behind it,
+    // unless they belong to the lock screen
+    if (state->is_session_locked())
+        window_controller->apply_session_lock(window_info.window());
+    window_observer_registrar->advise_changed(WindowChange::created, *container);
+    placement_batch->advise_window_placed();
+
     pending_allocation.container_type = ContainerType::none;
 }
 
@@ -399,7 +809,11 @@ void Policy::handle_window_ready(miral::WindowInfo& window_info)
         return;
     }
 
+    state->window_open_stats()->mark(
+        std::shared_ptr<mir::scene::Surface>(window_info.window()).get(), WindowOpenStage::ready);
+    state->render_data_manager()->placeholder_change(*container, std::nullopt);
     container->handle_ready();
+    launcher->advise_window_opened(miral::pid_of(window_info.window().application()));
 }
 
 mir::geometry::Rectangle
@@ -422,6 +836,7 @@ Policy::confirm_placement_on_display(
 void Policy::advise_focus_gained(const miral::WindowInfo& window_info)
 {
     std::lock_guard lock(self->mutex);
+    pointer_hit.reset();
     auto container = window_controller->get_container(window_info.window());
     if (!container)
     {
@@ -440,6 +855,7 @@ void Policy::advise_focus_gained(const miral::WindowInfo& window_info)
         auto* workspace = container->get_workspace();
         state->focus_container(container);
         container->on_focus_gained();
+        window_observer_registrar->advise_changed(WindowChange::focused, *container);
 
         // TODO: This logic was put in place to navigate to the focused
         //  workspace.
@@ -456,6 +872,7 @@ void Policy::advise_focus_gained(const miral::WindowInfo& window_info)
 void Policy::advise_focus_lost(const miral::WindowInfo& window_info)
 {
     std::lock_guard lock(self->mutex);
+    pointer_hit.reset();
     auto container = window_controller->get_container(window_info.window());
     if (!container)
     {
@@ -477,6 +894,7 @@ void Policy::advise_focus_lost(const miral::WindowInfo& window_info)
 void Policy::advise_delete_window(const miral::WindowInfo& window_info)
 {
     std::lock_guard lock(self->mutex);
+    pointer_hit.reset();
     auto container = window_controller->get_container(window_info.window());
     if (!container)
     {
@@ -484,16 +902,23 @@ void Policy::advise_delete_window(const miral::WindowInfo& window_info)
         return;
     }
 
+    state->window_open_stats()->remove(std::shared_ptr<mir::scene::Surface>(window_info.window()).get());
+    window_observer_registrar->advise_changed(WindowChange::closed, *container);
+    if (auto& recorder = EventRecorder::instance(); recorder.is_recording())
+        recorder.record(RecordedWindowClosed { recorder.forget_window(container.get()) });
+
     if (auto output = container->get_output())
         output->delete_container(container);
     else
         scratchpad_->remove(container);
 
-    animator->remove_by_animation_handle(container->animation_handle());
+    // The handle goes to the next window, so this one must stop using it
+    window_controller->release_animation_handle(*container);
     if (container == state->focused_container())
         state->unfocus_container(container);
 
     state->remove(container);
+    window_controller->advise_delete(window_info.window());
 }
 
 void Policy::advise_move_to(miral::WindowInfo const& window_info, geom::Point top_left)
@@ -506,24 +931,104 @@ void Policy::advise_move_to(miral::WindowInfo const& window_info, geom::Point to
         return;
     }
 
+    pointer_hit.reset();
     container->on_move_to(top_left);
 }
 
+void Policy::advise_resize(miral::WindowInfo const& window_info, geom::Size const& new_size)
+{
+    std::lock_guard lock(self->mutex);
+    pointer_hit.reset();
+}
+
 void Policy::advise_output_create(miral::Output const& output)
 {
     std::lock_guard lock(self->mutex);
-    output_manager->create(output.name(), output.id(), output.extents(), *workspace_manager);
+    pointer_hit.reset();
+    record_output_event(RecordedOutputChange::created, output);
+
+    // Outputs change as a single transaction: windows jump to their new places,
+    // and each workspace is laid out once when the change is complete.
+    AnimationSuppression suppression(*state);
+    CommitBatch batch(*state);
+    auto const created = output_manager->create(output.name(), output.id(), output.extents(), *workspace_manager);
+    restore_layout(created);
+}
+
+void Policy::restore_layout(OutputInterface* output)
+{
+    if (!restored_layout)
+        return;
+
+    auto& saved_workspaces = restored_layout->workspaces;
+    std::optional<LayoutCheckpoint::Workspace> active;
+    bool is_restoring = false;
+    for (auto it = saved_workspaces.begin(); it != saved_workspaces.end();)
+    {
+        if (it->output != output->name())
+        {
+            ++it;
+            continue;
+        }
+
+        if (auto const workspace = request_restored_workspace(output, *it))
+            is_restoring |= workspace->append_layout(to_layout_template(it->root));
+        if (it->is_active)
+            active = *it;
+        it = saved_workspaces.erase(it);
+    }
+
+    if (active)
+        request_restored_workspace(output, active.value());
+    if (saved_workspaces.empty())
+        restored_layout.reset();
+
+    // The returning clients connect all at once
+    if (is_restoring)
+    {
+        mir::log_info("Restoring the layout of output %s from before the restart", output->name().c_str());
+        placement_batch->open();
+    }
+}
+
+WorkspaceInterface* Policy::request_restored_workspace(OutputInterface* output, LayoutCheckpoint::Workspace const& saved)
+{
+    if (saved.num)
+        workspace_manager->request_workspace(output, saved.num.value(), false);
+    else if (saved.name)
+        workspace_manager->request_workspace(output, saved.name.value(), false);
+    else
+        return nullptr;
+
+    for (auto const workspace : workspace_manager->workspaces())
+    {
+        if (saved.num ? workspace->num() == saved.num : workspace->name() == saved.name)
+            return workspace;
+    }
+    return nullptr;
 }
 
 void Policy::advise_output_update(miral::Output const& updated, miral::Output const& original)
 {
     std::lock_guard lock(self->mutex);
+    pointer_hit.reset();
+    record_output_event(RecordedOutputChange::updated, updated);
+
+    AnimationSuppression suppression(*state);
+    CommitBatch batch(*state);
     output_manager->update(updated.id(), updated.extents());
 }
 
 void Policy::advise_output_delete(miral::Output const& output)
 {
     std::lock_guard lock(self->mutex);
+    pointer_hit.reset();
+    workspace_swipe.reset();
+    swiped_output = nullptr;
+    record_output_event(RecordedOutputChange::deleted, output);
+
+    AnimationSuppression suppression(*state);
+    CommitBatch batch(*state);
     output_manager->remove(output.id(), *workspace_manager);
 }
 
@@ -548,7 +1053,15 @@ void Policy::handle_modify_window(
     else if (scratchpad_->contains(container) && !scratchpad_->is_showing(container))
         return;
 
+    bool const was_fullscreen = container->is_fullscreen();
     container->handle_modify(modifications);
+
+    if (modifications.name().is_set())
+        window_observer_registrar->advise_changed(WindowChange::title, *container);
+    if (modifications.application_id().is_set())
+        container_index->refresh(*container);
+    if (container->is_fullscreen() != was_fullscreen)
+        window_observer_registrar->advise_changed(WindowChange::fullscreen_mode, *container);
 }
 
 void Policy::handle_raise_window(miral::WindowInfo& window_info)
@@ -613,6 +1126,32 @@ void Policy::handle_animation(
     window_controller->process_animation(asr, sh_container);
 }
 
+void Policy::handle_animations(
+    std::vector<std::pair<AnimationStepResult, std::weak_ptr<Container>>> const& results)
+{
+    is_scene_untouched = true;
+    std::lock_guard lock(self->mutex);
+    RenderDataManager::Batch batch(*state->render_data_manager());
+    for (auto const& [asr, container] : results)
+    {
+        auto sh_container = container.lock();
+        if (!sh_container)
+        {
+            mir::log_error("handle_animations: container is invalid");
+            continue;
+        }
+
+        window_controller->process_animation(asr, sh_container);
+    }
+}
+
+void Policy::handle_xwayland_frame(miral::Window const& window)
+{
+    is_scene_untouched = true;
+    std::lock_guard lock(self->mutex);
+    window_controller->handle_xwayland_frame(window);
+}
+
 mir::geometry::Rectangle Policy::confirm_inherited_move(
     const miral::WindowInfo& window_info,
     mir::geometry::Displacement movement)
@@ -627,6 +1166,7 @@ void Policy::advise_application_zone_create(miral::Zone const& application_zone)
     {
         output->advise_application_zone_create(application_zone);
     }
+    queue_application_zone_flush();
 }
 
 void Policy::advise_application_zone_update(miral::Zone const& updated, miral::Zone const& original)
@@ -636,6 +1176,7 @@ void Policy::advise_application_zone_update(miral::Zone const& updated, miral::Z
     {
         output->advise_application_zone_update(updated, original);
     }
+    queue_application_zone_flush();
 }
 
 void Policy::advise_application_zone_delete(miral::Zone const& application_zone)
@@ -645,16 +1186,113 @@ void Policy::advise_application_zone_delete(miral::Zone const& application_zone)
     {
         output->advise_application_zone_delete(application_zone);
     }
+    queue_application_zone_flush();
+}
+
+bool Policy::handle_workspace_swipe(MirPointerAction action, float hscroll, uint modifiers)
+{
+    bool const is_swipe = action == mir_pointer_action_motion
+        && hscroll != 0.f
+        && modifiers == config->get_primary_modifier()
+        && state->mode() == WindowManagerMode::normal;
+    if (!is_swipe)
+    {
+        end_workspace_swipe();
+        return false;
+    }
+
+    if (!workspace_swipe)
+    {
+        auto const output = output_manager->focused();
+        if (!output || output->is_showing_overview() || !output->active())
+            return false;
+
+        auto const& workspaces = output->get_workspaces();
+        auto const it = std::ranges::find(workspaces, output->active(), [](auto const& workspace) { return workspace.get(); });
+        if (it == workspaces.end())
+            return false;
+
+        workspace_swipe.emplace(
+            static_cast<float>(output->get_area().size.width.as_int()),
+            it != workspaces.begin(),
+            std::next(it) != workspaces.end());
+        swiped_output = output;
+        swiped_output->begin_swipe();
+    }
+
+    swiped_output->swipe(workspace_swipe->update(hscroll * WORKSPACE_SWIPE_PIXELS_PER_SCROLL));
+    workspace_swipe_alarm->reschedule_in(WORKSPACE_SWIPE_IDLE_TIME);
+    return true;
+}
+
+void Policy::end_workspace_swipe()
+{
+    if (!workspace_swipe)
+        return;
+
+    workspace_swipe_alarm->cancel();
+    auto const swipe = std::exchange(workspace_swipe, std::nullopt).value();
+    auto const output = std::exchange(swiped_output, nullptr);
+    auto const landing = swipe.landing();
+
+    std::shared_ptr<WorkspaceInterface> neighbour;
+    auto const& workspaces = output->get_workspaces();
+    auto const it = std::ranges::find(workspaces, output->active(), [](auto const& workspace) { return workspace.get(); });
+    if (it != workspaces.end())
+    {
+        if (landing > 0 && std::next(it) != workspaces.end())
+            neighbour = *std::next(it);
+        else if (landing < 0 && it != workspaces.begin())
+            neighbour = *std::prev(it);
+    }
+
+    output->end_swipe(swipe.velocity(), neighbour != nullptr);
+    if (neighbour)
+    {
+        CommitBatch batch(*state);
+        workspace_manager->request_focus(neighbour->id());
+    }
+}
+
+void Policy::queue_application_zone_flush()
+{
+    if (is_application_zone_flush_queued)
+        return;
+
+    is_application_zone_flush_queued = true;
+    server_action_queue->enqueue(this, [this]()
+    {
+        tools.invoke_under_lock([this]()
+        {
+            MIRACLE_TRACE_SCOPE("Policy::flush_application_zones");
+            is_application_zone_flush_queued = false;
+            std::lock_guard lock(self->mutex);
+            CommitBatch batch(*state);
+            for (auto const& output : output_manager->outputs())
+                output->apply_application_zones();
+        });
+    });
+}
+
+void Policy::advise_begin()
+{
+    is_scene_untouched = false;
 }
 
 void Policy::advise_end()
 {
+    if (!is_scene_untouched)
+        state->scene_changed();
+    command_controller->publish_scene();
+
     if (is_starting_)
     {
         is_starting_ = false;
-        for (auto const& app : config->get_startup_apps())
-        {
-            launcher->launch(app);
-        }
+
+        // The startup apps open their windows all at once, so they are laid out together
+        if (!config->get_startup_apps().empty())
+            placement_batch->open();
+
+        launcher->launch_startup_apps(config->get_startup_apps(), config->startup());
     }
 }
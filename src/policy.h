@@ -23,21 +23,41 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "command_controller.h"
 #include "compositor_state.h"
 #include "config.h"
+#include "container_index.h"
 #include "drag_and_drop_service.h"
 #include "ipc.h"
 #include "ipc_command_executor.h"
+#include "layout_checkpoint.h"
 #include "mode_observer.h"
 #include "move_service.h"
 #include "output.h"
+#include "placement_batch.h"
 #include "scratchpad.h"
+#include "window_observer.h"
 #include "window_manager_tools_window_controller.h"
 #include "workspace_manager.h"
+#include "workspace_swipe.h"
 
+#include <chrono>
 #include <memory>
 #include <miral/window_management_policy.h>
 #include <miral/window_manager_tools.h>
+#include <optional>
 #include <vector>
 
+namespace mir
+{
+class ServerActionQueue;
+namespace scene
+{
+class SessionLock;
+}
+namespace time
+{
+class Alarm;
+}
+}
+
 namespace miral
 {
 class MirRunner;
@@ -51,6 +71,7 @@ class Container;
 class ContainerGroupContainer;
 class AnimatorLoop;
 class OutputManager;
+class Spawner;
 
 class Policy : public miral::WindowManagementPolicy
 {
@@ -61,7 +82,8 @@ public:
         miral::MirRunner&,
         miral::ExternalClientLauncher& external_client_launcher,
         std::shared_ptr<Config> const&,
-        std::shared_ptr<CompositorState> const& state);
+        std::shared_ptr<CompositorState> const& state,
+        std::shared_ptr<Spawner> const& spawner);
     ~Policy() override;
 
     bool handle_keyboard_event(MirKeyboardEvent const* event) override;
@@ -75,6 +97,7 @@ public:
     void advise_focus_lost(miral::WindowInfo const& window_info) override;
     void advise_delete_window(miral::WindowInfo const& window_info) override;
     void advise_move_to(miral::WindowInfo const& window_info, geom::Point top_left) override;
+    void advise_resize(miral::WindowInfo const& window_info, geom::Size const& new_size) override;
     void advise_output_create(miral::Output const& output) override;
     void advise_output_update(miral::Output const& updated, miral::Output const& original) override;
     void advise_output_delete(miral::Output const& output) override;
@@ -93,12 +116,20 @@ public:
     void handle_animation(
         AnimationStepResult const& asr,
         std::weak_ptr<Container> const& container);
+
+    /// Applies every result of an animator tick at once.
+    void handle_animations(
+        std::vector<std::pair<AnimationStepResult, std::weak_ptr<Container>>> const& results);
+
+    /// Sends an Xwayland window the size that was held back while it caught up.
+    void handle_xwayland_frame(miral::Window const& window);
     auto confirm_inherited_move(
         const miral::WindowInfo& window_info,
         mir::geometry::Displacement movement) -> mir::geometry::Rectangle override;
     void advise_application_zone_create(miral::Zone const& application_zone) override;
     void advise_application_zone_update(miral::Zone const& updated, miral::Zone const& original) override;
     void advise_application_zone_delete(miral::Zone const& application_zone) override;
+    void advise_begin() override;
     void advise_end() override;
 
 private:
@@ -111,6 +142,7 @@ private:
     std::unique_ptr<AutoRestartingLauncher> launcher;
     std::shared_ptr<WorkspaceObserverRegistrar> workspace_observer_registrar;
     std::shared_ptr<ModeObserverRegistrar> mode_observer_registrar;
+    std::shared_ptr<WindowObserverRegistrar> window_observer_registrar;
     std::shared_ptr<OutputManager> output_manager;
     std::shared_ptr<WorkspaceManager> workspace_manager;
     std::shared_ptr<Self> self;
@@ -118,12 +150,100 @@ private:
     std::shared_ptr<CommandController> command_controller;
     std::unique_ptr<DragAndDropService> drag_and_drop_service;
     std::unique_ptr<MoveService> move_service;
+    std::shared_ptr<ContainerIndex> container_index;
+    std::shared_ptr<PlacementBatch> placement_batch;
     std::shared_ptr<Ipc> ipc;
     std::unique_ptr<AnimatorLoop> animator_loop;
     std::shared_ptr<ContainerGroupContainer> group_selection;
 
     bool is_starting_ = true;
     AllocationHint pending_allocation;
+    /// When the window that [pending_allocation] was made for was asked for, and
+    /// when its position was allocated. See [WindowOpenStats].
+    std::chrono::steady_clock::time_point pending_open_requested;
+    std::chrono::steady_clock::time_point pending_open_placed;
+
+    /// Whether the current transaction only handles input that was not bound to a
+    /// command, an animation tick or an Xwayland frame. These record their own
+    /// changes to the scene, so that moving the pointer or animating a window does
+    /// not take a new [SceneSnapshot] with every event.
+    bool is_scene_untouched = false;
+
+    /// Key repeats of a resize or move binding that have not been applied yet.
+    /// Repeats that arrive before the main loop gets to them are applied at
+    /// once, as a single resize or a single commit.
+    struct PendingRepeat
+    {
+        DefaultKeyCommand command;
+        int count;
+    };
+
+    miral::WindowManagerTools tools;
+    std::shared_ptr<mir::ServerActionQueue> server_action_queue;
+    std::optional<PendingRepeat> pending_repeat;
+
+    /// Runs a command that is bound to a key. The switch over [DefaultKeyCommand]
+    /// is dense, so it is compiled to a jump table.
+    bool run_key_command(DefaultKeyCommand key_command, MirKeyboardAction action);
+    /// Coalesces a key repeat of a resize or move binding. Returns whether the key
+    /// was consumed, or std::nullopt if [command] is not coalesced and must be run
+    /// as it is.
+    std::optional<bool> queue_repeat(DefaultKeyCommand command);
+    void flush_pending_repeat();
+    /// Applies [command] [count] times. Returns whether it did anything.
+    bool apply_repeat(DefaultKeyCommand command, int count);
+
+    /// Panels that animate their exclusive zone change it many times a second, so
+    /// the workspaces are only laid out again once the main loop gets to them.
+    bool is_application_zone_flush_queued = false;
+    void queue_application_zone_flush();
+
+    /// The layout saved by the process that restarted into this one. Each workspace
+    /// is restored once its output appears.
+    std::optional<LayoutCheckpoint> restored_layout;
+    void restore_layout(OutputInterface* output);
+    WorkspaceInterface* request_restored_workspace(OutputInterface* output, LayoutCheckpoint::Workspace const& saved);
+
+    /// The container that the pointer was last found to be over. While the pointer
+    /// moves within [area] with the same buttons and modifiers held, the result of
+    /// handling the motion is known without hit testing again.
+    ///
+    /// The hit is cleared whenever a window is created, destroyed, moved or resized,
+    /// or when focus or the outputs change.
+    struct PointerHit
+    {
+        std::weak_ptr<Container> container;
+        geom::Rectangle area;
+        Output const* output;
+        geom::Rectangle output_area;
+        MirPointerButtons buttons;
+        uint modifiers;
+    };
+
+    std::optional<PointerHit> pointer_hit;
+
+    /// A swipe across the workspaces of [swiped_output], made by scrolling sideways
+    /// with the primary modifier held. It ends once the scrolling stops.
+    std::optional<WorkspaceSwipe> workspace_swipe;
+    OutputInterface* swiped_output = nullptr;
+    std::unique_ptr<mir::time::Alarm> workspace_swipe_alarm;
+
+    /// Returns true if the event was taken as part of a workspace swipe.
+    bool handle_workspace_swipe(MirPointerAction action, float hscroll, uint modifiers);
+    /// Switches to the workspace that the swipe landed on, if any.
+    void end_workspace_swipe();
+
+    /// Told by Mir when the session is locked and unlocked.
+    class SessionLockObserver;
+    std::shared_ptr<mir::scene::SessionLock> session_lock;
+    std::shared_ptr<SessionLockObserver> session_lock_observer;
+
+    /// Hides every window from Mir while the session is locked, and shows them
+    /// again once it is unlocked. See [WindowManagerToolsWindowController::apply_session_lock].
+    void apply_session_lock();
+
+    bool is_pointer_hit(float x, float y, MirPointerButtons buttons, uint modifiers) const;
+    void remember_pointer_hit(std::shared_ptr<Container> const& container, MirPointerButtons buttons, uint modifiers);
 };
 }
 
@@ -0,0 +1,132 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_POOL_ALLOCATOR_H
+#define MIRACLE_WM_POOL_ALLOCATOR_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace miracle
+{
+
+/// Holds on to freed blocks of a single size so that they can be handed out again.
+class BlockFreeList
+{
+public:
+    explicit BlockFreeList(size_t capacity) :
+        capacity { capacity }
+    {
+        blocks.reserve(capacity);
+    }
+
+    BlockFreeList(BlockFreeList const&) = delete;
+    BlockFreeList& operator=(BlockFreeList const&) = delete;
+
+    ~BlockFreeList()
+    {
+        for (auto block : blocks)
+            ::operator delete(block);
+    }
+
+    /// Returns a recycled block, or nullptr if there are none.
+    void* pop()
+    {
+        std::lock_guard lock(mutex);
+        if (blocks.empty())
+            return nullptr;
+
+        auto block = blocks.back();
+        blocks.pop_back();
+        return block;
+    }
+
+    /// Keeps [block] for later. Returns false if the list is full, in which case
+    /// the caller still owns [block].
+    bool push(void* block)
+    {
+        std::lock_guard lock(mutex);
+        if (blocks.size() >= capacity)
+            return false;
+
+        blocks.push_back(block);
+        return true;
+    }
+
+private:
+    size_t const capacity;
+    std::mutex mutex;
+    std::vector<void*> blocks;
+};
+
+/// An allocator that recycles the memory of objects that are created and
+/// destroyed in rapid succession, such as animations. Use it with
+/// std::allocate_shared in place of std::make_shared.
+///
+/// Each type that the allocator is rebound to gets its own free list, so the
+/// blocks of the object and of its shared_ptr control block are pooled together.
+template <typename T>
+class PoolAllocator
+{
+public:
+    using value_type = T;
+
+    /// The number of freed blocks that are kept for each type.
+    static constexpr size_t pool_size = 64;
+
+    PoolAllocator() noexcept = default;
+
+    template <typename U>
+    PoolAllocator(PoolAllocator<U> const&) noexcept
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "Over-aligned types cannot be pooled");
+        if (n == 1)
+        {
+            if (auto block = free_list().pop())
+                return static_cast<T*>(block);
+        }
+
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept
+    {
+        if (n != 1 || !free_list().push(p))
+            ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(PoolAllocator<U> const&) const noexcept { return true; }
+
+private:
+    static BlockFreeList& free_list()
+    {
+        static BlockFreeList list(pool_size);
+        return list;
+    }
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_POOL_ALLOCATOR_H
@@ -0,0 +1,100 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "post_process_target.h"
+#include <mir/log.h>
+
+miracle::PostProcessTarget::PostProcessTarget(GLint filter) :
+    filter { filter }
+{
+}
+
+miracle::PostProcessTarget::~PostProcessTarget()
+{
+    release();
+}
+
+std::optional<int> miracle::PostProcessTarget::bind(mir::geometry::Size size, bool with_stencil)
+{
+    if (framebuffer && size == allocated_size && with_stencil == has_stencil)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        return 1;
+    }
+
+    release();
+    auto const width = size.width.as_int();
+    auto const height = size.height.as_int();
+
+    glGenTextures(1, &texture_);
+    glBindTexture(GL_TEXTURE_2D, texture_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture_, 0);
+
+    // The stencil is only used for the outline fallback, so it is left out when
+    // the border program is available
+    if (with_stencil)
+    {
+        glGenRenderbuffers(1, &stencil);
+        glBindRenderbuffer(GL_RENDERBUFFER, stencil);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_STENCIL_INDEX8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, stencil);
+    }
+
+    if (auto const status = glCheckFramebufferStatus(GL_FRAMEBUFFER); status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        mir::log_warning("PostProcessTarget: the offscreen framebuffer is incomplete: 0x%x", status);
+        release();
+        return std::nullopt;
+    }
+
+    allocated_size = size;
+    has_stencil = with_stencil;
+    return 0;
+}
+
+size_t miracle::PostProcessTarget::bytes() const
+{
+    if (!framebuffer)
+        return 0;
+
+    auto const pixels = static_cast<size_t>(allocated_size.width.as_int()) * static_cast<size_t>(allocated_size.height.as_int());
+    return pixels * 4 + (has_stencil ? pixels : 0);
+}
+
+void miracle::PostProcessTarget::release()
+{
+    if (framebuffer)
+        glDeleteFramebuffers(1, &framebuffer);
+    if (texture_)
+        glDeleteTextures(1, &texture_);
+    if (stencil)
+        glDeleteRenderbuffers(1, &stencil);
+
+    framebuffer = 0;
+    texture_ = 0;
+    stencil = 0;
+}
@@ -0,0 +1,69 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_POST_PROCESS_TARGET_H
+#define MIRACLE_WM_POST_PROCESS_TARGET_H
+
+#include <GLES2/gl2.h>
+#include <cstddef>
+#include <mir/geometry/size.h>
+#include <optional>
+
+namespace miracle
+{
+
+/// An offscreen framebuffer that an output is drawn into when a pass must run
+/// over the finished frame, such as an output-wide color filter.
+///
+/// The contents of the target survive from one frame to the next, so damage
+/// tracking treats it as a back buffer with an age of one. Must be
+/// constructed, used and destroyed with the same GL context current.
+class PostProcessTarget
+{
+public:
+    /// [filter] is how the texture of the target is sampled when it is scaled.
+    explicit PostProcessTarget(GLint filter = GL_NEAREST);
+    ~PostProcessTarget();
+
+    PostProcessTarget(PostProcessTarget const&) = delete;
+    PostProcessTarget& operator=(PostProcessTarget const&) = delete;
+
+    /// Binds the target for drawing, (re)allocating it first if it does not
+    /// match [size]. Returns the age of its contents: 1 if they are the
+    /// previous frame, or 0 if they were just allocated. Returns std::nullopt
+    /// if the driver cannot draw to such a target, in which case nothing is bound.
+    std::optional<int> bind(mir::geometry::Size size, bool with_stencil);
+
+    [[nodiscard]] GLuint texture() const { return texture_; }
+
+    /// The video memory held by the target, or 0 if it is not allocated.
+    [[nodiscard]] size_t bytes() const;
+
+private:
+    void release();
+
+    GLint const filter;
+    GLuint framebuffer = 0;
+    GLuint texture_ = 0;
+    GLuint stencil = 0;
+    mir::geometry::Size allocated_size;
+    bool has_stencil = false;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_POST_PROCESS_TARGET_H
@@ -0,0 +1,145 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#define MIR_LOG_COMPONENT "program_binary_cache"
+
+#include "program_binary_cache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <mir/log.h>
+
+using namespace miracle;
+
+namespace
+{
+constexpr std::uint32_t magic = 0x4250574d; // "MWPB"
+constexpr std::uint32_t version = 1;
+
+struct Header
+{
+    std::uint32_t magic = 0;
+    std::uint32_t version = 0;
+    std::uint32_t format = 0;
+    std::uint32_t reserved = 0;
+    std::uint64_t size = 0;
+};
+
+/// FNV-1a, which is plenty for telling shader sources apart.
+void hash_into(std::uint64_t& hash, std::string_view data)
+{
+    for (unsigned char c : data)
+    {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+
+    // Separate the inputs so that ("ab", "c") and ("a", "bc") differ.
+    hash ^= 0xff;
+    hash *= 0x100000001b3ull;
+}
+}
+
+ProgramBinaryCache::ProgramBinaryCache(std::filesystem::path directory, std::string driver) :
+    directory { std::move(directory) },
+    driver { std::move(driver) }
+{
+}
+
+std::string ProgramBinaryCache::key(std::initializer_list<std::string_view> sources) const
+{
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    hash_into(hash, driver);
+    for (auto const& source : sources)
+        hash_into(hash, source);
+
+    char result[17];
+    snprintf(result, sizeof(result), "%016llx", static_cast<unsigned long long>(hash));
+    return result;
+}
+
+std::filesystem::path ProgramBinaryCache::path_for(std::string const& key) const
+{
+    return directory / (key + ".bin");
+}
+
+std::optional<ProgramBinary> ProgramBinaryCache::load(std::string const& key) const
+{
+    std::ifstream file(path_for(key), std::ios::binary);
+    if (!file)
+        return std::nullopt;
+
+    Header header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || header.magic != magic
+        || header.version != version
+        || header.size == 0)
+        return std::nullopt;
+
+    ProgramBinary binary { .format = header.format };
+    binary.data.resize(header.size);
+    if (!file.read(binary.data.data(), static_cast<std::streamsize>(header.size)))
+        return std::nullopt;
+
+    return binary;
+}
+
+void ProgramBinaryCache::store(std::string const& key, ProgramBinary const& binary) const
+{
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec)
+    {
+        mir::log_warning("Unable to create the program cache directory %s: %s", directory.c_str(), ec.message().c_str());
+        return;
+    }
+
+    // Write to a temporary file first so that a crash never leaves a truncated entry behind.
+    auto const path = path_for(key);
+    auto temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        Header const header {
+            .magic = magic,
+            .version = version,
+            .format = binary.format,
+            .size = binary.data.size()
+        };
+        file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        file.write(binary.data.data(), static_cast<std::streamsize>(binary.data.size()));
+        if (!file)
+        {
+            mir::log_warning("Unable to write the program cache entry %s", temporary.c_str());
+            std::filesystem::remove(temporary, ec);
+            return;
+        }
+    }
+
+    std::filesystem::rename(temporary, path, ec);
+    if (ec)
+    {
+        mir::log_warning("Unable to write the program cache entry %s: %s", path.c_str(), ec.message().c_str());
+        std::filesystem::remove(temporary, ec);
+    }
+}
+
+void ProgramBinaryCache::erase(std::string const& key) const
+{
+    std::error_code ec;
+    std::filesystem::remove(path_for(key), ec);
+}
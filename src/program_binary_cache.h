@@ -0,0 +1,69 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_PROGRAM_BINARY_CACHE_H
+#define MIRACLE_WM_PROGRAM_BINARY_CACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace miracle
+{
+
+/// A linked program as returned by glGetProgramBinaryOES.
+struct ProgramBinary
+{
+    std::uint32_t format = 0;
+    std::vector<char> data;
+
+    bool operator==(ProgramBinary const&) const = default;
+};
+
+/// Stores linked program binaries on disk so that the shaders do not need to
+/// be compiled again the next time that the compositor starts.
+///
+/// Binaries are only valid for the driver that produced them, so the driver
+/// identifier is part of every key.
+class ProgramBinaryCache
+{
+public:
+    ProgramBinaryCache(std::filesystem::path directory, std::string driver);
+
+    /// Returns the key for a program built from [sources].
+    [[nodiscard]] std::string key(std::initializer_list<std::string_view> sources) const;
+
+    [[nodiscard]] std::optional<ProgramBinary> load(std::string const& key) const;
+    void store(std::string const& key, ProgramBinary const& binary) const;
+
+    /// Removes the entry for [key], e.g. after the driver rejected the binary.
+    void erase(std::string const& key) const;
+
+private:
+    [[nodiscard]] std::filesystem::path path_for(std::string const& key) const;
+
+    std::filesystem::path directory;
+    std::string driver;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_PROGRAM_BINARY_CACHE_H
@@ -18,6 +18,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIR_LOG_COMPONENT "program_factory"
 
 #include "program_factory.h"
+#include "program_binary_cache.h"
+#include <EGL/egl.h>
+#include <cstring>
+#include <glib-2.0/glib.h>
 #include <mir/graphics/egl_error.h>
 #include <mir/log.h>
 #include <sstream>
@@ -44,20 +48,154 @@ void main() {
 }
 )";
 
-const GLchar* const mode_scale_integration = R"(
-uniform int mode;
+const GLchar* const border_vertex_shader_src = R"(
+attribute vec3 position;
+attribute vec4 color;
+
+uniform mat4 screen_to_gl_coords;
+uniform mat4 display_transform;
+
+varying vec4 v_color;
+
+void main() {
+   gl_Position = display_transform * screen_to_gl_coords * vec4(position, 1.0);
+   v_color = color;
+}
+)";
+
+const GLchar* const border_fragment_shader_src = R"(
+#ifdef GL_ES
+precision mediump float;
+#endif
+
+varying vec4 v_color;
+
+void main() {
+    gl_FragColor = v_color;
+}
+)";
+
+const GLchar* const post_process_vertex_shader_src = R"(
+attribute vec2 position;
+
+varying vec2 v_texcoord;
+
+void main() {
+   gl_Position = vec4(position, 0.0, 1.0);
+   v_texcoord = position * 0.5 + 0.5;
+}
+)";
+
+// The colors are premultiplied, which the matrix does not mind as it is linear.
+const GLchar* const post_process_fragment_shader_src = R"(
+#ifdef GL_ES
+precision mediump float;
+#endif
+
+uniform sampler2D tex;
+uniform mat3 color_matrix;
+
+varying vec2 v_texcoord;
+
+void main() {
+    vec4 color = texture2D(tex, v_texcoord);
+    gl_FragColor = vec4(clamp(color_matrix * color.rgb, 0.0, color.a), color.a);
+}
+)";
+
+// The two halves of a dual kawase blur (Marius Bjørge, "Bandwidth-Efficient
+// Rendering", 2015). Each pass samples between texels to get four of them for
+// the price of one, so a wide blur takes few samples at a low resolution.
+const GLchar* const blur_downsample_fragment_shader_src = R"(
+#ifdef GL_ES
+precision mediump float;
+#endif
+
+uniform sampler2D tex;
+uniform vec2 half_pixel;
+
+varying vec2 v_texcoord;
+
+void main() {
+    vec4 sum = texture2D(tex, v_texcoord) * 4.0;
+    sum += texture2D(tex, v_texcoord - half_pixel);
+    sum += texture2D(tex, v_texcoord + half_pixel);
+    sum += texture2D(tex, v_texcoord + vec2(half_pixel.x, -half_pixel.y));
+    sum += texture2D(tex, v_texcoord - vec2(half_pixel.x, -half_pixel.y));
+    gl_FragColor = sum / 8.0;
+}
+)";
+
+const GLchar* const blur_upsample_fragment_shader_src = R"(
+#ifdef GL_ES
+precision mediump float;
+#endif
+
+uniform sampler2D tex;
+uniform vec2 half_pixel;
 
+varying vec2 v_texcoord;
+
+void main() {
+    vec4 sum = texture2D(tex, v_texcoord + vec2(-half_pixel.x * 2.0, 0.0));
+    sum += texture2D(tex, v_texcoord + vec2(-half_pixel.x, half_pixel.y)) * 2.0;
+    sum += texture2D(tex, v_texcoord + vec2(0.0, half_pixel.y * 2.0));
+    sum += texture2D(tex, v_texcoord + vec2(half_pixel.x, half_pixel.y)) * 2.0;
+    sum += texture2D(tex, v_texcoord + vec2(half_pixel.x * 2.0, 0.0));
+    sum += texture2D(tex, v_texcoord + vec2(half_pixel.x, -half_pixel.y)) * 2.0;
+    sum += texture2D(tex, v_texcoord + vec2(0.0, -half_pixel.y * 2.0));
+    sum += texture2D(tex, v_texcoord + vec2(-half_pixel.x, -half_pixel.y)) * 2.0;
+    gl_FragColor = sum / 12.0;
+}
+)";
+
+const GLchar* const unfiltered_resolve_color = R"(
 vec4 resolve_color(vec4 v) {
-    if (mode == 1) {
-        float color =  0.299 * v.x + 0.587 * v.y + 0.114 * v.z;
-        return vec4(color, color, color, v.w);
-    }
-    else {
-        return v;
-    }
+    return v;
+}
+)";
+
+const GLchar* const grayscale_resolve_color = R"(
+vec4 resolve_color(vec4 v) {
+    float color =  0.299 * v.x + 0.587 * v.y + 0.114 * v.z;
+    return vec4(color, color, color, v.w);
 }
 )";
 
+/// Returns the `resolve_color` function that applies [filter], or nullptr if
+/// the filter draws like [RenderFilter::none].
+GLchar const* resolve_color_src(miracle::RenderFilter filter)
+{
+    switch (filter)
+    {
+    case miracle::RenderFilter::none:
+        return unfiltered_resolve_color;
+    case miracle::RenderFilter::grayscale:
+        return grayscale_resolve_color;
+    default:
+        return nullptr;
+    }
+}
+
+char const* gl_string(GLenum name)
+{
+    auto const* value = reinterpret_cast<char const*>(glGetString(name));
+    return value ? value : "";
+}
+
+bool has_extension(char const* extension)
+{
+    // Extensions are space-separated, so make sure that we do not match a prefix of another.
+    auto const* extensions = gl_string(GL_EXTENSIONS);
+    auto const length = strlen(extension);
+    for (auto const* p = strstr(extensions, extension); p; p = strstr(p + length, extension))
+    {
+        if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0'))
+            return true;
+    }
+
+    return false;
+}
 }
 
 miracle::ProgramData::ProgramData(GLuint program_id)
@@ -101,16 +239,42 @@ miracle::ProgramData::ProgramData(GLuint program_id)
     if (alpha_uniform < 0)
         mir::log_warning("Program is missing alpha_uniform");
 
-    mode_uniform = glGetUniformLocation(id, "mode");
-    if (mode_uniform < 0)
-        mir::log_warning("Program is missing mode_uniform");
-
     outline_color_uniform = glGetUniformLocation(id, "outline_color");
     if (outline_color_uniform < 0)
         mir::log_warning("Program is missing outline_color_uniform");
+    blur_tex_uniform = glGetUniformLocation(id, "blur_tex");
+    blur_scale_uniform = glGetUniformLocation(id, "blur_scale");
 }
 
-miracle::Program::Program(
+miracle::BorderProgramData::BorderProgramData(ProgramHandle&& program) :
+    handle { std::move(program) },
+    id { handle }
+{
+    position_attr = glGetAttribLocation(id, "position");
+    color_attr = glGetAttribLocation(id, "color");
+    display_transform_uniform = glGetUniformLocation(id, "display_transform");
+    screen_to_gl_coords_uniform = glGetUniformLocation(id, "screen_to_gl_coords");
+}
+
+miracle::PostProcessProgramData::PostProcessProgramData(ProgramHandle&& program) :
+    handle { std::move(program) },
+    id { handle }
+{
+    position_attr = glGetAttribLocation(id, "position");
+    tex_uniform = glGetUniformLocation(id, "tex");
+    color_matrix_uniform = glGetUniformLocation(id, "color_matrix");
+}
+
+miracle::BlurProgramData::BlurProgramData(ProgramHandle&& program) :
+    handle { std::move(program) },
+    id { handle }
+{
+    position_attr = glGetAttribLocation(id, "position");
+    tex_uniform = glGetUniformLocation(id, "tex");
+    half_pixel_uniform = glGetUniformLocation(id, "half_pixel");
+}
+
+miracle::ProgramVariant::ProgramVariant(
     ProgramHandle&& opaque_shader, ProgramHandle&& alpha_shader, ProgramHandle&& outline_shader) :
     opaque_handle(std::move(opaque_shader)),
     alpha_handle(std::move(alpha_shader)),
@@ -121,9 +285,119 @@ miracle::Program::Program(
 {
 }
 
+miracle::Program::Program(
+    std::string extension_fragment, std::string fragment_fragment, std::unique_ptr<ProgramVariant> unfiltered) :
+    extension_fragment { std::move(extension_fragment) },
+    fragment_fragment { std::move(fragment_fragment) }
+{
+    variants[static_cast<size_t>(RenderFilter::none)] = std::move(unfiltered);
+}
+
 miracle::ProgramFactory::ProgramFactory() :
     vertex_shader { compile_shader(GL_VERTEX_SHADER, vertex_shader_src) }
 {
+    try
+    {
+        ShaderHandle const border_vertex_shader {
+            compile_shader(GL_VERTEX_SHADER, border_vertex_shader_src)
+        };
+        ShaderHandle const border_fragment_shader {
+            compile_shader(GL_FRAGMENT_SHADER, border_fragment_shader_src)
+        };
+        border_program_ = std::make_unique<BorderProgramData>(
+            link_shader(border_vertex_shader, border_fragment_shader));
+    }
+    catch (std::exception const& e)
+    {
+        mir::log_warning("Unable to compile the border program, falling back to stencil outlines: %s", e.what());
+    }
+
+    GLint num_binary_formats = 0;
+    if (has_extension("GL_OES_get_program_binary"))
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &num_binary_formats);
+
+    get_program_binary = num_binary_formats > 0
+        ? reinterpret_cast<PFNGLGETPROGRAMBINARYOESPROC>(eglGetProcAddress("glGetProgramBinaryOES"))
+        : nullptr;
+    program_binary = num_binary_formats > 0
+        ? reinterpret_cast<PFNGLPROGRAMBINARYOESPROC>(eglGetProcAddress("glProgramBinaryOES"))
+        : nullptr;
+    if (get_program_binary && program_binary)
+    {
+        std::string driver = gl_string(GL_VENDOR);
+        driver += '\n';
+        driver += gl_string(GL_RENDERER);
+        driver += '\n';
+        driver += gl_string(GL_VERSION);
+        binary_cache = std::make_unique<ProgramBinaryCache>(
+            std::filesystem::path(g_get_user_cache_dir()) / "miracle-wm" / "programs",
+            driver);
+    }
+    else
+        mir::log_info("Program binaries are not supported by this driver, shaders will be compiled on every start");
+}
+
+miracle::ProgramFactory::~ProgramFactory() = default;
+
+miracle::BorderProgramData const* miracle::ProgramFactory::border_program() const
+{
+    return border_program_.get();
+}
+
+miracle::PostProcessProgramData const* miracle::ProgramFactory::post_process_program()
+{
+    std::lock_guard lock { compilation_mutex };
+    if (!post_process_program_ && !post_process_program_failed)
+    {
+        try
+        {
+            ShaderHandle const post_process_vertex_shader {
+                compile_shader(GL_VERTEX_SHADER, post_process_vertex_shader_src)
+            };
+            ShaderHandle const post_process_fragment_shader {
+                compile_shader(GL_FRAGMENT_SHADER, post_process_fragment_shader_src)
+            };
+            post_process_program_ = std::make_unique<PostProcessProgramData>(
+                link_shader(post_process_vertex_shader, post_process_fragment_shader));
+        }
+        catch (std::exception const& e)
+        {
+            mir::log_warning("Unable to compile the post-process program, color filters are disabled: %s", e.what());
+            post_process_program_failed = true;
+        }
+    }
+
+    return post_process_program_.get();
+}
+
+miracle::BlurPrograms const* miracle::ProgramFactory::blur_programs()
+{
+    std::lock_guard lock { compilation_mutex };
+    if (!blur_programs_ && !blur_programs_failed)
+    {
+        try
+        {
+            ShaderHandle const vertex {
+                compile_shader(GL_VERTEX_SHADER, post_process_vertex_shader_src)
+            };
+            ShaderHandle const downsample {
+                compile_shader(GL_FRAGMENT_SHADER, blur_downsample_fragment_shader_src)
+            };
+            ShaderHandle const upsample {
+                compile_shader(GL_FRAGMENT_SHADER, blur_upsample_fragment_shader_src)
+            };
+            blur_programs_ = std::make_unique<BlurPrograms>(BlurPrograms {
+                BlurProgramData { link_shader(vertex, downsample) },
+                BlurProgramData { link_shader(vertex, upsample) } });
+        }
+        catch (std::exception const& e)
+        {
+            mir::log_warning("Unable to compile the blur programs, blur is disabled: %s", e.what());
+            blur_programs_failed = true;
+        }
+    }
+
+    return blur_programs_.get();
 }
 
 mir::graphics::gl::Program& miracle::ProgramFactory::compile_fragment_shader(
@@ -135,13 +409,69 @@ mir::graphics::gl::Program& miracle::ProgramFactory::compile_fragment_shader(
      * per rendering thread.
      */
 
-    for (auto const& pair : programs)
-    {
-        if (pair.first == id)
-        {
-            return *pair.second;
-        }
-    }
+    if (auto it = programs.find(id); it != programs.end())
+        return *it->second;
+
+    auto unfiltered = build_variant(extension_fragment, fragment_fragment, RenderFilter::none);
+    auto const& [it, _] = programs.emplace(id, std::make_unique<miracle::Program>(
+        extension_fragment, fragment_fragment, std::move(unfiltered)));
+    return *it->second;
+}
+
+miracle::ProgramVariant const& miracle::ProgramFactory::variant(Program const& program, RenderFilter filter)
+{
+    auto const index = static_cast<size_t>(filter);
+    if (index >= program.variants.size() || !resolve_color_src(filter))
+        return program.unfiltered();
+
+    auto& variant = program.variants[index];
+    if (!variant)
+        variant = build_variant(program.extension_fragment, program.fragment_fragment, filter);
+    return *variant;
+}
+
+miracle::ProgramData const& miracle::ProgramFactory::blurred(Program const& program, RenderFilter filter)
+{
+    auto const& family = variant(program, filter);
+    if (family.blurred)
+        return *family.blurred;
+
+    // The blurred background has the layout of the framebuffer, so it is sampled by
+    // fragment position. Fully transparent pixels, such as the corners of rounded
+    // windows, are left transparent rather than filled with the background.
+    std::stringstream blurred_fragment;
+    blurred_fragment
+        << program.extension_fragment
+        << "\n"
+        << "#ifdef GL_ES\n"
+           "precision mediump float;\n"
+           "#endif\n"
+        << "\n"
+        << program.fragment_fragment
+        << "\n"
+        << resolve_color_src(resolve_color_src(filter) ? filter : RenderFilter::none)
+        << "varying vec2 v_texcoord;\n"
+           "uniform float alpha;\n"
+           "uniform sampler2D blur_tex;\n"
+           "uniform vec2 blur_scale;\n"
+           "void main() {\n"
+           "    vec4 color = alpha * resolve_color(sample_to_rgba(v_texcoord));\n"
+           "    vec4 background = texture2D(blur_tex, gl_FragCoord.xy * blur_scale);\n"
+           "    gl_FragColor = color + (1.0 - color.a) * sign(color.a) * background;\n"
+           "}\n";
+
+    std::lock_guard lock { compilation_mutex };
+    family.blurred_handle.emplace(build_program(blurred_fragment.str()));
+    family.blurred.emplace(*family.blurred_handle);
+    return *family.blurred;
+}
+
+std::unique_ptr<miracle::ProgramVariant> miracle::ProgramFactory::build_variant(
+    std::string const& extension_fragment,
+    std::string const& fragment_fragment,
+    RenderFilter filter)
+{
+    auto const* const resolve_color = resolve_color_src(filter);
 
     std::stringstream opaque_fragment;
     opaque_fragment
@@ -153,7 +483,7 @@ mir::graphics::gl::Program& miracle::ProgramFactory::compile_fragment_shader(
         << "\n"
         << fragment_fragment
         << "\n"
-        << mode_scale_integration
+        << resolve_color
         << "varying vec2 v_texcoord;\n"
            "void main() {\n"
            "    gl_FragColor = resolve_color(sample_to_rgba(v_texcoord));\n"
@@ -169,7 +499,7 @@ mir::graphics::gl::Program& miracle::ProgramFactory::compile_fragment_shader(
         << "\n"
         << fragment_fragment
         << "\n"
-        << mode_scale_integration
+        << resolve_color
         << "varying vec2 v_texcoord;\n"
            "uniform float alpha;\n"
            "void main() {\n"
@@ -183,7 +513,7 @@ mir::graphics::gl::Program& miracle::ProgramFactory::compile_fragment_shader(
            "precision mediump float;\n"
            "#endif\n"
         << "\n"
-        << mode_scale_integration
+        << resolve_color
         << "uniform float alpha;\n"
         << "uniform vec4 outline_color;\n"
         << "void main() {\n"
@@ -193,22 +523,64 @@ mir::graphics::gl::Program& miracle::ProgramFactory::compile_fragment_shader(
     // GL shader compilation is *not* threadsafe, and requires external synchronisation
     std::lock_guard lock { compilation_mutex };
 
-    ShaderHandle const opaque_shader {
-        compile_shader(GL_FRAGMENT_SHADER, opaque_fragment.str().c_str())
-    };
-    ShaderHandle const alpha_shader {
-        compile_shader(GL_FRAGMENT_SHADER, alpha_fragment.str().c_str())
-    };
-    ShaderHandle const outline_shader {
-        compile_shader(GL_FRAGMENT_SHADER, outline_shader_src.str().c_str())
-    };
+    auto opaque_program = build_program(opaque_fragment.str());
+    auto alpha_program = build_program(alpha_fragment.str());
+    auto outline_program = build_program(outline_shader_src.str());
+    return std::make_unique<ProgramVariant>(
+        std::move(opaque_program), std::move(alpha_program), std::move(outline_program));
+}
 
-    programs.emplace_back(id, std::make_unique<miracle::Program>(link_shader(vertex_shader, opaque_shader), link_shader(vertex_shader, alpha_shader), link_shader(vertex_shader, outline_shader)));
+miracle::ProgramHandle miracle::ProgramFactory::build_program(std::string const& fragment_src)
+{
+    std::string key;
+    if (binary_cache)
+    {
+        key = binary_cache->key({ vertex_shader_src, fragment_src });
+        if (auto binary = binary_cache->load(key))
+        {
+            ProgramHandle program { glCreateProgram() };
+            program_binary(program, binary->format, binary->data.data(), static_cast<GLint>(binary->data.size()));
+            GLint ok = GL_FALSE;
+            glGetProgramiv(program, GL_LINK_STATUS, &ok);
+            if (ok)
+                return program;
+
+            // Most likely a driver update that did not change the version string.
+            mir::log_info("Cached program binary %s was rejected, compiling from source", key.c_str());
+            binary_cache->erase(key);
+        }
+    }
 
-    return *programs.back().second;
+    // We delete the fragment shader at the end of this scope. This is fine; it only marks it
+    // for deletion. GL will only delete it once the GL Program it's linked in is destroyed.
+    ShaderHandle const fragment_shader {
+        compile_shader(GL_FRAGMENT_SHADER, fragment_src.c_str())
+    };
+    auto program = link_shader(vertex_shader, fragment_shader);
+    if (binary_cache)
+        store_binary(key, program);
 
-    // We delete opaque_shader and alpha_shader here. This is fine; it only marks them
-    // for deletion. GL will only delete them once the GL Program they're linked in is destroyed.
+    return program;
+}
+
+void miracle::ProgramFactory::store_binary(std::string const& key, GLuint program)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+    if (length <= 0)
+        return;
+
+    ProgramBinary binary;
+    binary.data.resize(length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    get_program_binary(program, length, &written, &format, binary.data.data());
+    if (written <= 0)
+        return;
+
+    binary.format = format;
+    binary.data.resize(written);
+    binary_cache->store(key, binary);
 }
 
 GLuint miracle::ProgramFactory::compile_shader(GLenum type, GLchar const* src)
@@ -18,15 +18,21 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef MIRACLE_WM_PROGRAM_FACTORY_H
 #define MIRACLE_WM_PROGRAM_FACTORY_H
 
+#include "render_filter.h"
 #include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
 #include <array>
+#include <memory>
 #include <mir/graphics/program.h>
 #include <mir/graphics/program_factory.h>
 #include <mutex>
-#include <vector>
+#include <optional>
+#include <string>
+#include <unordered_map>
 
 namespace miracle
 {
+class ProgramBinaryCache;
 
 template <void (*deleter)(GLuint)>
 class GLHandle
@@ -81,38 +87,141 @@ struct ProgramData
     GLint transform_uniform = -1;
     GLint screen_to_gl_coords_uniform = -1;
     GLint alpha_uniform = -1;
-    GLint mode_uniform = -1;
     GLint outline_color_uniform = -1;
+    GLint blur_tex_uniform = -1;
+    GLint blur_scale_uniform = -1;
     mutable long long last_used_frameno = 0;
 
     ProgramData(GLuint program_id);
 };
 
-struct Program : public mir::graphics::gl::Program
+/// A program that draws solid-colored geometry. Positions are expected to
+/// already be transformed into the screen space of the output.
+struct BorderProgramData
 {
-public:
-    Program(ProgramHandle&& opaque_shader, ProgramHandle&& alpha_shader, ProgramHandle&& outline_shader);
+    explicit BorderProgramData(ProgramHandle&& program);
+    ProgramHandle handle;
+    GLuint id = 0;
+    GLint position_attr = -1;
+    GLint color_attr = -1;
+    GLint display_transform_uniform = -1;
+    GLint screen_to_gl_coords_uniform = -1;
+};
+
+/// A program that draws a texture over the whole output through a color matrix.
+struct PostProcessProgramData
+{
+    explicit PostProcessProgramData(ProgramHandle&& program);
+    ProgramHandle handle;
+    GLuint id = 0;
+    GLint position_attr = -1;
+    GLint tex_uniform = -1;
+    GLint color_matrix_uniform = -1;
+};
+
+/// One pass of the blur, which draws [tex] over the whole of the bound framebuffer.
+struct BlurProgramData
+{
+    explicit BlurProgramData(ProgramHandle&& program);
+    ProgramHandle handle;
+    GLuint id = 0;
+    GLint position_attr = -1;
+    GLint tex_uniform = -1;
+    GLint half_pixel_uniform = -1;
+};
+
+struct BlurPrograms
+{
+    BlurProgramData downsample;
+    BlurProgramData upsample;
+};
+
+/// The programs that draw one kind of buffer through one [RenderFilter].
+struct ProgramVariant
+{
+    ProgramVariant(ProgramHandle&& opaque_shader, ProgramHandle&& alpha_shader, ProgramHandle&& outline_shader);
     ProgramHandle opaque_handle, alpha_handle, outline_handle;
     ProgramData opaque, alpha, outline;
+
+    /// Draws a translucent window over the blurred background. Built by
+    /// [ProgramFactory::blurred] the first time that it is needed.
+    mutable std::optional<ProgramHandle> blurred_handle;
+    mutable std::optional<ProgramData> blurred;
+};
+
+/// The programs that draw one kind of buffer, with a variant for each [RenderFilter].
+/// The unfiltered variant is built up front, while the others are built by
+/// [ProgramFactory::variant] the first time that they are drawn with.
+struct Program : public mir::graphics::gl::Program
+{
+public:
+    Program(std::string extension_fragment, std::string fragment_fragment, std::unique_ptr<ProgramVariant> unfiltered);
+
+    [[nodiscard]] ProgramVariant const& unfiltered() const { return *variants[0]; }
+
+    std::string const extension_fragment;
+    std::string const fragment_fragment;
+    mutable std::array<std::unique_ptr<ProgramVariant>, static_cast<size_t>(RenderFilter::max)> variants;
 };
 
 class ProgramFactory : public mir::graphics::gl::ProgramFactory
 {
 public:
     ProgramFactory();
+    ~ProgramFactory();
     mir::graphics::gl::Program& compile_fragment_shader(
         void const* id,
         char const* extension_fragment,
         char const* fragment_fragment) override;
 
+    /// Returns the variant of [program] that applies [filter], building it if
+    /// this is the first time that it is needed.
+    ProgramVariant const& variant(Program const& program, RenderFilter filter);
+
+    /// Returns the program used to draw the borders of all windows in a single
+    /// batch, or nullptr if it could not be compiled on this platform.
+    [[nodiscard]] BorderProgramData const* border_program() const;
+
+    /// Returns the program that applies an output-wide color filter, or nullptr
+    /// if it could not be compiled on this platform. It is compiled the first
+    /// time that it is asked for, so outputs without a filter never pay for it.
+    PostProcessProgramData const* post_process_program();
+
+    /// Returns the programs that blur the background of translucent windows, or
+    /// nullptr if they could not be compiled. Like [post_process_program], they
+    /// are compiled the first time that they are asked for.
+    BlurPrograms const* blur_programs();
+
+    /// Returns the alpha program of [program] that composites it over the
+    /// blurred background, building it if this is the first time that it is needed.
+    ProgramData const& blurred(Program const& program, RenderFilter filter);
+
 private:
     static GLuint compile_shader(GLenum type, GLchar const* src);
+    std::unique_ptr<ProgramVariant> build_variant(
+        std::string const& extension_fragment,
+        std::string const& fragment_fragment,
+        RenderFilter filter);
     static ProgramHandle link_shader(
         ShaderHandle const& vertex_shader,
         ShaderHandle const& fragment_shader);
 
+    /// Links [fragment_src] against the texture vertex shader, reusing the binary
+    /// from a previous run of the compositor if there is one.
+    ProgramHandle build_program(std::string const& fragment_src);
+    void store_binary(std::string const& key, GLuint program);
+
     ShaderHandle const vertex_shader;
-    std::vector<std::pair<void const*, std::unique_ptr<Program>>> programs;
+    std::unique_ptr<BorderProgramData> border_program_;
+    std::unique_ptr<PostProcessProgramData> post_process_program_;
+    bool post_process_program_failed = false;
+    std::unique_ptr<BlurPrograms> blur_programs_;
+    bool blur_programs_failed = false;
+    std::unordered_map<void const*, std::unique_ptr<Program>> programs;
+    /// Null when the driver cannot hand out program binaries.
+    std::unique_ptr<ProgramBinaryCache> binary_cache;
+    PFNGLGETPROGRAMBINARYOESPROC get_program_binary = nullptr;
+    PFNGLPROGRAMBINARYOESPROC program_binary = nullptr;
     // GL requires us to synchronise multi-threaded access to the shader APIs.
     std::mutex compilation_mutex;
 };
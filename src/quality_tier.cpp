@@ -0,0 +1,72 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "quality_tier.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace
+{
+/// Names that software renderers give themselves in GL_RENDERER, in lower case.
+constexpr std::string_view software_renderers[] = {
+    "llvmpipe",
+    "softpipe",
+    "swrast",
+    "software rasterizer",
+    "swiftshader",
+    "microsoft basic render",
+};
+
+bool contains_ignoring_case(std::string_view haystack, std::string_view needle)
+{
+    return std::ranges::search(haystack, needle, [](char left, char right)
+    {
+        return std::tolower(static_cast<unsigned char>(left)) == right;
+    }).begin() != haystack.end();
+}
+}
+
+std::optional<miracle::QualityTier> miracle::from_string_quality_tier(std::string const& tier)
+{
+    if (tier == "full")
+        return QualityTier::full;
+    else if (tier == "reduced")
+        return QualityTier::reduced;
+    else
+        return std::nullopt;
+}
+
+char const* miracle::to_string(QualityTier tier)
+{
+    switch (tier)
+    {
+    case QualityTier::reduced:
+        return "reduced";
+    default:
+        return "full";
+    }
+}
+
+miracle::QualityTier miracle::detect_quality_tier(std::string_view gl_renderer)
+{
+    auto const is_software = std::ranges::any_of(software_renderers, [&](std::string_view name)
+    {
+        return contains_ignoring_case(gl_renderer, name);
+    });
+    return is_software ? QualityTier::reduced : QualityTier::full;
+}
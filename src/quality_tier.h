@@ -0,0 +1,48 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_QUALITY_TIER_H
+#define MIRACLE_WM_QUALITY_TIER_H
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace miracle
+{
+
+/// How much the compositor spends on making things look good.
+enum class QualityTier : int
+{
+    /// Every animation and effect that is configured.
+    full,
+    /// For renderers that draw on the CPU. Animations and blur are turned off, and
+    /// outputs are drawn offscreen if that is what it takes to redraw only the damage.
+    reduced,
+    max
+};
+
+std::optional<QualityTier> from_string_quality_tier(std::string const&);
+char const* to_string(QualityTier);
+
+/// The tier that suits the renderer that GL_RENDERER names as [gl_renderer].
+/// Software renderers, such as llvmpipe, are given the [QualityTier::reduced] tier.
+QualityTier detect_quality_tier(std::string_view gl_renderer);
+
+} // miracle
+
+#endif // MIRACLE_WM_QUALITY_TIER_H
@@ -0,0 +1,182 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_RECTANGLE_INDEX_H
+#define MIRACLE_WM_RECTANGLE_INDEX_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <mir/geometry/rectangle.h>
+#include <vector>
+
+namespace miracle
+{
+
+/// A uniform grid over a set of rectangles that answers which of them contains
+/// a point without testing each one.
+///
+/// The index is built once from all of its entries and must be rebuilt when any
+/// of them changes. When several entries contain a point, the one that came
+/// first is found, so overlapping entries should be given topmost first.
+template <typename T>
+class RectangleIndex
+{
+public:
+    struct Entry
+    {
+        mir::geometry::Rectangle area;
+        T value;
+    };
+
+    /// The most cells along either axis of the grid.
+    static constexpr int max_cells_per_axis = 32;
+
+    RectangleIndex() = default;
+
+    explicit RectangleIndex(std::vector<Entry> entries)
+    {
+        build(std::move(entries));
+    }
+
+    void build(std::vector<Entry> next_entries)
+    {
+        entries = std::move(next_entries);
+        cell_offsets.clear();
+        cell_entries.clear();
+        columns = 0;
+        rows = 0;
+
+        bool has_bounds = false;
+        for (auto const& entry : entries)
+        {
+            if (entry.area.size.width.as_int() <= 0 || entry.area.size.height.as_int() <= 0)
+                continue;
+
+            if (!has_bounds)
+            {
+                left = entry.area.left().as_int();
+                top = entry.area.top().as_int();
+                right = entry.area.right().as_int();
+                bottom = entry.area.bottom().as_int();
+                has_bounds = true;
+                continue;
+            }
+
+            left = std::min(left, entry.area.left().as_int());
+            top = std::min(top, entry.area.top().as_int());
+            right = std::max(right, entry.area.right().as_int());
+            bottom = std::max(bottom, entry.area.bottom().as_int());
+        }
+
+        if (!has_bounds)
+            return;
+
+        auto const per_axis = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(entries.size()))));
+        columns = std::clamp(per_axis, 1, std::min(max_cells_per_axis, right - left));
+        rows = std::clamp(per_axis, 1, std::min(max_cells_per_axis, bottom - top));
+        cell_width = (right - left + columns - 1) / columns;
+        cell_height = (bottom - top + rows - 1) / rows;
+
+        // Count the entries of each cell, then lay the cells out back to back
+        cell_offsets.assign(static_cast<size_t>(columns * rows) + 1, 0);
+        for_each_cell([&](size_t cell, size_t)
+        {
+            cell_offsets[cell + 1]++;
+        });
+        for (size_t i = 1; i < cell_offsets.size(); i++)
+            cell_offsets[i] += cell_offsets[i - 1];
+
+        auto next = cell_offsets;
+        cell_entries.resize(cell_offsets.back());
+        for_each_cell([&](size_t cell, size_t index)
+        {
+            cell_entries[next[cell]++] = static_cast<uint32_t>(index);
+        });
+    }
+
+    /// Returns the first entry that contains [point] and whose value is accepted
+    /// by [accept], or nullptr if there is none.
+    template <typename F>
+    [[nodiscard]] T const* find(mir::geometry::Point const& point, F const& accept) const
+    {
+        if (columns == 0)
+            return nullptr;
+
+        int const x = point.x.as_int();
+        int const y = point.y.as_int();
+        if (x < left || x >= right || y < top || y >= bottom)
+            return nullptr;
+
+        auto const cell = static_cast<size_t>(((y - top) / cell_height) * columns + (x - left) / cell_width);
+        for (auto i = cell_offsets[cell]; i < cell_offsets[cell + 1]; i++)
+        {
+            auto const& entry = entries[cell_entries[i]];
+            if (entry.area.contains(point) && accept(entry.value))
+                return &entry.value;
+        }
+
+        return nullptr;
+    }
+
+    [[nodiscard]] T const* find(mir::geometry::Point const& point) const
+    {
+        return find(point, [](T const&)
+        { return true; });
+    }
+
+    [[nodiscard]] std::vector<Entry> const& get_entries() const { return entries; }
+
+private:
+    std::vector<Entry> entries;
+    int left = 0;
+    int top = 0;
+    int right = 0;
+    int bottom = 0;
+    int columns = 0;
+    int rows = 0;
+    int cell_width = 1;
+    int cell_height = 1;
+
+    /// The entries of cell i are cell_entries[cell_offsets[i]] to cell_entries[cell_offsets[i + 1]].
+    std::vector<uint32_t> cell_offsets;
+    std::vector<uint32_t> cell_entries;
+
+    /// Calls [f] with each cell that each entry overlaps, in the order of the entries.
+    template <typename F>
+    void for_each_cell(F const& f) const
+    {
+        for (size_t index = 0; index < entries.size(); index++)
+        {
+            auto const& area = entries[index].area;
+            if (area.size.width.as_int() <= 0 || area.size.height.as_int() <= 0)
+                continue;
+
+            int const first_column = (area.left().as_int() - left) / cell_width;
+            int const last_column = (area.right().as_int() - 1 - left) / cell_width;
+            int const first_row = (area.top().as_int() - top) / cell_height;
+            int const last_row = (area.bottom().as_int() - 1 - top) / cell_height;
+            for (int row = first_row; row <= last_row; row++)
+                for (int column = first_column; column <= last_column; column++)
+                    f(static_cast<size_t>(row * columns + column), index);
+        }
+    }
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_RECTANGLE_INDEX_H
@@ -17,6 +17,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "render_data_manager.h"
 #include "container.h"
+#include "parent_container.h"
+#include "workspace_interface.h"
 #include <algorithm>
 #include <mir/scene/surface.h>
 
@@ -36,6 +38,71 @@ inline glm::mat4 workspace_transform(Container const& container)
 {
     return container.get_output_transform() * container.get_workspace_transform();
 }
+
+inline std::optional<uint32_t> workspace_id(Container const& container)
+{
+    if (auto const workspace = container.get_workspace())
+        return workspace->id();
+    return std::nullopt;
+}
+
+/// The bytes held by a copy of the render data and its index.
+size_t bytes_held(
+    std::vector<RenderData> const& render_data,
+    std::unordered_map<mir::scene::Surface const*, size_t> const& index)
+{
+    using Node = std::pair<mir::scene::Surface const* const, size_t>;
+    return render_data.capacity() * sizeof(RenderData)
+        + index.size() * (sizeof(Node) + sizeof(void*))
+        + index.bucket_count() * sizeof(void*);
+}
+
+inline mir::scene::Surface* get_surface(Container const& container)
+{
+    return container.window()->operator std::shared_ptr<mir::scene::Surface>().get();
+}
+}
+
+RenderDataSnapshot::RenderDataSnapshot(std::shared_ptr<Data const> data) :
+    data { std::move(data) }
+{
+}
+
+RenderData const* RenderDataSnapshot::find(mir::scene::Surface const* surface) const
+{
+    if (!data)
+        return nullptr;
+
+    auto it = data->index->positions.find(surface);
+    if (it == data->index->positions.end())
+        return nullptr;
+
+    return &(*this)[it->second];
+}
+
+size_t RenderDataSnapshot::size() const
+{
+    return data ? data->size : 0;
+}
+
+RenderData const& RenderDataSnapshot::operator[](size_t i) const
+{
+    return data->chunks[i / chunk_size]->render_data[i % chunk_size];
+}
+
+uint64_t RenderDataSnapshot::generation() const
+{
+    return data ? data->generation : 0;
+}
+
+WindowManagerMode RenderDataSnapshot::mode() const
+{
+    return data ? data->mode : WindowManagerMode::normal;
+}
+
+std::optional<mir::geometry::Rectangle> RenderDataSnapshot::drag_preview() const
+{
+    return data ? data->drag_preview : std::nullopt;
 }
 
 RenderDataManager::RenderDataManager()
@@ -43,73 +110,365 @@ RenderDataManager::RenderDataManager()
     render_data.reserve(48);
 }
 
+RenderData* RenderDataManager::find(Container const& container)
+{
+    auto it = index.find(get_surface(container));
+    if (it == index.end())
+        return nullptr;
+
+    return &render_data[it->second];
+}
+
+void RenderDataManager::rebuild_index()
+{
+    index.clear();
+    for (size_t i = 0; i < render_data.size(); i++)
+        index.emplace(render_data[i].surface, i);
+}
+
 void RenderDataManager::add(Container const& container)
 {
     if (container.window() == std::nullopt)
         return;
 
+    std::lock_guard lock(mutex);
+    auto surface = get_surface(container);
+    index.emplace(surface, render_data.size());
     render_data.emplace_back(RenderData {
-        .surface = container.window()->operator std::shared_ptr<mir::scene::Surface>().get(),
+        .surface = surface,
         .needs_outline = needs_outline(container),
         .is_focused = container.is_focused(),
+        .is_fullscreen = container.is_fullscreen(),
+        .is_hidden_tab = container.is_hidden_tab(),
         .transform = container.get_transform(),
-        .workspace_transform = workspace_transform(container) });
+        .workspace_transform = workspace_transform(container),
+        .workspace_id = workspace_id(container) });
+    tag_input(render_data.back());
+    memory.resize(bytes_held(render_data, index));
+    is_index_dirty = true;
+    mark_changed(render_data.back());
 }
 
 void RenderDataManager::transform_change(Container const& container)
 {
-    for (auto& data : render_data)
+    std::lock_guard lock(mutex);
+    if (auto data = find(container))
     {
-        if (data.surface == container.window()->operator std::shared_ptr<mir::scene::Surface>().get())
-        {
-            data.transform = container.get_transform();
-            return;
-        }
+        tag_input(*data);
+        data->transform = container.get_transform();
+        mark_changed(*data);
     }
 }
 
 void RenderDataManager::workspace_transform_change(Container const& container)
 {
+    std::lock_guard lock(mutex);
+    if (auto data = find(container))
+    {
+        tag_input(*data);
+        data->workspace_transform = workspace_transform(container);
+        data->workspace_id = workspace_id(container);
+        mark_changed(*data);
+    }
+}
+
+void RenderDataManager::workspace_change(Container const& container)
+{
+    if (container.window() == std::nullopt)
+        return;
+
+    std::lock_guard lock(mutex);
+    if (auto data = find(container))
+    {
+        tag_input(*data);
+        data->workspace_id = workspace_id(container);
+        data->workspace_transform = workspace_transform(container);
+        mark_changed(*data);
+    }
+}
+
+void RenderDataManager::workspace_transform_change(uint32_t workspace_id, glm::mat4 const& transform)
+{
+    std::lock_guard lock(mutex);
+    workspace_transforms[workspace_id] = transform;
     for (auto& data : render_data)
     {
-        if (data.surface == container.window()->operator std::shared_ptr<mir::scene::Surface>().get())
+        if (data.workspace_id == workspace_id)
         {
-            data.workspace_transform = workspace_transform(container);
-            return;
+            tag_input(data);
+            mark_changed(data);
         }
     }
+    mark_changed();
+}
+
+void RenderDataManager::clear_workspace_transform(uint32_t workspace_id)
+{
+    std::lock_guard lock(mutex);
+    if (!workspace_transforms.erase(workspace_id))
+        return;
+
+    for (auto const& data : render_data)
+    {
+        if (data.workspace_id == workspace_id)
+            mark_changed(data);
+    }
+    mark_changed();
 }
 
 void RenderDataManager::focus_change(Container const& container)
 {
-    for (auto& data : render_data)
+    std::lock_guard lock(mutex);
+    if (auto data = find(container))
     {
-        if (data.surface == container.window()->operator std::shared_ptr<mir::scene::Surface>().get())
+        tag_input(*data);
+        data->is_focused = container.is_focused();
+        mark_changed(*data);
+    }
+}
+
+void RenderDataManager::fullscreen_change(Container const& container)
+{
+    std::lock_guard lock(mutex);
+    if (auto data = find(container))
+    {
+        tag_input(*data);
+        data->is_fullscreen = container.is_fullscreen();
+        mark_changed(*data);
+    }
+}
+
+void RenderDataManager::tab_change(Container const& container)
+{
+    if (container.window() == std::nullopt)
+        return;
+
+    std::lock_guard lock(mutex);
+    if (auto data = find(container))
+    {
+        auto const hidden = container.is_hidden_tab();
+        if (data->is_hidden_tab != hidden)
+        {
+            tag_input(*data);
+            data->is_hidden_tab = hidden;
+            mark_changed(*data);
+        }
+    }
+}
+
+void RenderDataManager::placeholder_change(
+    Container const& container, std::optional<mir::geometry::Rectangle> const& placeholder)
+{
+    if (container.window() == std::nullopt)
+        return;
+
+    std::lock_guard lock(mutex);
+    if (auto data = find(container))
+    {
+        if (data->placeholder != placeholder)
         {
-            data.is_focused = container.is_focused();
-            return;
+            data->placeholder = placeholder;
+            mark_changed(*data);
         }
     }
 }
 
 void RenderDataManager::remove(Container const& container)
 {
-    render_data.erase(std::remove_if(render_data.begin(), render_data.end(), [&](RenderData const& data)
+    std::lock_guard lock(mutex);
+    auto surface = get_surface(container);
+    auto const first = std::ranges::find(render_data, surface, &RenderData::surface);
+    if (first == render_data.end())
+        return;
+
+    // Every window after the first that is removed moves down, so each chunk
+    // from there on differs from the one in the last snapshot.
+    auto const position = static_cast<size_t>(first - render_data.begin());
+    render_data.erase(std::remove_if(first, render_data.end(), [&](RenderData const& data)
     {
-        return data.surface == container.window()->operator std::shared_ptr<mir::scene::Surface>().get();
+        return data.surface == surface;
     }),
         render_data.end());
+    rebuild_index();
+    memory.resize(bytes_held(render_data, index));
+    is_index_dirty = true;
+    for (auto i = position / RenderDataSnapshot::chunk_size; i < dirty_chunks.size(); i++)
+        dirty_chunks[i] = true;
+    mark_changed();
+}
+
+void RenderDataManager::mode_change(WindowManagerMode next)
+{
+    std::lock_guard lock(mutex);
+    if (mode == next)
+        return;
+
+    mode = next;
+    mark_changed();
 }
 
-std::vector<RenderData> const& RenderDataManager::get()
+void RenderDataManager::drag_preview_change(std::optional<mir::geometry::Rectangle> const& next)
 {
     std::lock_guard lock(mutex);
-    copy_for_renderer.clear();
-    if (render_data.capacity() > copy_for_renderer.capacity())
-        copy_for_renderer.reserve(render_data.capacity());
-    std::copy(
-        render_data.begin(),
-        render_data.end(),
-        std::back_inserter(copy_for_renderer));
-    return copy_for_renderer;
-}
\ No newline at end of file
+    if (drag_preview == next)
+        return;
+
+    drag_preview = next;
+    mark_changed();
+}
+
+void RenderDataManager::mark_changed()
+{
+    if (batch_depth > 0)
+        has_batched_changes = true;
+    else
+        generation++;
+}
+
+void RenderDataManager::mark_changed(RenderData const& data)
+{
+    auto const chunk = static_cast<size_t>(&data - render_data.data()) / RenderDataSnapshot::chunk_size;
+    if (chunk >= dirty_chunks.size())
+        dirty_chunks.resize(chunk + 1, true);
+    dirty_chunks[chunk] = true;
+    mark_changed();
+}
+
+void RenderDataManager::tag_input(RenderData& data) const
+{
+    if (input_time && input_thread == std::this_thread::get_id())
+        data.input_time = input_time;
+}
+
+RenderDataManager::Batch::Batch(RenderDataManager& manager) :
+    manager { manager }
+{
+    std::lock_guard lock(manager.mutex);
+    manager.batch_depth++;
+}
+
+RenderDataManager::Batch::~Batch()
+{
+    std::lock_guard lock(manager.mutex);
+    if (--manager.batch_depth == 0 && manager.has_batched_changes)
+    {
+        manager.has_batched_changes = false;
+        manager.generation++;
+    }
+}
+
+RenderDataManager::InputTag::InputTag(RenderDataManager& manager, std::chrono::steady_clock::time_point time) :
+    manager { manager }
+{
+    std::lock_guard lock(manager.mutex);
+    previous_time = manager.input_time;
+    previous_thread = manager.input_thread;
+    manager.input_time = time;
+    manager.input_thread = std::this_thread::get_id();
+}
+
+RenderDataManager::InputTag::~InputTag()
+{
+    std::lock_guard lock(manager.mutex);
+    manager.input_time = previous_time;
+    manager.input_thread = previous_thread;
+}
+
+RenderDataSnapshot RenderDataManager::get()
+{
+    // Fast path: nothing has changed since the last snapshot was published.
+    auto current = published.load();
+    if (current && current->generation == generation.load())
+        return RenderDataSnapshot(current);
+
+    return publish(nullptr);
+}
+
+void RenderDataManager::update(RenderDataSnapshot& snapshot, RenderDataFetch& fetch)
+{
+    fetch = {};
+    if (snapshot.generation() == generation.load())
+        return;
+
+    fetch.refreshed = true;
+    auto current = published.load();
+    if (current && current->generation == generation.load())
+        snapshot = RenderDataSnapshot(current);
+    else
+        snapshot = publish(&fetch);
+}
+
+RenderDataSnapshot RenderDataManager::publish(RenderDataFetch* fetch)
+{
+    std::unique_lock lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+        auto const start = std::chrono::steady_clock::now();
+        lock.lock();
+        if (fetch)
+        {
+            fetch->contended = true;
+            fetch->wait = std::chrono::steady_clock::now() - start;
+        }
+    }
+
+    auto current = published.load();
+    if (!current || current->generation != generation.load())
+    {
+        auto next = std::make_shared<RenderDataSnapshot::Data>();
+        next->generation = generation.load();
+        next->size = render_data.size();
+        next->mode = mode;
+        next->drag_preview = drag_preview;
+
+        // Only the chunks that have changed since the last snapshot are copied.
+        auto const chunk_count = (render_data.size() + RenderDataSnapshot::chunk_size - 1) / RenderDataSnapshot::chunk_size;
+        dirty_chunks.resize(chunk_count, true);
+        next->chunks.reserve(chunk_count);
+        for (size_t i = 0; i < chunk_count; i++)
+        {
+            if (current && !dirty_chunks[i] && i < current->chunks.size())
+            {
+                next->chunks.push_back(current->chunks[i]);
+                continue;
+            }
+
+            auto chunk = std::make_shared<RenderDataSnapshot::Chunk>();
+            auto const begin = i * RenderDataSnapshot::chunk_size;
+            auto const end = std::min(begin + RenderDataSnapshot::chunk_size, render_data.size());
+            std::copy(render_data.begin() + begin, render_data.begin() + end, chunk->render_data.begin());
+            if (!workspace_transforms.empty())
+            {
+                for (auto& data : chunk->render_data)
+                {
+                    if (!data.workspace_id)
+                        continue;
+
+                    auto const it = workspace_transforms.find(data.workspace_id.value());
+                    if (it != workspace_transforms.end())
+                        data.workspace_transform = it->second;
+                }
+            }
+            next->chunks.push_back(std::move(chunk));
+            dirty_chunks[i] = false;
+        }
+
+        if (current && !is_index_dirty)
+            next->index = current->index;
+        else
+        {
+            auto next_index = std::make_shared<RenderDataSnapshot::Index>();
+            next_index->positions = index;
+            using Node = std::pair<mir::scene::Surface const* const, size_t>;
+            next_index->memory.resize(
+                index.size() * (sizeof(Node) + sizeof(void*)) + next_index->positions.bucket_count() * sizeof(void*));
+            next->index = std::move(next_index);
+            is_index_dirty = false;
+        }
+        next->memory.resize(next->chunks.capacity() * sizeof(std::shared_ptr<RenderDataSnapshot::Chunk const>));
+        current = next;
+        published.store(current);
+    }
+
+    return RenderDataSnapshot(current);
+}
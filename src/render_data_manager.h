@@ -18,8 +18,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef MIRACLEWM_SURFACE_TRACKER_H
 #define MIRACLEWM_SURFACE_TRACKER_H
 
+#include "memory_accounting.h"
+#include "window_manager_mode.h"
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <glm/glm.hpp>
+#include <memory>
+#include <mir/geometry/rectangle.h>
 #include <mir/scene/surface.h>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace miracle
@@ -32,25 +43,184 @@ struct RenderData
     mir::scene::Surface* surface;
     bool needs_outline = false;
     bool is_focused = false;
+    bool is_fullscreen = false;
+    /// Whether the window is a tab in a tabbing or stacking container that is not selected.
+    bool is_hidden_tab = false;
     glm::mat4 transform = glm::mat4(1.f);
     glm::mat4 workspace_transform = glm::mat4(1.f);
+    std::optional<uint32_t> workspace_id;
+    /// The area of a window that is opening but has yet to submit its first
+    /// buffer. A placeholder is drawn there in the meantime, so that the open
+    /// animation can play without waiting for the client.
+    std::optional<mir::geometry::Rectangle> placeholder;
+    /// The arrival time of the input event that last changed this data, if an
+    /// input event changed it at all. See [RenderDataManager::InputTag].
+    std::optional<std::chrono::steady_clock::time_point> input_time;
+};
+
+/// An immutable view of the [RenderData] at a point in time. Snapshots are cheap
+/// to copy and may be held by the renderer without blocking the window manager.
+///
+/// The data is held in fixed-size chunks. A new snapshot shares every chunk in
+/// which nothing has changed with the one before it, so that publishing costs
+/// as much as the changes since the last snapshot rather than the whole scene.
+class RenderDataSnapshot
+{
+public:
+    RenderDataSnapshot() = default;
+
+    /// Returns the data associated with [surface], or nullptr if none exists.
+    [[nodiscard]] RenderData const* find(mir::scene::Surface const* surface) const;
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] RenderData const& operator[](size_t index) const;
+    [[nodiscard]] uint64_t generation() const;
+
+    /// The mode of the window manager when the snapshot was taken.
+    [[nodiscard]] WindowManagerMode mode() const;
+
+    /// The area that the dragged container will be dropped in, while dragging.
+    [[nodiscard]] std::optional<mir::geometry::Rectangle> drag_preview() const;
+
+private:
+    friend class RenderDataManager;
+    static size_t constexpr chunk_size = 16;
+
+    struct Chunk
+    {
+        std::array<RenderData, chunk_size> render_data;
+        MemoryCharge memory { MemorySubsystem::render_data, sizeof(Chunk) };
+    };
+
+    struct Index
+    {
+        std::unordered_map<mir::scene::Surface const*, size_t> positions;
+        MemoryCharge memory { MemorySubsystem::render_data };
+    };
+
+    struct Data
+    {
+        uint64_t generation = 0;
+        size_t size = 0;
+        std::vector<std::shared_ptr<Chunk const>> chunks;
+        std::shared_ptr<Index const> index;
+        WindowManagerMode mode = WindowManagerMode::normal;
+        std::optional<mir::geometry::Rectangle> drag_preview;
+        MemoryCharge memory { MemorySubsystem::render_data };
+    };
+
+    explicit RenderDataSnapshot(std::shared_ptr<Data const> data);
+    std::shared_ptr<Data const> data;
+};
+
+/// Describes how a renderer brought its snapshot up to date in [RenderDataManager::update].
+struct RenderDataFetch
+{
+    /// Whether the snapshot was replaced because the data had changed.
+    bool refreshed = false;
+    /// Whether the renderer had to wait for another thread to build the new snapshot.
+    bool contended = false;
+    std::chrono::nanoseconds wait { 0 };
 };
 
 class RenderDataManager
 {
 public:
+    /// Changes made while a [Batch] is alive are published to the renderer
+    /// together once the last batch ends, so that a frame never shows half of them.
+    class Batch
+    {
+    public:
+        explicit Batch(RenderDataManager& manager);
+        ~Batch();
+
+        Batch(Batch const&) = delete;
+        Batch& operator=(Batch const&) = delete;
+
+    private:
+        RenderDataManager& manager;
+    };
+
+    /// Changes made on this thread while an [InputTag] is alive are attributed to
+    /// the input event that arrived at [time], so that the renderer can measure how
+    /// long the event took to reach the screen.
+    class InputTag
+    {
+    public:
+        InputTag(RenderDataManager& manager, std::chrono::steady_clock::time_point time);
+        ~InputTag();
+
+        InputTag(InputTag const&) = delete;
+        InputTag& operator=(InputTag const&) = delete;
+
+    private:
+        RenderDataManager& manager;
+        std::optional<std::chrono::steady_clock::time_point> previous_time;
+        std::thread::id previous_thread;
+    };
+
     RenderDataManager();
     void add(Container const&);
     void remove(Container const&);
     void transform_change(Container const&);
     void workspace_transform_change(Container const&);
+    void workspace_change(Container const&);
+
+    /// Sets the workspace transform that is shared by every window on the workspace
+    /// with [workspace_id], in place of the transforms of the windows themselves,
+    /// until it is cleared. Moving a workspace is then a single update, however
+    /// many windows it holds.
+    void workspace_transform_change(uint32_t workspace_id, glm::mat4 const& transform);
+    void clear_workspace_transform(uint32_t workspace_id);
     void focus_change(Container const&);
-    std::vector<RenderData> const& get();
+    void fullscreen_change(Container const&);
+    void tab_change(Container const&);
+    void placeholder_change(Container const&, std::optional<mir::geometry::Rectangle> const&);
+
+    /// The mode and the drag preview are published with the window data, so that
+    /// the renderer reads them once per frame from the same snapshot.
+    void mode_change(WindowManagerMode);
+    void drag_preview_change(std::optional<mir::geometry::Rectangle> const&);
+
+    /// Returns the latest snapshot of the render data. A new snapshot is only
+    /// built when the data has changed since the last call.
+    RenderDataSnapshot get();
+
+    /// Brings [snapshot] up to date, describing how in [fetch]. Each renderer keeps
+    /// a snapshot of its own, so that a frame in which nothing has changed touches
+    /// nothing besides the generation that is shared with the other outputs.
+    void update(RenderDataSnapshot& snapshot, RenderDataFetch& fetch);
 
 private:
+    RenderData* find(Container const&);
+    void rebuild_index();
+    /// Publishes a snapshot of the current data, unless another thread beat us to it.
+    RenderDataSnapshot publish(RenderDataFetch* fetch);
+    /// Must be called with [mutex] held.
+    void mark_changed();
+    /// Marks the chunk that holds [data] to be copied into the next snapshot.
+    /// Must be called with [mutex] held.
+    void mark_changed(RenderData const& data);
+    /// Attributes the change to [data] to the current input event, if any.
+    /// Must be called with [mutex] held.
+    void tag_input(RenderData& data) const;
+
     std::mutex mutex;
     std::vector<RenderData> render_data;
-    std::vector<RenderData> copy_for_renderer;
+    std::unordered_map<mir::scene::Surface const*, size_t> index;
+    std::unordered_map<uint32_t, glm::mat4> workspace_transforms;
+    WindowManagerMode mode = WindowManagerMode::normal;
+    std::optional<mir::geometry::Rectangle> drag_preview;
+    MemoryCharge memory { MemorySubsystem::render_data };
+    /// Whether each chunk of [render_data] has changed since the last snapshot.
+    std::vector<bool> dirty_chunks;
+    /// Whether windows were added or removed since the last snapshot.
+    bool is_index_dirty = true;
+    std::atomic<uint64_t> generation = 1;
+    int batch_depth = 0;
+    bool has_batched_changes = false;
+    std::optional<std::chrono::steady_clock::time_point> input_time;
+    std::thread::id input_thread;
+    std::atomic<std::shared_ptr<RenderDataSnapshot::Data const>> published;
 };
 
 } // miracle
@@ -0,0 +1,123 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "render_filter.h"
+
+namespace
+{
+/// A 3x3 matrix in row-major order, which is how the matrices below are written.
+using RowMatrix = std::array<std::array<float, 3>, 3>;
+
+/// Simulations of complete dichromacy (Machado, Oliveira and Fernandes, 2009).
+constexpr RowMatrix protanopia_simulation { {
+    { 0.152286f, 1.052583f, -0.204868f },
+    { 0.114503f, 0.786281f, 0.099216f },
+    { -0.003882f, -0.048116f, 1.051998f },
+} };
+
+constexpr RowMatrix deuteranopia_simulation { {
+    { 0.367322f, 0.860646f, -0.227968f },
+    { 0.280085f, 0.672501f, 0.047413f },
+    { -0.011820f, 0.042940f, 0.968881f },
+} };
+
+constexpr RowMatrix tritanopia_simulation { {
+    { 1.255528f, -0.076749f, -0.178779f },
+    { -0.078411f, 0.930809f, 0.147602f },
+    { 0.004733f, 0.691367f, 0.303900f },
+} };
+
+/// Moves the error between a color and its simulation into the green and blue channels.
+constexpr RowMatrix error_shift { {
+    { 0.f, 0.f, 0.f },
+    { 0.7f, 1.f, 0.f },
+    { 0.7f, 0.f, 1.f },
+} };
+
+constexpr RowMatrix grayscale { {
+    { 0.2126f, 0.7152f, 0.0722f },
+    { 0.2126f, 0.7152f, 0.0722f },
+    { 0.2126f, 0.7152f, 0.0722f },
+} };
+
+constexpr RowMatrix identity { {
+    { 1.f, 0.f, 0.f },
+    { 0.f, 1.f, 0.f },
+    { 0.f, 0.f, 1.f },
+} };
+
+/// Folds daltonization, c + shift * (c - simulation * c), into a single matrix.
+RowMatrix daltonize(RowMatrix const& simulation)
+{
+    RowMatrix result = identity;
+    for (size_t row = 0; row < 3; row++)
+    {
+        for (size_t column = 0; column < 3; column++)
+        {
+            for (size_t k = 0; k < 3; k++)
+                result[row][column] += error_shift[row][k] * (identity[k][column] - simulation[k][column]);
+        }
+    }
+
+    return result;
+}
+
+miracle::ColorMatrix to_column_major(RowMatrix const& matrix)
+{
+    miracle::ColorMatrix result {};
+    for (size_t row = 0; row < 3; row++)
+    {
+        for (size_t column = 0; column < 3; column++)
+            result[column * 3 + row] = matrix[row][column];
+    }
+
+    return result;
+}
+}
+
+std::optional<miracle::RenderFilter> miracle::from_string_render_filter(std::string const& filter)
+{
+    if (filter == "none")
+        return RenderFilter::none;
+    else if (filter == "grayscale")
+        return RenderFilter::grayscale;
+    else if (filter == "protanopia")
+        return RenderFilter::protanopia;
+    else if (filter == "deuteranopia")
+        return RenderFilter::deuteranopia;
+    else if (filter == "tritanopia")
+        return RenderFilter::tritanopia;
+    else
+        return std::nullopt;
+}
+
+miracle::ColorMatrix miracle::color_filter_matrix(RenderFilter filter)
+{
+    switch (filter)
+    {
+    case RenderFilter::grayscale:
+        return to_column_major(grayscale);
+    case RenderFilter::protanopia:
+        return to_column_major(daltonize(protanopia_simulation));
+    case RenderFilter::deuteranopia:
+        return to_column_major(daltonize(deuteranopia_simulation));
+    case RenderFilter::tritanopia:
+        return to_column_major(daltonize(tritanopia_simulation));
+    default:
+        return to_column_major(identity);
+    }
+}
@@ -0,0 +1,54 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_RENDER_FILTER_H
+#define MIRACLE_WM_RENDER_FILTER_H
+
+#include <array>
+#include <optional>
+#include <string>
+
+namespace miracle
+{
+
+/// A color filter that is applied to a surface as it is drawn. Each filter is
+/// drawn with a program of its own, so that the shaders never branch on it.
+enum class RenderFilter : int
+{
+    none,
+    grayscale,
+    protanopia,
+    deuteranopia,
+    tritanopia,
+    max
+};
+
+std::optional<RenderFilter> from_string_render_filter(std::string const&);
+
+/// A 3x3 matrix in column-major order, as expected by glUniformMatrix3fv.
+using ColorMatrix = std::array<float, 9>;
+
+/// Returns the matrix that [filter] multiplies the color of each pixel by
+/// when it is applied to a whole output at once.
+///
+/// The colorblind filters correct rather than simulate: the colors that the
+/// viewer cannot tell apart are shifted into the channels that they can see.
+ColorMatrix color_filter_matrix(RenderFilter filter);
+
+} // miracle
+
+#endif // MIRACLE_WM_RENDER_FILTER_H
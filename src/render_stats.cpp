@@ -0,0 +1,206 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "render_stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace miracle;
+
+namespace
+{
+double to_ms(std::chrono::nanoseconds duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+nlohmann::json samples_to_json(RollingSamples const& samples)
+{
+    return {
+        { "p50", samples.percentile(0.5) },
+        { "p95", samples.percentile(0.95) },
+        { "p99", samples.percentile(0.99) }
+    };
+}
+}
+
+RollingSamples::RollingSamples(size_t capacity) :
+    capacity { std::max<size_t>(capacity, 1) }
+{
+    samples.reserve(this->capacity);
+}
+
+void RollingSamples::push(double sample)
+{
+    if (samples.size() < capacity)
+        samples.push_back(sample);
+    else
+        samples[next] = sample;
+    next = (next + 1) % capacity;
+}
+
+double RollingSamples::percentile(double fraction) const
+{
+    if (samples.empty())
+        return 0;
+
+    auto const rank = static_cast<size_t>(std::ceil(std::clamp(fraction, 0.0, 1.0) * samples.size()));
+    auto const index = rank == 0 ? 0 : rank - 1;
+    auto sorted = samples;
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return sorted[index];
+}
+
+OutputRenderStats::OutputRenderStats(size_t window) :
+    cpu_time_ms { window },
+    gpu_time_ms { window },
+    render_data_wait_us { window },
+    input_latency_ms { window },
+    uploaded_kb { window },
+    blur_gpu_time_ms { window }
+{
+}
+
+RenderStatsManager::RenderStatsManager(size_t window) :
+    window { window }
+{
+}
+
+void RenderStatsManager::record(
+    void const* renderer, mir::geometry::Rectangle const& area, RenderFrameStats const& frame)
+{
+    std::lock_guard lock(mutex);
+    auto it = stats.find(renderer);
+    if (it == stats.end())
+        it = stats.emplace(renderer, OutputRenderStats(window)).first;
+
+    auto& output = it->second;
+    output.area = area;
+    output.last = frame;
+    output.frames++;
+    output.total_gl_errors += frame.gl_errors;
+    if (frame.skipped)
+        output.skipped_frames++;
+    if (frame.software_cursor)
+        output.software_cursor_frames++;
+    if (frame.capped)
+        output.capped_frames++;
+    if (frame.mirrored)
+        output.mirrored_frames++;
+    output.cpu_time_ms.push(to_ms(frame.cpu_time));
+    if (frame.gpu_time)
+        output.gpu_time_ms.push(to_ms(frame.gpu_time.value()));
+    if (frame.render_data_refreshed)
+        output.render_data_refreshes++;
+    if (frame.render_data_contended)
+    {
+        output.render_data_contentions++;
+        output.total_render_data_wait += frame.render_data_wait;
+        output.render_data_wait_us.push(std::chrono::duration<double, std::micro>(frame.render_data_wait).count());
+    }
+    if (frame.input_latency)
+    {
+        auto const latency = frame.input_latency.value();
+        output.input_latency_ms.push(to_ms(latency));
+        auto const bucket = std::ranges::lower_bound(metric_histogram_bounds, latency);
+        output.input_latency_buckets[static_cast<size_t>(bucket - metric_histogram_bounds.begin())]++;
+    }
+    output.total_uploaded_bytes += frame.uploaded_bytes;
+    output.uploaded_kb.push(static_cast<double>(frame.uploaded_bytes) / 1024.0);
+    if (frame.blur_updated)
+        output.blur_updates++;
+    if (frame.blur_gpu_time)
+        output.blur_gpu_time_ms.push(to_ms(frame.blur_gpu_time.value()));
+    output.total_gpu_memory_evictions += frame.gpu_memory_evictions;
+}
+
+void RenderStatsManager::remove(void const* renderer)
+{
+    std::lock_guard lock(mutex);
+    stats.erase(renderer);
+}
+
+std::vector<OutputRenderStats> RenderStatsManager::outputs() const
+{
+    std::lock_guard lock(mutex);
+    std::vector<OutputRenderStats> result;
+    result.reserve(stats.size());
+    for (auto const& [_, output] : stats)
+        result.push_back(output);
+    return result;
+}
+
+nlohmann::json RenderStatsManager::to_json() const
+{
+    nlohmann::json j = nlohmann::json::array();
+    for (auto const& output : outputs())
+    {
+        nlohmann::json gpu_time = nullptr;
+        if (output.gpu_time_ms.size() > 0)
+            gpu_time = samples_to_json(output.gpu_time_ms);
+        nlohmann::json blur_gpu_time = nullptr;
+        if (output.blur_gpu_time_ms.size() > 0)
+            blur_gpu_time = samples_to_json(output.blur_gpu_time_ms);
+
+        nlohmann::json buckets = nlohmann::json::array();
+        for (size_t i = 0; i < metric_histogram_bounds.size(); i++)
+            buckets.push_back({ { "le_ms", to_ms(metric_histogram_bounds[i]) }, { "count", output.input_latency_buckets[i] } });
+        buckets.push_back({ { "le_ms", nullptr }, { "count", output.input_latency_buckets.back() } });
+
+        j.push_back({
+            { "rect",
+             { { "x", output.area.top_left.x.as_int() },
+                { "y", output.area.top_left.y.as_int() },
+                { "width", output.area.size.width.as_int() },
+                { "height", output.area.size.height.as_int() } } },
+            { "frameno", output.last.frameno },
+            { "frames", output.frames },
+            { "skipped_frames", output.skipped_frames },
+            { "software_cursor_frames", output.software_cursor_frames },
+            { "capped_frames", output.capped_frames },
+            { "mirrored_frames", output.mirrored_frames },
+            { "renderables_drawn", output.last.renderables_drawn },
+            { "scaled_renderables_drawn", output.last.scaled_renderables_drawn },
+            { "outlines_drawn", output.last.outlines_drawn },
+            { "gl_errors", output.total_gl_errors },
+            { "cpu_time_ms", samples_to_json(output.cpu_time_ms) },
+            { "gpu_time_ms", gpu_time },
+            { "render_data",
+             { { "refreshes", output.render_data_refreshes },
+                { "contentions", output.render_data_contentions },
+                { "total_wait_ms", to_ms(output.total_render_data_wait) },
+                { "wait_us", samples_to_json(output.render_data_wait_us) } } },
+            { "input_latency",
+             { { "samples", output.input_latency_ms.size() },
+                { "ms", samples_to_json(output.input_latency_ms) },
+                { "buckets", buckets } } },
+            { "texture_uploads",
+             { { "total_bytes", output.total_uploaded_bytes },
+                { "kb", samples_to_json(output.uploaded_kb) } } },
+            { "blur",
+             { { "updates", output.blur_updates },
+                { "gpu_time_ms", blur_gpu_time } } },
+            { "gpu_memory",
+             { { "bytes", output.last.gpu_memory_bytes },
+                { "budget_bytes", output.last.gpu_memory_budget_bytes },
+                { "evictions", output.total_gpu_memory_evictions } } }
+        });
+    }
+
+    return j;
+}
@@ -0,0 +1,148 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_RENDER_STATS_H
+#define MIRACLE_WM_RENDER_STATS_H
+
+#include "metrics.h"
+#include <array>
+#include <chrono>
+#include <mir/geometry/rectangle.h>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace miracle
+{
+
+/// The measurements taken while rendering a single frame on a single output.
+struct RenderFrameStats
+{
+    long long frameno = 0;
+    std::chrono::nanoseconds cpu_time { 0 };
+    /// The GPU time of the most recent frame whose timer query has completed.
+    /// GPU results arrive a few frames late, so this is not the current frame.
+    std::optional<std::chrono::nanoseconds> gpu_time;
+    size_t renderables_drawn = 0;
+    /// The renderables whose buffers did not match the size that they were drawn
+    /// at, e.g. from clients that ignore the fractional scale of the output.
+    size_t scaled_renderables_drawn = 0;
+    size_t outlines_drawn = 0;
+    /// The bytes of shm buffers that were uploaded to textures for this frame.
+    size_t uploaded_bytes = 0;
+    size_t gl_errors = 0;
+    /// Whether nothing had changed since the last frame, so that nothing was drawn.
+    bool skipped = false;
+    /// Whether the cursor was composited into this frame because no cursor plane was in use.
+    bool software_cursor = false;
+    /// Whether this frame was held back to keep the output within its frame rate cap.
+    bool capped = false;
+    /// Whether this frame was scaled from the frame of the output that it mirrors,
+    /// rather than drawn. See [MirrorGroups].
+    bool mirrored = false;
+    /// How the renderer came by the render data of this frame.
+    bool render_data_refreshed = false;
+    bool render_data_contended = false;
+    std::chrono::nanoseconds render_data_wait { 0 };
+    /// The time from the arrival of an input event to the commit of this frame,
+    /// if this is the first frame to show a change that the event caused.
+    std::optional<std::chrono::nanoseconds> input_latency;
+    /// Whether the blurred background was recomputed for this frame.
+    bool blur_updated = false;
+    /// The GPU time of the most recent blur whose timer query has completed.
+    std::optional<std::chrono::nanoseconds> blur_gpu_time;
+    /// The video memory held by the offscreen targets of this output.
+    size_t gpu_memory_bytes = 0;
+    /// The video memory that the offscreen targets of all outputs may hold together.
+    size_t gpu_memory_budget_bytes = 0;
+    /// The offscreen targets that were freed at the start of this frame to keep within the budget.
+    size_t gpu_memory_evictions = 0;
+};
+
+/// Holds the last [capacity] samples of a measurement.
+class RollingSamples
+{
+public:
+    explicit RollingSamples(size_t capacity);
+    void push(double sample);
+
+    /// Returns the nearest-rank percentile of the samples, where [fraction] is
+    /// in the range [0, 1]. Returns 0 when there are no samples.
+    [[nodiscard]] double percentile(double fraction) const;
+    [[nodiscard]] size_t size() const { return samples.size(); }
+
+private:
+    size_t capacity;
+    size_t next = 0;
+    std::vector<double> samples;
+};
+
+struct OutputRenderStats
+{
+    explicit OutputRenderStats(size_t window);
+
+    mir::geometry::Rectangle area;
+    RenderFrameStats last;
+    size_t frames = 0;
+    size_t skipped_frames = 0;
+    size_t software_cursor_frames = 0;
+    size_t capped_frames = 0;
+    size_t mirrored_frames = 0;
+    size_t total_gl_errors = 0;
+    RollingSamples cpu_time_ms;
+    RollingSamples gpu_time_ms;
+    size_t render_data_refreshes = 0;
+    size_t render_data_contentions = 0;
+    std::chrono::nanoseconds total_render_data_wait { 0 };
+    /// The time spent waiting for the render data in frames where it was contended.
+    RollingSamples render_data_wait_us;
+    RollingSamples input_latency_ms;
+    /// The input latencies counted into the buckets of [metric_histogram_bounds],
+    /// with a final bucket for those above the last bound.
+    std::array<size_t, metric_histogram_bounds.size() + 1> input_latency_buckets {};
+    size_t total_uploaded_bytes = 0;
+    RollingSamples uploaded_kb;
+    size_t blur_updates = 0;
+    RollingSamples blur_gpu_time_ms;
+    size_t total_gpu_memory_evictions = 0;
+};
+
+/// Collects the frame statistics of every renderer so that they may be
+/// queried over IPC. Renderers report from their own threads.
+class RenderStatsManager
+{
+public:
+    /// [window] is the number of frames over which percentiles are computed.
+    explicit RenderStatsManager(size_t window = 600);
+
+    void record(void const* renderer, mir::geometry::Rectangle const& area, RenderFrameStats const& stats);
+    void remove(void const* renderer);
+
+    [[nodiscard]] std::vector<OutputRenderStats> outputs() const;
+    [[nodiscard]] nlohmann::json to_json() const;
+
+private:
+    size_t window;
+    mutable std::mutex mutex;
+    std::unordered_map<void const*, OutputRenderStats> stats;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_RENDER_STATS_H
@@ -21,12 +21,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "renderer.h"
 #include "compositor_state.h"
 #include "config.h"
+#include "debug_log.h"
+#include "metrics.h"
 #include "program_factory.h"
+#include "startup_profile.h"
 #include "tessellation_helpers.h"
+#include "thread_scheduling.h"
 
 #include <EGL/egl.h>
+#include <EGL/eglext.h>
 #include <GLES2/gl2.h>
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <mir/graphics/buffer.h>
@@ -37,8 +47,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <mir/graphics/texture.h>
 #include <mir/log.h>
 #include <mir/renderer/gl/gl_surface.h>
+#include <mir/renderer/sw/pixel_source.h>
 #include <mir/scene/surface.h>
 #include <stdexcept>
+#include <thread>
 
 namespace mg = mir::graphics;
 namespace mgl = mir::gl;
@@ -133,6 +145,34 @@ private:
     int outline_width_px;
     float _alpha;
 };
+
+/// The blurred background is bound to the last of the 8 texture units that every
+/// GL implementation provides, which the planes of a buffer never reach.
+constexpr GLint blur_texture_unit = 7;
+
+/// The bytes that turning [buffer] into a texture uploads: all of them for an shm
+/// buffer, and none for a buffer that is imported, such as a dmabuf.
+size_t upload_size(mg::Buffer& buffer)
+{
+    if (!dynamic_cast<mir::renderer::software::ReadMappableBuffer*>(buffer.native_buffer_base()))
+        return 0;
+
+    auto const size = buffer.size();
+    return static_cast<size_t>(size.width.as_int())
+        * static_cast<size_t>(size.height.as_int())
+        * static_cast<size_t>(MIR_BYTES_PER_PIXEL(buffer.pixel_format()));
+}
+
+/// Draws a quad that covers the whole of the bound framebuffer.
+void draw_fullscreen_quad(GLint position_attr)
+{
+    static constexpr GLfloat quad[] = { -1.f, -1.f, 1.f, -1.f, -1.f, 1.f, 1.f, 1.f };
+    auto const attribute = static_cast<GLuint>(position_attr);
+    glEnableVertexAttribArray(attribute);
+    glVertexAttribPointer(attribute, 2, GL_FLOAT, GL_FALSE, 0, quad);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glDisableVertexAttribArray(attribute);
+}
 }
 
 Renderer::Renderer(
@@ -145,6 +185,8 @@ Renderer::Renderer(
     program_factory { std::make_unique<ProgramFactory>() },
     display_transform(1),
     screen_to_gl_coords(1),
+    gpu_timer { std::make_unique<GpuTimer>() },
+    has_gpu_fences { GpuFence::is_supported() },
     gl_interface { std::move(gl_interface) },
     config { config },
     compositor_state { compositor_state }
@@ -169,6 +211,11 @@ Renderer::Renderer(
             auto val = eglQueryString(disp, s.id);
             mir::log_info(std::string(s.label) + ": " + (val ? val : ""));
         }
+
+        auto const extensions = eglQueryString(disp, EGL_EXTENSIONS);
+        has_buffer_age = extensions
+            && (strstr(extensions, "EGL_EXT_buffer_age") || strstr(extensions, "EGL_KHR_partial_update"));
+        mir::log_info("Damage tracking is %s", has_buffer_age ? "enabled" : "disabled");
     }
 
     struct
@@ -189,6 +236,10 @@ Renderer::Renderer(
         mir::log_info(std::string(s.label) + ": " + (val ? val : ""));
     }
 
+    auto const gl_renderer = reinterpret_cast<char const*>(glGetString(GL_RENDERER));
+    detected_quality_tier = detect_quality_tier(gl_renderer ? gl_renderer : "");
+    mir::log_info("Detected the %s quality tier", to_string(detected_quality_tier));
+
     GLint max_texture_size = 0;
     glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
     mir::log_info("GL max texture size = %d", max_texture_size);
@@ -204,7 +255,21 @@ Renderer::Renderer(
         rbits, gbits, bbits, abits, dbits, sbits);
 
     has_stencil_support = dbits > 0;
+    mir::log_info("GPU frame timing is %s", gpu_timer->is_supported() ? "enabled" : "disabled");
+    glGenBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
     glBindBuffer(GL_ARRAY_BUFFER, 0);
+    StartupProfile::instance().mark("renderer constructed");
+}
+
+Renderer::~Renderer()
+{
+    compositor_state->render_stats()->remove(this);
+    compositor_state->frame_clock()->remove(this);
+    compositor_state->gpu_memory_budget()->remove(this);
+    // Mirrors may still be reading the offscreen target, which is deleted with us
+    compositor_state->mirror_groups()->begin_drawing(this, mirror_reads);
+    compositor_state->mirror_groups()->remove(this);
+    glDeleteBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
 }
 
 void Renderer::tessellate(
@@ -217,47 +282,654 @@ void Renderer::tessellate(
 
 Renderer::DrawData Renderer::get_draw_data(
     mir::graphics::Renderable const& renderable,
-    std::vector<RenderData> const& data) const
+    RenderDataSnapshot const& data) const
 {
     DrawData result = { true };
     auto surface = renderable.surface_if_any();
     if (surface)
     {
-        for (auto const& item : data)
+        if (auto item = data.find(surface.value()))
+            result.data = *item;
+
+        // The outline of a fullscreen surface would be drawn off of the output.
+        if (result.data.is_fullscreen)
+            result.data.needs_outline = false;
+    }
+
+    return result;
+}
+
+int Renderer::get_buffer_age() const
+{
+    // The frame is drawn into the offscreen target rather than the output's buffer
+    if (is_post_processing)
+        return post_process_age;
+
+    EGLDisplay display = eglGetCurrentDisplay();
+    EGLSurface surface = eglGetCurrentSurface(EGL_DRAW);
+    if (display == EGL_NO_DISPLAY || surface == EGL_NO_SURFACE)
+        return 0;
+
+    EGLint age = 0;
+    if (eglQuerySurface(display, surface, EGL_BUFFER_AGE_EXT, &age) != EGL_TRUE)
+        return 0;
+
+    return age;
+}
+
+geom::Rectangle Renderer::to_gl_rectangle(geom::Rectangle const& rect) const
+{
+    // Damage is only tracked when the viewport maps 1:1 onto the output, so
+    // the only thing left to do is to flip the y-axis when GL is rendering upside-down.
+    int const x = rect.top_left.x.as_int() - viewport.top_left.x.as_int();
+    int const y = rect.top_left.y.as_int() - viewport.top_left.y.as_int();
+    int const y_from_bottom = output_surface->layout() == mg::gl::OutputSurface::Layout::GL
+        ? viewport.size.height.as_int() - y - rect.size.height.as_int()
+        : y;
+    return {
+        geom::Point { x, y_from_bottom },
+        rect.size
+    };
+}
+
+bool Renderer::can_track_output_damage() const
+{
+    return (has_buffer_age || is_post_processing)
+        && has_identity_output_transform
+        && viewport.size == output_surface->size();
+}
+
+bool Renderer::is_scene_unchanged(mg::RenderableList const& renderables) const
+{
+    scene_entries.clear();
+    for (auto const& r : renderables)
+    {
+        auto const buffer = r->buffer();
+        scene_entries.push_back(SceneEntry {
+            .id = r->id(),
+            .buffer_id = buffer ? buffer->id() : mg::BufferID {},
+            .screen_position = r->screen_position(),
+            .clip_area = r->clip_area(),
+            .alpha = r->alpha(),
+            .transformation = r->transformation(),
+            .shaped = r->shaped() });
+    }
+
+    bool const is_unchanged = scene_entries == last_scene_entries
+        && frame_render_data.generation() == last_scene_generation
+        && frame_config == last_scene_config;
+
+    std::swap(scene_entries, last_scene_entries);
+    last_scene_generation = frame_render_data.generation();
+    last_scene_config = frame_config;
+    return is_unchanged;
+}
+
+std::optional<geom::Rectangle> Renderer::calculate_damage(mg::RenderableList const& renderables) const
+{
+    // Transformed renderables may draw outside of their screen position, so we can
+    // only trust the rectangles of untransformed ones. This also means that a full
+    // redraw happens whenever a workspace animation is running.
+    bool can_track_damage = can_track_output_damage();
+
+    auto const& border_config = frame_config->border_config;
+    damage_entries.clear();
+    for (size_t i = 0; i < renderables.size(); i++)
+    {
+        auto const& renderable = *renderables[i];
+        auto const& data = frame_draw_data[i].data;
+        if (renderable.transformation() != glm::mat4(1.f)
+            || data.transform != glm::mat4(1.f)
+            || data.workspace_transform != glm::mat4(1.f))
+            can_track_damage = false;
+
+        auto area = renderable.screen_position();
+        bool const has_outline = data.needs_outline && border_config.size > 0;
+        if (has_outline)
         {
-            if (item.surface == surface.value())
-            {
-                result.data = item;
-                break;
-            }
+            area.top_left = {
+                area.top_left.x.as_int() - border_config.size,
+                area.top_left.y.as_int() - border_config.size
+            };
+            area.size = {
+                area.size.width.as_int() + 2 * border_config.size,
+                area.size.height.as_int() + 2 * border_config.size
+            };
         }
+
+        auto const buffer = renderable.buffer();
+        damage_entries.push_back(DamageTrackerEntry {
+            .id = renderable.id(),
+            .buffer_id = buffer ? buffer->id() : mg::BufferID {},
+            .area = area,
+            .clip_area = renderable.clip_area(),
+            .alpha = renderable.alpha(),
+            .is_focused = data.is_focused,
+            .needs_outline = has_outline,
+            .outline_color = has_outline
+                ? (data.is_focused ? border_config.focus_color : border_config.color)
+                : glm::vec4(0) });
     }
 
-    return result;
+    if (frame_drag_preview)
+    {
+        damage_entries.push_back(DamageTrackerEntry {
+            .id = this,
+            .area = frame_drag_preview.value(),
+            .outline_color = border_config.focus_color });
+    }
+
+    for (size_t i = 0; i < frame_render_data.size(); i++)
+    {
+        auto const& data = frame_render_data[i];
+        if (!shows_placeholder(data))
+            continue;
+
+        if (data.transform != glm::mat4(1.f) || data.workspace_transform != glm::mat4(1.f))
+            can_track_damage = false;
+
+        damage_entries.push_back(DamageTrackerEntry {
+            .id = data.surface,
+            .area = data.placeholder.value(),
+            .outline_color = border_config.focus_color });
+    }
+
+    // The selection mode changes the filter of every surface on the screen.
+    if (frame_mode != last_mode)
+    {
+        last_mode = frame_mode;
+        can_track_damage = false;
+    }
+
+    // The blurred background shows through every translucent window.
+    if (is_blur_dirty || is_blurring != was_blurring)
+    {
+        was_blurring = is_blurring;
+        can_track_damage = false;
+    }
+
+    if (!can_track_damage)
+        damage_tracker.invalidate();
+
+    return damage_tracker.next_frame(damage_entries, can_track_damage ? get_buffer_age() : 0);
+}
+
+void Renderer::set_scissor(geom::Rectangle const& rect) const
+{
+    auto scissor = rect;
+    if (damage_scissor)
+        scissor = scissor.intersection_with(damage_scissor.value());
+
+    gl_state.set_enabled(GL_SCISSOR_TEST, true);
+    gl_state.scissor(
+        scissor.top_left.x.as_int(),
+        scissor.top_left.y.as_int(),
+        scissor.size.width.as_int(),
+        scissor.size.height.as_int());
+}
+
+void Renderer::reset_scissor() const
+{
+    if (damage_scissor)
+        set_scissor(damage_scissor.value());
+    else
+        gl_state.set_enabled(GL_SCISSOR_TEST, false);
+}
+
+void Renderer::cull_occluded(mg::RenderableList const& renderables) const
+{
+    // Walk the renderables from front to back, collecting the areas that are
+    // covered by opaque surfaces. Anything that is entirely inside of one of those
+    // areas will never be seen. Only untransformed renderables take part, as the
+    // screen position of a transformed one says little about where it is drawn.
+    culled_count = 0;
+    occluders.clear();
+    for (size_t i = renderables.size(); i-- > 0;)
+    {
+        auto const& renderable = *renderables[i];
+        auto& draw_data = frame_draw_data[i];
+        // Tabs that are not selected are never seen.
+        if (draw_data.data.is_hidden_tab)
+        {
+            draw_data.occluded = true;
+            culled_count++;
+            continue;
+        }
+
+        if (is_transformed(renderable, draw_data))
+            continue;
+
+        // The damage entry area includes the outline, which must be hidden as well.
+        auto const& area = damage_entries[i].area;
+        if (std::any_of(occluders.begin(), occluders.end(), [&](geom::Rectangle const& occluder)
+        {
+            return occluder.contains(area);
+        }))
+        {
+            draw_data.occluded = true;
+            culled_count++;
+            continue;
+        }
+
+        if (renderable.shaped() || renderable.alpha() < 1.0f)
+            continue;
+
+        auto occluder = renderable.screen_position();
+        if (auto const clip_area = renderable.clip_area())
+        {
+            if (!occluder.overlaps(clip_area.value()))
+                continue;
+            occluder = occluder.intersection_with(clip_area.value());
+        }
+
+        occluders.push_back(occluder);
+    }
 }
 
-auto Renderer::render(mg::RenderableList const& renderables) const -> std::unique_ptr<mg::Framebuffer>
+bool Renderer::update_fullscreen_status(mg::RenderableList const& renderables) const
 {
+    // The display sink is offered the renderables for direct scanout before the
+    // renderer is invoked. If we end up here with a single, opaque, untransformed,
+    // fullscreen surface, then that offer was declined and we composite it instead.
+    mg::Renderable const* visible = nullptr;
+    DrawData const* visible_data = nullptr;
+    for (size_t i = 0; i < renderables.size(); i++)
+    {
+        if (frame_draw_data[i].occluded)
+            continue;
+
+        if (visible)
+        {
+            visible = nullptr;
+            break;
+        }
+
+        visible = renderables[i].get();
+        visible_data = &frame_draw_data[i];
+    }
+
+    bool const is_lone_fullscreen = visible
+        && visible_data->data.is_fullscreen
+        && !visible->shaped()
+        && visible->alpha() == 1.0f
+        && visible->screen_position() == viewport
+        && visible->transformation() == glm::mat4(1.f)
+        && visible_data->data.transform == glm::mat4(1.f)
+        && visible_data->data.workspace_transform == glm::mat4(1.f)
+        && frame_mode != WindowManagerMode::selecting;
+
+    if (is_lone_fullscreen != is_compositing_fullscreen)
+    {
+        is_compositing_fullscreen = is_lone_fullscreen;
+        if (is_lone_fullscreen)
+            mir::log_info("Renderer: fullscreen surface was not scanned out directly, compositing it on output %dx%d+%d+%d",
+                viewport.size.width.as_int(), viewport.size.height.as_int(),
+                viewport.top_left.x.as_int(), viewport.top_left.y.as_int());
+        else
+            mir::log_info("Renderer: no longer compositing a lone fullscreen surface on output %dx%d+%d+%d",
+                viewport.size.width.as_int(), viewport.size.height.as_int(),
+                viewport.top_left.x.as_int(), viewport.top_left.y.as_int());
+    }
+
+    return is_lone_fullscreen;
+}
+
+bool Renderer::shows_focused_window(mg::RenderableList const& renderables) const
+{
+    return std::ranges::any_of(renderables, [&](auto const& r)
+    {
+        auto const surface = r->surface_if_any();
+        if (!surface)
+            return false;
+
+        auto const data = frame_render_data.find(surface.value());
+        return data && data->is_focused;
+    });
+}
+
+mg::RenderableList const& Renderer::select_renderables(mg::RenderableList const& renderables) const
+{
+    bool const is_locked = compositor_state->is_session_locked();
+    if (is_locked != was_session_locked)
+    {
+        // Nothing that was on the output before the session was locked may be left on it
+        was_session_locked = is_locked;
+        damage_tracker.invalidate();
+    }
+
+    if (!is_locked)
+        return renderables;
+
+    lock_screen_renderables.clear();
+    for (auto const& r : renderables)
+    {
+        auto const surface = r->surface_if_any();
+        if (!surface || surface.value()->visible_on_lock_screen())
+            lock_screen_renderables.push_back(r);
+    }
+    return lock_screen_renderables;
+}
+
+bool Renderer::wait_for_frame_rate_cap(mg::RenderableList const& renderables) const
+{
+    // Anything that the window manager is moving is drawn at the full rate, and
+    // so is an output that the cursor is composited on, as the cursor follows input.
+    // The lock screen is drawn at the full rate too, so that it shows up at once.
+    if (frame_render_data.mode() != WindowManagerMode::normal
+        || render_data_fetch.refreshed
+        || is_compositing_cursor
+        || was_session_locked)
+        return false;
+
+    auto const fps = frame_config->frame_rate_caps.cap(shows_focused_window(renderables));
+    if (fps <= 0)
+        return false;
+
+    auto const deadline = last_frame_start + std::chrono::nanoseconds(std::chrono::seconds(1)) / fps;
+    auto now = std::chrono::steady_clock::now();
+    if (now >= deadline)
+        return false;
+
+    // The wait is broken up into refresh intervals, so that a change made by the
+    // window manager in the meantime, like the start of an animation, is not held back
+    auto const& frame_clock = compositor_state->frame_clock();
+    while (now < deadline)
+    {
+        std::this_thread::sleep_until(std::min(deadline, now + frame_clock->refresh_interval()));
+        compositor_state->render_data_manager()->update(frame_render_data, render_data_fetch);
+        if (render_data_fetch.refreshed || compositor_state->is_session_locked())
+            break;
+        now = std::chrono::steady_clock::now();
+    }
+
+    return true;
+}
+
+void Renderer::update_cursor_status(mg::RenderableList const& renderables) const
+{
+    // A software cursor moves like any other renderable, so it only damages the
+    // rectangles that it leaves and enters. It is still worth knowing about, as it
+    // keeps a fullscreen surface from being scanned out.
+    bool const has_software_cursor = std::ranges::any_of(renderables, [](auto const& r)
+    {
+        return !r->surface_if_any();
+    });
+
+    if (has_software_cursor != is_compositing_cursor)
+    {
+        is_compositing_cursor = has_software_cursor;
+        if (has_software_cursor)
+            mir::log_info("Renderer: no cursor plane is in use, compositing a software cursor on output %dx%d+%d+%d",
+                viewport.size.width.as_int(), viewport.size.height.as_int(),
+                viewport.top_left.x.as_int(), viewport.top_left.y.as_int());
+        else
+            mir::log_info("Renderer: no longer compositing a software cursor on output %dx%d+%d+%d",
+                viewport.size.width.as_int(), viewport.size.height.as_int(),
+                viewport.top_left.x.as_int(), viewport.top_left.y.as_int());
+    }
+}
+
+RenderFilter Renderer::render_filter(DrawData const& data) const
+{
+    if (frame_mode == WindowManagerMode::selecting && !data.data.is_focused)
+        return RenderFilter::grayscale;
+    return RenderFilter::none;
+}
+
+bool Renderer::is_transformed(mg::Renderable const& renderable, DrawData const& data)
+{
+    return renderable.transformation() != glm::mat4(1.f)
+        || data.data.transform != glm::mat4(1.f)
+        || data.data.workspace_transform != glm::mat4(1.f);
+}
+
+void Renderer::sort_renderables(
+    mg::RenderableList const& renderables,
+    std::optional<geom::Rectangle> const& damage) const
+{
+    draw_order_items.clear();
+    FrameVector<size_t> indices { FrameArenaAllocator<size_t>(frame_arena) };
+    indices.reserve(renderables.size());
+    for (size_t i = 0; i < renderables.size(); i++)
+    {
+        auto& data = frame_draw_data[i];
+        if (data.occluded || (damage && !damage->overlaps(damage_entries[i].area)))
+            continue;
+
+        auto const& renderable = *renderables[i];
+        data.texture = texture_for(renderable);
+
+        // Mirrors the program and blend selection in draw()
+        auto const& family = program_factory->variant(
+            dynamic_cast<Program const&>(data.texture->shader(*program_factory)), render_filter(data));
+        GLuint const program = renderable.alpha() < 1.0f ? family.alpha.id : family.opaque.id;
+        std::uint64_t const blend = renderable.shaped() ? 1 : (renderable.alpha() == 1.0f ? 0 : 2);
+
+        indices.push_back(i);
+        draw_order_items.push_back(DrawOrderItem {
+            .area = damage_entries[i].area,
+            .batch_key = (static_cast<std::uint64_t>(program) << 2) | blend,
+            .is_barrier = is_transformed(renderable, data) });
+    }
+
+    draw_order.clear();
+    for (auto const index : sort_draw_order(draw_order_items, frame_arena))
+        draw_order.push_back(indices[index]);
+}
+
+void Renderer::upload_vertices(
+    mg::RenderableList const& renderables,
+    std::optional<geom::Rectangle> const& damage) const
+{
+    frame_vertices.clear();
+    for (size_t i = 0; i < renderables.size(); i++)
+    {
+        if (frame_draw_data[i].occluded || (damage && !damage->overlaps(damage_entries[i].area)))
+            continue;
+
+        auto const primitive = mgl::tessellate_renderable_into_rectangle(*renderables[i], geom::Displacement { 0, 0 });
+        frame_draw_data[i].first_vertex = (GLint)frame_vertices.size();
+        frame_vertices.insert(frame_vertices.end(), std::begin(primitive.vertices), std::end(primitive.vertices));
+    }
+
+    if (frame_vertices.empty())
+        return;
+
+    // Cycle through the buffers so that we never write to one that the GPU may still be reading from.
+    vertex_buffer_index = (vertex_buffer_index + 1) % vertex_buffers.size();
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[vertex_buffer_index]);
+    glBufferData(
+        GL_ARRAY_BUFFER,
+        (GLsizeiptr)(frame_vertices.size() * sizeof(mgl::Vertex)),
+        frame_vertices.data(),
+        GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+auto Renderer::render(mg::RenderableList const& all_renderables) const -> std::unique_ptr<mg::Framebuffer>
+{
+    // Each output may be composited on a thread of its own
+    thread_local bool is_thread_scheduled = false;
+    if (!is_thread_scheduled)
+    {
+        is_thread_scheduled = true;
+        apply_thread_scheduling("Render", config->scheduling().render);
+    }
+
     output_surface->make_current();
     output_surface->bind();
 
-    glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
-    glClearStencil(0);
-    glStencilMask(0xFF);
-    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-    glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-
+    auto start = std::chrono::steady_clock::now();
     ++frameno;
+    frame_arena.reset();
+    is_mirrored = false;
+    renderables_drawn = 0;
+    scaled_renderables_drawn = 0;
+    texture_cache.begin_frame();
+    outlines_drawn = 0;
+    gl_state.begin_frame();
+    frame_config = config->snapshot();
+    quality_tier = frame_config->quality_tier.value_or(detected_quality_tier);
+    compositor_state->set_quality_tier(quality_tier);
+    take_gpu_memory_evictions();
+    compositor_state->render_data_manager()->update(frame_render_data, render_data_fetch);
+    auto const& renderables = select_renderables(all_renderables);
+    update_cursor_status(renderables);
+
+    // The time spent held back by the cap is not part of the frame
+    is_frame_capped = wait_for_frame_rate_cap(renderables);
+    if (is_frame_capped)
+        start = std::chrono::steady_clock::now();
+    last_frame_start = start;
+
+    frame_mode = frame_render_data.mode();
+    frame_drag_preview = frame_mode == WindowManagerMode::dragging
+        ? frame_render_data.drag_preview()
+        : std::nullopt;
+    resolve_frame_borders();
+
+    update_mirror_role();
+    if (mirror_role == MirrorGroups::Role::mirror)
+    {
+        if (auto output = draw_mirrored_frame(renderables, start))
+            return output;
+    }
+    else if (mirror_role == MirrorGroups::Role::source)
+    {
+        // The mirrors must be done with the last frame before it is drawn over
+        compositor_state->mirror_groups()->begin_drawing(this, mirror_reads);
+        for (auto const& read : mirror_reads)
+            read->wait();
+        mirror_reads.clear();
+    }
 
-    auto const& render_data = compositor_state->render_data_manager()->get();
+    // Without buffer age, every frame is drawn from scratch. That is cheap on a GPU
+    // but not on the CPU, where drawing offscreen and copying the result across
+    // lets only the damage be drawn.
+    is_post_processing = begin_post_processing(
+        frame_config->color_filter,
+        (quality_tier == QualityTier::reduced && !has_buffer_age) || mirror_role == MirrorGroups::Role::source);
+
+    // An idle output is committed as it is, without so much as looking at the
+    // windows, once the buffer that we are given has caught up with the scene.
+    if (is_scene_unchanged(renderables)
+        && can_track_output_damage()
+        && damage_tracker.is_up_to_date(get_buffer_age()))
+    {
+        damage_tracker.repeat_frame();
+        is_blur_dirty = false;
+        if (is_post_processing)
+            finish_post_processing();
+
+        publish_mirrored_frame(renderables);
+        track_gpu_memory();
+        auto output = output_surface->commit();
+        report_frame_stats(start, 0, true);
+        return output;
+    }
+
+    frame_draw_data.clear();
+    for (auto const& r : renderables)
+        frame_draw_data.push_back(get_draw_data(*r, frame_render_data));
+
+    prepare_blur(renderables);
+    auto const damage = calculate_damage(renderables);
+    if (damage && (damage->size.width.as_int() <= 0 || damage->size.height.as_int() <= 0))
+    {
+        // Nothing has changed since the contents of this buffer were drawn. The
+        // offscreen target is up to date, but the output's buffer may not be.
+        if (is_post_processing)
+            finish_post_processing();
+
+        publish_mirrored_frame(renderables);
+        track_gpu_memory();
+        auto output = output_surface->commit();
+        report_frame_stats(start, 0, true);
+        return output;
+    }
+
+    // Buffers that are not drawn because they are outside of the damage are
+    // still on the output, so their textures are kept for when they are drawn
     for (auto const& r : renderables)
     {
-        auto data = draw(*r, get_draw_data(*r, render_data));
-        if (data.enabled && data.outline_context.enabled)
+        if (auto const buffer = r->buffer())
+            texture_cache.keep(buffer->id().as_value());
+    }
+
+    // The blur is timed on its own, as timer queries cannot be nested
+    if (is_blur_dirty)
+        update_blur(renderables);
+    track_gpu_memory();
+
+    gpu_timer->begin_frame();
+
+    damage_scissor.reset();
+    if (damage)
+    {
+        damage_scissor = to_gl_rectangle(damage.value());
+        set_scissor(damage_scissor.value());
+    }
+
+    cull_occluded(renderables);
+    bool const is_lone_fullscreen = update_fullscreen_status(renderables);
+    upload_vertices(renderables, damage);
+    sort_renderables(renderables, damage);
+
+    // A lone fullscreen surface covers every pixel, so there is nothing to clear.
+    if (!is_lone_fullscreen)
+    {
+        glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
+        glClearStencil(0);
+        gl_state.stencil_mask(0xFF);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    }
+
+    if (is_blurring)
+    {
+        gl_state.active_texture(static_cast<GLenum>(GL_TEXTURE0 + blur_texture_unit));
+        glBindTexture(GL_TEXTURE_2D, blur_levels[1]->texture());
+        gl_state.active_texture(GL_TEXTURE0);
+    }
+
+    auto* open_stats = compositor_state->window_open_stats();
+    for (auto const i : draw_order)
+    {
+        auto const& r = renderables[i];
+
+        // Borders are drawn in batches, so any queued border that this renderable
+        // is stacked on top of must be drawn before it.
+        auto const screen_position = r->screen_position();
+        if (std::any_of(pending_border_areas.begin(), pending_border_areas.end(), [&](geom::Rectangle const& area)
+        {
+            return area.overlaps(screen_position);
+        }))
+            flush_borders();
+
+        auto& data = frame_draw_data[i];
+        bool const has_outline = draw(*r, data);
+        data.texture.reset();
+        renderables_drawn++;
+        if (open_stats->has_pending())
+        {
+            if (auto const surface = r->surface_if_any())
+                open_stats->mark(surface.value(), WindowOpenStage::first_frame);
+        }
+
+        if (has_outline)
         {
-            if (has_stencil_support)
+            outlines_drawn++;
+            data.outline_context = { true, static_cast<uint8_t>(data.data.is_focused) };
+            if (program_factory->border_program())
+            {
+                append_border(*r, data);
+            }
+            else if (has_stencil_support)
             {
-                OutlineRenderable outline(*r, data.outline_context.size, data.outline_context.color.a);
+                // The outline is not in the frame's vertex buffer, so it is tessellated
+                data.first_vertex = -1;
+                OutlineRenderable outline(
+                    *r, frame_borders.size, frame_borders.colors[data.outline_context.color_index].a);
                 draw(outline, data);
                 glClear(GL_STENCIL_BUFFER_BIT);
             }
@@ -268,53 +940,586 @@ auto Renderer::render(mg::RenderableList const& renderables) const -> std::uniqu
         }
     }
 
+    flush_borders();
+    draw_placeholders();
+    draw_drag_preview();
+
+    // We're done with the textures for this frame
+    for (auto const& texture : frame_textures)
+        texture->add_syncpoint();
+    frame_textures.clear();
+    texture_cache.end_frame();
+
+    if (damage_scissor)
+    {
+        gl_state.set_enabled(GL_SCISSOR_TEST, false);
+        damage_scissor.reset();
+    }
+
+    if (is_post_processing)
+        finish_post_processing();
+    publish_mirrored_frame(renderables);
+
+    auto const& stats = gl_state.stats();
+    if (frameno % 600 == 0)
+        MIRACLE_LOG_DEBUG(LogCategory::render, "GL state calls: issued=%zu, skipped=%zu, culled renderables=%zu, frame arena=%zu/%zu bytes",
+            stats.issued, stats.skipped, culled_count, frame_arena.used(), frame_arena.capacity());
+
+#ifndef NDEBUG
+    // Once the arena has grown to fit a typical frame, frames should no longer allocate from
+    // the heap. Growth after that is worth knowing about, although a new scene may cause it.
+    if (frame_arena.heap_allocations() != last_arena_allocations)
+    {
+        if (frameno > arena_warmup_frames)
+            MIRACLE_LOG_DEBUG(LogCategory::render, "Renderer: frame %lld outgrew the frame arena, which now holds %zu bytes",
+                frameno, frame_arena.capacity());
+        last_arena_allocations = frame_arena.heap_allocations();
+    }
+#endif
+
+    gpu_timer->end_frame();
     auto output = output_surface->commit();
 
     // Report any GL errors after commit, to catch any *during* commit
+    size_t gl_errors = 0;
     while (auto const gl_error = glGetError())
-        mir::log_debug("GL error: %d", gl_error);
+    {
+        MIRACLE_LOG_DEBUG(LogCategory::render, "GL error: %d", gl_error);
+        gl_errors++;
+    }
+
+    report_frame_stats(start, gl_errors);
+    return output;
+}
+
+bool Renderer::begin_post_processing(RenderFilter filter, bool force) const
+{
+    if (filter != post_process_filter)
+    {
+        // The filter changes every pixel of the output.
+        post_process_filter = filter;
+        post_process_matrix = color_filter_matrix(filter);
+        damage_tracker.invalidate();
+    }
+
+    if ((filter == RenderFilter::none && !force) || is_post_processing_unsupported)
+    {
+        post_process_target.reset();
+        return false;
+    }
+
+    if (!program_factory->post_process_program())
+    {
+        is_post_processing_unsupported = true;
+        return false;
+    }
+
+    auto const sampling = mirror_role == MirrorGroups::Role::source ? GL_LINEAR : GL_NEAREST;
+    if (post_process_target && sampling != post_process_sampling)
+        post_process_target.reset();
+
+    if (!post_process_target)
+    {
+        post_process_target = std::make_unique<PostProcessTarget>(sampling);
+        post_process_sampling = sampling;
+    }
+
+    auto const age = post_process_target->bind(
+        output_surface->size(), has_stencil_support && !program_factory->border_program());
+    if (!age)
+    {
+        mir::log_warning("Renderer: unable to draw offscreen, the color filter is disabled");
+        is_post_processing_unsupported = true;
+        post_process_target.reset();
+        output_surface->bind();
+        return false;
+    }
+
+    post_process_age = age.value();
+    return true;
+}
+
+void Renderer::finish_post_processing() const
+{
+    // The target has the same size and layout as the output's buffer, so it is
+    // copied across pixel for pixel, including any letterboxing.
+    draw_texture_to_output(post_process_target->texture());
+}
+
+void Renderer::draw_texture_to_output(GLuint texture) const
+{
+    output_surface->bind();
+    auto const size = output_surface->size();
+    glViewport(0, 0, size.width.as_int(), size.height.as_int());
+
+    auto const* prog = program_factory->post_process_program();
+    gl_state.use_program(prog->id);
+    gl_state.uniform(prog->tex_uniform, 0);
+    glUniformMatrix3fv(prog->color_matrix_uniform, 1, GL_FALSE, post_process_matrix.data());
+
+    gl_state.set_enabled(GL_SCISSOR_TEST, false);
+    gl_state.set_enabled(GL_STENCIL_TEST, false);
+    gl_state.set_enabled(GL_BLEND, false);
+    gl_state.active_texture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    draw_fullscreen_quad(prog->position_attr);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    update_gl_viewport();
+}
+
+void Renderer::update_mirror_role() const
+{
+    auto* groups = compositor_state->mirror_groups();
+    groups->set_output(
+        this,
+        viewport,
+        output_surface->size(),
+        output_surface->layout() == mg::gl::OutputSurface::Layout::TopRowFirst,
+        share_group.id(),
+        has_gpu_fences
+            && has_identity_output_transform
+            && !is_post_processing_unsupported);
+
+    auto const role = groups->role(this);
+    if (role == mirror_role)
+        return;
 
+    mir::log_info("Renderer: output %dx%d+%d+%d is now %s",
+        viewport.size.width.as_int(), viewport.size.height.as_int(),
+        viewport.top_left.x.as_int(), viewport.top_left.y.as_int(),
+        role == MirrorGroups::Role::source ? "drawing for the outputs that mirror it"
+            : role == MirrorGroups::Role::mirror ? "showing the frames of the output that it mirrors"
+                                                  : "drawing by itself");
+    mirror_role = role;
+}
+
+uint64_t Renderer::hash_scene(mg::RenderableList const& renderables) const
+{
+    // FNV-1a, over the same fields as SceneEntry
+    uint64_t hash = 14695981039346656037ull;
+    auto const mix = [&](void const* data, size_t size)
+    {
+        auto const* bytes = static_cast<unsigned char const*>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    auto const mix_value = [&](auto const value)
+    {
+        mix(&value, sizeof(value));
+    };
+    auto const mix_rectangle = [&](geom::Rectangle const& rectangle)
+    {
+        mix_value(rectangle.top_left.x.as_int());
+        mix_value(rectangle.top_left.y.as_int());
+        mix_value(rectangle.size.width.as_int());
+        mix_value(rectangle.size.height.as_int());
+    };
+
+    mix_value(frame_render_data.generation());
+    mix_value(static_cast<void const*>(frame_config.get()));
+    for (auto const& r : renderables)
+    {
+        auto const buffer = r->buffer();
+        auto const clip_area = r->clip_area();
+        auto const transformation = r->transformation();
+        mix_value(static_cast<void const*>(r->id()));
+        mix_value(buffer ? buffer->id().as_value() : 0);
+        mix_rectangle(r->screen_position());
+        mix_value(clip_area.has_value());
+        if (clip_area)
+            mix_rectangle(clip_area.value());
+        mix_value(r->alpha());
+        mix(glm::value_ptr(transformation), sizeof(transformation));
+        mix_value(r->shaped());
+    }
+
+    return hash;
+}
+
+std::unique_ptr<mg::Framebuffer> Renderer::draw_mirrored_frame(
+    mg::RenderableList const& renderables,
+    std::chrono::steady_clock::time_point start) const
+{
+    if (!program_factory->post_process_program())
+        return nullptr;
+
+    // The source is usually drawing the same scene at about the same time
+    auto* groups = compositor_state->mirror_groups();
+    auto const frame = groups->frame_for(
+        this, hash_scene(renderables), compositor_state->frame_clock()->refresh_interval() / 2);
+    if (!frame)
+        return nullptr;
+
+    if (frame_config->color_filter != post_process_filter)
+    {
+        post_process_filter = frame_config->color_filter;
+        post_process_matrix = color_filter_matrix(post_process_filter);
+    }
+
+    if (frame->drawn)
+        frame->drawn->wait();
+    draw_texture_to_output(frame->texture);
+    groups->finish_reading(this, GpuFence::create());
+
+    // Whatever was in the buffers of this output is gone, so that it is drawn in
+    // full once it draws by itself again. It needs no offscreen target of its own.
+    damage_tracker.invalidate();
+    post_process_target.reset();
+    is_mirrored = true;
+
+    track_gpu_memory();
+    auto output = output_surface->commit();
+    report_frame_stats(start, 0);
     return output;
 }
 
-miracle::Renderer::DrawData Renderer::draw(
+void Renderer::publish_mirrored_frame(mg::RenderableList const& renderables) const
+{
+    if (mirror_role != MirrorGroups::Role::source || !is_post_processing)
+        return;
+
+    compositor_state->mirror_groups()->publish(this, std::make_shared<MirrorFrame const>(MirrorFrame {
+        .texture = post_process_target->texture(),
+        .scene = hash_scene(renderables),
+        .drawn = GpuFence::create() }));
+}
+
+void Renderer::bind_frame_target() const
+{
+    if (is_post_processing)
+        post_process_target->bind(output_surface->size(), has_stencil_support && !program_factory->border_program());
+    else
+        output_surface->bind();
+}
+
+std::shared_ptr<mg::gl::Texture> Renderer::texture_for(mg::Renderable const& renderable) const
+{
+    auto const buffer = renderable.buffer();
+    return texture_cache.get(buffer->id().as_value(), upload_size(*buffer), [&]
+    {
+        return gl_interface->as_texture(buffer);
+    });
+}
+
+bool Renderer::is_pixel_exact(mg::Renderable const& renderable, DrawData const& data) const
+{
+    if (!has_identity_output_transform
+        || renderable.transformation() != glm::mat4(1.f)
+        || data.data.transform != glm::mat4(1.f)
+        || data.data.workspace_transform != glm::mat4(1.f))
+        return false;
+
+    // The viewport is in logical pixels, while the output's buffer is in physical ones
+    auto const output_size = output_surface->size();
+    auto const scale_x = static_cast<double>(output_size.width.as_int()) / viewport.size.width.as_int();
+    auto const scale_y = static_cast<double>(output_size.height.as_int()) / viewport.size.height.as_int();
+    auto const src = renderable.src_bounds();
+    auto const dst = renderable.screen_position();
+    return std::abs(src.size.width.as_value() - dst.size.width.as_int() * scale_x) < 0.5
+        && std::abs(src.size.height.as_value() - dst.size.height.as_int() * scale_y) < 0.5;
+}
+
+bool Renderer::shows_blur(mg::Renderable const& renderable, DrawData const& data) const
+{
+    // Only windows are drawn over the blur, so that panels and the like keep their own look
+    return data.data.surface
+        && !data.data.is_hidden_tab
+        && (renderable.shaped() || renderable.alpha() < 1.f);
+}
+
+void Renderer::prepare_blur(mg::RenderableList const& renderables) const
+{
+    is_blurring = false;
+    is_blur_dirty = false;
+    auto const& blur = frame_config->blur;
+    if (!blur.enabled || is_blur_unsupported || quality_tier == QualityTier::reduced)
+    {
+        blur_levels.clear();
+        is_blur_valid = false;
+        return;
+    }
+
+    // The background is whatever is stacked below the lowest window, such as the wallpaper
+    frame_background_count = renderables.size();
+    for (size_t i = 0; i < renderables.size(); i++)
+    {
+        if (frame_draw_data[i].data.surface)
+        {
+            frame_background_count = i;
+            break;
+        }
+    }
+
+    for (size_t i = frame_background_count; i < renderables.size() && !is_blurring; i++)
+        is_blurring = shows_blur(*renderables[i], frame_draw_data[i]);
+
+    // The blur is kept while no window needs it, in case one needs it again soon
+    if (!is_blurring)
+        return;
+
+    if (!program_factory->blur_programs())
+    {
+        is_blur_unsupported = true;
+        is_blurring = false;
+        return;
+    }
+
+    frame_background.clear();
+    for (size_t i = 0; i < frame_background_count; i++)
+    {
+        auto const& renderable = *renderables[i];
+        auto const buffer = renderable.buffer();
+        frame_background.push_back(DamageTrackerEntry {
+            .id = renderable.id(),
+            .buffer_id = buffer ? buffer->id() : mg::BufferID {},
+            .area = renderable.screen_position(),
+            .clip_area = renderable.clip_area(),
+            .alpha = renderable.alpha() });
+    }
+
+    is_blur_dirty = !is_blur_valid
+        || blurred_size != output_surface->size()
+        || blurred_passes != blur.passes
+        || blurred_offset != blur.offset
+        || blurred_mode != frame_mode
+        || frame_background != blurred_background;
+}
+
+void Renderer::update_blur(mg::RenderableList const& renderables) const
+{
+    auto const& blur = frame_config->blur;
+    auto const* programs = program_factory->blur_programs();
+    auto const size = output_surface->size();
+    if (!blur_timer)
+        blur_timer = std::make_unique<GpuTimer>();
+
+    auto const level_count = static_cast<size_t>(blur.passes) + 1;
+    while (blur_levels.size() < level_count)
+        blur_levels.push_back(std::make_unique<PostProcessTarget>(GL_LINEAR));
+    blur_levels.resize(level_count);
+
+    auto const level_size = [&](size_t level)
+    {
+        return geom::Size {
+            std::max(1, size.width.as_int() >> level),
+            std::max(1, size.height.as_int() >> level) };
+    };
+
+    blur_timer->begin_frame();
+
+    // The background is drawn exactly as it is drawn onto the output, so that the
+    // blur lines up with the windows that are drawn over it
+    if (!blur_levels[0]->bind(size, false))
+    {
+        mir::log_warning("Renderer: unable to draw offscreen, blur is disabled");
+        blur_timer->end_frame();
+        blur_levels.clear();
+        is_blur_unsupported = true;
+        is_blurring = false;
+        is_blur_dirty = false;
+        bind_frame_target();
+        return;
+    }
+
+    gl_state.set_enabled(GL_SCISSOR_TEST, false);
+    glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glClear(GL_COLOR_BUFFER_BIT);
+    for (size_t i = 0; i < frame_background_count; i++)
+        draw(*renderables[i], frame_draw_data[i]);
+
+    gl_state.set_enabled(GL_SCISSOR_TEST, false);
+    gl_state.set_enabled(GL_STENCIL_TEST, false);
+    gl_state.set_enabled(GL_BLEND, false);
+    gl_state.active_texture(GL_TEXTURE0);
+
+    auto const pass = [&](BlurProgramData const& program, size_t from, size_t to)
+    {
+        auto const to_size = level_size(to);
+        blur_levels[to]->bind(to_size, false);
+        glViewport(0, 0, to_size.width.as_int(), to_size.height.as_int());
+        gl_state.use_program(program.id);
+        gl_state.uniform(program.tex_uniform, 0);
+        gl_state.uniform(program.half_pixel_uniform, glm::vec2(
+            0.5f * blur.offset / static_cast<float>(to_size.width.as_int()),
+            0.5f * blur.offset / static_cast<float>(to_size.height.as_int())));
+        glBindTexture(GL_TEXTURE_2D, blur_levels[from]->texture());
+        draw_fullscreen_quad(program.position_attr);
+    };
+
+    // Down to the smallest level and back up again, but only as far as half of
+    // the size of the output: the blur has no detail left to lose at that size
+    for (size_t level = 1; level < level_count; level++)
+        pass(programs->downsample, level - 1, level);
+    for (size_t level = level_count - 1; level > 1; level--)
+        pass(programs->upsample, level, level - 1);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    blur_timer->end_frame();
+
+    bind_frame_target();
+    update_gl_viewport();
+
+    blurred_background = frame_background;
+    blurred_size = size;
+    blurred_passes = blur.passes;
+    blurred_offset = blur.offset;
+    blurred_mode = frame_mode;
+    is_blur_valid = true;
+}
+
+void Renderer::take_gpu_memory_evictions() const
+{
+    auto* budget = compositor_state->gpu_memory_budget();
+    budget->set_budget(frame_config->gpu_memory_budget_bytes);
+    gpu_memory_evictions = 0;
+    if (budget->take_eviction(this, blur_memory_slot))
+    {
+        blur_levels.clear();
+        is_blur_valid = false;
+        gpu_memory_evictions++;
+    }
+}
+
+void Renderer::track_gpu_memory() const
+{
+    auto* budget = compositor_state->gpu_memory_budget();
+    if (post_process_target)
+        budget->use(this, post_process_memory_slot, post_process_target->bytes(), false);
+    else
+        budget->release(this, post_process_memory_slot);
+
+    // The blur is only counted as used on frames that draw over it, so that one
+    // which is kept while no window needs it is the first to go
+    if (blur_levels.empty())
+        budget->release(this, blur_memory_slot);
+    else if (is_blurring)
+    {
+        size_t bytes = 0;
+        for (auto const& level : blur_levels)
+            bytes += level->bytes();
+        budget->use(this, blur_memory_slot, bytes, true);
+    }
+}
+
+void Renderer::report_frame_stats(std::chrono::steady_clock::time_point start, size_t gl_errors, bool skipped) const
+{
+    auto const cpu_time = std::chrono::steady_clock::now() - start;
+    auto const input_latency = take_input_latency();
+    auto const uploaded_bytes = texture_cache.uploaded_bytes();
+    if (frameno == 1)
+        StartupProfile::instance().mark("first frame");
+    auto& metrics = Metrics::instance();
+    metrics.increment(MetricCounter::frames);
+    metrics.increment(MetricCounter::renderables_drawn, renderables_drawn);
+    metrics.increment(MetricCounter::texture_upload_bytes, uploaded_bytes);
+    metrics.observe(MetricHistogram::frame_time, cpu_time);
+    if (input_latency)
+        metrics.observe(MetricHistogram::input_latency, input_latency.value());
+    compositor_state->frame_clock()->on_frame(this);
+    compositor_state->frame_clock()->on_render_time(this, cpu_time);
+    compositor_state->render_stats()->record(this, viewport, RenderFrameStats {
+        .frameno = frameno,
+        .cpu_time = cpu_time,
+        .gpu_time = gpu_timer->poll(),
+        .renderables_drawn = renderables_drawn,
+        .scaled_renderables_drawn = scaled_renderables_drawn,
+        .outlines_drawn = outlines_drawn,
+        .uploaded_bytes = uploaded_bytes,
+        .gl_errors = gl_errors,
+        .skipped = skipped,
+        .software_cursor = is_compositing_cursor,
+        .capped = is_frame_capped,
+        .mirrored = is_mirrored,
+        .render_data_refreshed = render_data_fetch.refreshed,
+        .render_data_contended = render_data_fetch.contended,
+        .render_data_wait = render_data_fetch.wait,
+        .input_latency = input_latency,
+        .blur_updated = is_blur_dirty,
+        .blur_gpu_time = blur_timer ? blur_timer->poll() : std::nullopt,
+        .gpu_memory_bytes = compositor_state->gpu_memory_budget()->used_bytes(this),
+        .gpu_memory_budget_bytes = compositor_state->gpu_memory_budget()->budget_bytes(),
+        .gpu_memory_evictions = gpu_memory_evictions
+    });
+}
+
+std::optional<std::chrono::nanoseconds> Renderer::take_input_latency() const
+{
+    std::optional<std::chrono::steady_clock::time_point> newest;
+    for (auto const& draw_data : frame_draw_data)
+    {
+        auto const& time = draw_data.data.input_time;
+        if (time && time.value() > last_input_time && (!newest || time.value() > newest.value()))
+            newest = time;
+    }
+
+    if (!newest)
+        return std::nullopt;
+
+    last_input_time = newest.value();
+    return std::chrono::steady_clock::now() - newest.value();
+}
+
+void Renderer::resolve_frame_borders() const
+{
+    auto const& border_config = frame_config->border_config;
+    frame_borders.size = border_config.size;
+    frame_borders.colors = { border_config.color, border_config.focus_color };
+    for (size_t i = 0; i < frame_borders.colors.size(); i++)
+    {
+        auto color = frame_borders.colors[i];
+        bool const is_focused = i == 1;
+        if (frame_mode == WindowManagerMode::selecting && !is_focused)
+        {
+            float const gray = 0.299f * color.r + 0.587f * color.g + 0.114f * color.b;
+            color = glm::vec4(gray, gray, gray, color.a);
+        }
+
+        // Colors are premultiplied so that every border can share a single blend function.
+        frame_borders.premultiplied_colors[i] = { color.r * color.a, color.g * color.a, color.b * color.a, color.a };
+    }
+}
+
+bool Renderer::draw(
     mg::Renderable const& renderable,
     DrawData const& data) const
 {
-    auto const texture = gl_interface->as_texture(renderable.buffer());
+    auto const texture = data.texture ? data.texture : texture_for(renderable);
     auto const clip_area = renderable.clip_area();
     if (clip_area)
     {
-        glEnable(GL_SCISSOR_TEST);
         // The Y-coordinate is always relative to the top, so we make it relative to the bottom.
         auto clip_y = viewport.top_left.y.as_int() + viewport.size.height.as_int()
             - clip_area.value().top_left.y.as_int() - clip_area.value().size.height.as_int();
         glm::vec4 clip_pos(clip_area.value().top_left.x.as_int(), clip_y, 0, 1);
         clip_pos = display_transform * data.data.workspace_transform * clip_pos;
 
-        glScissor(
-            (int)clip_pos.x - viewport.top_left.x.as_int(),
-            (int)clip_pos.y,
-            clip_area.value().size.width.as_int(),
-            clip_area.value().size.height.as_int());
+        set_scissor(geom::Rectangle {
+            geom::Point { (int)clip_pos.x - viewport.top_left.x.as_int(), (int)clip_pos.y },
+            clip_area.value().size });
     }
 
     // Resource: https://stackoverflow.com/questions/48246302/writing-to-the-opengl-stencil-buffer
     if (data.outline_context.enabled)
     {
-        glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
-        glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
+        gl_state.stencil_op(GL_KEEP, GL_KEEP, GL_KEEP);
+        gl_state.stencil_func(GL_NOTEQUAL, 1, 0xFF);
     }
-    else if (data.data.needs_outline)
+    else if (data.data.needs_outline && !program_factory->border_program())
     {
-        glEnable(GL_STENCIL_TEST);
-        glStencilFunc(GL_ALWAYS, 1, 0xFF);
-        glStencilMask(0xFF);
-        glStencilOp(GL_REPLACE, GL_REPLACE, GL_REPLACE);
+        gl_state.set_enabled(GL_STENCIL_TEST, true);
+        gl_state.stencil_func(GL_ALWAYS, 1, 0xFF);
+        gl_state.stencil_mask(0xFF);
+        gl_state.stencil_op(GL_REPLACE, GL_REPLACE, GL_REPLACE);
     }
     else
     {
-        glDisable(GL_STENCIL_TEST);
+        gl_state.set_enabled(GL_STENCIL_TEST, false);
     }
 
     // All the programs are held by program_factory through its lifetime. Using pointers avoids
@@ -322,38 +1527,46 @@ miracle::Renderer::DrawData Renderer::draw(
     auto const* const prog =
         [&](bool alpha) -> ProgramData const*
     {
-        auto const& family = dynamic_cast<Program const&>(texture->shader(*program_factory));
+        auto const& program = dynamic_cast<Program const&>(texture->shader(*program_factory));
+        auto const& family = program_factory->variant(program, render_filter(data));
         if (data.outline_context.enabled)
             return &family.outline;
+        if (is_blurring && shows_blur(renderable, data))
+            return &program_factory->blurred(program, render_filter(data));
         if (alpha)
             return &family.alpha;
         return &family.opaque;
     }(renderable.alpha() < 1.0f);
+    bool const is_blurred = prog->blur_tex_uniform >= 0;
 
-    glUseProgram(prog->id);
+    gl_state.use_program(prog->id);
     if (prog->last_used_frameno != frameno)
-    { // Avoid reloading the screen-global uniforms on every renderable
-        // TODO: We actually only need to bind these *once*, right? Not once per frame?
+    { // Avoid looking up the screen-global uniforms on every renderable
         prog->last_used_frameno = frameno;
         for (auto i = 0u; i < prog->tex_uniforms.size(); ++i)
         {
             if (prog->tex_uniforms[i] != -1)
             {
-                glUniform1i(prog->tex_uniforms[i], (int)i);
+                gl_state.uniform(prog->tex_uniforms[i], (GLint)i);
             }
         }
-        glUniformMatrix4fv(prog->display_transform_uniform, 1, GL_FALSE,
-            glm::value_ptr(display_transform));
-        glUniformMatrix4fv(prog->screen_to_gl_coords_uniform, 1, GL_FALSE,
-            glm::value_ptr(screen_to_gl_coords));
+        gl_state.uniform(prog->display_transform_uniform, display_transform);
+        gl_state.uniform(prog->screen_to_gl_coords_uniform, screen_to_gl_coords);
+        if (is_blurred)
+        {
+            auto const size = output_surface->size();
+            gl_state.uniform(prog->blur_tex_uniform, blur_texture_unit);
+            gl_state.uniform(prog->blur_scale_uniform, glm::vec2(
+                1.f / static_cast<float>(size.width.as_int()), 1.f / static_cast<float>(size.height.as_int())));
+        }
     }
 
-    glActiveTexture(GL_TEXTURE0);
+    gl_state.active_texture(GL_TEXTURE0);
 
     auto const& rect = renderable.screen_position();
     GLfloat const top_left_x = (float)rect.top_left.x.as_int();
     GLfloat const top_left_y = (float)rect.top_left.y.as_int();
-    glUniform2f(prog->topleft_uniform, top_left_x, top_left_y);
+    gl_state.uniform(prog->topleft_uniform, glm::vec2(top_left_x, top_left_y));
 
     glm::mat4 transform = data.data.transform;
     if (texture->layout() == mg::gl::Texture::Layout::TopRowFirst)
@@ -368,34 +1581,15 @@ miracle::Renderer::DrawData Renderer::draw(
         };
     }
 
-    glUniformMatrix4fv(prog->transform_uniform, 1, GL_FALSE,
-        glm::value_ptr(transform));
+    gl_state.uniform(prog->transform_uniform, transform);
 
     if (prog->alpha_uniform >= 0)
-        glUniform1f(prog->alpha_uniform, renderable.alpha());
+        gl_state.uniform(prog->alpha_uniform, renderable.alpha());
 
-    switch (compositor_state->mode())
-    {
-    case WindowManagerMode::selecting:
-        glUniform1i(prog->mode_uniform, (int)(data.data.is_focused ? RenderFilter::none : RenderFilter::grayscale));
-        break;
-    default:
-        glUniform1i(prog->mode_uniform, (int)RenderFilter::none);
-        break;
-    }
-
-    glUniformMatrix4fv(prog->workspace_transform_uniform, 1, GL_FALSE,
-        glm::value_ptr(data.data.workspace_transform));
+    gl_state.uniform(prog->workspace_transform_uniform, data.data.workspace_transform);
 
     if (prog->outline_color_uniform >= 0 && data.outline_context.enabled)
-    {
-        glUniform4f(
-            prog->outline_color_uniform,
-            data.outline_context.color.r,
-            data.outline_context.color.g,
-            data.outline_context.color.b,
-            data.outline_context.color.a);
-    }
+        gl_state.uniform(prog->outline_color_uniform, frame_borders.colors[data.outline_context.color_index]);
 
     glEnableVertexAttribArray(prog->position_attr);
 
@@ -403,8 +1597,11 @@ miracle::Renderer::DrawData Renderer::draw(
     if (has_texcoord_attr)
         glEnableVertexAttribArray(prog->texcoord_attr);
 
+    // Renderables that were uploaded to the frame's vertex buffer don't need to be tessellated again
+    bool const uses_vertex_buffer = data.first_vertex >= 0;
     primitives.clear();
-    tessellate(primitives, renderable);
+    if (!uses_vertex_buffer)
+        tessellate(primitives, renderable);
 
     // if we fail to load the texture, we need to carry on (part of lp:1629275)
     try
@@ -417,7 +1614,7 @@ miracle::Renderer::DrawData Renderer::draw(
         BlendSeparate client_blend;
 
         // These renderable method names could be better (see LP: #1236224)
-        if (renderable.shaped()) // Client is RGBA:
+        if (renderable.shaped() || is_blurred) // Client is RGBA, or drawn over the blur:
         {
             client_blend = { GL_ONE, GL_ONE_MINUS_SRC_ALPHA,
                 GL_ONE, GL_ONE_MINUS_SRC_ALPHA };
@@ -433,42 +1630,66 @@ miracle::Renderer::DrawData Renderer::draw(
             // careful and avoid using SRC_ALPHA (LP: #1423462).
             client_blend = { GL_ONE, GL_ONE_MINUS_CONSTANT_ALPHA,
                 GL_ZERO, GL_ONE };
-            glBlendColor(0.0f, 0.0f, 0.0f, renderable.alpha());
+            gl_state.blend_color(0.0f, 0.0f, 0.0f, renderable.alpha());
         }
 
-        for (auto const& p : primitives)
+        // [vertices] is either a client-side pointer or an offset into the bound vertex buffer
+        auto const draw_vertices = [&](GLenum type, GLint first, GLsizei count, std::uintptr_t vertices)
         {
             BlendSeparate blend;
 
             blend = client_blend;
-            texture->bind();
-
             glVertexAttribPointer(prog->position_attr, 3, GL_FLOAT,
                 GL_FALSE, sizeof(mgl::Vertex),
-                &p.vertices[0].position);
+                reinterpret_cast<GLvoid const*>(vertices + offsetof(mgl::Vertex, position)));
 
             if (has_texcoord_attr)
             {
                 glVertexAttribPointer(prog->texcoord_attr, 2, GL_FLOAT,
                     GL_FALSE, sizeof(mgl::Vertex),
-                    &p.vertices[0].texcoord);
+                    reinterpret_cast<GLvoid const*>(vertices + offsetof(mgl::Vertex, texcoord)));
             }
 
             if (blend.dst_rgb == GL_ZERO)
             {
-                glDisable(GL_BLEND);
+                gl_state.set_enabled(GL_BLEND, false);
             }
             else
             {
-                glEnable(GL_BLEND);
-                glBlendFuncSeparate(blend.src_rgb, blend.dst_rgb,
+                gl_state.set_enabled(GL_BLEND, true);
+                gl_state.blend_func_separate(blend.src_rgb, blend.dst_rgb,
                     blend.src_alpha, blend.dst_alpha);
             }
 
-            glDrawArrays(p.type, 0, p.nvertices);
+            glDrawArrays(type, first, count);
+        };
 
-            // We're done with the texture for now
-            texture->add_syncpoint();
+        // Each primitive samples from the same texture, so it is bound once for all of them.
+        texture->bind();
+        gl_state.invalidate_active_texture();
+
+        // A buffer that maps onto the output pixel for pixel, as one drawn at the output's
+        // fractional scale does, is sampled exactly. Anything else is resolved with linear
+        // filtering in the same pass, as client buffers cannot be mipmapped.
+        bool const is_exact = is_pixel_exact(renderable, data);
+        if (!is_exact)
+            scaled_renderables_drawn++;
+        gl_state.active_texture(GL_TEXTURE0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, is_exact ? GL_NEAREST : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, is_exact ? GL_NEAREST : GL_LINEAR);
+        if (std::find(frame_textures.begin(), frame_textures.end(), texture) == frame_textures.end())
+            frame_textures.push_back(texture);
+
+        if (uses_vertex_buffer)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[vertex_buffer_index]);
+            draw_vertices(GL_TRIANGLE_STRIP, data.first_vertex, mgl::Primitive::max_vertices, 0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        else
+        {
+            for (auto const& p : primitives)
+                draw_vertices(p.type, 0, p.nvertices, reinterpret_cast<std::uintptr_t>(&p.vertices[0]));
         }
     }
     catch (std::exception const& ex)
@@ -479,29 +1700,178 @@ miracle::Renderer::DrawData Renderer::draw(
         glDisableVertexAttribArray(prog->texcoord_attr);
 
     glDisableVertexAttribArray(prog->position_attr);
-    if (renderable.clip_area())
+    if (clip_area)
+        reset_scissor();
+
+    // Next, draw the outline if we have container to facilitate it
+    return !data.outline_context.enabled && data.data.needs_outline && frame_borders.size > 0;
+}
+
+void Renderer::append_border(mg::Renderable const& renderable, DrawData const& data) const
+{
+    auto const rect = renderable.screen_position();
+    int const size = frame_borders.size;
+    geom::Rectangle const outer {
+        geom::Point { rect.top_left.x.as_int() - size, rect.top_left.y.as_int() - size },
+        geom::Size { rect.size.width.as_int() + 2 * size, rect.size.height.as_int() + 2 * size }
+    };
+
+    int const inner_right = rect.top_left.x.as_int() + rect.size.width.as_int();
+    int const inner_bottom = rect.top_left.y.as_int() + rect.size.height.as_int();
+    std::array<geom::Rectangle, 4> strips = {
+        geom::Rectangle { outer.top_left, geom::Size { outer.size.width.as_int(), size } },
+        geom::Rectangle { geom::Point { outer.top_left.x.as_int(), inner_bottom }, geom::Size { outer.size.width.as_int(), size } },
+        geom::Rectangle { geom::Point { outer.top_left.x.as_int(), rect.top_left.y.as_int() }, geom::Size { size, rect.size.height.as_int() } },
+        geom::Rectangle { geom::Point { inner_right, rect.top_left.y.as_int() }, geom::Size { size, rect.size.height.as_int() } }
+    };
+
+    // The outline used to be scissored to the clip area grown by the border size,
+    // so we clip the strips to the same area here.
+    if (auto const clip_area = renderable.clip_area())
     {
-        glDisable(GL_SCISSOR_TEST);
+        geom::Rectangle const clip {
+            geom::Point { clip_area->top_left.x.as_int() - size, clip_area->top_left.y.as_int() - size },
+            geom::Size { clip_area->size.width.as_int() + 2 * size, clip_area->size.height.as_int() + 2 * size }
+        };
+        for (auto& strip : strips)
+            strip = strip.overlaps(clip) ? strip.intersection_with(clip) : geom::Rectangle {};
     }
 
-    // Next, draw the outline if we have container to facilitate it
-    if (data.data.needs_outline)
+    auto const& premultiplied = frame_borders.premultiplied_colors[data.outline_context.color_index];
+
+    // Apply the same transforms as the vertex shader does for surfaces, pivoting around the top left.
+    glm::vec4 const pivot(outer.top_left.x.as_int(), outer.top_left.y.as_int(), 0, 0);
+    auto const transform_vertex = [&](float x, float y)
+    {
+        glm::vec4 transformed = data.data.workspace_transform
+            * (data.data.transform * (glm::vec4(x, y, 0, 1) - pivot) + pivot);
+        BorderVertex vertex;
+        vertex.position[0] = transformed.x;
+        vertex.position[1] = transformed.y;
+        vertex.position[2] = transformed.z;
+        std::copy(std::begin(premultiplied), std::end(premultiplied), vertex.color);
+        return vertex;
+    };
+
+    for (auto const& strip : strips)
+    {
+        if (strip.size.width.as_int() <= 0 || strip.size.height.as_int() <= 0)
+            continue;
+
+        auto const left = (float)strip.top_left.x.as_int();
+        auto const top = (float)strip.top_left.y.as_int();
+        auto const right = left + (float)strip.size.width.as_int();
+        auto const bottom = top + (float)strip.size.height.as_int();
+        auto const top_left = transform_vertex(left, top);
+        auto const top_right = transform_vertex(right, top);
+        auto const bottom_left = transform_vertex(left, bottom);
+        auto const bottom_right = transform_vertex(right, bottom);
+        border_vertices.insert(border_vertices.end(), { top_left, bottom_left, top_right, top_right, bottom_left, bottom_right });
+    }
+
+    pending_border_areas.push_back(outer);
+}
+
+void Renderer::flush_borders() const
+{
+    if (border_vertices.empty())
+    {
+        pending_border_areas.clear();
+        return;
+    }
+
+    auto const* prog = program_factory->border_program();
+    gl_state.use_program(prog->id);
+    gl_state.uniform(prog->display_transform_uniform, display_transform);
+    gl_state.uniform(prog->screen_to_gl_coords_uniform, screen_to_gl_coords);
+
+    gl_state.set_enabled(GL_STENCIL_TEST, false);
+    gl_state.set_enabled(GL_BLEND, true);
+    gl_state.blend_func_separate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    glEnableVertexAttribArray(prog->position_attr);
+    glEnableVertexAttribArray(prog->color_attr);
+    glVertexAttribPointer(prog->position_attr, 3, GL_FLOAT, GL_FALSE, sizeof(BorderVertex),
+        &border_vertices[0].position);
+    glVertexAttribPointer(prog->color_attr, 4, GL_FLOAT, GL_FALSE, sizeof(BorderVertex),
+        &border_vertices[0].color);
+
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)border_vertices.size());
+
+    glDisableVertexAttribArray(prog->color_attr);
+    glDisableVertexAttribArray(prog->position_attr);
+
+    border_vertices.clear();
+    pending_border_areas.clear();
+}
+
+void Renderer::draw_drag_preview() const
+{
+    if (!frame_drag_preview || !program_factory->border_program())
+        return;
+
+    auto const& area = frame_drag_preview.value();
+    auto const color = frame_config->border_config.focus_color;
+    float const alpha = color.a * 0.3f;
+    auto const vertex = [&](int x, int y)
     {
-        auto border_config = config->get_border_config();
-        if (border_config.size > 0)
+        return BorderVertex {
+            { (GLfloat)x, (GLfloat)y, 0.f },
+            { color.r * alpha, color.g * alpha, color.b * alpha, alpha }
+        };
+    };
+
+    int const left = area.top_left.x.as_int();
+    int const top = area.top_left.y.as_int();
+    int const right = left + area.size.width.as_int();
+    int const bottom = top + area.size.height.as_int();
+    border_vertices.insert(border_vertices.end(), { vertex(left, top), vertex(left, bottom), vertex(right, top), vertex(right, top), vertex(left, bottom), vertex(right, bottom) });
+    flush_borders();
+}
+
+bool Renderer::shows_placeholder(RenderData const& data) const
+{
+    if (!data.placeholder || data.is_hidden_tab)
+        return false;
+
+    // The window may have submitted its first buffer before the window manager heard of it
+    return std::none_of(frame_draw_data.begin(), frame_draw_data.end(), [&](DrawData const& draw_data)
+    {
+        return draw_data.data.surface == data.surface;
+    });
+}
+
+void Renderer::draw_placeholders() const
+{
+    if (!program_factory->border_program())
+        return;
+
+    auto const color = frame_config->border_config.focus_color;
+    float const alpha = color.a * 0.5f;
+    for (size_t i = 0; i < frame_render_data.size(); i++)
+    {
+        auto const& data = frame_render_data[i];
+        if (!shows_placeholder(data))
+            continue;
+
+        // The corners are transformed about the top left corner, as in the vertex shader of the windows
+        auto const& area = data.placeholder.value();
+        glm::vec4 const top_left(area.top_left.x.as_int(), area.top_left.y.as_int(), 0.f, 0.f);
+        auto const vertex = [&](int x, int y)
         {
-            auto color = data.data.is_focused ? border_config.focus_color : border_config.color;
-            return DrawData {
-                true,
-                data.data,
-                { true,
-                       color,
-                       border_config.size }
+            auto const position = data.workspace_transform * (data.transform * glm::vec4(x, y, 0.f, 1.f) + top_left);
+            return BorderVertex {
+                { position.x, position.y, position.z },
+                { color.r * alpha, color.g * alpha, color.b * alpha, alpha }
             };
-        }
+        };
+
+        int const width = area.size.width.as_int();
+        int const height = area.size.height.as_int();
+        border_vertices.insert(border_vertices.end(), { vertex(0, 0), vertex(0, height), vertex(width, 0), vertex(width, 0), vertex(0, height), vertex(width, height) });
     }
 
-    return { false };
+    flush_borders();
 }
 
 void Renderer::set_viewport(mir::geometry::Rectangle const& rect)
@@ -543,10 +1913,12 @@ void Renderer::set_viewport(mir::geometry::Rectangle const& rect)
             0.0f });
 
     viewport = rect;
+    damage_tracker.invalidate();
+    is_blur_valid = false;
     update_gl_viewport();
 }
 
-void Renderer::update_gl_viewport()
+void Renderer::update_gl_viewport() const
 {
     /*
      * Letterboxing: Move the glViewport to add black bars in the case that
@@ -597,8 +1969,11 @@ void Renderer::set_output_transform(glm::mat2 const& t)
         break;
     }
 
+    has_identity_output_transform = t == glm::mat2(1.f);
     if (new_display_transform != display_transform)
     {
+        damage_tracker.invalidate();
+        is_blur_valid = false;
         display_transform = new_display_transform;
         update_gl_viewport();
     }
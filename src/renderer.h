@@ -18,9 +18,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef MIR_RENDERER_GL_RENDERER_H_
 #define MIR_RENDERER_GL_RENDERER_H_
 
+#include "compositor_state.h"
+#include "damage_tracker.h"
+#include "draw_order.h"
+#include "frame_arena.h"
+#include "gl_share_group.h"
+#include "gl_state_cache.h"
+#include "gpu_fence.h"
+#include "gpu_timer.h"
+#include "mirror_groups.h"
+#include "post_process_target.h"
 #include "primitive.h"
 #include "program_factory.h"
+#include "quality_tier.h"
 #include "render_data_manager.h"
+#include "render_filter.h"
+#include "texture_cache.h"
 
 #include <GLES2/gl2.h>
 #include <mir/geometry/rectangle.h>
@@ -28,6 +41,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <mir/graphics/renderable.h>
 #include <mir/renderer/renderer.h>
 #include <miral/window_manager_tools.h>
+#include <array>
+#include <chrono>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -41,12 +56,14 @@ namespace graphics
 namespace graphics::gl
 {
     class OutputSurface;
+    class Texture;
 }
 }
 
 namespace miracle
 {
 class Config;
+struct ConfigSnapshot;
 class CompositorState;
 class WindowToolsAccessor;
 class Animator;
@@ -58,7 +75,7 @@ public:
         std::unique_ptr<mir::graphics::gl::OutputSurface> output,
         std::shared_ptr<Config> const& config,
         std::shared_ptr<CompositorState> const& compositor_state);
-    ~Renderer() override = default;
+    ~Renderer() override;
 
     // These are called with a valid GL context:
     void set_viewport(mir::geometry::Rectangle const& rect) override;
@@ -92,19 +109,180 @@ private:
     {
         bool enabled = false;
         RenderData data;
+        /// The first vertex of this renderable in the frame's vertex buffer, or -1 if
+        /// the renderable must be tessellated when it is drawn.
+        GLint first_vertex = -1;
+        /// True if the renderable is covered entirely by opaque renderables above it.
+        bool occluded = false;
+        /// The texture of the renderable, if it has been looked up already this frame.
+        std::shared_ptr<mir::graphics::gl::Texture> texture;
 
         struct
         {
             bool enabled = false;
-            glm::vec4 color;
-            int size;
+            /// The index of the outline's color in [FrameBorders].
+            uint8_t color_index = 0;
         } outline_context;
     };
 
-    DrawData get_draw_data(mir::graphics::Renderable const&, std::vector<RenderData> const& data) const;
-    /// Draws the current renderable and returns a follow-up draw if required.
-    DrawData draw(mir::graphics::Renderable const& renderable, DrawData const& data) const;
-    void update_gl_viewport();
+    /// The border parameters of the current frame, resolved from the config once
+    /// per frame rather than for every outline. Colors are indexed by whether the
+    /// window is focused.
+    struct FrameBorders
+    {
+        int size = 0;
+        std::array<glm::vec4, 2> colors {};
+        /// The colors as the border program takes them: premultiplied, and grayed
+        /// out for unfocused windows while selecting.
+        std::array<std::array<GLfloat, 4>, 2> premultiplied_colors {};
+    };
+
+    /// What Mir hands us of a single renderable, compared between frames to tell
+    /// whether anything on the output could have changed.
+    struct SceneEntry
+    {
+        mir::graphics::Renderable::ID id = nullptr;
+        mir::graphics::BufferID buffer_id;
+        mir::geometry::Rectangle screen_position;
+        std::optional<mir::geometry::Rectangle> clip_area;
+        float alpha = 1.f;
+        glm::mat4 transformation = glm::mat4(1.f);
+        bool shaped = false;
+
+        bool operator==(SceneEntry const&) const = default;
+    };
+
+    /// A vertex of the solid border geometry, already in screen space.
+    struct BorderVertex
+    {
+        GLfloat position[3];
+        GLfloat color[4];
+    };
+
+    DrawData get_draw_data(mir::graphics::Renderable const&, RenderDataSnapshot const& data) const;
+    /// The filter that [data] is drawn through. Unfocused windows are grayed out
+    /// while the user is selecting.
+    [[nodiscard]] RenderFilter render_filter(DrawData const& data) const;
+    /// Draws the current renderable and returns true if its outline must be drawn next.
+    bool draw(mir::graphics::Renderable const& renderable, DrawData const& data) const;
+    /// Resolves [frame_borders] from the config and the mode of this frame.
+    void resolve_frame_borders() const;
+    void update_gl_viewport() const;
+
+    /// Queues the border of [renderable] to be drawn in the next border batch.
+    void append_border(mir::graphics::Renderable const& renderable, DrawData const& data) const;
+    /// Draws every queued border in a single draw call.
+    void flush_borders() const;
+    /// Draws a translucent rectangle over the drop target of the current drag.
+    void draw_drag_preview() const;
+    /// Returns true if [data] is of a window that is opening without a buffer to
+    /// show, in which case its placeholder is drawn in this frame.
+    [[nodiscard]] bool shows_placeholder(RenderData const& data) const;
+    /// Draws a translucent rectangle in place of each window that is opening
+    /// without a buffer, transformed as the window would be.
+    void draw_placeholders() const;
+
+    /// True if [renderable] is drawn with a transform, which makes its screen
+    /// position say little about where it is drawn.
+    [[nodiscard]] static bool is_transformed(mir::graphics::Renderable const& renderable, DrawData const& data);
+
+    /// Marks renderables that are hidden behind opaque renderables as occluded.
+    void cull_occluded(mir::graphics::RenderableList const& renderables) const;
+
+    /// Returns true if the only visible renderable is an opaque fullscreen surface
+    /// that could have been scanned out directly, logging whenever that changes.
+    bool update_fullscreen_status(mir::graphics::RenderableList const& renderables) const;
+
+    /// Records whether Mir fell back to a software cursor, which is the only renderable
+    /// that it hands us without a surface, logging whenever that changes.
+    void update_cursor_status(mir::graphics::RenderableList const& renderables) const;
+
+    /// While the session is locked, the renderables that may be seen on the lock
+    /// screen, which are the lock surfaces and the cursor. Otherwise, [renderables].
+    /// Redraws the whole output whenever the session is locked or unlocked.
+    mir::graphics::RenderableList const& select_renderables(mir::graphics::RenderableList const& renderables) const;
+
+    /// Whether the focused window is among [renderables].
+    bool shows_focused_window(mir::graphics::RenderableList const& renderables) const;
+
+    /// Holds this frame back until the frame rate cap of this output allows it to be
+    /// drawn, if the output is capped at all. Returns true if the frame was held back.
+    bool wait_for_frame_rate_cap(mir::graphics::RenderableList const& renderables) const;
+
+    /// Fills [draw_order] so that renderables which share a program and blend mode
+    /// are drawn together, wherever the stacking order allows it.
+    void sort_renderables(
+        mir::graphics::RenderableList const& renderables,
+        std::optional<mir::geometry::Rectangle> const& damage) const;
+
+    /// Tessellates every renderable that will be drawn this frame into a single vertex buffer.
+    void upload_vertices(
+        mir::graphics::RenderableList const& renderables,
+        std::optional<mir::geometry::Rectangle> const& damage) const;
+
+    /// Returns the area of the output that needs to be redrawn this frame, or
+    /// std::nullopt if the entire output must be redrawn.
+    std::optional<mir::geometry::Rectangle> calculate_damage(mir::graphics::RenderableList const&) const;
+    /// Whether the damage of this output can be tracked at all, whatever is on it.
+    [[nodiscard]] bool can_track_output_damage() const;
+    /// Returns true if neither the renderables, the render data nor the configuration
+    /// have changed since the last frame, recording this frame's scene either way.
+    bool is_scene_unchanged(mir::graphics::RenderableList const& renderables) const;
+    [[nodiscard]] int get_buffer_age() const;
+    [[nodiscard]] mir::geometry::Rectangle to_gl_rectangle(mir::geometry::Rectangle const&) const;
+
+    /// Publishes the statistics of the frame that started at [start].
+    void report_frame_stats(std::chrono::steady_clock::time_point start, size_t gl_errors, bool skipped = false) const;
+    /// Returns the time since the newest input event shown in this frame arrived,
+    /// unless that event was already shown in an earlier frame.
+    std::optional<std::chrono::nanoseconds> take_input_latency() const;
+
+    /// Scissors to [rect], restricted to the damaged area of the current frame.
+    void set_scissor(mir::geometry::Rectangle const& rect) const;
+    /// Restores the scissor to the damaged area of the current frame.
+    void reset_scissor() const;
+
+    /// Binds the offscreen target if [filter] must be applied to this frame, or
+    /// regardless if [force] is true. Returns false if the frame is drawn straight
+    /// to the output instead.
+    bool begin_post_processing(RenderFilter filter, bool force) const;
+    /// Draws the offscreen target onto the output through the color filter.
+    void finish_post_processing() const;
+    /// Draws [texture] over the whole of the output through the color filter.
+    void draw_texture_to_output(GLuint texture) const;
+    /// Binds the framebuffer that the current frame is drawn into.
+    void bind_frame_target() const;
+
+    /// Joins the [MirrorGroups] with the current viewport and size of this output,
+    /// and learns its role in its group.
+    void update_mirror_role() const;
+    /// Identifies everything that [is_scene_unchanged] compares, so that outputs
+    /// which mirror one another can tell whether they were asked to draw the same frame.
+    [[nodiscard]] uint64_t hash_scene(mir::graphics::RenderableList const& renderables) const;
+    /// Scales the frame of the source of this output's mirror group onto the output,
+    /// if the source drew the same scene. Returns nullptr if the frame must be drawn
+    /// here instead.
+    std::unique_ptr<mir::graphics::Framebuffer> draw_mirrored_frame(
+        mir::graphics::RenderableList const& renderables,
+        std::chrono::steady_clock::time_point start) const;
+    /// Publishes the offscreen target to the mirrors of this output, if it has any.
+    void publish_mirrored_frame(mir::graphics::RenderableList const& renderables) const;
+    /// Returns the texture of the buffer of [renderable] from [texture_cache].
+    std::shared_ptr<mir::graphics::gl::Texture> texture_for(mir::graphics::Renderable const& renderable) const;
+    /// Whether the buffer of [renderable] covers exactly as many pixels of the output
+    /// as it has, so that it can be sampled without filtering.
+    [[nodiscard]] bool is_pixel_exact(mir::graphics::Renderable const& renderable, DrawData const& data) const;
+    /// Whether [renderable] is a window that shows the blurred background through itself.
+    [[nodiscard]] bool shows_blur(mir::graphics::Renderable const& renderable, DrawData const& data) const;
+    /// Decides whether this frame draws over the blurred background, and whether
+    /// that background must be computed again because what is behind the windows changed.
+    void prepare_blur(mir::graphics::RenderableList const& renderables) const;
+    /// Draws the background into the first of the [blur_levels] and blurs it.
+    void update_blur(mir::graphics::RenderableList const& renderables) const;
+    /// Frees the offscreen targets that the [GpuMemoryBudget] evicted since the last frame.
+    void take_gpu_memory_evictions() const;
+    /// Records the offscreen targets held by this frame with the [GpuMemoryBudget].
+    void track_gpu_memory() const;
 
     std::unique_ptr<mir::graphics::gl::OutputSurface> const output_surface;
     GLfloat clear_color[4];
@@ -115,8 +293,115 @@ private:
     glm::mat4 screen_to_gl_coords;
     glm::mat4 display_transform;
     std::vector<mir::gl::Primitive> mutable primitives;
+    /// This output's own view of the render data, which is only replaced when the data changes.
+    RenderDataSnapshot mutable frame_render_data;
+    RenderDataFetch mutable render_data_fetch;
+    std::vector<DrawData> mutable frame_draw_data;
+    std::vector<mir::gl::Vertex> mutable frame_vertices;
+    std::vector<mir::geometry::Rectangle> mutable occluders;
+    std::vector<DrawOrderItem> mutable draw_order_items;
+    std::vector<size_t> mutable draw_order;
+    /// Scratch space for the current frame, reset at the start of [render].
+    FrameArena mutable frame_arena;
+#ifndef NDEBUG
+    static constexpr long long arena_warmup_frames = 120;
+    size_t mutable last_arena_allocations = 0;
+#endif
+    /// Every texture drawn this frame, which each need a single syncpoint once drawing is done.
+    std::vector<std::shared_ptr<mir::graphics::gl::Texture>> mutable frame_textures;
+    /// The texture of every buffer on the output, so that each is only imported once.
+    TextureCache<mir::graphics::gl::Texture> mutable texture_cache;
+    size_t mutable culled_count = 0;
+    bool mutable is_compositing_fullscreen = false;
+    /// Whether the cursor is drawn by us this frame rather than on a cursor plane.
+    bool mutable is_compositing_cursor = false;
+    bool mutable was_session_locked = false;
+    mir::graphics::RenderableList mutable lock_screen_renderables;
+    std::array<GLuint, 3> vertex_buffers {};
+    size_t mutable vertex_buffer_index = 0;
+    std::vector<BorderVertex> mutable border_vertices;
+    std::vector<mir::geometry::Rectangle> mutable pending_border_areas;
+    bool has_buffer_age = false;
+    /// The tier that suits the GPU, and the one in use this frame, which the
+    /// configuration may override.
+    QualityTier detected_quality_tier = QualityTier::full;
+    QualityTier mutable quality_tier = QualityTier::full;
+    bool has_identity_output_transform = true;
+    GLStateCache mutable gl_state;
+    std::unique_ptr<GpuTimer> const gpu_timer;
+    size_t mutable renderables_drawn = 0;
+    /// The renderables this frame whose buffers had to be scaled onto the output.
+    size_t mutable scaled_renderables_drawn = 0;
+    size_t mutable outlines_drawn = 0;
+    DamageTracker mutable damage_tracker;
+    std::vector<DamageTrackerEntry> mutable damage_entries;
+    std::optional<mir::geometry::Rectangle> mutable damage_scissor;
+    WindowManagerMode mutable last_mode = WindowManagerMode::normal;
+    /// Only allocated while an output-wide color filter is configured.
+    std::unique_ptr<PostProcessTarget> mutable post_process_target;
+    RenderFilter mutable post_process_filter = RenderFilter::none;
+    ColorMatrix mutable post_process_matrix = color_filter_matrix(RenderFilter::none);
+    bool mutable is_post_processing = false;
+    bool mutable is_post_processing_unsupported = false;
+    int mutable post_process_age = 0;
+    /// How the offscreen target is sampled. Mirrors scale it, so it is filtered
+    /// while this output is the source of a mirror group.
+    GLint mutable post_process_sampling = GL_NEAREST;
+    /// Frames are only shared between outputs whose GL contexts can wait for one another.
+    bool const has_gpu_fences;
+    /// Frames are only shared between outputs whose GL contexts share textures.
+    GlShareGroup const share_group;
+    MirrorGroups::Role mutable mirror_role = MirrorGroups::Role::alone;
+    /// Whether the current frame was scaled from the frame of the source of this output.
+    bool mutable is_mirrored = false;
+    /// The reads of the offscreen target by the mirrors of this output, which must be
+    /// done before it is drawn over.
+    std::vector<std::shared_ptr<GpuFence const>> mutable mirror_reads;
+    /// The background of this output, blurred for the translucent windows in front
+    /// of it. The first level holds the background at the size of the output and
+    /// each level after it is half the size of the one before. The blur itself
+    /// ends up in the second level.
+    std::vector<std::unique_ptr<PostProcessTarget>> mutable blur_levels;
+    /// What [blur_levels] was computed from, to tell when it must be computed again.
+    std::vector<DamageTrackerEntry> mutable blurred_background;
+    int mutable blurred_passes = 0;
+    float mutable blurred_offset = 0;
+    mir::geometry::Size mutable blurred_size;
+    WindowManagerMode mutable blurred_mode = WindowManagerMode::normal;
+    bool mutable is_blur_valid = false;
+    /// The renderables below the lowest window in this frame, which are what is blurred.
+    std::vector<DamageTrackerEntry> mutable frame_background;
+    size_t mutable frame_background_count = 0;
+    bool mutable is_blurring = false;
+    bool mutable was_blurring = false;
+    bool mutable is_blur_dirty = false;
+    bool mutable is_blur_unsupported = false;
+    /// Created once blur is first used, so that its GPU time is measured apart from the frame.
+    std::unique_ptr<GpuTimer> mutable blur_timer;
+    /// The slots of the offscreen targets of this renderer in the [GpuMemoryBudget].
+    /// The blur can be computed again, so it may be evicted. The post processing
+    /// target is drawn into on every frame, so it may not.
+    static constexpr int post_process_memory_slot = 0;
+    static constexpr int blur_memory_slot = 1;
+    size_t mutable gpu_memory_evictions = 0;
+    std::chrono::steady_clock::time_point mutable last_input_time;
+    /// When the last frame started to be drawn, which a capped frame is paced from.
+    std::chrono::steady_clock::time_point mutable last_frame_start;
+    bool mutable is_frame_capped = false;
     std::shared_ptr<mir::graphics::GLRenderingProvider> const gl_interface;
     std::shared_ptr<Config> config;
+    /// The configuration that the current frame is drawn with.
+    std::shared_ptr<ConfigSnapshot const> mutable frame_config;
+    /// The scene of the last frame, which a frame is skipped for if it is the same.
+    std::vector<SceneEntry> mutable scene_entries;
+    std::vector<SceneEntry> mutable last_scene_entries;
+    uint64_t mutable last_scene_generation = 0;
+    std::shared_ptr<ConfigSnapshot const> mutable last_scene_config;
+    /// The mode of the window manager in [frame_render_data], read once per frame.
+    WindowManagerMode mutable frame_mode = WindowManagerMode::normal;
+    /// The drop target of the current drag, if one is being previewed this frame.
+    std::optional<mir::geometry::Rectangle> mutable frame_drag_preview;
+    FrameBorders mutable frame_borders;
     std::shared_ptr<CompositorState> compositor_state;
 };
 
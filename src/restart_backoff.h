@@ -0,0 +1,98 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_RESTART_BACKOFF_H
+#define MIRACLE_WM_RESTART_BACKOFF_H
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <optional>
+#include <string>
+
+namespace miracle
+{
+
+/// What is known about the runs of a program that is restarted when it dies.
+struct RestartStats
+{
+    /// The number of times that the program has been started.
+    unsigned int starts = 0;
+
+    /// The number of times in a row that the program has died shortly after
+    /// it was started.
+    unsigned int consecutive_failures = 0;
+
+    /// The wait status of the last exit.
+    int last_status = 0;
+
+    std::chrono::steady_clock::time_point last_start;
+};
+
+/// Decides how long to wait before restarting a program that has died.
+///
+/// A program that ran for at least [stable_runtime] is restarted right away.
+/// Otherwise, the delay doubles with each failure in a row, from [initial_delay]
+/// up to [max_delay], so that a program stuck in a crash loop costs a bounded
+/// amount of work.
+class RestartBackoff
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::milliseconds initial_delay { 250 };
+    static constexpr std::chrono::milliseconds max_delay { 30'000 };
+    static constexpr std::chrono::milliseconds stable_runtime { 10'000 };
+
+    void started(std::string const& command, clock::time_point now)
+    {
+        auto& stats = stats_[command];
+        stats.starts++;
+        stats.last_start = now;
+    }
+
+    /// Records that [command] exited with [status] and returns how long to wait
+    /// before starting it again.
+    std::chrono::milliseconds exited(std::string const& command, int status, clock::time_point now)
+    {
+        auto& stats = stats_[command];
+        stats.last_status = status;
+        if (now - stats.last_start >= stable_runtime)
+        {
+            stats.consecutive_failures = 0;
+            return std::chrono::milliseconds::zero();
+        }
+
+        stats.consecutive_failures++;
+        auto const shift = std::min(stats.consecutive_failures - 1, 16u);
+        return std::min(initial_delay * (1 << shift), max_delay);
+    }
+
+    [[nodiscard]] std::optional<RestartStats> stats(std::string const& command) const
+    {
+        if (auto it = stats_.find(command); it != stats_.end())
+            return it->second;
+        return std::nullopt;
+    }
+
+private:
+    std::map<std::string, RestartStats> stats_;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_RESTART_BACKOFF_H
@@ -0,0 +1,39 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "scene_snapshot.h"
+
+#include <algorithm>
+
+using namespace miracle;
+
+SceneContainer const* SceneSnapshot::find(uintptr_t id) const
+{
+    auto const it = std::ranges::find(containers, id, &SceneContainer::id);
+    return it == containers.end() ? nullptr : &*it;
+}
+
+void ScenePublisher::publish(SceneSnapshot scene)
+{
+    scene.version = next_version++;
+    published.store(std::make_shared<SceneSnapshot const>(std::move(scene)), std::memory_order_release);
+}
+
+std::shared_ptr<SceneSnapshot const> ScenePublisher::latest() const
+{
+    return published.load(std::memory_order_acquire);
+}
@@ -0,0 +1,117 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_SCENE_SNAPSHOT_H
+#define MIRACLE_WM_SCENE_SNAPSHOT_H
+
+#include "container.h"
+#include "window_manager_mode.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mir/geometry/rectangle.h>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace miracle
+{
+
+/// A container as it was when the [SceneSnapshot] was taken. Ids are the same
+/// as those of the i3 tree.
+struct SceneContainer
+{
+    uintptr_t id;
+    ContainerType type;
+    std::optional<uintptr_t> parent;
+    mir::geometry::Rectangle area;
+    std::optional<uint32_t> workspace;
+    bool is_floating = false;
+    bool is_focused = false;
+};
+
+struct SceneWorkspace
+{
+    uint32_t id;
+    std::optional<int> num;
+    std::string name;
+    std::string output;
+    bool is_visible = false;
+    bool is_focused = false;
+};
+
+struct SceneOutput
+{
+    std::string name;
+    mir::geometry::Rectangle area;
+    std::optional<uint32_t> active_workspace;
+    bool is_focused = false;
+};
+
+/// An immutable copy of the scene at the end of a window management transaction.
+/// It may be read from any thread for as long as it is held.
+struct SceneSnapshot
+{
+    /// Increases with every snapshot that is published.
+    uint64_t version = 0;
+    WindowManagerMode mode = WindowManagerMode::normal;
+    std::optional<uintptr_t> focused;
+
+    /// The windows from the most to the least recently focused, followed by the
+    /// parents that hold them.
+    std::vector<SceneContainer> containers;
+    std::vector<SceneWorkspace> workspaces;
+    std::vector<SceneOutput> outputs;
+
+    /// Returns the container with [id], or nullptr if there is none.
+    [[nodiscard]] SceneContainer const* find(uintptr_t id) const;
+};
+
+/// What a [SceneSnapshot] was taken from. A new snapshot is only taken once this changes.
+struct SceneKey
+{
+    uint64_t scene_generation = 0;
+    void const* focused = nullptr;
+    void const* focused_output = nullptr;
+    /// The workspace that is active on each output, in the order of the outputs.
+    std::vector<void const*> active_workspaces;
+
+    bool operator==(SceneKey const&) const = default;
+};
+
+/// Hands [SceneSnapshot]s from the server thread to readers on other threads.
+/// Readers never wait for the window manager: they share the latest snapshot,
+/// which is freed once the last of them lets go of it.
+class ScenePublisher
+{
+public:
+    /// Publishes [scene] under the next version. Must only be called by one thread
+    /// at a time.
+    void publish(SceneSnapshot scene);
+
+    /// The latest snapshot, or nullptr if none has been published yet.
+    [[nodiscard]] std::shared_ptr<SceneSnapshot const> latest() const;
+
+private:
+    uint64_t next_version = 1;
+    std::atomic<std::shared_ptr<SceneSnapshot const>> published;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_SCENE_SNAPSHOT_H
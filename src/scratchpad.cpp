@@ -41,10 +41,14 @@ bool Scratchpad::move_to(std::shared_ptr<Container> const& container)
         return false;
     }
 
+    if (find(container))
+        return true;
+
     // Remove it from its current workspace since it is no longer wanted there
     if (auto workspace = container->get_workspace())
         workspace->delete_container(container);
 
+    index[container.get()] = items.size();
     items.push_back({ container, false });
     container->scratchpad_state(ScratchpadState::fresh);
     container->set_workspace(nullptr);
@@ -52,50 +56,69 @@ bool Scratchpad::move_to(std::shared_ptr<Container> const& container)
     return true;
 }
 
+ScratchpadItem* Scratchpad::find(std::shared_ptr<Container> const& container)
+{
+    auto const it = index.find(container.get());
+    return it == index.end() ? nullptr : &items[it->second];
+}
+
 bool Scratchpad::remove(std::shared_ptr<Container> const& container)
 {
-    return items.erase(std::remove_if(items.begin(), items.end(), [&](auto const& item)
+    auto const it = index.find(container.get());
+    if (it == index.end())
+        return false;
+
+    // The last item takes the place of the removed one
+    auto const position = it->second;
+    index.erase(it);
+    if (position != items.size() - 1)
     {
-        return item.container == container;
-    }),
-               items.end())
-        != items.end();
+        items[position] = std::move(items.back());
+        index[items[position].container.get()] = position;
+    }
+    items.pop_back();
+    return true;
 }
 
 void Scratchpad::toggle(ScratchpadItem& other)
 {
     other.is_showing = !other.is_showing;
     other.container->scratchpad_state(ScratchpadState::changed);
-    if (other.is_showing)
+    if (!other.is_showing)
     {
-        auto window = other.container->window().value();
-        auto output_extents = output_manager->focused()->get_area();
-        other.container->show();
-        miral::WindowSpecification spec;
-        spec.depth_layer() = mir_depth_layer_above;
-        spec.top_left() = {
-            output_extents.top_left.x.as_int() + (output_extents.size.width.as_int() - window.size().width.as_int()) / 2.f,
-            output_extents.top_left.y.as_int() + (output_extents.size.height.as_int() - window.size().height.as_int()) / 2.f,
-        };
-        window_controller->modify(window, spec);
-        window_controller->noclip(window);
-    }
-    else
         other.container->hide();
+        return;
+    }
+
+    auto window = other.container->window().value();
+    other.container->show();
+    auto const* output = output_manager->focused();
+    if (other.placed_on == output)
+    {
+        window_controller->raise(window);
+        return;
+    }
+
+    auto output_extents = output->get_area();
+    miral::WindowSpecification spec;
+    spec.depth_layer() = mir_depth_layer_above;
+    spec.top_left() = {
+        output_extents.top_left.x.as_int() + (output_extents.size.width.as_int() - window.size().width.as_int()) / 2.f,
+        output_extents.top_left.y.as_int() + (output_extents.size.height.as_int() - window.size().height.as_int()) / 2.f,
+    };
+    window_controller->modify(window, spec);
+    window_controller->noclip(window);
+    other.placed_on = output;
 }
 
 bool Scratchpad::toggle_show(std::shared_ptr<Container> const& container)
 {
-    for (auto& other : items)
-    {
-        if (other.container == container)
-        {
-            toggle(other);
-            return true;
-        }
-    }
+    auto const item = find(container);
+    if (!item)
+        return false;
 
-    return false;
+    toggle(*item);
+    return true;
 }
 
 bool Scratchpad::toggle_show_all()
@@ -108,22 +131,11 @@ bool Scratchpad::toggle_show_all()
 
 bool Scratchpad::contains(std::shared_ptr<Container> const& container)
 {
-    for (auto const& other : items)
-    {
-        if (other.container == container)
-            return true;
-    }
-
-    return false;
+    return find(container) != nullptr;
 }
 
 bool Scratchpad::is_showing(std::shared_ptr<Container> const& container)
 {
-    for (auto const& other : items)
-    {
-        if (other.container == container)
-            return other.is_showing;
-    }
-
-    return false;
-}
\ No newline at end of file
+    auto const item = find(container);
+    return item && item->is_showing;
+}
@@ -21,18 +21,26 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "window_controller.h"
 
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace miracle
 {
 class Container;
 class ParentContainer;
+class OutputInterface;
 class OutputManager;
 
 struct ScratchpadItem
 {
     std::shared_ptr<Container> container;
     bool is_showing = false;
+
+    /// The output that the window was placed in the middle of, in the layer above
+    /// the workspaces, or null if it has yet to be placed. It is placed again only
+    /// when it is shown while another output has the focus, and otherwise keeps
+    /// wherever it was.
+    OutputInterface const* placed_on = nullptr;
 };
 
 class Scratchpad
@@ -52,10 +60,12 @@ public:
 
 private:
     void toggle(ScratchpadItem& item);
+    ScratchpadItem* find(std::shared_ptr<Container> const&);
 
     std::shared_ptr<WindowController> window_controller;
     std::shared_ptr<OutputManager> output_manager;
     std::vector<ScratchpadItem> items;
+    std::unordered_map<Container const*, size_t> index;
 };
 }
 
@@ -260,63 +260,70 @@ bool ShellComponentContainer::is_fullscreen() const
     return false;
 }
 
-nlohmann::json ShellComponentContainer::to_json(bool is_workspace_visible) const
+void ShellComponentContainer::write_json(JsonWriter& writer, bool is_workspace_visible) const
 {
     auto const app = window_.application();
     auto const& win_info = window_controller->info_for(window_);
-    auto const visible_area = get_visible_area();
     auto const logical_area = get_logical_area();
-    return {
-        { "id",                   reinterpret_cast<std::uintptr_t>(this)                                                                                                                                                   },
-        { "name",                 app->name()                                                                                                                                                                              },
-        { "rect",                 {
-                      { "x", logical_area.top_left.x.as_int() },
-                      { "y", logical_area.top_left.y.as_int() },
-                      { "width", logical_area.size.width.as_int() },
-                      { "height", logical_area.size.height.as_int() },
-                  }                                                                                                                                                                                       },
-        { "focused",              is_focused()                                                                                                                                                                             },
-        { "focus",                std::vector<int>()                                                                                                                                                                       },
-        { "border",               "none"                                                                                                                                                                                   },
-        { "current_border_width", 0                                                                                                                                                                                        },
-        { "layout",               "dockarea"                                                                                                                                                                               },
-        { "orientation",          "none"                                                                                                                                                                                   },
-        { "window_rect",          {
-                                                                                                                                                                                                     { "x", visible_area.top_left.x.as_int() },
-                                                                                                                                                                                                     { "y", visible_area.top_left.y.as_int() },
-                                                                                                                                                                                                     { "width", visible_area.size.width.as_int() },
-                                                                                                                                                                                                     { "height", visible_area.size.height.as_int() },
-                                                                                                                                                                                                 } },
-        { "deco_rect",            {
-                           { "x", 0 },
-                           { "y", 0 },
-                           { "width", logical_area.size.width.as_int() },
-                           { "height", logical_area.size.height.as_int() },
-                       }                                                                                                                                                                             },
-        { "geometry",             {
-                          { "x", 0 },
-                          { "y", 0 },
-                          { "width", logical_area.size.width.as_int() },
-                          { "height", logical_area.size.height.as_int() },
-                      }                                                                                                                                                                               },
-        { "window",               0                                                                                                                                                                                        }, // TODO
-        { "urgent",               false                                                                                                                                                                                    },
-        { "floating_nodes",       std::vector<int>()                                                                                                                                                                       },
-        { "sticky",               false                                                                                                                                                                                    },
-        { "type",                 "dockarea"                                                                                                                                                                               },
-        { "fullscreen_mode",      is_fullscreen() ? 1 : 0                                                                                                                                                                  }, // TODO: Support value 2
-        { "pid",                  app->process_id()                                                                                                                                                                        },
-        { "app_id",               win_info.application_id()                                                                                                                                                                },
-        { "visible",              true                                                                                                                                                                                     },
-        { "shell",                "miracle-wm"                                                                                                                                                                             }, // TODO
-        { "inhibit_idle",         false                                                                                                                                                                                    },
-        { "idle_inhibitors",      {
-                                                            { "application", "none" },
-                                                            { "user", "visible" },
-                                                        }                                                                                                                                      },
-        { "window_properties",    {}                                                                                                                                                                                       }, // TODO
-        { "nodes",                std::vector<int>()                                                                                                                                                                       }
-    };
+    mir::geometry::Rectangle const local_area { mir::geometry::Point { 0, 0 }, logical_area.size };
+    writer.begin_object()
+        .key("id")
+        .value(reinterpret_cast<std::uintptr_t>(this))
+        .key("name")
+        .value(app->name())
+        .rect("rect", logical_area)
+        .key("focused")
+        .value(is_focused())
+        .key("focus")
+        .begin_array()
+        .end_array()
+        .key("border")
+        .value("none")
+        .key("current_border_width")
+        .value(0)
+        .key("layout")
+        .value("dockarea")
+        .key("orientation")
+        .value("none")
+        .rect("window_rect", get_visible_area())
+        .rect("deco_rect", local_area)
+        .rect("geometry", local_area)
+        .key("window")
+        .value(0) // TODO
+        .key("urgent")
+        .value(false)
+        .key("floating_nodes")
+        .begin_array()
+        .end_array()
+        .key("sticky")
+        .value(false)
+        .key("type")
+        .value("dockarea")
+        .key("fullscreen_mode")
+        .value(is_fullscreen() ? 1 : 0) // TODO: Support value 2
+        .key("pid")
+        .value(app->process_id())
+        .key("app_id")
+        .value(win_info.application_id())
+        .key("visible")
+        .value(true)
+        .key("shell")
+        .value("miracle-wm") // TODO
+        .key("inhibit_idle")
+        .value(false)
+        .key("idle_inhibitors")
+        .begin_object()
+        .key("application")
+        .value("none")
+        .key("user")
+        .value("visible")
+        .end_object()
+        .key("window_properties")
+        .null() // TODO
+        .key("nodes")
+        .begin_array()
+        .end_array()
+        .end_object();
 }
 
 } // miracle
@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIRACLE_WM_SHELL_COMPONENT_CONTAINER_H
 
 #include "container.h"
+#include "memory_accounting.h"
 
 namespace miracle
 {
@@ -91,13 +92,14 @@ public:
     void scratchpad_state(ScratchpadState) override { }
     LayoutScheme get_layout() const override { return LayoutScheme::none; }
     bool is_fullscreen() const override;
-    nlohmann::json to_json(bool is_workspace_visible) const override;
+    void write_json(JsonWriter& writer, bool is_workspace_visible) const override;
 
 private:
     miral::Window window_;
     std::shared_ptr<WindowController> window_controller;
     uint32_t handle_ = 0;
     glm::mat4 transform_;
+    MemoryCharge memory { MemorySubsystem::containers, sizeof(ShellComponentContainer) };
 };
 
 } // miracle
@@ -0,0 +1,100 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_SMALL_VECTOR_H
+#define MIRACLE_WM_SMALL_VECTOR_H
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace miracle
+{
+
+/// A vector that stores its first [N] items inline, so that it only allocates
+/// once it grows beyond them.
+template <typename T, size_t N>
+class SmallVector
+{
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = T const*;
+
+    void push_back(T value)
+    {
+        if (heap.empty() && count < N)
+        {
+            inline_items[count++] = std::move(value);
+            return;
+        }
+
+        if (heap.empty())
+        {
+            heap.reserve(N * 2);
+            for (auto& item : inline_items)
+                heap.push_back(std::move(item));
+        }
+
+        heap.push_back(std::move(value));
+        count++;
+    }
+
+    void clear()
+    {
+        heap.clear();
+        count = 0;
+    }
+
+    [[nodiscard]] size_t size() const { return count; }
+    [[nodiscard]] bool empty() const { return count == 0; }
+
+    T* data() { return heap.empty() ? inline_items.data() : heap.data(); }
+    T const* data() const { return heap.empty() ? inline_items.data() : heap.data(); }
+
+    T& operator[](size_t i)
+    {
+        assert(i < count);
+        return data()[i];
+    }
+
+    T const& operator[](size_t i) const
+    {
+        assert(i < count);
+        return data()[i];
+    }
+
+    T& front() { return (*this)[0]; }
+    T const& front() const { return (*this)[0]; }
+    T& back() { return (*this)[count - 1]; }
+    T const& back() const { return (*this)[count - 1]; }
+
+    iterator begin() { return data(); }
+    iterator end() { return data() + count; }
+    const_iterator begin() const { return data(); }
+    const_iterator end() const { return data() + count; }
+
+private:
+    std::array<T, N> inline_items {};
+    std::vector<T> heap;
+    size_t count = 0;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_SMALL_VECTOR_H
@@ -0,0 +1,309 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#define MIR_LOG_COMPONENT "Spawner"
+
+#include "spawner.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <mir/log.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/prctl.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+using namespace miracle;
+
+namespace
+{
+/// Requests are a header followed by the argv and then the environment, each
+/// string terminated by a NUL. As the sockets preserve message boundaries, a
+/// request is always read whole.
+struct RequestHeader
+{
+    uint32_t argc;
+    uint32_t envc;
+};
+
+// Stays below the default socket buffer size, which bounds a single message
+size_t constexpr max_request_size = 1 << 17;
+
+/// Reads the strings of a request into [out]. Returns false if [data] does not
+/// hold [count] NUL terminated strings.
+bool read_strings(char* data, size_t size, size_t& offset, uint32_t count, std::vector<char*>& out)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (offset >= size)
+            return false;
+
+        auto const end = static_cast<char*>(memchr(data + offset, '\0', size - offset));
+        if (!end)
+            return false;
+
+        out.push_back(data + offset);
+        offset = end - data + 1;
+    }
+    out.push_back(nullptr);
+    return true;
+}
+
+/// Returns the pid of the spawned program, or a negated errno.
+int32_t spawn_request(char* data, size_t size)
+{
+    if (size < sizeof(RequestHeader))
+        return -EINVAL;
+
+    RequestHeader header;
+    memcpy(&header, data, sizeof(header));
+    size_t offset = sizeof(header);
+
+    std::vector<char*> argv, envp;
+    if (header.argc == 0 || !read_strings(data, size, offset, header.argc, argv)
+        || !read_strings(data, size, offset, header.envc, envp))
+        return -EINVAL;
+
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    short flags = POSIX_SPAWN_SETSIGMASK;
+#ifdef POSIX_SPAWN_SETSID
+    flags |= POSIX_SPAWN_SETSID;
+#endif
+    posix_spawnattr_setflags(&attributes, flags);
+    sigset_t empty;
+    sigemptyset(&empty);
+    posix_spawnattr_setsigmask(&attributes, &empty);
+
+    // posix_spawnp searches the PATH of the calling process, so the program's
+    // environment stands in for the helper's while it is looked up. The helper
+    // is single threaded, so nothing else can observe the swap.
+    auto const helper_environment = environ;
+    environ = envp.data();
+    pid_t pid;
+    int const error = posix_spawnp(&pid, argv[0], nullptr, &attributes, argv.data(), envp.data());
+    environ = helper_environment;
+    posix_spawnattr_destroy(&attributes);
+
+    return error == 0 ? pid : -error;
+}
+
+[[noreturn]] void run_helper(int requests, int exits)
+{
+    // The helper has no reason to outlive the compositor
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, nullptr);
+    int const signals = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+    if (signals < 0)
+        _exit(EXIT_FAILURE);
+
+    // The compositor may be blocked on a spawn while its exit socket is full, so
+    // exits are never sent blocking. Those that do not fit wait here until the
+    // compositor reads the ones before them.
+    std::deque<Spawner::Exit> unsent_exits;
+    auto const send_exits = [&]()
+    {
+        while (!unsent_exits.empty())
+        {
+            auto const& exit = unsent_exits.front();
+            if (send(exits, &exit, sizeof(exit), MSG_NOSIGNAL | MSG_DONTWAIT) < 0)
+            {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                    return;
+
+                // Nobody is listening for exits any more
+                unsent_exits.clear();
+                return;
+            }
+            unsent_exits.pop_front();
+        }
+    };
+
+    std::vector<char> buffer(max_request_size);
+    pollfd fds[] = {
+        { .fd = requests, .events = POLLIN, .revents = 0 },
+        { .fd = signals,  .events = POLLIN, .revents = 0 },
+        { .fd = exits,    .events = 0,      .revents = 0 }
+    };
+    while (true)
+    {
+        fds[2].events = unsent_exits.empty() ? 0 : POLLOUT;
+        if (poll(fds, 3, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            _exit(EXIT_FAILURE);
+        }
+
+        if (fds[2].revents & (POLLHUP | POLLERR))
+        {
+            unsent_exits.clear();
+            fds[2].fd = -1;
+        }
+        else if (fds[2].revents & POLLOUT)
+            send_exits();
+
+        if (fds[1].revents & POLLIN)
+        {
+            signalfd_siginfo info;
+            while (read(signals, &info, sizeof(info)) == sizeof(info))
+                ;
+
+            int status;
+            pid_t pid;
+            while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+                unsent_exits.push_back({ pid, status });
+
+            if (fds[2].fd >= 0)
+                send_exits();
+            else
+                unsent_exits.clear();
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            auto const received = recv(requests, buffer.data(), buffer.size(), 0);
+            if (received <= 0)
+                _exit(EXIT_SUCCESS);
+
+            int32_t const result = spawn_request(buffer.data(), static_cast<size_t>(received));
+            if (send(requests, &result, sizeof(result), MSG_NOSIGNAL) < 0)
+                _exit(EXIT_SUCCESS);
+        }
+        else if (fds[0].revents & (POLLHUP | POLLERR))
+        {
+            // The compositor has gone away
+            _exit(EXIT_SUCCESS);
+        }
+    }
+}
+}
+
+std::unique_ptr<Spawner> Spawner::start()
+{
+    int request_sockets[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, request_sockets) < 0)
+    {
+        mir::log_error("Unable to create the spawner's request socket: %s", strerror(errno));
+        return nullptr;
+    }
+
+    int exit_sockets[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, exit_sockets) < 0)
+    {
+        mir::log_error("Unable to create the spawner's exit socket: %s", strerror(errno));
+        close(request_sockets[0]);
+        close(request_sockets[1]);
+        return nullptr;
+    }
+
+    pid_t const helper = fork();
+    if (helper < 0)
+    {
+        mir::log_error("Unable to fork the spawner: %s", strerror(errno));
+        for (int fd : { request_sockets[0], request_sockets[1], exit_sockets[0], exit_sockets[1] })
+            close(fd);
+        return nullptr;
+    }
+
+    if (helper == 0)
+    {
+        close(request_sockets[0]);
+        close(exit_sockets[0]);
+        run_helper(request_sockets[1], exit_sockets[1]);
+    }
+
+    close(request_sockets[1]);
+    close(exit_sockets[1]);
+    fcntl(exit_sockets[0], F_SETFL, fcntl(exit_sockets[0], F_GETFL) | O_NONBLOCK);
+    return std::unique_ptr<Spawner>(new Spawner(helper, request_sockets[0], exit_sockets[0]));
+}
+
+Spawner::Spawner(pid_t helper, int requests, int exits) :
+    helper { helper },
+    requests { requests },
+    exits { exits }
+{
+}
+
+Spawner::~Spawner()
+{
+    // The helper exits once it sees the request socket close
+    close(requests);
+    close(exits);
+    waitpid(helper, nullptr, 0);
+}
+
+pid_t Spawner::spawn(std::vector<std::string> const& argv, std::vector<std::string> const& env)
+{
+    if (argv.empty())
+        return -1;
+
+    RequestHeader const header { static_cast<uint32_t>(argv.size()), static_cast<uint32_t>(env.size()) };
+    std::vector<char> request(sizeof(header));
+    memcpy(request.data(), &header, sizeof(header));
+    for (auto const* strings : { &argv, &env })
+    {
+        for (auto const& string : *strings)
+            request.insert(request.end(), string.c_str(), string.c_str() + string.size() + 1);
+    }
+
+    if (request.size() > max_request_size)
+    {
+        mir::log_error("Unable to spawn %s: the request is too large", argv[0].c_str());
+        return -1;
+    }
+
+    std::lock_guard lock(mutex);
+    int32_t result;
+    if (send(requests, request.data(), request.size(), MSG_NOSIGNAL) < 0
+        || recv(requests, &result, sizeof(result), 0) != sizeof(result))
+    {
+        mir::log_error("Unable to reach the spawner: %s", strerror(errno));
+        return -1;
+    }
+
+    if (result < 0)
+    {
+        mir::log_error("Unable to spawn %s: %s", argv[0].c_str(), strerror(-result));
+        return -1;
+    }
+
+    return result;
+}
+
+std::vector<Spawner::Exit> Spawner::read_exits()
+{
+    std::vector<Exit> result;
+    Exit exit;
+    while (recv(exits, &exit, sizeof(exit), 0) == sizeof(exit))
+        result.push_back(exit);
+    return result;
+}
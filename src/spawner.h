@@ -0,0 +1,78 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_SPAWNER_H
+#define MIRACLE_WM_SPAWNER_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace miracle
+{
+
+/// A helper process that starts programs on behalf of the compositor.
+///
+/// The helper is forked at the very start of main, while the compositor is still
+/// a single thread with a small address space. From then on, the compositor does
+/// not fork for a launch: it sends the program's argv and environment over a
+/// socket, and the helper posix_spawns the program and answers with its pid.
+/// Children belong to the helper, so their exits are reported over a second socket.
+/// The helper never blocks on that socket, so a launch still gets its answer while
+/// the exits go unread.
+class Spawner
+{
+public:
+    /// Forks the helper. Returns nullptr if it could not be started.
+    static std::unique_ptr<Spawner> start();
+
+    ~Spawner();
+    Spawner(Spawner const&) = delete;
+    Spawner& operator=(Spawner const&) = delete;
+
+    /// Starts [argv] with the environment [env], where each entry is NAME=value.
+    /// The program is looked up in the PATH of [env]. Returns the pid of the
+    /// program, or -1 if it could not be started.
+    pid_t spawn(std::vector<std::string> const& argv, std::vector<std::string> const& env);
+
+    struct Exit
+    {
+        pid_t pid;
+        /// The status as returned by waitpid.
+        int status;
+    };
+
+    /// Becomes readable when the helper has reported exits.
+    [[nodiscard]] int exit_fd() const { return exits; }
+
+    /// Returns the exits that have been reported since the last call, without blocking.
+    std::vector<Exit> read_exits();
+
+private:
+    Spawner(pid_t helper, int requests, int exits);
+
+    pid_t const helper;
+    int const requests;
+    int const exits;
+    std::mutex mutex;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_SPAWNER_H
@@ -0,0 +1,62 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#define MIR_LOG_COMPONENT "startup"
+
+#include "startup_profile.h"
+
+#include <algorithm>
+#include <mir/log.h>
+
+using namespace miracle;
+
+namespace
+{
+double to_ms(std::chrono::nanoseconds duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+}
+
+StartupProfile::StartupProfile(clock::time_point start) :
+    start { start }
+{
+}
+
+StartupProfile& StartupProfile::instance()
+{
+    static StartupProfile profile;
+    return profile;
+}
+
+void StartupProfile::mark(std::string const& phase)
+{
+    std::lock_guard lock(mutex);
+    if (std::ranges::any_of(phases_, [&](StartupPhase const& p) { return p.name == phase; }))
+        return;
+
+    auto const elapsed = clock::now() - start;
+    auto const previous = phases_.empty() ? std::chrono::nanoseconds(0) : phases_.back().elapsed;
+    phases_.push_back({ phase, elapsed });
+    mir::log_info("%s after %.2fms (+%.2fms)", phase.c_str(), to_ms(elapsed), to_ms(elapsed - previous));
+}
+
+std::vector<StartupPhase> StartupProfile::phases() const
+{
+    std::lock_guard lock(mutex);
+    return phases_;
+}
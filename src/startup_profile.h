@@ -0,0 +1,62 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_STARTUP_PROFILE_H
+#define MIRACLE_WM_STARTUP_PROFILE_H
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace miracle
+{
+
+/// A point that startup reached, measured from the start of the process.
+struct StartupPhase
+{
+    std::string name;
+    std::chrono::nanoseconds elapsed { 0 };
+};
+
+/// Records how long each phase of startup takes, from `main` to the first frame,
+/// and logs each phase as it is reached.
+class StartupProfile
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit StartupProfile(clock::time_point start = clock::now());
+
+    /// The profile of this process. The clock starts on the first call.
+    static StartupProfile& instance();
+
+    /// Records that startup has reached [phase]. Only the first mark of each
+    /// phase counts, so that a phase reached by every output is logged once.
+    void mark(std::string const& phase);
+
+    [[nodiscard]] std::vector<StartupPhase> phases() const;
+
+private:
+    clock::time_point const start;
+    mutable std::mutex mutex;
+    std::vector<StartupPhase> phases_;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_STARTUP_PROFILE_H
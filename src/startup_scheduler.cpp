@@ -0,0 +1,90 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "startup_scheduler.h"
+
+#include <algorithm>
+
+using namespace miracle;
+
+StartupScheduler::StartupScheduler(std::vector<StartupApp> const& apps_, StartupConfiguration const& config) :
+    apps { apps_ },
+    config { config }
+{
+    std::ranges::stable_sort(apps, std::ranges::greater {}, &StartupApp::priority);
+}
+
+std::optional<StartupApp> StartupScheduler::next(clock::time_point now)
+{
+    std::erase_if(starting, [&](Starting const& app)
+    {
+        return app.deadline <= now;
+    });
+
+    if (has_launched_all())
+        return std::nullopt;
+
+    if (config.concurrency > 0 && starting.size() >= static_cast<size_t>(config.concurrency))
+        return std::nullopt;
+
+    auto const is_previous = [&](Starting const& app)
+    {
+        return app.index == next_index - 1;
+    };
+    if (apps[next_index].after_previous && next_index > 0 && std::ranges::any_of(starting, is_previous))
+        return std::nullopt;
+
+    return apps[next_index++];
+}
+
+void StartupScheduler::launched(pid_t pid, clock::time_point now)
+{
+    // An app that failed to launch will never open a window, so it is not waited for
+    if (pid > 0)
+        starting.push_back({ next_index - 1, pid, now + config.app_timeout });
+}
+
+void StartupScheduler::window_opened(pid_t pid)
+{
+    forget(pid);
+}
+
+void StartupScheduler::exited(pid_t pid)
+{
+    forget(pid);
+}
+
+std::optional<StartupScheduler::clock::time_point> StartupScheduler::next_deadline() const
+{
+    if (has_launched_all() || starting.empty())
+        return std::nullopt;
+
+    return std::ranges::min(starting, {}, &Starting::deadline).deadline;
+}
+
+bool StartupScheduler::has_launched_all() const
+{
+    return next_index == apps.size();
+}
+
+void StartupScheduler::forget(pid_t pid)
+{
+    std::erase_if(starting, [&](Starting const& app)
+    {
+        return app.pid == pid;
+    });
+}
@@ -0,0 +1,82 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_STARTUP_SCHEDULER_H
+#define MIRACLE_WM_STARTUP_SCHEDULER_H
+
+#include "config.h"
+
+#include <chrono>
+#include <optional>
+#include <sys/types.h>
+#include <vector>
+
+namespace miracle
+{
+
+/// Decides when each of the startup apps is launched.
+///
+/// Apps are launched from the highest to the lowest [StartupApp::priority], and
+/// in the order of the configuration within a priority. An app counts as starting
+/// from its launch until it opens its first window, exits, or runs out of
+/// [StartupConfiguration::app_timeout]. No more than [StartupConfiguration::concurrency]
+/// apps are starting at once, and an app with [StartupApp::after_previous] waits
+/// until the app launched before it is no longer starting.
+class StartupScheduler
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    StartupScheduler(std::vector<StartupApp> const& apps, StartupConfiguration const& config);
+
+    /// The next app to launch at [now], or std::nullopt if it has to wait or
+    /// every app has been launched. Each app that is returned must be followed
+    /// by a call to [launched].
+    std::optional<StartupApp> next(clock::time_point now);
+
+    /// Records that the app last returned by [next] was launched as [pid], or
+    /// that it failed to launch if [pid] is not positive.
+    void launched(pid_t pid, clock::time_point now);
+
+    void window_opened(pid_t pid);
+    void exited(pid_t pid);
+
+    /// When an app that is starting times out, or std::nullopt if [next] can only
+    /// return more apps after a window opens or an app exits.
+    [[nodiscard]] std::optional<clock::time_point> next_deadline() const;
+
+    [[nodiscard]] bool has_launched_all() const;
+
+private:
+    struct Starting
+    {
+        size_t index;
+        pid_t pid;
+        clock::time_point deadline;
+    };
+
+    std::vector<StartupApp> apps;
+    StartupConfiguration config;
+    size_t next_index = 0;
+    std::vector<Starting> starting;
+
+    void forget(pid_t pid);
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_STARTUP_SCHEDULER_H
@@ -0,0 +1,93 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_TEXTURE_CACHE_H
+#define MIRACLE_WM_TEXTURE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+namespace miracle
+{
+
+/// Keeps the texture of each buffer from one frame to the next, by buffer ID.
+///
+/// A buffer is only turned into a texture the first time that it is drawn, which
+/// for an shm buffer is when its pixels are uploaded. A texture is dropped at the
+/// end of the first frame that no longer shows its buffer, so that the buffer
+/// can be released to its client.
+template <typename Texture>
+class TextureCache
+{
+public:
+    void begin_frame()
+    {
+        frameno++;
+        uploaded_bytes_ = 0;
+    }
+
+    /// Returns the texture of the buffer with [id], calling [make] to create it if
+    /// it is new. [upload_bytes] is the number of bytes that creating it uploads.
+    template <typename F>
+    std::shared_ptr<Texture> const& get(std::uint64_t id, size_t upload_bytes, F const& make)
+    {
+        auto [it, inserted] = entries.try_emplace(id);
+        if (inserted)
+        {
+            it->second.texture = make();
+            uploaded_bytes_ += upload_bytes;
+        }
+
+        it->second.last_used_frameno = frameno;
+        return it->second.texture;
+    }
+
+    /// Keeps the texture of the buffer with [id], if there is one, through this
+    /// frame without drawing it, e.g. because it is outside of the damaged area.
+    void keep(std::uint64_t id)
+    {
+        if (auto it = entries.find(id); it != entries.end())
+            it->second.last_used_frameno = frameno;
+    }
+
+    /// Drops the textures that were neither used nor kept during this frame.
+    void end_frame()
+    {
+        std::erase_if(entries, [&](auto const& entry) { return entry.second.last_used_frameno != frameno; });
+    }
+
+    /// The bytes uploaded for the textures created during this frame.
+    [[nodiscard]] size_t uploaded_bytes() const { return uploaded_bytes_; }
+    [[nodiscard]] size_t size() const { return entries.size(); }
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<Texture> texture;
+        long long last_used_frameno = 0;
+    };
+
+    std::unordered_map<std::uint64_t, Entry> entries;
+    long long frameno = 0;
+    size_t uploaded_bytes_ = 0;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_TEXTURE_CACHE_H
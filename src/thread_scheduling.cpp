@@ -0,0 +1,213 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#define MIR_LOG_COMPONENT "thread_scheduling"
+
+#include "thread_scheduling.h"
+
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <gio/gio.h>
+#include <mir/log.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace miracle;
+
+namespace
+{
+char const* const rtkit_name = "org.freedesktop.RealtimeKit1";
+char const* const rtkit_path = "/org/freedesktop/RealtimeKit1";
+
+/// rtkit refuses real-time scheduling to a process unless it limits how long
+/// a real-time thread may run without blocking. This is the default maximum of
+/// rtkit.
+constexpr rlim_t rtkit_rttime_usec = 200'000;
+
+/// A connection to the system bus for requests to rtkit, made on first use.
+GDBusConnection* system_bus()
+{
+    static GDBusConnection* connection = []() -> GDBusConnection*
+    {
+        GError* error = nullptr;
+        auto const result = g_bus_get_sync(G_BUS_TYPE_SYSTEM, nullptr, &error);
+        if (!result)
+        {
+            mir::log_warning("Unable to connect to the system bus for rtkit: %s", error->message);
+            g_error_free(error);
+        }
+        return result;
+    }();
+    return connection;
+}
+
+bool call_rtkit(char const* method, GVariant* parameters)
+{
+    auto const connection = system_bus();
+    if (!connection)
+    {
+        g_variant_unref(g_variant_ref_sink(parameters));
+        return false;
+    }
+
+    GError* error = nullptr;
+    auto const reply = g_dbus_connection_call_sync(
+        connection, rtkit_name, rtkit_path, rtkit_name, method, parameters,
+        nullptr, G_DBUS_CALL_FLAGS_NONE, -1, nullptr, &error);
+    if (!reply)
+    {
+        mir::log_warning("rtkit refused %s: %s", method, error->message);
+        g_error_free(error);
+        return false;
+    }
+
+    g_variant_unref(reply);
+    return true;
+}
+
+bool set_realtime(int priority, bool& via_rtkit)
+{
+    sched_param param {};
+    param.sched_priority = priority;
+    if (sched_setscheduler(0, SCHED_RR | SCHED_RESET_ON_FORK, &param) == 0)
+        return true;
+
+    if (errno != EPERM)
+    {
+        mir::log_warning("Unable to set SCHED_RR: %s", strerror(errno));
+        return false;
+    }
+
+    rlimit limit { rtkit_rttime_usec, rtkit_rttime_usec };
+    if (setrlimit(RLIMIT_RTTIME, &limit) != 0)
+        return false;
+
+    auto const tid = static_cast<guint64>(gettid());
+    if (!call_rtkit("MakeThreadRealtime", g_variant_new("(tu)", tid, static_cast<guint32>(priority))))
+        return false;
+
+    via_rtkit = true;
+    return true;
+}
+
+bool set_nice(int nice, bool& via_rtkit)
+{
+    auto const tid = gettid();
+    if (setpriority(PRIO_PROCESS, static_cast<id_t>(tid), nice) == 0)
+        return true;
+
+    if (errno != EPERM && errno != EACCES)
+    {
+        mir::log_warning("Unable to set the nice value: %s", strerror(errno));
+        return false;
+    }
+
+    if (!call_rtkit("MakeThreadHighPriority", g_variant_new("(ti)", static_cast<guint64>(tid), nice)))
+        return false;
+
+    via_rtkit = true;
+    return true;
+}
+
+bool set_cpus(std::vector<int> const& cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto const cpu : cpus)
+    {
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+            CPU_SET(static_cast<size_t>(cpu), &set);
+    }
+
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+    {
+        mir::log_warning("Unable to pin the thread to its CPUs: %s", strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+}
+
+ThreadScheduling miracle::current_thread_scheduling()
+{
+    ThreadScheduling result;
+    result.policy = sched_getscheduler(0) & ~SCHED_RESET_ON_FORK;
+    sched_param param {};
+    if (sched_getparam(0, &param) == 0)
+        result.priority = param.sched_priority;
+
+    result.nice = getpriority(PRIO_PROCESS, static_cast<id_t>(gettid()));
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if (CPU_ISSET(static_cast<size_t>(cpu), &set))
+                result.cpus.push_back(cpu);
+        }
+    }
+
+    return result;
+}
+
+ThreadScheduling miracle::apply_thread_scheduling(std::string const& name, ThreadSchedulingConfiguration const& config)
+{
+    bool via_rtkit = false;
+    if (!config.cpus.empty())
+        set_cpus(config.cpus);
+    if (config.nice)
+        set_nice(config.nice.value(), via_rtkit);
+    if (config.realtime)
+        set_realtime(config.realtime_priority, via_rtkit);
+
+    auto result = current_thread_scheduling();
+    result.via_rtkit = via_rtkit;
+    mir::log_info("%s thread is scheduled with %s", name.c_str(), to_string(result).c_str());
+    return result;
+}
+
+std::string miracle::to_string(ThreadScheduling const& scheduling)
+{
+    std::string policy;
+    switch (scheduling.policy)
+    {
+    case SCHED_OTHER:
+        policy = "SCHED_OTHER";
+        break;
+    case SCHED_RR:
+        policy = std::format("SCHED_RR priority {}", scheduling.priority);
+        break;
+    case SCHED_FIFO:
+        policy = std::format("SCHED_FIFO priority {}", scheduling.priority);
+        break;
+    default:
+        policy = std::format("policy {}", scheduling.policy);
+        break;
+    }
+
+    std::string cpus;
+    for (auto const cpu : scheduling.cpus)
+        cpus += std::format("{}{}", cpus.empty() ? "" : ",", cpu);
+
+    return std::format("{}, nice {}, cpus {}{}",
+        policy, scheduling.nice, cpus.empty() ? "none" : cpus, scheduling.via_rtkit ? " (via rtkit)" : "");
+}
@@ -0,0 +1,71 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_THREAD_SCHEDULING_H
+#define MIRACLE_WM_THREAD_SCHEDULING_H
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace miracle
+{
+
+/// How a thread that the compositor depends upon for smooth frames should be
+/// scheduled. Each setting is requested separately, and a setting that is not
+/// permitted is left as it was.
+struct ThreadSchedulingConfiguration
+{
+    /// Whether to run the thread under SCHED_RR. When the process may not do
+    /// so itself, real-time scheduling is requested from rtkit.
+    bool realtime = false;
+    int realtime_priority = 10;
+
+    /// The nice value of the thread.
+    std::optional<int> nice;
+
+    /// The CPUs that the thread is pinned to. Empty to run on any CPU.
+    std::vector<int> cpus;
+
+    bool operator==(ThreadSchedulingConfiguration const&) const = default;
+};
+
+/// The scheduling that a thread actually has.
+struct ThreadScheduling
+{
+    int policy = 0;
+    int priority = 0;
+    int nice = 0;
+    std::vector<int> cpus;
+
+    /// Whether any of the above was granted by rtkit.
+    bool via_rtkit = false;
+};
+
+/// Applies [config] to the calling thread, logging the scheduling that it got
+/// under [name].
+ThreadScheduling apply_thread_scheduling(std::string const& name, ThreadSchedulingConfiguration const& config);
+
+/// Reads the scheduling of the calling thread.
+ThreadScheduling current_thread_scheduling();
+
+/// Describes [scheduling] as, for example, "SCHED_RR priority 10, nice -5, cpus 2,3".
+std::string to_string(ThreadScheduling const& scheduling);
+
+} // miracle
+
+#endif // MIRACLE_WM_THREAD_SCHEDULING_H
@@ -0,0 +1,170 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "tracing.h"
+
+using namespace miracle;
+
+namespace
+{
+int64_t to_ns(Tracer::clock::time_point time)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+std::atomic<uint64_t> next_tracer_id = 1;
+
+/// The ring of the calling thread, for the tracer with the id [tracer].
+struct ThreadRing
+{
+    uint64_t tracer = 0;
+    TraceSpanRing* ring = nullptr;
+};
+
+thread_local ThreadRing thread_ring;
+}
+
+TraceSpanRing::TraceSpanRing(uint32_t thread) :
+    thread { thread }
+{
+}
+
+void TraceSpanRing::push(char const* name, int64_t start_ns, int64_t duration_ns)
+{
+    auto const index = head.load(std::memory_order_relaxed);
+    auto& slot = slots[index % capacity];
+
+    // An odd sequence marks the slot as being written
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start_ns.store(start_ns, std::memory_order_relaxed);
+    slot.duration_ns.store(duration_ns, std::memory_order_relaxed);
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+    head.store(index + 1, std::memory_order_release);
+}
+
+void TraceSpanRing::read(std::vector<TraceSpan>& out) const
+{
+    auto const end = head.load(std::memory_order_acquire);
+    auto const begin = end > capacity ? end - capacity : 0;
+    for (auto index = begin; index < end; index++)
+    {
+        auto const& slot = slots[index % capacity];
+        auto const sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != 2 * index + 2)
+            continue;
+
+        TraceSpan span {
+            .name = slot.name.load(std::memory_order_relaxed),
+            .thread = thread,
+            .start_ns = slot.start_ns.load(std::memory_order_relaxed),
+            .duration_ns = slot.duration_ns.load(std::memory_order_relaxed)
+        };
+
+        // The writer may have lapped the reader while the slot was being copied
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+            continue;
+
+        out.push_back(span);
+    }
+}
+
+Tracer::Tracer() :
+    id { next_tracer_id++ }
+{
+}
+
+Tracer& Tracer::instance()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::start()
+{
+    started_ns = to_ns(clock::now());
+    recording = true;
+}
+
+void Tracer::stop()
+{
+    recording = false;
+}
+
+void Tracer::record(char const* name, clock::time_point start, clock::time_point end)
+{
+    ring_for_current_thread().push(name, to_ns(start), to_ns(end) - to_ns(start));
+}
+
+TraceSpanRing& Tracer::ring_for_current_thread()
+{
+    if (thread_ring.tracer == id)
+        return *thread_ring.ring;
+
+    // A thread registers its ring the first time that it records a span. Rings
+    // outlive their threads, so that a thread's spans can still be dumped.
+    std::lock_guard lock(rings_mutex);
+    rings.push_back(std::make_unique<TraceSpanRing>(static_cast<uint32_t>(rings.size() + 1)));
+    thread_ring = { id, rings.back().get() };
+    return *thread_ring.ring;
+}
+
+std::vector<TraceSpan> Tracer::spans() const
+{
+    std::vector<TraceSpan> result;
+    {
+        std::lock_guard lock(rings_mutex);
+        for (auto const& ring : rings)
+            ring->read(result);
+    }
+
+    auto const since = started_ns.load();
+    std::erase_if(result, [since](TraceSpan const& span)
+    {
+        return span.start_ns < since;
+    });
+    return result;
+}
+
+nlohmann::json Tracer::to_chrome_trace() const
+{
+    // Timestamps and durations are in microseconds
+    auto const to_us = [](int64_t ns)
+    {
+        return static_cast<double>(ns) / 1e3;
+    };
+
+    nlohmann::json events = nlohmann::json::array();
+    for (auto const& span : spans())
+    {
+        events.push_back({
+            { "name", span.name },
+            { "ph", "X" },
+            { "pid", 0 },
+            { "tid", span.thread },
+            { "ts", to_us(span.start_ns) },
+            { "dur", to_us(span.duration_ns) }
+        });
+    }
+
+    return {
+        { "traceEvents", events },
+        { "displayTimeUnit", "ms" }
+    };
+}
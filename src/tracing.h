@@ -0,0 +1,159 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_TRACING_H
+#define MIRACLE_WM_TRACING_H
+
+#include "feature_flags.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <vector>
+
+namespace miracle
+{
+
+/// The time spent within a named scope on a single thread.
+struct TraceSpan
+{
+    /// A string literal, so that recording a span never allocates.
+    char const* name = nullptr;
+    uint32_t thread = 0;
+    int64_t start_ns = 0;
+    int64_t duration_ns = 0;
+};
+
+/// A ring buffer of the spans recorded on a single thread.
+///
+/// Only the owning thread writes to the ring, without taking a lock. Any thread
+/// may read it: each slot carries a sequence number that tells the reader if
+/// the slot was overwritten while it was being copied.
+class TraceSpanRing
+{
+public:
+    static constexpr size_t capacity = 4096;
+
+    explicit TraceSpanRing(uint32_t thread);
+
+    /// Must only be called by the owning thread.
+    void push(char const* name, int64_t start_ns, int64_t duration_ns);
+
+    /// Appends the spans that are held to [out], oldest first.
+    void read(std::vector<TraceSpan>& out) const;
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence = 0;
+        std::atomic<char const*> name = nullptr;
+        std::atomic<int64_t> start_ns = 0;
+        std::atomic<int64_t> duration_ns = 0;
+    };
+
+    uint32_t const thread;
+    std::atomic<uint64_t> head = 0;
+    std::array<Slot, capacity> slots;
+};
+
+/// Collects the [TraceSpan]s of every thread while it is recording, so that the
+/// time between an input event and the resulting window changes can be broken
+/// down after the fact.
+///
+/// While the tracer is not recording, a [TraceScope] costs a single relaxed load.
+class Tracer
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    Tracer();
+
+    /// The tracer that [MIRACLE_TRACE_SCOPE] records to.
+    static Tracer& instance();
+
+    /// Starts a new recording, leaving out the spans of any previous one.
+    void start();
+    void stop();
+
+    [[nodiscard]] bool is_recording() const
+    {
+        return recording.load(std::memory_order_relaxed);
+    }
+
+    /// Records a span on the calling thread.
+    void record(char const* name, clock::time_point start, clock::time_point end);
+
+    /// Returns the spans of the latest recording, grouped by thread.
+    [[nodiscard]] std::vector<TraceSpan> spans() const;
+
+    /// Converts the spans into the Chrome trace event format, which can be
+    /// loaded by chrome://tracing and Perfetto.
+    [[nodiscard]] nlohmann::json to_chrome_trace() const;
+
+private:
+    TraceSpanRing& ring_for_current_thread();
+
+    uint64_t const id;
+    std::atomic<bool> recording = false;
+    std::atomic<int64_t> started_ns = 0;
+    mutable std::mutex rings_mutex;
+    std::vector<std::unique_ptr<TraceSpanRing>> rings;
+};
+
+/// Records the lifetime of the scope that it is declared in as a span.
+class TraceScope
+{
+public:
+    explicit TraceScope(char const* name) :
+        name { name }
+    {
+        if (Tracer::instance().is_recording())
+            start = Tracer::clock::now();
+    }
+
+    ~TraceScope()
+    {
+        if (start)
+            Tracer::instance().record(name, *start, Tracer::clock::now());
+    }
+
+    TraceScope(TraceScope const&) = delete;
+    TraceScope& operator=(TraceScope const&) = delete;
+
+private:
+    char const* name;
+    std::optional<Tracer::clock::time_point> start;
+};
+
+} // miracle
+
+#define MIRACLE_TRACE_CONCAT_IMPL(a, b) a##b
+#define MIRACLE_TRACE_CONCAT(a, b) MIRACLE_TRACE_CONCAT_IMPL(a, b)
+
+/// Traces the enclosing scope as a span called [name], which must be a string
+/// literal. Compiles to nothing unless MIRACLE_FEATURE_FLAG_TRACING is set.
+#if MIRACLE_FEATURE_FLAG_TRACING
+#define MIRACLE_TRACE_SCOPE(name) ::miracle::TraceScope MIRACLE_TRACE_CONCAT(miracle_trace_scope_, __LINE__)(name)
+#else
+#define MIRACLE_TRACE_SCOPE(name)
+#endif
+
+#endif // MIRACLE_WM_TRACING_H
@@ -19,25 +19,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIRACLE_WM_UTILITY_GENERAL_H
 
 #include <algorithm>
-#include <string>
+#include <charconv>
+#include <string_view>
 
 namespace miracle
 {
-bool try_get_number(std::string const& s, int& out)
+/// Parses the integer at the start of [s], ignoring anything that follows it.
+inline bool try_get_number(std::string_view s, int& out)
 {
-    try
-    {
-        out = std::stoi(s);
-        return true;
-    }
-    catch (std::invalid_argument const& ex)
-    {
-        return false;
-    }
-    catch (std::out_of_range const& ex)
-    {
-        return false;
-    }
+    return std::from_chars(s.data(), s.data() + s.size(), out).ec == std::errc();
 }
 }
 
@@ -47,6 +47,11 @@ public:
     virtual std::shared_ptr<Container> get_container(miral::Window const&) = 0;
     virtual void raise(miral::Window const&) = 0;
     virtual void send_to_back(miral::Window const&) = 0;
+
+    /// Tells Mir whether [window] cannot be seen, like a tab that is not selected.
+    /// Mir stops compositing an occluded window and sending it frame callbacks, so
+    /// its client throttles itself. Unlike hiding it, this leaves its state alone.
+    virtual void set_occluded(miral::Window const&, bool occluded) = 0;
     virtual void open(miral::Window const&) = 0;
     virtual void close(miral::Window const&) = 0;
     virtual void set_user_data(miral::Window const&, std::shared_ptr<void> const&) = 0;
@@ -58,6 +63,36 @@ public:
     virtual void set_size_hack(AnimationHandle handle, geom::Size const& size) = 0;
     virtual miral::Window window_at(float x, float y) = 0;
     virtual void process_animation(AnimationStepResult const&, std::shared_ptr<Container> const&) = 0;
+
+    /// Holds back the modifications of [window] until the matching [end_changes],
+    /// so that its state, depth layer and geometry reach the client together.
+    /// Calls may be nested.
+    virtual void begin_changes(miral::Window const& window) = 0;
+    virtual void end_changes(miral::Window const& window) = 0;
+};
+
+/// Collects the modifications of a window for as long as it is alive.
+class WindowChangeBatch
+{
+public:
+    WindowChangeBatch(WindowController& controller, miral::Window const& window) :
+        controller { controller },
+        window { window }
+    {
+        controller.begin_changes(window);
+    }
+
+    ~WindowChangeBatch()
+    {
+        controller.end_changes(window);
+    }
+
+    WindowChangeBatch(WindowChangeBatch const&) = delete;
+    WindowChangeBatch& operator=(WindowChangeBatch const&) = delete;
+
+private:
+    WindowController& controller;
+    miral::Window window;
 };
 
 }
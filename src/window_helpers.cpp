@@ -21,7 +21,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "container.h"
 #include "leaf_container.h"
 
+#include <fstream>
 #include <mir/log.h>
+#include <miral/application.h>
 
 bool miracle::window_helpers::is_window_fullscreen(MirWindowState state)
 {
@@ -59,4 +61,20 @@ miral::WindowSpecification miracle::window_helpers::copy_from(miral::WindowInfo
     spec.focus_mode() = info.focus_mode();
     spec.visible_on_lock_screen() = info.visible_on_lock_screen();
     return spec;
-}
\ No newline at end of file
+}
+bool miracle::window_helpers::is_xwayland(miral::Window const& window)
+{
+    auto const application = window.application();
+    if (!application)
+        return false;
+
+    // Every X11 window is a surface of the Xwayland server, which is a client of its own
+    std::ifstream comm("/proc/" + std::to_string(miral::pid_of(application)) + "/comm");
+    std::string name;
+    return std::getline(comm, name) && name == "Xwayland";
+}
+
+bool miracle::window_helpers::is_hidden(mir::scene::Surface const& surface, bool is_session_locked, bool is_occluded)
+{
+    return is_occluded || (is_session_locked && !surface.visible_on_lock_screen());
+}
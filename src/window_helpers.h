@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIRACLEWM_WINDOW_HELPERS_H
 
 #include "container.h"
+#include <mir/scene/surface.h>
 #include <miral/window_info.h>
 #include <miral/window_manager_tools.h>
 
@@ -30,6 +31,13 @@ namespace window_helpers
 {
     bool is_window_fullscreen(MirWindowState state);
     miral::WindowSpecification copy_from(miral::WindowInfo const&);
+
+    /// Whether [window] is an X11 window, which is to say that Xwayland created it.
+    bool is_xwayland(miral::Window const& window);
+
+    /// Whether [surface] should be hidden from Mir. Surfaces of the lock screen
+    /// are the only ones that stay visible while the session is locked.
+    bool is_hidden(mir::scene::Surface const& surface, bool is_session_locked, bool is_occluded);
 }
 }
 
@@ -0,0 +1,57 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_WINDOW_MANAGER_MUTEX_H
+#define MIRACLE_WM_WINDOW_MANAGER_MUTEX_H
+
+#include "metrics.h"
+
+#include <chrono>
+#include <mutex>
+
+namespace miracle
+{
+
+/// The recursive mutex that guards the state of the window manager.
+///
+/// Taking it when it is free costs the same as a std::recursive_mutex. When
+/// another thread holds it, the wait is recorded as a lock contention, so that
+/// threads blocking one another show up in the metrics.
+class WindowManagerMutex
+{
+public:
+    void lock()
+    {
+        if (mutex.try_lock())
+            return;
+
+        auto const start = std::chrono::steady_clock::now();
+        mutex.lock();
+        Metrics::instance().increment(MetricCounter::lock_contentions);
+        Metrics::instance().observe(MetricHistogram::lock_wait, std::chrono::steady_clock::now() - start);
+    }
+
+    bool try_lock() { return mutex.try_lock(); }
+    void unlock() { mutex.unlock(); }
+
+private:
+    std::recursive_mutex mutex;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_WINDOW_MANAGER_MUTEX_H
@@ -22,14 +22,80 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "compositor_state.h"
 #include "config.h"
 #include "leaf_container.h"
+#include "output_interface.h"
 #include "policy.h"
+#include "pool_allocator.h"
 #include "window_helpers.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <glm/gtc/matrix_transform.hpp>
 #include <mir/log.h>
+#include <mir/scene/null_surface_observer.h>
 #include <mir/scene/surface.h>
 #include <mir/server_action_queue.h>
 
 using namespace miracle;
 
+namespace
+{
+template <typename T>
+void merge_field(T& to, T const& from)
+{
+    if (from.is_set())
+        to = from;
+}
+
+/// Adds every field that is set in [from] to [to], replacing what [to] held.
+void merge(miral::WindowSpecification& to, miral::WindowSpecification const& from)
+{
+    merge_field(to.top_left(), from.top_left());
+    merge_field(to.size(), from.size());
+    merge_field(to.name(), from.name());
+    merge_field(to.type(), from.type());
+    merge_field(to.state(), from.state());
+    merge_field(to.depth_layer(), from.depth_layer());
+    merge_field(to.userdata(), from.userdata());
+    merge_field(to.min_width(), from.min_width());
+    merge_field(to.min_height(), from.min_height());
+    merge_field(to.max_width(), from.max_width());
+    merge_field(to.max_height(), from.max_height());
+    merge_field(to.parent(), from.parent());
+    merge_field(to.application_id(), from.application_id());
+    merge_field(to.attached_edges(), from.attached_edges());
+    merge_field(to.exclusive_rect(), from.exclusive_rect());
+    merge_field(to.focus_mode(), from.focus_mode());
+}
+
+/// The key of [window] in the [XwaylandGeometry].
+void const* key_of(miral::Window const& window)
+{
+    return std::shared_ptr<mir::scene::Surface>(window).get();
+}
+}
+
+/// Tells the controller when an Xwayland window posts its first frame after a
+/// configure. Frames that answer nothing are ignored without leaving the client's thread.
+class WindowManagerToolsWindowController::XwaylandFrameObserver : public mir::scene::NullSurfaceObserver
+{
+public:
+    explicit XwaylandFrameObserver(std::function<void()> on_answer) :
+        on_answer { std::move(on_answer) }
+    {
+    }
+
+    void frame_posted(mir::scene::Surface const*, mir::geometry::Rectangle const&) override
+    {
+        if (awaiting_frame.exchange(false))
+            on_answer();
+    }
+
+    std::atomic<bool> awaiting_frame = false;
+
+private:
+    std::function<void()> on_answer;
+};
+
 WindowManagerToolsWindowController::WindowManagerToolsWindowController(
     miral::WindowManagerTools const& tools,
     std::shared_ptr<Animator> const& animator,
@@ -55,6 +121,8 @@ void WindowManagerToolsWindowController::open(miral::Window const& window)
         return;
     }
 
+    track_xwayland(window);
+
     auto const& info = info_for(window);
     geom::Rectangle rect { window.top_left(), window.size() };
     if (info.parent())
@@ -63,15 +131,18 @@ void WindowManagerToolsWindowController::open(miral::Window const& window)
         return;
     }
 
-    if (!config->are_animations_enabled())
+    auto const snapshot = config->snapshot();
+    if (!snapshot->animations_enabled || state->animations_suppressed())
     {
         policy->handle_animation(AnimationStepResult { container->animation_handle(), true, rect }, container);
         return;
     }
 
-    auto animation = std::make_shared<WindowAnimation>(
+    auto const& definition = snapshot->animation_definitions[(int)AnimateableEvent::window_open];
+    auto animation = std::allocate_shared<WindowAnimation>(
+        PoolAllocator<WindowAnimation>(),
         container->animation_handle(),
-        config->get_animation_definitions()[(int)AnimateableEvent::window_open],
+        definition,
         rect,
         rect,
         rect,
@@ -79,12 +150,16 @@ void WindowManagerToolsWindowController::open(miral::Window const& window)
         container);
 
     animator->append(animation);
+
+    // The window grows out of a placeholder until the client submits its first
+    // buffer, instead of the animation playing out before anything is shown.
+    if (definition.type == AnimationType::grow)
+        state->render_data_manager()->placeholder_change(*container, rect);
 }
 
 bool WindowManagerToolsWindowController::is_fullscreen(miral::Window const& window)
 {
-    auto& info = tools.info_for(window);
-    return window_helpers::is_window_fullscreen(info.state());
+    return window_helpers::is_window_fullscreen(effective_state(window));
 }
 
 void WindowManagerToolsWindowController::set_rectangle(
@@ -97,6 +172,18 @@ void WindowManagerToolsWindowController::set_rectangle(
         return;
     }
 
+    // Nothing changes if the window already sits untransformed at [to] and is not
+    // on its way elsewhere, so there is no need to wake the client or animate.
+    auto const handle = container->animation_handle();
+    auto const current = effective_rectangle(window);
+    if (!animating.contains(handle)
+        && current == to
+        && container->get_transform() == glm::mat4(1.f))
+    {
+        state->window_update_stats().rectangles_suppressed++;
+        return;
+    }
+
     auto const& info = info_for(window);
     if (info.parent())
     {
@@ -104,7 +191,8 @@ void WindowManagerToolsWindowController::set_rectangle(
         return;
     }
 
-    if (!config->are_animations_enabled() || !with_animations)
+    auto const snapshot = config->snapshot();
+    if (!snapshot->animations_enabled || !with_animations || state->animations_suppressed())
     {
         policy->handle_animation(
             AnimationStepResult { container->animation_handle(),
@@ -117,42 +205,61 @@ void WindowManagerToolsWindowController::set_rectangle(
         return;
     }
 
-    auto animation = std::make_shared<WindowAnimation>(
+    auto animation = std::allocate_shared<WindowAnimation>(
+        PoolAllocator<WindowAnimation>(),
         container->animation_handle(),
-        config->get_animation_definitions()[(int)AnimateableEvent::window_move],
+        snapshot->animation_definitions[(int)AnimateableEvent::window_move],
         from,
         to,
-        geom::Rectangle { window.top_left(), window.size() },
+        current,
         this,
         container);
 
+    animating.insert(handle);
     animator->append(animation);
 }
 
 MirWindowState WindowManagerToolsWindowController::get_state(miral::Window const& window)
 {
-    auto& window_info = tools.info_for(window);
-    return window_info.state();
+    return effective_state(window);
 }
 
 void WindowManagerToolsWindowController::change_state(miral::Window const& window, MirWindowState state)
 {
-    auto& window_info = tools.info_for(window);
+    if (effective_state(window) == state)
+    {
+        this->state->window_update_stats().states_suppressed++;
+        return;
+    }
+
     miral::WindowSpecification spec;
     spec.state() = state;
-    tools.place_and_size_for_state(spec, window_info);
-    tools.modify_window(window, spec);
+    tools.place_and_size_for_state(spec, tools.info_for(window));
+    apply(window, spec);
 }
 
 void WindowManagerToolsWindowController::clip(miral::Window const& window, geom::Rectangle const& r)
 {
     auto& window_info = tools.info_for(window);
+    auto const& current = window_info.clip_area();
+    if (current.is_set() && current.value() == r)
+    {
+        state->window_update_stats().clips_suppressed++;
+        return;
+    }
+
     window_info.clip_area(r);
 }
 
 void WindowManagerToolsWindowController::noclip(miral::Window const& window)
 {
     auto& window_info = tools.info_for(window);
+    if (!window_info.clip_area().is_set())
+    {
+        state->window_update_stats().clips_suppressed++;
+        return;
+    }
+
     window_info.clip_area(mir::optional_value<geom::Rectangle>());
 }
 
@@ -161,6 +268,9 @@ void WindowManagerToolsWindowController::select_active_window(miral::Window cons
     if (state->mode() != WindowManagerMode::normal)
         return;
 
+    // Mir does not activate a window that cannot be seen, so a tab that is being
+    // selected is shown first. The tab container occludes the others once it has focus.
+    set_occluded(window, false);
     tools.select_active_window(window);
 }
 
@@ -189,6 +299,37 @@ void WindowManagerToolsWindowController::send_to_back(miral::Window const& windo
     tools.send_tree_to_back(window);
 }
 
+void WindowManagerToolsWindowController::set_occluded(miral::Window const& window, bool occluded)
+{
+    auto const key = key_of(window);
+    if (!key)
+        return;
+
+    bool const changed = occluded
+        ? occluded_windows.insert(key).second
+        : occluded_windows.erase(key) > 0;
+    if (!changed)
+        return;
+
+    // A window that is hidden by its state stays hidden either way
+    if (effective_state(window) != mir_window_state_hidden)
+    {
+        auto const surface = std::shared_ptr<mir::scene::Surface>(window);
+        surface->set_hidden(window_helpers::is_hidden(*surface, state->is_session_locked(), occluded));
+    }
+    state->window_update_stats().occlusions_changed++;
+}
+
+void WindowManagerToolsWindowController::apply_session_lock(miral::Window const& window)
+{
+    auto const key = key_of(window);
+    if (!key || effective_state(window) == mir_window_state_hidden)
+        return;
+
+    auto const surface = std::shared_ptr<mir::scene::Surface>(window);
+    surface->set_hidden(window_helpers::is_hidden(*surface, state->is_session_locked(), occluded_windows.contains(key)));
+}
+
 WindowManagerToolsWindowController::WindowAnimation::WindowAnimation(
     AnimationHandle handle,
     AnimationDefinition definition,
@@ -201,13 +342,43 @@ WindowManagerToolsWindowController::WindowAnimation::WindowAnimation(
     controller { controller },
     container { container }
 {
+    // Windows that cannot be seen are the first to be skipped when running over budget
+    auto const output = container->get_output();
+    if (output)
+    {
+        auto const& area = output->get_area();
+        set_low_priority(container->get_workspace() != output->active()
+            || (!area.overlaps(from) && !area.overlaps(to)));
+    }
 }
 
 void WindowManagerToolsWindowController::WindowAnimation::on_tick(AnimationStepResult const& asr)
 {
-    controller->server_action_queue->enqueue(controller, [controller = controller, asr = asr, container = container]()
+    controller->queue_animation(asr, container);
+}
+
+void WindowManagerToolsWindowController::queue_animation(
+    AnimationStepResult const& result, std::weak_ptr<Container> const& container)
+{
+    {
+        std::lock_guard lock(pending_animations_mutex);
+        pending_animations.emplace_back(result, container);
+
+        // Only the first result needs to schedule the flush, as it applies everything queued before it runs.
+        if (pending_animations.size() > 1)
+            return;
+    }
+
+    server_action_queue->enqueue(this, [this]()
     {
-        controller->policy->handle_animation(asr, container);
+        std::vector<std::pair<AnimationStepResult, std::weak_ptr<Container>>> results;
+        {
+            std::lock_guard lock(pending_animations_mutex);
+            results.swap(pending_animations);
+        }
+
+        tools.invoke_under_lock([&]()
+        { policy->handle_animations(results); });
     });
 }
 
@@ -215,6 +386,16 @@ void WindowManagerToolsWindowController::process_animation(
     AnimationStepResult const& result,
     std::shared_ptr<Container> const& container)
 {
+    // A result can still be on its way from the animator when the window that it
+    // was for is deleted and its handle goes to another window. It must not end
+    // the slide of the window that has the handle now.
+    if (result.is_complete && result.handle == container->animation_handle())
+        animating.erase(result.handle);
+
+    auto* open_stats = state->window_open_stats();
+    if (open_stats->has_pending() && container->window())
+        open_stats->mark(std::shared_ptr<mir::scene::Surface>(container->window().value()).get(), WindowOpenStage::animated);
+
     bool needs_modify = false;
     miral::WindowSpecification spec;
 
@@ -245,7 +426,7 @@ void WindowManagerToolsWindowController::process_animation(
         auto window = container->window().value();
         if (!window)
             return;
-        tools.modify_window(window, spec);
+        apply(window, spec);
 
         if (result.is_complete)
             container->constrain();
@@ -257,6 +438,17 @@ void WindowManagerToolsWindowController::process_animation(
                 noclip(window);
         }
     }
+    else if (result.is_compositor_only && !result.is_complete && container->get_type() == ContainerType::leaf)
+    {
+        // Compositor-only animations leave the geometry alone, but the clip
+        // must still follow the transformed surface.
+        if (!container->window())
+            return;
+
+        auto window = container->window().value();
+        if (window)
+            clip(window, result.clip_area);
+    }
 }
 
 void WindowManagerToolsWindowController::set_user_data(
@@ -270,7 +462,219 @@ void WindowManagerToolsWindowController::set_user_data(
 void WindowManagerToolsWindowController::modify(
     miral::Window const& window, miral::WindowSpecification const& spec)
 {
+    apply(window, spec);
+}
+
+void WindowManagerToolsWindowController::begin_changes(miral::Window const& window)
+{
+    if (auto const pending = pending_changes_for(window))
+    {
+        pending->depth++;
+        return;
+    }
+
+    pending_changes.push_back({ .window = window, .depth = 1 });
+}
+
+void WindowManagerToolsWindowController::end_changes(miral::Window const& window)
+{
+    auto const it = std::find_if(pending_changes.begin(), pending_changes.end(), [&](auto const& pending)
+    {
+        return pending.window == window;
+    });
+    if (it == pending_changes.end())
+    {
+        mir::log_error("end_changes: no changes are pending for the window");
+        return;
+    }
+
+    if (--it->depth > 0)
+        return;
+
+    auto const pending = std::move(*it);
+    pending_changes.erase(it);
+    if (pending.has_changes && window)
+        send(window, pending.spec);
+}
+
+void WindowManagerToolsWindowController::advise_delete(miral::Window const& window)
+{
+    auto const key = key_of(window);
+    occluded_windows.erase(key);
+    if (!xwayland_geometry.is_tracked(key))
+        return;
+
+    if (auto const it = xwayland_observers.find(key); it != xwayland_observers.end())
+    {
+        if (auto const surface = std::shared_ptr<mir::scene::Surface>(window))
+            surface->unregister_interest(*it->second);
+        xwayland_observers.erase(it);
+    }
+    xwayland_geometry.remove(key);
+    xwayland_scaled.erase(key);
+}
+
+void WindowManagerToolsWindowController::release_animation_handle(Container& container)
+{
+    // The slide never completes, so it must not outlive the handle
+    auto const handle = container.animation_handle();
+    animating.erase(handle);
+    animator->unregister_animateable(handle);
+    container.animation_handle(none_animation_handle);
+}
+
+void WindowManagerToolsWindowController::handle_xwayland_frame(miral::Window const& window)
+{
+    auto const key = key_of(window);
+    if (!xwayland_geometry.is_tracked(key))
+        return;
+
+    if (auto const size = xwayland_geometry.frame_posted(key))
+    {
+        miral::WindowSpecification spec;
+        spec.size() = size.value();
+        tools.modify_window(window, spec);
+        state->window_update_stats().modifications_applied++;
+        on_xwayland_size_sent(window, key, size.value());
+    }
+
+    update_xwayland_transform(window, key);
+}
+
+WindowManagerToolsWindowController::PendingChanges* WindowManagerToolsWindowController::pending_changes_for(
+    miral::Window const& window)
+{
+    for (auto& pending : pending_changes)
+    {
+        if (pending.window == window)
+            return &pending;
+    }
+
+    return nullptr;
+}
+
+void WindowManagerToolsWindowController::apply(miral::Window const& window, miral::WindowSpecification const& spec)
+{
+    auto const pending = pending_changes_for(window);
+    if (!pending)
+    {
+        send(window, spec);
+        return;
+    }
+
+    if (pending->has_changes)
+        state->window_update_stats().modifications_merged++;
+    merge(pending->spec, spec);
+    pending->has_changes = true;
+}
+
+void WindowManagerToolsWindowController::send(miral::Window const& window, miral::WindowSpecification spec)
+{
+    auto const key = spec.size().is_set() ? key_of(window) : nullptr;
+    bool const is_paced = key && xwayland_geometry.is_tracked(key);
+    if (is_paced)
+    {
+        auto const size = spec.size().value();
+        if (xwayland_geometry.request(key, size))
+            on_xwayland_size_sent(window, key, size);
+        else
+        {
+            spec.size() = mir::optional_value<geom::Size>();
+            if (xwayland_geometry.target(key) != xwayland_geometry.sent(key))
+                state->window_update_stats().xwayland_sizes_deferred++;
+        }
+    }
+
     tools.modify_window(window, spec);
+    state->window_update_stats().modifications_applied++;
+
+    if (is_paced)
+        update_xwayland_transform(window, key);
+
+    // Mir shows a window again whenever it leaves the hidden state, occluded or not
+    if (spec.state().is_set()
+        && spec.state().value() != mir_window_state_hidden
+        && occluded_windows.contains(key_of(window)))
+        std::shared_ptr<mir::scene::Surface>(window)->set_hidden(true);
+}
+
+void WindowManagerToolsWindowController::track_xwayland(miral::Window const& window)
+{
+    auto const key = key_of(window);
+    if (!key || xwayland_geometry.is_tracked(key) || !window_helpers::is_xwayland(window))
+        return;
+
+    auto observer = std::make_shared<XwaylandFrameObserver>([this, window]()
+    {
+        server_action_queue->enqueue(this, [this, window]()
+        {
+            tools.invoke_under_lock([&]()
+            { policy->handle_xwayland_frame(window); });
+        });
+    });
+    std::shared_ptr<mir::scene::Surface>(window)->register_interest(observer);
+    xwayland_observers.emplace(key, std::move(observer));
+    xwayland_geometry.track(key, window.size());
+}
+
+void WindowManagerToolsWindowController::on_xwayland_size_sent(
+    miral::Window const& window, void const* key, geom::Size const& size)
+{
+    state->window_update_stats().xwayland_sizes_sent++;
+    if (auto const it = xwayland_observers.find(key); it != xwayland_observers.end())
+        it->second->awaiting_frame = true;
+
+    // The surface is drawn at the size that it was sent, however far behind its
+    // buffer is, so that is the size that an animation scales from
+    if (auto const container = get_container(window))
+        set_size_hack(container->animation_handle(), size);
+}
+
+void WindowManagerToolsWindowController::update_xwayland_transform(miral::Window const& window, void const* key)
+{
+    auto const container = get_container(window);
+    if (!container || animating.contains(container->animation_handle()))
+        return;
+
+    // Animations scale the window themselves. Otherwise, a window that is waiting
+    // for its new size is stretched to that size in the meantime.
+    auto const sent = xwayland_geometry.sent(key);
+    auto const target = xwayland_geometry.target(key);
+    if (sent && target && sent != target && sent->width.as_int() > 0 && sent->height.as_int() > 0)
+    {
+        container->set_transform(glm::scale(glm::mat4(1.f), glm::vec3(
+            static_cast<float>(target->width.as_int()) / static_cast<float>(sent->width.as_int()),
+            static_cast<float>(target->height.as_int()) / static_cast<float>(sent->height.as_int()),
+            1.f)));
+        xwayland_scaled.insert(key);
+    }
+    else if (xwayland_scaled.erase(key))
+        container->set_transform(glm::mat4(1.f));
+}
+
+MirWindowState WindowManagerToolsWindowController::effective_state(miral::Window const& window)
+{
+    auto const pending = pending_changes_for(window);
+    if (pending && pending->spec.state().is_set())
+        return pending->spec.state().value();
+
+    return tools.info_for(window).state();
+}
+
+geom::Rectangle WindowManagerToolsWindowController::effective_rectangle(miral::Window const& window)
+{
+    geom::Rectangle rectangle { window.top_left(), window.size() };
+    if (auto const target = xwayland_geometry.target(key_of(window)))
+        rectangle.size = target.value();
+    if (auto const pending = pending_changes_for(window))
+    {
+        if (pending->spec.top_left().is_set())
+            rectangle.top_left = pending->spec.top_left().value();
+        if (pending->spec.size().is_set())
+            rectangle.size = pending->spec.size().value();
+    }
+
+    return rectangle;
 }
 
 miral::WindowInfo& WindowManagerToolsWindowController::info_for(miral::Window const& window)
@@ -20,7 +20,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "animator.h"
 #include "window_controller.h"
+#include "xwayland_geometry.h"
 #include <miral/window_manager_tools.h>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace mir
 {
@@ -53,6 +58,13 @@ public:
     std::shared_ptr<Container> get_container(miral::Window const&) override;
     void raise(miral::Window const&) override;
     void send_to_back(miral::Window const&) override;
+    void set_occluded(miral::Window const&, bool occluded) override;
+
+    /// Hides [window] from Mir while the session is locked, so that it is neither
+    /// composited nor sent frame callbacks, and shows it again once the session is
+    /// unlocked unless it is occluded. Windows of the lock screen are never hidden.
+    /// See [CompositorState::is_session_locked].
+    void apply_session_lock(miral::Window const& window);
     void set_user_data(miral::Window const&, std::shared_ptr<void> const&) override;
     void modify(miral::Window const&, miral::WindowSpecification const&) override;
     miral::WindowInfo& info_for(miral::Window const&) override;
@@ -63,8 +75,32 @@ public:
     void set_size_hack(AnimationHandle handle, mir::geometry::Size const& size) override;
     miral::Window window_at(float x, float y) override;
     void process_animation(AnimationStepResult const&, std::shared_ptr<Container> const&) override;
+    void begin_changes(miral::Window const& window) override;
+    void end_changes(miral::Window const& window) override;
+
+    /// Forgets [window], which is being deleted.
+    void advise_delete(miral::Window const& window);
+
+    /// Gives the animation handle of [container], whose window is being deleted,
+    /// back to the animator so that the next window can take it. Whatever was
+    /// still animating the window is dropped along with the handle.
+    void release_animation_handle(Container& container);
+
+    /// Called when an Xwayland window posts the frame that answers its last configure.
+    void handle_xwayland_frame(miral::Window const& window);
 
 private:
+    class XwaylandFrameObserver;
+
+    /// The modifications of a window that are being held back by [begin_changes].
+    struct PendingChanges
+    {
+        miral::Window window;
+        int depth = 0;
+        bool has_changes = false;
+        miral::WindowSpecification spec;
+    };
+
     miral::WindowManagerTools tools;
     std::shared_ptr<Animator> animator;
     std::shared_ptr<CompositorState> state;
@@ -72,6 +108,43 @@ private:
     std::shared_ptr<mir::ServerActionQueue> server_action_queue;
     Policy* policy;
 
+    /// The windows whose rectangle is still being animated towards its target.
+    std::unordered_set<AnimationHandle> animating;
+
+    /// Results produced by the animator thread that have yet to be applied on the server thread.
+    std::mutex pending_animations_mutex;
+    std::vector<std::pair<AnimationStepResult, std::weak_ptr<Container>>> pending_animations;
+
+    /// Usually a single window, as windows commit their changes one at a time.
+    std::vector<PendingChanges> pending_changes;
+
+    /// The sizes of Xwayland windows, which are sent no faster than the clients answer them.
+    XwaylandGeometry xwayland_geometry;
+    std::unordered_map<void const*, std::shared_ptr<XwaylandFrameObserver>> xwayland_observers;
+    /// The Xwayland windows that are scaled to a size that they have yet to be sent.
+    std::unordered_set<void const*> xwayland_scaled;
+
+    /// The windows that Mir has been told cannot be seen. See [set_occluded].
+    std::unordered_set<void const*> occluded_windows;
+
+    [[nodiscard]] PendingChanges* pending_changes_for(miral::Window const& window);
+    /// Modifies [window] now, or adds [spec] to its pending changes if it has any.
+    void apply(miral::Window const& window, miral::WindowSpecification const& spec);
+    /// Modifies [window], holding back a size that an Xwayland window is not ready for.
+    void send(miral::Window const& window, miral::WindowSpecification spec);
+    /// Starts pacing the sizes of [window] if it is an Xwayland window.
+    void track_xwayland(miral::Window const& window);
+    /// Waits for the answer to the size that was just sent to the Xwayland window [window].
+    void on_xwayland_size_sent(miral::Window const& window, void const* key, geom::Size const& size);
+    /// Scales an Xwayland window to the size that it is waiting to be sent, if any.
+    void update_xwayland_transform(miral::Window const& window, void const* key);
+    /// The state and rectangle of [window] once its pending changes are applied.
+    [[nodiscard]] MirWindowState effective_state(miral::Window const& window);
+    [[nodiscard]] geom::Rectangle effective_rectangle(miral::Window const& window);
+
+    /// Queues [result] to be applied along with every other result of the same tick.
+    void queue_animation(AnimationStepResult const& result, std::weak_ptr<Container> const& container);
+
     class WindowAnimation : public Animation
     {
     public:
@@ -0,0 +1,114 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "window_open_stats.h"
+
+using namespace miracle;
+
+char const* miracle::to_string(WindowOpenStage stage)
+{
+    switch (stage)
+    {
+    case WindowOpenStage::placed:
+        return "placed";
+    case WindowOpenStage::created:
+        return "created";
+    case WindowOpenStage::animated:
+        return "animated";
+    case WindowOpenStage::ready:
+        return "ready";
+    case WindowOpenStage::first_frame:
+        return "first_frame";
+    default:
+        return "unknown";
+    }
+}
+
+WindowOpenStats::WindowOpenStats(size_t window) :
+    stage_ms {
+        RollingSamples(window),
+        RollingSamples(window),
+        RollingSamples(window),
+        RollingSamples(window),
+        RollingSamples(window)
+    }
+{
+}
+
+void WindowOpenStats::begin(void const* surface, Clock::time_point requested)
+{
+    std::lock_guard lock(mutex);
+    pending[surface] = PendingWindow { .requested = requested };
+    pending_count.store(pending.size(), std::memory_order_relaxed);
+}
+
+void WindowOpenStats::mark(void const* surface, WindowOpenStage stage, Clock::time_point time)
+{
+    std::lock_guard lock(mutex);
+    auto const it = pending.find(surface);
+    if (it == pending.end())
+        return;
+
+    auto& window = it->second;
+    auto& reached = window.stages[(size_t)stage];
+    if (!reached)
+        reached = time;
+
+    if (stage != WindowOpenStage::first_frame)
+        return;
+
+    // A stage that the window skipped, such as an animation that was disabled, is left out
+    for (size_t i = 0; i < window.stages.size(); i++)
+    {
+        if (window.stages[i])
+            stage_ms[i].push(std::chrono::duration<double, std::milli>(window.stages[i].value() - window.requested).count());
+    }
+
+    opened++;
+    pending.erase(it);
+    pending_count.store(pending.size(), std::memory_order_relaxed);
+}
+
+void WindowOpenStats::remove(void const* surface)
+{
+    std::lock_guard lock(mutex);
+    if (pending.erase(surface))
+    {
+        abandoned++;
+        pending_count.store(pending.size(), std::memory_order_relaxed);
+    }
+}
+
+nlohmann::json WindowOpenStats::to_json() const
+{
+    std::lock_guard lock(mutex);
+    auto stages = nlohmann::json::object();
+    for (size_t i = 0; i < stage_ms.size(); i++)
+    {
+        stages[to_string(static_cast<WindowOpenStage>(i))] = {
+            { "p50", stage_ms[i].percentile(0.5) },
+            { "p95", stage_ms[i].percentile(0.95) }
+        };
+    }
+
+    return {
+        { "opened", opened },
+        { "abandoned", abandoned },
+        { "pending", pending.size() },
+        { "stages_ms", stages }
+    };
+}
@@ -0,0 +1,99 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_WINDOW_OPEN_STATS_H
+#define MIRACLE_WM_WINDOW_OPEN_STATS_H
+
+#include "render_stats.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <unordered_map>
+
+namespace miracle
+{
+
+/// The stages that a new window passes through on its way to the screen, in the
+/// order in which they usually happen. Each is timed from the moment that the
+/// client asked for the window.
+enum class WindowOpenStage
+{
+    /// A position was allocated for the window.
+    placed,
+    /// The container of the window was created.
+    created,
+    /// The first step of the open animation was applied.
+    animated,
+    /// The client submitted its first buffer.
+    ready,
+    /// The window was drawn by a renderer for the first time.
+    first_frame,
+    max
+};
+
+char const* to_string(WindowOpenStage stage);
+
+/// Times each new window from the moment that it is asked for until it is first
+/// drawn. The window manager and the renderers report from their own threads.
+class WindowOpenStats
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// [window] is the number of windows over which percentiles are computed.
+    explicit WindowOpenStats(size_t window = 200);
+
+    /// Starts timing the window of [surface], which was asked for at [requested].
+    void begin(void const* surface, Clock::time_point requested);
+
+    /// Records that the window of [surface] reached [stage] at [time]. Only the
+    /// first time that a stage is reached counts. The window is done once it has
+    /// reached [WindowOpenStage::first_frame].
+    void mark(void const* surface, WindowOpenStage stage, Clock::time_point time = Clock::now());
+
+    /// Stops timing the window of [surface], which closed before it was drawn.
+    void remove(void const* surface);
+
+    /// Returns true if any window has yet to be drawn. This does not lock, so
+    /// that it may be checked for every window in every frame.
+    [[nodiscard]] bool has_pending() const { return pending_count.load(std::memory_order_relaxed) > 0; }
+
+    /// The percentiles of each stage in milliseconds.
+    [[nodiscard]] nlohmann::json to_json() const;
+
+private:
+    struct PendingWindow
+    {
+        Clock::time_point requested;
+        std::array<std::optional<Clock::time_point>, (size_t)WindowOpenStage::max> stages;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<void const*, PendingWindow> pending;
+    std::atomic<size_t> pending_count = 0;
+    std::array<RollingSamples, (size_t)WindowOpenStage::max> stage_ms;
+    size_t opened = 0;
+    size_t abandoned = 0;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_WINDOW_OPEN_STATS_H
@@ -0,0 +1,95 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "worker_pool.h"
+
+using namespace miracle;
+
+WorkerPool::WorkerPool(size_t thread_count)
+{
+    threads.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; i++)
+        threads.emplace_back([this]() { work(); });
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard lock(mutex);
+        is_stopping = true;
+    }
+
+    loop_started.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+void WorkerPool::for_each(size_t count, FunctionRef<void(size_t)> task)
+{
+    if (count == 0)
+        return;
+
+    Loop current { task, count };
+    {
+        std::lock_guard lock(mutex);
+        loop = &current;
+        loop_generation++;
+    }
+
+    loop_started.notify_all();
+    run_iterations(current);
+
+    // Every iteration has been claimed, but the workers may still be running theirs.
+    // Workers that wake up after this find no loop to join.
+    std::unique_lock lock(mutex);
+    loop_finished.wait(lock, [this]() { return busy_workers == 0; });
+    loop = nullptr;
+}
+
+void WorkerPool::work()
+{
+    uint64_t seen_generation = 0;
+    while (true)
+    {
+        Loop* current;
+        {
+            std::unique_lock lock(mutex);
+            loop_started.wait(lock, [&]() { return is_stopping || loop_generation != seen_generation; });
+            if (is_stopping)
+                return;
+
+            seen_generation = loop_generation;
+            if (!loop)
+                continue;
+
+            current = loop;
+            busy_workers++;
+        }
+
+        run_iterations(*current);
+
+        std::lock_guard lock(mutex);
+        if (--busy_workers == 0)
+            loop_finished.notify_one();
+    }
+}
+
+void WorkerPool::run_iterations(Loop& loop)
+{
+    for (auto index = loop.next_index.fetch_add(1); index < loop.count; index = loop.next_index.fetch_add(1))
+        loop.task(index);
+}
@@ -0,0 +1,77 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_WORKER_POOL_H
+#define MIRACLE_WM_WORKER_POOL_H
+
+#include "function_ref.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace miracle
+{
+
+/// A few threads that share the iterations of a loop with the thread that runs it,
+/// for work that splits into pieces that do not touch one another.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(size_t thread_count);
+    ~WorkerPool();
+    WorkerPool(WorkerPool const&) = delete;
+    WorkerPool& operator=(WorkerPool const&) = delete;
+
+    /// Calls [task] with every index below [count], spread over the workers and the
+    /// calling thread, and returns once every call has returned. Only one thread
+    /// may run a loop at a time.
+    void for_each(size_t count, FunctionRef<void(size_t)> task);
+
+    [[nodiscard]] size_t thread_count() const { return threads.size(); }
+
+private:
+    /// The loop that is being run. It lives on the stack of [for_each].
+    struct Loop
+    {
+        FunctionRef<void(size_t)> task;
+        size_t count;
+        std::atomic<size_t> next_index = 0;
+    };
+
+    void work();
+
+    /// Runs unclaimed iterations of [loop] until there are none left.
+    static void run_iterations(Loop& loop);
+
+    std::mutex mutex;
+    std::condition_variable loop_started;
+    std::condition_variable loop_finished;
+    bool is_stopping = false;
+    uint64_t loop_generation = 0;
+    Loop* loop = nullptr;
+    /// The workers that are running iterations of [loop].
+    size_t busy_workers = 0;
+    std::vector<std::thread> threads;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_WORKER_POOL_H
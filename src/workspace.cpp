@@ -25,8 +25,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "output_interface.h"
 #include "output_manager.h"
 #include "parent_container.h"
+#include "pool_allocator.h"
 #include "shell_component_container.h"
 
+#include <algorithm>
 #include <cassert>
 #include <mir/log.h>
 #include <mir/scene/surface.h>
@@ -74,9 +76,8 @@ LayoutScheme from_direction(Direction direction)
     }
 }
 
-std::shared_ptr<Container> foreach_node_internal(
-    std::function<bool(std::shared_ptr<Container> const&)> const& f,
-    std::shared_ptr<Container> const& parent)
+template <typename F>
+std::shared_ptr<Container> foreach_node_internal(F const& f, std::shared_ptr<Container> const& parent)
 {
     if (f(parent))
         return parent;
@@ -118,13 +119,17 @@ Workspace::Workspace(
     window_controller { window_controller },
     state { state },
     config { config },
-    root(std::make_shared<ParentContainer>(
+    root(std::allocate_shared<ParentContainer>(
+        PoolAllocator<ParentContainer>(),
         state, window_controller, config, get_output_area(output), this, nullptr, true))
 {
-    config_handle = config->register_listener([this](auto const&)
+    // Only the gaps and the borders change the area of the containers
+    auto const on_change = [this](auto const&)
     {
+        state->layout_changed();
         recalculate_area();
-    });
+    };
+    config_handle = config->register_listener(on_change, ConfigSection::gaps | ConfigSection::border, 5);
 }
 
 Workspace::~Workspace()
@@ -132,16 +137,34 @@ Workspace::~Workspace()
     config->unregister_listener(config_handle);
 }
 
+void Workspace::recycle(uint32_t id, std::optional<int> num, std::optional<std::string> name)
+{
+    id_ = id;
+    num_ = num;
+    name_ = std::move(name);
+    last_selected_container.reset();
+    pending_layout.reset();
+    if (root->get_scheme() != config->get_default_layout_scheme())
+        root->set_layout(config->get_default_layout_scheme());
+    recalculate_area();
+}
+
 void Workspace::set_area(mir::geometry::Rectangle const& area)
 {
+    // Nobody sees the windows of a hidden workspace, so they are laid out once it is shown
+    if (is_hidden)
+    {
+        deferred_area = area;
+        return;
+    }
+
     root->set_logical_area(area);
     root->commit_changes();
 }
 
 void Workspace::recalculate_area()
 {
-    root->set_logical_area(get_output_area(output));
-    root->commit_changes();
+    set_area(get_output_area(output));
 }
 
 AllocationHint Workspace::allocate_position(
@@ -158,6 +181,12 @@ AllocationHint Workspace::allocate_position(
     {
     case ContainerType::leaf:
     {
+        if (pending_layout && !hint.parent)
+        {
+            if (auto const from_layout = allocate_position_from_layout(app_info, requested_specification))
+                return from_layout.value();
+        }
+
         auto parent = hint.parent ? hint.parent.value() : get_layout_container();
         requested_specification = parent->place_new_window(requested_specification);
         return { ContainerType::leaf, parent };
@@ -193,11 +222,196 @@ std::shared_ptr<Container> Workspace::create_container(
     spec.min_width() = mir::geometry::Width(0);
     spec.min_height() = mir::geometry::Height(0);
     window_controller->modify(window_info.window(), spec);
+
+    if (pending_layout && pending_layout->placing)
+    {
+        pending_layout->windows[pending_layout->placing.value()] = container;
+        pending_layout->placing.reset();
+        apply_pending_layout();
+    }
+
+    // A layout may take a window onto a workspace that is not being shown
+    if (is_hidden && container)
+        container->hide();
+
+    state->layout_changed();
     return container;
 }
 
+bool Workspace::append_layout(LayoutTemplateNode const& layout)
+{
+    if (root->num_nodes() > 0)
+    {
+        mir::log_error("append_layout: workspace %s already has tiled windows", display_name().c_str());
+        return false;
+    }
+
+    pending_layout = std::make_unique<PendingLayout>(PendingLayout { .layout = layout });
+    pending_layout->containers[{}] = root;
+    root->set_layout(layout.scheme);
+    return true;
+}
+
+std::optional<AllocationHint> Workspace::allocate_position_from_layout(
+    miral::ApplicationInfo const& app_info,
+    miral::WindowSpecification& requested_specification)
+{
+    auto& pending = *pending_layout;
+    pending.placing.reset();
+
+    // The layout is solved for the area that the workspace has now, which may have
+    // changed since the layout was appended.
+    auto const snapshot = config->snapshot();
+    auto const solution = solve_layout_template(
+        pending.layout, root->get_logical_area(), snapshot->half_inner_gaps_x, snapshot->half_inner_gaps_y);
+
+    auto const app_id = requested_specification.application_id().is_set()
+        ? requested_specification.application_id().value()
+        : app_info.name();
+    auto const title = requested_specification.name().is_set() ? requested_specification.name().value() : "";
+    auto const slot = find_free_slot(solution, app_id, title);
+    if (slot == solution.slots.end())
+        return std::nullopt;
+
+    auto const is_realized = [&](std::vector<size_t> const& path, LayoutTemplateNode const& node)
+    {
+        if (node.is_slot())
+        {
+            auto const it = pending.windows.find(path);
+            return it != pending.windows.end() && !it->second.expired();
+        }
+
+        auto const it = pending.containers.find(path);
+        return it != pending.containers.end() && !it->second.expired();
+    };
+
+    // Walk down to the slot, creating the containers that it needs on the way
+    auto parent = root;
+    LayoutTemplateNode const* node = &pending.layout;
+    std::vector<size_t> path;
+    for (auto const index : slot->path)
+    {
+        // The nodes that come before this one in the template but have no windows
+        // yet take up no room in the tree.
+        int tree_index = 0;
+        for (size_t i = 0; i < index; i++)
+        {
+            path.push_back(i);
+            if (is_realized(path, node->nodes[i]))
+                tree_index++;
+            path.pop_back();
+        }
+
+        path.push_back(index);
+        node = &node->nodes[index];
+        if (tree_index > (int)parent->num_nodes())
+        {
+            mir::log_warning("append_layout: the tree of workspace %s no longer follows its layout", display_name().c_str());
+            pending_layout.reset();
+            return std::nullopt;
+        }
+
+        if (node->is_slot())
+        {
+            requested_specification = parent->place_new_window(requested_specification, tree_index);
+            break;
+        }
+
+        auto child = is_realized(path, *node) ? pending.containers[path].lock() : nullptr;
+        if (!child)
+        {
+            child = std::allocate_shared<ParentContainer>(
+                PoolAllocator<ParentContainer>(),
+                state, window_controller, config, parent->get_logical_area(), this, parent, true);
+            parent->graft_existing(child, tree_index);
+            child->set_layout(node->scheme);
+            pending.containers[path] = child;
+        }
+        else if (child->get_parent().lock() != parent)
+        {
+            mir::log_warning("append_layout: the tree of workspace %s no longer follows its layout", display_name().c_str());
+            pending_layout.reset();
+            return std::nullopt;
+        }
+
+        parent = child;
+    }
+
+    // The window is mapped at the size that it will have once the layout is full
+    requested_specification.top_left() = slot->visible_area.top_left;
+    requested_specification.size() = slot->visible_area.size;
+    pending.placing = slot->path;
+    return AllocationHint { ContainerType::leaf, parent };
+}
+
+bool Workspace::has_layout_slot_for(std::string const& app_id, std::string const& title) const
+{
+    if (!pending_layout)
+        return false;
+
+    auto const snapshot = config->snapshot();
+    auto const solution = solve_layout_template(
+        pending_layout->layout, root->get_logical_area(), snapshot->half_inner_gaps_x, snapshot->half_inner_gaps_y);
+    return find_free_slot(solution, app_id, title) != solution.slots.end();
+}
+
+std::vector<LayoutTemplateSlot>::const_iterator Workspace::find_free_slot(
+    LayoutTemplateSolution const& solution, std::string const& app_id, std::string const& title) const
+{
+    return std::find_if(solution.slots.begin(), solution.slots.end(), [&](LayoutTemplateSlot const& slot)
+    {
+        auto const window = pending_layout->windows.find(slot.path);
+        bool const is_free = window == pending_layout->windows.end() || window->second.expired();
+        return is_free && slot.node->matches(app_id, title);
+    });
+}
+
+void Workspace::apply_pending_layout()
+{
+    auto& pending = *pending_layout;
+    auto const snapshot = config->snapshot();
+    auto const solution = solve_layout_template(
+        pending.layout, root->get_logical_area(), snapshot->half_inner_gaps_x, snapshot->half_inner_gaps_y);
+
+    // Containers come before their nodes, so each node ends up with the exact area
+    // of its slot rather than a share of what its parent has been given so far.
+    // The root keeps its area, which is the one that the layout was solved for.
+    for (auto const& container : solution.containers)
+    {
+        if (container.path.empty())
+            continue;
+
+        if (auto const it = pending.containers.find(container.path); it != pending.containers.end())
+        {
+            if (auto const locked = it->second.lock())
+                locked->set_logical_area(container.logical_area);
+        }
+    }
+
+    size_t filled = 0;
+    for (auto const& slot : solution.slots)
+    {
+        if (auto const it = pending.windows.find(slot.path); it != pending.windows.end())
+        {
+            if (auto const locked = it->second.lock())
+            {
+                locked->set_logical_area(slot.logical_area);
+                filled++;
+            }
+        }
+    }
+
+    root->commit_changes();
+    if (filled == solution.slots.size())
+    {
+        mir::log_info("append_layout: every slot of the layout on workspace %s is filled", display_name().c_str());
+        pending_layout.reset();
+    }
+}
+
 void Workspace::delete_container(std::shared_ptr<Container> const& container)
 {
+    state->layout_changed();
     switch (container->get_type())
     {
     case ContainerType::leaf:
@@ -228,6 +442,14 @@ void Workspace::advise_focus_gained(std::shared_ptr<Container> const& container)
 
 void Workspace::show()
 {
+    is_hidden = false;
+    if (deferred_area)
+    {
+        auto const area = deferred_area.value();
+        deferred_area.reset();
+        set_area(area);
+    }
+
     root->show();
     for (auto const& floating : floating_trees)
         floating->show();
@@ -235,12 +457,13 @@ void Workspace::show()
 
 void Workspace::hide()
 {
+    is_hidden = true;
     root->hide();
     for (auto const& floating : floating_trees)
         floating->hide();
 }
 
-bool Workspace::for_each_window(std::function<bool(std::shared_ptr<Container>)> const& f) const
+bool Workspace::for_each_window(FunctionRef<bool(std::shared_ptr<Container> const&)> f) const
 {
     auto _for_each_window = [&](std::shared_ptr<Container> const& node)
     {
@@ -252,8 +475,8 @@ bool Workspace::for_each_window(std::function<bool(std::shared_ptr<Container>)>
                 return false;
             }
 
-            auto container = window_controller->get_container(leaf->window().value());
-            if (container && f(container))
+            // The leaf is the container of its window, so there is nothing to look up
+            if (f(node))
                 return true;
         }
 
@@ -274,6 +497,9 @@ bool Workspace::for_each_window(std::function<bool(std::shared_ptr<Container>)>
 
 void Workspace::transfer_pinned_windows_to(std::shared_ptr<WorkspaceInterface> const& other)
 {
+    // This runs on every workspace switch, so the layout is only marked as changed
+    // by [graft] when there is a pinned window to move.
+    RenderDataManager::Batch batch(*state->render_data_manager());
     for (auto it = floating_trees.begin(); it != floating_trees.end();)
     {
         if (it->get()->pinned())
@@ -288,7 +514,8 @@ void Workspace::transfer_pinned_windows_to(std::shared_ptr<WorkspaceInterface> c
 
 std::shared_ptr<ParentContainer> Workspace::create_floating_tree(mir::geometry::Rectangle const& area)
 {
-    auto floating = std::make_shared<ParentContainer>(
+    auto floating = std::allocate_shared<ParentContainer>(
+        PoolAllocator<ParentContainer>(),
         state, window_controller, config, area, this, nullptr, false);
     floating_trees.push_back(floating);
     return floating;
@@ -346,7 +573,7 @@ Workspace::MoveResult Workspace::handle_move(Container& from, Direction directio
     //     currently is
     //  2. If our parent layout direction does not equal the root layout direction, we can append
     //     or prepend to the root
-    if (auto insert_node = LeafContainer::handle_select(from, direction))
+    if (auto insert_node = neighbour(from, direction))
     {
         return {
             MoveResult::traversal_type_insert,
@@ -361,7 +588,8 @@ Workspace::MoveResult Workspace::handle_move(Container& from, Direction directio
         if (new_layout_direction == root->get_direction())
             return {};
 
-        auto after_root_lane = std::make_shared<ParentContainer>(
+        auto after_root_lane = std::allocate_shared<ParentContainer>(
+            PoolAllocator<ParentContainer>(),
             state,
             window_controller,
             config,
@@ -388,6 +616,22 @@ Workspace::MoveResult Workspace::handle_move(Container& from, Direction directio
         };
 }
 
+std::shared_ptr<LeafContainer> Workspace::neighbour(Container& from, Direction direction)
+{
+    // Moving the focus leaves the layout as it is, so holding down a focus key
+    // walks the tree once for each window rather than once for each key press.
+    if (neighbours_generation != state->layout_generation())
+    {
+        neighbours.clear();
+        neighbours_generation = state->layout_generation();
+    }
+
+    auto& found = neighbours[&from][static_cast<size_t>(direction)];
+    if (!found)
+        found = LeafContainer::handle_select(from, direction);
+    return found->lock();
+}
+
 void Workspace::select_first_window()
 {
     // Check if the selected container is already on this workspace
@@ -433,14 +677,29 @@ void Workspace::set_output(OutputInterface* new_output)
 
 void Workspace::workspace_transform_change_hack()
 {
-    // TODO: This is extra extra slow, especially for animation purposes.
-    //  We should have the [LeafContainer]s in a row and we should probably
-    //  set all container transforms at the same time to avoid taking
-    //  the lock over and over again.
+    // Every window on the workspace shares its transform, so the render data holds
+    // it once for the whole workspace rather than once per window.
+    if (output)
+    {
+        auto const& workspaces = output->get_workspaces();
+        for (size_t i = 0; i < workspaces.size(); i++)
+        {
+            if (workspaces[i].get() == this)
+            {
+                state->render_data_manager()->workspace_transform_change(id_, output->get_workspace_transform(i));
+                break;
+            }
+        }
+    }
+
+    surface_transform_change_hack();
+}
+
+void Workspace::surface_transform_change_hack()
+{
     for_each_window([&](std::shared_ptr<Container> const& container)
     {
         auto window = container->window();
-        state->render_data_manager()->workspace_transform_change(*container);
         if (window)
         {
             auto surface = window->operator std::shared_ptr<mir::scene::Surface>();
@@ -466,6 +725,7 @@ bool Workspace::is_empty() const
 
 void Workspace::graft(std::shared_ptr<Container> const& container)
 {
+    state->layout_changed();
     switch (container->get_type())
     {
     case ContainerType::parent:
@@ -526,64 +786,62 @@ std::string Workspace::display_name() const
 }
 
 nlohmann::json Workspace::to_json(bool is_output_focused) const
+{
+    std::string serialized;
+    JsonWriter writer(serialized);
+    write_json(writer, is_output_focused);
+    return nlohmann::json::parse(serialized);
+}
+
+void Workspace::write_json(JsonWriter& writer, bool is_output_focused) const
 {
     bool const is_active_on_output = output->active() == this;
+    geom::Rectangle const empty_area;
 
     // Note: The reported workspace area appears to be the placement
     // area of the root tree.
     //   See: https://i3wm.org/docs/ipc.html#_tree_reply
     auto area = root->get_logical_area();
 
-    nlohmann::json floating_nodes = nlohmann::json::array();
+    writer.begin_object()
+        .key("num")
+        .value(num_ ? num_.value() : -1)
+        .key("id")
+        .value(reinterpret_cast<std::uintptr_t>(this))
+        .key("type")
+        .value("workspace")
+        .key("name")
+        .value(display_name())
+        .key("visible")
+        .value(is_active_on_output)
+        .key("focused")
+        .value(is_output_focused && is_active_on_output)
+        .key("urgent")
+        .value(false)
+        .key("output")
+        .value(output->name())
+        .key("border")
+        .value("none")
+        .key("current_border_width")
+        .value(0)
+        .key("layout")
+        .value(to_string(root->get_scheme()))
+        .key("orientation")
+        .value("none")
+        .rect("window_rect", empty_area)
+        .rect("deco_rect", empty_area)
+        .rect("geometry", empty_area)
+        .key("window")
+        .null()
+        .rect("rect", area);
+
+    writer.key("floating_nodes").begin_array();
     for (auto const& container : floating_trees)
-        floating_nodes.push_back(container->to_json(is_active_on_output));
+        container->write_json(writer, is_active_on_output);
+    writer.end_array();
 
-    nlohmann::json nodes = nlohmann::json::array();
+    writer.key("nodes").begin_array();
     for (auto const& container : root->get_sub_nodes())
-        nodes.push_back(container->to_json(is_active_on_output));
-
-    return {
-        {
-         "num",
-         num_ ? num_.value() : -1,
-         },
-        { "id", reinterpret_cast<std::uintptr_t>(this) },
-        { "type", "workspace" },
-        { "name", display_name() },
-        { "visible", is_active_on_output },
-        { "focused", is_output_focused && is_active_on_output },
-        { "urgent", false },
-        { "output", output->name() },
-        { "border", "none" },
-        { "current_border_width", 0 },
-        { "layout", to_string(root->get_scheme()) },
-        { "orientation", "none" },
-        { "window_rect", {
-                             { "x", 0 },
-                             { "y", 0 },
-                             { "width", 0 },
-                             { "height", 0 },
-                         } },
-        { "deco_rect", {
-                           { "x", 0 },
-                           { "y", 0 },
-                           { "width", 0 },
-                           { "height", 0 },
-                       } },
-        { "geometry", {
-                          { "x", 0 },
-                          { "y", 0 },
-                          { "width", 0 },
-                          { "height", 0 },
-                      } },
-        { "window", nullptr },
-        { "floating_nodes", floating_nodes },
-        { "rect", {
-                                                                                   { "x", area.top_left.x.as_int() },
-                                                                                   { "y", area.top_left.y.as_int() },
-                                                                                   { "width", area.size.width.as_int() },
-                                                                                   { "height", area.size.height.as_int() },
-                                                                               } },
-        { "nodes", nodes }
-    };
+        container->write_json(writer, is_active_on_output);
+    writer.end_array().end_object();
 }
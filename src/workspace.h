@@ -18,11 +18,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef MIRACLEWM_WORKSPACE_CONTENT_H
 #define MIRACLEWM_WORKSPACE_CONTENT_H
 
+#include "layout_template.h"
 #include "workspace_interface.h"
 
+#include <array>
 #include <glm/glm.hpp>
+#include <map>
 #include <memory>
 #include <miral/window_manager_tools.h>
+#include <unordered_map>
 
 namespace miracle
 {
@@ -59,21 +63,30 @@ public:
     void show() override;
     void hide() override;
     void transfer_pinned_windows_to(std::shared_ptr<WorkspaceInterface> const& other) override;
-    bool for_each_window(std::function<bool(std::shared_ptr<Container>)> const&) const override;
+    bool for_each_window(FunctionRef<bool(std::shared_ptr<Container> const&)> f) const override;
     std::shared_ptr<ParentContainer> create_floating_tree(mir::geometry::Rectangle const& area) override;
     void advise_focus_gained(std::shared_ptr<Container> const& container) override;
     void select_first_window() override;
+    std::shared_ptr<LeafContainer> neighbour(Container& from, Direction direction) override;
     OutputInterface* get_output() const override;
     void set_output(OutputInterface*) override;
     void workspace_transform_change_hack() override;
+    void surface_transform_change_hack() override;
     [[nodiscard]] bool is_empty() const override;
     void graft(std::shared_ptr<Container> const&) override;
+    /// Readies a workspace that was emptied and set aside to be used as a new
+    /// workspace with [id], [num] and [name].
+    void recycle(uint32_t id, std::optional<int> num, std::optional<std::string> name);
+
     [[nodiscard]] uint32_t id() const override { return id_; }
     [[nodiscard]] std::optional<int> num() const override { return num_; }
     [[nodiscard]] nlohmann::json to_json(bool is_output_focused) const override;
+    void write_json(JsonWriter& writer, bool is_output_focused) const override;
     [[nodiscard]] std::optional<std::string> const& name() const override { return name_; }
     [[nodiscard]] std::string display_name() const override;
     [[nodiscard]] std::shared_ptr<ParentContainer> get_root() const override { return root; }
+    bool append_layout(LayoutTemplateNode const& layout) override;
+    [[nodiscard]] bool has_layout_slot_for(std::string const& app_id, std::string const& title) const override;
 
 private:
     struct MoveResult
@@ -89,6 +102,33 @@ private:
         std::shared_ptr<Container> node = nullptr;
     };
 
+    /// A layout template that is still waiting for some of its windows.
+    struct PendingLayout
+    {
+        LayoutTemplateNode layout;
+
+        /// The containers and windows that have been created for the nodes of
+        /// [layout], by their path from its root.
+        std::map<std::vector<size_t>, std::weak_ptr<ParentContainer>> containers;
+        std::map<std::vector<size_t>, std::weak_ptr<Container>> windows;
+
+        /// The slot that the window being placed is going into.
+        std::optional<std::vector<size_t>> placing;
+    };
+
+    /// Places the window of [requested_specification] into the first free slot of
+    /// the pending layout that it matches.
+    std::optional<AllocationHint> allocate_position_from_layout(
+        miral::ApplicationInfo const& app_info,
+        miral::WindowSpecification& requested_specification);
+
+    /// The first slot of [solution] that is free and matches [app_id] and [title].
+    [[nodiscard]] std::vector<LayoutTemplateSlot>::const_iterator find_free_slot(
+        LayoutTemplateSolution const& solution, std::string const& app_id, std::string const& title) const;
+
+    /// Gives every container and window of the pending layout its exact area.
+    void apply_pending_layout();
+
     OutputInterface* output;
     uint32_t id_;
     std::optional<int> num_;
@@ -100,6 +140,17 @@ private:
     std::shared_ptr<Config> config;
     std::weak_ptr<Container> last_selected_container;
     int config_handle = 0;
+    std::unique_ptr<PendingLayout> pending_layout;
+
+    /// While the workspace is hidden, the area that it will be laid out in once
+    /// it is shown again.
+    bool is_hidden = false;
+    std::optional<mir::geometry::Rectangle> deferred_area;
+
+    /// The neighbours that [neighbour] has found in each direction, which hold
+    /// until the layout changes after [neighbours_generation].
+    std::unordered_map<Container const*, std::array<std::optional<std::weak_ptr<LeafContainer>>, static_cast<size_t>(Direction::MAX)>> neighbours;
+    std::optional<uint64_t> neighbours_generation;
 
     /// Retrieves the container that is currently being used for layout
     std::shared_ptr<ParentContainer> get_layout_container();
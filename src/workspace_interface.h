@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "container.h"
 #include "direction.h"
+#include "function_ref.h"
 
 #include <glm/glm.hpp>
 #include <memory>
@@ -30,6 +31,8 @@ namespace miracle
 class OutputInterface;
 class Container;
 class ParentContainer;
+class LeafContainer;
+struct LayoutTemplateNode;
 
 struct AllocationHint
 {
@@ -63,9 +66,9 @@ public:
 
     virtual void transfer_pinned_windows_to(std::shared_ptr<WorkspaceInterface> const& other) = 0;
 
-    /// Iterates all containers on this workspace that represent a window until the predicate is satisfied.
-    /// Returns true if the predicate returned true.
-    virtual bool for_each_window(std::function<bool(std::shared_ptr<Container>)> const&) const = 0;
+    /// Calls [f] with each window on the workspace until it returns true. Returns
+    /// whether [f] returned true.
+    virtual bool for_each_window(FunctionRef<bool(std::shared_ptr<Container> const&)> f) const = 0;
 
     /// Creates a new floating tree on this workspace. The tree is empty by default
     /// and must be filled in by subsequent calls, lest it become a zombie tree with
@@ -76,6 +79,10 @@ public:
 
     virtual void select_first_window() = 0;
 
+    /// The leaf that the focus moves to from [from] in [direction], or nullptr if
+    /// there is none.
+    [[nodiscard]] virtual std::shared_ptr<LeafContainer> neighbour(Container& from, Direction direction) = 0;
+
     [[nodiscard]] virtual OutputInterface* get_output() const = 0;
 
     virtual void set_output(OutputInterface*) = 0;
@@ -84,15 +91,33 @@ public:
     virtual void workspace_transform_change_hack()
         = 0;
 
+    /// Like [workspace_transform_change_hack], but only updates the transforms of
+    /// the scene's surfaces. The render data is left to the caller.
+    [[deprecated("Do not use unless you have a very good reason to do so!")]]
+    virtual void surface_transform_change_hack()
+        = 0;
+
     [[nodiscard]] virtual bool is_empty() const = 0;
     virtual void graft(std::shared_ptr<Container> const&) = 0;
 
     [[nodiscard]] virtual uint32_t id() const = 0;
     [[nodiscard]] virtual std::optional<int> num() const = 0;
+    /// Returns the result of [write_json] as a document.
     [[nodiscard]] virtual nlohmann::json to_json(bool is_output_focused) const = 0;
+    /// Writes this workspace as a node of the i3 tree.
+    virtual void write_json(JsonWriter& writer, bool is_output_focused) const = 0;
     [[nodiscard]] virtual std::optional<std::string> const& name() const = 0;
     [[nodiscard]] virtual std::string display_name() const = 0;
     [[nodiscard]] virtual std::shared_ptr<ParentContainer> get_root() const = 0;
+
+    /// Reserves the tiled area of an empty workspace for the windows of [layout].
+    /// Windows that match its slots are placed straight into them as they open.
+    /// Returns false if the workspace already has tiled windows.
+    virtual bool append_layout(LayoutTemplateNode const& layout) = 0;
+
+    /// Whether a window with [app_id] and [title] would be placed into a free
+    /// slot of the layout that this workspace is waiting on.
+    [[nodiscard]] virtual bool has_layout_slot_for(std::string const& app_id, std::string const& title) const = 0;
 };
 }
 
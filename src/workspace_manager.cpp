@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "output_interface.h"
 #include "output_manager.h"
 #include "vector_helpers.h"
+#include <algorithm>
 #include <mir/log.h>
 
 using namespace mir::geometry;
@@ -71,6 +72,7 @@ bool WorkspaceManager::request_workspace(
     output_hint->advise_new_workspace({ .id = id,
         .num = num,
         .name = workspace_config.name });
+    register_workspace(*output_hint, id);
     registry->advise_created(id);
     request_focus(id);
     return true;
@@ -87,6 +89,7 @@ bool WorkspaceManager::request_workspace(
     uint32_t id = next_id++;
     output_hint->advise_new_workspace({ .id = id,
         .name = name });
+    register_workspace(*output_hint, id);
     request_focus(id);
     registry->advise_created(id);
     return true;
@@ -118,20 +121,11 @@ bool WorkspaceManager::request_next(OutputInterface* output)
     if (!active)
         return false;
 
-    auto const l = workspaces();
-    for (auto it = l.begin(); it != l.end(); it++)
-    {
-        if (*it == active)
-        {
-            it++;
-            if (it == l.end())
-                it = l.begin();
-
-            return focus_existing(*it, false);
-        }
-    }
+    auto const it = index_by_id.find(active->id());
+    if (it == index_by_id.end())
+        return false;
 
-    return false;
+    return focus_existing(ordered[(it->second + 1) % ordered.size()], false);
 }
 
 bool WorkspaceManager::request_prev(OutputInterface* output)
@@ -140,20 +134,11 @@ bool WorkspaceManager::request_prev(OutputInterface* output)
     if (!active)
         return false;
 
-    auto const l = workspaces();
-    for (auto it = l.rbegin(); it != l.rend(); it++)
-    {
-        if (*it == active)
-        {
-            it++;
-            if (it == l.rend())
-                it = l.rbegin();
-
-            return focus_existing(*it, false);
-        }
-    }
+    auto const it = index_by_id.find(active->id());
+    if (it == index_by_id.end())
+        return false;
 
-    return false;
+    return focus_existing(ordered[(it->second + ordered.size() - 1) % ordered.size()], false);
 }
 
 bool WorkspaceManager::request_back_and_forth()
@@ -217,6 +202,7 @@ bool WorkspaceManager::delete_workspace(uint32_t id)
     if (!w)
         return false;
 
+    unregister_workspace(*w);
     registry->advise_removed(id);
     auto* output = w->get_output();
     output->advise_workspace_deleted(*this, id);
@@ -255,68 +241,65 @@ bool WorkspaceManager::request_focus(uint32_t id)
 
 WorkspaceInterface* WorkspaceManager::workspace(int num) const
 {
-    for (auto const& output : output_manager->outputs())
-    {
-        for (auto const& workspace : output->get_workspaces())
-        {
-            if (workspace->num() == num)
-                return workspace.get();
-        }
-    }
-
-    return nullptr;
+    auto const it = id_by_num.find(num);
+    return it == id_by_num.end() ? nullptr : workspace(it->second);
 }
 
 WorkspaceInterface* WorkspaceManager::workspace(uint32_t id) const
 {
-    for (auto const& output : output_manager->outputs())
-    {
-        for (auto const& workspace : output->get_workspaces())
-        {
-            if (workspace->id() == id)
-                return workspace.get();
-        }
-    }
-
-    return nullptr;
+    auto const it = index_by_id.find(id);
+    return it == index_by_id.end() ? nullptr : ordered[it->second];
 }
 
 WorkspaceInterface* WorkspaceManager::workspace(std::string const& name) const
 {
-    for (auto const& output : output_manager->outputs())
+    auto const it = id_by_name.find(name);
+    return it == id_by_name.end() ? nullptr : workspace(it->second);
+}
+
+void WorkspaceManager::register_workspace(OutputInterface const& output, uint32_t id)
+{
+    auto const& output_workspaces = output.get_workspaces();
+    auto const it = std::ranges::find_if(output_workspaces, [&](auto const& w)
     {
-        for (auto const& workspace : output->get_workspaces())
-        {
-            if (workspace->name() == name)
-                return workspace.get();
-        }
+        return w->id() == id;
+    });
+    if (it == output_workspaces.end())
+    {
+        mir::log_error("register_workspace: output %d did not create workspace %d", output.id(), id);
+        return;
     }
 
-    return nullptr;
+    auto* const w = it->get();
+    insert_sorted(ordered, w, [](WorkspaceInterface const* a, WorkspaceInterface const* b)
+    {
+        if (a->num() && b->num())
+            return a->num().value() < b->num().value();
+        return a->num().has_value() && !b->num().has_value();
+    });
+
+    if (w->num())
+        id_by_num[w->num().value()] = id;
+    if (w->name())
+        id_by_name[w->name().value()] = id;
+    reindex();
 }
 
-std::vector<WorkspaceInterface const*> WorkspaceManager::workspaces() const
+void WorkspaceManager::unregister_workspace(WorkspaceInterface const& w)
 {
-    std::vector<WorkspaceInterface const*> result;
-    for (auto const& output : output_manager->outputs())
-    {
-        for (auto const& w : output->get_workspaces())
-        {
-            auto const* ptr = w.get();
-            insert_sorted(result, ptr, [](WorkspaceInterface const* a, WorkspaceInterface const* b)
-            {
-                if (a->num() && b->num())
-                    return a->num().value() < b->num().value();
-                else if (a->num())
-                    return true;
-                else if (b->num())
-                    return false;
-                else
-                    return true;
-            });
-        }
-    }
-    return result;
+    std::erase(ordered, &w);
+    if (w.num())
+        id_by_num.erase(w.num().value());
+    if (w.name())
+        id_by_name.erase(w.name().value());
+    reindex();
+}
+
+void WorkspaceManager::reindex()
+{
+    index_by_id.clear();
+    for (size_t i = 0; i < ordered.size(); i++)
+        index_by_id[ordered[i]->id()] = i;
 }
 
 void WorkspaceManager::move_workspace_to_output(uint32_t id, OutputInterface* hint)
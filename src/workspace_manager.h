@@ -25,6 +25,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <map>
 #include <memory>
 #include <miral/window_manager_tools.h>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace miracle
@@ -88,8 +90,9 @@ public:
     /// Returns the workspace with the provided [id], if any.
     WorkspaceInterface* workspace(uint32_t id) const;
 
-    /// Builds and returns a sorted array of all active workspaces.
-    std::vector<WorkspaceInterface const*> workspaces() const;
+    /// Returns every workspace in sorted order: numbered workspaces by number,
+    /// followed by the others in the order in which they were created.
+    [[nodiscard]] std::vector<WorkspaceInterface*> const& workspaces() const { return ordered; }
 
     /// Moves the workspace associated with [id] to the [hint].
     void move_workspace_to_output(uint32_t id, OutputInterface* hint);
@@ -105,6 +108,18 @@ private:
     WorkspaceInterface* workspace(int num) const;
     WorkspaceInterface* workspace(std::string const& name) const;
 
+    /// Adds the workspace with [id], which was just created on [output], to the registry.
+    void register_workspace(OutputInterface const& output, uint32_t id);
+    void unregister_workspace(WorkspaceInterface const&);
+    void reindex();
+
+    /// The registry of workspaces. The workspaces themselves are owned by their
+    /// outputs, and moving one between outputs leaves it at the same address.
+    std::vector<WorkspaceInterface*> ordered;
+    std::unordered_map<uint32_t, size_t> index_by_id;
+    std::unordered_map<int, uint32_t> id_by_num;
+    std::unordered_map<std::string, uint32_t> id_by_name;
+
     std::shared_ptr<WorkspaceObserverRegistrar> registry;
     std::shared_ptr<Config> config;
     std::shared_ptr<OutputManager> output_manager;
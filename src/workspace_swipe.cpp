@@ -0,0 +1,102 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "workspace_swipe.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace miracle;
+
+namespace
+{
+/// How far toward a side without a workspace the swipe gives, as a fraction of the
+/// distance that the fingers moved.
+constexpr float RESISTANCE = 0.2f;
+
+/// The weight of the latest update in the estimate of the velocity.
+constexpr float VELOCITY_SMOOTHING = 0.5f;
+
+/// Fingers that rest for this long have stopped, whatever their last speed was.
+constexpr auto REST_TIME = std::chrono::milliseconds(100);
+
+/// A release is judged by where the swipe would be after carrying on at its
+/// velocity for this long.
+constexpr float PROJECTION_SECONDS = 0.15f;
+
+/// The slope of an ease-out cubic curve at its start.
+constexpr float EASE_OUT_CUBIC_START_SLOPE = 3.f;
+constexpr float MIN_RELEASE_DURATION = 0.05f;
+}
+
+WorkspaceSwipe::WorkspaceSwipe(float width, bool has_previous, bool has_next) :
+    width { width },
+    has_previous { has_previous },
+    has_next { has_next }
+{
+}
+
+float WorkspaceSwipe::update(float delta, clock::time_point time)
+{
+    travelled += delta;
+    if (last_update)
+    {
+        auto const seconds = std::chrono::duration<float>(time - last_update.value()).count();
+        if (time - last_update.value() > REST_TIME)
+            velocity_ = 0.f;
+        if (seconds > 0.f)
+            velocity_ = VELOCITY_SMOOTHING * (delta / seconds) + (1.f - VELOCITY_SMOOTHING) * velocity_;
+    }
+
+    last_update = time;
+    return offset();
+}
+
+float WorkspaceSwipe::offset() const
+{
+    bool const has_neighbour = travelled > 0.f ? has_next : has_previous;
+    auto const limit = has_neighbour ? width : width * RESISTANCE;
+    auto const offset = has_neighbour ? travelled : travelled * RESISTANCE;
+    return std::clamp(offset, -limit, limit);
+}
+
+float WorkspaceSwipe::velocity(clock::time_point now) const
+{
+    if (!last_update || now - last_update.value() > REST_TIME)
+        return 0.f;
+    return velocity_;
+}
+
+int WorkspaceSwipe::landing(clock::time_point now) const
+{
+    auto const projected = offset() + velocity(now) * PROJECTION_SECONDS;
+    if (has_next && projected > width / 2)
+        return 1;
+    if (has_previous && projected < -width / 2)
+        return -1;
+    return 0;
+}
+
+float WorkspaceSwipe::release_duration(float distance, float velocity, float max_duration)
+{
+    auto const speed = std::abs(velocity);
+    if (speed <= 0.f)
+        return max_duration;
+
+    auto const duration = EASE_OUT_CUBIC_START_SLOPE * std::abs(distance) / speed;
+    return std::clamp(duration, std::min(MIN_RELEASE_DURATION, max_duration), max_duration);
+}
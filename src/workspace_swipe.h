@@ -0,0 +1,74 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_WORKSPACE_SWIPE_H
+#define MIRACLE_WM_WORKSPACE_SWIPE_H
+
+#include <chrono>
+#include <optional>
+
+namespace miracle
+{
+
+/// Follows a swipe across the workspaces of an output as the fingers move, and
+/// decides where it lands once they are lifted.
+///
+/// The offset is measured in pixels from the active workspace, and is positive
+/// toward the next workspace. It never goes further than one workspace, and
+/// only gives a little toward a side that has no workspace.
+class WorkspaceSwipe
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    /// [width] is the distance between two workspaces. [has_previous] and [has_next]
+    /// are whether the active workspace has a neighbour on that side.
+    WorkspaceSwipe(float width, bool has_previous, bool has_next);
+
+    /// Moves the swipe by [delta] pixels at [time] and returns the new offset.
+    float update(float delta, clock::time_point time = clock::now());
+
+    [[nodiscard]] float offset() const;
+
+    /// The speed of the fingers in pixels per second, positive toward the next
+    /// workspace. It is zero if the fingers have rested for a while.
+    [[nodiscard]] float velocity(clock::time_point now = clock::now()) const;
+
+    /// Where the swipe lands if it is released at [now]: -1 on the previous
+    /// workspace, 1 on the next one, or 0 back on the active one. A quick flick
+    /// carries over to the neighbour even if it has not yet moved halfway there.
+    [[nodiscard]] int landing(clock::time_point now = clock::now()) const;
+
+    /// The duration of an ease-out cubic animation that covers [distance] pixels
+    /// and starts out at [velocity] pixels per second, so that the animation picks
+    /// up where the fingers left off. It is never longer than [max_duration].
+    static float release_duration(float distance, float velocity, float max_duration);
+
+private:
+    float width;
+    bool has_previous;
+    bool has_next;
+
+    /// The sum of the deltas, before the offset is limited.
+    float travelled = 0.f;
+    float velocity_ = 0.f;
+    std::optional<clock::time_point> last_update;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_WORKSPACE_SWIPE_H
@@ -0,0 +1,110 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "xwayland_geometry.h"
+
+using namespace miracle;
+
+XwaylandGeometry::XwaylandGeometry(std::chrono::nanoseconds timeout) :
+    timeout { timeout }
+{
+}
+
+void XwaylandGeometry::track(void const* window, mir::geometry::Size size)
+{
+    windows.insert_or_assign(window, Window { .sent = size });
+}
+
+void XwaylandGeometry::remove(void const* window)
+{
+    windows.erase(window);
+}
+
+bool XwaylandGeometry::is_tracked(void const* window) const
+{
+    return windows.contains(window);
+}
+
+std::optional<mir::geometry::Size> XwaylandGeometry::request(
+    void const* window, mir::geometry::Size size, clock::time_point now)
+{
+    auto const it = windows.find(window);
+    if (it == windows.end())
+        return size;
+
+    // Going back to the size in flight, or staying at it, needs nothing to be sent
+    auto& entry = it->second;
+    if (size == entry.sent)
+    {
+        entry.queued.reset();
+        return std::nullopt;
+    }
+
+    if (entry.awaiting_frame && now - entry.sent_at < timeout)
+    {
+        entry.queued = size;
+        return std::nullopt;
+    }
+
+    entry.queued.reset();
+    entry.sent = size;
+    entry.sent_at = now;
+    entry.awaiting_frame = true;
+    return size;
+}
+
+std::optional<mir::geometry::Size> XwaylandGeometry::frame_posted(void const* window, clock::time_point now)
+{
+    auto const it = windows.find(window);
+    if (it == windows.end())
+        return std::nullopt;
+
+    auto& entry = it->second;
+    entry.awaiting_frame = false;
+    if (!entry.queued)
+        return std::nullopt;
+
+    entry.sent = entry.queued.value();
+    entry.sent_at = now;
+    entry.awaiting_frame = true;
+    entry.queued.reset();
+    return entry.sent;
+}
+
+bool XwaylandGeometry::is_awaiting_frame(void const* window) const
+{
+    auto const it = windows.find(window);
+    return it != windows.end() && it->second.awaiting_frame;
+}
+
+std::optional<mir::geometry::Size> XwaylandGeometry::sent(void const* window) const
+{
+    auto const it = windows.find(window);
+    if (it == windows.end())
+        return std::nullopt;
+
+    return it->second.sent;
+}
+
+std::optional<mir::geometry::Size> XwaylandGeometry::target(void const* window) const
+{
+    auto const it = windows.find(window);
+    if (it == windows.end())
+        return std::nullopt;
+
+    return it->second.queued ? it->second.queued : it->second.sent;
+}
@@ -0,0 +1,85 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_XWAYLAND_GEOMETRY_H
+#define MIRACLE_WM_XWAYLAND_GEOMETRY_H
+
+#include <chrono>
+#include <mir/geometry/size.h>
+#include <optional>
+#include <unordered_map>
+
+namespace miracle
+{
+
+/// Paces the sizes that are sent to Xwayland windows.
+///
+/// X11 clients are slow to answer a ConfigureNotify, so sending every intermediate
+/// size of a resize only queues up frames that the client draws long after they
+/// matter. Instead, each window has at most one size in flight. Until the client
+/// posts a frame in answer to it, newer sizes replace one another in a queue, and
+/// only the latest of them is sent once the client catches up. As a client posts at
+/// most one frame per refresh, a window is configured at most once per frame.
+///
+/// A window that has not answered within the timeout is sent the latest size
+/// anyway, so that a client which stops drawing cannot hold its size back forever.
+class XwaylandGeometry
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit XwaylandGeometry(std::chrono::nanoseconds timeout = std::chrono::milliseconds(250));
+
+    /// Starts pacing the sizes of [window], whose size is currently [size].
+    void track(void const* window, mir::geometry::Size size);
+    void remove(void const* window);
+    [[nodiscard]] bool is_tracked(void const* window) const;
+
+    /// Returns [size] if it may be sent to [window] now, in which case it is in
+    /// flight, or std::nullopt if it has been queued or is already on its way.
+    std::optional<mir::geometry::Size> request(
+        void const* window, mir::geometry::Size size, clock::time_point now = clock::now());
+
+    /// Called when [window] posts a frame, which answers the size in flight.
+    /// Returns the queued size, if there is one, which is now in flight in turn.
+    std::optional<mir::geometry::Size> frame_posted(void const* window, clock::time_point now = clock::now());
+
+    /// Whether a size has been sent to [window] that it has yet to answer.
+    [[nodiscard]] bool is_awaiting_frame(void const* window) const;
+
+    /// The size that [window] was last sent, which the surface is drawn at.
+    [[nodiscard]] std::optional<mir::geometry::Size> sent(void const* window) const;
+
+    /// The latest size requested for [window], whether it has been sent or is queued.
+    [[nodiscard]] std::optional<mir::geometry::Size> target(void const* window) const;
+
+private:
+    struct Window
+    {
+        mir::geometry::Size sent;
+        std::optional<mir::geometry::Size> queued;
+        bool awaiting_frame = false;
+        clock::time_point sent_at;
+    };
+
+    std::chrono::nanoseconds timeout;
+    std::unordered_map<void const*, Window> windows;
+};
+
+} // miracle
+
+#endif // MIRACLE_WM_XWAYLAND_GEOMETRY_H
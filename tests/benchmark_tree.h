@@ -0,0 +1,176 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLE_WM_BENCHMARK_TREE_H
+#define MIRACLE_WM_BENCHMARK_TREE_H
+
+#include "animator.h"
+#include "compositor_state.h"
+#include "leaf_container.h"
+#include "mock_output_factory.h"
+#include "output.h"
+#include "output_manager.h"
+#include "parent_container.h"
+#include "stub_configuration.h"
+#include "stub_session.h"
+#include "stub_surface.h"
+#include "stub_window_controller.h"
+#include "workspace.h"
+#include "workspace_manager.h"
+#include "workspace_observer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+namespace miracle
+{
+namespace benchmark
+{
+/// The number of calls to operator new so far, counted by allocation_counter.cpp.
+extern std::atomic<size_t> allocation_count;
+
+inline geom::Rectangle const OUTPUT_AREA { geom::Point(0, 0), geom::Size(3840, 2160) };
+
+/// Keeps the rectangles of the windows to itself, so that the cost of finding a
+/// window in the stub does not grow with the size of the tree.
+class BenchmarkWindowController : public StubWindowController
+{
+public:
+    using StubWindowController::StubWindowController;
+
+    void set_rectangle(miral::Window const&, geom::Rectangle const&, geom::Rectangle const&, bool) override { }
+    MirWindowState get_state(miral::Window const&) override { return mir_window_state_restored; }
+    void change_state(miral::Window const&, MirWindowState) override { }
+    void clip(miral::Window const&, geom::Rectangle const&) override { }
+    void noclip(miral::Window const&) override { }
+    void modify(miral::Window const&, miral::WindowSpecification const&) override { }
+};
+
+/// The time and the heap allocations that one operation costs on average.
+struct Measurement
+{
+    double nanoseconds_per_op;
+    double allocations_per_op;
+};
+
+template <typename F>
+Measurement measure(int ops, F const& f)
+{
+    auto const allocations_before = allocation_count.load(std::memory_order_relaxed);
+    auto const start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ops; i++)
+        f(i);
+    auto const elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    auto const allocations = allocation_count.load(std::memory_order_relaxed) - allocations_before;
+    return { elapsed / ops, static_cast<double>(allocations) / ops };
+}
+
+/// A tree of [leaf_count] windows on the workspace of its own output, nested
+/// [depth] containers deep.
+class Tree
+{
+public:
+    Tree(int leaf_count, int depth) :
+        config { std::make_shared<test::StubConfiguration>() },
+        state { std::make_shared<CompositorState>() },
+        window_controller { std::make_shared<BenchmarkWindowController>(pairs) },
+        output_manager { std::make_shared<OutputManager>(
+            std::make_unique<testing::NiceMock<test::MockOutputFactory>>()) },
+        workspace_manager { std::make_shared<WorkspaceManager>(
+            std::make_shared<WorkspaceObserverRegistrar>(), config, output_manager) },
+        output { "benchmark", 0, OUTPUT_AREA, state, config, window_controller, std::make_shared<Animator>() }
+    {
+        output.advise_new_workspace({ .id = 0, .num = 1 });
+        output.advise_workspace_active(*workspace_manager, 0);
+        workspace = output.active();
+
+        auto const fanout = std::max(2, static_cast<int>(std::ceil(std::pow(leaf_count, 1.0 / depth))));
+        auto const start = std::chrono::steady_clock::now();
+        auto const allocations_before = allocation_count.load(std::memory_order_relaxed);
+        build(workspace->get_root(), leaf_count, fanout, depth - 1, LayoutScheme::vertical);
+        creation = {
+            std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / leaves.size(),
+            static_cast<double>(allocation_count.load(std::memory_order_relaxed) - allocations_before) / leaves.size()
+        };
+    }
+
+    std::shared_ptr<ParentContainer> root() const { return workspace->get_root(); }
+
+    std::shared_ptr<test::StubConfiguration> config;
+    std::shared_ptr<CompositorState> state;
+    std::vector<StubWindowData> pairs;
+    std::shared_ptr<BenchmarkWindowController> window_controller;
+    std::shared_ptr<OutputManager> output_manager;
+    std::shared_ptr<WorkspaceManager> workspace_manager;
+    Output output;
+    WorkspaceInterface* workspace;
+    std::vector<std::shared_ptr<LeafContainer>> leaves;
+    std::vector<std::shared_ptr<test::StubSession>> sessions;
+    std::vector<std::shared_ptr<test::StubSurface>> surfaces;
+
+    /// The cost of [Workspace::create_container] per window while the tree was built.
+    Measurement creation;
+
+private:
+    std::shared_ptr<LeafContainer> create_leaf(std::shared_ptr<ParentContainer> const& parent)
+    {
+        miral::WindowSpecification spec;
+        miral::ApplicationInfo app_info;
+        auto hint = workspace->allocate_position(app_info, spec, { ContainerType::leaf, parent });
+
+        auto session = std::make_shared<test::StubSession>();
+        sessions.push_back(session);
+        auto surface = std::make_shared<test::StubSurface>();
+        surfaces.push_back(surface);
+
+        miral::Window window(session, surface);
+        miral::WindowInfo info(window, spec);
+        auto leaf = Container::as_leaf(workspace->create_container(info, hint));
+        pairs.push_back({ window, leaf });
+        state->add(leaf);
+        leaves.push_back(leaf);
+        return leaf;
+    }
+
+    /// Fills [parent] with up to [fanout] nodes. While [levels] remain, each node
+    /// is turned into a container of its own, split the other way, and filled in turn.
+    void build(std::shared_ptr<ParentContainer> const& parent, int leaf_count, int fanout, int levels, LayoutScheme scheme)
+    {
+        for (int i = 0; i < fanout && static_cast<int>(leaves.size()) < leaf_count; i++)
+        {
+            auto const leaf = create_leaf(parent);
+            if (levels == 0)
+                continue;
+
+            auto const child = parent->convert_to_parent(leaf);
+            child->set_layout(scheme);
+            build(
+                child,
+                leaf_count,
+                fanout,
+                levels - 1,
+                scheme == LayoutScheme::vertical ? LayoutScheme::horizontal : LayoutScheme::vertical);
+        }
+    }
+};
+}
+}
+
+#endif // MIRACLE_WM_BENCHMARK_TREE_H
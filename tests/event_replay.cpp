@@ -0,0 +1,344 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+/// Replays a recording made with --record-events as fast as possible, reporting
+/// the time that each kind of event costs. The windows, outputs and workspaces
+/// are the real ones, while the windows behind them are the stubs that the
+/// tests use, so the numbers measure the window management of the session.
+///
+/// Keyboard events only update the modifiers, as the stub configuration binds
+/// no keys. Commands that launch applications are skipped.
+///
+/// Usage: miracle-wm-replay <recording>
+
+#include "animator.h"
+#include "auto_restarting_launcher.h"
+#include "command_controller.h"
+#include "compositor_state.h"
+#include "container_index.h"
+#include "event_recording.h"
+#include "ipc_command.h"
+#include "ipc_command_executor.h"
+#include "mode_observer.h"
+#include "output_factory.h"
+#include "output_manager.h"
+#include "scratchpad.h"
+#include "stub_configuration.h"
+#include "stub_session.h"
+#include "stub_surface.h"
+#include "stub_window_controller.h"
+#include "window_observer.h"
+#include "workspace_manager.h"
+#include "workspace_observer.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <miral/external_client.h>
+#include <miral/runner.h>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+using namespace miracle;
+
+namespace
+{
+class StubCommandControllerInterface : public CommandControllerInterface
+{
+public:
+    void quit() override { }
+};
+
+/// Keeps the rectangles of the windows to itself, so that the replay measures
+/// the window management rather than the stub.
+class ReplayWindowController : public StubWindowController
+{
+public:
+    using StubWindowController::StubWindowController;
+
+    void set_rectangle(miral::Window const&, geom::Rectangle const&, geom::Rectangle const&, bool) override { }
+    MirWindowState get_state(miral::Window const&) override { return mir_window_state_restored; }
+    void change_state(miral::Window const&, MirWindowState) override { }
+    void clip(miral::Window const&, geom::Rectangle const&) override { }
+    void noclip(miral::Window const&) override { }
+    void modify(miral::Window const&, miral::WindowSpecification const&) override { }
+};
+
+constexpr std::array<std::string_view, std::variant_size_v<RecordedPayload>> event_names = {
+    "window opened",
+    "window closed",
+    "keyboard",
+    "pointer",
+    "ipc command",
+    "output"
+};
+
+struct EventCost
+{
+    size_t count = 0;
+    size_t skipped = 0;
+    std::chrono::nanoseconds total { 0 };
+    std::chrono::nanoseconds max { 0 };
+};
+
+/// Applies recorded events to a compositor made of the real layout engine and
+/// stubbed windows, in the way that [Policy] applies them.
+class Replay
+{
+public:
+    explicit Replay(miral::MirRunner& runner) :
+        config { std::make_shared<test::StubConfiguration>() },
+        state { std::make_shared<CompositorState>() },
+        window_controller { std::make_shared<ReplayWindowController>(pairs) },
+        animator { std::make_shared<Animator>() },
+        output_manager { std::make_shared<OutputManager>(
+            std::make_unique<MiralOutputFactory>(state, config, window_controller, animator)) },
+        workspace_manager { std::make_shared<WorkspaceManager>(
+            std::make_shared<WorkspaceObserverRegistrar>(), config, output_manager) },
+        command_controller { std::make_shared<CommandController>(
+            config,
+            mutex,
+            state,
+            window_controller,
+            workspace_manager,
+            std::make_shared<ModeObserverRegistrar>(),
+            std::make_shared<WindowObserverRegistrar>(),
+            std::make_unique<StubCommandControllerInterface>(),
+            std::make_shared<Scratchpad>(window_controller, output_manager),
+            output_manager) },
+        launcher { runner, external_client_launcher },
+        executor {
+            command_controller, output_manager, workspace_manager, state, launcher, window_controller,
+            std::make_shared<ContainerIndex>(window_controller)
+        }
+    {
+    }
+
+    /// Returns false if the event could not be applied.
+    bool apply(RecordedPayload const& payload)
+    {
+        std::lock_guard lock(mutex);
+        return std::visit([this](auto const& event) { return handle(event); }, payload);
+    }
+
+private:
+    bool handle(RecordedWindowOpened const& event)
+    {
+        auto const output = output_manager->focused();
+        if (!output)
+            return false;
+
+        miral::WindowSpecification spec;
+        spec.type() = static_cast<MirWindowType>(event.type);
+        spec.state() = static_cast<MirWindowState>(event.state);
+        spec.top_left() = event.area.top_left;
+        spec.size() = event.area.size;
+        miral::ApplicationInfo app_info;
+        auto const hint = output->allocate_position(app_info, spec, {});
+
+        auto const session = std::make_shared<test::StubSession>();
+        auto const surface = std::make_shared<test::StubSurface>();
+        miral::Window window(session, surface);
+        miral::WindowInfo info(window, spec);
+        auto const container = output->create_container(info, hint);
+        container->animation_handle(animator->register_animateable());
+        container->on_open();
+        state->add(container);
+
+        pairs.push_back({ window, container, event.area, static_cast<MirWindowState>(event.state) });
+        windows[event.id] = { session, surface, window };
+        return true;
+    }
+
+    bool handle(RecordedWindowClosed const& event)
+    {
+        auto const it = windows.find(event.id);
+        if (it == windows.end())
+            return false;
+
+        auto const container = window_controller->get_container(it->second.window);
+        if (!container)
+            return false;
+
+        if (auto const output = container->get_output())
+            output->delete_container(container);
+
+        animator->unregister_animateable(container->animation_handle());
+        container->animation_handle(none_animation_handle);
+        if (container == state->focused_container())
+            state->unfocus_container(container);
+        state->remove(container);
+
+        std::erase_if(pairs, [&](StubWindowData const& data) { return data.window == it->second.window; });
+        windows.erase(it);
+        return true;
+    }
+
+    bool handle(RecordedKeyboardEvent const& event)
+    {
+        state->modifiers = event.modifiers;
+        return true;
+    }
+
+    bool handle(RecordedPointerEvent const& event)
+    {
+        state->cursor_position = { event.x, event.y };
+        auto const output = output_manager->output_at(
+            geom::Point(static_cast<int>(event.x), static_cast<int>(event.y)));
+        if (!output)
+            return true;
+
+        if (output_manager->focused() != output)
+        {
+            if (output_manager->focused())
+                output_manager->unfocus(output_manager->focused()->id());
+            output_manager->focus(output->id());
+            if (auto const active = output->active())
+                workspace_manager->request_focus(active->id());
+        }
+
+        output->intersect_leaf(event.x, event.y, false);
+        return true;
+    }
+
+    bool handle(RecordedIpcCommand const& event)
+    {
+        auto const& result = command_cache.parse(event.command);
+        if (std::ranges::any_of(result.commands, [](IpcCommand const& command) { return command.type == IpcCommandType::exec; }))
+            return false;
+
+        executor.process(result);
+        return true;
+    }
+
+    bool handle(RecordedOutputEvent const& event)
+    {
+        AnimationSuppression suppression(*state);
+        CommitBatch batch(*state);
+        switch (event.change)
+        {
+        case RecordedOutputChange::created:
+            output_manager->create(event.name, event.id, event.area, *workspace_manager);
+            return true;
+        case RecordedOutputChange::updated:
+            output_manager->update(event.id, event.area);
+            return true;
+        case RecordedOutputChange::deleted:
+            return output_manager->remove(event.id, *workspace_manager);
+        }
+
+        return false;
+    }
+
+    struct StubWindow
+    {
+        std::shared_ptr<test::StubSession> session;
+        std::shared_ptr<test::StubSurface> surface;
+        miral::Window window;
+    };
+
+    WindowManagerMutex mutex;
+    std::vector<StubWindowData> pairs;
+    std::shared_ptr<test::StubConfiguration> config;
+    std::shared_ptr<CompositorState> state;
+    std::shared_ptr<ReplayWindowController> window_controller;
+    std::shared_ptr<Animator> animator;
+    std::shared_ptr<OutputManager> output_manager;
+    std::shared_ptr<WorkspaceManager> workspace_manager;
+    std::shared_ptr<CommandController> command_controller;
+    miral::ExternalClientLauncher external_client_launcher;
+    AutoRestartingLauncher launcher;
+    IpcCommandExecutor executor;
+    IpcCommandCache command_cache;
+    std::unordered_map<uint32_t, StubWindow> windows;
+};
+
+double to_us(std::chrono::nanoseconds duration)
+{
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+}
+
+int main(int argc, char const** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: miracle-wm-replay <recording>" << std::endl;
+        return 1;
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    EventReader reader(file);
+    if (!reader.valid())
+    {
+        std::cerr << argv[1] << " is not an event recording" << std::endl;
+        return 1;
+    }
+
+    // The launcher needs a runner, although nothing is ever launched
+    miral::MirRunner runner(1, argv);
+    Replay replay(runner);
+
+    std::array<EventCost, event_names.size()> costs;
+    std::chrono::microseconds recorded { 0 };
+    auto const start = std::chrono::steady_clock::now();
+    while (auto const event = reader.next())
+    {
+        auto& cost = costs[event->payload.index()];
+        auto const event_start = std::chrono::steady_clock::now();
+        auto const applied = replay.apply(event->payload);
+        auto const elapsed = std::chrono::steady_clock::now() - event_start;
+
+        cost.count++;
+        if (!applied)
+            cost.skipped++;
+        cost.total += elapsed;
+        cost.max = std::max<std::chrono::nanoseconds>(cost.max, elapsed);
+        recorded = event->time;
+    }
+    auto const elapsed = std::chrono::steady_clock::now() - start;
+
+    size_t total = 0;
+    for (auto const& cost : costs)
+        total += cost.count;
+
+    std::cout << std::format("replayed {} events, recorded over {:.1f}s, in {:.1f}ms\n",
+        total,
+        std::chrono::duration<double>(recorded).count(),
+        std::chrono::duration<double, std::milli>(elapsed).count());
+    for (size_t i = 0; i < costs.size(); i++)
+    {
+        auto const& cost = costs[i];
+        if (cost.count == 0)
+            continue;
+
+        std::cout << std::format("  {:<16}{:>10} events{:>8} skipped{:>12.1f} us/event{:>12.1f} us max\n",
+            event_names[i],
+            cost.count,
+            cost.skipped,
+            to_us(cost.total) / static_cast<double>(cost.count),
+            to_us(cost.max));
+    }
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+/// Counts the GL calls that miracle-wm makes while it renders. The benchmarks
+/// that link this are linked with --wrap for each function below (see
+/// MIRACLE_WRAPPED_GL_FUNCTIONS in CMakeLists.txt), so that calls to them reach
+/// the wrapper, which counts them and passes them on. Calls made within Mir are
+/// not counted, although those of the textures that the benchmarks stand in for
+/// Mir's are.
+
+#include <GLES2/gl2.h>
+#include <atomic>
+#include <cstddef>
+
+namespace miracle
+{
+namespace benchmark
+{
+std::atomic<size_t> gl_call_count = 0;
+}
+}
+
+#define MIRACLE_COUNT_GL_CALLS(ret, name, params, args)                                 \
+    ret __real_##name params;                                                           \
+    ret __wrap_##name params                                                            \
+    {                                                                                   \
+        miracle::benchmark::gl_call_count.fetch_add(1, std::memory_order_relaxed);     \
+        return __real_##name args;                                                      \
+    }
+
+extern "C"
+{
+MIRACLE_COUNT_GL_CALLS(void, glActiveTexture, (GLenum texture), (texture))
+MIRACLE_COUNT_GL_CALLS(void, glBindBuffer, (GLenum target, GLuint buffer), (target, buffer))
+MIRACLE_COUNT_GL_CALLS(void, glBindFramebuffer, (GLenum target, GLuint framebuffer), (target, framebuffer))
+MIRACLE_COUNT_GL_CALLS(void, glBindTexture, (GLenum target, GLuint texture), (target, texture))
+MIRACLE_COUNT_GL_CALLS(void, glBlendColor, (GLfloat r, GLfloat g, GLfloat b, GLfloat a), (r, g, b, a))
+MIRACLE_COUNT_GL_CALLS(void, glBlendFuncSeparate, (GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha), (src_rgb, dst_rgb, src_alpha, dst_alpha))
+MIRACLE_COUNT_GL_CALLS(void, glBufferData, (GLenum target, GLsizeiptr size, void const* data, GLenum usage), (target, size, data, usage))
+MIRACLE_COUNT_GL_CALLS(void, glClear, (GLbitfield mask), (mask))
+MIRACLE_COUNT_GL_CALLS(void, glClearColor, (GLfloat r, GLfloat g, GLfloat b, GLfloat a), (r, g, b, a))
+MIRACLE_COUNT_GL_CALLS(void, glClearStencil, (GLint s), (s))
+MIRACLE_COUNT_GL_CALLS(void, glColorMask, (GLboolean r, GLboolean g, GLboolean b, GLboolean a), (r, g, b, a))
+MIRACLE_COUNT_GL_CALLS(void, glDisable, (GLenum cap), (cap))
+MIRACLE_COUNT_GL_CALLS(void, glDisableVertexAttribArray, (GLuint index), (index))
+MIRACLE_COUNT_GL_CALLS(void, glDrawArrays, (GLenum mode, GLint first, GLsizei count), (mode, first, count))
+MIRACLE_COUNT_GL_CALLS(void, glEnable, (GLenum cap), (cap))
+MIRACLE_COUNT_GL_CALLS(void, glEnableVertexAttribArray, (GLuint index), (index))
+MIRACLE_COUNT_GL_CALLS(GLenum, glGetError, (void), ())
+MIRACLE_COUNT_GL_CALLS(void, glGetIntegerv, (GLenum pname, GLint* data), (pname, data))
+MIRACLE_COUNT_GL_CALLS(void, glScissor, (GLint x, GLint y, GLsizei width, GLsizei height), (x, y, width, height))
+MIRACLE_COUNT_GL_CALLS(void, glStencilFunc, (GLenum func, GLint ref, GLuint mask), (func, ref, mask))
+MIRACLE_COUNT_GL_CALLS(void, glStencilMask, (GLuint mask), (mask))
+MIRACLE_COUNT_GL_CALLS(void, glStencilOp, (GLenum fail, GLenum zfail, GLenum zpass), (fail, zfail, zpass))
+MIRACLE_COUNT_GL_CALLS(void, glTexImage2D, (GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, void const* pixels), (target, level, internal_format, width, height, border, format, type, pixels))
+MIRACLE_COUNT_GL_CALLS(void, glTexParameteri, (GLenum target, GLenum pname, GLint param), (target, pname, param))
+MIRACLE_COUNT_GL_CALLS(void, glUniform1f, (GLint location, GLfloat v0), (location, v0))
+MIRACLE_COUNT_GL_CALLS(void, glUniform1i, (GLint location, GLint v0), (location, v0))
+MIRACLE_COUNT_GL_CALLS(void, glUniform2f, (GLint location, GLfloat v0, GLfloat v1), (location, v0, v1))
+MIRACLE_COUNT_GL_CALLS(void, glUniform4f, (GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3), (location, v0, v1, v2, v3))
+MIRACLE_COUNT_GL_CALLS(void, glUniformMatrix3fv, (GLint location, GLsizei count, GLboolean transpose, GLfloat const* value), (location, count, transpose, value))
+MIRACLE_COUNT_GL_CALLS(void, glUniformMatrix4fv, (GLint location, GLsizei count, GLboolean transpose, GLfloat const* value), (location, count, transpose, value))
+MIRACLE_COUNT_GL_CALLS(void, glUseProgram, (GLuint program), (program))
+MIRACLE_COUNT_GL_CALLS(void, glVertexAttribPointer, (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, void const* pointer), (index, size, type, normalized, stride, pointer))
+MIRACLE_COUNT_GL_CALLS(void, glViewport, (GLint x, GLint y, GLsizei width, GLsizei height), (x, y, width, height))
+}
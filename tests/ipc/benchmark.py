@@ -0,0 +1,286 @@
+'''
+Benchmarks miracle-wm end to end on the headless virtual platform.
+
+The script starts a server with no configuration and a fixed virtual output,
+opens a number of Wayland clients in it and then runs a scripted scenario of
+IPC commands against it: switching workspaces, resizing, toggling tabbing
+and dragging a floating window across the output. The frame times, relayout
+counts, IPC latencies and CPU usage of the server are written to a JSON
+report whose keys are sorted, so that the reports of two commits can be
+diffed directly.
+
+Usage:
+    python benchmark.py [--clients N] [--iterations N] [--client-command CMD]
+                        [--output report.json]
+
+The server binary is taken from MIRACLE_IPC_TEST_BIN, as in the tests.
+'''
+
+import argparse
+import json
+import os
+import shlex
+import socket
+import struct
+import subprocess
+import sys
+import threading
+import time
+from typing import Any, Dict, List, Optional, Tuple
+
+from conftest import _create_server
+
+IPC_MAGIC = b"i3-ipc"
+IPC_HEADER = struct.Struct("=6sII")
+
+IPC_COMMAND = 0
+IPC_GET_TREE = 4
+IPC_GET_RENDER_STATS = 200
+IPC_GET_METRICS = 208
+IPC_GET_MEMORY = 209
+
+VIRTUAL_OUTPUT = "1280x720"
+WORKSPACES = 4
+
+
+class RawConnection:
+    '''
+    A blocking i3 IPC connection that can also send the miracle-specific
+    message types, which i3ipc does not know about.
+    '''
+
+    def __init__(self, path: str) -> None:
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.sock.connect(path)
+
+    def close(self) -> None:
+        self.sock.close()
+
+    def request(self, message_type: int, payload: str = "") -> Tuple[Any, float]:
+        '''Returns the decoded reply and the time to receive it in milliseconds.'''
+        data = payload.encode("utf-8")
+        start = time.perf_counter()
+        self.sock.sendall(IPC_HEADER.pack(IPC_MAGIC, len(data), message_type) + data)
+        header = self._read(IPC_HEADER.size)
+        magic, length, _ = IPC_HEADER.unpack(header)
+        if magic != IPC_MAGIC:
+            raise RuntimeError("Unexpected reply from the IPC socket")
+        body = self._read(length)
+        latency = (time.perf_counter() - start) * 1000
+        return (json.loads(body) if body else None, latency)
+
+    def _read(self, size: int) -> bytes:
+        data = b""
+        while len(data) < size:
+            chunk = self.sock.recv(size - len(data))
+            if not chunk:
+                raise RuntimeError("The IPC socket was closed")
+            data += chunk
+        return data
+
+
+class Recorder:
+    '''Collects the latency of each IPC request under the step that sent it.'''
+
+    def __init__(self, conn: RawConnection) -> None:
+        self.conn = conn
+        self.latencies: Dict[str, List[float]] = {}
+
+    def command(self, step: str, command: str) -> None:
+        reply, latency = self.conn.request(IPC_COMMAND, command)
+        self.latencies.setdefault(step, []).append(latency)
+        if reply and not all(result.get("success", False) for result in reply):
+            print(f"Command '{command}' failed: {reply}", file=sys.stderr)
+
+    def query(self, step: str, message_type: int) -> Any:
+        reply, latency = self.conn.request(message_type)
+        self.latencies.setdefault(step, []).append(latency)
+        return reply
+
+
+def percentile(samples: List[float], p: float) -> float:
+    if not samples:
+        return 0
+    ordered = sorted(samples)
+    return ordered[min(len(ordered) - 1, int(p * len(ordered)))]
+
+
+def summarize(samples: List[float]) -> Dict[str, Any]:
+    return {
+        "count": len(samples),
+        "p50_ms": round(percentile(samples, 0.5), 3),
+        "p95_ms": round(percentile(samples, 0.95), 3),
+        "p99_ms": round(percentile(samples, 0.99), 3),
+        "max_ms": round(max(samples), 3) if samples else 0,
+    }
+
+
+def count_windows(node: Dict[str, Any]) -> int:
+    count = 1 if node.get("pid") else 0
+    for child in node.get("nodes", []) + node.get("floating_nodes", []):
+        count += count_windows(child)
+    return count
+
+
+def process_usage(pid: int) -> Dict[str, float]:
+    '''Reads the CPU time and peak resident size of [pid] from /proc.'''
+    with open(f"/proc/{pid}/stat") as f:
+        # The command name may contain spaces, so the fields are counted from its end.
+        fields = f.read().rsplit(")", 1)[1].split()
+    ticks = os.sysconf("SC_CLK_TCK")
+    usage = {
+        "cpu_user_s": int(fields[11]) / ticks,
+        "cpu_system_s": int(fields[12]) / ticks,
+        "peak_rss_kb": 0,
+    }
+    with open(f"/proc/{pid}/status") as f:
+        for line in f:
+            if line.startswith("VmHWM:"):
+                usage["peak_rss_kb"] = int(line.split()[1])
+    return usage
+
+
+def wait_for_socket(process: subprocess.Popen) -> str:
+    to_find = "Listening to IPC socket on path: "
+    assert process.stdout is not None
+    for line in iter(process.stdout.readline, b''):
+        data = line.decode("utf-8").strip()
+        if to_find in data:
+            # Keep reading the log so that the server never blocks on a full pipe.
+            threading.Thread(target=lambda: process.stdout.read(), daemon=True).start()
+            return data[data.index(to_find) + len(to_find):].strip()
+    raise RuntimeError("miracle-wm exited before opening its IPC socket")
+
+
+def wait_for_windows(conn: RawConnection, count: int, timeout: float) -> bool:
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        tree, _ = conn.request(IPC_GET_TREE)
+        if count_windows(tree) >= count:
+            return True
+        time.sleep(0.05)
+    return False
+
+
+def counter_deltas(before: Dict[str, Any], after: Dict[str, Any]) -> Dict[str, int]:
+    return {name: value - before["counters"].get(name, 0) for name, value in after["counters"].items()}
+
+
+def open_clients(recorder: Recorder, env: Dict[str, str], command: List[str], count: int) -> List[subprocess.Popen]:
+    clients = []
+    for i in range(count):
+        # Spread the clients over the workspaces so that switching has work to do.
+        recorder.command("open_windows", f"workspace number {i % WORKSPACES + 1}")
+        clients.append(subprocess.Popen(command, env=env, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL))
+        if not wait_for_windows(recorder.conn, i + 1, timeout=10):
+            raise RuntimeError(f"Client {i + 1} did not map a window")
+    return clients
+
+
+def run_scenario(recorder: Recorder, iterations: int) -> None:
+    for _ in range(iterations):
+        for workspace in range(1, WORKSPACES + 1):
+            recorder.command("switch_workspace", f"workspace number {workspace}")
+
+        for amount in (50, -50, 50, -50):
+            direction = "grow" if amount > 0 else "shrink"
+            recorder.command("resize", f"resize {direction} width {abs(amount)} px")
+            recorder.command("resize", f"resize {direction} height {abs(amount)} px")
+
+        recorder.command("toggle_tabbing", "layout tabbed")
+        recorder.command("toggle_tabbing", "focus right")
+        recorder.command("toggle_tabbing", "layout toggle split")
+
+        recorder.command("drag", "floating enable")
+        for step in range(20):
+            recorder.command("drag", f"move position {100 + step * 20} {100 + step * 10}")
+        recorder.command("drag", "floating disable")
+
+        recorder.query("get_tree", IPC_GET_TREE)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--clients", type=int, default=8, help="number of Wayland clients to open")
+    parser.add_argument("--iterations", type=int, default=20, help="number of times to run the scenario")
+    parser.add_argument("--client-command", default="foot", help="the command that opens one client")
+    parser.add_argument("--output", default="-", help="where to write the report, or - for stdout")
+    args = parser.parse_args()
+
+    process, env = _create_server([
+        '--platform-display-libs', 'mir:virtual',
+        '--virtual-output', VIRTUAL_OUTPUT,
+        '--no-config', '1'])
+    clients: List[subprocess.Popen] = []
+    conn: Optional[RawConnection] = None
+    try:
+        conn = RawConnection(wait_for_socket(process))
+        recorder = Recorder(conn)
+        start_usage = process_usage(process.pid)
+        start_metrics, _ = conn.request(IPC_GET_METRICS)
+
+        clients = open_clients(recorder, env, shlex.split(args.client_command), args.clients)
+        opened_metrics, _ = conn.request(IPC_GET_METRICS)
+
+        start = time.perf_counter()
+        run_scenario(recorder, args.iterations)
+        elapsed = time.perf_counter() - start
+
+        end_metrics, _ = conn.request(IPC_GET_METRICS)
+        render_stats, _ = conn.request(IPC_GET_RENDER_STATS)
+        memory, _ = conn.request(IPC_GET_MEMORY)
+        end_usage = process_usage(process.pid)
+
+        all_latencies = [latency for samples in recorder.latencies.values() for latency in samples]
+        cpu_seconds = (end_usage["cpu_user_s"] + end_usage["cpu_system_s"]
+                       - start_usage["cpu_user_s"] - start_usage["cpu_system_s"])
+        report = {
+            "config": {
+                "clients": args.clients,
+                "iterations": args.iterations,
+                "client_command": args.client_command,
+                "virtual_output": VIRTUAL_OUTPUT,
+            },
+            "ipc_latency": {
+                "all": summarize(all_latencies),
+                "steps": {step: summarize(samples) for step, samples in recorder.latencies.items()},
+            },
+            "counters": {
+                "open_windows": counter_deltas(start_metrics, opened_metrics),
+                "scenario": counter_deltas(opened_metrics, end_metrics),
+            },
+            "frame_time_ms": [
+                {
+                    "rect": output.get("rect"),
+                    "frames": output.get("frames"),
+                    "cpu": output.get("cpu_time_ms"),
+                    "gpu": output.get("gpu_time_ms"),
+                }
+                for output in render_stats
+            ],
+            "cpu": {
+                "seconds": round(cpu_seconds, 3),
+                "scenario_utilization": round(cpu_seconds / elapsed, 3) if elapsed > 0 else 0,
+                "peak_rss_kb": end_usage["peak_rss_kb"],
+            },
+            "memory": memory,
+        }
+    finally:
+        if conn:
+            conn.close()
+        for client in clients:
+            client.terminate()
+        process.terminate()
+        process.wait()
+
+    text = json.dumps(report, indent=2, sort_keys=True)
+    if args.output == "-":
+        print(text)
+    else:
+        with open(args.output, "w") as f:
+            f.write(text + "\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
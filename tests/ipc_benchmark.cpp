@@ -0,0 +1,456 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+/// Drives a real [Ipc] with many concurrent clients, reporting the latency and
+/// throughput of its replies. The compositor behind it is built from the stubs
+/// and mocks that the tests use, so the numbers measure the IPC layer itself.
+///
+/// The cost of serializing the reply to IPC_GET_TREE is reported on its own,
+/// on a real tree of [--tree-windows] windows.
+///
+/// Usage: miracle-wm-ipc-benchmark [--clients N] [--subscribers N] [--requests N] [--tree-windows N]
+
+#include "animator.h"
+#include "auto_restarting_launcher.h"
+#include "benchmark_tree.h"
+#include "command_controller.h"
+#include "compositor_state.h"
+#include "container_index.h"
+#include "ipc.h"
+#include "ipc_command_executor.h"
+#include "mock_output_factory.h"
+#include "mock_window_controller.h"
+#include "mode_observer.h"
+#include "output_manager.h"
+#include "scratchpad.h"
+#include "stub_configuration.h"
+#include "window_observer.h"
+#include "workspace_manager.h"
+#include "workspace_observer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <iostream>
+#include <miral/external_client.h>
+#include <miral/runner.h>
+#include <mir/server_action_queue.h>
+#include <mutex>
+#include <set>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace miracle;
+
+namespace
+{
+class StubCommandControllerInterface : public CommandControllerInterface
+{
+public:
+    void quit() override { }
+};
+
+/// Runs server actions on a thread of its own, standing in for the main loop.
+class ThreadedServerActionQueue : public mir::ServerActionQueue
+{
+public:
+    ThreadedServerActionQueue() :
+        thread(&ThreadedServerActionQueue::run, this)
+    {
+    }
+
+    ~ThreadedServerActionQueue() override
+    {
+        {
+            std::lock_guard lock(mutex);
+            running = false;
+        }
+        cv.notify_all();
+        thread.join();
+    }
+
+    void enqueue(void const* owner, mir::ServerAction const& action) override
+    {
+        {
+            std::lock_guard lock(mutex);
+            if (paused.contains(owner))
+                return;
+            actions.push_back({ owner, action });
+        }
+        cv.notify_one();
+    }
+
+    void enqueue_with_guaranteed_execution(mir::ServerAction const& action) override
+    {
+        enqueue(nullptr, action);
+    }
+
+    void pause_processing_for(void const* owner) override
+    {
+        {
+            std::lock_guard lock(mutex);
+            paused.insert(owner);
+            std::erase_if(actions, [owner](auto const& pending)
+            { return pending.first == owner; });
+        }
+
+        // Wait out an action of [owner] that may be running right now.
+        std::lock_guard execution_lock(execution_mutex);
+    }
+
+    void resume_processing_for(void const* owner) override
+    {
+        std::lock_guard lock(mutex);
+        paused.erase(owner);
+    }
+
+private:
+    void run()
+    {
+        while (true)
+        {
+            std::unique_lock lock(mutex);
+            cv.wait(lock, [this]()
+            { return !running || !actions.empty(); });
+            if (!running)
+                return;
+
+            std::lock_guard execution_lock(execution_mutex);
+            auto [owner, action] = std::move(actions.front());
+            actions.pop_front();
+            lock.unlock();
+            action();
+        }
+    }
+
+    std::mutex mutex;
+    std::mutex execution_mutex;
+    std::condition_variable cv;
+    std::deque<std::pair<void const*, mir::ServerAction>> actions;
+    std::set<void const*> paused;
+    bool running = true;
+    std::thread thread;
+};
+
+/// A blocking i3 IPC client.
+class BenchmarkClient
+{
+public:
+    explicit BenchmarkClient(std::string const& path) :
+        fd { socket(AF_UNIX, SOCK_STREAM, 0) }
+    {
+        sockaddr_un address {};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1)
+        {
+            std::cerr << "Unable to connect to " << path << ": " << strerror(errno) << std::endl;
+            exit(1);
+        }
+    }
+
+    ~BenchmarkClient()
+    {
+        close(fd);
+    }
+
+    void send(uint32_t type, std::string_view payload) const
+    {
+        auto const frame = IpcWriteQueue::frame(type, payload);
+        write_all(frame->data(), frame->size());
+    }
+
+    /// Reads the next message, returning false once the socket is closed.
+    bool receive(uint32_t& type, std::string& payload)
+    {
+        char header[IpcWriteQueue::header_size];
+        if (!read_all(header, sizeof(header)))
+            return false;
+
+        uint32_t length;
+        memcpy(&length, header + 6, sizeof(length));
+        memcpy(&type, header + 10, sizeof(type));
+        payload.resize(length);
+        if (!read_all(payload.data(), length))
+            return false;
+
+        bytes_received += sizeof(header) + length;
+        return true;
+    }
+
+    /// Stops a [receive] that is blocked on another thread.
+    void shutdown() const
+    {
+        ::shutdown(fd, SHUT_RDWR);
+    }
+
+    size_t bytes_received = 0;
+
+private:
+    void write_all(char const* data, size_t size) const
+    {
+        while (size > 0)
+        {
+            auto const written = write(fd, data, size);
+            if (written <= 0)
+            {
+                std::cerr << "Unable to write to the IPC socket: " << strerror(errno) << std::endl;
+                exit(1);
+            }
+            data += written;
+            size -= written;
+        }
+    }
+
+    bool read_all(char* data, size_t size) const
+    {
+        while (size > 0)
+        {
+            auto const count = read(fd, data, size);
+            if (count <= 0)
+                return false;
+            data += count;
+            size -= count;
+        }
+        return true;
+    }
+
+    int fd;
+};
+
+struct Options
+{
+    int clients = 8;
+    int subscribers = 4;
+    int requests = 2000;
+    int tree_windows = 200;
+};
+
+Options parse_options(int argc, char const** argv)
+{
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string_view const name = argv[i];
+        int const value = std::atoi(argv[i + 1]);
+        if (name == "--clients")
+            options.clients = value;
+        else if (name == "--subscribers")
+            options.subscribers = value;
+        else if (name == "--requests")
+            options.requests = value;
+        else if (name == "--tree-windows")
+            options.tree_windows = value;
+        else
+            std::cerr << "Ignoring unknown option: " << name << std::endl;
+    }
+
+    return options;
+}
+
+/// Reports the time and the allocations that it takes to write the tree of an
+/// output, as IPC_GET_TREE does. The first write builds the JSON of every
+/// container, while the later ones reuse the JSON of those that did not change.
+void report_tree_serialization(int windows)
+{
+    benchmark::Tree tree(windows, 3);
+    int const iterations = 200;
+    size_t bytes = 0;
+    auto const write = [&](int)
+    {
+        std::string serialized;
+        JsonWriter writer(serialized);
+        tree.output.write_json(writer, true);
+        bytes = serialized.size();
+    };
+
+    auto const cold = benchmark::measure(1, write);
+    auto const warm = benchmark::measure(iterations, write);
+    std::cout << std::format(
+        "IPC_GET_TREE with {} windows ({} bytes):\n"
+        "  first: {:.1f}us, {:.0f} allocations\n"
+        "  cached: {:.1f}us, {:.1f} allocations\n",
+        tree.leaves.size(), bytes,
+        cold.nanoseconds_per_op / 1000, cold.allocations_per_op,
+        warm.nanoseconds_per_op / 1000, warm.allocations_per_op);
+}
+
+double percentile(std::vector<double> const& sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+}
+
+int main(int argc, char const** argv)
+{
+    auto const options = parse_options(argc, argv);
+    report_tree_serialization(options.tree_windows);
+
+    auto const socket_path = std::format("/tmp/miracle-wm-ipc-benchmark-{}.sock", getpid());
+    setenv("SWAYSOCK", socket_path.c_str(), 1);
+
+    miral::MirRunner runner(argc, argv);
+    miral::ExternalClientLauncher external_client_launcher;
+    AutoRestartingLauncher launcher(runner, external_client_launcher);
+
+    WindowManagerMutex mutex;
+    auto const config = std::make_shared<test::StubConfiguration>();
+    auto const state = std::make_shared<CompositorState>();
+    auto const window_controller = std::make_shared<testing::NiceMock<test::MockWindowController>>();
+    auto const output_manager = std::make_shared<OutputManager>(
+        std::make_unique<testing::NiceMock<test::MockOutputFactory>>());
+    auto const workspace_manager = std::make_shared<WorkspaceManager>(
+        std::make_shared<WorkspaceObserverRegistrar>(), config, output_manager);
+    auto const command_controller = std::make_shared<CommandController>(
+        config,
+        mutex,
+        state,
+        window_controller,
+        workspace_manager,
+        std::make_shared<ModeObserverRegistrar>(),
+        std::make_shared<WindowObserverRegistrar>(),
+        std::make_unique<StubCommandControllerInterface>(),
+        std::make_shared<Scratchpad>(window_controller, output_manager),
+        output_manager);
+
+    auto const server_action_queue = std::make_shared<ThreadedServerActionQueue>();
+    auto ipc = std::make_unique<Ipc>(
+        server_action_queue,
+        command_controller,
+        std::make_unique<IpcCommandExecutor>(
+            command_controller, output_manager, workspace_manager, state, launcher, window_controller,
+            std::make_shared<ContainerIndex>(window_controller)),
+        config,
+        std::make_shared<Animator>());
+
+    // Subscribers read every event that the load generates, as a bar would.
+    std::vector<std::unique_ptr<BenchmarkClient>> subscribers;
+    std::vector<std::thread> subscriber_threads;
+    std::atomic<size_t> events_received = 0;
+    for (int i = 0; i < options.subscribers; i++)
+    {
+        auto& subscriber = subscribers.emplace_back(std::make_unique<BenchmarkClient>(socket_path));
+        subscriber->send(IPC_SUBSCRIBE, R"(["tick", "window", "workspace"])");
+        subscriber_threads.emplace_back([&subscriber = *subscriber, &events_received]()
+        {
+            uint32_t type;
+            std::string payload;
+            while (subscriber.receive(type, payload))
+            {
+                if (type & (1u << 31))
+                    events_received++;
+            }
+        });
+    }
+
+    // Each client has one request in flight at a time, so that the time to its
+    // reply is the latency that a client would see.
+    std::vector<std::vector<double>> latencies(options.clients);
+    std::vector<size_t> bytes_received(options.clients);
+    std::vector<std::thread> client_threads;
+    auto const start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.clients; i++)
+    {
+        client_threads.emplace_back([&, i]()
+        {
+            BenchmarkClient client(socket_path);
+            latencies[i].reserve(options.requests);
+            uint32_t type;
+            std::string payload;
+            for (int j = 0; j < options.requests; j++)
+            {
+                auto const request_start = std::chrono::steady_clock::now();
+                switch (j % 3)
+                {
+                case 0:
+                    client.send(IPC_GET_TREE, "");
+                    break;
+                case 1:
+                    client.send(IPC_COMMAND, "nop");
+                    break;
+                case 2:
+                    client.send(IPC_SEND_TICK, "benchmark");
+                    break;
+                }
+
+                if (!client.receive(type, payload))
+                {
+                    std::cerr << "Client " << i << " was disconnected" << std::endl;
+                    break;
+                }
+
+                latencies[i].push_back(std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - request_start)
+                        .count());
+            }
+
+            bytes_received[i] = client.bytes_received;
+        });
+    }
+
+    for (auto& thread : client_threads)
+        thread.join();
+    auto const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::string ipc_stats;
+    {
+        BenchmarkClient client(socket_path);
+        uint32_t type;
+        client.send(IPC_GET_IPC_STATS, "");
+        client.receive(type, ipc_stats);
+    }
+
+    for (auto const& subscriber : subscribers)
+        subscriber->shutdown();
+    for (auto& thread : subscriber_threads)
+        thread.join();
+
+    std::vector<double> all_latencies;
+    for (auto const& client_latencies : latencies)
+        all_latencies.insert(all_latencies.end(), client_latencies.begin(), client_latencies.end());
+    std::sort(all_latencies.begin(), all_latencies.end());
+
+    auto const events = events_received.load();
+    size_t total_bytes = 0;
+    for (auto const bytes : bytes_received)
+        total_bytes += bytes;
+    for (auto const& subscriber : subscribers)
+        total_bytes += subscriber->bytes_received;
+
+    std::cout << "clients: " << options.clients << ", subscribers: " << options.subscribers
+              << ", requests per client: " << options.requests << "\n"
+              << "replies: " << all_latencies.size() << " in " << seconds << "s ("
+              << all_latencies.size() / seconds << " per second)\n"
+              << "events received: " << events << " (" << events / seconds << " per second)\n"
+              << "latency: p50 " << percentile(all_latencies, 0.5) << "us, p99 "
+              << percentile(all_latencies, 0.99) << "us, max "
+              << (all_latencies.empty() ? 0 : all_latencies.back()) << "us\n"
+              << "bytes copied to clients: " << total_bytes << " (" << total_bytes / seconds / 1e6 << " MB/s)\n"
+              << "ipc stats: " << ipc_stats << std::endl;
+
+    ipc.reset();
+    return 0;
+}
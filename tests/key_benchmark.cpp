@@ -0,0 +1,117 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+/// Times the lookup that every key press goes through before it reaches a
+/// client, reporting the time and the number of heap allocations per keystroke.
+/// Keys that are typed are timed apart from those that are bound to a command.
+///
+/// Usage: miracle-wm-key-benchmark [--keystrokes N]
+
+#include "benchmark_tree.h"
+#include "config.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <miral/runner.h>
+#include <string_view>
+
+using namespace miracle;
+using namespace miracle::benchmark;
+
+namespace
+{
+struct Options
+{
+    int keystrokes = 1'000'000;
+};
+
+Options parse_options(int argc, char const** argv)
+{
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string_view const name = argv[i];
+        int const value = std::atoi(argv[i + 1]);
+        if (name == "--keystrokes")
+            options.keystrokes = value;
+        else
+            std::cerr << "Ignoring unknown option: " << name << std::endl;
+    }
+
+    return options;
+}
+
+void report(std::string_view name, Measurement const& measurement)
+{
+    std::cout << std::format("  {:<28}{:>14.1f} ns/op{:>12.1f} allocs/op\n",
+        name, measurement.nanoseconds_per_op, measurement.allocations_per_op);
+}
+
+/// Does with a [KeyMatch] what the policy does with it, short of running the
+/// commands, and returns whether the key was bound.
+bool dispatch(KeyMatch const& match, size_t& commands)
+{
+    if (match.empty())
+        return false;
+
+    if (match.custom_key_command)
+        commands++;
+    else
+        commands += match.default_key_commands.size();
+    return true;
+}
+}
+
+int main(int argc, char const** argv)
+{
+    auto const options = parse_options(argc, argv);
+
+    // An empty file leaves the default bindings in place
+    auto const path = std::filesystem::temp_directory_path() / "miracle-wm-key-benchmark.yaml";
+    std::ofstream(path, std::ofstream::trunc).close();
+
+    miral::MirRunner runner(argc, argv);
+    FilesystemConfiguration config(runner, path.string(), true);
+    auto const primary = config.get_primary_modifier();
+
+    // The letters of the top row, typed in turn without a modifier
+    static int const typed_keys[] = { KEY_Q, KEY_W, KEY_E, KEY_R, KEY_T, KEY_Y, KEY_U, KEY_I, KEY_O, KEY_P };
+    static int const bound_keys[] = { KEY_H, KEY_J, KEY_K, KEY_L, KEY_1, KEY_2, KEY_3, KEY_F };
+
+    size_t commands = 0;
+    size_t bound = 0;
+    std::cout << std::format("keystrokes: {}\n", options.keystrokes);
+    report("typed", measure(options.keystrokes, [&](int i)
+    {
+        auto const key = typed_keys[i % std::size(typed_keys)];
+        bound += dispatch(config.match_key(mir_keyboard_action_down, key, mir_input_event_modifier_none), commands);
+    }));
+
+    report("bound", measure(options.keystrokes, [&](int i)
+    {
+        auto const key = bound_keys[i % std::size(bound_keys)];
+        bound += dispatch(config.match_key(mir_keyboard_action_down, key, primary), commands);
+    }));
+
+    // Keeps the lookups from being optimized away
+    std::cout << std::format("  bound keystrokes: {}, commands: {}\n", bound, commands);
+    std::filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,127 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+/// Times the tree operations of the layout engine on generated trees, reporting
+/// the time and the number of heap allocations that each operation costs. The
+/// trees are real [Workspace]s on a real [Output], while the windows behind them
+/// are the stubs that the tests use.
+///
+/// Usage: miracle-wm-layout-benchmark [--iterations N]
+
+#include "benchmark_tree.h"
+
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <random>
+#include <string_view>
+
+using namespace miracle;
+using namespace miracle::benchmark;
+
+namespace
+{
+struct Options
+{
+    int iterations = 200;
+};
+
+Options parse_options(int argc, char const** argv)
+{
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string_view const name = argv[i];
+        int const value = std::atoi(argv[i + 1]);
+        if (name == "--iterations")
+            options.iterations = value;
+        else
+            std::cerr << "Ignoring unknown option: " << name << std::endl;
+    }
+
+    return options;
+}
+
+void report(std::string_view name, Measurement const& measurement)
+{
+    std::cout << std::format("  {:<28}{:>14.1f} ns/op{:>12.1f} allocs/op\n",
+        name, measurement.nanoseconds_per_op, measurement.allocations_per_op);
+}
+
+void run(int leaf_count, int depth, int iterations)
+{
+    Tree tree(leaf_count, depth);
+    std::cout << std::format("leaves: {}, depth: {}\n", tree.leaves.size(), depth);
+    report("Workspace::create_container", tree.creation);
+
+    auto const root = tree.root();
+    report("ParentContainer::relayout", measure(iterations, [&](int)
+    {
+        root->relayout();
+    }));
+
+    report("ParentContainer::swap_nodes", measure(iterations, [&](int)
+    {
+        root->swap_nodes(root->at(0), root->at(root->num_nodes() - 1));
+    }));
+
+    // Every layout is visited in turn, so any multiple of four leaves the root as it was.
+    report("ParentContainer::toggle_layout", measure(iterations - iterations % 4, [&](int)
+    {
+        root->toggle_layout(true);
+    }));
+
+    size_t windows_visited = 0;
+    report("Workspace::for_each_window", measure(iterations, [&](int)
+    {
+        tree.workspace->for_each_window([&](std::shared_ptr<Container> const&)
+        {
+            windows_visited++;
+            return false;
+        });
+    }));
+
+    std::minstd_rand random;
+    std::uniform_real_distribution<float> x(0, static_cast<float>(OUTPUT_AREA.size.width.as_int()));
+    std::uniform_real_distribution<float> y(0, static_cast<float>(OUTPUT_AREA.size.height.as_int()));
+    report("Output::intersect_leaf", measure(iterations, [&](int)
+    {
+        tree.output.intersect_leaf(x(random), y(random), false);
+    }));
+
+    // Moving back and forth keeps the leaf near where it started.
+    auto& moving = *tree.leaves[tree.leaves.size() / 2];
+    report("Workspace::move_container", measure(iterations, [&](int i)
+    {
+        tree.workspace->move_container(i % 2 ? Direction::left : Direction::right, moving);
+    }));
+
+    std::cout << std::endl;
+}
+}
+
+int main(int argc, char const** argv)
+{
+    auto const options = parse_options(argc, argv);
+    for (int const leaf_count : { 10, 100, 1000 })
+    {
+        for (int const depth : { 1, 3, 6 })
+            run(leaf_count, depth, options.iterations);
+    }
+
+    return 0;
+}
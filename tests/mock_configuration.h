@@ -28,10 +28,16 @@ namespace test
     class MockConfig : public Config
     {
     public:
+        MockConfig()
+        {
+            ON_CALL(*this, snapshot()).WillByDefault(testing::Return(std::make_shared<ConfigSnapshot const>()));
+        }
+
         MOCK_METHOD(void, load, (mir::Server & server), (override));
         MOCK_METHOD(void, reload, (), (override));
         MOCK_METHOD(std::string const&, get_filename, (), (const, override));
         MOCK_METHOD(MirInputEventModifier, get_input_event_modifier, (), (const, override));
+        MOCK_METHOD(KeyMatch, match_key, (MirKeyboardAction action, int scan_code, unsigned int modifiers), (const, override));
         MOCK_METHOD(CustomKeyCommand const*, matches_custom_key_command, (MirKeyboardAction action, int scan_code, unsigned int modifiers), (const, override));
         MOCK_METHOD(bool, matches_key_command, (MirKeyboardAction action, int scan_code, unsigned int modifiers, std::function<bool(DefaultKeyCommand)> const& f), (const, override));
         MOCK_METHOD(int, get_inner_gaps_x, (), (const, override));
@@ -39,6 +45,7 @@ namespace test
         MOCK_METHOD(int, get_outer_gaps_x, (), (const, override));
         MOCK_METHOD(int, get_outer_gaps_y, (), (const, override));
         MOCK_METHOD(std::vector<StartupApp> const&, get_startup_apps, (), (const, override));
+        MOCK_METHOD(StartupConfiguration, startup, (), (const, override));
         MOCK_METHOD(std::optional<std::string> const&, get_terminal_command, (), (const, override));
         MOCK_METHOD(int, get_resize_jump, (), (const, override));
         MOCK_METHOD(std::vector<EnvironmentVariable> const&, get_env_variables, (), (const, override));
@@ -48,12 +55,16 @@ namespace test
         MOCK_METHOD(WorkspaceConfig, get_workspace_config, (std::optional<int> const& num, std::optional<std::string> const& name), (const, override));
         MOCK_METHOD(LayoutScheme, get_default_layout_scheme, (), (const, override));
         MOCK_METHOD(DragAndDropConfiguration, drag_and_drop, (), (const, override));
+        MOCK_METHOD(IpcConfiguration, ipc, (), (const, override));
+        MOCK_METHOD(SchedulingConfiguration, scheduling, (), (const, override));
         MOCK_METHOD(int, register_listener, (std::function<void(miracle::Config&)> const&), (override));
         MOCK_METHOD(int, register_listener, (std::function<void(miracle::Config&)> const&, int priority), (override));
+        MOCK_METHOD(int, register_listener, (std::function<void(miracle::Config&)> const&, ConfigSection sections, int priority), (override));
         MOCK_METHOD(void, unregister_listener, (int handle), (override));
         MOCK_METHOD(void, try_process_change, (), (override));
         MOCK_METHOD(uint, get_primary_modifier, (), (const, override));
         MOCK_METHOD(uint, move_modifier, (), (const, override));
+        MOCK_METHOD(std::shared_ptr<ConfigSnapshot const>, snapshot, (), (const, override));
     };
 }
 }
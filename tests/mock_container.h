@@ -86,7 +86,7 @@ namespace test
         MOCK_METHOD(void, scratchpad_state, (ScratchpadState), (override));
         MOCK_METHOD(ScratchpadState, scratchpad_state, (), (const, override));
         MOCK_METHOD(LayoutScheme, get_layout, (), (const, override));
-        MOCK_METHOD(nlohmann::json, to_json, (bool), (const, override));
+        MOCK_METHOD(void, write_json, (JsonWriter&, bool), (const, override));
     };
 }
 }
@@ -49,12 +49,14 @@ namespace test
             (override));
         MOCK_METHOD(void, move_workspace_to, (WorkspaceManager&, WorkspaceInterface*), (override));
         MOCK_METHOD(void, advise_application_zone_delete, (miral::Zone const& application_zone), (override));
+        MOCK_METHOD(void, apply_application_zones, (), (override));
+        MOCK_METHOD(bool, has_layout_slot_for, (std::string const&, std::string const&), (const, override));
         MOCK_METHOD(bool, point_is_in_output, (int x, int y), (override));
         MOCK_METHOD(void, update_area, (geom::Rectangle const& area), (override));
         MOCK_METHOD(void, graft, (std::shared_ptr<Container> const& container), (override));
         MOCK_METHOD(void, set_transform, (glm::mat4 const& in), (override));
         MOCK_METHOD(void, set_position, (glm::vec2 const&), (override));
-        MOCK_METHOD(std::vector<miral::Window>, collect_all_windows, (), (const, override));
+        MOCK_METHOD(bool, for_each_window, (FunctionRef<bool(std::shared_ptr<Container> const&)>), (const, override));
         MOCK_METHOD(WorkspaceInterface*, active, (), (const, override));
         MOCK_METHOD(std::vector<std::shared_ptr<WorkspaceInterface>> const&, get_workspaces, (), (const, override));
         MOCK_METHOD(geom::Rectangle const&, get_area, (), (const, override));
@@ -63,12 +65,20 @@ namespace test
         MOCK_METHOD(int, id, (), (const, override));
         MOCK_METHOD(glm::mat4, get_transform, (), (const, override));
         MOCK_METHOD(geom::Rectangle, get_workspace_rectangle, (size_t i), (const, override));
+        MOCK_METHOD(glm::mat4, get_workspace_transform, (size_t i), (const, override));
         MOCK_METHOD(WorkspaceInterface const*, workspace, (uint32_t id), (const, override));
         MOCK_METHOD(nlohmann::json, to_json, (bool), (const, override));
+        MOCK_METHOD(void, write_json, (JsonWriter&, bool), (const, override));
         MOCK_METHOD(void, set_info, (int id, std::string name), (override));
         MOCK_METHOD(void, set_defunct, (), (override));
         MOCK_METHOD(void, unset_defunct, (), (override));
         MOCK_METHOD(bool, is_defunct, (), (const, override));
+        MOCK_METHOD(void, set_overview, (bool), (override));
+        MOCK_METHOD(void, begin_swipe, (), (override));
+        MOCK_METHOD(void, swipe, (float), (override));
+        MOCK_METHOD(void, end_swipe, (float, bool), (override));
+        MOCK_METHOD(bool, is_showing_overview, (), (const, override));
+        MOCK_METHOD(std::optional<uint32_t>, overview_workspace_at, (geom::Point const&), (const, override));
     };
 
 }
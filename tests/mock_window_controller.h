@@ -22,10 +22,13 @@ namespace test
         MOCK_METHOD(std::shared_ptr<Container>, get_container, (miral::Window const&), (override));
         MOCK_METHOD(void, raise, (miral::Window const&), (override));
         MOCK_METHOD(void, send_to_back, (miral::Window const&), (override));
+        MOCK_METHOD(void, set_occluded, (miral::Window const&, bool), (override));
         MOCK_METHOD(void, open, (miral::Window const&), (override));
         MOCK_METHOD(void, close, (miral::Window const&), (override));
         MOCK_METHOD(void, set_user_data, (miral::Window const&, std::shared_ptr<void> const&), (override));
         MOCK_METHOD(void, modify, (miral::Window const&, miral::WindowSpecification const&), (override));
+        MOCK_METHOD(void, begin_changes, (miral::Window const&), (override));
+        MOCK_METHOD(void, end_changes, (miral::Window const&), (override));
         MOCK_METHOD(miral::WindowInfo&, info_for, (miral::Window const&), (override));
         MOCK_METHOD(miral::ApplicationInfo&, info_for, (miral::Application const&), (override));
         MOCK_METHOD(miral::ApplicationInfo&, app_info, (miral::Window const&), (override));
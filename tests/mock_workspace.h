@@ -18,6 +18,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef MIRACLE_WM_MOCK_WORKSPACE_H
 #define MIRACLE_WM_MOCK_WORKSPACE_H
 
+#include "layout_template.h"
 #include "workspace_interface.h"
 #include <functional>
 #include <gmock/gmock.h>
@@ -54,17 +55,19 @@ namespace test
         MOCK_METHOD(void, transfer_pinned_windows_to, (std::shared_ptr<WorkspaceInterface> const& other), (override));
 
         MOCK_METHOD(bool, for_each_window,
-            (std::function<bool(std::shared_ptr<Container>)> const&), (const, override));
+            (FunctionRef<bool(std::shared_ptr<Container> const&)>), (const, override));
 
         MOCK_METHOD(void, advise_focus_gained, (std::shared_ptr<Container> const& container), (override));
 
         MOCK_METHOD(void, select_first_window, (), (override));
+        MOCK_METHOD(std::shared_ptr<LeafContainer>, neighbour, (Container&, Direction), (override));
 
         MOCK_METHOD(OutputInterface*, get_output, (), (const, override));
 
         MOCK_METHOD(void, set_output, (OutputInterface*), (override));
 
         MOCK_METHOD(void, workspace_transform_change_hack, (), (override));
+        MOCK_METHOD(void, surface_transform_change_hack, (), (override));
 
         MOCK_METHOD(bool, is_empty, (), (const, override));
         MOCK_METHOD(void, graft, (std::shared_ptr<Container> const&), (override));
@@ -72,9 +75,12 @@ namespace test
         MOCK_METHOD(uint32_t, id, (), (const, override));
         MOCK_METHOD(std::optional<int>, num, (), (const, override));
         MOCK_METHOD(nlohmann::json, to_json, (bool), (const, override));
+        MOCK_METHOD(void, write_json, (JsonWriter&, bool), (const, override));
         MOCK_METHOD(std::optional<std::string> const&, name, (), (const, override));
         MOCK_METHOD(std::string, display_name, (), (const, override));
         MOCK_METHOD(std::shared_ptr<ParentContainer>, get_root, (), (const, override));
+        MOCK_METHOD(bool, append_layout, (LayoutTemplateNode const&), (override));
+        MOCK_METHOD(bool, has_layout_slot_for, (std::string const&, std::string const&), (const, override));
     };
 }
 }
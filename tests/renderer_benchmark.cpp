@@ -0,0 +1,414 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+/// Times [Renderer::render] on synthetic windows, drawn into an offscreen
+/// framebuffer of a surfaceless EGL context. Reports the time, the heap
+/// allocations and the GL calls that each frame costs, along with the CPU and
+/// GPU times that the renderer measures itself, so that a change to the renderer
+/// can be compared against a baseline.
+///
+/// The windows are the leaves of a generated tree, so that their render data is
+/// that of real containers. Each one is drawn from a texture of its own, which
+/// alternates between two buffers from frame to frame as a client would.
+///
+/// Usage: miracle-wm-renderer-benchmark [--frames N] [--windows N] [--texture-size N]
+///            [--alpha PERCENT] [--border N] [--idle 0|1] [--reduced 0|1]
+///
+/// A texture size of 0 sizes each texture to its window. With --idle 1, the
+/// buffers never change, so that the cost of an idle frame is measured instead.
+
+#include "benchmark_tree.h"
+#include "config.h"
+#include "renderer.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <mir/graphics/buffer.h>
+#include <mir/graphics/display_sink.h>
+#include <mir/graphics/platform.h>
+#include <mir/graphics/program_factory.h>
+#include <mir/graphics/renderable.h>
+#include <mir/graphics/texture.h>
+#include <stdexcept>
+#include <string_view>
+
+using namespace miracle;
+using namespace miracle::benchmark;
+namespace mg = mir::graphics;
+
+namespace miracle
+{
+namespace benchmark
+{
+/// The number of GL calls so far, counted by gl_call_counter.cpp.
+extern std::atomic<size_t> gl_call_count;
+}
+}
+
+namespace
+{
+struct Options
+{
+    int frames = 600;
+    int windows = 16;
+    int texture_size = 0;
+    int alpha_percent = 100;
+    int border = 2;
+    bool idle = false;
+    bool reduced = false;
+};
+
+Options parse_options(int argc, char const** argv)
+{
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string_view const name = argv[i];
+        int const value = std::atoi(argv[i + 1]);
+        if (name == "--frames")
+            options.frames = value;
+        else if (name == "--windows")
+            options.windows = value;
+        else if (name == "--texture-size")
+            options.texture_size = value;
+        else if (name == "--alpha")
+            options.alpha_percent = value;
+        else if (name == "--border")
+            options.border = value;
+        else if (name == "--idle")
+            options.idle = value != 0;
+        else if (name == "--reduced")
+            options.reduced = value != 0;
+        else
+            std::cerr << "Ignoring unknown option: " << name << std::endl;
+    }
+
+    return options;
+}
+
+/// A GLES 2 context without a surface of its own, which renders into framebuffer
+/// objects alone.
+class SurfacelessContext
+{
+public:
+    SurfacelessContext()
+    {
+        auto const get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (!get_platform_display)
+            throw std::runtime_error("eglGetPlatformDisplayEXT is not available");
+
+        display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+            throw std::runtime_error("Unable to initialize a surfaceless EGL display");
+
+        eglBindAPI(EGL_OPENGL_ES_API);
+        EGLint const attributes[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
+        context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+        if (context == EGL_NO_CONTEXT)
+            throw std::runtime_error("Unable to create a surfaceless GLES 2 context");
+    }
+
+    ~SurfacelessContext()
+    {
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+    }
+
+    void make_current() const { eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context); }
+    void release_current() const { eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT); }
+
+private:
+    EGLDisplay display;
+    EGLContext context;
+};
+
+/// Stands in for the output, as a framebuffer object of the size of [OUTPUT_AREA].
+class BenchmarkOutputSurface : public mg::gl::OutputSurface
+{
+public:
+    explicit BenchmarkOutputSurface(SurfacelessContext const& context) :
+        context { context }
+    {
+        context.make_current();
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, OUTPUT_AREA.size.width.as_int(), OUTPUT_AREA.size.height.as_int(),
+            0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            throw std::runtime_error("The output framebuffer is incomplete");
+    }
+
+    ~BenchmarkOutputSurface() override
+    {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteTextures(1, &texture);
+    }
+
+    void bind() override { glBindFramebuffer(GL_FRAMEBUFFER, framebuffer); }
+    void make_current() override { context.make_current(); }
+    void release_current() override { context.release_current(); }
+
+    auto commit() -> std::unique_ptr<mg::Framebuffer> override
+    {
+        glFlush();
+        return nullptr;
+    }
+
+    auto size() const -> geom::Size override { return OUTPUT_AREA.size; }
+    auto layout() const -> Layout override { return Layout::GL; }
+
+private:
+    SurfacelessContext const& context;
+    GLuint framebuffer = 0;
+    GLuint texture = 0;
+};
+
+/// An RGBA texture with undefined contents, sampled as Mir samples those of shm buffers.
+class BenchmarkTexture : public mg::gl::Texture
+{
+public:
+    explicit BenchmarkTexture(geom::Size size)
+    {
+        glGenTextures(1, &id);
+        glBindTexture(GL_TEXTURE_2D, id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.width.as_int(), size.height.as_int(),
+            0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+
+    ~BenchmarkTexture() override { glDeleteTextures(1, &id); }
+
+    auto shader(mg::gl::ProgramFactory& factory) const -> mg::gl::Program const& override
+    {
+        static int const shader_id = 0;
+        return factory.compile_fragment_shader(
+            &shader_id,
+            "",
+            "uniform sampler2D tex;\n"
+            "vec4 sample_to_rgba(in vec2 texcoord)\n"
+            "{\n"
+            "    return texture2D(tex, texcoord);\n"
+            "}\n");
+    }
+
+    auto layout() const -> Layout override { return Layout::GL; }
+    void bind() override { glBindTexture(GL_TEXTURE_2D, id); }
+    auto tex_id() const -> GLuint override { return id; }
+    void add_syncpoint() override { }
+
+private:
+    GLuint id = 0;
+};
+
+class BenchmarkBuffer : public mg::Buffer
+{
+public:
+    BenchmarkBuffer(uint32_t id, geom::Size size) :
+        id_ { id },
+        size_ { size },
+        texture_ { std::make_shared<BenchmarkTexture>(size) }
+    {
+    }
+
+    mg::BufferID id() const override { return id_; }
+    geom::Size size() const override { return size_; }
+    MirPixelFormat pixel_format() const override { return mir_pixel_format_abgr_8888; }
+    mg::NativeBufferBase* native_buffer_base() override { return texture_.get(); }
+
+    [[nodiscard]] std::shared_ptr<BenchmarkTexture> const& texture() const { return texture_; }
+
+private:
+    mg::BufferID const id_;
+    geom::Size const size_;
+    std::shared_ptr<BenchmarkTexture> const texture_;
+};
+
+/// Turns each [BenchmarkBuffer] into its texture. Nothing else is asked of it by the renderer.
+class BenchmarkRenderingProvider : public mg::GLRenderingProvider
+{
+public:
+    auto as_texture(std::shared_ptr<mg::Buffer> buffer) -> std::shared_ptr<mg::gl::Texture> override
+    {
+        return std::static_pointer_cast<BenchmarkBuffer>(buffer)->texture();
+    }
+
+    auto surface_for_sink(mg::DisplaySink&, mg::GLConfig const&) -> std::unique_ptr<mg::gl::OutputSurface> override
+    {
+        throw std::logic_error("The renderer benchmark has no display sinks");
+    }
+
+    auto suitability_for_allocator(std::shared_ptr<mg::GraphicBufferAllocator> const&) -> mg::probe::Result override
+    {
+        return mg::probe::unsupported;
+    }
+
+    auto suitability_for_display(mg::DisplaySink&) -> mg::probe::Result override
+    {
+        return mg::probe::unsupported;
+    }
+
+    auto make_framebuffer_provider(mg::DisplaySink&) -> std::unique_ptr<mg::FramebufferProvider> override
+    {
+        throw std::logic_error("The renderer benchmark has no display sinks");
+    }
+};
+
+/// A window of the tree, shown at its logical area from one of two buffers.
+class BenchmarkRenderable : public mg::Renderable
+{
+public:
+    BenchmarkRenderable(
+        mir::scene::Surface const* surface,
+        geom::Rectangle area,
+        std::array<std::shared_ptr<BenchmarkBuffer>, 2> buffers,
+        float alpha,
+        int const& frame) :
+        surface { surface },
+        area { area },
+        buffers { std::move(buffers) },
+        alpha_ { alpha },
+        frame { frame }
+    {
+    }
+
+    ID id() const override { return this; }
+    std::shared_ptr<mg::Buffer> buffer() const override { return buffers[frame % 2]; }
+    geom::Rectangle screen_position() const override { return area; }
+
+    geom::RectangleD src_bounds() const override
+    {
+        auto const size = buffers[0]->size();
+        return { { 0, 0 }, { size.width.as_value(), size.height.as_value() } };
+    }
+
+    std::optional<geom::Rectangle> clip_area() const override { return area; }
+    float alpha() const override { return alpha_; }
+    glm::mat4 transformation() const override { return glm::mat4(1.f); }
+    bool shaped() const override { return alpha_ < 1.f; }
+    std::optional<mir::scene::Surface const*> surface_if_any() const override { return surface; }
+
+private:
+    mir::scene::Surface const* surface;
+    geom::Rectangle area;
+    std::array<std::shared_ptr<BenchmarkBuffer>, 2> buffers;
+    float alpha_;
+    int const& frame;
+};
+
+/// Hands the renderer the same snapshot in every frame, as the real configuration
+/// does between reloads.
+class BenchmarkConfiguration : public test::StubConfiguration
+{
+public:
+    explicit BenchmarkConfiguration(Options const& options)
+    {
+        ConfigSnapshot config;
+        config.border_config = {
+            .size = options.border,
+            .focus_color = glm::vec4(0.9f, 0.6f, 0.2f, 1.f),
+            .color = glm::vec4(0.3f, 0.3f, 0.3f, 1.f)
+        };
+        config.quality_tier = options.reduced ? QualityTier::reduced : QualityTier::full;
+        snapshot_ = std::make_shared<ConfigSnapshot const>(std::move(config));
+    }
+
+    [[nodiscard]] std::shared_ptr<ConfigSnapshot const> snapshot() const override { return snapshot_; }
+
+private:
+    std::shared_ptr<ConfigSnapshot const> snapshot_;
+};
+}
+
+int main(int argc, char const** argv)
+{
+    auto const options = parse_options(argc, argv);
+    auto const config = std::make_shared<BenchmarkConfiguration>(options);
+
+    // Two levels lay the windows out in a grid rather than in slivers
+    Tree tree(options.windows, 2);
+    SurfacelessContext context;
+    auto output = std::make_unique<BenchmarkOutputSurface>(context);
+
+    int frame = 0;
+    uint32_t next_buffer_id = 1;
+    mg::RenderableList renderables;
+    for (size_t i = 0; i < tree.leaves.size(); i++)
+    {
+        auto const area = tree.leaves[i]->get_logical_area();
+        auto const texture_size = options.texture_size > 0
+            ? geom::Size(options.texture_size, options.texture_size)
+            : area.size;
+        std::array<std::shared_ptr<BenchmarkBuffer>, 2> buffers;
+        for (auto& buffer : buffers)
+            buffer = std::make_shared<BenchmarkBuffer>(next_buffer_id++, texture_size);
+
+        renderables.push_back(std::make_shared<BenchmarkRenderable>(
+            tree.surfaces[i].get(), area, buffers, options.alpha_percent / 100.f, frame));
+    }
+
+    Renderer renderer(std::make_shared<BenchmarkRenderingProvider>(), std::move(output), config, tree.state);
+    renderer.set_viewport(OUTPUT_AREA);
+
+    auto const render = [&]
+    {
+        renderer.render(renderables);
+        glFinish();
+        if (!options.idle)
+            frame++;
+    };
+
+    // The first frames compile the programs and fill the caches
+    for (int i = 0; i < 10; i++)
+        render();
+
+    auto const gl_calls_before = gl_call_count.load(std::memory_order_relaxed);
+    auto const measurement = measure(options.frames, [&](int) { render(); });
+    auto const gl_calls = gl_call_count.load(std::memory_order_relaxed) - gl_calls_before;
+
+    std::cout << std::format("windows: {}, frames: {}, alpha: {}%, border: {}px{}{}\n",
+        renderables.size(), options.frames, options.alpha_percent, options.border,
+        options.idle ? ", idle" : "", options.reduced ? ", reduced" : "");
+    std::cout << std::format("  {:<28}{:>14.1f} us/frame{:>12.1f} allocs/frame\n",
+        "render + finish", measurement.nanoseconds_per_op / 1000.0, measurement.allocations_per_op);
+    std::cout << std::format("  {:<28}{:>14.1f} calls/frame\n",
+        "GL", static_cast<double>(gl_calls) / options.frames);
+
+    for (auto const& stats : tree.state->render_stats()->outputs())
+    {
+        std::cout << std::format("  {:<28}{:>14.3f} ms p50{:>10.3f} ms p95\n",
+            "renderer CPU time", stats.cpu_time_ms.percentile(0.5), stats.cpu_time_ms.percentile(0.95));
+        if (stats.gpu_time_ms.size() > 0)
+            std::cout << std::format("  {:<28}{:>14.3f} ms p50{:>10.3f} ms p95\n",
+                "renderer GPU time", stats.gpu_time_ms.percentile(0.5), stats.gpu_time_ms.percentile(0.95));
+        else
+            std::cout << std::format("  {:<28}{:>14}\n", "renderer GPU time", "unsupported");
+        std::cout << std::format("  {:<28}{:>14} drawn{:>10} skipped frames\n",
+            "last frame", stats.last.renderables_drawn, stats.skipped_frames);
+    }
+
+    return 0;
+}
@@ -31,6 +31,11 @@ namespace test
         void reload() override { }
         [[nodiscard]] std::string const& get_filename() const override { return filename; }
         [[nodiscard]] MirInputEventModifier get_input_event_modifier() const override { return mir_input_event_modifier_none; }
+        [[nodiscard]] KeyMatch match_key(MirKeyboardAction action, int scan_code, unsigned int modifiers) const override
+        {
+            return {};
+        }
+
         [[nodiscard]] CustomKeyCommand const* matches_custom_key_command(MirKeyboardAction action, int scan_code, unsigned int modifiers) const override
         {
             return nullptr;
@@ -66,6 +71,11 @@ namespace test
             return startup_apps;
         }
 
+        [[nodiscard]] StartupConfiguration startup() const override
+        {
+            return {};
+        }
+
         [[nodiscard]] std::optional<std::string> const& get_terminal_command() const override
         {
             return terminal_command;
@@ -113,6 +123,11 @@ namespace test
             return -1;
         }
 
+        int register_listener(std::function<void(miracle::Config&)> const&, ConfigSection sections, int priority) override
+        {
+            return -1;
+        }
+
         void unregister_listener(int handle) override
         {
         }
@@ -124,6 +139,13 @@ namespace test
             return 0;
         }
 
+        [[nodiscard]] std::shared_ptr<ConfigSnapshot const> snapshot() const override
+        {
+            return std::make_shared<ConfigSnapshot const>(ConfigSnapshot {
+                .border_config = border_config,
+                .animation_definitions = animations });
+        }
+
         [[nodiscard]] LayoutScheme get_default_layout_scheme() const override
         {
             return LayoutScheme::horizontal;
@@ -134,6 +156,16 @@ namespace test
             return {};
         }
 
+        [[nodiscard]] IpcConfiguration ipc() const override
+        {
+            return {};
+        }
+
+        [[nodiscard]] SchedulingConfiguration scheduling() const override
+        {
+            return {};
+        }
+
         [[nodiscard]] uint move_modifier() const override
         {
             return 0;
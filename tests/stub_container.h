@@ -266,9 +266,9 @@ namespace test
             return LayoutScheme::horizontal;
         }
 
-        nlohmann::json to_json(bool) const override
+        void write_json(JsonWriter& writer, bool) const override
         {
-            return {};
+            writer.null();
         }
     };
 }
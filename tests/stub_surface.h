@@ -60,7 +60,7 @@ public:
 
     auto visible_on_lock_screen() const -> bool override
     {
-        return false;
+        return is_visible_on_lock_screen;
     }
 
     void register_interest(std::weak_ptr<mir::scene::SurfaceObserver> const& observer) override
@@ -231,6 +231,7 @@ public:
 
     void set_visible_on_lock_screen(bool visible) override
     {
+        is_visible_on_lock_screen = visible;
     }
 
     std::optional<mir::geometry::Rectangle> clip_area() const override
@@ -278,6 +279,9 @@ public:
     void set_focus_mode(MirFocusMode focus_mode) override
     {
     }
+
+private:
+    bool is_visible_on_lock_screen = false;
 };
 }
 
@@ -37,6 +37,7 @@ struct StubWindowData
     mir::geometry::Rectangle rectangle;
     MirWindowState state;
     std::optional<mir::geometry::Rectangle> clip;
+    bool occluded = false;
 };
 
 class StubWindowController : public miracle::WindowController
@@ -91,6 +92,15 @@ public:
 
     void raise(miral::Window const&) override { }
     void send_to_back(miral::Window const&) override { }
+    void set_occluded(miral::Window const& window, bool occluded) override
+    {
+        // Windows are occluded as they are placed, before they are known to the stub
+        for (auto& p : pairs)
+        {
+            if (p.window == window)
+                p.occluded = occluded;
+        }
+    }
     void open(miral::Window const&) override { }
     void close(miral::Window const&) override { }
     void set_user_data(miral::Window const&, std::shared_ptr<void> const&) override { }
@@ -141,6 +151,9 @@ public:
     {
     }
 
+    void begin_changes(miral::Window const&) override { }
+    void end_changes(miral::Window const&) override { }
+
 private:
     std::vector<StubWindowData>& pairs;
     miral::WindowInfo stub_win_info;
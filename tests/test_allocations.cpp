@@ -0,0 +1,179 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "animator.h"
+#include "benchmark_tree.h"
+#include "config.h"
+#include "ipc_command.h"
+#include "mock_container.h"
+#include "render_data_manager.h"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <miral/runner.h>
+
+using namespace miracle;
+
+namespace
+{
+int argc = 1;
+char const* argv[] = { "miracle-wm-tests" };
+std::string const path = std::filesystem::current_path() / "test_allocations.yaml";
+
+class StubAnimation : public Animation
+{
+public:
+    using Animation::Animation;
+    void on_tick(AnimationStepResult const&) override { }
+};
+
+/// The number of heap allocations that [f] makes, as counted by allocation_counter.cpp.
+template <typename F>
+size_t count_allocations(F const& f)
+{
+    auto const before = benchmark::allocation_count.load(std::memory_order_relaxed);
+    f();
+    return benchmark::allocation_count.load(std::memory_order_relaxed) - before;
+}
+}
+
+/// Each test warms its subject up once, then checks that doing the same again
+/// does not touch the heap. These are the paths that run on every frame, key
+/// press or pointer motion.
+class AllocationTest : public testing::Test
+{
+public:
+    static constexpr int iterations = 100;
+};
+
+TEST_F(AllocationTest, KeyLookupDoesNotAllocate)
+{
+    std::ofstream(path, std::ofstream::trunc).close();
+    miral::MirRunner runner(argc, argv);
+    FilesystemConfiguration config(runner, path, true);
+    std::filesystem::remove(path);
+
+    auto const primary = config.get_primary_modifier();
+    size_t bound = 0;
+    auto const lookup = [&]
+    {
+        for (int i = 0; i < iterations; i++)
+        {
+            bound += !config.match_key(mir_keyboard_action_down, KEY_Q, mir_input_event_modifier_none).empty();
+            bound += !config.match_key(mir_keyboard_action_down, KEY_H, primary).empty();
+            config.matches_key_command(mir_keyboard_action_down, KEY_J, primary, [&bound](DefaultKeyCommand)
+            {
+                bound++;
+                return true;
+            });
+        }
+    };
+
+    lookup();
+    EXPECT_EQ(count_allocations(lookup), 0);
+    EXPECT_GT(bound, 0);
+}
+
+TEST_F(AllocationTest, GettingUnchangedRenderDataDoesNotAllocate)
+{
+    RenderDataManager render_data_manager;
+    std::vector<std::unique_ptr<testing::NiceMock<test::MockContainer>>> containers;
+    for (int i = 0; i < 32; i++)
+    {
+        auto container = std::make_unique<testing::NiceMock<test::MockContainer>>();
+        ON_CALL(*container, get_type())
+            .WillByDefault(testing::Return(ContainerType::leaf));
+        render_data_manager.add(*container);
+        containers.push_back(std::move(container));
+    }
+
+    RenderDataSnapshot snapshot;
+    RenderDataFetch fetch;
+    auto const get = [&]
+    {
+        for (int i = 0; i < iterations; i++)
+        {
+            auto const latest = render_data_manager.get();
+            render_data_manager.update(snapshot, fetch);
+        }
+    };
+
+    get();
+    EXPECT_EQ(count_allocations(get), 0);
+    EXPECT_EQ(snapshot.size(), containers.size());
+}
+
+TEST_F(AllocationTest, TickingRunningAnimationsDoesNotAllocate)
+{
+    Animator animator;
+    AnimationDefinition const definition {
+        .type = AnimationType::slide,
+        .function = EaseFunction::ease_out_cubic,
+        .duration_seconds = 1000
+    };
+    mir::geometry::Rectangle const from { { 0, 0 }, { 100, 100 } };
+    mir::geometry::Rectangle const to { { 600, 400 }, { 200, 200 } };
+    for (int i = 0; i < 32; i++)
+        animator.append(std::make_shared<StubAnimation>(animator.register_animateable(), definition, from, to, from));
+
+    auto const tick = [&]
+    {
+        for (int i = 0; i < iterations; i++)
+            animator.tick(0.001f);
+    };
+
+    tick();
+    EXPECT_EQ(count_allocations(tick), 0);
+}
+
+TEST_F(AllocationTest, ParsingACachedCommandDoesNotAllocate)
+{
+    IpcCommandCache cache;
+    std::string const commands[] = { "workspace number 3", "focus left", "move container to workspace 2" };
+    size_t parsed = 0;
+    auto const parse = [&]
+    {
+        for (int i = 0; i < iterations; i++)
+        {
+            for (auto const& command : commands)
+                parsed += cache.parse(command).commands.size();
+        }
+    };
+
+    parse();
+    EXPECT_EQ(count_allocations(parse), 0);
+    EXPECT_GT(parsed, 0);
+}
+
+TEST_F(AllocationTest, IntersectingALeafDoesNotAllocate)
+{
+    benchmark::Tree tree(16, 2);
+    size_t found = 0;
+    auto const intersect = [&]
+    {
+        for (int i = 0; i < iterations; i++)
+        {
+            auto const x = static_cast<float>((i * 389) % benchmark::OUTPUT_AREA.size.width.as_int());
+            auto const y = static_cast<float>((i * 211) % benchmark::OUTPUT_AREA.size.height.as_int());
+            found += tree.output.intersect_leaf(x, y, false) != nullptr;
+        }
+    };
+
+    intersect();
+    EXPECT_EQ(count_allocations(intersect), 0);
+    EXPECT_GT(found, 0);
+}
@@ -0,0 +1,59 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "animation_trace.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+
+namespace
+{
+AnimationTraceRecord tick(uint32_t count, int64_t start_ns)
+{
+    return { .type = AnimationTraceRecord::Type::tick, .count = count, .value = 0.016f, .start_ns = start_ns, .duration_ns = 1000 };
+}
+}
+
+TEST(AnimationTraceTest, records_are_returned_oldest_first)
+{
+    AnimationTrace trace(3);
+    trace.record({ tick(1, 0), tick(2, 1) });
+    trace.record({ tick(3, 2), tick(4, 3) });
+
+    auto const records = trace.records();
+    ASSERT_EQ(records.size(), 3);
+    EXPECT_EQ(records[0].count, 2);
+    EXPECT_EQ(records[1].count, 3);
+    EXPECT_EQ(records[2].count, 4);
+}
+
+TEST(AnimationTraceTest, chrome_trace_contains_ticks_and_steps)
+{
+    AnimationTrace trace;
+    trace.record({ tick(1, 2000),
+        { .type = AnimationTraceRecord::Type::step, .count = 7, .value = 0.5f, .start_ns = 2500, .duration_ns = 500 } });
+
+    auto const json = trace.to_chrome_trace();
+    auto const& events = json["traceEvents"];
+    ASSERT_EQ(events.size(), 4);
+    EXPECT_EQ(events[0]["name"], "tick");
+    EXPECT_EQ(events[0]["ph"], "X");
+    EXPECT_DOUBLE_EQ(events[0]["ts"].get<double>(), 2.0);
+    EXPECT_EQ(events[2]["name"], "on_tick");
+    EXPECT_EQ(events[2]["args"]["handle"], 7);
+    EXPECT_EQ(events[3]["name"], "progress 7");
+}
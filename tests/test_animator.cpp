@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "animator.h"
 #include <gtest/gtest.h>
+#include <thread>
 
 using namespace miracle;
 
@@ -38,9 +39,11 @@ public:
     void on_tick(AnimationStepResult const& asr) override
     {
         was_called = true;
+        last_result = asr;
     }
 
     bool was_called = false;
+    AnimationStepResult last_result;
 };
 }
 
@@ -74,3 +77,266 @@ TEST_F(AnimatorTest, CanStepLinearSlideAnimation)
     animator.tick(0.16);
     EXPECT_EQ(animation->was_called, true);
 }
+
+TEST_F(AnimatorTest, LatestAnimationForHandleReplacesPrevious)
+{
+    Animator animator;
+    auto const handle = animator.register_animateable();
+    AnimationDefinition definition {
+        .type = AnimationType::slide,
+        .function = EaseFunction::linear,
+        .duration_seconds = 1
+    };
+    mir::geometry::Rectangle const from(mir::geometry::Point(0, 0), mir::geometry::Size(0, 0));
+    mir::geometry::Rectangle const to(mir::geometry::Point(600, 0), mir::geometry::Size(0, 0));
+    auto const first = std::make_shared<StubAnimation>(handle, definition, from, to, from);
+    auto const second = std::make_shared<StubAnimation>(handle, definition, from, to, from);
+    animator.append(first);
+    animator.append(second);
+
+    first->was_called = false;
+    second->was_called = false;
+    animator.tick(0.16);
+    EXPECT_EQ(first->was_called, false);
+    EXPECT_EQ(second->was_called, true);
+}
+
+TEST_F(AnimatorTest, CompletedAnimationsAreRemoved)
+{
+    Animator animator;
+    AnimationDefinition definition {
+        .type = AnimationType::grow,
+        .function = EaseFunction::ease_out_back,
+        .duration_seconds = 0.5
+    };
+    mir::geometry::Rectangle const area(mir::geometry::Point(0, 0), mir::geometry::Size(100, 100));
+    animator.append(std::make_shared<StubAnimation>(animator.register_animateable(), definition, area, area, area));
+    animator.append(std::make_shared<StubAnimation>(animator.register_animateable(), definition, area, area, area));
+
+    animator.tick(0.25);
+    EXPECT_TRUE(animator.has_animations());
+    animator.tick(0.25);
+    EXPECT_FALSE(animator.has_animations());
+}
+
+TEST_F(AnimatorTest, CompositorOnlySlideOnlyChangesGeometryOnCompletion)
+{
+    AnimationDefinition definition {
+        .type = AnimationType::slide,
+        .function = EaseFunction::linear,
+        .duration_seconds = 1,
+        .compositor_only = true
+    };
+    mir::geometry::Rectangle const from(mir::geometry::Point(0, 0), mir::geometry::Size(100, 100));
+    mir::geometry::Rectangle const to(mir::geometry::Point(600, 0), mir::geometry::Size(200, 100));
+    StubAnimation animation(1, definition, from, to, from);
+
+    auto const init = animation.init();
+    EXPECT_FALSE(init.position);
+    EXPECT_FALSE(init.size);
+    EXPECT_TRUE(init.is_compositor_only);
+
+    auto const halfway = animation.step(0.5f, 0.5f);
+    EXPECT_FALSE(halfway.is_complete);
+    EXPECT_TRUE(halfway.is_compositor_only);
+    EXPECT_FALSE(halfway.position);
+    EXPECT_FALSE(halfway.size);
+    ASSERT_TRUE(halfway.transform);
+    auto const bottom_right = halfway.transform.value() * glm::vec4(100, 100, 0, 1);
+    EXPECT_FLOAT_EQ(bottom_right.x, 450);
+    EXPECT_FLOAT_EQ(bottom_right.y, 100);
+    EXPECT_EQ(halfway.clip_area, mir::geometry::Rectangle(mir::geometry::Point(300, 0), mir::geometry::Size(150, 100)));
+
+    auto const complete = animation.step(1.f, 1.f);
+    EXPECT_TRUE(complete.is_complete);
+    EXPECT_EQ(complete.position, glm::vec2(600, 0));
+    EXPECT_EQ(complete.size, glm::vec2(200, 100));
+    EXPECT_EQ(complete.transform, glm::mat4(1.f));
+    EXPECT_FALSE(complete.is_compositor_only);
+}
+
+TEST_F(AnimatorTest, GrowIsNotCompositorOnly)
+{
+    AnimationDefinition definition {
+        .type = AnimationType::grow,
+        .function = EaseFunction::linear,
+        .duration_seconds = 1
+    };
+    mir::geometry::Rectangle const area(mir::geometry::Point(0, 0), mir::geometry::Size(100, 100));
+    StubAnimation animation(1, definition, area, area, area);
+
+    auto const halfway = animation.step(0.5f, 0.5f);
+    ASSERT_TRUE(halfway.transform);
+    EXPECT_FALSE(halfway.is_compositor_only);
+}
+
+TEST_F(AnimatorTest, LowPriorityAnimationsCompleteWhenOverBudget)
+{
+    Animator animator;
+    AnimationDefinition definition {
+        .type = AnimationType::slide,
+        .function = EaseFunction::linear,
+        .duration_seconds = 1
+    };
+    mir::geometry::Rectangle const from(mir::geometry::Point(0, 0), mir::geometry::Size(100, 100));
+    mir::geometry::Rectangle const to(mir::geometry::Point(600, 0), mir::geometry::Size(100, 100));
+    auto const low = std::make_shared<StubAnimation>(animator.register_animateable(), definition, from, to, from);
+    low->set_low_priority(true);
+    auto const high = std::make_shared<StubAnimation>(animator.register_animateable(), definition, from, to, from);
+    animator.append(low);
+    animator.append(high);
+
+    animator.set_over_budget(true);
+    animator.tick(0.1f);
+    EXPECT_TRUE(low->is_going_to_great_animator_in_the_sky());
+    EXPECT_FALSE(high->is_going_to_great_animator_in_the_sky());
+}
+
+TEST_F(AnimatorTest, EveryAnimationCompletesWhileSnapping)
+{
+    Animator animator;
+    AnimationDefinition definition {
+        .type = AnimationType::slide,
+        .function = EaseFunction::linear,
+        .duration_seconds = 1
+    };
+    mir::geometry::Rectangle const from(mir::geometry::Point(0, 0), mir::geometry::Size(100, 100));
+    mir::geometry::Rectangle const to(mir::geometry::Point(600, 0), mir::geometry::Size(100, 100));
+    auto const animation = std::make_shared<StubAnimation>(animator.register_animateable(), definition, from, to, from);
+    animator.append(animation);
+
+    animator.set_snapping(true);
+    animator.tick(0.1f);
+    EXPECT_TRUE(animation->is_going_to_great_animator_in_the_sky());
+    EXPECT_FALSE(animator.has_animations());
+}
+
+TEST_F(AnimatorTest, CommandsFromOtherThreadsAreAppliedOnTheNextTick)
+{
+    Animator animator;
+    AnimationDefinition definition {
+        .type = AnimationType::grow,
+        .function = EaseFunction::linear,
+        .duration_seconds = 1
+    };
+    mir::geometry::Rectangle const area(mir::geometry::Point(0, 0), mir::geometry::Size(100, 100));
+    auto const handle = animator.register_animateable();
+    std::thread producer([&]
+    {
+        animator.append(std::make_shared<StubAnimation>(handle, definition, area, area, area));
+        animator.remove_by_animation_handle(handle);
+    });
+    producer.join();
+
+    EXPECT_TRUE(animator.has_animations());
+    animator.tick(0.1f);
+    EXPECT_FALSE(animator.has_animations());
+    EXPECT_EQ(animator.get_stats().commands_processed, 2);
+}
+
+TEST_F(AnimatorTest, RetargetingASlideContinuesFromWhereItIs)
+{
+    Animator animator;
+    auto const handle = animator.register_animateable();
+    AnimationDefinition definition {
+        .type = AnimationType::slide,
+        .function = EaseFunction::linear,
+        .duration_seconds = 1
+    };
+    mir::geometry::Rectangle const from(mir::geometry::Point(0, 0), mir::geometry::Size(100, 100));
+    mir::geometry::Rectangle const to(mir::geometry::Point(600, 0), mir::geometry::Size(100, 100));
+    mir::geometry::Rectangle const next_to(mir::geometry::Point(1000, 0), mir::geometry::Size(100, 100));
+    auto const first = std::make_shared<StubAnimation>(handle, definition, from, to, from);
+    animator.append(first);
+    animator.tick(0.5f);
+    ASSERT_TRUE(first->last_result.position);
+    EXPECT_FLOAT_EQ(first->last_result.position->x, 300);
+
+    auto const second = std::make_shared<StubAnimation>(handle, definition, from, next_to, from);
+    animator.append(second);
+    animator.tick(0.f);
+    EXPECT_FALSE(second->was_called);
+    ASSERT_TRUE(first->last_result.position);
+    EXPECT_FLOAT_EQ(first->last_result.position->x, 300);
+
+    // The slide starts over, so the surface has the whole duration to get there
+    animator.tick(0.5f);
+    EXPECT_FALSE(first->last_result.is_complete);
+    animator.tick(0.5f);
+    EXPECT_TRUE(first->last_result.is_complete);
+    EXPECT_EQ(first->last_result.position, glm::vec2(1000, 0));
+}
+
+TEST_F(AnimatorTest, RetargetingLateInASlideKeepsItsSpeed)
+{
+    Animator animator;
+    auto const handle = animator.register_animateable();
+    AnimationDefinition definition {
+        .type = AnimationType::slide,
+        .function = EaseFunction::linear,
+        .duration_seconds = 1
+    };
+    mir::geometry::Rectangle const from(mir::geometry::Point(0, 0), mir::geometry::Size(100, 100));
+    mir::geometry::Rectangle const to(mir::geometry::Point(600, 0), mir::geometry::Size(100, 100));
+    mir::geometry::Rectangle const next_to(mir::geometry::Point(1000, 0), mir::geometry::Size(100, 100));
+    auto const first = std::make_shared<StubAnimation>(handle, definition, from, to, from);
+    animator.append(first);
+    animator.tick(0.95f);
+    ASSERT_TRUE(first->last_result.position);
+    EXPECT_FLOAT_EQ(first->last_result.position->x, 570);
+
+    auto const second = std::make_shared<StubAnimation>(handle, definition, from, next_to, from);
+    animator.append(second);
+    animator.tick(0.f);
+    ASSERT_TRUE(first->last_result.position);
+    EXPECT_FLOAT_EQ(first->last_result.position->x, 570);
+
+    // Still at 600px per second, rather than leaping to cover 430px in the last 5%
+    animator.tick(0.01f);
+    ASSERT_TRUE(first->last_result.position);
+    EXPECT_NEAR(first->last_result.position->x, 576, 0.5);
+    EXPECT_FLOAT_EQ(first->last_result.position->y, 0);
+
+    animator.tick(1.f);
+    EXPECT_TRUE(first->last_result.is_complete);
+    EXPECT_EQ(first->last_result.position, glm::vec2(1000, 0));
+}
+
+TEST_F(AnimatorTest, HandlesAreReusedOnceUnregistered)
+{
+    Animator animator;
+    auto const first = animator.register_animateable();
+    auto const second = animator.register_animateable();
+    EXPECT_NE(first, second);
+
+    animator.unregister_animateable(first);
+    EXPECT_EQ(animator.register_animateable(), first);
+    EXPECT_NE(animator.register_animateable(), second);
+}
+
+TEST_F(AnimatorTest, ReusedHandlesDoNotContinueTheAnimationsOfTheirPreviousOwner)
+{
+    Animator animator;
+    AnimationDefinition definition {
+        .type = AnimationType::slide,
+        .function = EaseFunction::linear,
+        .duration_seconds = 1
+    };
+    mir::geometry::Rectangle const from(mir::geometry::Point(0, 0), mir::geometry::Size(0, 0));
+    mir::geometry::Rectangle const to(mir::geometry::Point(600, 0), mir::geometry::Size(0, 0));
+
+    auto const handle = animator.register_animateable();
+    auto const previous = std::make_shared<StubAnimation>(handle, definition, from, to, from);
+    animator.append(previous);
+    animator.tick(0.16);
+
+    animator.unregister_animateable(handle);
+    ASSERT_EQ(animator.register_animateable(), handle);
+    auto const next = std::make_shared<StubAnimation>(handle, definition, from, to, from);
+    animator.append(next);
+
+    previous->was_called = false;
+    animator.tick(0.16);
+    EXPECT_FALSE(previous->was_called);
+    EXPECT_TRUE(next->was_called);
+}
@@ -25,9 +25,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "mode_observer.h"
 #include "output_manager.h"
 #include "scratchpad.h"
+#include "window_observer.h"
 #include "workspace_manager.h"
 #include "workspace_observer.h"
 #include <gtest/gtest.h>
+#include <future>
 #include <memory>
 #include <mutex>
 
@@ -55,13 +57,14 @@ public:
             window_controller,
             workspace_manager,
             mode_observer_registrar,
+            window_observer_registrar,
             std::make_unique<StubCommandControllerInterface>(),
             scratchpad,
             output_manager))
     {
     }
 
-    std::recursive_mutex mutex;
+    WindowManagerMutex mutex;
     test::MockOutputFactory* output_factory = new test::MockOutputFactory();
     std::shared_ptr<OutputManager> output_manager;
     std::shared_ptr<test::MockConfig> config;
@@ -70,6 +73,7 @@ public:
     std::shared_ptr<WorkspaceManager> workspace_manager;
     std::shared_ptr<Scratchpad> scratchpad;
     std::shared_ptr<ModeObserverRegistrar> mode_observer_registrar = std::make_shared<ModeObserverRegistrar>();
+    std::shared_ptr<WindowObserverRegistrar> window_observer_registrar = std::make_shared<WindowObserverRegistrar>();
     std::shared_ptr<CompositorState> state = std::make_shared<CompositorState>();
     std::shared_ptr<CommandController> command_controller;
 };
@@ -105,3 +109,45 @@ TEST_F(CommandControllerTest, cannot_move_active_to_same_workspace_by_name)
     std::string expected = "Test";
     ASSERT_FALSE(command_controller->move_active_to_workspace_named(expected, false));
 }
+
+TEST_F(CommandControllerTest, lock_holds_off_other_threads_until_it_is_released)
+{
+    // Whether another thread can take the lock right now
+    auto const try_lock_from_other_thread = [&]
+    {
+        return std::async(std::launch::async, [&]
+        {
+            std::unique_lock other_lock(mutex, std::try_to_lock);
+            return other_lock.owns_lock();
+        }).get();
+    };
+
+    {
+        auto const lock = command_controller->lock();
+        EXPECT_FALSE(try_lock_from_other_thread());
+
+        // The same thread may still make requests while holding the lock
+        std::unique_lock inner(mutex, std::try_to_lock);
+        EXPECT_TRUE(inner.owns_lock());
+    }
+
+    EXPECT_TRUE(try_lock_from_other_thread());
+}
+
+TEST_F(CommandControllerTest, scene_is_only_published_again_once_it_has_changed)
+{
+    auto container = std::make_shared<testing::NiceMock<test::MockContainer>>();
+    state->add(container);
+
+    command_controller->publish_scene();
+    auto const first = command_controller->scene();
+    command_controller->publish_scene();
+    ASSERT_EQ(command_controller->scene(), first);
+
+    state->focus_container(container);
+    command_controller->publish_scene();
+    auto const second = command_controller->scene();
+    ASSERT_GT(second->version, first->version);
+    ASSERT_EQ(second->focused, reinterpret_cast<uintptr_t>(container.get()));
+    ASSERT_TRUE(second->find(reinterpret_cast<uintptr_t>(container.get()))->is_focused);
+}
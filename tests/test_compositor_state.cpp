@@ -0,0 +1,104 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "compositor_state.h"
+#include "stub_container.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+
+namespace
+{
+std::vector<std::shared_ptr<Container>> order_of(CompositorState const& state)
+{
+    std::vector<std::shared_ptr<Container>> result;
+    for (auto const& container : state.containers())
+        result.push_back(container.lock());
+    return result;
+}
+}
+
+class CompositorStateTest : public testing::Test
+{
+public:
+    CompositorState state;
+    std::shared_ptr<Container> a = std::make_shared<test::StubContainer>();
+    std::shared_ptr<Container> b = std::make_shared<test::StubContainer>();
+    std::shared_ptr<Container> c = std::make_shared<test::StubContainer>();
+};
+
+TEST_F(CompositorStateTest, focusing_a_container_moves_it_to_the_front)
+{
+    state.add(a);
+    state.add(b);
+    state.add(c);
+    state.focus_container(c);
+    state.focus_container(b);
+
+    EXPECT_EQ(state.focused_container(), b);
+    EXPECT_EQ(order_of(state), (std::vector { b, c, a }));
+}
+
+TEST_F(CompositorStateTest, removing_a_container_keeps_the_order_of_the_rest)
+{
+    state.add(a);
+    state.add(b);
+    state.add(c);
+    state.remove(b);
+
+    EXPECT_EQ(order_of(state), (std::vector { a, c }));
+}
+
+TEST_F(CompositorStateTest, removing_an_unknown_container_does_nothing)
+{
+    state.add(a);
+    state.remove(b);
+
+    EXPECT_EQ(order_of(state), (std::vector { a }));
+}
+
+TEST_F(CompositorStateTest, containers_that_were_never_added_are_only_focused_anonymously)
+{
+    state.focus_container(a);
+    EXPECT_EQ(state.focused_container(), nullptr);
+
+    state.focus_container(a, true);
+    EXPECT_EQ(state.focused_container(), a);
+    EXPECT_TRUE(state.containers().empty());
+}
+
+TEST_F(CompositorStateTest, animations_are_suppressed_until_the_outermost_suppression_ends)
+{
+    {
+        AnimationSuppression outer(state);
+        {
+            AnimationSuppression inner(state);
+            EXPECT_TRUE(state.animations_suppressed());
+        }
+        EXPECT_TRUE(state.animations_suppressed());
+    }
+    EXPECT_FALSE(state.animations_suppressed());
+}
+
+TEST_F(CompositorStateTest, animations_are_suppressed_in_the_reduced_quality_tier)
+{
+    state.set_quality_tier(QualityTier::reduced);
+    EXPECT_TRUE(state.animations_suppressed());
+
+    state.set_quality_tier(QualityTier::full);
+    EXPECT_FALSE(state.animations_suppressed());
+}
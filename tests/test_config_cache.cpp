@@ -0,0 +1,121 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "config_cache.h"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+using namespace miracle;
+
+class ConfigCacheTest : public testing::Test
+{
+public:
+    void SetUp() override
+    {
+        directory = std::filesystem::temp_directory_path() / ("miracle-config-cache-" + std::to_string(getpid()));
+        config_path = directory / "config.yaml";
+        std::filesystem::create_directories(directory);
+        write_config("inner_gaps: { x: 1, y: 2 }\n");
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(directory);
+    }
+
+    void write_config(std::string const& contents)
+    {
+        std::ofstream(config_path, std::ios::trunc) << contents;
+        this->contents = contents;
+    }
+
+    std::filesystem::path directory;
+    std::filesystem::path config_path;
+    std::string contents;
+};
+
+TEST_F(ConfigCacheTest, stored_entries_can_be_loaded)
+{
+    ConfigCache const cache(directory / "cache");
+    auto const key = ConfigCache::key(config_path, contents);
+    std::string const data = "parsed configuration";
+    cache.store(key, data);
+
+    auto const entry = cache.load(key);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(std::string(entry->data().begin(), entry->data().end()), data);
+}
+
+TEST_F(ConfigCacheTest, missing_entries_are_not_loaded)
+{
+    ConfigCache const cache(directory / "cache");
+    EXPECT_EQ(cache.load(ConfigCache::key(config_path, contents)), nullptr);
+}
+
+TEST_F(ConfigCacheTest, entries_are_not_loaded_once_the_file_changes)
+{
+    ConfigCache const cache(directory / "cache");
+    cache.store(ConfigCache::key(config_path, contents), std::string_view("stale"));
+
+    write_config("inner_gaps: { x: 3, y: 4 }\n");
+    EXPECT_EQ(cache.load(ConfigCache::key(config_path, contents)), nullptr);
+}
+
+TEST_F(ConfigCacheTest, keys_differ_by_contents)
+{
+    EXPECT_NE(ConfigCache::key(config_path, "a").hash, ConfigCache::key(config_path, "b").hash);
+}
+
+TEST_F(ConfigCacheTest, truncated_entries_are_not_loaded)
+{
+    ConfigCache const cache(directory / "cache");
+    auto const key = ConfigCache::key(config_path, contents);
+    cache.store(key, std::string_view("parsed configuration"));
+
+    for (auto const& file : std::filesystem::directory_iterator(directory / "cache"))
+        std::filesystem::resize_file(file.path(), std::filesystem::file_size(file.path()) - 4);
+
+    EXPECT_EQ(cache.load(key), nullptr);
+}
+
+TEST(ConfigCacheReaderTest, reads_back_what_was_written)
+{
+    ConfigCacheWriter writer;
+    writer.write(42);
+    writer.write(std::string("hello"));
+    writer.write(true);
+
+    ConfigCacheReader reader(writer.data());
+    EXPECT_EQ(reader.read<int>(), 42);
+    EXPECT_EQ(reader.read_string(), "hello");
+    EXPECT_TRUE(reader.read<bool>());
+    EXPECT_TRUE(reader.ok());
+    EXPECT_TRUE(reader.at_end());
+}
+
+TEST(ConfigCacheReaderTest, fails_when_reading_past_the_end)
+{
+    ConfigCacheWriter writer;
+    writer.write(std::string("hello"));
+    auto const data = writer.data();
+
+    ConfigCacheReader reader(data.subspan(0, data.size() - 1));
+    EXPECT_EQ(reader.read_string(), "");
+    EXPECT_FALSE(reader.ok());
+}
@@ -0,0 +1,89 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "compositor_state.h"
+#include "container_group_container.h"
+#include "stub_container.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+
+class ContainerGroupContainerTest : public testing::Test
+{
+public:
+    std::shared_ptr<CompositorState> state = std::make_shared<CompositorState>();
+    ContainerGroupContainer group { state };
+
+    std::vector<std::shared_ptr<Container>> members() const
+    {
+        std::vector<std::shared_ptr<Container>> result;
+        group.for_each([&](std::shared_ptr<Container> const& container)
+        {
+            result.push_back(container);
+        });
+        return result;
+    }
+};
+
+TEST_F(ContainerGroupContainerTest, added_containers_are_contained)
+{
+    auto const first = std::make_shared<test::StubContainer>();
+    auto const second = std::make_shared<test::StubContainer>();
+    group.add(first);
+
+    EXPECT_TRUE(group.contains(first));
+    EXPECT_FALSE(group.contains(second));
+}
+
+TEST_F(ContainerGroupContainerTest, adding_a_container_twice_keeps_one_entry)
+{
+    auto const container = std::make_shared<test::StubContainer>();
+    group.add(container);
+    group.add(container);
+
+    EXPECT_EQ(group.get_containers().size(), 1);
+}
+
+TEST_F(ContainerGroupContainerTest, removal_keeps_the_selection_order)
+{
+    std::vector<std::shared_ptr<Container>> containers;
+    for (int i = 0; i < 4; i++)
+    {
+        containers.push_back(std::make_shared<test::StubContainer>());
+        group.add(containers.back());
+    }
+
+    group.remove(containers[1]);
+
+    EXPECT_FALSE(group.contains(containers[1]));
+    EXPECT_EQ(members(), (std::vector { containers[0], containers[2], containers[3] }));
+
+    group.remove(containers[0]);
+    group.add(containers[1]);
+    EXPECT_EQ(members(), (std::vector { containers[2], containers[3], containers[1] }));
+}
+
+TEST_F(ContainerGroupContainerTest, expired_members_are_skipped)
+{
+    auto const kept = std::make_shared<test::StubContainer>();
+    auto expired = std::make_shared<test::StubContainer>();
+    group.add(kept);
+    group.add(expired);
+    expired.reset();
+
+    EXPECT_EQ(members(), (std::vector<std::shared_ptr<Container>> { kept }));
+}
@@ -0,0 +1,126 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "container_index.h"
+#include "mock_container.h"
+#include "mock_window_controller.h"
+#include "stub_session.h"
+#include "stub_surface.h"
+#include <gtest/gtest.h>
+#include <memory>
+
+using namespace miracle;
+
+class ContainerIndexTest : public testing::Test
+{
+public:
+    ContainerIndexTest()
+    {
+        index.update(editor, { .app_id = "org.gnome.TextEditor", .title = "notes.txt", .workspace = "1", .floating = false });
+        index.update(terminal, { .app_id = "kitty", .title = "vim notes.txt", .workspace = "2", .floating = false });
+        index.update(calculator, { .app_id = "org.gnome.Calculator", .title = "Calculator", .workspace = "2", .floating = true });
+    }
+
+    std::vector<std::shared_ptr<Container>> find(char const* criteria)
+    {
+        IpcCommandParser parser(criteria);
+        return index.find(parser.parse().scope);
+    }
+
+    ContainerIndex index { nullptr };
+    std::shared_ptr<Container> editor = std::make_shared<testing::NiceMock<test::MockContainer>>();
+    std::shared_ptr<Container> terminal = std::make_shared<testing::NiceMock<test::MockContainer>>();
+    std::shared_ptr<Container> calculator = std::make_shared<testing::NiceMock<test::MockContainer>>();
+};
+
+TEST_F(ContainerIndexTest, MatchesAppIdPatterns)
+{
+    auto const matches = find("[app_id=\"^org\\.gnome\\.\"]");
+    ASSERT_EQ(matches.size(), 2);
+    EXPECT_NE(std::find(matches.begin(), matches.end(), editor), matches.end());
+    EXPECT_NE(std::find(matches.begin(), matches.end(), calculator), matches.end());
+}
+
+TEST_F(ContainerIndexTest, EveryCriterionMustBeMet)
+{
+    auto const matches = find("[title=\"notes\" workspace=\"2\"]");
+    ASSERT_EQ(matches.size(), 1);
+    EXPECT_EQ(matches[0], terminal);
+}
+
+TEST_F(ContainerIndexTest, MatchesFloatingAndTiling)
+{
+    auto const floating = find("[floating]");
+    ASSERT_EQ(floating.size(), 1);
+    EXPECT_EQ(floating[0], calculator);
+    EXPECT_EQ(find("[tiling]").size(), 2);
+}
+
+TEST_F(ContainerIndexTest, MatchesContainerIds)
+{
+    auto const criteria = "[con_id=" + std::to_string(reinterpret_cast<std::uintptr_t>(terminal.get())) + "]";
+    auto const matches = find(criteria.c_str());
+    ASSERT_EQ(matches.size(), 1);
+    EXPECT_EQ(matches[0], terminal);
+}
+
+TEST_F(ContainerIndexTest, UpdatesReplaceTheIndexedAttributes)
+{
+    index.update(editor, { .app_id = "org.gnome.TextEditor", .title = "todo.txt", .workspace = "3", .floating = false });
+    EXPECT_EQ(find("[title=\"notes\" workspace=\"1\"]").size(), 0);
+    ASSERT_EQ(find("[workspace=\"3\"]").size(), 1);
+}
+
+TEST_F(ContainerIndexTest, RemovedContainersAreNotFound)
+{
+    index.remove(terminal.get());
+    EXPECT_EQ(index.size(), 2);
+    EXPECT_EQ(find("[app_id=\"kitty\"]").size(), 0);
+}
+
+TEST_F(ContainerIndexTest, UnsupportedAndInvalidCriteriaMatchNothing)
+{
+    EXPECT_EQ(find("[con_mark=\"mine\"]").size(), 0);
+    EXPECT_EQ(find("[title=\"(unclosed\"]").size(), 0);
+}
+
+TEST(ContainerIndexRefreshTest, RefreshPicksUpANewAppId)
+{
+    auto const window_controller = std::make_shared<testing::NiceMock<test::MockWindowController>>();
+    ContainerIndex index { window_controller };
+
+    miral::Window window(std::make_shared<test::StubSession>(), std::make_shared<test::StubSurface>());
+    miral::WindowSpecification spec;
+    miral::WindowInfo info(window, spec);
+    info.application_id("placeholder");
+
+    auto const container = std::make_shared<testing::NiceMock<test::MockContainer>>();
+    ON_CALL(*container, window()).WillByDefault(testing::Return(window));
+    ON_CALL(*window_controller, info_for(testing::A<miral::Window const&>())).WillByDefault(testing::ReturnRef(info));
+
+    index.on_window_changed(WindowChange::created, *container);
+    IpcCommandParser placeholder("[app_id=\"placeholder\"]");
+    EXPECT_EQ(index.find(placeholder.parse().scope).size(), 1);
+
+    // A client may set its app_id after the window was created
+    info.application_id("org.gnome.TextEditor");
+    index.refresh(*container);
+    IpcCommandParser editor("[app_id=\"TextEditor\"]");
+    EXPECT_EQ(index.find(editor.parse().scope).size(), 1);
+    IpcCommandParser placeholder_again("[app_id=\"placeholder\"]");
+    EXPECT_EQ(index.find(placeholder_again.parse().scope).size(), 0);
+}
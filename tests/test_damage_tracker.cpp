@@ -0,0 +1,157 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "damage_tracker.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+namespace geom = mir::geometry;
+
+namespace
+{
+int const ID_1 = 1;
+int const ID_2 = 2;
+
+DamageTrackerEntry create_entry(int const& id, geom::Rectangle const& area, int buffer_id = 0)
+{
+    return DamageTrackerEntry {
+        .id = &id,
+        .buffer_id = mir::graphics::BufferID { static_cast<uint32_t>(buffer_id) },
+        .area = area
+    };
+}
+}
+
+class DamageTrackerTest : public testing::Test
+{
+public:
+    DamageTracker tracker;
+    geom::Rectangle const first_area { geom::Point { 0, 0 }, geom::Size { 100, 100 } };
+    geom::Rectangle const second_area { geom::Point { 200, 200 }, geom::Size { 50, 50 } };
+};
+
+TEST_F(DamageTrackerTest, first_frame_requires_full_redraw)
+{
+    auto result = tracker.next_frame({ create_entry(ID_1, first_area) }, 1);
+    EXPECT_EQ(result, std::nullopt);
+}
+
+TEST_F(DamageTrackerTest, unknown_buffer_age_requires_full_redraw)
+{
+    tracker.next_frame({ create_entry(ID_1, first_area) }, 1);
+    auto result = tracker.next_frame({ create_entry(ID_1, first_area) }, 0);
+    EXPECT_EQ(result, std::nullopt);
+}
+
+TEST_F(DamageTrackerTest, unchanged_frame_has_no_damage)
+{
+    tracker.next_frame({ create_entry(ID_1, first_area) }, 1);
+    auto result = tracker.next_frame({ create_entry(ID_1, first_area) }, 1);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->size, geom::Size());
+}
+
+TEST_F(DamageTrackerTest, new_buffer_damages_the_area_of_the_renderable)
+{
+    tracker.next_frame({ create_entry(ID_1, first_area), create_entry(ID_2, second_area) }, 1);
+    auto result = tracker.next_frame({ create_entry(ID_1, first_area), create_entry(ID_2, second_area, 1) }, 1);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result.value(), second_area);
+}
+
+TEST_F(DamageTrackerTest, moving_a_renderable_damages_both_the_old_and_new_area)
+{
+    tracker.next_frame({ create_entry(ID_1, first_area) }, 1);
+    auto result = tracker.next_frame({ create_entry(ID_1, second_area) }, 1);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result.value(), geom::Rectangle(geom::Point { 0, 0 }, geom::Size { 250, 250 }));
+}
+
+TEST_F(DamageTrackerTest, removing_a_renderable_damages_its_old_area)
+{
+    tracker.next_frame({ create_entry(ID_1, first_area), create_entry(ID_2, second_area) }, 1);
+    auto result = tracker.next_frame({ create_entry(ID_1, first_area) }, 1);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result.value(), second_area);
+}
+
+TEST_F(DamageTrackerTest, restacking_renderables_damages_both)
+{
+    tracker.next_frame({ create_entry(ID_1, first_area), create_entry(ID_2, second_area) }, 1);
+    auto result = tracker.next_frame({ create_entry(ID_2, second_area), create_entry(ID_1, first_area) }, 1);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result.value(), geom::Rectangle(geom::Point { 0, 0 }, geom::Size { 250, 250 }));
+}
+
+TEST_F(DamageTrackerTest, older_buffers_accumulate_damage_from_previous_frames)
+{
+    tracker.next_frame({ create_entry(ID_1, first_area), create_entry(ID_2, second_area) }, 1);
+    tracker.next_frame({ create_entry(ID_1, first_area, 1), create_entry(ID_2, second_area) }, 1);
+    auto result = tracker.next_frame({ create_entry(ID_1, first_area, 1), create_entry(ID_2, second_area, 1) }, 2);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result.value(), geom::Rectangle(geom::Point { 0, 0 }, geom::Size { 250, 250 }));
+}
+
+TEST_F(DamageTrackerTest, buffer_older_than_history_requires_full_redraw)
+{
+    tracker.next_frame({ create_entry(ID_1, first_area) }, 1);
+    tracker.next_frame({ create_entry(ID_1, first_area) }, 1);
+    auto result = tracker.next_frame({ create_entry(ID_1, first_area) }, 3);
+    EXPECT_EQ(result, std::nullopt);
+}
+
+TEST_F(DamageTrackerTest, invalidate_requires_full_redraw)
+{
+    tracker.next_frame({ create_entry(ID_1, first_area) }, 1);
+    tracker.invalidate();
+    auto result = tracker.next_frame({ create_entry(ID_1, first_area) }, 1);
+    EXPECT_EQ(result, std::nullopt);
+}
+
+TEST_F(DamageTrackerTest, buffer_of_the_last_frame_is_up_to_date)
+{
+    tracker.next_frame({ create_entry(ID_1, first_area) }, 1);
+    EXPECT_TRUE(tracker.is_up_to_date(1));
+    EXPECT_FALSE(tracker.is_up_to_date(0));
+}
+
+TEST_F(DamageTrackerTest, older_buffer_is_only_up_to_date_once_the_frames_since_are_unchanged)
+{
+    tracker.next_frame({ create_entry(ID_1, first_area) }, 1);
+    tracker.next_frame({ create_entry(ID_1, first_area, 1) }, 1);
+    EXPECT_FALSE(tracker.is_up_to_date(2));
+
+    tracker.repeat_frame();
+    EXPECT_TRUE(tracker.is_up_to_date(2));
+    EXPECT_FALSE(tracker.is_up_to_date(3));
+}
+
+TEST_F(DamageTrackerTest, repeated_frames_keep_the_entries_to_compare_against)
+{
+    tracker.next_frame({ create_entry(ID_1, first_area) }, 1);
+    tracker.repeat_frame();
+    auto result = tracker.next_frame({ create_entry(ID_1, first_area, 1) }, 2);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result.value(), first_area);
+}
+
+TEST_F(DamageTrackerTest, invalidated_tracker_is_not_up_to_date)
+{
+    tracker.next_frame({ create_entry(ID_1, first_area) }, 1);
+    tracker.invalidate();
+    EXPECT_FALSE(tracker.is_up_to_date(1));
+}
@@ -0,0 +1,79 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "debug_log.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+
+namespace
+{
+int evaluations = 0;
+
+int evaluate()
+{
+    return ++evaluations;
+}
+}
+
+class DebugLogTest : public testing::Test
+{
+public:
+    DebugLogTest()
+    {
+        evaluations = 0;
+        DebugLog::enable(0);
+    }
+
+    ~DebugLogTest() override
+    {
+        DebugLog::enable(0);
+    }
+};
+
+TEST_F(DebugLogTest, arguments_are_not_evaluated_while_the_category_is_disabled)
+{
+    MIRACLE_LOG_DEBUG(LogCategory::ipc, "value: %d", evaluate());
+    EXPECT_EQ(evaluations, 0);
+}
+
+TEST_F(DebugLogTest, arguments_are_evaluated_once_the_category_is_enabled)
+{
+    DebugLog::enable(static_cast<uint32_t>(LogCategory::ipc));
+    MIRACLE_LOG_DEBUG(LogCategory::ipc, "value: %d", evaluate());
+    MIRACLE_LOG_DEBUG(LogCategory::render, "value: %d", evaluate());
+    EXPECT_EQ(evaluations, 1);
+}
+
+TEST_F(DebugLogTest, categories_are_parsed_by_name)
+{
+    EXPECT_EQ(DebugLog::parse("ipc,render"),
+        static_cast<uint32_t>(LogCategory::ipc) | static_cast<uint32_t>(LogCategory::render));
+    EXPECT_EQ(DebugLog::parse(""), 0u);
+    EXPECT_EQ(DebugLog::parse("all"), all_log_categories);
+}
+
+TEST_F(DebugLogTest, unknown_categories_are_rejected)
+{
+    EXPECT_EQ(DebugLog::parse("ipc,nonsense"), std::nullopt);
+}
+
+TEST_F(DebugLogTest, every_category_is_compiled_in_by_default)
+{
+    for (uint32_t bit = 1; bit <= all_log_categories; bit <<= 1)
+        EXPECT_TRUE(is_log_category_compiled(static_cast<LogCategory>(bit))) << log_category_name(static_cast<LogCategory>(bit));
+}
@@ -69,7 +69,7 @@ public:
                 .modifiers = mir_input_event_modifier_meta }));
     }
 
-    std::recursive_mutex mutex;
+    WindowManagerMutex mutex;
     std::vector<StubWindowData> data;
     test::MockOutputFactory* output_factory = new test::MockOutputFactory();
     std::shared_ptr<OutputManager> output_manager;
@@ -219,3 +219,79 @@ TEST_F(DragAndDropServiceTest, can_drag_to_other_container)
         mir_pointer_action_button_down,
         mir_input_event_modifier_none);
 }
+
+TEST_F(DragAndDropServiceTest, dragging_over_a_container_previews_it_until_drop)
+{
+    test::MockOutput* mock_output = new test::MockOutput();
+    std::vector<std::shared_ptr<WorkspaceInterface>> workspaces;
+    ON_CALL(*mock_output, get_workspaces())
+        .WillByDefault(::testing::ReturnRef(workspaces));
+    EXPECT_CALL(*output_factory, create(::testing::_, ::testing::_, ::testing::_))
+        .WillOnce(testing::Return(std::unique_ptr<OutputInterface>(mock_output)));
+    output_manager->create("Output1", 1, {
+                                             { 0,    0    },
+                                             { 1920, 1080 }
+    },
+        *workspace_manager);
+
+    auto container_drag = std::make_shared<::testing::NiceMock<test::MockContainer>>();
+    state->add(container_drag);
+    state->focus_container(container_drag);
+    ON_CALL(*mock_output, intersect(::testing::_, ::testing::_))
+        .WillByDefault(::testing::Return(container_drag));
+
+    ON_CALL(*container_drag, drag_start())
+        .WillByDefault(::testing::Return(true));
+
+    service.handle_pointer_event(
+        *state,
+        100,
+        100,
+        mir_pointer_action_button_down,
+        mir_input_event_modifier_meta);
+
+    auto other_container = std::make_shared<::testing::NiceMock<test::MockContainer>>();
+    state->add(other_container);
+
+    geom::Rectangle const other_area {
+        { 400, 400 },
+        { 400, 400 }
+    };
+    std::shared_ptr<test::MockWorkspace> workspace = std::make_shared<test::MockWorkspace>();
+    ON_CALL(*mock_output, active())
+        .WillByDefault(::testing::Return(workspace.get()));
+    ON_CALL(*mock_output, intersect_leaf(::testing::_, ::testing::_, ::testing::_))
+        .WillByDefault(::testing::Return(other_container));
+    ON_CALL(*workspace, is_empty())
+        .WillByDefault(::testing::Return(false));
+    ON_CALL(*container_drag, get_type())
+        .WillByDefault(::testing::Return(ContainerType::leaf));
+    ON_CALL(*other_container, get_type())
+        .WillByDefault(::testing::Return(ContainerType::leaf));
+    ON_CALL(*other_container, get_visible_area())
+        .WillByDefault(::testing::Return(other_area));
+
+    EXPECT_CALL(*container_drag, move_to(::testing::_)).Times(0);
+
+    service.handle_pointer_event(
+        *state,
+        500,
+        500,
+        mir_pointer_action_motion,
+        mir_input_event_modifier_meta);
+
+    ASSERT_TRUE(state->drag_preview().has_value());
+    EXPECT_EQ(state->drag_preview().value(), other_area);
+    ::testing::Mock::VerifyAndClearExpectations(container_drag.get());
+
+    EXPECT_CALL(*container_drag, move_to(::testing::_));
+
+    service.handle_pointer_event(
+        *state,
+        500,
+        500,
+        mir_pointer_action_button_up,
+        mir_input_event_modifier_meta);
+
+    EXPECT_FALSE(state->drag_preview().has_value());
+}
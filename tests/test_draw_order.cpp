@@ -0,0 +1,99 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "draw_order.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+namespace geom = mir::geometry;
+
+namespace
+{
+geom::Rectangle tile(int column)
+{
+    return geom::Rectangle { geom::Point { column * 100, 0 }, geom::Size { 100, 100 } };
+}
+
+std::vector<size_t> expected(std::initializer_list<size_t> indices)
+{
+    return std::vector<size_t>(indices);
+}
+}
+
+TEST(DrawOrderTest, empty_list_has_empty_order)
+{
+    EXPECT_TRUE(sort_draw_order({}).empty());
+}
+
+TEST(DrawOrderTest, non_overlapping_items_are_grouped_by_batch)
+{
+    auto const order = sort_draw_order({
+        { tile(0), 1 },
+        { tile(1), 2 },
+        { tile(2), 1 },
+        { tile(3), 2 }
+    });
+    EXPECT_EQ(order, expected({ 0, 2, 1, 3 }));
+}
+
+TEST(DrawOrderTest, overlapping_items_keep_their_stacking_order)
+{
+    auto const order = sort_draw_order({
+        { tile(0), 1 },
+        { tile(0), 2 },
+        { tile(0), 1 }
+    });
+    EXPECT_EQ(order, expected({ 0, 1, 2 }));
+}
+
+TEST(DrawOrderTest, item_is_grouped_once_the_items_below_it_are_drawn)
+{
+    // Item 2 overlaps item 1, so it can only join the batch of item 0 after item 1 is drawn.
+    auto const order = sort_draw_order({
+        { tile(0), 1 },
+        { tile(1), 2 },
+        { geom::Rectangle { geom::Point { 150, 0 }, geom::Size { 100, 100 } }, 1 },
+        { tile(3), 1 }
+    });
+    EXPECT_EQ(order, expected({ 0, 3, 1, 2 }));
+}
+
+TEST(DrawOrderTest, transformed_item_keeps_its_stacking_position)
+{
+    // Item 1 may be drawn anywhere, so item 2 cannot move below it to join item 0
+    auto const order = sort_draw_order({
+        { tile(0), 1 },
+        { tile(1), 2, true },
+        { tile(2), 1 }
+    });
+    EXPECT_EQ(order, expected({ 0, 1, 2 }));
+}
+
+TEST(DrawOrderTest, sorting_in_an_arena_matches_sorting_on_the_heap)
+{
+    std::vector<DrawOrderItem> const items {
+        { tile(0), 1 },
+        { tile(0), 2 },
+        { tile(1), 1 },
+        { tile(2), 2 },
+        { tile(1), 2 }
+    };
+
+    FrameArena arena;
+    auto const order = sort_draw_order(items, arena);
+    EXPECT_EQ(std::vector<size_t>(order.begin(), order.end()), sort_draw_order(items));
+}
@@ -0,0 +1,130 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "easing.h"
+#include <chrono>
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace miracle;
+
+class EasingTest : public testing::TestWithParam<int>
+{
+public:
+    AnimationDefinition const definition { .function = static_cast<EaseFunction>(GetParam()) };
+};
+
+TEST_P(EasingTest, starts_at_zero_and_ends_at_one)
+{
+    EXPECT_NEAR(ease(definition, 0.f), 0.f, 1e-3);
+    EXPECT_NEAR(ease(definition, 1.f), 1.f, 1e-3);
+}
+
+TEST_P(EasingTest, batch_matches_single_evaluation)
+{
+    std::vector<float> t;
+    for (int i = 0; i <= 100; i++)
+        t.push_back(static_cast<float>(i) / 100.f);
+
+    std::vector<float> out(t.size());
+    ease_batch(definition, t.data(), out.data(), t.size());
+    for (size_t i = 0; i < t.size(); i++)
+        EXPECT_FLOAT_EQ(out[i], ease(definition, t[i]));
+}
+
+TEST_P(EasingTest, table_matches_analytic_evaluation)
+{
+    if (!has_ease_table(definition.function))
+        GTEST_SKIP() << "This function is evaluated analytically";
+
+    EaseTable const table(definition);
+    for (int i = 0; i <= 10'000; i++)
+    {
+        float const t = static_cast<float>(i) / 10'000.f;
+        EXPECT_NEAR(table(t), ease(definition, t), 1e-3) << "t=" << t;
+    }
+}
+
+TEST_P(EasingTest, table_is_exact_at_the_endpoints)
+{
+    EaseTable const table(definition);
+    EXPECT_FLOAT_EQ(table(0.f), ease(definition, 0.f));
+    EXPECT_FLOAT_EQ(table(1.f), ease(definition, 1.f));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    AllEaseFunctions,
+    EasingTest,
+    testing::Range(0, static_cast<int>(EaseFunction::max)));
+
+TEST(EaseTest, linear_is_identity)
+{
+    AnimationDefinition const definition { .function = EaseFunction::linear };
+    EXPECT_FLOAT_EQ(ease(definition, 0.25f), 0.25f);
+}
+
+TEST(EaseTest, cheap_functions_are_not_tabulated)
+{
+    AnimationDefinition definition { .function = EaseFunction::linear };
+    compile_ease_table(definition);
+    EXPECT_EQ(definition.ease_table, nullptr);
+}
+
+TEST(EaseTest, compiled_definitions_are_evaluated_with_their_table)
+{
+    AnimationDefinition definition { .function = EaseFunction::ease_in_out_elastic };
+    compile_ease_table(definition);
+    ASSERT_NE(definition.ease_table, nullptr);
+    EXPECT_FLOAT_EQ(ease(definition, 0.3f), (*definition.ease_table)(0.3f));
+}
+
+/// Compares the speed of the ease tables with analytic evaluation. Run with
+/// --gtest_also_run_disabled_tests.
+TEST(EaseTest, DISABLED_benchmark_table_against_analytic)
+{
+    size_t const count = 1 << 20;
+    std::vector<float> t(count);
+    for (size_t i = 0; i < count; i++)
+        t[i] = static_cast<float>(i) / static_cast<float>(count - 1);
+    std::vector<float> out(count);
+
+    auto const measure = [&](auto const& f)
+    {
+        auto const start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+    };
+
+    for (int i = 0; i < static_cast<int>(EaseFunction::max); i++)
+    {
+        AnimationDefinition definition { .function = static_cast<EaseFunction>(i) };
+        auto const analytic = measure([&] { ease_batch_exact(definition, t.data(), out.data(), count); });
+        compile_ease_table(definition);
+        auto const table = measure([&] { ease_batch(definition, t.data(), out.data(), count); });
+
+        float max_error = 0;
+        for (size_t j = 0; j < count; j += 97)
+        {
+            float exact;
+            ease_batch_exact(definition, &t[j], &exact, 1);
+            max_error = std::max(max_error, std::abs(out[j] - exact));
+        }
+
+        std::cout << "function " << i << ": analytic " << analytic << "ns, table " << table
+                  << "ns, max error " << max_error << std::endl;
+    }
+}
@@ -0,0 +1,113 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "event_recording.h"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <vector>
+
+using namespace miracle;
+
+namespace
+{
+std::vector<RecordedEvent> read_all(std::string const& data)
+{
+    std::istringstream in(data);
+    EventReader reader(in);
+    std::vector<RecordedEvent> events;
+    while (auto event = reader.next())
+        events.push_back(std::move(event.value()));
+    return events;
+}
+}
+
+TEST(EventRecordingTest, events_are_read_back_as_they_were_written)
+{
+    std::ostringstream out;
+    EventWriter writer(out);
+    writer.write({ std::chrono::microseconds(10),
+        RecordedWindowOpened { 1, { { -20, 30 }, { 640, 480 } }, 2, 3 } });
+    writer.write({ std::chrono::microseconds(15), RecordedKeyboardEvent { 1, 0x61, -4, 0x8 } });
+    writer.write({ std::chrono::microseconds(15), RecordedPointerEvent { 2, 12.5f, 300.25f, 1, 0 } });
+    writer.write({ std::chrono::microseconds(400), RecordedIpcCommand { "workspace number 2" } });
+    writer.write({ std::chrono::microseconds(500),
+        RecordedOutputEvent { RecordedOutputChange::updated, 7, "HDMI-1", { { 1920, 0 }, { 1280, 720 } } } });
+    writer.write({ std::chrono::microseconds(1'000'000), RecordedWindowClosed { 1 } });
+
+    auto const events = read_all(out.str());
+    ASSERT_EQ(events.size(), 6u);
+
+    EXPECT_EQ(events[0].time, std::chrono::microseconds(10));
+    auto const& opened = std::get<RecordedWindowOpened>(events[0].payload);
+    EXPECT_EQ(opened.id, 1u);
+    EXPECT_EQ(opened.area, (mir::geometry::Rectangle { { -20, 30 }, { 640, 480 } }));
+    EXPECT_EQ(opened.type, 2u);
+    EXPECT_EQ(opened.state, 3u);
+
+    auto const& key = std::get<RecordedKeyboardEvent>(events[1].payload);
+    EXPECT_EQ(key.keysym, 0x61u);
+    EXPECT_EQ(key.scan_code, -4);
+    EXPECT_EQ(key.modifiers, 0x8u);
+
+    auto const& pointer = std::get<RecordedPointerEvent>(events[2].payload);
+    EXPECT_EQ(events[2].time, std::chrono::microseconds(15));
+    EXPECT_FLOAT_EQ(pointer.x, 12.5f);
+    EXPECT_FLOAT_EQ(pointer.y, 300.25f);
+    EXPECT_EQ(pointer.buttons, 1u);
+
+    EXPECT_EQ(std::get<RecordedIpcCommand>(events[3].payload).command, "workspace number 2");
+
+    auto const& output = std::get<RecordedOutputEvent>(events[4].payload);
+    EXPECT_EQ(output.change, RecordedOutputChange::updated);
+    EXPECT_EQ(output.id, 7);
+    EXPECT_EQ(output.name, "HDMI-1");
+    EXPECT_EQ(output.area.top_left.x.as_int(), 1920);
+
+    EXPECT_EQ(events[5].time, std::chrono::microseconds(1'000'000));
+    EXPECT_EQ(std::get<RecordedWindowClosed>(events[5].payload).id, 1u);
+}
+
+TEST(EventRecordingTest, truncated_recording_ends_at_the_last_complete_event)
+{
+    std::ostringstream out;
+    EventWriter writer(out);
+    writer.write({ std::chrono::microseconds(1), RecordedWindowClosed { 4 } });
+    auto const complete = out.str().size();
+    writer.write({ std::chrono::microseconds(2), RecordedIpcCommand { "layout tabbed" } });
+
+    auto const data = out.str();
+    for (size_t size = complete; size < data.size(); size++)
+        EXPECT_EQ(read_all(data.substr(0, size)).size(), 1u) << "size=" << size;
+    EXPECT_EQ(read_all(data).size(), 2u);
+}
+
+TEST(EventRecordingTest, stream_without_a_header_is_invalid)
+{
+    std::istringstream in("not a recording");
+    EventReader reader(in);
+    EXPECT_FALSE(reader.valid());
+    EXPECT_FALSE(reader.next());
+}
+
+TEST(EventRecordingTest, events_are_compact)
+{
+    std::ostringstream out;
+    EventWriter writer(out);
+    auto const header = out.str().size();
+    writer.write({ std::chrono::microseconds(100), RecordedPointerEvent { 2, 100.f, 200.f, 0, 0 } });
+    EXPECT_LE(out.str().size() - header, 14u);
+}
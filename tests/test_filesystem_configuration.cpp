@@ -220,6 +220,243 @@ TEST_F(FilesystemConfigurationTest, CustomActionWithInvalidCommandIsNotAdded)
     EXPECT_EQ(custom_action, nullptr);
 }
 
+TEST_F(FilesystemConfigurationTest, UnboundKeysDoNotMatchAnyCommand)
+{
+    FilesystemConfiguration config(runner, path, true);
+    EXPECT_EQ(config.matches_custom_key_command(
+                  MirKeyboardAction::mir_keyboard_action_down,
+                  KEY_X,
+                  mir_input_event_modifier_none),
+        nullptr);
+    EXPECT_FALSE(config.matches_key_command(
+        MirKeyboardAction::mir_keyboard_action_down,
+        KEY_X,
+        mir_input_event_modifier_none,
+        [&](DefaultKeyCommand)
+    {
+        return true;
+    }));
+}
+
+TEST_F(FilesystemConfigurationTest, MatchKeyIsEmptyForUnboundKeys)
+{
+    FilesystemConfiguration config(runner, path, true);
+    EXPECT_TRUE(config.match_key(
+                          MirKeyboardAction::mir_keyboard_action_down,
+                          KEY_X,
+                          mir_input_event_modifier_none)
+                    .empty());
+}
+
+TEST_F(FilesystemConfigurationTest, MatchKeyFindsTheCustomAndDefaultCommandsOfAKey)
+{
+    YAML::Node node;
+    YAML::Node custom_action_node;
+    custom_action_node["command"] = "echo Hi";
+    custom_action_node["action"] = "down";
+    custom_action_node["modifiers"].push_back("primary");
+    custom_action_node["key"] = "KEY_ENTER";
+    node["custom_actions"].push_back(custom_action_node);
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path, true);
+    auto const match = config.match_key(
+        MirKeyboardAction::mir_keyboard_action_down,
+        KEY_ENTER,
+        mir_input_event_modifier_meta);
+    ASSERT_NE(match.custom_key_command, nullptr);
+    EXPECT_EQ(match.custom_key_command->command, "echo Hi");
+    ASSERT_EQ(match.default_key_commands.size(), 1);
+    EXPECT_EQ(match.default_key_commands[0], DefaultKeyCommand::Terminal);
+}
+
+TEST_F(FilesystemConfigurationTest, DefaultActionsAreBoundToTheActionKey)
+{
+    write_kvp("action_key", "alt");
+    FilesystemConfiguration config(runner, path, true);
+
+    std::optional<DefaultKeyCommand> matched;
+    config.matches_key_command(
+        MirKeyboardAction::mir_keyboard_action_down,
+        KEY_ENTER,
+        mir_input_event_modifier_alt,
+        [&](DefaultKeyCommand command)
+    {
+        matched = command;
+        return true;
+    });
+    EXPECT_EQ(matched, DefaultKeyCommand::Terminal);
+
+    EXPECT_FALSE(config.matches_key_command(
+        MirKeyboardAction::mir_keyboard_action_down,
+        KEY_ENTER,
+        mir_input_event_modifier_meta,
+        [&](DefaultKeyCommand)
+    {
+        return true;
+    }));
+}
+
+TEST_F(FilesystemConfigurationTest, ListenersAreOnlyNotifiedOfTheSectionsTheySubscribeTo)
+{
+    write_kvp("terminal", "foot");
+    FilesystemConfiguration config(runner, path, true);
+
+    int gaps_changes = 0;
+    int terminal_changes = 0;
+    int all_changes = 0;
+    config.register_listener([&](Config&)
+    { gaps_changes++; }, ConfigSection::gaps, 5);
+    config.register_listener([&](Config&)
+    { terminal_changes++; }, ConfigSection::terminal, 5);
+    config.register_listener([&](Config&)
+    { all_changes++; }, 5);
+
+    std::ofstream(path, std::ofstream::out | std::ofstream::trunc) << "terminal: kitty\n";
+    config.reload();
+    config.try_process_change();
+
+    EXPECT_EQ(gaps_changes, 0);
+    EXPECT_EQ(terminal_changes, 1);
+    EXPECT_EQ(all_changes, 1);
+}
+
+TEST_F(FilesystemConfigurationTest, ListenersAreNotNotifiedWhenNothingChanged)
+{
+    write_kvp("terminal", "foot");
+    FilesystemConfiguration config(runner, path, true);
+
+    int changes = 0;
+    config.register_listener([&](Config&)
+    { changes++; }, 5);
+
+    config.reload();
+    config.try_process_change();
+    EXPECT_EQ(changes, 0);
+}
+
+TEST_F(FilesystemConfigurationTest, SnapshotIsReplacedOnReload)
+{
+    write_kvp("inner_gaps", "{ x: 33, y: 44 }");
+    FilesystemConfiguration config(runner, path, true);
+
+    auto const before = config.snapshot();
+    EXPECT_EQ(before->inner_gaps_x, 33);
+    EXPECT_EQ(before->half_inner_gaps_x, 17);
+    EXPECT_EQ(before->half_inner_gaps_y, 22);
+
+    std::ofstream(path, std::ofstream::out | std::ofstream::trunc) << "inner_gaps: { x: 5, y: 6 }\n";
+    config.reload();
+
+    auto const after = config.snapshot();
+    EXPECT_EQ(after->inner_gaps_x, 5);
+    EXPECT_EQ(after->half_inner_gaps_x, 3);
+    EXPECT_EQ(before->inner_gaps_x, 33);
+}
+
+TEST_F(FilesystemConfigurationTest, ReloadWithErrorsKeepsThePreviousConfiguration)
+{
+    write_kvp("inner_gaps", "{ x: 33, y: 44 }");
+    FilesystemConfiguration config(runner, path, true);
+
+    int changes = 0;
+    config.register_listener([&](Config&)
+    { changes++; }, 5);
+
+    std::ofstream(path, std::ofstream::out | std::ofstream::trunc) << "inner_gaps: { x: 5, y: 6 }\nresize_jump: [\n";
+    config.reload();
+    config.try_process_change();
+
+    EXPECT_EQ(config.get_inner_gaps_x(), 33);
+    EXPECT_EQ(config.snapshot()->inner_gaps_x, 33);
+    EXPECT_EQ(changes, 0);
+}
+
+TEST_F(FilesystemConfigurationTest, BackgroundReloadOnlyChangesTheConfigurationOnceApplied)
+{
+    write_kvp("inner_gaps", "{ x: 33, y: 44 }");
+    FilesystemConfiguration config(runner, path, true);
+
+    int changes = 0;
+    config.register_listener([&](Config&)
+    { changes++; }, 5);
+
+    std::ofstream(path, std::ofstream::out | std::ofstream::trunc) << "inner_gaps: { x: 5, y: 6 }\n";
+    config.reload_in_background();
+    EXPECT_EQ(config.get_inner_gaps_x(), 33);
+    EXPECT_EQ(config.snapshot()->inner_gaps_x, 33);
+    EXPECT_EQ(changes, 0);
+
+    config.on_parse_done();
+    EXPECT_EQ(config.get_inner_gaps_x(), 5);
+    EXPECT_EQ(config.snapshot()->inner_gaps_x, 5);
+    EXPECT_EQ(changes, 1);
+}
+
+TEST_F(FilesystemConfigurationTest, BackgroundReloadWithErrorsKeepsThePreviousConfiguration)
+{
+    write_kvp("inner_gaps", "{ x: 33, y: 44 }");
+    FilesystemConfiguration config(runner, path, true);
+
+    int changes = 0;
+    config.register_listener([&](Config&)
+    { changes++; }, 5);
+
+    std::ofstream(path, std::ofstream::out | std::ofstream::trunc) << "inner_gaps: { x: 5, y: 6 }\nresize_jump: [\n";
+    config.reload_in_background();
+    config.on_parse_done();
+
+    EXPECT_EQ(config.get_inner_gaps_x(), 33);
+    EXPECT_EQ(config.snapshot()->inner_gaps_x, 33);
+    EXPECT_EQ(changes, 0);
+}
+
+TEST_F(FilesystemConfigurationTest, CachedConfigurationMatchesTheParsedOne)
+{
+    YAML::Node node;
+    YAML::Node custom_action;
+    custom_action["command"] = "echo Hi";
+    custom_action["action"] = "down";
+    custom_action["modifiers"].push_back("primary");
+    custom_action["key"] = "KEY_X";
+    node["custom_actions"].push_back(custom_action);
+    node["action_key"] = "alt";
+    node["terminal"] = "foot";
+    node["inner_gaps"]["x"] = 33;
+    node["inner_gaps"]["y"] = 44;
+    write_yaml_node(node);
+
+    auto const cache_directory = std::filesystem::current_path() / "test-config-cache";
+    FilesystemConfiguration parsed(runner, path, true, cache_directory);
+    FilesystemConfiguration cached(runner, path, true, cache_directory);
+    std::filesystem::remove_all(cache_directory);
+
+    EXPECT_EQ(cached.get_input_event_modifier(), parsed.get_input_event_modifier());
+    EXPECT_EQ(cached.get_terminal_command(), parsed.get_terminal_command());
+    EXPECT_EQ(cached.get_inner_gaps_x(), 33);
+    EXPECT_EQ(cached.get_inner_gaps_y(), 44);
+    EXPECT_EQ(cached.get_border_config(), parsed.get_border_config());
+
+    auto const custom = cached.matches_custom_key_command(
+        MirKeyboardAction::mir_keyboard_action_down,
+        KEY_X,
+        mir_input_event_modifier_alt);
+    ASSERT_NE(custom, nullptr);
+    EXPECT_EQ(custom->command, "echo Hi");
+
+    std::optional<DefaultKeyCommand> matched;
+    cached.matches_key_command(
+        MirKeyboardAction::mir_keyboard_action_down,
+        KEY_ENTER,
+        mir_input_event_modifier_alt,
+        [&](DefaultKeyCommand command)
+    {
+        matched = command;
+        return true;
+    });
+    EXPECT_EQ(matched, DefaultKeyCommand::Terminal);
+}
+
 TEST_F(FilesystemConfigurationTest, InvalidInnerGapsResolveToDefault)
 {
     YAML::Node node;
@@ -343,6 +580,35 @@ TEST_F(FilesystemConfigurationTest, StartupAppsInvalidRestartOnDeathIsNotParsed)
     EXPECT_EQ(config.get_startup_apps().size(), 0);
 }
 
+TEST_F(FilesystemConfigurationTest, StartupAppsCanBePrioritizedAndOrdered)
+{
+    YAML::Node node;
+    YAML::Node startup_app;
+    startup_app["command"] = "waybar";
+    startup_app["priority"] = 10;
+    startup_app["after_previous"] = true;
+    node["startup_apps"].push_back(startup_app);
+    node["startup"]["concurrency"] = 2;
+    node["startup"]["app_timeout_ms"] = 1500;
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path, true);
+    EXPECT_EQ(config.get_startup_apps()[0].priority, 10);
+    EXPECT_EQ(config.get_startup_apps()[0].after_previous, true);
+    EXPECT_EQ(config.startup().concurrency, 2);
+    EXPECT_EQ(config.startup().app_timeout, std::chrono::milliseconds(1500));
+}
+
+TEST_F(FilesystemConfigurationTest, StartupNegativeConcurrencyIsNotParsed)
+{
+    YAML::Node node;
+    node["startup"]["concurrency"] = -1;
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path, true);
+    EXPECT_EQ(config.startup().concurrency, 0);
+}
+
 TEST_F(FilesystemConfigurationTest, EnvironmentVariableInvalidWhenKeyIsMissing)
 {
     YAML::Node node;
@@ -509,4 +775,215 @@ TEST_F(FilesystemConfigurationTest, DragAndDropMissingModifiers)
     FilesystemConfiguration config(runner, path, true);
     EXPECT_EQ(config.drag_and_drop().enabled, true);
     EXPECT_EQ(config.drag_and_drop().modifiers, miracle_input_event_modifier_default | mir_input_event_modifier_shift);
-}
\ No newline at end of file
+}
+
+TEST_F(FilesystemConfigurationTest, IpcAllValues)
+{
+    YAML::Node ipc;
+    ipc["max_client_queue_bytes"] = 1024;
+    ipc["overflow"]["workspace"] = "coalesce";
+    ipc["overflow"]["window"] = "drop_oldest";
+    ipc["metrics_socket"] = "/tmp/miracle-metrics.sock";
+    ipc["listen_backlog"] = 512;
+
+    YAML::Node node;
+    node["ipc"] = ipc;
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path, true);
+    EXPECT_EQ(config.ipc().max_client_queue_bytes, 1024);
+    EXPECT_EQ(config.ipc().overflow_policies.at("workspace"), IpcOverflowPolicy::coalesce);
+    EXPECT_EQ(config.ipc().overflow_policies.at("window"), IpcOverflowPolicy::drop_oldest);
+    EXPECT_EQ(config.ipc().metrics_socket, "/tmp/miracle-metrics.sock");
+    EXPECT_EQ(config.ipc().listen_backlog, 512);
+}
+
+TEST_F(FilesystemConfigurationTest, IpcInvalidOverflowPolicyIsIgnored)
+{
+    YAML::Node ipc;
+    ipc["overflow"]["workspace"] = "explode";
+
+    YAML::Node node;
+    node["ipc"] = ipc;
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path, true);
+    EXPECT_EQ(config.ipc().max_client_queue_bytes, 4'000'000);
+    EXPECT_TRUE(config.ipc().overflow_policies.empty());
+    EXPECT_TRUE(config.ipc().metrics_socket.empty());
+    EXPECT_EQ(config.ipc().listen_backlog, IpcConfiguration {}.listen_backlog);
+}
+
+TEST_F(FilesystemConfigurationTest, IpcListenBacklogMustBePositive)
+{
+    YAML::Node ipc;
+    ipc["listen_backlog"] = 0;
+
+    YAML::Node node;
+    node["ipc"] = ipc;
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path, true);
+    EXPECT_EQ(config.ipc().listen_backlog, IpcConfiguration {}.listen_backlog);
+}
+
+TEST_F(FilesystemConfigurationTest, SchedulingAllValues)
+{
+    YAML::Node animator;
+    animator["realtime"] = true;
+    animator["priority"] = 5;
+    animator["nice"] = -10;
+    animator["cpus"].push_back(2);
+    animator["cpus"].push_back(3);
+
+    YAML::Node node;
+    node["scheduling"]["animator"] = animator;
+    node["scheduling"]["render"]["nice"] = -5;
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path, true);
+    auto const scheduling = config.scheduling();
+    EXPECT_TRUE(scheduling.animator.realtime);
+    EXPECT_EQ(scheduling.animator.realtime_priority, 5);
+    EXPECT_EQ(scheduling.animator.nice, -10);
+    EXPECT_EQ(scheduling.animator.cpus, (std::vector<int> { 2, 3 }));
+    EXPECT_FALSE(scheduling.render.realtime);
+    EXPECT_EQ(scheduling.render.nice, -5);
+    EXPECT_TRUE(scheduling.render.cpus.empty());
+}
+
+TEST_F(FilesystemConfigurationTest, SchedulingDefaultsLeaveThreadsAlone)
+{
+    YAML::Node node;
+    node["inner_gaps"]["x"] = 10;
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path, true);
+    EXPECT_EQ(config.scheduling(), SchedulingConfiguration {});
+}
+
+TEST_F(FilesystemConfigurationTest, CanReadColorFilter)
+{
+    YAML::Node node;
+    node["color_filter"] = "deuteranopia";
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path, true);
+    EXPECT_EQ(config.snapshot()->color_filter, RenderFilter::deuteranopia);
+}
+
+TEST_F(FilesystemConfigurationTest, InvalidColorFilterIsIgnored)
+{
+    YAML::Node node;
+    node["color_filter"] = "sepia";
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path, true);
+    EXPECT_EQ(config.snapshot()->color_filter, RenderFilter::none);
+}
+
+TEST_F(FilesystemConfigurationTest, QualityTierIsDetectedByDefault)
+{
+    FilesystemConfiguration config(runner, path, true);
+    EXPECT_EQ(config.snapshot()->quality_tier, std::nullopt);
+}
+
+TEST_F(FilesystemConfigurationTest, CanOverrideQualityTier)
+{
+    YAML::Node node;
+    node["quality_tier"] = "reduced";
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path, true);
+    EXPECT_EQ(config.snapshot()->quality_tier, QualityTier::reduced);
+}
+
+TEST_F(FilesystemConfigurationTest, AutomaticQualityTierIsDetected)
+{
+    YAML::Node node;
+    node["quality_tier"] = "auto";
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path, true);
+    EXPECT_EQ(config.snapshot()->quality_tier, std::nullopt);
+}
+
+TEST_F(FilesystemConfigurationTest, CanReadBlur)
+{
+    YAML::Node node;
+    node["blur"]["enabled"] = true;
+    node["blur"]["passes"] = 3;
+    node["blur"]["offset"] = 1.5;
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path, true);
+    auto const& blur = config.snapshot()->blur;
+    EXPECT_TRUE(blur.enabled);
+    EXPECT_EQ(blur.passes, 3);
+    EXPECT_FLOAT_EQ(blur.offset, 1.5f);
+}
+
+TEST_F(FilesystemConfigurationTest, BlurPassesOutOfRangeAreIgnored)
+{
+    YAML::Node node;
+    node["blur"]["enabled"] = true;
+    node["blur"]["passes"] = 20;
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path, true);
+    EXPECT_EQ(config.snapshot()->blur.passes, BlurConfiguration {}.passes);
+}
+
+TEST_F(FilesystemConfigurationTest, CanReadGpuMemoryBudget)
+{
+    YAML::Node node;
+    node["gpu_memory_budget_mb"] = 64;
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path, true);
+    EXPECT_EQ(config.snapshot()->gpu_memory_budget_bytes, 64 * 1024 * 1024);
+}
+
+TEST_F(FilesystemConfigurationTest, GpuMemoryBudgetBelowOneIsIgnored)
+{
+    YAML::Node node;
+    node["gpu_memory_budget_mb"] = 0;
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path, true);
+    EXPECT_EQ(config.snapshot()->gpu_memory_budget_bytes, ConfigSnapshot {}.gpu_memory_budget_bytes);
+}
+
+TEST_F(FilesystemConfigurationTest, CanReadFrameRateCaps)
+{
+    YAML::Node node;
+    node["frame_rate_caps"]["unfocused"] = 30;
+    node["frame_rate_caps"]["static"] = 20;
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path, true);
+    auto const& caps = config.snapshot()->frame_rate_caps;
+    EXPECT_EQ(caps.unfocused, 30);
+    EXPECT_EQ(caps.static_content, 20);
+}
+
+TEST_F(FilesystemConfigurationTest, NegativeFrameRateCapsAreIgnored)
+{
+    YAML::Node node;
+    node["frame_rate_caps"]["unfocused"] = -1;
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path, true);
+    EXPECT_EQ(config.snapshot()->frame_rate_caps.unfocused, 0);
+}
+
+TEST(FrameRateCapConfigurationTest, LowerCapAppliesToAnUnfocusedOutput)
+{
+    FrameRateCapConfiguration caps { .unfocused = 30, .static_content = 20 };
+    EXPECT_EQ(caps.cap(false), 20);
+    EXPECT_EQ(caps.cap(true), 20);
+
+    caps.static_content = 0;
+    EXPECT_EQ(caps.cap(false), 30);
+    EXPECT_EQ(caps.cap(true), 0);
+}
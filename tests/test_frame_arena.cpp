@@ -0,0 +1,90 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "draw_order.h"
+#include "frame_arena.h"
+#include <cstdint>
+#include <gtest/gtest.h>
+
+using namespace miracle;
+namespace geom = mir::geometry;
+
+TEST(FrameArenaTest, allocations_are_aligned)
+{
+    FrameArena arena(256);
+    arena.allocate(1, 1);
+    auto const p = arena.allocate(sizeof(double), alignof(double));
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(p) % alignof(double), 0u);
+}
+
+TEST(FrameArenaTest, reset_frees_everything)
+{
+    FrameArena arena(256);
+    auto const first = arena.allocate(64, 8);
+    EXPECT_GE(arena.used(), 64u);
+
+    arena.reset();
+    EXPECT_EQ(arena.used(), 0u);
+    EXPECT_EQ(arena.allocate(64, 8), first);
+}
+
+TEST(FrameArenaTest, overflow_is_folded_into_the_block_on_reset)
+{
+    FrameArena arena(64);
+    for (int i = 0; i < 10; i++)
+        arena.allocate(32, 8);
+    EXPECT_GT(arena.heap_allocations(), 1u);
+
+    arena.reset();
+    EXPECT_GE(arena.capacity(), 320u);
+
+    auto const allocations = arena.heap_allocations();
+    for (int i = 0; i < 10; i++)
+        arena.allocate(32, 8);
+    EXPECT_EQ(arena.heap_allocations(), allocations);
+}
+
+TEST(FrameArenaTest, containers_may_allocate_from_the_arena)
+{
+    FrameArena arena(1024);
+    FrameVector<int> values { FrameArenaAllocator<int>(arena) };
+    for (int i = 0; i < 100; i++)
+        values.push_back(i);
+
+    EXPECT_EQ(values.back(), 99);
+    EXPECT_GE(arena.used(), 100 * sizeof(int));
+}
+
+TEST(FrameArenaTest, sorting_the_same_scene_stops_allocating_after_the_first_frame)
+{
+    std::vector<DrawOrderItem> items;
+    for (int i = 0; i < 64; i++)
+        items.push_back({ geom::Rectangle { geom::Point { (i % 8) * 50, 0 }, geom::Size { 100, 100 } }, static_cast<std::uint64_t>(i % 3) });
+
+    FrameArena arena(256);
+    arena.reset();
+    sort_draw_order(items, arena);
+    arena.reset();
+
+    auto const allocations = arena.heap_allocations();
+    for (int frame = 0; frame < 100; frame++)
+    {
+        arena.reset();
+        sort_draw_order(items, arena);
+    }
+    EXPECT_EQ(arena.heap_allocations(), allocations);
+}
@@ -0,0 +1,141 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "frame_clock.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace miracle;
+using namespace std::chrono_literals;
+
+namespace
+{
+int const OUTPUT_60HZ = 1;
+int const OUTPUT_144HZ = 2;
+}
+
+class FrameClockTest : public testing::Test
+{
+public:
+    FrameClock clock;
+
+    /// Presents [count] frames on [output] at [interval], ending now.
+    void present(void const* output, std::chrono::nanoseconds interval, int count)
+    {
+        auto const now = FrameClock::clock::now();
+        for (int i = count - 1; i >= 0; i--)
+            clock.on_frame(output, now - interval * i);
+    }
+};
+
+TEST_F(FrameClockTest, refresh_interval_defaults_to_60hz)
+{
+    EXPECT_EQ(clock.refresh_interval(), 16'666'667ns);
+}
+
+TEST_F(FrameClockTest, refresh_interval_is_measured_from_frames)
+{
+    present(&OUTPUT_144HZ, 6944us, 10);
+    EXPECT_EQ(clock.refresh_interval(), 6944us);
+}
+
+TEST_F(FrameClockTest, fastest_output_sets_the_refresh_interval)
+{
+    present(&OUTPUT_60HZ, 16667us, 5);
+    present(&OUTPUT_144HZ, 6944us, 5);
+    EXPECT_EQ(clock.refresh_interval(), 6944us);
+}
+
+TEST_F(FrameClockTest, removing_the_fastest_output_falls_back_to_the_next)
+{
+    present(&OUTPUT_60HZ, 16667us, 5);
+    present(&OUTPUT_144HZ, 6944us, 5);
+    clock.remove(&OUTPUT_144HZ);
+    EXPECT_EQ(clock.refresh_interval(), 16667us);
+}
+
+TEST_F(FrameClockTest, wait_for_frame_times_out_without_frames)
+{
+    EXPECT_FALSE(clock.wait_for_frame(1ms));
+}
+
+TEST_F(FrameClockTest, wait_for_frame_returns_when_fastest_output_presents)
+{
+    present(&OUTPUT_144HZ, 6944us, 5);
+    std::thread presenter([&]
+    {
+        std::this_thread::sleep_for(5ms);
+        clock.on_frame(&OUTPUT_144HZ);
+    });
+
+    EXPECT_TRUE(clock.wait_for_frame(5s));
+    presenter.join();
+}
+
+TEST_F(FrameClockTest, frames_of_slower_outputs_are_not_counted)
+{
+    present(&OUTPUT_60HZ, 16667us, 5);
+    present(&OUTPUT_144HZ, 6944us, 5);
+    std::thread presenter([&]
+    {
+        std::this_thread::sleep_for(5ms);
+        clock.on_frame(&OUTPUT_60HZ);
+    });
+
+    EXPECT_FALSE(clock.wait_for_frame(50ms));
+    presenter.join();
+}
+
+TEST_F(FrameClockTest, render_time_is_zero_without_frames)
+{
+    EXPECT_EQ(clock.render_time(), 0ns);
+}
+
+TEST_F(FrameClockTest, render_time_is_that_of_the_slowest_output)
+{
+    present(&OUTPUT_60HZ, 16667us, 5);
+    present(&OUTPUT_144HZ, 6944us, 5);
+    clock.on_render_time(&OUTPUT_60HZ, 4ms);
+    clock.on_render_time(&OUTPUT_144HZ, 2ms);
+    EXPECT_EQ(clock.render_time(), 4ms);
+}
+
+TEST_F(FrameClockTest, next_frame_time_is_now_without_frames)
+{
+    auto const now = FrameClock::clock::now();
+    EXPECT_EQ(clock.next_frame_time(now), now);
+}
+
+TEST_F(FrameClockTest, next_frame_time_is_one_interval_after_the_last_frame)
+{
+    auto const start = FrameClock::clock::now();
+    for (int i = 0; i < 10; i++)
+        clock.on_frame(&OUTPUT_144HZ, start + 6944us * i);
+
+    auto const last = start + 6944us * 9;
+    EXPECT_EQ(clock.next_frame_time(last + 1ms), last + 6944us);
+}
+
+TEST_F(FrameClockTest, next_frame_time_skips_frames_that_were_missed)
+{
+    auto const start = FrameClock::clock::now();
+    for (int i = 0; i < 10; i++)
+        clock.on_frame(&OUTPUT_144HZ, start + 6944us * i);
+
+    auto const last = start + 6944us * 9;
+    EXPECT_EQ(clock.next_frame_time(last + 6944us * 2 + 1ms), last + 6944us * 3);
+}
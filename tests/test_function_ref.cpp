@@ -0,0 +1,66 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "function_ref.h"
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace miracle;
+
+namespace
+{
+int call_twice(FunctionRef<int(int)> f)
+{
+    return f(f(1));
+}
+}
+
+TEST(FunctionRefTest, CallsTheReferencedCallable)
+{
+    int calls = 0;
+    EXPECT_EQ(call_twice([&](int x)
+    {
+        calls++;
+        return x * 3;
+    }),
+        9);
+    EXPECT_EQ(calls, 2);
+}
+
+TEST(FunctionRefTest, CopiesReferToTheSameCallable)
+{
+    std::string seen;
+    auto const append = [&](std::string const& s)
+    {
+        seen += s;
+        return true;
+    };
+    FunctionRef<bool(std::string const&)> const first(append);
+    auto const second = first;
+    first("a");
+    second("b");
+    EXPECT_EQ(seen, "ab");
+}
+
+TEST(FunctionRefTest, ConvertsTheResultOfTheCallable)
+{
+    auto const odd = [](int x)
+    { return x % 2; };
+    FunctionRef<bool(int)> const is_odd(odd);
+    EXPECT_TRUE(is_odd(3));
+    EXPECT_FALSE(is_odd(4));
+}
@@ -0,0 +1,110 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "gpu_memory_budget.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+
+namespace
+{
+int const OWNER_1 = 0;
+int const OWNER_2 = 1;
+}
+
+class GpuMemoryBudgetTest : public testing::Test
+{
+public:
+    GpuMemoryBudget budget { 100 };
+};
+
+TEST_F(GpuMemoryBudgetTest, targets_within_the_budget_are_kept)
+{
+    budget.use(&OWNER_1, 0, 40, true);
+    budget.use(&OWNER_1, 1, 60, true);
+
+    EXPECT_EQ(budget.used_bytes(), 100);
+    EXPECT_FALSE(budget.take_eviction(&OWNER_1, 0));
+    EXPECT_FALSE(budget.take_eviction(&OWNER_1, 1));
+}
+
+TEST_F(GpuMemoryBudgetTest, least_recently_used_target_is_evicted_over_the_budget)
+{
+    budget.use(&OWNER_1, 0, 40, true);
+    budget.use(&OWNER_2, 0, 40, true);
+    budget.use(&OWNER_1, 0, 40, true);
+    budget.use(&OWNER_1, 1, 40, true);
+
+    EXPECT_TRUE(budget.take_eviction(&OWNER_2, 0));
+    EXPECT_FALSE(budget.take_eviction(&OWNER_1, 0));
+    EXPECT_EQ(budget.used_bytes(), 80);
+}
+
+TEST_F(GpuMemoryBudgetTest, targets_that_are_not_evictable_are_kept_over_the_budget)
+{
+    budget.use(&OWNER_1, 0, 80, false);
+    budget.use(&OWNER_1, 1, 80, false);
+
+    EXPECT_FALSE(budget.take_eviction(&OWNER_1, 0));
+    EXPECT_EQ(budget.used_bytes(), 160);
+}
+
+TEST_F(GpuMemoryBudgetTest, target_being_used_is_not_evicted_to_make_room_for_itself)
+{
+    budget.use(&OWNER_1, 0, 150, true);
+
+    EXPECT_FALSE(budget.take_eviction(&OWNER_1, 0));
+    EXPECT_EQ(budget.used_bytes(), 150);
+}
+
+TEST_F(GpuMemoryBudgetTest, an_eviction_is_only_taken_once)
+{
+    budget.use(&OWNER_1, 0, 60, true);
+    budget.use(&OWNER_1, 1, 60, true);
+
+    EXPECT_TRUE(budget.take_eviction(&OWNER_1, 0));
+    EXPECT_FALSE(budget.take_eviction(&OWNER_1, 0));
+}
+
+TEST_F(GpuMemoryBudgetTest, lowering_the_budget_evicts_targets)
+{
+    budget.use(&OWNER_1, 0, 60, true);
+    budget.use(&OWNER_1, 1, 30, true);
+    budget.set_budget(50);
+
+    EXPECT_TRUE(budget.take_eviction(&OWNER_1, 0));
+    EXPECT_EQ(budget.used_bytes(), 30);
+}
+
+TEST_F(GpuMemoryBudgetTest, removing_an_owner_forgets_its_targets)
+{
+    budget.use(&OWNER_1, 0, 40, true);
+    budget.use(&OWNER_2, 0, 20, true);
+    budget.remove(&OWNER_1);
+
+    EXPECT_EQ(budget.used_bytes(), 20);
+    EXPECT_EQ(budget.used_bytes(&OWNER_1), 0);
+    EXPECT_EQ(budget.used_bytes(&OWNER_2), 20);
+}
+
+TEST_F(GpuMemoryBudgetTest, released_targets_are_no_longer_counted)
+{
+    budget.use(&OWNER_1, 0, 40, true);
+    budget.release(&OWNER_1, 0);
+
+    EXPECT_EQ(budget.used_bytes(), 0);
+}
@@ -16,7 +16,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 **/
 
 #include "ipc_command.h"
+#include <chrono>
 #include <gtest/gtest.h>
+#include <iostream>
+#include <string>
 
 using namespace miracle;
 
@@ -87,6 +90,26 @@ TEST_F(IpcCommandParserTest, CanParseSingleI3Command)
     ASSERT_EQ(commands.commands[0].arguments[0], "gedit");
 }
 
+TEST_F(IpcCommandParserTest, CanParseAppendLayoutCommand)
+{
+    const char* v = "append_layout /home/user/.config/miracle-wm/morning.json";
+    IpcCommandParser parser(v);
+    auto commands = parser.parse();
+    ASSERT_EQ(commands.commands.size(), 1);
+    ASSERT_EQ(commands.commands[0].type, IpcCommandType::append_layout);
+    ASSERT_EQ(commands.commands[0].arguments[0], "/home/user/.config/miracle-wm/morning.json");
+}
+
+TEST_F(IpcCommandParserTest, CanParseOverviewCommand)
+{
+    const char* v = "overview toggle";
+    IpcCommandParser parser(v);
+    auto commands = parser.parse();
+    ASSERT_EQ(commands.commands.size(), 1);
+    ASSERT_EQ(commands.commands[0].type, IpcCommandType::overview);
+    ASSERT_EQ(commands.commands[0].arguments[0], "toggle");
+}
+
 TEST_F(IpcCommandParserTest, CanParseExecCommandWithNoStartupId)
 {
     const char* v = "exec --no-startup-id gedit";
@@ -145,4 +168,102 @@ TEST_F(IpcCommandParserTest, CanParseThreeCommands)
     ASSERT_EQ(commands.commands[2].type, IpcCommandType::layout);
     ASSERT_EQ(commands.commands[2].options[0], "--opt2");
     ASSERT_EQ(commands.commands[2].arguments[0], "splitv");
-}
\ No newline at end of file
+}
+
+TEST_F(IpcCommandParserTest, TokensAreViewsIntoTheInput)
+{
+    std::string const v = "[title=\"Editor\"] exec --no-startup-id gedit";
+    IpcCommandParser parser(v);
+    auto commands = parser.parse();
+    ASSERT_EQ(commands.commands.size(), 1);
+    auto const in_input = [&](std::string_view token)
+    {
+        return token.data() >= v.data() && token.data() + token.size() <= v.data() + v.size();
+    };
+    EXPECT_TRUE(in_input(commands.scope[0].value));
+    EXPECT_TRUE(in_input(commands.commands[0].options[0]));
+    EXPECT_TRUE(in_input(commands.commands[0].arguments[0]));
+}
+
+TEST_F(IpcCommandParserTest, CanParseMoreItemsThanFitInline)
+{
+    const char* v = "exec a b c d e f; split vertical; split horizontal; layout splitv; layout splith";
+    IpcCommandParser parser(v);
+    auto commands = parser.parse();
+    ASSERT_EQ(commands.commands.size(), 5);
+    ASSERT_EQ(commands.commands[0].arguments.size(), 6);
+    ASSERT_EQ(commands.commands[0].arguments[5], "f");
+    ASSERT_EQ(commands.commands[1].arguments[0], "vertical");
+    ASSERT_EQ(commands.commands[4].type, IpcCommandType::layout);
+    ASSERT_EQ(commands.commands[4].arguments[0], "splith");
+}
+
+TEST_F(IpcCommandParserTest, CacheReturnsTheSameResultForARepeatedCommand)
+{
+    IpcCommandCache cache;
+    auto const* first = &cache.parse("workspace number 3");
+    std::string const again = "workspace number 3";
+    auto const& second = cache.parse(again);
+    EXPECT_EQ(first, &second);
+    EXPECT_EQ(cache.hits(), 1);
+    EXPECT_EQ(cache.misses(), 1);
+    ASSERT_EQ(second.commands.size(), 1);
+    EXPECT_EQ(second.commands[0].type, IpcCommandType::workspace);
+    EXPECT_EQ(second.commands[0].arguments[1], "3");
+}
+
+TEST_F(IpcCommandParserTest, CacheEvictsTheLeastRecentlyUsedCommand)
+{
+    IpcCommandCache cache(2);
+    cache.parse("focus left");
+    cache.parse("focus right");
+    cache.parse("focus left");
+    cache.parse("focus up");
+    EXPECT_EQ(cache.size(), 2);
+
+    cache.parse("focus left");
+    EXPECT_EQ(cache.hits(), 2);
+    cache.parse("focus right");
+    EXPECT_EQ(cache.misses(), 4);
+}
+
+TEST_F(IpcCommandParserTest, CacheDoesNotKeepLongCommands)
+{
+    IpcCommandCache cache;
+    std::string const command = "exec " + std::string(IpcCommandCache::max_command_length, 'a');
+    auto const& result = cache.parse(command);
+    EXPECT_EQ(cache.size(), 0);
+    ASSERT_EQ(result.commands.size(), 1);
+    EXPECT_EQ(result.commands[0].arguments[0].size(), IpcCommandCache::max_command_length);
+}
+
+/// Measures the time taken to parse typical commands. Run with
+/// --gtest_also_run_disabled_tests.
+TEST_F(IpcCommandParserTest, DISABLED_benchmark_parse)
+{
+    std::string batch;
+    for (int i = 0; i < 40; i++)
+        batch += "[con_id=" + std::to_string(i) + "] move container to workspace \"" + std::to_string(i % 10) + ":web\"; ";
+
+    for (std::string const& command : { std::string("focus left"), std::string("exec --no-startup-id gedit"), batch })
+    {
+        int const iterations = 100'000;
+        size_t count = 0;
+        auto const start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            IpcCommandParser parser(command);
+            count += parser.parse().commands.size();
+        }
+
+        auto const ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        IpcCommandCache cache;
+        auto const cached_start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+            count += cache.parse(command).commands.size();
+
+        auto const cached_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - cached_start).count();
+        std::cout << command.size() << " bytes, " << count / iterations / 2 << " commands: " << ns / iterations
+                  << "ns per parse, " << cached_ns / iterations << "ns per cached parse" << std::endl;
+    }
+}
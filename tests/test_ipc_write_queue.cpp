@@ -0,0 +1,162 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "ipc_write_queue.h"
+#include <cstring>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace miracle;
+
+class IpcWriteQueueTest : public testing::Test
+{
+public:
+    IpcWriteQueueTest()
+    {
+        socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+        fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+        fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+    }
+
+    ~IpcWriteQueueTest() override
+    {
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    std::string read_all()
+    {
+        std::string result;
+        char buf[4096];
+        ssize_t count;
+        while ((count = read(fds[1], buf, sizeof(buf))) > 0)
+            result.append(buf, count);
+        return result;
+    }
+
+    static std::string message(uint32_t type, std::string const& payload)
+    {
+        std::string result = "i3-ipc";
+        uint32_t const length = payload.size();
+        result.append(reinterpret_cast<char const*>(&length), sizeof(length));
+        result.append(reinterpret_cast<char const*>(&type), sizeof(type));
+        return result + payload;
+    }
+
+    int fds[2];
+    IpcWriteQueue queue;
+};
+
+TEST_F(IpcWriteQueueTest, writes_messages_in_order)
+{
+    queue.push(IpcWriteQueue::frame(1, "hello"));
+    queue.push(IpcWriteQueue::frame(2, ""));
+    queue.push(IpcWriteQueue::frame(3, "world"));
+    EXPECT_EQ(queue.size(), 3 * IpcWriteQueue::header_size + 10);
+
+    EXPECT_EQ(queue.write_to(fds[0]), IpcWriteQueue::WriteResult::done);
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.size(), 0);
+    EXPECT_EQ(read_all(), message(1, "hello") + message(2, "") + message(3, "world"));
+}
+
+TEST_F(IpcWriteQueueTest, resumes_partial_writes_when_the_client_catches_up)
+{
+    int const buffer_size = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+
+    std::string const payload(1 << 20, 'x');
+    queue.push(IpcWriteQueue::frame(4, payload));
+    queue.push(IpcWriteQueue::frame(5, "tail"));
+
+    std::string received;
+    int attempts = 0;
+    while (queue.write_to(fds[0]) == IpcWriteQueue::WriteResult::pending && attempts++ < 100'000)
+    {
+        EXPECT_FALSE(queue.empty());
+        received += read_all();
+    }
+
+    received += read_all();
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(received, message(4, payload) + message(5, "tail"));
+}
+
+TEST_F(IpcWriteQueueTest, shares_frames_instead_of_copying_them)
+{
+    auto const frame = IpcWriteQueue::frame(6, "event");
+    IpcWriteQueue other;
+    queue.push(frame);
+    other.push(frame);
+    EXPECT_EQ(frame.use_count(), 3);
+
+    EXPECT_EQ(queue.write_to(fds[0]), IpcWriteQueue::WriteResult::done);
+    EXPECT_EQ(frame.use_count(), 2);
+    EXPECT_EQ(read_all(), message(6, "event"));
+}
+
+TEST_F(IpcWriteQueueTest, reports_an_error_when_the_client_has_gone)
+{
+    close(fds[1]);
+    fds[1] = -1;
+    queue.push(IpcWriteQueue::frame(7, "lost"));
+    EXPECT_EQ(queue.write_to(fds[0]), IpcWriteQueue::WriteResult::error);
+}
+
+TEST_F(IpcWriteQueueTest, drops_the_oldest_messages_of_a_type_until_there_is_room)
+{
+    queue.push(IpcWriteQueue::frame(1, "a"));
+    queue.push(IpcWriteQueue::frame(2, "b"));
+    queue.push(IpcWriteQueue::frame(1, "c"));
+    queue.push(IpcWriteQueue::frame(1, "d"));
+
+    auto const message_size = IpcWriteQueue::header_size + 1;
+    EXPECT_EQ(queue.drop_oldest(1, message_size, 3 * message_size), 2);
+    EXPECT_EQ(queue.count(), 2);
+    EXPECT_EQ(queue.size(), 2 * message_size);
+
+    EXPECT_EQ(queue.write_to(fds[0]), IpcWriteQueue::WriteResult::done);
+    EXPECT_EQ(read_all(), message(2, "b") + message(1, "d"));
+}
+
+TEST_F(IpcWriteQueueTest, removes_every_unwritten_message_of_a_type)
+{
+    queue.push(IpcWriteQueue::frame(1, "a"));
+    queue.push(IpcWriteQueue::frame(2, "b"));
+    queue.push(IpcWriteQueue::frame(1, "c"));
+
+    EXPECT_EQ(queue.remove(1), 2);
+    EXPECT_EQ(queue.size(), IpcWriteQueue::header_size + 1);
+
+    EXPECT_EQ(queue.write_to(fds[0]), IpcWriteQueue::WriteResult::done);
+    EXPECT_EQ(read_all(), message(2, "b"));
+}
+
+TEST_F(IpcWriteQueueTest, keeps_messages_that_are_partially_written)
+{
+    int size = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    std::string const payload(1 << 20, 'x');
+    queue.push(IpcWriteQueue::frame(1, payload));
+    queue.push(IpcWriteQueue::frame(1, "next"));
+
+    ASSERT_EQ(queue.write_to(fds[0]), IpcWriteQueue::WriteResult::pending);
+    EXPECT_EQ(queue.remove(1), 1);
+    EXPECT_EQ(queue.count(), 1);
+}
@@ -0,0 +1,114 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "json_fragment.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+
+namespace
+{
+struct Key
+{
+    int value;
+    bool operator==(Key const&) const = default;
+};
+}
+
+TEST(JsonFragmentTest, cache_only_rebuilds_when_the_key_changes)
+{
+    JsonFragmentCache<Key> cache;
+    int builds = 0;
+    auto const build = [&](Key const& key)
+    {
+        builds++;
+        return nlohmann::json({ { "value", key.value } }).dump();
+    };
+
+    EXPECT_EQ(cache.get({ 1 }, build), "{\"value\":1}");
+    EXPECT_EQ(cache.get({ 1 }, build), "{\"value\":1}");
+    EXPECT_EQ(builds, 1);
+
+    EXPECT_EQ(cache.get({ 2 }, build), "{\"value\":2}");
+    EXPECT_EQ(builds, 2);
+}
+
+TEST(JsonFragmentTest, delta_holds_only_changed_and_added_fields)
+{
+    nlohmann::json const previous = {
+        { "id",      1     },
+        { "name",    "old" },
+        { "focused", false }
+    };
+    nlohmann::json const current = {
+        { "id",      1     },
+        { "name",    "new" },
+        { "focused", false },
+        { "urgent",  true  }
+    };
+
+    nlohmann::json const expected = {
+        { "name",   "new" },
+        { "urgent", true  }
+    };
+    EXPECT_EQ(json_delta(previous, current), expected);
+    EXPECT_TRUE(json_delta(current, current).empty());
+}
+
+TEST(JsonFragmentTest, subscriber_that_joins_later_is_sent_the_whole_container)
+{
+    nlohmann::json const opened = {
+        { "id",   1     },
+        { "name", "old" }
+    };
+    nlohmann::json const renamed = {
+        { "id",   1     },
+        { "name", "new" }
+    };
+    nlohmann::json const focused = {
+        { "id",      1     },
+        { "name",    "new" },
+        { "focused", true  }
+    };
+    nlohmann::json const expected_delta = {
+        { "id",   1     },
+        { "name", "new" }
+    };
+
+    // The first subscriber is sent the whole container, and then what changed
+    WindowDeltas deltas;
+    EXPECT_EQ(deltas.next(opened, false), opened);
+    EXPECT_EQ(deltas.next(renamed, false), expected_delta);
+
+    // A second subscriber joins, so the next event carries everything again
+    deltas.reset();
+    EXPECT_EQ(deltas.next(focused, false), focused);
+    EXPECT_EQ(deltas.next(focused, false), nlohmann::json({ { "id", 1 } }));
+}
+
+TEST(JsonFragmentTest, closed_container_has_only_its_id_and_no_baseline)
+{
+    nlohmann::json const container = {
+        { "id",   1   },
+        { "name", "a" }
+    };
+
+    WindowDeltas deltas;
+    deltas.next(container, false);
+    EXPECT_EQ(deltas.next(container, true), nlohmann::json({ { "id", 1 } }));
+    EXPECT_EQ(deltas.next(container, false), container);
+}
@@ -0,0 +1,108 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "json_writer.h"
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <limits>
+#include <nlohmann/json.hpp>
+
+using namespace miracle;
+
+class JsonWriterTest : public testing::Test
+{
+public:
+    std::string out;
+    JsonWriter writer { out };
+};
+
+TEST_F(JsonWriterTest, nested_values_are_separated)
+{
+    writer.begin_object()
+        .key("name")
+        .value("parent")
+        .key("nodes")
+        .begin_array()
+        .value(1)
+        .begin_object()
+        .end_object()
+        .begin_array()
+        .end_array()
+        .null()
+        .end_array()
+        .key("focused")
+        .value(true)
+        .end_object();
+
+    EXPECT_EQ(out, R"({"name":"parent","nodes":[1,{},[],null],"focused":true})");
+}
+
+TEST_F(JsonWriterTest, numbers_match_nlohmann)
+{
+    writer.begin_array()
+        .value(-1)
+        .value(std::numeric_limits<std::uintptr_t>::max())
+        .value(0.25f)
+        .value(1.0)
+        .value(std::numeric_limits<double>::infinity())
+        .end_array();
+
+    nlohmann::json const expected = { -1, std::numeric_limits<std::uintptr_t>::max(), 0.25f, 1.0, nullptr };
+    EXPECT_EQ(out, expected.dump());
+}
+
+TEST_F(JsonWriterTest, strings_are_escaped)
+{
+    std::string const value = "a \"quoted\" \\ path\n\twith \x01 control";
+    writer.value(value);
+
+    EXPECT_EQ(out, nlohmann::json(value).dump());
+    EXPECT_EQ(nlohmann::json::parse(out), value);
+}
+
+TEST_F(JsonWriterTest, valid_utf8_is_kept)
+{
+    std::string const value = "caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80";
+    writer.value(value);
+
+    EXPECT_EQ(out, "\"" + value + "\"");
+}
+
+TEST_F(JsonWriterTest, invalid_utf8_is_replaced)
+{
+    writer.value("a\xff" "b\xc3");
+
+    EXPECT_EQ(out, "\"a\xef\xbf\xbd" "b\xef\xbf\xbd\"");
+    EXPECT_NO_THROW(nlohmann::json::parse(out));
+}
+
+TEST_F(JsonWriterTest, serialized_fields_continue_an_open_object)
+{
+    std::string fields;
+    JsonWriter(fields).key("id").value(1).key("name").value("parent");
+
+    writer.begin_object().fields(fields).key("nodes").begin_array().raw(R"({"id":2})").end_array().end_object();
+
+    EXPECT_EQ(out, R"({"id":1,"name":"parent","nodes":[{"id":2}]})");
+}
+
+TEST_F(JsonWriterTest, rect_is_written_as_an_i3_rect)
+{
+    writer.begin_object().rect("rect", { { 1, 2 }, { 3, 4 } }).end_object();
+
+    EXPECT_EQ(out, R"({"rect":{"x":1,"y":2,"width":3,"height":4}})");
+}
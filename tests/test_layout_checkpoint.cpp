@@ -0,0 +1,97 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "layout_checkpoint.h"
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+using namespace miracle;
+
+namespace
+{
+LayoutCheckpoint make_checkpoint()
+{
+    LayoutCheckpoint::Node terminal { .app_id = "foot" };
+    LayoutCheckpoint::Node browser { .percent = 0.75, .app_id = "firefox" };
+    LayoutCheckpoint::Node stack { .scheme = LayoutScheme::vertical, .percent = 0.25, .nodes = { terminal, terminal } };
+
+    return LayoutCheckpoint {
+        .workspaces = {
+            { .output = "DP-1", .num = 1, .is_active = true, .root = { .nodes = { browser, stack } } },
+            { .output = "HDMI-A-1", .name = "mail", .root = { .scheme = LayoutScheme::tabbing, .nodes = { terminal } } } }
+    };
+}
+}
+
+class LayoutCheckpointTest : public testing::Test
+{
+public:
+    void TearDown() override
+    {
+        std::filesystem::remove(path);
+    }
+
+    std::filesystem::path path = std::filesystem::temp_directory_path()
+        / ("miracle-layout-checkpoint-" + std::to_string(getpid()));
+};
+
+TEST_F(LayoutCheckpointTest, checkpoints_can_be_read_back)
+{
+    auto const checkpoint = make_checkpoint();
+    auto const data = serialize_layout_checkpoint(checkpoint);
+
+    auto const parsed = parse_layout_checkpoint(data);
+    ASSERT_TRUE(parsed);
+    EXPECT_EQ(parsed.value(), checkpoint);
+}
+
+TEST_F(LayoutCheckpointTest, truncated_checkpoints_are_rejected)
+{
+    auto data = serialize_layout_checkpoint(make_checkpoint());
+    data.resize(data.size() - 1);
+
+    EXPECT_FALSE(parse_layout_checkpoint(data));
+}
+
+TEST_F(LayoutCheckpointTest, checkpoints_are_only_taken_once)
+{
+    ASSERT_TRUE(write_layout_checkpoint(path, make_checkpoint()));
+
+    EXPECT_EQ(take_layout_checkpoint(path), make_checkpoint());
+    EXPECT_FALSE(std::filesystem::exists(path));
+    EXPECT_FALSE(take_layout_checkpoint(path));
+}
+
+TEST_F(LayoutCheckpointTest, slots_of_the_template_swallow_exactly_their_app_id)
+{
+    auto const layout = to_layout_template(make_checkpoint().workspaces[0].root);
+    ASSERT_EQ(layout.nodes.size(), 2);
+    EXPECT_EQ(layout.nodes[0].percent, 0.75);
+    EXPECT_TRUE(layout.nodes[0].matches("firefox", ""));
+    EXPECT_FALSE(layout.nodes[0].matches("firefox-esr", ""));
+    EXPECT_EQ(layout.nodes[1].scheme, LayoutScheme::vertical);
+    EXPECT_TRUE(layout.nodes[1].nodes[0].matches("foot", ""));
+}
+
+TEST_F(LayoutCheckpointTest, app_ids_are_matched_literally)
+{
+    auto const layout = to_layout_template(LayoutCheckpoint::Node { .app_id = "org.gnome.Nautilus" });
+
+    EXPECT_TRUE(layout.matches("org.gnome.Nautilus", ""));
+    EXPECT_FALSE(layout.matches("orgXgnomeXNautilus", ""));
+}
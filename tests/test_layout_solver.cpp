@@ -0,0 +1,90 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "layout_solver.h"
+#include <gtest/gtest.h>
+#include <numeric>
+#include <random>
+
+using namespace miracle;
+
+TEST(LayoutSolverTest, nothing_to_distribute_between)
+{
+    EXPECT_TRUE(distribute_space(100, {}, {}).empty());
+}
+
+TEST(LayoutSolverTest, equal_weights_split_the_remainder_from_the_front)
+{
+    EXPECT_EQ(distribute_space(1280, { 1, 1, 1 }, {}), (std::vector<int> { 427, 427, 426 }));
+}
+
+TEST(LayoutSolverTest, space_follows_the_weights)
+{
+    EXPECT_EQ(distribute_space(900, { 300, 600 }, {}), (std::vector<int> { 300, 600 }));
+    EXPECT_EQ(distribute_space(1000, { 1, 3 }, {}), (std::vector<int> { 250, 750 }));
+}
+
+TEST(LayoutSolverTest, distributing_the_current_sizes_changes_nothing)
+{
+    std::vector<int> const sizes { 427, 427, 426 };
+    EXPECT_EQ(distribute_space(1280, { 427, 427, 426 }, {}), sizes);
+}
+
+TEST(LayoutSolverTest, items_without_weight_share_equally)
+{
+    EXPECT_EQ(distribute_space(100, { 0, 0 }, {}), (std::vector<int> { 50, 50 }));
+}
+
+TEST(LayoutSolverTest, minimums_take_space_from_the_other_items)
+{
+    EXPECT_EQ(distribute_space(1000, { 1, 99 }, { 50, 50 }), (std::vector<int> { 50, 950 }));
+}
+
+TEST(LayoutSolverTest, minimums_that_cannot_be_met_are_ignored)
+{
+    EXPECT_EQ(distribute_space(60, { 1, 1 }, { 50, 50 }), (std::vector<int> { 30, 30 }));
+}
+
+TEST(LayoutSolverTest, sizes_always_add_up_to_the_total)
+{
+    std::mt19937 random(3);
+    std::uniform_int_distribution<int> total(0, 4000);
+    std::uniform_int_distribution<int> count(1, 12);
+    std::uniform_real_distribution<double> weight(0, 10);
+    std::uniform_int_distribution<int> minimum(0, 100);
+
+    for (int i = 0; i < 1000; i++)
+    {
+        auto const n = static_cast<size_t>(count(random));
+        std::vector<double> weights;
+        std::vector<int> minimums;
+        for (size_t j = 0; j < n; j++)
+        {
+            weights.push_back(weight(random));
+            minimums.push_back(minimum(random));
+        }
+
+        int const t = total(random);
+        auto const sizes = distribute_space(t, weights, minimums);
+        ASSERT_EQ(std::accumulate(sizes.begin(), sizes.end(), 0), t);
+        if (std::accumulate(minimums.begin(), minimums.end(), 0) <= t)
+        {
+            for (size_t j = 0; j < n; j++)
+                EXPECT_GE(sizes[j], minimums[j]);
+        }
+    }
+}
@@ -0,0 +1,121 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "layout_template.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+
+namespace geom = mir::geometry;
+
+namespace
+{
+LayoutTemplateNode parse(char const* text)
+{
+    auto result = parse_layout_template(nlohmann::json::parse(text));
+    if (auto const* error = std::get_if<std::string>(&result))
+        ADD_FAILURE() << *error;
+    return std::get<LayoutTemplateNode>(std::move(result));
+}
+
+geom::Rectangle rect(int x, int y, int width, int height)
+{
+    return geom::Rectangle { geom::Point { x, y }, geom::Size { width, height } };
+}
+}
+
+TEST(LayoutTemplateTest, reads_the_layout_of_each_node)
+{
+    auto const root = parse(R"({"layout": "splith", "nodes": [
+        {"layout": "splitv", "nodes": [{}, {}]},
+        {"layout": "tabbed", "nodes": [{}]}
+    ]})");
+
+    EXPECT_EQ(root.scheme, LayoutScheme::horizontal);
+    ASSERT_EQ(root.nodes.size(), 2u);
+    EXPECT_EQ(root.nodes[0].scheme, LayoutScheme::vertical);
+    EXPECT_EQ(root.nodes[0].nodes.size(), 2u);
+    EXPECT_EQ(root.nodes[1].scheme, LayoutScheme::tabbing);
+}
+
+TEST(LayoutTemplateTest, an_array_is_read_as_the_nodes_of_a_horizontal_container)
+{
+    auto const root = parse(R"([{}, {}, {}])");
+    EXPECT_EQ(root.scheme, LayoutScheme::horizontal);
+    EXPECT_EQ(root.nodes.size(), 3u);
+}
+
+TEST(LayoutTemplateTest, invalid_templates_are_rejected)
+{
+    for (auto const* text : { R"({"layout": "diagonal", "nodes": [{}]})", R"({})", R"({"nodes": [{"swallows": [{"title": "("}]}]})" })
+        EXPECT_TRUE(std::holds_alternative<std::string>(parse_layout_template(nlohmann::json::parse(text)))) << text;
+}
+
+TEST(LayoutTemplateTest, slots_match_by_app_id_class_or_title)
+{
+    auto const root = parse(R"([
+        {"swallows": [{"app_id": "^foot$"}]},
+        {"swallows": [{"class": "^firefox$", "title": "Mail"}]},
+        {}
+    ])");
+
+    EXPECT_TRUE(root.nodes[0].matches("foot", "~"));
+    EXPECT_FALSE(root.nodes[0].matches("footclient", "~"));
+    EXPECT_TRUE(root.nodes[1].matches("firefox", "Inbox - Mail"));
+    EXPECT_FALSE(root.nodes[1].matches("firefox", "News"));
+    EXPECT_TRUE(root.nodes[2].matches("anything", "at all"));
+}
+
+TEST(LayoutTemplateTest, slots_share_what_the_percentages_leave_over)
+{
+    auto const root = parse(R"([{"percent": 0.5}, {}, {}])");
+    auto const solution = solve_layout_template(root, rect(0, 0, 1000, 500), 0, 0);
+
+    ASSERT_EQ(solution.slots.size(), 3u);
+    EXPECT_EQ(solution.slots[0].logical_area, rect(0, 0, 500, 500));
+    EXPECT_EQ(solution.slots[1].logical_area, rect(500, 0, 250, 500));
+    EXPECT_EQ(solution.slots[2].logical_area, rect(750, 0, 250, 500));
+}
+
+TEST(LayoutTemplateTest, nested_containers_are_solved_before_their_nodes)
+{
+    auto const root = parse(R"({"layout": "splith", "nodes": [
+        {"layout": "splitv", "nodes": [{}, {}, {}]},
+        {"layout": "tabbed", "nodes": [{}, {}]}
+    ]})");
+    auto const solution = solve_layout_template(root, rect(0, 0, 1000, 900), 0, 0);
+
+    ASSERT_EQ(solution.containers.size(), 3u);
+    EXPECT_TRUE(solution.containers[0].path.empty());
+    EXPECT_EQ(solution.containers[1].path, (std::vector<size_t> { 0 }));
+    EXPECT_EQ(solution.containers[1].logical_area, rect(0, 0, 500, 900));
+
+    ASSERT_EQ(solution.slots.size(), 5u);
+    EXPECT_EQ(solution.slots[0].path, (std::vector<size_t> { 0, 0 }));
+    EXPECT_EQ(solution.slots[2].logical_area, rect(0, 600, 500, 300));
+    EXPECT_EQ(solution.slots[3].logical_area, rect(500, 0, 500, 900));
+    EXPECT_EQ(solution.slots[4].logical_area, rect(500, 0, 500, 900));
+}
+
+TEST(LayoutTemplateTest, windows_are_inset_only_where_they_meet_another_window)
+{
+    auto const root = parse(R"([{}, {}])");
+    auto const solution = solve_layout_template(root, rect(0, 0, 1000, 500), 5, 5);
+
+    EXPECT_EQ(solution.slots[0].visible_area, rect(0, 0, 495, 500));
+    EXPECT_EQ(solution.slots[1].visible_area, rect(505, 0, 495, 500));
+}
@@ -106,6 +106,17 @@ TEST_F(LeafContainerTest, SetsAndGetsStateCorrectly)
     leaf_container->commit_changes();
 }
 
+TEST_F(LeafContainerTest, ChangesOfACommitAreAppliedTogether)
+{
+    testing::InSequence sequence;
+    EXPECT_CALL(*window_controller, begin_changes(testing::_));
+    EXPECT_CALL(*window_controller, change_state(testing::_, MirWindowState::mir_window_state_fullscreen));
+    EXPECT_CALL(*window_controller, modify(testing::_, testing::_));
+    EXPECT_CALL(*window_controller, end_changes(testing::_));
+
+    leaf_container->toggle_fullscreen();
+}
+
 TEST_F(LeafContainerTest, SetsAndGetsTreeCorrectly)
 {
     auto new_workspace = std::make_unique<test::MockWorkspace>();
@@ -192,3 +203,30 @@ TEST_F(LeafContainerTest, IfParentIsUnanchoredThenParentCanBeResizedDown)
     EXPECT_CALL(*parent, commit_changes());
     leaf_container->resize(Direction::down, 20);
 }
+
+TEST_F(LeafContainerTest, CommitsWithinABatchAreAppliedOnceWhenTheBatchCloses)
+{
+    geom::Rectangle last_area {
+        { 20,  20  },
+        { 100, 100 }
+    };
+
+    EXPECT_CALL(*window_controller, set_rectangle(::testing::_, ::testing::_, ::testing::_, ::testing::_))
+        .Times(0);
+    {
+        CommitBatch batch(*state);
+        leaf_container->set_logical_area({
+            { 10,  10  },
+            { 200, 200 }
+        });
+        leaf_container->commit_changes();
+        leaf_container->set_logical_area(last_area);
+        leaf_container->commit_changes();
+
+        testing::Mock::VerifyAndClearExpectations(window_controller.get());
+        EXPECT_CALL(*window_controller, set_rectangle(::testing::_, ::testing::_, ::testing::_, ::testing::_))
+            .Times(1);
+    }
+
+    ASSERT_EQ(leaf_container->get_logical_area(), last_area);
+}
@@ -0,0 +1,94 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "json_fragment.h"
+#include "memory_accounting.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace miracle;
+
+namespace
+{
+MemoryUsage usage(MemorySubsystem subsystem)
+{
+    return MemoryAccounting::instance().usage(subsystem);
+}
+}
+
+TEST(MemoryAccountingTest, charges_are_counted_while_they_live)
+{
+    auto const before = usage(MemorySubsystem::animations);
+    {
+        MemoryCharge charge(MemorySubsystem::animations, 64);
+        EXPECT_EQ(usage(MemorySubsystem::animations).bytes, before.bytes + 64);
+        EXPECT_EQ(usage(MemorySubsystem::animations).objects, before.objects + 1);
+    }
+
+    EXPECT_EQ(usage(MemorySubsystem::animations).bytes, before.bytes);
+    EXPECT_EQ(usage(MemorySubsystem::animations).objects, before.objects);
+}
+
+TEST(MemoryAccountingTest, resizing_changes_only_the_bytes)
+{
+    auto const before = usage(MemorySubsystem::ipc_clients);
+    MemoryCharge charge(MemorySubsystem::ipc_clients, 100);
+    charge.resize(16 * 1024);
+    EXPECT_EQ(usage(MemorySubsystem::ipc_clients).bytes, before.bytes + 16 * 1024);
+    charge.resize(10);
+    EXPECT_EQ(usage(MemorySubsystem::ipc_clients).bytes, before.bytes + 10);
+    EXPECT_EQ(usage(MemorySubsystem::ipc_clients).objects, before.objects + 1);
+}
+
+TEST(MemoryAccountingTest, copies_are_counted_and_moves_are_not)
+{
+    auto const before = usage(MemorySubsystem::containers);
+    std::vector<MemoryCharge> charges;
+    charges.emplace_back(MemorySubsystem::containers, 8);
+    charges.push_back(charges.front());
+    for (int i = 0; i < 10; i++)
+        charges.emplace_back(MemorySubsystem::containers, 8);
+
+    EXPECT_EQ(usage(MemorySubsystem::containers).objects, before.objects + 12);
+    EXPECT_EQ(usage(MemorySubsystem::containers).bytes, before.bytes + 12 * 8);
+
+    charges.clear();
+    EXPECT_EQ(usage(MemorySubsystem::containers).objects, before.objects);
+    EXPECT_EQ(usage(MemorySubsystem::containers).bytes, before.bytes);
+}
+
+TEST(MemoryAccountingTest, json_caches_count_their_serialized_json)
+{
+    auto const before = usage(MemorySubsystem::json_caches);
+    JsonFragmentCache<int> cache;
+    std::string const& json = cache.get(1, [](int) { return std::string(1000, 'x'); });
+    EXPECT_EQ(usage(MemorySubsystem::json_caches).objects, before.objects + 1);
+    EXPECT_EQ(usage(MemorySubsystem::json_caches).bytes, before.bytes + static_cast<int64_t>(json.capacity()));
+}
+
+TEST(MemoryAccountingTest, json_reports_every_subsystem)
+{
+    auto const j = MemoryAccounting::instance().to_json();
+    for (size_t i = 0; i < static_cast<size_t>(MemorySubsystem::max); i++)
+    {
+        auto const name = memory_subsystem_name(static_cast<MemorySubsystem>(i));
+        ASSERT_TRUE(j.contains(name)) << name;
+        EXPECT_TRUE(j[name].contains("bytes"));
+        EXPECT_TRUE(j[name].contains("objects"));
+    }
+    EXPECT_TRUE(j.contains("total_bytes"));
+}
@@ -0,0 +1,121 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "metrics.h"
+#include "window_manager_mutex.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+
+using namespace miracle;
+using namespace std::chrono_literals;
+
+TEST(MetricsTest, CountersAreSummedAcrossThreads)
+{
+    Metrics metrics;
+    metrics.increment(MetricCounter::frames);
+    std::thread other([&]
+    {
+        for (int i = 0; i < 1000; i++)
+            metrics.increment(MetricCounter::frames, 2);
+    });
+    other.join();
+
+    EXPECT_EQ(metrics.snapshot().counter(MetricCounter::frames), 2001);
+    EXPECT_EQ(metrics.snapshot().counter(MetricCounter::relayouts), 0);
+}
+
+TEST(MetricsTest, ObservationsFallIntoTheFirstBucketThatHoldsThem)
+{
+    Metrics metrics;
+    metrics.observe(MetricHistogram::frame_time, 5us);
+    metrics.observe(MetricHistogram::frame_time, 10us);
+    metrics.observe(MetricHistogram::frame_time, 700us);
+    metrics.observe(MetricHistogram::frame_time, 1s);
+
+    auto const histogram = metrics.snapshot().histogram(MetricHistogram::frame_time);
+    EXPECT_EQ(histogram.count, 4);
+    EXPECT_EQ(histogram.sum, 1s + 715us);
+    EXPECT_EQ(histogram.buckets[0], 2);
+    EXPECT_EQ(histogram.buckets[5], 1);
+
+    // Above the last bound, an observation only counts toward the total
+    uint64_t bucketed = 0;
+    for (auto const count : histogram.buckets)
+        bucketed += count;
+    EXPECT_EQ(bucketed, 3);
+}
+
+TEST(MetricsTest, PrometheusBucketsAreCumulative)
+{
+    Metrics metrics;
+    metrics.observe(MetricHistogram::input_time, 20us);
+    metrics.observe(MetricHistogram::input_time, 80us);
+    metrics.increment(MetricCounter::input_events, 2);
+
+    auto const text = metrics.to_prometheus();
+    EXPECT_NE(text.find("# TYPE miracle_input_events_total counter\nmiracle_input_events_total 2\n"), std::string::npos);
+    EXPECT_NE(text.find("miracle_input_seconds_bucket{le=\"5e-05\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("miracle_input_seconds_bucket{le=\"0.0001\"} 2\n"), std::string::npos);
+    EXPECT_NE(text.find("miracle_input_seconds_bucket{le=\"+Inf\"} 2\n"), std::string::npos);
+    EXPECT_NE(text.find("miracle_input_seconds_count 2\n"), std::string::npos);
+}
+
+TEST(MetricsTest, JsonHoldsEveryCounter)
+{
+    Metrics metrics;
+    metrics.increment(MetricCounter::config_reloads);
+    auto const json = metrics.to_json();
+    EXPECT_EQ(json["counters"].size(), static_cast<size_t>(MetricCounter::max));
+    EXPECT_EQ(json["counters"]["miracle_config_reloads_total"], 1);
+}
+
+TEST(MetricsTest, WaitingForTheWindowManagerLockIsRecorded)
+{
+    auto const before = Metrics::instance().snapshot();
+    WindowManagerMutex mutex;
+
+    // Taking a free lock, or taking it again on the same thread, is not a contention
+    {
+        std::lock_guard outer(mutex);
+        std::lock_guard inner(mutex);
+    }
+    EXPECT_EQ(
+        Metrics::instance().snapshot().counter(MetricCounter::lock_contentions),
+        before.counter(MetricCounter::lock_contentions));
+
+    std::atomic<bool> is_waiting = false;
+    std::thread other;
+    {
+        std::lock_guard lock(mutex);
+        other = std::thread([&]
+        {
+            is_waiting = true;
+            std::lock_guard other_lock(mutex);
+        });
+        while (!is_waiting)
+            std::this_thread::yield();
+        std::this_thread::sleep_for(20ms);
+    }
+    other.join();
+
+    auto const after = Metrics::instance().snapshot();
+    EXPECT_EQ(after.counter(MetricCounter::lock_contentions), before.counter(MetricCounter::lock_contentions) + 1);
+    EXPECT_GE(
+        after.histogram(MetricHistogram::lock_wait).sum - before.histogram(MetricHistogram::lock_wait).sum,
+        10ms);
+}
@@ -0,0 +1,185 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "mirror_groups.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace miracle;
+
+namespace
+{
+int const LAPTOP = 0;
+int const PROJECTOR = 1;
+int const MONITOR = 2;
+
+mir::geometry::Rectangle const VIEWPORT { { 0, 0 }, { 1920, 1080 } };
+mir::geometry::Size const FULL_HD { 1920, 1080 };
+mir::geometry::Size const HD { 1280, 720 };
+
+std::shared_ptr<MirrorFrame const> frame_of(uint64_t scene)
+{
+    return std::make_shared<MirrorFrame const>(MirrorFrame { .texture = 1, .scene = scene });
+}
+}
+
+class MirrorGroupsTest : public testing::Test
+{
+public:
+    MirrorGroups groups;
+};
+
+TEST_F(MirrorGroupsTest, an_output_by_itself_is_alone)
+{
+    groups.set_output(&LAPTOP, VIEWPORT, FULL_HD, false, 1, true);
+    EXPECT_EQ(groups.role(&LAPTOP), MirrorGroups::Role::alone);
+}
+
+TEST_F(MirrorGroupsTest, the_output_with_the_most_pixels_is_the_source)
+{
+    groups.set_output(&PROJECTOR, VIEWPORT, HD, false, 1, true);
+    groups.set_output(&LAPTOP, VIEWPORT, FULL_HD, false, 1, true);
+
+    EXPECT_EQ(groups.role(&LAPTOP), MirrorGroups::Role::source);
+    EXPECT_EQ(groups.role(&PROJECTOR), MirrorGroups::Role::mirror);
+}
+
+TEST_F(MirrorGroupsTest, outputs_that_show_different_areas_are_alone)
+{
+    groups.set_output(&LAPTOP, VIEWPORT, FULL_HD, false, 1, true);
+    groups.set_output(&MONITOR, { { 1920, 0 }, { 1920, 1080 } }, FULL_HD, false, 1, true);
+
+    EXPECT_EQ(groups.role(&LAPTOP), MirrorGroups::Role::alone);
+    EXPECT_EQ(groups.role(&MONITOR), MirrorGroups::Role::alone);
+}
+
+TEST_F(MirrorGroupsTest, outputs_of_another_aspect_ratio_are_alone)
+{
+    groups.set_output(&LAPTOP, VIEWPORT, { 1920, 1200 }, false, 1, true);
+    groups.set_output(&PROJECTOR, VIEWPORT, FULL_HD, false, 1, true);
+
+    EXPECT_EQ(groups.role(&LAPTOP), MirrorGroups::Role::alone);
+    EXPECT_EQ(groups.role(&PROJECTOR), MirrorGroups::Role::alone);
+}
+
+TEST_F(MirrorGroupsTest, outputs_that_cannot_share_are_alone)
+{
+    groups.set_output(&LAPTOP, VIEWPORT, FULL_HD, false, 1, true);
+    groups.set_output(&PROJECTOR, VIEWPORT, HD, false, 1, false);
+
+    EXPECT_EQ(groups.role(&LAPTOP), MirrorGroups::Role::alone);
+    EXPECT_EQ(groups.role(&PROJECTOR), MirrorGroups::Role::alone);
+}
+
+TEST_F(MirrorGroupsTest, outputs_in_different_share_groups_are_alone)
+{
+    groups.set_output(&LAPTOP, VIEWPORT, FULL_HD, false, 1, true);
+    groups.set_output(&PROJECTOR, VIEWPORT, HD, false, 2, true);
+
+    EXPECT_EQ(groups.role(&LAPTOP), MirrorGroups::Role::alone);
+    EXPECT_EQ(groups.role(&PROJECTOR), MirrorGroups::Role::alone);
+}
+
+TEST_F(MirrorGroupsTest, outputs_with_their_rows_the_other_way_are_alone)
+{
+    groups.set_output(&LAPTOP, VIEWPORT, FULL_HD, false, 1, true);
+    groups.set_output(&PROJECTOR, VIEWPORT, HD, true, 1, true);
+
+    EXPECT_EQ(groups.role(&LAPTOP), MirrorGroups::Role::alone);
+    EXPECT_EQ(groups.role(&PROJECTOR), MirrorGroups::Role::alone);
+}
+
+TEST_F(MirrorGroupsTest, removing_the_source_leaves_its_mirror_alone)
+{
+    groups.set_output(&LAPTOP, VIEWPORT, FULL_HD, false, 1, true);
+    groups.set_output(&PROJECTOR, VIEWPORT, HD, false, 1, true);
+    groups.remove(&LAPTOP);
+
+    EXPECT_EQ(groups.role(&PROJECTOR), MirrorGroups::Role::alone);
+}
+
+TEST_F(MirrorGroupsTest, a_mirror_is_only_given_a_frame_of_its_own_scene)
+{
+    groups.set_output(&LAPTOP, VIEWPORT, FULL_HD, false, 1, true);
+    groups.set_output(&PROJECTOR, VIEWPORT, HD, false, 1, true);
+    groups.publish(&LAPTOP, frame_of(1));
+
+    EXPECT_EQ(groups.frame_for(&PROJECTOR, 2, std::chrono::nanoseconds(0)), nullptr);
+
+    auto const frame = groups.frame_for(&PROJECTOR, 1, std::chrono::nanoseconds(0));
+    ASSERT_NE(frame, nullptr);
+    EXPECT_EQ(frame->scene, 1);
+    groups.finish_reading(&PROJECTOR, nullptr);
+}
+
+TEST_F(MirrorGroupsTest, a_frame_is_withdrawn_while_the_source_draws)
+{
+    groups.set_output(&LAPTOP, VIEWPORT, FULL_HD, false, 1, true);
+    groups.set_output(&PROJECTOR, VIEWPORT, HD, false, 1, true);
+    groups.publish(&LAPTOP, frame_of(1));
+
+    std::vector<std::shared_ptr<GpuFence const>> reads;
+    groups.begin_drawing(&LAPTOP, reads);
+
+    EXPECT_EQ(groups.frame_for(&PROJECTOR, 1, std::chrono::nanoseconds(0)), nullptr);
+}
+
+TEST_F(MirrorGroupsTest, a_mirror_waits_for_a_source_on_another_thread)
+{
+    groups.set_output(&LAPTOP, VIEWPORT, FULL_HD, false, 1, true);
+    groups.set_output(&PROJECTOR, VIEWPORT, HD, false, 1, true);
+
+    std::thread([&]
+    {
+        groups.publish(&LAPTOP, frame_of(1));
+    }).join();
+
+    std::thread source([&]
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        groups.publish(&LAPTOP, frame_of(2));
+    });
+
+    auto const frame = groups.frame_for(&PROJECTOR, 2, std::chrono::seconds(5));
+    source.join();
+
+    ASSERT_NE(frame, nullptr);
+    EXPECT_EQ(frame->scene, 2);
+    groups.finish_reading(&PROJECTOR, nullptr);
+}
+
+TEST_F(MirrorGroupsTest, the_source_waits_for_mirrors_that_are_reading_its_frame)
+{
+    groups.set_output(&LAPTOP, VIEWPORT, FULL_HD, false, 1, true);
+    groups.set_output(&PROJECTOR, VIEWPORT, HD, false, 1, true);
+    groups.publish(&LAPTOP, frame_of(1));
+    ASSERT_NE(groups.frame_for(&PROJECTOR, 1, std::chrono::nanoseconds(0)), nullptr);
+
+    std::atomic<bool> has_begun_drawing = false;
+    std::thread source([&]
+    {
+        std::vector<std::shared_ptr<GpuFence const>> reads;
+        groups.begin_drawing(&LAPTOP, reads);
+        has_begun_drawing = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_FALSE(has_begun_drawing);
+    groups.finish_reading(&PROJECTOR, nullptr);
+    source.join();
+    EXPECT_TRUE(has_begun_drawing);
+}
@@ -0,0 +1,76 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "mpsc_queue.h"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace miracle;
+
+TEST(MpscQueueTest, starts_empty)
+{
+    MpscQueue<int> queue;
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.drain([](int) { }), 0);
+}
+
+TEST(MpscQueueTest, drains_in_the_order_pushed)
+{
+    MpscQueue<int> queue;
+    for (int i = 0; i < 5; i++)
+        queue.push(i);
+    EXPECT_FALSE(queue.empty());
+
+    std::vector<int> drained;
+    EXPECT_EQ(queue.drain([&](int value) { drained.push_back(value); }), 5);
+    EXPECT_EQ(drained, std::vector<int>({ 0, 1, 2, 3, 4 }));
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(MpscQueueTest, items_from_every_producer_are_drained_in_order)
+{
+    int const producers = 4;
+    int const items = 10'000;
+    MpscQueue<std::pair<int, int>> queue;
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++)
+    {
+        threads.emplace_back([&queue, p]
+        {
+            for (int i = 0; i < items; i++)
+                queue.push({ p, i });
+        });
+    }
+
+    std::vector<int> next(producers, 0);
+    int drained = 0;
+    auto const consume = [&](std::pair<int, int> item)
+    {
+        EXPECT_EQ(item.second, next[item.first]);
+        next[item.first] = item.second + 1;
+        drained++;
+    };
+
+    while (drained < producers * items)
+        queue.drain(consume);
+
+    for (auto& thread : threads)
+        thread.join();
+    EXPECT_TRUE(queue.empty());
+}
@@ -231,3 +231,43 @@ TEST(OutputManagerTest, remove_focused_output)
     EXPECT_EQ(focused_output, nullptr);
     EXPECT_TRUE(manager->outputs().size() == 1);
 }
+
+TEST(OutputManagerTest, output_at_finds_the_output_under_the_point)
+{
+    // Arrange
+    auto mock_factory = std::make_unique<test::MockOutputFactory>();
+    auto mock_output = new test::MockOutput(); // Will be owned by unique_ptr
+
+    EXPECT_CALL(*mock_factory, create("Output1", 1, mir::geometry::Rectangle {
+                                                        { 0,    0    },
+                                                        { 1920, 1080 }
+    }))
+        .WillOnce(testing::Return(std::unique_ptr<OutputInterface>(mock_output)));
+
+    ON_CALL(*mock_output, id())
+        .WillByDefault(testing::Return(1));
+
+    static const std::vector<std::shared_ptr<WorkspaceInterface>> empty_workspaces;
+    ON_CALL(*mock_output, get_workspaces).WillByDefault(::testing::ReturnRef(empty_workspaces));
+
+    auto workspace_registry = std::make_shared<WorkspaceObserverRegistrar>();
+    auto config = std::make_shared<test::StubConfiguration>();
+    auto manager = std::make_shared<OutputManager>(std::move(mock_factory));
+    auto workspace_manager = std::make_shared<WorkspaceManager>(workspace_registry, config, manager);
+
+    manager->create("Output1", 1, {
+                                      { 0,    0    },
+                                      { 1920, 1080 }
+    },
+        *workspace_manager);
+
+    // Act
+    manager->update(1, {
+                           { 0,    0   },
+                           { 1280, 720 }
+    });
+
+    // Assert
+    EXPECT_EQ(manager->output_at({ 100, 100 }), mock_output);
+    EXPECT_EQ(manager->output_at({ 1500, 100 }), nullptr);
+}
@@ -0,0 +1,72 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "overview_layout.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+namespace geom = mir::geometry;
+
+namespace
+{
+geom::Rectangle const output_area { geom::Point { 1920, 0 }, geom::Size { 1920, 1080 } };
+
+glm::vec2 apply(glm::mat4 const& transform, int x, int y)
+{
+    auto const result = transform * glm::vec4(static_cast<float>(x), static_cast<float>(y), 0, 1);
+    return { result.x, result.y };
+}
+}
+
+TEST(OverviewLayoutTest, NoWorkspacesHaveNoCells)
+{
+    EXPECT_TRUE(layout_overview(output_area, 0).empty());
+}
+
+TEST(OverviewLayoutTest, WorkspacesAreArrangedInANearlySquareGrid)
+{
+    auto const cells = layout_overview(output_area, 5, 0);
+    ASSERT_EQ(cells.size(), 5);
+
+    // Three columns and two rows, so each workspace is a third of the output
+    EXPECT_EQ(cells[0].area, geom::Rectangle(geom::Point(1920, 90), geom::Size(640, 360)));
+    EXPECT_EQ(cells[2].area, geom::Rectangle(geom::Point(3200, 90), geom::Size(640, 360)));
+    EXPECT_EQ(cells[3].area, geom::Rectangle(geom::Point(1920, 630), geom::Size(640, 360)));
+}
+
+TEST(OverviewLayoutTest, CellsStayWithinTheOutput)
+{
+    for (size_t count = 1; count <= 10; count++)
+    {
+        for (auto const& cell : layout_overview(output_area, count))
+            EXPECT_TRUE(output_area.contains(cell.area)) << "count=" << count;
+    }
+}
+
+TEST(OverviewLayoutTest, TransformTakesTheOutputOntoTheCell)
+{
+    auto const cells = layout_overview(output_area, 4);
+    ASSERT_EQ(cells.size(), 4);
+
+    auto const& cell = cells[3];
+    auto const top_left = apply(cell.transform, 1920, 0);
+    auto const bottom_right = apply(cell.transform, 1920 + 1920, 1080);
+    EXPECT_NEAR(top_left.x, cell.area.top_left.x.as_int(), 1);
+    EXPECT_NEAR(top_left.y, cell.area.top_left.y.as_int(), 1);
+    EXPECT_NEAR(bottom_right.x, cell.area.bottom_right().x.as_int(), 1);
+    EXPECT_NEAR(bottom_right.y, cell.area.bottom_right().y.as_int(), 1);
+}
@@ -0,0 +1,57 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "perfect_hash.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+
+namespace
+{
+enum class Fruit
+{
+    apple,
+    banana,
+    cherry
+};
+
+constexpr PerfectHashMap<Fruit, 3> fruits({
+    { "apple",  Fruit::apple  },
+    { "banana", Fruit::banana },
+    { "cherry", Fruit::cherry },
+});
+}
+
+TEST(PerfectHashMapTest, finds_every_key)
+{
+    EXPECT_EQ(fruits.find("apple"), Fruit::apple);
+    EXPECT_EQ(fruits.find("banana"), Fruit::banana);
+    EXPECT_EQ(fruits.find("cherry"), Fruit::cherry);
+}
+
+TEST(PerfectHashMapTest, does_not_find_unknown_keys)
+{
+    EXPECT_EQ(fruits.find(""), std::nullopt);
+    EXPECT_EQ(fruits.find("appl"), std::nullopt);
+    EXPECT_EQ(fruits.find("durian"), std::nullopt);
+}
+
+TEST(PerfectHashMapTest, can_be_evaluated_at_compile_time)
+{
+    static_assert(fruits.find("banana") == Fruit::banana);
+    static_assert(!fruits.find("kiwi"));
+}
@@ -0,0 +1,57 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "pool_allocator.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+
+namespace
+{
+struct Pooled
+{
+    int value = 0;
+};
+}
+
+TEST(PoolAllocatorTest, freed_objects_are_recycled)
+{
+    auto first = std::allocate_shared<Pooled>(PoolAllocator<Pooled>(), 1);
+    auto const* address = first.get();
+    first.reset();
+
+    auto const second = std::allocate_shared<Pooled>(PoolAllocator<Pooled>(), 2);
+    EXPECT_EQ(second.get(), address);
+    EXPECT_EQ(second->value, 2);
+}
+
+TEST(PoolAllocatorTest, live_objects_are_distinct)
+{
+    auto const first = std::allocate_shared<Pooled>(PoolAllocator<Pooled>());
+    auto const second = std::allocate_shared<Pooled>(PoolAllocator<Pooled>());
+    EXPECT_NE(first.get(), second.get());
+}
+
+TEST(BlockFreeListTest, full_lists_reject_blocks)
+{
+    BlockFreeList list(1);
+    int a, b;
+    EXPECT_TRUE(list.push(&a));
+    EXPECT_FALSE(list.push(&b));
+    EXPECT_EQ(list.pop(), &a);
+    EXPECT_EQ(list.pop(), nullptr);
+}
@@ -0,0 +1,87 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "program_binary_cache.h"
+#include <fstream>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+using namespace miracle;
+
+class ProgramBinaryCacheTest : public testing::Test
+{
+public:
+    ProgramBinaryCacheTest() :
+        directory { std::filesystem::temp_directory_path() / ("miracle-wm-program-cache-" + std::to_string(getpid())) },
+        cache { directory, "vendor\nrenderer\nversion" }
+    {
+    }
+
+    ~ProgramBinaryCacheTest() override
+    {
+        std::filesystem::remove_all(directory);
+    }
+
+    std::filesystem::path directory;
+    ProgramBinaryCache cache;
+    ProgramBinary const binary { .format = 42, .data = { 'a', 'b', 'c' } };
+};
+
+TEST_F(ProgramBinaryCacheTest, missing_entry_is_not_loaded)
+{
+    EXPECT_EQ(cache.load(cache.key({ "vertex", "fragment" })), std::nullopt);
+}
+
+TEST_F(ProgramBinaryCacheTest, stored_entry_can_be_loaded)
+{
+    auto const key = cache.key({ "vertex", "fragment" });
+    cache.store(key, binary);
+    EXPECT_EQ(cache.load(key), binary);
+}
+
+TEST_F(ProgramBinaryCacheTest, erased_entry_is_not_loaded)
+{
+    auto const key = cache.key({ "vertex", "fragment" });
+    cache.store(key, binary);
+    cache.erase(key);
+    EXPECT_EQ(cache.load(key), std::nullopt);
+}
+
+TEST_F(ProgramBinaryCacheTest, key_depends_on_sources)
+{
+    EXPECT_EQ(cache.key({ "vertex", "fragment" }), cache.key({ "vertex", "fragment" }));
+    EXPECT_NE(cache.key({ "vertex", "fragment" }), cache.key({ "vertex", "other" }));
+    EXPECT_NE(cache.key({ "ab", "c" }), cache.key({ "a", "bc" }));
+}
+
+TEST_F(ProgramBinaryCacheTest, key_depends_on_driver)
+{
+    ProgramBinaryCache other { directory, "another driver" };
+    EXPECT_NE(cache.key({ "vertex", "fragment" }), other.key({ "vertex", "fragment" }));
+}
+
+TEST_F(ProgramBinaryCacheTest, truncated_entry_is_not_loaded)
+{
+    auto const key = cache.key({ "vertex", "fragment" });
+    cache.store(key, binary);
+
+    std::ofstream file(directory / (key + ".bin"), std::ios::binary | std::ios::trunc);
+    file << "MW";
+    file.close();
+
+    EXPECT_EQ(cache.load(key), std::nullopt);
+}
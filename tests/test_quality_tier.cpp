@@ -0,0 +1,49 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "quality_tier.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+
+TEST(QualityTierTest, software_renderers_are_given_the_reduced_tier)
+{
+    EXPECT_EQ(detect_quality_tier("llvmpipe (LLVM 17.0.6, 256 bits)"), QualityTier::reduced);
+    EXPECT_EQ(detect_quality_tier("softpipe"), QualityTier::reduced);
+    EXPECT_EQ(detect_quality_tier("Software Rasterizer"), QualityTier::reduced);
+    EXPECT_EQ(detect_quality_tier("Google SwiftShader"), QualityTier::reduced);
+}
+
+TEST(QualityTierTest, hardware_renderers_are_given_the_full_tier)
+{
+    EXPECT_EQ(detect_quality_tier("AMD Radeon RX 7900 XTX (radeonsi, navi31, LLVM 17.0.6, DRM 3.57)"), QualityTier::full);
+    EXPECT_EQ(detect_quality_tier("Mesa Intel(R) UHD Graphics 620 (KBL GT2)"), QualityTier::full);
+    EXPECT_EQ(detect_quality_tier("NVIDIA GeForce RTX 4070/PCIe/SSE2"), QualityTier::full);
+}
+
+TEST(QualityTierTest, an_unknown_renderer_is_given_the_full_tier)
+{
+    EXPECT_EQ(detect_quality_tier(""), QualityTier::full);
+}
+
+TEST(QualityTierTest, tiers_are_parsed_from_their_names)
+{
+    EXPECT_EQ(from_string_quality_tier("full"), QualityTier::full);
+    EXPECT_EQ(from_string_quality_tier("reduced"), QualityTier::reduced);
+    EXPECT_EQ(from_string_quality_tier("fancy"), std::nullopt);
+    EXPECT_STREQ(to_string(QualityTier::reduced), "reduced");
+}
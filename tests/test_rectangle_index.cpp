@@ -0,0 +1,132 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "rectangle_index.h"
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace miracle;
+namespace geom = mir::geometry;
+
+namespace
+{
+using Index = RectangleIndex<int>;
+
+geom::Rectangle rect(int x, int y, int width, int height)
+{
+    return geom::Rectangle { geom::Point(x, y), geom::Size(width, height) };
+}
+}
+
+TEST(RectangleIndexTest, empty_index_finds_nothing)
+{
+    Index const index;
+    EXPECT_EQ(index.find(geom::Point(0, 0)), nullptr);
+}
+
+TEST(RectangleIndexTest, finds_the_rectangle_that_contains_the_point)
+{
+    Index const index({
+        { rect(0,   0, 100, 100), 1 },
+        { rect(100, 0, 100, 100), 2 },
+    });
+
+    ASSERT_NE(index.find(geom::Point(50, 50)), nullptr);
+    EXPECT_EQ(*index.find(geom::Point(50, 50)), 1);
+    EXPECT_EQ(*index.find(geom::Point(100, 0)), 2);
+    EXPECT_EQ(*index.find(geom::Point(199, 99)), 2);
+}
+
+TEST(RectangleIndexTest, points_outside_every_rectangle_find_nothing)
+{
+    Index const index({
+        { rect(0,   0, 100, 100), 1 },
+        { rect(200, 0, 100, 100), 2 },
+    });
+
+    EXPECT_EQ(index.find(geom::Point(150, 50)), nullptr);
+    EXPECT_EQ(index.find(geom::Point(-1, 50)), nullptr);
+    EXPECT_EQ(index.find(geom::Point(50, 100)), nullptr);
+}
+
+TEST(RectangleIndexTest, earlier_entries_win_where_rectangles_overlap)
+{
+    Index const index({
+        { rect(50, 50, 100, 100), 1 },
+        { rect(0,  0,  200, 200), 2 },
+    });
+
+    EXPECT_EQ(*index.find(geom::Point(60, 60)), 1);
+    EXPECT_EQ(*index.find(geom::Point(10, 10)), 2);
+}
+
+TEST(RectangleIndexTest, rejected_entries_are_skipped)
+{
+    Index const index({
+        { rect(0, 0, 100, 100), 1 },
+        { rect(0, 0, 100, 100), 2 },
+    });
+
+    EXPECT_EQ(*index.find(geom::Point(10, 10), [](int value)
+    { return value != 1; }),
+        2);
+}
+
+TEST(RectangleIndexTest, empty_rectangles_are_never_found)
+{
+    Index const index({
+        { rect(0, 0, 0,   100), 1 },
+        { rect(0, 0, 100, 100), 2 },
+    });
+
+    EXPECT_EQ(*index.find(geom::Point(0, 0)), 2);
+}
+
+TEST(RectangleIndexTest, matches_a_linear_scan)
+{
+    std::mt19937 random(7);
+    std::uniform_int_distribution<int> position(-500, 2000);
+    std::uniform_int_distribution<int> extent(1, 600);
+
+    std::vector<Index::Entry> entries;
+    for (int i = 0; i < 200; i++)
+        entries.push_back({ rect(position(random), position(random), extent(random), extent(random)), i });
+    Index const index(entries);
+
+    for (int i = 0; i < 5000; i++)
+    {
+        geom::Point const point(position(random), position(random));
+        int const* expected = nullptr;
+        for (auto const& entry : entries)
+        {
+            if (entry.area.contains(point))
+            {
+                expected = &entry.value;
+                break;
+            }
+        }
+
+        auto const found = index.find(point);
+        if (expected)
+        {
+            ASSERT_NE(found, nullptr);
+            EXPECT_EQ(*found, *expected);
+        }
+        else
+            EXPECT_EQ(found, nullptr);
+    }
+}
@@ -16,8 +16,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 **/
 
 #include "mock_container.h"
+#include "mock_workspace.h"
 #include "render_data_manager.h"
 #include <gtest/gtest.h>
+#include <thread>
 
 using namespace miracle;
 
@@ -113,6 +115,62 @@ TEST_F(RenderDataManagerTest, can_change_workspace_transform)
     ASSERT_EQ(result[0].workspace_transform, glm::mat4(2.f));
 }
 
+TEST_F(RenderDataManagerTest, workspace_transforms_override_those_of_their_windows)
+{
+    ::testing::NiceMock<test::MockWorkspace> workspace;
+    ON_CALL(workspace, id())
+        .WillByDefault(::testing::Return(3));
+    ::testing::NiceMock<test::MockContainer> container;
+    ON_CALL(container, window())
+        .WillByDefault(::testing::Return(miral::Window()));
+    ON_CALL(container, get_workspace())
+        .WillByDefault(::testing::Return(&workspace));
+    ON_CALL(container, get_output_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+    ON_CALL(container, get_workspace_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+    ON_CALL(container, get_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+
+    render_data_manager.add(container);
+    render_data_manager.workspace_transform_change(3, glm::mat4(2.f));
+    ASSERT_EQ(render_data_manager.get()[0].workspace_transform, glm::mat4(2.f));
+
+    render_data_manager.clear_workspace_transform(3);
+    ASSERT_EQ(render_data_manager.get()[0].workspace_transform, glm::mat4(1.f));
+}
+
+TEST_F(RenderDataManagerTest, windows_take_the_transform_of_the_workspace_they_move_to)
+{
+    ::testing::NiceMock<test::MockWorkspace> first;
+    ON_CALL(first, id())
+        .WillByDefault(::testing::Return(3));
+    ::testing::NiceMock<test::MockWorkspace> second;
+    ON_CALL(second, id())
+        .WillByDefault(::testing::Return(4));
+    ::testing::NiceMock<test::MockContainer> container;
+    ON_CALL(container, window())
+        .WillByDefault(::testing::Return(miral::Window()));
+    ON_CALL(container, get_workspace())
+        .WillByDefault(::testing::Return(&first));
+    ON_CALL(container, get_output_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+    ON_CALL(container, get_workspace_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+    ON_CALL(container, get_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+
+    render_data_manager.add(container);
+    render_data_manager.workspace_transform_change(3, glm::mat4(2.f));
+    render_data_manager.workspace_transform_change(4, glm::mat4(3.f));
+    ASSERT_EQ(render_data_manager.get()[0].workspace_transform, glm::mat4(2.f));
+
+    ON_CALL(container, get_workspace())
+        .WillByDefault(::testing::Return(&second));
+    render_data_manager.workspace_change(container);
+    ASSERT_EQ(render_data_manager.get()[0].workspace_transform, glm::mat4(3.f));
+}
+
 TEST_F(RenderDataManagerTest, can_change_focus)
 {
     ::testing::NiceMock<test::MockContainer> container;
@@ -143,6 +201,261 @@ TEST_F(RenderDataManagerTest, can_change_focus)
     ASSERT_EQ(result[0].workspace_transform, glm::mat4(1.f));
 }
 
+TEST_F(RenderDataManagerTest, snapshot_is_reused_when_nothing_changes)
+{
+    ::testing::NiceMock<test::MockContainer> container;
+    ON_CALL(container, window())
+        .WillByDefault(::testing::Return(miral::Window()));
+    ON_CALL(container, get_type())
+        .WillByDefault(::testing::Return(ContainerType::leaf));
+    ON_CALL(container, get_output_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+    ON_CALL(container, get_workspace_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+    ON_CALL(container, get_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+
+    render_data_manager.add(container);
+
+    auto first = render_data_manager.get();
+    auto second = render_data_manager.get();
+    ASSERT_EQ(first.generation(), second.generation());
+    ASSERT_EQ(&first[0], &second[0]);
+}
+
+TEST_F(RenderDataManagerTest, update_only_replaces_the_snapshot_when_the_data_changes)
+{
+    ::testing::NiceMock<test::MockContainer> container;
+    ON_CALL(container, window())
+        .WillByDefault(::testing::Return(miral::Window()));
+    ON_CALL(container, get_type())
+        .WillByDefault(::testing::Return(ContainerType::leaf));
+    ON_CALL(container, get_output_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+    ON_CALL(container, get_workspace_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+    ON_CALL(container, get_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+
+    render_data_manager.add(container);
+
+    RenderDataSnapshot snapshot;
+    RenderDataFetch fetch;
+    render_data_manager.update(snapshot, fetch);
+    ASSERT_TRUE(fetch.refreshed);
+    ASSERT_FALSE(fetch.contended);
+    ASSERT_EQ(snapshot.size(), 1);
+
+    render_data_manager.update(snapshot, fetch);
+    ASSERT_FALSE(fetch.refreshed);
+
+    ON_CALL(container, get_transform())
+        .WillByDefault(::testing::Return(glm::mat4(2.f)));
+    render_data_manager.transform_change(container);
+    render_data_manager.update(snapshot, fetch);
+    ASSERT_TRUE(fetch.refreshed);
+    ASSERT_EQ(snapshot[0].transform, glm::mat4(2.f));
+}
+
+TEST_F(RenderDataManagerTest, snapshot_is_unaffected_by_later_changes)
+{
+    ::testing::NiceMock<test::MockContainer> container;
+    ON_CALL(container, window())
+        .WillByDefault(::testing::Return(miral::Window()));
+    ON_CALL(container, get_type())
+        .WillByDefault(::testing::Return(ContainerType::leaf));
+    ON_CALL(container, get_output_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+    ON_CALL(container, get_workspace_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+    ON_CALL(container, get_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+
+    render_data_manager.add(container);
+    auto before = render_data_manager.get();
+
+    ON_CALL(container, get_transform())
+        .WillByDefault(::testing::Return(glm::mat4(2.f)));
+    render_data_manager.transform_change(container);
+    auto after = render_data_manager.get();
+
+    ASSERT_NE(before.generation(), after.generation());
+    ASSERT_EQ(before[0].transform, glm::mat4(1.f));
+    ASSERT_EQ(after[0].transform, glm::mat4(2.f));
+}
+
+TEST_F(RenderDataManagerTest, mode_and_drag_preview_are_published_with_the_snapshot)
+{
+    auto before = render_data_manager.get();
+    mir::geometry::Rectangle const area { { 10, 20 }, { 300, 400 } };
+    render_data_manager.mode_change(WindowManagerMode::dragging);
+    render_data_manager.drag_preview_change(area);
+    auto after = render_data_manager.get();
+
+    ASSERT_EQ(before.mode(), WindowManagerMode::normal);
+    ASSERT_FALSE(before.drag_preview().has_value());
+    ASSERT_EQ(after.mode(), WindowManagerMode::dragging);
+    ASSERT_EQ(after.drag_preview(), area);
+}
+
+TEST_F(RenderDataManagerTest, setting_the_same_mode_does_not_publish_a_snapshot)
+{
+    render_data_manager.mode_change(WindowManagerMode::selecting);
+    auto before = render_data_manager.get();
+    render_data_manager.mode_change(WindowManagerMode::selecting);
+    auto after = render_data_manager.get();
+
+    ASSERT_EQ(before.generation(), after.generation());
+}
+
+TEST_F(RenderDataManagerTest, batched_changes_are_published_together)
+{
+    ::testing::NiceMock<test::MockContainer> container;
+    ON_CALL(container, window())
+        .WillByDefault(::testing::Return(miral::Window()));
+    ON_CALL(container, get_type())
+        .WillByDefault(::testing::Return(ContainerType::leaf));
+    ON_CALL(container, get_output_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+    ON_CALL(container, get_workspace_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+    ON_CALL(container, get_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+
+    render_data_manager.add(container);
+    auto before = render_data_manager.get();
+
+    {
+        RenderDataManager::Batch batch(render_data_manager);
+        ON_CALL(container, get_transform())
+            .WillByDefault(::testing::Return(glm::mat4(2.f)));
+        render_data_manager.transform_change(container);
+        ON_CALL(container, get_workspace_transform())
+            .WillByDefault(::testing::Return(glm::mat4(3.f)));
+        render_data_manager.workspace_transform_change(container);
+
+        auto during = render_data_manager.get();
+        ASSERT_EQ(before.generation(), during.generation());
+        ASSERT_EQ(during[0].transform, glm::mat4(1.f));
+    }
+
+    auto after = render_data_manager.get();
+    ASSERT_EQ(after.generation(), before.generation() + 1);
+    ASSERT_EQ(after[0].transform, glm::mat4(2.f));
+    ASSERT_EQ(after[0].workspace_transform, glm::mat4(3.f));
+}
+
+TEST_F(RenderDataManagerTest, changes_made_during_an_input_event_are_tagged_with_its_arrival)
+{
+    ::testing::NiceMock<test::MockContainer> container;
+    ON_CALL(container, window())
+        .WillByDefault(::testing::Return(miral::Window()));
+    ON_CALL(container, get_type())
+        .WillByDefault(::testing::Return(ContainerType::leaf));
+    ON_CALL(container, get_output_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+    ON_CALL(container, get_workspace_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+    ON_CALL(container, get_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+
+    render_data_manager.add(container);
+    ASSERT_FALSE(render_data_manager.get()[0].input_time);
+
+    auto const arrival = std::chrono::steady_clock::now();
+    {
+        RenderDataManager::InputTag tag(render_data_manager, arrival);
+        ON_CALL(container, is_focused())
+            .WillByDefault(::testing::Return(true));
+        render_data_manager.focus_change(container);
+    }
+
+    ASSERT_EQ(render_data_manager.get()[0].input_time, arrival);
+
+    // Changes made after the event was handled keep the tag of the event.
+    render_data_manager.transform_change(container);
+    ASSERT_EQ(render_data_manager.get()[0].input_time, arrival);
+}
+
+TEST_F(RenderDataManagerTest, changes_made_on_other_threads_are_not_tagged)
+{
+    ::testing::NiceMock<test::MockContainer> container;
+    ON_CALL(container, window())
+        .WillByDefault(::testing::Return(miral::Window()));
+    ON_CALL(container, get_type())
+        .WillByDefault(::testing::Return(ContainerType::leaf));
+    ON_CALL(container, get_output_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+    ON_CALL(container, get_workspace_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+    ON_CALL(container, get_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+
+    render_data_manager.add(container);
+
+    RenderDataManager::InputTag tag(render_data_manager, std::chrono::steady_clock::now());
+    std::thread([&]
+    {
+        render_data_manager.transform_change(container);
+    }).join();
+
+    ASSERT_FALSE(render_data_manager.get()[0].input_time);
+}
+
+TEST_F(RenderDataManagerTest, can_find_data_by_surface)
+{
+    ::testing::NiceMock<test::MockContainer> container;
+    ON_CALL(container, window())
+        .WillByDefault(::testing::Return(miral::Window()));
+    ON_CALL(container, get_type())
+        .WillByDefault(::testing::Return(ContainerType::leaf));
+    ON_CALL(container, get_output_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+    ON_CALL(container, get_workspace_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+    ON_CALL(container, get_transform())
+        .WillByDefault(::testing::Return(glm::mat4(1.f)));
+    ON_CALL(container, is_focused())
+        .WillByDefault(::testing::Return(true));
+
+    render_data_manager.add(container);
+
+    auto result = render_data_manager.get();
+    auto data = result.find(nullptr);
+    ASSERT_NE(data, nullptr);
+    ASSERT_TRUE(data->is_focused);
+}
+
+TEST_F(RenderDataManagerTest, snapshots_share_the_chunks_in_which_nothing_changed)
+{
+    std::vector<std::unique_ptr<::testing::NiceMock<test::MockContainer>>> containers;
+    for (int i = 0; i < 20; i++)
+    {
+        auto container = std::make_unique<::testing::NiceMock<test::MockContainer>>();
+        ON_CALL(*container, window())
+            .WillByDefault(::testing::Return(miral::Window()));
+        ON_CALL(*container, get_output_transform())
+            .WillByDefault(::testing::Return(glm::mat4(1.f)));
+        ON_CALL(*container, get_workspace_transform())
+            .WillByDefault(::testing::Return(glm::mat4(1.f)));
+        ON_CALL(*container, get_transform())
+            .WillByDefault(::testing::Return(glm::mat4(1.f)));
+        render_data_manager.add(*container);
+        containers.push_back(std::move(container));
+    }
+
+    auto before = render_data_manager.get();
+    ON_CALL(*containers[0], get_transform())
+        .WillByDefault(::testing::Return(glm::mat4(2.f)));
+    render_data_manager.transform_change(*containers[0]);
+    auto after = render_data_manager.get();
+
+    ASSERT_EQ(after.size(), 20);
+    ASSERT_NE(&before[0], &after[0]);
+    ASSERT_EQ(after[0].transform, glm::mat4(2.f));
+    ASSERT_EQ(&before[19], &after[19]);
+}
+
 class RenderDataManagerParameterizedTest : public RenderDataManagerTest, public ::testing::WithParamInterface<int>
 {
 };
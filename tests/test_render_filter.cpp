@@ -0,0 +1,76 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "render_filter.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+
+namespace
+{
+std::array<float, 3> apply(ColorMatrix const& matrix, std::array<float, 3> const& color)
+{
+    std::array<float, 3> result {};
+    for (size_t row = 0; row < 3; row++)
+    {
+        for (size_t column = 0; column < 3; column++)
+            result[row] += matrix[column * 3 + row] * color[column];
+    }
+
+    return result;
+}
+}
+
+TEST(RenderFilterTest, none_is_the_identity)
+{
+    EXPECT_EQ(color_filter_matrix(RenderFilter::none), (ColorMatrix { 1, 0, 0, 0, 1, 0, 0, 0, 1 }));
+}
+
+TEST(RenderFilterTest, grayscale_gives_every_channel_the_luminance)
+{
+    auto const result = apply(color_filter_matrix(RenderFilter::grayscale), { 1, 0, 0 });
+    EXPECT_FLOAT_EQ(result[0], 0.2126f);
+    EXPECT_FLOAT_EQ(result[1], 0.2126f);
+    EXPECT_FLOAT_EQ(result[2], 0.2126f);
+}
+
+TEST(RenderFilterTest, colorblind_filters_leave_grays_nearly_unchanged)
+{
+    for (auto const filter : { RenderFilter::protanopia, RenderFilter::deuteranopia, RenderFilter::tritanopia })
+    {
+        auto const result = apply(color_filter_matrix(filter), { 0.5f, 0.5f, 0.5f });
+        for (auto const channel : result)
+            EXPECT_NEAR(channel, 0.5f, 0.01f) << static_cast<int>(filter);
+    }
+}
+
+TEST(RenderFilterTest, protanopia_moves_red_into_the_other_channels)
+{
+    auto const result = apply(color_filter_matrix(RenderFilter::protanopia), { 1, 0, 0 });
+    EXPECT_GT(result[1], 0.f);
+    EXPECT_GT(result[2], 0.f);
+}
+
+TEST(RenderFilterTest, parses_every_filter_name)
+{
+    EXPECT_EQ(from_string_render_filter("none"), RenderFilter::none);
+    EXPECT_EQ(from_string_render_filter("grayscale"), RenderFilter::grayscale);
+    EXPECT_EQ(from_string_render_filter("protanopia"), RenderFilter::protanopia);
+    EXPECT_EQ(from_string_render_filter("deuteranopia"), RenderFilter::deuteranopia);
+    EXPECT_EQ(from_string_render_filter("tritanopia"), RenderFilter::tritanopia);
+    EXPECT_EQ(from_string_render_filter("sepia"), std::nullopt);
+}
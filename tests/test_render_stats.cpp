@@ -0,0 +1,234 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "render_stats.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+namespace geom = mir::geometry;
+
+namespace
+{
+int const RENDERER_1 = 1;
+int const RENDERER_2 = 2;
+}
+
+TEST(RollingSamplesTest, empty_samples_have_zero_percentiles)
+{
+    RollingSamples samples(10);
+    EXPECT_EQ(samples.percentile(0.5), 0);
+}
+
+TEST(RollingSamplesTest, percentiles_use_nearest_rank)
+{
+    RollingSamples samples(100);
+    for (int i = 100; i >= 1; i--)
+        samples.push(i);
+
+    EXPECT_EQ(samples.percentile(0.5), 50);
+    EXPECT_EQ(samples.percentile(0.95), 95);
+    EXPECT_EQ(samples.percentile(0.99), 99);
+    EXPECT_EQ(samples.percentile(1.0), 100);
+}
+
+TEST(RollingSamplesTest, oldest_samples_are_replaced_when_full)
+{
+    RollingSamples samples(2);
+    samples.push(100);
+    samples.push(1);
+    samples.push(2);
+
+    EXPECT_EQ(samples.size(), 2);
+    EXPECT_EQ(samples.percentile(1.0), 2);
+}
+
+class RenderStatsManagerTest : public testing::Test
+{
+public:
+    RenderStatsManager manager { 10 };
+    geom::Rectangle const area { geom::Point { 0, 0 }, geom::Size { 1920, 1080 } };
+};
+
+TEST_F(RenderStatsManagerTest, records_frames_per_renderer)
+{
+    manager.record(&RENDERER_1, area, { .frameno = 1, .renderables_drawn = 3 });
+    manager.record(&RENDERER_1, area, { .frameno = 2, .renderables_drawn = 4, .gl_errors = 1 });
+    manager.record(&RENDERER_2, area, { .frameno = 1 });
+
+    auto const outputs = manager.outputs();
+    ASSERT_EQ(outputs.size(), 2);
+
+    auto const& first = outputs[0].frames == 2 ? outputs[0] : outputs[1];
+    EXPECT_EQ(first.last.frameno, 2);
+    EXPECT_EQ(first.last.renderables_drawn, 4);
+    EXPECT_EQ(first.total_gl_errors, 1);
+    EXPECT_EQ(first.cpu_time_ms.size(), 2);
+}
+
+TEST_F(RenderStatsManagerTest, gpu_time_is_only_sampled_when_available)
+{
+    manager.record(&RENDERER_1, area, { .frameno = 1 });
+    manager.record(&RENDERER_1, area, { .frameno = 2, .gpu_time = std::chrono::milliseconds(4) });
+
+    auto const outputs = manager.outputs();
+    ASSERT_EQ(outputs.size(), 1);
+    EXPECT_EQ(outputs[0].gpu_time_ms.size(), 1);
+    EXPECT_EQ(outputs[0].gpu_time_ms.percentile(0.5), 4);
+}
+
+TEST_F(RenderStatsManagerTest, removed_renderers_are_not_reported)
+{
+    manager.record(&RENDERER_1, area, { .frameno = 1 });
+    manager.remove(&RENDERER_1);
+    EXPECT_TRUE(manager.outputs().empty());
+    EXPECT_TRUE(manager.to_json().empty());
+}
+
+TEST_F(RenderStatsManagerTest, json_reports_gpu_time_as_null_when_unavailable)
+{
+    manager.record(&RENDERER_1, area, { .frameno = 7, .outlines_drawn = 2 });
+
+    auto const j = manager.to_json();
+    ASSERT_EQ(j.size(), 1);
+    EXPECT_EQ(j[0]["frameno"], 7);
+    EXPECT_EQ(j[0]["outlines_drawn"], 2);
+    EXPECT_EQ(j[0]["rect"]["width"], 1920);
+    EXPECT_TRUE(j[0]["gpu_time_ms"].is_null());
+    EXPECT_TRUE(j[0]["cpu_time_ms"].contains("p99"));
+}
+
+TEST_F(RenderStatsManagerTest, render_data_contention_is_reported_per_renderer)
+{
+    manager.record(&RENDERER_1, area, { .frameno = 1, .render_data_refreshed = true });
+    manager.record(&RENDERER_1, area, { .frameno = 2, .render_data_refreshed = true, .render_data_contended = true, .render_data_wait = std::chrono::microseconds(250) });
+    manager.record(&RENDERER_2, area, { .frameno = 1 });
+
+    auto const outputs = manager.outputs();
+    ASSERT_EQ(outputs.size(), 2);
+
+    auto const& first = outputs[0].frames == 2 ? outputs[0] : outputs[1];
+    auto const& second = outputs[0].frames == 2 ? outputs[1] : outputs[0];
+    EXPECT_EQ(first.render_data_refreshes, 2);
+    EXPECT_EQ(first.render_data_contentions, 1);
+    EXPECT_EQ(first.total_render_data_wait, std::chrono::microseconds(250));
+    EXPECT_EQ(first.render_data_wait_us.percentile(0.5), 250);
+    EXPECT_EQ(second.render_data_contentions, 0);
+}
+
+TEST_F(RenderStatsManagerTest, input_latency_is_bucketed_per_renderer)
+{
+    manager.record(&RENDERER_1, area, { .frameno = 1, .input_latency = std::chrono::microseconds(40) });
+    manager.record(&RENDERER_1, area, { .frameno = 2 });
+    manager.record(&RENDERER_1, area, { .frameno = 3, .input_latency = std::chrono::seconds(1) });
+
+    auto const outputs = manager.outputs();
+    ASSERT_EQ(outputs.size(), 1);
+    EXPECT_EQ(outputs[0].input_latency_ms.size(), 2);
+    EXPECT_EQ(outputs[0].input_latency_buckets[1], 1);
+    EXPECT_EQ(outputs[0].input_latency_buckets.back(), 1);
+
+    auto const j = manager.to_json();
+    EXPECT_EQ(j[0]["input_latency"]["samples"], 2);
+    EXPECT_EQ(j[0]["input_latency"]["buckets"].size(), metric_histogram_bounds.size() + 1);
+    EXPECT_TRUE(j[0]["input_latency"]["buckets"].back()["le_ms"].is_null());
+}
+
+TEST_F(RenderStatsManagerTest, blur_updates_and_gpu_time_are_reported)
+{
+    manager.record(&RENDERER_1, area, { .frameno = 1, .blur_updated = true });
+    manager.record(&RENDERER_1, area, { .frameno = 2, .blur_gpu_time = std::chrono::microseconds(1500) });
+    manager.record(&RENDERER_1, area, { .frameno = 3 });
+
+    auto const j = manager.to_json();
+    ASSERT_EQ(j.size(), 1);
+    EXPECT_EQ(j[0]["blur"]["updates"], 1);
+    EXPECT_DOUBLE_EQ(j[0]["blur"]["gpu_time_ms"]["p50"].get<double>(), 1.5);
+}
+
+TEST_F(RenderStatsManagerTest, gpu_memory_of_the_last_frame_and_total_evictions_are_reported)
+{
+    manager.record(&RENDERER_1, area, { .frameno = 1, .gpu_memory_bytes = 4096, .gpu_memory_budget_bytes = 8192, .gpu_memory_evictions = 1 });
+    manager.record(&RENDERER_1, area, { .frameno = 2, .gpu_memory_bytes = 2048, .gpu_memory_budget_bytes = 8192 });
+
+    auto const j = manager.to_json();
+    ASSERT_EQ(j.size(), 1);
+    EXPECT_EQ(j[0]["gpu_memory"]["bytes"], 2048);
+    EXPECT_EQ(j[0]["gpu_memory"]["budget_bytes"], 8192);
+    EXPECT_EQ(j[0]["gpu_memory"]["evictions"], 1);
+}
+
+TEST_F(RenderStatsManagerTest, json_reports_scaled_renderables_of_the_last_frame)
+{
+    manager.record(&RENDERER_1, area, { .frameno = 1, .renderables_drawn = 3, .scaled_renderables_drawn = 1 });
+
+    auto const j = manager.to_json();
+    ASSERT_EQ(j.size(), 1);
+    EXPECT_EQ(j[0]["scaled_renderables_drawn"], 1);
+}
+
+TEST_F(RenderStatsManagerTest, uploaded_bytes_are_totalled_per_renderer)
+{
+    manager.record(&RENDERER_1, area, { .frameno = 1, .uploaded_bytes = 4096 });
+    manager.record(&RENDERER_1, area, { .frameno = 2, .uploaded_bytes = 2048 });
+
+    auto const j = manager.to_json();
+    ASSERT_EQ(j.size(), 1);
+    EXPECT_EQ(j[0]["texture_uploads"]["total_bytes"], 6144);
+    EXPECT_DOUBLE_EQ(j[0]["texture_uploads"]["kb"]["p99"].get<double>(), 4);
+}
+
+TEST_F(RenderStatsManagerTest, skipped_frames_are_counted)
+{
+    manager.record(&RENDERER_1, area, { .frameno = 1 });
+    manager.record(&RENDERER_1, area, { .frameno = 2, .skipped = true });
+    manager.record(&RENDERER_1, area, { .frameno = 3, .skipped = true });
+
+    auto const j = manager.to_json();
+    ASSERT_EQ(j.size(), 1);
+    EXPECT_EQ(j[0]["frames"], 3);
+    EXPECT_EQ(j[0]["skipped_frames"], 2);
+}
+
+TEST_F(RenderStatsManagerTest, software_cursor_frames_are_counted)
+{
+    manager.record(&RENDERER_1, area, { .frameno = 1, .software_cursor = true });
+    manager.record(&RENDERER_1, area, { .frameno = 2 });
+
+    auto const j = manager.to_json();
+    ASSERT_EQ(j.size(), 1);
+    EXPECT_EQ(j[0]["software_cursor_frames"], 1);
+}
+
+TEST_F(RenderStatsManagerTest, capped_frames_are_counted)
+{
+    manager.record(&RENDERER_1, area, { .frameno = 1 });
+    manager.record(&RENDERER_1, area, { .frameno = 2, .capped = true });
+
+    auto const j = manager.to_json();
+    ASSERT_EQ(j.size(), 1);
+    EXPECT_EQ(j[0]["capped_frames"], 1);
+}
+
+TEST_F(RenderStatsManagerTest, mirrored_frames_are_counted)
+{
+    manager.record(&RENDERER_1, area, { .frameno = 1, .mirrored = true });
+    manager.record(&RENDERER_1, area, { .frameno = 2 });
+
+    auto const j = manager.to_json();
+    ASSERT_EQ(j.size(), 1);
+    EXPECT_EQ(j[0]["mirrored_frames"], 1);
+}
@@ -0,0 +1,99 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "restart_backoff.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+using namespace std::chrono_literals;
+
+namespace
+{
+std::string const command = "waybar";
+}
+
+TEST(RestartBackoffTest, has_no_stats_for_unknown_commands)
+{
+    RestartBackoff backoff;
+    EXPECT_FALSE(backoff.stats(command).has_value());
+}
+
+TEST(RestartBackoffTest, restarts_right_away_after_a_long_run)
+{
+    RestartBackoff backoff;
+    auto const start = RestartBackoff::clock::now();
+    backoff.started(command, start);
+    EXPECT_EQ(backoff.exited(command, 0, start + RestartBackoff::stable_runtime), 0ms);
+}
+
+TEST(RestartBackoffTest, doubles_the_delay_with_each_failure_in_a_row)
+{
+    RestartBackoff backoff;
+    auto now = RestartBackoff::clock::now();
+    backoff.started(command, now);
+    EXPECT_EQ(backoff.exited(command, 1, now += 1ms), RestartBackoff::initial_delay);
+    backoff.started(command, now);
+    EXPECT_EQ(backoff.exited(command, 1, now += 1ms), RestartBackoff::initial_delay * 2);
+    backoff.started(command, now);
+    EXPECT_EQ(backoff.exited(command, 1, now += 1ms), RestartBackoff::initial_delay * 4);
+}
+
+TEST(RestartBackoffTest, delay_is_capped)
+{
+    RestartBackoff backoff;
+    auto now = RestartBackoff::clock::now();
+    std::chrono::milliseconds delay;
+    for (int i = 0; i < 100; i++)
+    {
+        backoff.started(command, now);
+        delay = backoff.exited(command, 1, now += 1ms);
+    }
+
+    EXPECT_EQ(delay, RestartBackoff::max_delay);
+}
+
+TEST(RestartBackoffTest, a_long_run_resets_the_delay)
+{
+    RestartBackoff backoff;
+    auto now = RestartBackoff::clock::now();
+    for (int i = 0; i < 3; i++)
+    {
+        backoff.started(command, now);
+        backoff.exited(command, 1, now += 1ms);
+    }
+
+    backoff.started(command, now);
+    EXPECT_EQ(backoff.exited(command, 0, now += RestartBackoff::stable_runtime), 0ms);
+    backoff.started(command, now);
+    EXPECT_EQ(backoff.exited(command, 1, now += 1ms), RestartBackoff::initial_delay);
+}
+
+TEST(RestartBackoffTest, records_stats)
+{
+    RestartBackoff backoff;
+    auto now = RestartBackoff::clock::now();
+    backoff.started(command, now);
+    backoff.exited(command, 11, now += 1ms);
+    backoff.started(command, now);
+    backoff.exited(command, 6, now += 1ms);
+
+    auto const stats = backoff.stats(command);
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_EQ(stats->starts, 2u);
+    EXPECT_EQ(stats->consecutive_failures, 2u);
+    EXPECT_EQ(stats->last_status, 6);
+}
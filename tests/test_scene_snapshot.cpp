@@ -0,0 +1,86 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "scene_snapshot.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace miracle;
+
+namespace
+{
+SceneSnapshot scene_with(uintptr_t id)
+{
+    SceneSnapshot scene;
+    scene.containers.push_back({ .id = id, .type = ContainerType::leaf });
+    return scene;
+}
+}
+
+TEST(ScenePublisherTest, nothing_is_published_at_first)
+{
+    ScenePublisher publisher;
+    ASSERT_EQ(publisher.latest(), nullptr);
+}
+
+TEST(ScenePublisherTest, each_snapshot_is_published_under_a_new_version)
+{
+    ScenePublisher publisher;
+    publisher.publish(scene_with(1));
+    auto const first = publisher.latest();
+    publisher.publish(scene_with(2));
+    auto const second = publisher.latest();
+
+    ASSERT_LT(first->version, second->version);
+    ASSERT_NE(second->find(2), nullptr);
+}
+
+TEST(ScenePublisherTest, readers_keep_their_snapshot_after_a_new_one_is_published)
+{
+    ScenePublisher publisher;
+    publisher.publish(scene_with(1));
+    auto const held = publisher.latest();
+    publisher.publish(scene_with(2));
+
+    ASSERT_NE(held->find(1), nullptr);
+    ASSERT_EQ(held->find(2), nullptr);
+}
+
+TEST(ScenePublisherTest, readers_on_other_threads_see_whole_snapshots)
+{
+    ScenePublisher publisher;
+    publisher.publish(scene_with(0));
+
+    std::thread reader([&]
+    {
+        for (int i = 0; i < 1000; i++)
+        {
+            auto const scene = publisher.latest();
+            ASSERT_EQ(scene->containers.size(), 1u);
+            ASSERT_EQ(scene->find(scene->containers[0].id), &scene->containers[0]);
+        }
+    });
+
+    for (uintptr_t i = 1; i <= 1000; i++)
+        publisher.publish(scene_with(i));
+    reader.join();
+}
+
+TEST(SceneSnapshotTest, finding_a_missing_container_returns_nullptr)
+{
+    ASSERT_EQ(scene_with(1).find(2), nullptr);
+}
@@ -113,4 +113,102 @@ TEST_F(ScratchpadTest, can_show_container)
     EXPECT_CALL(*window_controller, modify(testing::_, testing::_));
     EXPECT_CALL(*window_controller, noclip(testing::_));
     EXPECT_TRUE(scratchpad.toggle_show(container));
-}
\ No newline at end of file
+}
+
+TEST_F(ScratchpadTest, showing_a_container_again_only_raises_it)
+{
+    auto window_controller = std::make_shared<testing::NiceMock<test::MockWindowController>>();
+    auto output_factory = std::make_unique<test::MockOutputFactory>();
+    auto output = new testing::NiceMock<test::MockOutput>();
+    EXPECT_CALL(*output_factory, create(testing::_, testing::_, testing::_))
+        .WillOnce(::testing::Return(std::unique_ptr<OutputInterface>(output)));
+    mir::geometry::Rectangle output_area(
+        mir::geometry::Point(0, 0),
+        mir::geometry::Size(1920, 1280));
+    ON_CALL(*output, get_area())
+        .WillByDefault(::testing::ReturnRef(output_area));
+    std::vector<std::shared_ptr<WorkspaceInterface>> empty_workspaces;
+    ON_CALL(*output, get_workspaces())
+        .WillByDefault(::testing::ReturnRef(empty_workspaces));
+    ON_CALL(*output, id())
+        .WillByDefault(::testing::Return(1));
+    auto output_manager = std::make_shared<OutputManager>(std::move(output_factory));
+    auto workspace_registry = std::make_shared<WorkspaceObserverRegistrar>();
+    auto config = std::make_shared<testing::NiceMock<test::MockConfig>>();
+    auto workspace_manager = std::make_shared<WorkspaceManager>(workspace_registry, config, output_manager);
+    output_manager->create("Test", 1, mir::geometry::Rectangle {}, *workspace_manager);
+    output_manager->focus(1);
+
+    Scratchpad scratchpad(window_controller, output_manager);
+    auto container = std::make_shared<testing::NiceMock<test::MockContainer>>();
+    ON_CALL(*container, get_type())
+        .WillByDefault(::testing::Return(ContainerType::leaf));
+    ON_CALL(*container, window())
+        .WillByDefault(::testing::Return(miral::Window()));
+    ASSERT_TRUE(scratchpad.move_to(container));
+
+    EXPECT_CALL(*window_controller, modify(testing::_, testing::_)).Times(1);
+    EXPECT_CALL(*window_controller, raise(testing::_)).Times(1);
+    EXPECT_TRUE(scratchpad.toggle_show(container));
+    EXPECT_TRUE(scratchpad.toggle_show(container));
+    EXPECT_FALSE(scratchpad.is_showing(container));
+    EXPECT_TRUE(scratchpad.toggle_show(container));
+    EXPECT_TRUE(scratchpad.is_showing(container));
+
+    EXPECT_TRUE(scratchpad.remove(container));
+    EXPECT_FALSE(scratchpad.contains(container));
+}
+
+TEST_F(ScratchpadTest, showing_a_container_on_another_output_places_it_again)
+{
+    auto window_controller = std::make_shared<testing::NiceMock<test::MockWindowController>>();
+    auto output_factory = std::make_unique<test::MockOutputFactory>();
+    auto first = new testing::NiceMock<test::MockOutput>();
+    auto second = new testing::NiceMock<test::MockOutput>();
+    EXPECT_CALL(*output_factory, create(testing::_, testing::_, testing::_))
+        .WillOnce(::testing::Return(std::unique_ptr<OutputInterface>(first)))
+        .WillOnce(::testing::Return(std::unique_ptr<OutputInterface>(second)));
+    mir::geometry::Rectangle first_area(
+        mir::geometry::Point(0, 0),
+        mir::geometry::Size(1920, 1280));
+    mir::geometry::Rectangle second_area(
+        mir::geometry::Point(1920, 0),
+        mir::geometry::Size(1920, 1280));
+    ON_CALL(*first, get_area())
+        .WillByDefault(::testing::ReturnRef(first_area));
+    ON_CALL(*second, get_area())
+        .WillByDefault(::testing::ReturnRef(second_area));
+    std::vector<std::shared_ptr<WorkspaceInterface>> empty_workspaces;
+    ON_CALL(*first, get_workspaces())
+        .WillByDefault(::testing::ReturnRef(empty_workspaces));
+    ON_CALL(*second, get_workspaces())
+        .WillByDefault(::testing::ReturnRef(empty_workspaces));
+    ON_CALL(*first, id())
+        .WillByDefault(::testing::Return(1));
+    ON_CALL(*second, id())
+        .WillByDefault(::testing::Return(2));
+    auto output_manager = std::make_shared<OutputManager>(std::move(output_factory));
+    auto workspace_registry = std::make_shared<WorkspaceObserverRegistrar>();
+    auto config = std::make_shared<testing::NiceMock<test::MockConfig>>();
+    auto workspace_manager = std::make_shared<WorkspaceManager>(workspace_registry, config, output_manager);
+    output_manager->create("First", 1, mir::geometry::Rectangle {}, *workspace_manager);
+    output_manager->create("Second", 2, mir::geometry::Rectangle {}, *workspace_manager);
+    output_manager->focus(1);
+
+    Scratchpad scratchpad(window_controller, output_manager);
+    auto container = std::make_shared<testing::NiceMock<test::MockContainer>>();
+    ON_CALL(*container, get_type())
+        .WillByDefault(::testing::Return(ContainerType::leaf));
+    ON_CALL(*container, window())
+        .WillByDefault(::testing::Return(miral::Window()));
+    ASSERT_TRUE(scratchpad.move_to(container));
+
+    EXPECT_CALL(*window_controller, modify(testing::_, testing::_)).Times(2);
+    EXPECT_CALL(*window_controller, raise(testing::_)).Times(0);
+    EXPECT_TRUE(scratchpad.toggle_show(container));
+    EXPECT_TRUE(scratchpad.toggle_show(container));
+
+    output_manager->focus(2);
+    EXPECT_TRUE(scratchpad.toggle_show(container));
+    EXPECT_TRUE(scratchpad.is_showing(container));
+}
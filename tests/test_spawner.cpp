@@ -0,0 +1,110 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "spawner.h"
+#include <gtest/gtest.h>
+#include <poll.h>
+#include <set>
+#include <sys/wait.h>
+
+using namespace miracle;
+
+namespace
+{
+std::vector<std::string> const environment = { "PATH=/usr/bin:/bin", "MIRACLE_SPAWNER_TEST=expected" };
+
+Spawner::Exit wait_for_exit(Spawner& spawner, pid_t pid)
+{
+    while (true)
+    {
+        pollfd fd { .fd = spawner.exit_fd(), .events = POLLIN, .revents = 0 };
+        if (poll(&fd, 1, 5000) <= 0)
+            return { -1, -1 };
+
+        for (auto const& exit : spawner.read_exits())
+        {
+            if (exit.pid == pid)
+                return exit;
+        }
+    }
+}
+}
+
+class SpawnerTest : public testing::Test
+{
+public:
+    std::unique_ptr<Spawner> spawner = Spawner::start();
+};
+
+TEST_F(SpawnerTest, reports_the_exit_status_of_spawned_programs)
+{
+    ASSERT_NE(spawner, nullptr);
+    auto const pid = spawner->spawn({ "sh", "-c", "exit 3" }, environment);
+    ASSERT_GT(pid, 0);
+
+    auto const exit = wait_for_exit(*spawner, pid);
+    ASSERT_EQ(exit.pid, pid);
+    ASSERT_TRUE(WIFEXITED(exit.status));
+    EXPECT_EQ(WEXITSTATUS(exit.status), 3);
+}
+
+TEST_F(SpawnerTest, programs_are_given_the_requested_environment)
+{
+    ASSERT_NE(spawner, nullptr);
+    auto const pid = spawner->spawn({ "sh", "-c", "test \"$MIRACLE_SPAWNER_TEST\" = expected" }, environment);
+    ASSERT_GT(pid, 0);
+
+    auto const exit = wait_for_exit(*spawner, pid);
+    ASSERT_TRUE(WIFEXITED(exit.status));
+    EXPECT_EQ(WEXITSTATUS(exit.status), 0);
+}
+
+TEST_F(SpawnerTest, programs_that_cannot_be_found_are_not_spawned)
+{
+    ASSERT_NE(spawner, nullptr);
+    EXPECT_EQ(spawner->spawn({ "miracle-spawner-test-does-not-exist" }, environment), -1);
+    EXPECT_EQ(spawner->spawn({}, environment), -1);
+}
+
+TEST_F(SpawnerTest, programs_are_looked_up_in_the_requested_path)
+{
+    ASSERT_NE(spawner, nullptr);
+    EXPECT_EQ(spawner->spawn({ "sh", "-c", "true" }, { "PATH=/nonexistent" }), -1);
+}
+
+TEST_F(SpawnerTest, spawning_carries_on_while_exits_go_unread)
+{
+    ASSERT_NE(spawner, nullptr);
+
+    // Far more exits than the exit socket holds
+    int const count = 1000;
+    std::set<pid_t> pids;
+    for (int i = 0; i < count; i++)
+    {
+        auto const pid = spawner->spawn({ "true" }, environment);
+        ASSERT_GT(pid, 0);
+        pids.insert(pid);
+    }
+
+    while (!pids.empty())
+    {
+        pollfd fd { .fd = spawner->exit_fd(), .events = POLLIN, .revents = 0 };
+        ASSERT_GT(poll(&fd, 1, 5000), 0);
+        for (auto const& exit : spawner->read_exits())
+            pids.erase(exit.pid);
+    }
+}
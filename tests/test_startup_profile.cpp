@@ -0,0 +1,53 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "startup_profile.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+
+TEST(StartupProfileTest, phases_are_recorded_in_the_order_they_are_reached)
+{
+    StartupProfile profile;
+    profile.mark("configuration loaded");
+    profile.mark("first frame");
+
+    auto const phases = profile.phases();
+    ASSERT_EQ(phases.size(), 2);
+    EXPECT_EQ(phases[0].name, "configuration loaded");
+    EXPECT_EQ(phases[1].name, "first frame");
+    EXPECT_LE(phases[0].elapsed, phases[1].elapsed);
+}
+
+TEST(StartupProfileTest, only_the_first_mark_of_a_phase_counts)
+{
+    StartupProfile profile;
+    profile.mark("first frame");
+    auto const first = profile.phases()[0].elapsed;
+    profile.mark("first frame");
+
+    auto const phases = profile.phases();
+    ASSERT_EQ(phases.size(), 1);
+    EXPECT_EQ(phases[0].elapsed, first);
+}
+
+TEST(StartupProfileTest, phases_are_measured_from_the_start)
+{
+    StartupProfile profile(StartupProfile::clock::now() - std::chrono::seconds(1));
+    profile.mark("window manager constructed");
+    EXPECT_GE(profile.phases()[0].elapsed, std::chrono::seconds(1));
+}
@@ -0,0 +1,128 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "startup_scheduler.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+using namespace std::chrono_literals;
+
+namespace
+{
+StartupApp app(std::string const& command, int priority = 0, bool after_previous = false)
+{
+    return { .command = command, .priority = priority, .after_previous = after_previous };
+}
+}
+
+TEST(StartupSchedulerTest, launches_everything_at_once_without_a_limit)
+{
+    StartupScheduler scheduler({ app("a"), app("b"), app("c") }, {});
+    auto const now = StartupScheduler::clock::now();
+    for (pid_t pid = 1; pid <= 3; pid++)
+    {
+        ASSERT_TRUE(scheduler.next(now).has_value());
+        scheduler.launched(pid, now);
+    }
+    EXPECT_TRUE(scheduler.has_launched_all());
+    EXPECT_FALSE(scheduler.next(now).has_value());
+}
+
+TEST(StartupSchedulerTest, launches_higher_priorities_first_and_keeps_the_order_within_a_priority)
+{
+    StartupScheduler scheduler({ app("chat"), app("bar", 10), app("mail"), app("wallpaper", 10) }, {});
+    auto const now = StartupScheduler::clock::now();
+    std::vector<std::string> order;
+    while (auto next = scheduler.next(now))
+    {
+        order.push_back(next->command);
+        scheduler.launched(static_cast<pid_t>(order.size()), now);
+    }
+    EXPECT_EQ(order, (std::vector<std::string> { "bar", "wallpaper", "chat", "mail" }));
+}
+
+TEST(StartupSchedulerTest, waits_for_a_window_once_the_limit_is_reached)
+{
+    StartupScheduler scheduler({ app("a"), app("b"), app("c") }, { .concurrency = 2 });
+    auto const now = StartupScheduler::clock::now();
+    scheduler.next(now);
+    scheduler.launched(1, now);
+    scheduler.next(now);
+    scheduler.launched(2, now);
+    EXPECT_FALSE(scheduler.next(now).has_value());
+
+    scheduler.window_opened(2);
+    auto const next = scheduler.next(now);
+    ASSERT_TRUE(next.has_value());
+    EXPECT_EQ(next->command, "c");
+}
+
+TEST(StartupSchedulerTest, an_exit_frees_a_slot)
+{
+    StartupScheduler scheduler({ app("a"), app("b") }, { .concurrency = 1 });
+    auto const now = StartupScheduler::clock::now();
+    scheduler.next(now);
+    scheduler.launched(1, now);
+    EXPECT_FALSE(scheduler.next(now).has_value());
+
+    scheduler.exited(1);
+    EXPECT_TRUE(scheduler.next(now).has_value());
+}
+
+TEST(StartupSchedulerTest, a_failed_launch_does_not_take_a_slot)
+{
+    StartupScheduler scheduler({ app("a"), app("b") }, { .concurrency = 1 });
+    auto const now = StartupScheduler::clock::now();
+    scheduler.next(now);
+    scheduler.launched(-1, now);
+    EXPECT_TRUE(scheduler.next(now).has_value());
+}
+
+TEST(StartupSchedulerTest, an_app_that_never_opens_a_window_times_out)
+{
+    StartupScheduler scheduler({ app("a"), app("b") }, { .concurrency = 1, .app_timeout = 100ms });
+    auto const now = StartupScheduler::clock::now();
+    scheduler.next(now);
+    scheduler.launched(1, now);
+    EXPECT_EQ(scheduler.next_deadline(), now + 100ms);
+    EXPECT_FALSE(scheduler.next(now + 99ms).has_value());
+    EXPECT_TRUE(scheduler.next(now + 100ms).has_value());
+}
+
+TEST(StartupSchedulerTest, waits_for_the_previous_app_when_asked_to)
+{
+    StartupScheduler scheduler({ app("bar", 1), app("a"), app("b", 0, true) }, {});
+    auto const now = StartupScheduler::clock::now();
+    scheduler.next(now);
+    scheduler.launched(1, now);
+    scheduler.next(now);
+    scheduler.launched(2, now);
+    EXPECT_FALSE(scheduler.next(now).has_value());
+
+    // Only the app right before it is waited for
+    scheduler.window_opened(2);
+    EXPECT_TRUE(scheduler.next(now).has_value());
+}
+
+TEST(StartupSchedulerTest, has_no_deadline_once_everything_is_launched)
+{
+    StartupScheduler scheduler({ app("a") }, { .concurrency = 1 });
+    auto const now = StartupScheduler::clock::now();
+    scheduler.next(now);
+    scheduler.launched(1, now);
+    EXPECT_FALSE(scheduler.next_deadline().has_value());
+}
@@ -0,0 +1,102 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "texture_cache.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+
+namespace
+{
+struct FakeTexture
+{
+    int id;
+};
+}
+
+class TextureCacheTest : public testing::Test
+{
+public:
+    TextureCache<FakeTexture> cache;
+    int created = 0;
+
+    std::shared_ptr<FakeTexture> const& get(std::uint64_t id, size_t bytes = 0)
+    {
+        return cache.get(id, bytes, [&] { return std::make_shared<FakeTexture>(FakeTexture { ++created }); });
+    }
+};
+
+TEST_F(TextureCacheTest, buffers_are_only_made_into_textures_once)
+{
+    cache.begin_frame();
+    auto const first = get(1);
+    cache.end_frame();
+
+    cache.begin_frame();
+    EXPECT_EQ(get(1), first);
+    cache.end_frame();
+    EXPECT_EQ(created, 1);
+}
+
+TEST_F(TextureCacheTest, textures_are_dropped_once_a_frame_does_not_draw_them)
+{
+    cache.begin_frame();
+    get(1);
+    get(2);
+    cache.end_frame();
+
+    cache.begin_frame();
+    get(2);
+    cache.end_frame();
+    EXPECT_EQ(cache.size(), 1);
+
+    cache.begin_frame();
+    get(1);
+    cache.end_frame();
+    EXPECT_EQ(created, 3);
+}
+
+TEST_F(TextureCacheTest, only_new_textures_count_as_uploads)
+{
+    cache.begin_frame();
+    get(1, 100);
+    get(2, 50);
+    EXPECT_EQ(cache.uploaded_bytes(), 150);
+    cache.end_frame();
+
+    cache.begin_frame();
+    get(1, 100);
+    get(3, 10);
+    EXPECT_EQ(cache.uploaded_bytes(), 10);
+    cache.end_frame();
+}
+
+TEST_F(TextureCacheTest, kept_textures_survive_frames_that_do_not_draw_them)
+{
+    cache.begin_frame();
+    get(1);
+    cache.end_frame();
+
+    cache.begin_frame();
+    cache.keep(1);
+    cache.end_frame();
+
+    cache.begin_frame();
+    get(1);
+    cache.end_frame();
+    EXPECT_EQ(created, 1);
+}
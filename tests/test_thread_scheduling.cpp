@@ -0,0 +1,68 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "thread_scheduling.h"
+#include <gtest/gtest.h>
+#include <sched.h>
+#include <thread>
+
+using namespace miracle;
+
+TEST(ThreadSchedulingTest, empty_configuration_leaves_the_thread_as_it_was)
+{
+    std::thread([]
+    {
+        auto const before = current_thread_scheduling();
+        auto const after = apply_thread_scheduling("test", {});
+        EXPECT_EQ(after.policy, before.policy);
+        EXPECT_EQ(after.nice, before.nice);
+        EXPECT_EQ(after.cpus, before.cpus);
+        EXPECT_FALSE(after.via_rtkit);
+    }).join();
+}
+
+TEST(ThreadSchedulingTest, thread_can_be_pinned_to_a_cpu_that_it_may_run_on)
+{
+    std::thread([]
+    {
+        auto const allowed = current_thread_scheduling().cpus;
+        ASSERT_FALSE(allowed.empty());
+
+        ThreadSchedulingConfiguration config;
+        config.cpus = { allowed.back() };
+        auto const result = apply_thread_scheduling("test", config);
+        EXPECT_EQ(result.cpus, std::vector<int> { allowed.back() });
+    }).join();
+}
+
+TEST(ThreadSchedulingTest, nice_value_can_always_be_raised)
+{
+    std::thread([]
+    {
+        auto const nice = current_thread_scheduling().nice + 1;
+        ThreadSchedulingConfiguration config;
+        config.nice = nice;
+        auto const result = apply_thread_scheduling("test", config);
+        EXPECT_EQ(result.nice, nice);
+    }).join();
+}
+
+TEST(ThreadSchedulingTest, description_lists_policy_nice_and_cpus)
+{
+    ThreadScheduling const scheduling { .policy = SCHED_RR, .priority = 10, .nice = -5, .cpus = { 2, 3 }, .via_rtkit = true };
+    EXPECT_EQ(to_string(scheduling), "SCHED_RR priority 10, nice -5, cpus 2,3 (via rtkit)");
+}
@@ -0,0 +1,131 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "tracing.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace miracle;
+
+namespace
+{
+Tracer::clock::time_point at_us(int64_t us)
+{
+    return Tracer::clock::now() + std::chrono::microseconds(us);
+}
+}
+
+TEST(TracingTest, spans_are_only_recorded_while_recording)
+{
+    auto& tracer = Tracer::instance();
+    {
+        MIRACLE_TRACE_SCOPE("before");
+    }
+
+    tracer.start();
+    {
+        MIRACLE_TRACE_SCOPE("outer");
+        MIRACLE_TRACE_SCOPE("inner");
+    }
+    tracer.stop();
+    {
+        MIRACLE_TRACE_SCOPE("after");
+    }
+
+    auto const spans = tracer.spans();
+    ASSERT_EQ(spans.size(), 2);
+    EXPECT_STREQ(spans[0].name, "inner");
+    EXPECT_STREQ(spans[1].name, "outer");
+    EXPECT_LE(spans[1].start_ns, spans[0].start_ns);
+    EXPECT_GE(spans[1].duration_ns, spans[0].duration_ns);
+}
+
+TEST(TracingTest, starting_again_leaves_out_the_previous_recording)
+{
+    Tracer tracer;
+    tracer.start();
+    tracer.record("first", at_us(0), at_us(1));
+    tracer.start();
+    tracer.record("second", at_us(10), at_us(11));
+
+    auto const spans = tracer.spans();
+    ASSERT_EQ(spans.size(), 1);
+    EXPECT_STREQ(spans[0].name, "second");
+}
+
+TEST(TracingTest, each_thread_records_to_its_own_ring)
+{
+    Tracer tracer;
+    tracer.start();
+    tracer.record("main", at_us(0), at_us(1));
+    std::thread([&]
+    { tracer.record("worker", at_us(0), at_us(1)); })
+        .join();
+
+    auto const spans = tracer.spans();
+    ASSERT_EQ(spans.size(), 2);
+    EXPECT_NE(spans[0].thread, spans[1].thread);
+}
+
+TEST(TracingTest, ring_keeps_the_latest_spans_when_full)
+{
+    TraceSpanRing ring(1);
+    for (size_t i = 0; i < TraceSpanRing::capacity + 10; i++)
+        ring.push("span", static_cast<int64_t>(i), 1);
+
+    std::vector<TraceSpan> spans;
+    ring.read(spans);
+    ASSERT_EQ(spans.size(), TraceSpanRing::capacity);
+    EXPECT_EQ(spans.front().start_ns, 10);
+    EXPECT_EQ(spans.back().start_ns, static_cast<int64_t>(TraceSpanRing::capacity + 9));
+}
+
+TEST(TracingTest, ring_can_be_read_while_it_is_written)
+{
+    auto ring = std::make_unique<TraceSpanRing>(1);
+    std::atomic<bool> done = false;
+    std::thread writer([&]
+    {
+        for (int64_t i = 0; i < 200'000; i++)
+            ring->push("span", i, i * 2);
+        done = true;
+    });
+
+    while (!done)
+    {
+        std::vector<TraceSpan> spans;
+        ring->read(spans);
+        for (auto const& span : spans)
+            ASSERT_EQ(span.duration_ns, span.start_ns * 2);
+    }
+    writer.join();
+}
+
+TEST(TracingTest, chrome_trace_contains_complete_events)
+{
+    Tracer tracer;
+    tracer.start();
+    auto const start = at_us(5);
+    tracer.record("IpcCommandExecutor::process", start, start + std::chrono::microseconds(3));
+
+    auto const json = tracer.to_chrome_trace();
+    auto const& events = json["traceEvents"];
+    ASSERT_EQ(events.size(), 1);
+    EXPECT_EQ(events[0]["name"], "IpcCommandExecutor::process");
+    EXPECT_EQ(events[0]["ph"], "X");
+    EXPECT_DOUBLE_EQ(events[0]["dur"].get<double>(), 3.0);
+}
@@ -0,0 +1,42 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "stub_surface.h"
+#include "window_helpers.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+
+TEST(WindowHelpersTest, window_created_while_locked_is_hidden)
+{
+    test::StubSurface surface;
+    EXPECT_TRUE(window_helpers::is_hidden(surface, true, false));
+    EXPECT_FALSE(window_helpers::is_hidden(surface, false, false));
+}
+
+TEST(WindowHelpersTest, lock_surface_is_not_hidden_while_locked)
+{
+    test::StubSurface surface;
+    surface.set_visible_on_lock_screen(true);
+    EXPECT_FALSE(window_helpers::is_hidden(surface, true, false));
+}
+
+TEST(WindowHelpersTest, occluded_window_stays_hidden_once_unlocked)
+{
+    test::StubSurface surface;
+    EXPECT_TRUE(window_helpers::is_hidden(surface, false, true));
+}
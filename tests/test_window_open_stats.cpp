@@ -0,0 +1,105 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "window_open_stats.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+using namespace std::chrono_literals;
+
+namespace
+{
+int const SURFACE_1 = 1;
+int const SURFACE_2 = 2;
+}
+
+class WindowOpenStatsTest : public testing::Test
+{
+public:
+    WindowOpenStats stats;
+    WindowOpenStats::Clock::time_point const requested = WindowOpenStats::Clock::now();
+};
+
+TEST_F(WindowOpenStatsTest, window_is_pending_until_its_first_frame)
+{
+    stats.begin(&SURFACE_1, requested);
+    stats.mark(&SURFACE_1, WindowOpenStage::ready, requested + 5ms);
+    EXPECT_TRUE(stats.has_pending());
+
+    stats.mark(&SURFACE_1, WindowOpenStage::first_frame, requested + 10ms);
+    EXPECT_FALSE(stats.has_pending());
+
+    auto const json = stats.to_json();
+    EXPECT_EQ(json["opened"], 1);
+    EXPECT_EQ(json["pending"], 0);
+}
+
+TEST_F(WindowOpenStatsTest, stages_are_timed_from_the_request)
+{
+    stats.begin(&SURFACE_1, requested);
+    stats.mark(&SURFACE_1, WindowOpenStage::placed, requested + 1ms);
+    stats.mark(&SURFACE_1, WindowOpenStage::created, requested + 2ms);
+    stats.mark(&SURFACE_1, WindowOpenStage::first_frame, requested + 20ms);
+
+    auto const stages = stats.to_json()["stages_ms"];
+    EXPECT_DOUBLE_EQ(stages["placed"]["p50"].get<double>(), 1);
+    EXPECT_DOUBLE_EQ(stages["created"]["p95"].get<double>(), 2);
+    EXPECT_DOUBLE_EQ(stages["first_frame"]["p50"].get<double>(), 20);
+}
+
+TEST_F(WindowOpenStatsTest, only_the_first_time_that_a_stage_is_reached_counts)
+{
+    stats.begin(&SURFACE_1, requested);
+    stats.mark(&SURFACE_1, WindowOpenStage::animated, requested + 3ms);
+    stats.mark(&SURFACE_1, WindowOpenStage::animated, requested + 8ms);
+    stats.mark(&SURFACE_1, WindowOpenStage::first_frame, requested + 10ms);
+
+    EXPECT_DOUBLE_EQ(stats.to_json()["stages_ms"]["animated"]["p50"].get<double>(), 3);
+}
+
+TEST_F(WindowOpenStatsTest, skipped_stages_are_left_out)
+{
+    stats.begin(&SURFACE_1, requested);
+    stats.mark(&SURFACE_1, WindowOpenStage::animated, requested + 4ms);
+    stats.mark(&SURFACE_1, WindowOpenStage::first_frame, requested + 10ms);
+    stats.begin(&SURFACE_2, requested);
+    stats.mark(&SURFACE_2, WindowOpenStage::first_frame, requested + 10ms);
+
+    EXPECT_DOUBLE_EQ(stats.to_json()["stages_ms"]["animated"]["p95"].get<double>(), 4);
+}
+
+TEST_F(WindowOpenStatsTest, windows_that_close_before_they_are_drawn_are_abandoned)
+{
+    stats.begin(&SURFACE_1, requested);
+    stats.remove(&SURFACE_1);
+    stats.mark(&SURFACE_1, WindowOpenStage::first_frame, requested + 10ms);
+
+    auto const json = stats.to_json();
+    EXPECT_FALSE(stats.has_pending());
+    EXPECT_EQ(json["abandoned"], 1);
+    EXPECT_EQ(json["opened"], 0);
+}
+
+TEST_F(WindowOpenStatsTest, surfaces_that_were_never_begun_are_ignored)
+{
+    stats.mark(&SURFACE_2, WindowOpenStage::first_frame, requested);
+    stats.remove(&SURFACE_2);
+
+    auto const json = stats.to_json();
+    EXPECT_EQ(json["opened"], 0);
+    EXPECT_EQ(json["abandoned"], 0);
+}
@@ -0,0 +1,80 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "worker_pool.h"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace miracle;
+
+TEST(WorkerPoolTest, every_index_is_run_exactly_once)
+{
+    WorkerPool pool(3);
+    std::vector<std::atomic<int>> runs(1000);
+    pool.for_each(runs.size(), [&](size_t i) { runs[i]++; });
+
+    for (auto const& count : runs)
+        EXPECT_EQ(count, 1);
+}
+
+TEST(WorkerPoolTest, iterations_are_shared_with_the_workers)
+{
+    WorkerPool pool(2);
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    std::atomic<int> started = 0;
+    pool.for_each(3, [&](size_t)
+    {
+        // Each iteration waits for the others, so no thread can run two of them
+        started++;
+        while (started < 3)
+            std::this_thread::yield();
+
+        std::lock_guard lock(mutex);
+        threads.insert(std::this_thread::get_id());
+    });
+
+    EXPECT_EQ(threads.size(), 3);
+}
+
+TEST(WorkerPoolTest, loops_can_be_run_one_after_another)
+{
+    WorkerPool pool(3);
+    for (int loop = 0; loop < 200; loop++)
+    {
+        std::atomic<size_t> sum = 0;
+        pool.for_each(10, [&](size_t i) { sum += i; });
+        ASSERT_EQ(sum, 45);
+    }
+}
+
+TEST(WorkerPoolTest, a_pool_without_workers_runs_the_loop_on_the_calling_thread)
+{
+    WorkerPool pool(0);
+    auto const caller = std::this_thread::get_id();
+    size_t runs = 0;
+    pool.for_each(5, [&](size_t)
+    {
+        EXPECT_EQ(std::this_thread::get_id(), caller);
+        runs++;
+    });
+
+    EXPECT_EQ(runs, 5);
+}
@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "stub_window_controller.h"
 #include "window_controller.h"
 #include "workspace.h"
+#include <chrono>
 #include <gtest/gtest.h>
 
 using namespace miracle;
@@ -48,6 +49,7 @@ const geom::Rectangle OTHER_OUTPUT_SIZE {
 
 std::vector<std::shared_ptr<WorkspaceInterface>> empty_workspaces;
 std::vector<miral::Zone> empty_app_zones;
+std::string const output_name = "output";
 
 std::unique_ptr<test::MockOutput> create_output(geom::Rectangle const& bounds)
 {
@@ -58,6 +60,8 @@ std::unique_ptr<test::MockOutput> create_output(geom::Rectangle const& bounds)
         .WillByDefault(testing::ReturnRef(empty_workspaces));
     ON_CALL(*output, get_app_zones())
         .WillByDefault(testing::ReturnRef(empty_app_zones));
+    ON_CALL(*output, name())
+        .WillByDefault(testing::ReturnRef(output_name));
     return output;
 }
 }
@@ -147,6 +151,23 @@ TEST_F(WorkspaceTest, can_add_two_windows_vertically_without_border_and_gaps)
     ASSERT_EQ(leaf2->get_logical_area().top_left, geom::Point(0, OUTPUT_HEIGHT / 2.f));
 }
 
+TEST_F(WorkspaceTest, layout_within_a_batch_happens_once_the_batch_is_closed)
+{
+    auto leaf1 = create_leaf();
+    std::shared_ptr<LeafContainer> leaf2;
+    {
+        CommitBatch batch(*state);
+        leaf1->request_vertical_layout();
+        leaf2 = create_leaf();
+    }
+
+    ASSERT_EQ(leaf1->get_logical_area().size, geom::Size(OUTPUT_WIDTH, OUTPUT_HEIGHT / 2.f));
+    ASSERT_EQ(leaf1->get_logical_area().top_left, geom::Point(0, 0));
+
+    ASSERT_EQ(leaf2->get_logical_area().size, geom::Size(OUTPUT_WIDTH, OUTPUT_HEIGHT / 2.f));
+    ASSERT_EQ(leaf2->get_logical_area().top_left, geom::Point(0, OUTPUT_HEIGHT / 2.f));
+}
+
 TEST_F(WorkspaceTest, can_add_three_windows_horizontally_without_border_and_gaps)
 {
     auto leaf1 = create_leaf();
@@ -160,7 +181,7 @@ TEST_F(WorkspaceTest, can_add_three_windows_horizontally_without_border_and_gaps
     ASSERT_EQ(leaf2->get_logical_area().top_left, geom::Point(ceilf(OUTPUT_WIDTH / 3.f), 0));
 
     ASSERT_EQ(leaf3->get_logical_area().size, geom::Size(floorf(OUTPUT_WIDTH / 3.f), OUTPUT_HEIGHT));
-    ASSERT_EQ(leaf3->get_logical_area().top_left, geom::Point(floorf(OUTPUT_WIDTH * (2.f / 3.f)) - 1, 0));
+    ASSERT_EQ(leaf3->get_logical_area().top_left, geom::Point(2 * ceilf(OUTPUT_WIDTH / 3.f), 0));
 }
 
 TEST_F(WorkspaceTest, can_start_dragging_a_leaf)
@@ -202,6 +223,22 @@ TEST_F(WorkspaceTest, can_move_container_to_sibling)
     ASSERT_EQ(leaf1->get_logical_area().top_left, geom::Point(OUTPUT_WIDTH / 2.f, 0));
 }
 
+TEST_F(WorkspaceTest, swapping_containers_leaves_the_ones_between_them_in_place)
+{
+    auto leaf1 = create_leaf();
+    auto leaf2 = create_leaf();
+    auto leaf3 = create_leaf();
+    auto const first_area = leaf1->get_logical_area();
+    auto const middle_area = leaf2->get_logical_area();
+    auto const last_area = leaf3->get_logical_area();
+
+    ASSERT_TRUE(leaf1->move_to(*leaf3));
+
+    ASSERT_EQ(leaf3->get_logical_area(), first_area);
+    ASSERT_EQ(leaf2->get_logical_area(), middle_area);
+    ASSERT_EQ(leaf1->get_logical_area(), last_area);
+}
+
 TEST_F(WorkspaceTest, can_move_container_to_different_parent)
 {
     auto leaf1 = create_leaf();
@@ -310,4 +347,164 @@ TEST_F(WorkspaceTest, workspace_bounds_are_initialized_to_first_zone_size_when_a
 
     // Assert that the first tree (w/o app zones) is equal to the output size.
     ASSERT_EQ(other.get_root()->get_logical_area(), zone_bounds);
-}
\ No newline at end of file
+}
+
+TEST_F(WorkspaceTest, json_holds_the_tree_of_the_workspace)
+{
+    ON_CALL(*output, active()).WillByDefault(testing::Return(&workspace));
+    create_leaf();
+    auto leaf2 = create_leaf();
+    leaf2->request_vertical_layout();
+    create_leaf(leaf2->get_parent().lock());
+
+    std::string serialized;
+    JsonWriter writer(serialized);
+    workspace.write_json(writer, true);
+
+    auto const json = nlohmann::json::parse(serialized);
+    EXPECT_EQ(json["type"], "workspace");
+    EXPECT_EQ(json["floating_nodes"].size(), 0);
+    ASSERT_EQ(json["nodes"].size(), 2);
+    EXPECT_EQ(json["nodes"][0]["nodes"].size(), 0);
+    EXPECT_EQ(json["nodes"][1]["layout"], "splitv");
+    EXPECT_EQ(json["nodes"][1]["nodes"].size(), 2);
+    EXPECT_EQ(json, workspace.to_json(true));
+}
+
+TEST_F(WorkspaceTest, json_string_is_updated_for_containers_that_change)
+{
+    create_leaf();
+    std::string before;
+    JsonWriter before_writer(before);
+    workspace.write_json(before_writer, true);
+
+    create_leaf();
+    std::string after;
+    JsonWriter after_writer(after);
+    workspace.write_json(after_writer, true);
+
+    EXPECT_NE(before, after);
+    EXPECT_EQ(nlohmann::json::parse(after)["nodes"].size(), 2);
+}
+
+TEST_F(WorkspaceTest, windows_are_placed_into_the_slots_of_an_appended_layout)
+{
+    auto const layout = parse_layout_template(nlohmann::json::parse(R"({"layout": "splith", "nodes": [
+        {"percent": 0.25},
+        {"layout": "splitv", "nodes": [{}, {}]}
+    ]})"));
+    ASSERT_TRUE(workspace.append_layout(std::get<LayoutTemplateNode>(layout)));
+
+    // The first window keeps the area of its slot while the rest of the layout is empty
+    auto leaf1 = create_leaf();
+    ASSERT_EQ(leaf1->get_logical_area(), geom::Rectangle(geom::Point(0, 0), geom::Size(OUTPUT_WIDTH / 4, OUTPUT_HEIGHT)));
+
+    auto leaf2 = create_leaf();
+    auto leaf3 = create_leaf();
+    ASSERT_EQ(leaf1->get_logical_area(), geom::Rectangle(geom::Point(0, 0), geom::Size(OUTPUT_WIDTH / 4, OUTPUT_HEIGHT)));
+    ASSERT_EQ(leaf2->get_logical_area(), geom::Rectangle(geom::Point(OUTPUT_WIDTH / 4, 0), geom::Size(OUTPUT_WIDTH * 3 / 4, OUTPUT_HEIGHT / 2)));
+    ASSERT_EQ(leaf3->get_logical_area(), geom::Rectangle(geom::Point(OUTPUT_WIDTH / 4, OUTPUT_HEIGHT / 2), geom::Size(OUTPUT_WIDTH * 3 / 4, OUTPUT_HEIGHT / 2)));
+    ASSERT_EQ(leaf2->get_parent().lock(), leaf3->get_parent().lock());
+    ASSERT_EQ(leaf2->get_parent().lock()->get_layout(), LayoutScheme::vertical);
+}
+
+TEST_F(WorkspaceTest, a_layout_only_has_slots_for_the_windows_that_it_swallows)
+{
+    auto const layout = parse_layout_template(nlohmann::json::parse(R"([
+        {"swallows": [{"app_id": "^firefox$"}]}
+    ])"));
+    ASSERT_FALSE(workspace.has_layout_slot_for("firefox", ""));
+    ASSERT_TRUE(workspace.append_layout(std::get<LayoutTemplateNode>(layout)));
+
+    EXPECT_TRUE(workspace.has_layout_slot_for("firefox", ""));
+    EXPECT_FALSE(workspace.has_layout_slot_for("foot", ""));
+}
+
+TEST_F(WorkspaceTest, a_layout_cannot_be_appended_to_a_workspace_with_tiled_windows)
+{
+    create_leaf();
+    auto const layout = parse_layout_template(nlohmann::json::parse(R"([{}, {}])"));
+    ASSERT_FALSE(workspace.append_layout(std::get<LayoutTemplateNode>(layout)));
+}
+
+TEST_F(WorkspaceTest, hidden_workspaces_are_laid_out_once_they_are_shown)
+{
+    auto leaf = create_leaf();
+    workspace.hide();
+
+    geom::Rectangle const area { geom::Point(0, 0), geom::Size(OUTPUT_WIDTH / 2, OUTPUT_HEIGHT) };
+    workspace.set_area(area);
+    ASSERT_EQ(leaf->get_logical_area().size, geom::Size(OUTPUT_WIDTH, OUTPUT_HEIGHT));
+
+    workspace.show();
+    ASSERT_EQ(leaf->get_logical_area(), area);
+}
+
+TEST_F(WorkspaceTest, tabs_are_only_resized_once_they_are_selected)
+{
+    auto leaf1 = create_leaf();
+    auto leaf2 = create_leaf();
+    leaf2->get_parent().lock()->set_layout(LayoutScheme::tabbing);
+
+    geom::Rectangle const area { geom::Point(0, 0), geom::Size(OUTPUT_WIDTH, OUTPUT_HEIGHT) };
+    ASSERT_EQ(leaf2->get_logical_area(), area);
+    ASSERT_EQ(leaf1->get_logical_area().size, geom::Size(OUTPUT_WIDTH / 2, OUTPUT_HEIGHT));
+
+    state->focus_container(leaf1);
+    leaf1->on_focus_gained();
+    ASSERT_EQ(leaf1->get_logical_area(), area);
+}
+
+TEST_F(WorkspaceTest, only_the_selected_tab_is_left_unoccluded)
+{
+    auto leaf1 = create_leaf();
+    auto leaf2 = create_leaf();
+    leaf2->get_parent().lock()->set_layout(LayoutScheme::tabbing);
+    ASSERT_TRUE(pairs[0].occluded);
+    ASSERT_FALSE(pairs[1].occluded);
+
+    state->focus_container(leaf1);
+    leaf1->on_focus_gained();
+    ASSERT_FALSE(pairs[0].occluded);
+    ASSERT_TRUE(pairs[1].occluded);
+
+    leaf1->get_parent().lock()->set_layout(LayoutScheme::horizontal);
+    ASSERT_FALSE(pairs[0].occluded);
+    ASSERT_FALSE(pairs[1].occluded);
+}
+
+TEST_F(WorkspaceTest, neighbours_follow_changes_to_the_layout)
+{
+    auto leaf1 = create_leaf();
+    auto leaf2 = create_leaf();
+    ASSERT_EQ(workspace.neighbour(*leaf1, Direction::right), leaf2);
+    ASSERT_EQ(workspace.neighbour(*leaf1, Direction::down), nullptr);
+
+    leaf1->get_parent().lock()->set_layout(LayoutScheme::vertical);
+    ASSERT_EQ(workspace.neighbour(*leaf1, Direction::right), nullptr);
+    ASSERT_EQ(workspace.neighbour(*leaf1, Direction::down), leaf2);
+}
+
+TEST_F(WorkspaceTest, only_pinned_windows_are_transferred_to_the_next_workspace)
+{
+    auto other = std::make_shared<Workspace>(
+        output.get(),
+        1,
+        1,
+        "1",
+        std::make_shared<test::StubConfiguration>(),
+        window_controller,
+        state);
+    create_leaf();
+    auto floating = workspace.create_floating_tree(geom::Rectangle { geom::Point(0, 0), geom::Size(100, 100) });
+
+    auto const generation = state->layout_generation();
+    workspace.transfer_pinned_windows_to(other);
+    ASSERT_EQ(state->layout_generation(), generation);
+    ASSERT_EQ(floating->get_workspace(), &workspace);
+
+    floating->pinned(true);
+    workspace.transfer_pinned_windows_to(other);
+    ASSERT_EQ(floating->get_workspace(), other.get());
+    ASSERT_FALSE(workspace.is_empty());
+}
@@ -0,0 +1,141 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "animator.h"
+#include "compositor_state.h"
+#include "mock_output_factory.h"
+#include "output.h"
+#include "output_manager.h"
+#include "stub_configuration.h"
+#include "stub_session.h"
+#include "stub_surface.h"
+#include "stub_window_controller.h"
+#include "workspace_manager.h"
+#include "workspace_observer.h"
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace miracle;
+
+namespace
+{
+geom::Rectangle const OUTPUT_AREA { geom::Point(0, 0), geom::Size(1280, 720) };
+}
+
+class WorkspaceManagerTest : public testing::Test
+{
+public:
+    WorkspaceManagerTest()
+    {
+        ON_CALL(*output_factory, create)
+            .WillByDefault([this](std::string name, int id, geom::Rectangle area) -> std::unique_ptr<OutputInterface>
+        {
+            return std::make_unique<Output>(name, id, area, state, config, window_controller, animator);
+        });
+        output = output_manager->create("output", 0, OUTPUT_AREA, *workspace_manager);
+    }
+
+    /// Opens a window on [workspace], so that it is not deleted once it is left.
+    void add_window(WorkspaceInterface* workspace)
+    {
+        miral::WindowSpecification spec;
+        miral::ApplicationInfo app_info;
+        auto hint = workspace->allocate_position(app_info, spec, { ContainerType::leaf });
+
+        auto session = std::make_shared<test::StubSession>();
+        sessions.push_back(session);
+        auto surface = std::make_shared<test::StubSurface>();
+        surfaces.push_back(surface);
+
+        miral::Window window(session, surface);
+        miral::WindowInfo info(window, spec);
+        auto leaf = workspace->create_container(info, hint);
+        pairs.push_back({ window, leaf });
+        state->add(leaf);
+    }
+
+    std::vector<int> numbers() const
+    {
+        std::vector<int> result;
+        for (auto const* workspace : workspace_manager->workspaces())
+            result.push_back(workspace->num().value_or(-1));
+        return result;
+    }
+
+    std::shared_ptr<CompositorState> state = std::make_shared<CompositorState>();
+    std::shared_ptr<test::StubConfiguration> config = std::make_shared<test::StubConfiguration>();
+    std::vector<std::shared_ptr<test::StubSession>> sessions;
+    std::vector<std::shared_ptr<test::StubSurface>> surfaces;
+    std::vector<StubWindowData> pairs;
+    std::shared_ptr<StubWindowController> window_controller = std::make_shared<StubWindowController>(pairs);
+    std::shared_ptr<Animator> animator = std::make_shared<Animator>();
+    testing::NiceMock<test::MockOutputFactory>* output_factory = new testing::NiceMock<test::MockOutputFactory>();
+    std::shared_ptr<OutputManager> output_manager = std::make_shared<OutputManager>(
+        std::unique_ptr<test::MockOutputFactory>(output_factory));
+    std::shared_ptr<WorkspaceManager> workspace_manager = std::make_shared<WorkspaceManager>(
+        std::make_shared<WorkspaceObserverRegistrar>(), config, output_manager);
+    OutputInterface* output;
+};
+
+TEST_F(WorkspaceManagerTest, workspaces_are_sorted_by_number)
+{
+    add_window(output->active());
+    workspace_manager->request_workspace(output, 3);
+    add_window(output->active());
+    workspace_manager->request_workspace(output, 2);
+    add_window(output->active());
+    workspace_manager->request_workspace(output, "named");
+
+    EXPECT_EQ(numbers(), (std::vector<int> { 1, 2, 3, -1 }));
+}
+
+TEST_F(WorkspaceManagerTest, next_and_prev_wrap_around)
+{
+    add_window(output->active());
+    workspace_manager->request_workspace(output, 3);
+    add_window(output->active());
+    workspace_manager->request_workspace(output, 2);
+    add_window(output->active());
+
+    ASSERT_TRUE(workspace_manager->request_next(output));
+    EXPECT_EQ(output->active()->num(), 3);
+    ASSERT_TRUE(workspace_manager->request_next(output));
+    EXPECT_EQ(output->active()->num(), 1);
+    ASSERT_TRUE(workspace_manager->request_prev(output));
+    EXPECT_EQ(output->active()->num(), 3);
+}
+
+TEST_F(WorkspaceManagerTest, empty_workspaces_are_unregistered_once_they_are_left)
+{
+    auto const first_id = output->active()->id();
+    workspace_manager->request_workspace(output, 3);
+
+    EXPECT_EQ(workspace_manager->workspace(first_id), nullptr);
+    EXPECT_EQ(numbers(), std::vector<int> { 3 });
+    ASSERT_FALSE(workspace_manager->request_workspace(output, 3, false));
+}
+
+TEST_F(WorkspaceManagerTest, emptied_workspaces_are_recycled_as_new_ones)
+{
+    auto const* first = output->active();
+    workspace_manager->request_workspace(output, 3);
+    workspace_manager->request_workspace(output, 5);
+
+    ASSERT_EQ(output->active(), first);
+    EXPECT_EQ(first->num(), 5);
+    EXPECT_EQ(numbers(), std::vector<int> { 5 });
+}
@@ -0,0 +1,100 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "workspace_swipe.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+using namespace std::chrono_literals;
+
+namespace
+{
+float const WIDTH = 1000.f;
+WorkspaceSwipe::clock::time_point const START {};
+}
+
+TEST(WorkspaceSwipeTest, offset_follows_the_fingers)
+{
+    WorkspaceSwipe swipe(WIDTH, true, true);
+    swipe.update(100.f, START);
+    ASSERT_FLOAT_EQ(swipe.update(-30.f, START + 10ms), 70.f);
+}
+
+TEST(WorkspaceSwipeTest, offset_goes_no_further_than_one_workspace)
+{
+    WorkspaceSwipe swipe(WIDTH, true, true);
+    ASSERT_FLOAT_EQ(swipe.update(5000.f, START), WIDTH);
+}
+
+TEST(WorkspaceSwipeTest, sides_without_a_workspace_only_give_a_little)
+{
+    WorkspaceSwipe swipe(WIDTH, false, true);
+    auto const offset = swipe.update(-100.f, START);
+    ASSERT_LT(offset, 0.f);
+    ASSERT_GT(offset, -100.f);
+    ASSERT_GT(swipe.update(-5000.f, START + 10ms), -WIDTH / 2);
+}
+
+TEST(WorkspaceSwipeTest, slow_swipes_land_on_the_nearest_workspace)
+{
+    WorkspaceSwipe swipe(WIDTH, true, true);
+    for (int i = 1; i <= 80; i++)
+        swipe.update(5.f, START + i * 10ms);
+    ASSERT_EQ(swipe.landing(START + 800ms), 0);
+
+    for (int i = 81; i <= 110; i++)
+        swipe.update(5.f, START + i * 10ms);
+    ASSERT_EQ(swipe.landing(START + 1100ms), 1);
+}
+
+TEST(WorkspaceSwipeTest, quick_flicks_carry_over_to_the_neighbour)
+{
+    WorkspaceSwipe swipe(WIDTH, true, true);
+    for (int i = 1; i <= 5; i++)
+        swipe.update(-60.f, START + i * 10ms);
+
+    ASSERT_GT(swipe.offset(), -WIDTH / 2);
+    ASSERT_LT(swipe.velocity(START + 50ms), 0.f);
+    ASSERT_EQ(swipe.landing(START + 50ms), -1);
+}
+
+TEST(WorkspaceSwipeTest, fingers_that_rest_have_no_velocity)
+{
+    WorkspaceSwipe swipe(WIDTH, true, true);
+    for (int i = 1; i <= 5; i++)
+        swipe.update(60.f, START + i * 10ms);
+
+    ASSERT_FLOAT_EQ(swipe.velocity(START + 1s), 0.f);
+    ASSERT_EQ(swipe.landing(START + 1s), 0);
+}
+
+TEST(WorkspaceSwipeTest, swipes_do_not_land_on_a_missing_workspace)
+{
+    WorkspaceSwipe swipe(WIDTH, true, false);
+    for (int i = 1; i <= 5; i++)
+        swipe.update(200.f, START + i * 10ms);
+    ASSERT_EQ(swipe.landing(START + 50ms), 0);
+}
+
+TEST(WorkspaceSwipeTest, faster_releases_animate_for_less_time)
+{
+    auto const slow = WorkspaceSwipe::release_duration(500.f, 1000.f, 1.f);
+    auto const fast = WorkspaceSwipe::release_duration(500.f, 5000.f, 1.f);
+    ASSERT_LT(fast, slow);
+    ASSERT_FLOAT_EQ(WorkspaceSwipe::release_duration(500.f, 0.f, 0.4f), 0.4f);
+    ASSERT_FLOAT_EQ(WorkspaceSwipe::release_duration(500.f, 10.f, 0.4f), 0.4f);
+}
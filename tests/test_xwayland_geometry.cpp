@@ -0,0 +1,99 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "xwayland_geometry.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+using namespace std::chrono_literals;
+
+namespace
+{
+int const WINDOW = 1;
+mir::geometry::Size const SMALL { 400, 300 };
+mir::geometry::Size const MEDIUM { 500, 400 };
+mir::geometry::Size const LARGE { 600, 500 };
+}
+
+class XwaylandGeometryTest : public testing::Test
+{
+public:
+    XwaylandGeometryTest()
+    {
+        geometry.track(&WINDOW, SMALL);
+    }
+
+    XwaylandGeometry geometry { 100ms };
+    XwaylandGeometry::clock::time_point const now = XwaylandGeometry::clock::now();
+};
+
+TEST_F(XwaylandGeometryTest, untracked_windows_are_sent_every_size)
+{
+    int const other = 2;
+    EXPECT_EQ(geometry.request(&other, MEDIUM, now), MEDIUM);
+    EXPECT_EQ(geometry.request(&other, LARGE, now), LARGE);
+}
+
+TEST_F(XwaylandGeometryTest, size_is_sent_when_nothing_is_in_flight)
+{
+    EXPECT_EQ(geometry.request(&WINDOW, MEDIUM, now), MEDIUM);
+    EXPECT_TRUE(geometry.is_awaiting_frame(&WINDOW));
+    EXPECT_EQ(geometry.sent(&WINDOW), MEDIUM);
+}
+
+TEST_F(XwaylandGeometryTest, sizes_are_queued_while_a_size_is_in_flight)
+{
+    geometry.request(&WINDOW, MEDIUM, now);
+    EXPECT_EQ(geometry.request(&WINDOW, LARGE, now + 1ms), std::nullopt);
+    EXPECT_EQ(geometry.sent(&WINDOW), MEDIUM);
+    EXPECT_EQ(geometry.target(&WINDOW), LARGE);
+}
+
+TEST_F(XwaylandGeometryTest, only_the_latest_queued_size_is_sent_once_the_window_answers)
+{
+    geometry.request(&WINDOW, MEDIUM, now);
+    geometry.request(&WINDOW, LARGE, now + 1ms);
+    geometry.request(&WINDOW, SMALL, now + 2ms);
+
+    EXPECT_EQ(geometry.frame_posted(&WINDOW, now + 3ms), SMALL);
+    EXPECT_TRUE(geometry.is_awaiting_frame(&WINDOW));
+    EXPECT_EQ(geometry.frame_posted(&WINDOW, now + 4ms), std::nullopt);
+    EXPECT_FALSE(geometry.is_awaiting_frame(&WINDOW));
+}
+
+TEST_F(XwaylandGeometryTest, going_back_to_the_size_in_flight_clears_the_queue)
+{
+    geometry.request(&WINDOW, MEDIUM, now);
+    geometry.request(&WINDOW, LARGE, now + 1ms);
+    EXPECT_EQ(geometry.request(&WINDOW, MEDIUM, now + 2ms), std::nullopt);
+
+    EXPECT_EQ(geometry.target(&WINDOW), MEDIUM);
+    EXPECT_EQ(geometry.frame_posted(&WINDOW, now + 3ms), std::nullopt);
+}
+
+TEST_F(XwaylandGeometryTest, size_is_sent_anyway_once_the_window_times_out)
+{
+    geometry.request(&WINDOW, MEDIUM, now);
+    EXPECT_EQ(geometry.request(&WINDOW, LARGE, now + 150ms), LARGE);
+}
+
+TEST_F(XwaylandGeometryTest, removed_windows_are_no_longer_paced)
+{
+    geometry.remove(&WINDOW);
+    EXPECT_FALSE(geometry.is_tracked(&WINDOW));
+    EXPECT_EQ(geometry.target(&WINDOW), std::nullopt);
+}